@@ -1364,6 +1364,38 @@ VBOXDDU_DECL(int) VDAsyncDiscardRanges(PVDISK pDisk, PCRTRANGE paRanges, unsigne
                                        PFNVDASYNCTRANSFERCOMPLETE pfnComplete,
                                        void *pvUser1, void *pvUser2);
 
+/**
+ * Statistics about the memory allocations done on the asynchronous I/O path,
+ * see VDQueryIoAllocStats().
+ */
+typedef struct VDIOALLOCSTATS
+{
+    /** Number of auxiliary allocations made for I/O contexts (deferred list
+     * nodes, metadata transfers, bounce buffers). */
+    uint64_t        cAllocs;
+    /** Number of heap allocations this resulted in, i.e. allocations which
+     * couldn't be served from the per-disk arena plus arena chunk allocations. */
+    uint64_t        cHeapAllocs;
+    /** Number of times the per-disk arena was emptied and reset. */
+    uint64_t        cArenaResets;
+    /** Number of bytes held by the per-disk arena. */
+    uint64_t        cbArena;
+} VDIOALLOCSTATS;
+/** Pointer to I/O allocation statistics. */
+typedef VDIOALLOCSTATS *PVDIOALLOCSTATS;
+
+/**
+ * Queries the I/O path allocation statistics of a disk.
+ *
+ * Briefly takes the disk lock, which may process queued I/O on the calling
+ * thread.
+ *
+ * @return  VBox status code.
+ * @param   pDisk           Pointer to HDD container.
+ * @param   pStats          Where to store the statistics.
+ */
+VBOXDDU_DECL(int) VDQueryIoAllocStats(PVDISK pDisk, PVDIOALLOCSTATS pStats);
+
 /**
  * Tries to repair a corrupted image.
  *
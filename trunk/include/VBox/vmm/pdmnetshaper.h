@@ -41,6 +41,8 @@
 
 #define PDM_NETSHAPER_MIN_BUCKET_SIZE UINT32_C(65536) /**< bytes */
 #define PDM_NETSHAPER_MAX_LATENCY     UINT32_C(100)   /**< milliseconds */
+#define PDM_NETSHAPER_DEFAULT_WEIGHT  UINT32_C(1)     /**< relative share under contention */
+#define PDM_NETSHAPER_MAX_WEIGHT      UINT32_C(1000)
 
 RT_C_DECLS_BEGIN
 
@@ -55,7 +57,16 @@ typedef struct PDMNSFILTER
     /** Set when the filter fails to obtain bandwidth. */
     bool                                fChoked;
     /** Aligment padding. */
-    bool                                afPadding[HC_ARCH_BITS == 32 ? 3 : 7];
+    bool                                afPadding[3];
+    /** The share of this filter relative to the other filters of the group
+     * when they compete for bandwidth (PDM_NETSHAPER_DEFAULT_WEIGHT if 0).
+     * Set by the driver before attaching. */
+    uint32_t                            uWeight;
+    /** Bytes handed to this filter by the TX thread while it was choked, used
+     * before taking tokens from the group (protected by the group lock). */
+    uint32_t                            cbCredit;
+    /** Aligment padding. */
+    uint32_t                            u32Padding;
     /** The driver this filter is aggregated into (ring-3). */
     R3PTRTYPE(PPDMINETWORKDOWN)         pIDrvNetR3;
 } PDMNSFILTER;
@@ -652,6 +652,11 @@ VMM_INT_DECL(int)   PGMPhysIemGCPhys2PtrNoLock(PVM pVM, PVMCPU pVCpu, RTGCPHYS G
 #define PGMIEMGCPHYS2PTR_F_NO_READ      RT_BIT_32(4)    /**< Not readable (IEMTLBE_F_PG_NO_READ). */
 #define PGMIEMGCPHYS2PTR_F_NO_MAPPINGR3 RT_BIT_32(7)    /**< No ring-3 mapping (IEMTLBE_F_NO_MAPPINGR3). */
 /** @} */
+#ifdef IN_RING3
+VMM_INT_DECL(int)   PGMPhysIemQueryCodePage(PVM pVM, PVMCPU pVCpu, RTGCPHYS GCPhys, uint8_t const **ppbPage,
+                                            void const **ppvPage, uint64_t *puCookie, uint32_t *puGen);
+VMM_INT_DECL(bool)  PGMPhysIemIsCodePageValid(PVM pVM, void const *pvPage, uint64_t uCookie, uint32_t uGen);
+#endif
 
 #ifdef VBOX_STRICT
 VMMDECL(unsigned)   PGMAssertHandlerAndFlagsInSync(PVM pVM);
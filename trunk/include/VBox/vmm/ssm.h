@@ -1216,6 +1216,25 @@ VMMR3DECL(void)         SSMR3HandleReportLivePercent(PSSMHANDLE pSSM, unsigned u
 VMMR3DECL(int)          SSMR3Cancel(PUVM pUVM);
 
 
+/** @name Striped TCP streams.
+ * @{ */
+/** Handle to a striped (multi-connection) TCP stream. */
+typedef struct SSMTCPSTRIPE *PSSMTCPSTRIPE;
+/** The max number of data connections in a striped TCP stream. */
+#define SSM_TCP_STRIPE_MAX_CONNS    16
+VMMR3DECL(int)          SSMR3TcpStripeCreate(bool fWrite, PRTSOCKET pahSockets, uint32_t cSockets, RTSOCKET hCtrlSocket,
+                                             PSSMTCPSTRIPE *ppStripe);
+VMMR3DECL(int)          SSMR3TcpStripeListen(RTSOCKET hCtrlSocket, const char *pszAddress, uint32_t cConns, bool fWrite,
+                                             PSSMTCPSTRIPE *ppStripe);
+VMMR3DECL(int)          SSMR3TcpStripeConnect(RTSOCKET hCtrlSocket, const char *pszAddress, uint32_t cConns, bool fWrite,
+                                              PSSMTCPSTRIPE *ppStripe);
+VMMR3DECL(int)          SSMR3TcpStripeReset(PSSMTCPSTRIPE pStripe);
+VMMR3DECL(int)          SSMR3TcpStripeDestroy(PSSMTCPSTRIPE pStripe);
+VMMR3DECL(PCSSMSTRMOPS) SSMR3TcpStripeGetOps(void);
+VMMR3DECL(uint64_t)     SSMR3TcpStripeGetConnBytes(PSSMTCPSTRIPE pStripe, uint32_t iConn);
+/** @} */
+
+
 /** Save operations.
  * @{
  */
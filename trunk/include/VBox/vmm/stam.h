@@ -27,6 +27,7 @@
 #define ___VBox_vmm_stam_h
 
 #include <VBox/types.h>
+#include <iprt/assert.h>
 #include <iprt/stdarg.h>
 #ifdef _MSC_VER
 # if _MSC_VER >= 1400
@@ -1238,6 +1239,102 @@ typedef FNSTAMR3ENUM *PFNSTAMR3ENUM;
 VMMR3DECL(int)  STAMR3Enum(PUVM pUVM, const char *pszPat, PFNSTAMR3ENUM pfnEnum, void *pvUser);
 VMMR3DECL(const char *) STAMR3GetUnit(STAMUNIT enmUnit);
 
+/** Pointer to a compiled sample index (opaque).
+ * @see STAMR3IndexCompile */
+typedef struct STAMINDEX *PSTAMINDEX;
+
+VMMR3DECL(int)      STAMR3IndexCompile(PUVM pUVM, const char *pszPat, PSTAMINDEX *ppIndex);
+VMMR3DECL(int)      STAMR3IndexRelease(PUVM pUVM, PSTAMINDEX pIndex);
+VMMR3DECL(uint32_t) STAMR3IndexGetSampleCount(PSTAMINDEX pIndex);
+VMMR3DECL(uint32_t) STAMR3IndexGetValueCount(PSTAMINDEX pIndex);
+VMMR3DECL(int)      STAMR3IndexQuerySample(PSTAMINDEX pIndex, uint32_t iSample, const char **ppszName, STAMTYPE *penmType,
+                                           STAMUNIT *penmUnit, uint32_t *piValue, uint32_t *pcValues);
+VMMR3DECL(int)      STAMR3SnapshotBinary(PUVM pUVM, PSTAMINDEX pIndex, uint64_t *pau64Values, uint32_t cValues);
+VMMR3DECL(uint32_t) STAMR3GetTypeValueCount(STAMTYPE enmType);
+
+
+/**
+ * Header of the shared memory statistics export area.
+ *
+ * The area consists of this header, an array of STAMEXPORTSAMPLE entries,
+ * the sample names and the 64-bit values (layout as for
+ * STAMR3SnapshotBinary).  Everything but the values and the two volatile
+ * header members is static for the lifetime of the export.
+ *
+ * Readers must not take any locks, they use the sequence counter instead:
+ *      -# Read uSeq, retry after a short while if it's odd (update pending).
+ *      -# Read fence, then copy the values they're interested in.
+ *      -# Read fence, then read uSeq again and start over if it changed.
+ */
+typedef struct STAMEXPORTHDR
+{
+    /** Magic value (STAMEXPORTHDR_MAGIC). */
+    uint32_t            u32Magic;
+    /** Layout version (STAMEXPORTHDR_VERSION). */
+    uint32_t            u32Version;
+    /** The size of the whole export area. */
+    uint32_t            cbArea;
+    /** Number of entries in the sample array. */
+    uint32_t            cSamples;
+    /** Number of 64-bit values. */
+    uint32_t            cValues;
+    /** Offset of the STAMEXPORTSAMPLE array. */
+    uint32_t            offSamples;
+    /** Offset of the sample name strings. */
+    uint32_t            offNames;
+    /** Offset of the 64-bit values (64 byte aligned). */
+    uint32_t            offValues;
+    /** The update sequence number, odd while an update is in progress. */
+    uint32_t volatile   uSeq;
+    /** Explicit alignment padding. */
+    uint32_t            u32Padding;
+    /** The RTTimeNanoTS value of the last update. */
+    uint64_t volatile   u64NanoTS;
+    /** Reserved for future use, zero. */
+    uint64_t            au64Reserved[2];
+} STAMEXPORTHDR;
+AssertCompileSize(STAMEXPORTHDR, 64);
+/** Pointer to a shared memory export header. */
+typedef STAMEXPORTHDR *PSTAMEXPORTHDR;
+/** Pointer to a const shared memory export header. */
+typedef STAMEXPORTHDR const *PCSTAMEXPORTHDR;
+
+/** STAMEXPORTHDR::u32Magic value (ASCII 'STAM'). */
+#define STAMEXPORTHDR_MAGIC     UINT32_C(0x4d415453)
+/** STAMEXPORTHDR::u32Version value. */
+#define STAMEXPORTHDR_VERSION   UINT32_C(0x00010000)
+
+/**
+ * Sample entry in the shared memory statistics export area.
+ */
+typedef struct STAMEXPORTSAMPLE
+{
+    /** Offset of the sample name relative to STAMEXPORTHDR::offNames. */
+    uint32_t            offName;
+    /** The index of the first value. */
+    uint32_t            iValue;
+    /** The sample type (STAMTYPE). */
+    uint8_t             enmType;
+    /** The sample unit (STAMUNIT). */
+    uint8_t             enmUnit;
+    /** The number of values (see STAMR3GetTypeValueCount). */
+    uint16_t            cValues;
+    /** Reserved, zero. */
+    uint32_t            u32Reserved;
+} STAMEXPORTSAMPLE;
+AssertCompileSize(STAMEXPORTSAMPLE, 16);
+/** Pointer to a const shared memory export sample entry. */
+typedef STAMEXPORTSAMPLE const *PCSTAMEXPORTSAMPLE;
+
+/** Pointer to a shared memory statistics export (opaque).
+ * @see STAMR3ExportCreate */
+typedef struct STAMEXPORT *PSTAMEXPORT;
+
+VMMR3DECL(int)      STAMR3ExportCreate(PUVM pUVM, const char *pszPat, const char *pszFile, PSTAMEXPORT *ppExport);
+VMMR3DECL(int)      STAMR3ExportUpdate(PUVM pUVM, PSTAMEXPORT pExport);
+VMMR3DECL(PCSTAMEXPORTHDR) STAMR3ExportGetArea(PSTAMEXPORT pExport, size_t *pcbArea);
+VMMR3DECL(int)      STAMR3ExportDestroy(PUVM pUVM, PSTAMEXPORT pExport);
+
 /** @} */
 
 /** @} */
@@ -78,6 +78,10 @@ typedef enum TMCLOCK
 /** No critical section needed or a custom one is set using
  *  TMR3TimerSetCritSect(). */
 #define TMTIMER_FLAGS_NO_CRIT_SECT      RT_BIT_32(0)
+/** The timer callback doesn't need to run on EMT and can be serviced by the
+ *  timer thread pool.  Only valid for TMCLOCK_VIRTUAL and TMCLOCK_REAL timers,
+ *  ignored when the pool is disabled (/TM/TimerThreads = 0). */
+#define TMTIMER_FLAGS_NO_EMT            RT_BIT_32(1)
 /** @} */
 
 
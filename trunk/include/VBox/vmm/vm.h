@@ -146,7 +146,7 @@ typedef struct VMCPU
 #ifdef ___IEMInternal_h
         struct IEMCPU       s;
 #endif
-        uint8_t             padding[18496];     /* multiple of 64 */
+        uint8_t             padding[18816];     /* multiple of 64 */
     } iem;
 
     /** HM part. */
@@ -253,7 +253,7 @@ typedef struct VMCPU
     STAMPROFILEADV          aStatAdHoc[8];                          /* size: 40*8 = 320 */
 
     /** Align the following members on page boundary. */
-    uint8_t                 abAlignment2[2168];
+    uint8_t                 abAlignment2[1848];
 
     /** PGM part. */
     union VMCPUUNIONPGM
@@ -0,0 +1,203 @@
+/** @file
+ * IPRT - B+Trees.
+ */
+
+/*
+ * Copyright (C) 2016 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ *
+ * The contents of this file may alternatively be used under the terms
+ * of the Common Development and Distribution License Version 1.0
+ * (CDDL) only, as it comes in the "COPYING.CDDL" file of the
+ * VirtualBox OSE distribution, in which case the provisions of the
+ * CDDL are applicable instead of those of the GPL.
+ *
+ * You may elect to license modified versions of this file under the
+ * terms and conditions of either the GPL or the CDDL or both.
+ */
+
+#ifndef ___iprt_btree_h
+#define ___iprt_btree_h
+
+#include <iprt/cdefs.h>
+#include <iprt/types.h>
+
+RT_C_DECLS_BEGIN
+
+/** @defgroup grp_rt_btree  RTBTree - B+Trees
+ * @ingroup grp_rt
+ *
+ * Range maps with the same semantics as the corresponding AVL range trees
+ * (see @ref grp_rt_avl), but keeping the keys packed in cache line sized
+ * nodes.  A lookup touches a handful of nodes instead of one node per tree
+ * level, which makes a big difference once the tree no longer fits in the
+ * cache.
+ *
+ * Like with the AVL trees the caller owns the nodes: it embeds a node core in
+ * its own structure and the tree stores a pointer to it.  Unlike the AVL trees
+ * the B+tree allocates its internal nodes from the heap, so insertion can fail
+ * with VERR_NO_MEMORY.  The trees are usable in ring-3 and ring-0, but a tree
+ * must only be accessed in the context it was created in.
+ *
+ * The trees do no serialization.
+ *
+ * @{
+ */
+
+
+/** B+tree with uint64_t ranges.
+ * @{
+ */
+
+/** B+tree key type. */
+typedef uint64_t RTBTREERU64KEY;
+
+/**
+ * B+tree node core, embedded in the user structure.
+ *
+ * The members are the same as the first two of AVLRU64NODECORE.
+ */
+typedef struct RTBTREERU64NODECORE
+{
+    RTBTREERU64KEY          Key;        /**< First key value in the range (inclusive). */
+    RTBTREERU64KEY          KeyLast;    /**< Last key value in the range (inclusive). */
+} RTBTREERU64NODECORE;
+/** Pointer to a B+tree node core. */
+typedef RTBTREERU64NODECORE *PRTBTREERU64NODECORE;
+
+/**
+ * B+tree with uint64_t ranges.
+ *
+ * Initialize it with RTBTREERU64TREE_INITIALIZER or by zeroing it.  The
+ * members are private to the implementation except for cEntries, which may be
+ * read.
+ */
+typedef struct RTBTREERU64TREE
+{
+    /** The root node, NULL if the tree is empty. */
+    void                   *pvRoot;
+    /** The number of node levels, zero if the tree is empty. */
+    uint32_t                cDepth;
+    /** The number of entries (user nodes) in the tree. */
+    uint32_t                cEntries;
+} RTBTREERU64TREE;
+/** Pointer to a B+tree with uint64_t ranges. */
+typedef RTBTREERU64TREE *PRTBTREERU64TREE;
+
+/** Static initializer for RTBTREERU64TREE. */
+#define RTBTREERU64TREE_INITIALIZER     { NULL, 0, 0 }
+
+/** Callback function for RTBTreeRU64DoWithAll() and RTBTreeRU64Destroy().
+ *  @returns IPRT status codes. */
+typedef DECLCALLBACK(int) RTBTREERU64CALLBACK(PRTBTREERU64NODECORE, void *);
+/** Pointer to callback function for RTBTreeRU64DoWithAll(). */
+typedef RTBTREERU64CALLBACK *PRTBTREERU64CALLBACK;
+
+/*
+ * Functions.
+ */
+
+/**
+ * Inserts a node.
+ *
+ * @returns IPRT status code.
+ * @retval  VERR_ALREADY_EXISTS if the range overlaps an existing one.
+ * @retval  VERR_NO_MEMORY if a tree node could not be allocated.  The tree is
+ *          left unchanged.
+ * @param   pTree       The tree.
+ * @param   pNode       The node to insert.  Key and KeyLast must be set and
+ *                      Key <= KeyLast.
+ */
+RTDECL(int)                  RTBTreeRU64Insert(PRTBTREERU64TREE pTree, PRTBTREERU64NODECORE pNode);
+
+/**
+ * Removes the node with the given start key.
+ *
+ * @returns Pointer to the removed node, NULL if not found.
+ * @param   pTree       The tree.
+ * @param   Key         The first key of the range.
+ */
+RTDECL(PRTBTREERU64NODECORE) RTBTreeRU64Remove(PRTBTREERU64TREE pTree, RTBTREERU64KEY Key);
+
+/**
+ * Gets the node with the given start key.
+ *
+ * @returns Pointer to the node, NULL if not found.
+ * @param   pTree       The tree.
+ * @param   Key         The first key of the range.
+ */
+RTDECL(PRTBTREERU64NODECORE) RTBTreeRU64Get(PRTBTREERU64TREE pTree, RTBTREERU64KEY Key);
+
+/**
+ * Gets the node whose range contains the given key.
+ *
+ * @returns Pointer to the node, NULL if not found.
+ * @param   pTree       The tree.
+ * @param   Key         The key to look up.
+ */
+RTDECL(PRTBTREERU64NODECORE) RTBTreeRU64RangeGet(PRTBTREERU64TREE pTree, RTBTREERU64KEY Key);
+
+/**
+ * Removes the node whose range contains the given key.
+ *
+ * @returns Pointer to the removed node, NULL if not found.
+ * @param   pTree       The tree.
+ * @param   Key         The key to look up.
+ */
+RTDECL(PRTBTREERU64NODECORE) RTBTreeRU64RangeRemove(PRTBTREERU64TREE pTree, RTBTREERU64KEY Key);
+
+/**
+ * Finds the node with the start key closest to the given one.
+ *
+ * @returns Pointer to the node, NULL if none.
+ * @param   pTree       The tree.
+ * @param   Key         The key to look up.
+ * @param   fAbove      true: the node with the smallest start key >= Key.
+ *                      false: the node with the largest start key <= Key.
+ */
+RTDECL(PRTBTREERU64NODECORE) RTBTreeRU64GetBestFit(PRTBTREERU64TREE pTree, RTBTREERU64KEY Key, bool fAbove);
+
+/**
+ * Calls a callback for each node in key order.
+ *
+ * The callback must not modify the tree.
+ *
+ * @returns VINF_SUCCESS, or the first non-zero status returned by the callback,
+ *          which stops the enumeration.
+ * @param   pTree       The tree.
+ * @param   fFromLeft   true: ascending order, false: descending order.
+ * @param   pfnCallBack The callback.
+ * @param   pvParam     User argument for the callback.
+ */
+RTDECL(int)                  RTBTreeRU64DoWithAll(PRTBTREERU64TREE pTree, int fFromLeft, PRTBTREERU64CALLBACK pfnCallBack, void *pvParam);
+
+/**
+ * Destroys the tree, calling a callback for each node.
+ *
+ * Each node is unlinked before the callback is called, so the callback may
+ * free it.
+ *
+ * @returns VINF_SUCCESS, or the first non-zero status returned by the callback.
+ *          On failure only further calls to RTBTreeRU64Destroy may be made on
+ *          the tree.  The node the callback failed on is considered unlinked.
+ * @param   pTree       The tree.
+ * @param   pfnCallBack The callback, optional.
+ * @param   pvParam     User argument for the callback.
+ */
+RTDECL(int)                  RTBTreeRU64Destroy(PRTBTREERU64TREE pTree, PRTBTREERU64CALLBACK pfnCallBack, void *pvParam);
+
+/** @} */
+
+/** @} */
+
+RT_C_DECLS_END
+
+#endif
+
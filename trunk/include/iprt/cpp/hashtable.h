@@ -0,0 +1,370 @@
+/** @file
+ * IPRT - Generic Hash Table Class.
+ */
+
+/*
+ * Copyright (C) 2016 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ *
+ * The contents of this file may alternatively be used under the terms
+ * of the Common Development and Distribution License Version 1.0
+ * (CDDL) only, as it comes in the "COPYING.CDDL" file of the
+ * VirtualBox OSE distribution, in which case the provisions of the
+ * CDDL are applicable instead of those of the GPL.
+ *
+ * You may elect to license modified versions of this file under the
+ * terms and conditions of either the GPL or the CDDL or both.
+ */
+
+#ifndef ___iprt_cpp_hashtable_h
+#define ___iprt_cpp_hashtable_h
+
+#include <iprt/assert.h>
+#include <iprt/mem.h>
+#include <iprt/cpp/ministring.h>
+
+#include <new> /* For std::bad_alloc and placement new. */
+
+/** @defgroup grp_rt_cpp_hashtable   C++ Hash Table support
+ * @ingroup grp_rt_cpp
+ *
+ * @brief  Generic C++ hash table class support.
+ *
+ * RTCHashTable maps keys to values using open addressing with linear probing
+ * in a power of two sized table.  Deletion shifts the following entries back
+ * instead of leaving tombstones, so lookups never get slower as the table
+ * sees churn.  The table doubles when it gets three quarters full.
+ *
+ * Like the list classes there are no dependencies on STL.  The key and value
+ * types need a copy constructor; they are copied when the table is resized or
+ * an entry is moved during deletion.  The hash function and key comparison
+ * are supplied by a traits class, see RTCHashTableKeyTraits.
+ *
+ * The hash table class is reentrant.  For a thread-safe variant see
+ * RTCMTHashTable.
+ *
+ * @{
+ */
+
+/**
+ * Hashes a block of memory (FNV-1a).
+ *
+ * @returns 32-bit hash value.
+ * @param   pv          The memory to hash.
+ * @param   cb          The number of bytes.
+ */
+DECLINLINE(uint32_t) RTCHashTableHashBytes(const void *pv, size_t cb)
+{
+    uint8_t const *pb    = (uint8_t const *)pv;
+    uint32_t       uHash = UINT32_C(0x811c9dc5);
+    while (cb-- > 0)
+    {
+        uHash ^= *pb++;
+        uHash *= UINT32_C(0x01000193);
+    }
+    return uHash;
+}
+
+/**
+ * Default key traits: hashes the key bytes and compares with operator==.
+ *
+ * Only suitable for integer, pointer and other plain keys without padding.
+ * Specialize it (or pass your own traits class) for anything else.
+ */
+template <typename K>
+struct RTCHashTableKeyTraits
+{
+    static uint32_t hash(K const &rKey)                     { return RTCHashTableHashBytes(&rKey, sizeof(rKey)); }
+    static bool     equals(K const &rKey1, K const &rKey2)  { return rKey1 == rKey2; }
+};
+
+/**
+ * Key traits for RTCString keys.
+ */
+template <>
+struct RTCHashTableKeyTraits<RTCString>
+{
+    static uint32_t hash(RTCString const &rKey)                         { return RTCHashTableHashBytes(rKey.c_str(), rKey.length()); }
+    static bool     equals(RTCString const &rKey1, RTCString const &rKey2) { return rKey1 == rKey2; }
+};
+
+
+/**
+ * Generic hash table class.
+ *
+ * @tparam  K       The key type.
+ * @tparam  V       The value type.
+ * @tparam  KT      The key traits, providing static hash() and equals()
+ *                  methods.
+ */
+template <typename K, typename V, typename KT = RTCHashTableKeyTraits<K> >
+class RTCHashTable
+{
+public:
+    /**
+     * Creates a new, empty hash table.
+     *
+     * @param   cCapacity   The number of entries to make room for up front.
+     * @throws  std::bad_alloc
+     */
+    RTCHashTable(size_t cCapacity = 0)
+        : m_pauHashes(NULL)
+        , m_paEntries(NULL)
+        , m_cEntries(0)
+        , m_fMask(0)
+    {
+        size_t cSlots = kMinSlots;
+        while (cSlots - cSlots / 4 < cCapacity)
+            cSlots *= 2;
+        realloc(cSlots);
+    }
+
+    /**
+     * Destroys the hash table and all the keys and values in it.
+     */
+    ~RTCHashTable()
+    {
+        clear();
+        RTMemFree(m_pauHashes);
+        RTMemFree(m_paEntries);
+    }
+
+    /**
+     * Inserts or replaces an entry.
+     *
+     * @returns true if the key was new, false if an existing value was
+     *          replaced.
+     * @param   rKey        The key.
+     * @param   rValue      The value.
+     * @throws  std::bad_alloc
+     */
+    bool insert(K const &rKey, V const &rValue)
+    {
+        uint32_t const uHash = hashKey(rKey);
+        size_t         i     = find(rKey, uHash);
+        if (i != kNotFound)
+        {
+            m_paEntries[i].Value = rValue;
+            return false;
+        }
+
+        if (m_cEntries + 1 > (m_fMask + 1) - (m_fMask + 1) / 4)
+            realloc((m_fMask + 1) * 2);
+
+        i = uHash & m_fMask;
+        while (m_pauHashes[i])
+            i = (i + 1) & m_fMask;
+        new (&m_paEntries[i]) Entry(rKey, rValue);
+        m_pauHashes[i] = uHash;
+        m_cEntries++;
+        return true;
+    }
+
+    /**
+     * Looks up the value of a key.
+     *
+     * @returns Pointer to the value, NULL if not found.  The pointer is valid
+     *          until the table is modified.
+     * @param   rKey        The key.
+     */
+    V *lookup(K const &rKey)
+    {
+        size_t i = find(rKey, hashKey(rKey));
+        return i != kNotFound ? &m_paEntries[i].Value : NULL;
+    }
+
+    /**
+     * Looks up the value of a key, const version.
+     *
+     * @returns Pointer to the value, NULL if not found.  The pointer is valid
+     *          until the table is modified.
+     * @param   rKey        The key.
+     */
+    V const *lookup(K const &rKey) const
+    {
+        size_t i = find(rKey, hashKey(rKey));
+        return i != kNotFound ? &m_paEntries[i].Value : NULL;
+    }
+
+    /**
+     * Checks whether a key is in the table.
+     *
+     * @returns true if found, false if not.
+     * @param   rKey        The key.
+     */
+    bool contains(K const &rKey) const
+    {
+        return find(rKey, hashKey(rKey)) != kNotFound;
+    }
+
+    /**
+     * Removes an entry.
+     *
+     * @returns true if found and removed, false if not found.
+     * @param   rKey        The key.
+     */
+    bool remove(K const &rKey)
+    {
+        size_t i = find(rKey, hashKey(rKey));
+        if (i == kNotFound)
+            return false;
+
+        m_paEntries[i].~Entry();
+        m_pauHashes[i] = 0;
+        m_cEntries--;
+
+        /* Shift back entries which are displaced past the hole. */
+        size_t j = i;
+        for (;;)
+        {
+            j = (j + 1) & m_fMask;
+            if (!m_pauHashes[j])
+                break;
+            size_t const iHome = m_pauHashes[j] & m_fMask;
+            if (((j - iHome) & m_fMask) >= ((j - i) & m_fMask))
+            {
+                new (&m_paEntries[i]) Entry(m_paEntries[j]);
+                m_pauHashes[i] = m_pauHashes[j];
+                m_paEntries[j].~Entry();
+                m_pauHashes[j] = 0;
+                i = j;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * Removes all entries, keeping the allocated table.
+     */
+    void clear()
+    {
+        for (size_t i = 0; i <= m_fMask && m_cEntries > 0; i++)
+            if (m_pauHashes[i])
+            {
+                m_paEntries[i].~Entry();
+                m_pauHashes[i] = 0;
+                m_cEntries--;
+            }
+        Assert(!m_cEntries);
+    }
+
+    /**
+     * Calls a functor for each entry.
+     *
+     * The functor is called as rFunctor(K const &rKey, V &rValue) and must not
+     * modify the table.
+     *
+     * @param   rFunctor    The functor.
+     */
+    template <typename F>
+    void forEach(F &rFunctor)
+    {
+        for (size_t i = 0; i <= m_fMask; i++)
+            if (m_pauHashes[i])
+                rFunctor(const_cast<K const &>(m_paEntries[i].Key), m_paEntries[i].Value);
+    }
+
+    /** Returns the number of entries in the table. */
+    size_t size() const { return m_cEntries; }
+
+    /** Returns true if the table is empty. */
+    bool isEmpty() const { return m_cEntries == 0; }
+
+    /** Returns the number of slots in the table. */
+    size_t capacity() const { return m_fMask + 1; }
+
+    /* Define our own new and delete. */
+    RTMEMEF_NEW_AND_DELETE_OPERATORS();
+
+private:
+    /** A table entry. */
+    struct Entry
+    {
+        Entry(K const &rKey, V const &rValue) : Key(rKey), Value(rValue) {}
+        K Key;
+        V Value;
+    };
+
+    /** The smallest table size. */
+    static const size_t kMinSlots = 16;
+    /** find() return value for not found. */
+    static const size_t kNotFound = ~(size_t)0;
+
+    /** Hashes a key, returning a value that is never zero (zero marks empty
+     *  slots). */
+    static uint32_t hashKey(K const &rKey)
+    {
+        return KT::hash(rKey) | UINT32_C(0x80000000);
+    }
+
+    /** Finds the slot of a key, kNotFound if not present. */
+    size_t find(K const &rKey, uint32_t uHash) const
+    {
+        size_t i = uHash & m_fMask;
+        uint32_t uSlotHash;
+        while ((uSlotHash = m_pauHashes[i]) != 0)
+        {
+            if (   uSlotHash == uHash
+                && KT::equals(m_paEntries[i].Key, rKey))
+                return i;
+            i = (i + 1) & m_fMask;
+        }
+        return kNotFound;
+    }
+
+    /** Moves all entries into a newly allocated table with @a cSlots slots. */
+    void realloc(size_t cSlots)
+    {
+        uint32_t *pauHashes = (uint32_t *)RTMemAllocZ(cSlots * sizeof(uint32_t));
+        Entry    *paEntries = (Entry *)RTMemAlloc(cSlots * sizeof(Entry));
+        if (RT_UNLIKELY(!pauHashes || !paEntries))
+        {
+            RTMemFree(pauHashes);
+            RTMemFree(paEntries);
+            throw std::bad_alloc();
+        }
+
+        size_t const fMask = cSlots - 1;
+        for (size_t iOld = 0; m_pauHashes && iOld <= m_fMask; iOld++)
+            if (m_pauHashes[iOld])
+            {
+                size_t i = m_pauHashes[iOld] & fMask;
+                while (pauHashes[i])
+                    i = (i + 1) & fMask;
+                new (&paEntries[i]) Entry(m_paEntries[iOld]);
+                pauHashes[i] = m_pauHashes[iOld];
+                m_paEntries[iOld].~Entry();
+            }
+
+        RTMemFree(m_pauHashes);
+        RTMemFree(m_paEntries);
+        m_pauHashes = pauHashes;
+        m_paEntries = paEntries;
+        m_fMask     = fMask;
+    }
+
+    /* Not copyable. */
+    RTCHashTable(RTCHashTable const &);
+    RTCHashTable &operator=(RTCHashTable const &);
+
+    /** The hash of each slot, zero if free. */
+    uint32_t   *m_pauHashes;
+    /** The entries, only constructed where m_pauHashes is non-zero. */
+    Entry      *m_paEntries;
+    /** The number of entries. */
+    size_t      m_cEntries;
+    /** The table size minus one. */
+    size_t      m_fMask;
+};
+
+/** @} */
+
+#endif
+
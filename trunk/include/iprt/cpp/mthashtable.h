@@ -0,0 +1,253 @@
+/** @file
+ * IPRT - Generic thread-safe Hash Table Class.
+ */
+
+/*
+ * Copyright (C) 2016 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ *
+ * The contents of this file may alternatively be used under the terms
+ * of the Common Development and Distribution License Version 1.0
+ * (CDDL) only, as it comes in the "COPYING.CDDL" file of the
+ * VirtualBox OSE distribution, in which case the provisions of the
+ * CDDL are applicable instead of those of the GPL.
+ *
+ * You may elect to license modified versions of this file under the
+ * terms and conditions of either the GPL or the CDDL or both.
+ */
+
+#ifndef ___iprt_cpp_mthashtable_h
+#define ___iprt_cpp_mthashtable_h
+
+#include <iprt/cpp/hashtable.h>
+#include <iprt/semaphore.h>
+
+/** @addtogroup grp_rt_cpp_hashtable
+ * @{
+ */
+
+/**
+ * @brief Generic thread-safe hash table class.
+ *
+ * RTCMTHashTable splits the keys over @a a_cStripes independent RTCHashTable
+ * instances, each protected by its own read/write semaphore.  Lookups of keys
+ * in the same stripe run in parallel, and writers only block the users of
+ * their own stripe, so the table scales with the number of threads as long as
+ * the keys hash well.  Resizing is done per stripe and therefore only stalls
+ * a fraction of the table at a time.
+ *
+ * Since another thread may modify the table at any time, lookup() copies the
+ * value out instead of returning a pointer.
+ *
+ * @tparam  K           The key type.
+ * @tparam  V           The value type.
+ * @tparam  KT          The key traits, see RTCHashTableKeyTraits.
+ * @tparam  a_cStripes  The number of stripes, must be a power of two.
+ */
+template <typename K, typename V, typename KT = RTCHashTableKeyTraits<K>, unsigned a_cStripes = 16>
+class RTCMTHashTable
+{
+public:
+    /**
+     * Creates a new, empty hash table.
+     *
+     * @param   cCapacity   The number of entries to make room for up front.
+     * @throws  std::bad_alloc
+     */
+    RTCMTHashTable(size_t cCapacity = 0)
+    {
+        Assert(a_cStripes > 0 && !(a_cStripes & (a_cStripes - 1)));
+        for (unsigned i = 0; i < a_cStripes; i++)
+            m_aStripes[i].pTable = NULL;
+        for (unsigned i = 0; i < a_cStripes; i++)
+        {
+            int rc = RTSemRWCreateEx(&m_aStripes[i].hRWSem, RTSEMRW_FLAGS_NO_LOCK_VAL, NIL_RTLOCKVALCLASS, 0, NULL);
+            AssertRC(rc);
+            m_aStripes[i].pTable = new RTCHashTable<K, V, KT>(cCapacity / a_cStripes);
+        }
+    }
+
+    /**
+     * Destroys the hash table and all the keys and values in it.
+     */
+    ~RTCMTHashTable()
+    {
+        for (unsigned i = 0; i < a_cStripes; i++)
+        {
+            delete m_aStripes[i].pTable;
+            RTSemRWDestroy(m_aStripes[i].hRWSem);
+        }
+    }
+
+    /**
+     * Inserts or replaces an entry.
+     *
+     * @returns true if the key was new, false if an existing value was
+     *          replaced.
+     * @param   rKey        The key.
+     * @param   rValue      The value.
+     * @throws  std::bad_alloc
+     */
+    bool insert(K const &rKey, V const &rValue)
+    {
+        Stripe &rStripe = stripe(rKey);
+        WriteLock Lock(rStripe);
+        return rStripe.pTable->insert(rKey, rValue);
+    }
+
+    /**
+     * Looks up the value of a key.
+     *
+     * @returns true if found, false if not.
+     * @param   rKey        The key.
+     * @param   pValue      Where to copy the value.  Optional.
+     */
+    bool lookup(K const &rKey, V *pValue) const
+    {
+        Stripe &rStripe = stripe(rKey);
+        ReadLock Lock(rStripe);
+        V const *pFound = const_cast<RTCHashTable<K, V, KT> const *>(rStripe.pTable)->lookup(rKey);
+        if (!pFound)
+            return false;
+        if (pValue)
+            *pValue = *pFound;
+        return true;
+    }
+
+    /**
+     * Checks whether a key is in the table.
+     *
+     * @returns true if found, false if not.
+     * @param   rKey        The key.
+     */
+    bool contains(K const &rKey) const
+    {
+        return lookup(rKey, NULL);
+    }
+
+    /**
+     * Removes an entry.
+     *
+     * @returns true if found and removed, false if not found.
+     * @param   rKey        The key.
+     */
+    bool remove(K const &rKey)
+    {
+        Stripe &rStripe = stripe(rKey);
+        WriteLock Lock(rStripe);
+        return rStripe.pTable->remove(rKey);
+    }
+
+    /**
+     * Removes all entries.
+     */
+    void clear()
+    {
+        for (unsigned i = 0; i < a_cStripes; i++)
+        {
+            WriteLock Lock(m_aStripes[i]);
+            m_aStripes[i].pTable->clear();
+        }
+    }
+
+    /**
+     * Calls a functor for each entry, one stripe at a time.
+     *
+     * The stripe being walked is read locked.  The functor is called as
+     * rFunctor(K const &rKey, V &rValue) and must neither modify the value nor
+     * call back into the table.
+     *
+     * @param   rFunctor    The functor.
+     */
+    template <typename F>
+    void forEach(F &rFunctor) const
+    {
+        for (unsigned i = 0; i < a_cStripes; i++)
+        {
+            ReadLock Lock(m_aStripes[i]);
+            m_aStripes[i].pTable->forEach(rFunctor);
+        }
+    }
+
+    /**
+     * Returns the number of entries in the table.
+     *
+     * This is a snapshot and may be stale by the time it returns.
+     */
+    size_t size() const
+    {
+        size_t cEntries = 0;
+        for (unsigned i = 0; i < a_cStripes; i++)
+        {
+            ReadLock Lock(m_aStripes[i]);
+            cEntries += m_aStripes[i].pTable->size();
+        }
+        return cEntries;
+    }
+
+    /** Returns true if the table is empty (snapshot). */
+    bool isEmpty() const { return size() == 0; }
+
+    /* Define our own new and delete. */
+    RTMEMEF_NEW_AND_DELETE_OPERATORS();
+
+private:
+    /** A stripe, padded to a cache line so the locks don't share lines. */
+    struct Stripe
+    {
+        RTSEMRW                     hRWSem;
+        RTCHashTable<K, V, KT>     *pTable;
+        uint8_t                     abPadding[64 - sizeof(RTSEMRW) - sizeof(void *)];
+    };
+
+    /** Read lock holder. */
+    class ReadLock
+    {
+    public:
+        ReadLock(Stripe &rStripe) : m_rStripe(rStripe)
+        { int rc = RTSemRWRequestRead(m_rStripe.hRWSem, RT_INDEFINITE_WAIT); AssertRC(rc); }
+        ~ReadLock()
+        { int rc = RTSemRWReleaseRead(m_rStripe.hRWSem); AssertRC(rc); }
+    private:
+        Stripe &m_rStripe;
+    };
+
+    /** Write lock holder. */
+    class WriteLock
+    {
+    public:
+        WriteLock(Stripe &rStripe) : m_rStripe(rStripe)
+        { int rc = RTSemRWRequestWrite(m_rStripe.hRWSem, RT_INDEFINITE_WAIT); AssertRC(rc); }
+        ~WriteLock()
+        { int rc = RTSemRWReleaseWrite(m_rStripe.hRWSem); AssertRC(rc); }
+    private:
+        Stripe &m_rStripe;
+    };
+
+    /** Picks the stripe of a key.  Uses the top hash bits since the tables
+     *  index with the bottom ones. */
+    Stripe &stripe(K const &rKey) const
+    {
+        uint32_t uHash = KT::hash(rKey) * UINT32_C(0x9e3779b1);
+        return m_aStripes[(uHash >> 24) & (a_cStripes - 1)];
+    }
+
+    /* Not copyable. */
+    RTCMTHashTable(RTCMTHashTable const &);
+    RTCMTHashTable &operator=(RTCMTHashTable const &);
+
+    /** The stripes. */
+    mutable Stripe m_aStripes[a_cStripes];
+};
+
+/** @} */
+
+#endif
+
@@ -59,6 +59,9 @@ RTDECL(uint32_t)    RTCrc32Start(void);
 /**
  * Processes a multiblock of a CRC-32 calculation.
  *
+ * The intermediate value is the CRC-32 of the data processed so far, i.e. the
+ * same as zlib's crc32() would return.
+ *
  * @returns Intermediate CRC-32 value.
  * @param   uCRC32  Current CRC-32 intermediate value.
  * @param   pv      The data block to process.
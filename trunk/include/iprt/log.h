@@ -357,6 +357,14 @@ typedef enum RTLOGFLAGS
     RTLOGFLAGS_FLUSH                = 0x00000200,
     /** Restrict the number of log entries per group. */
     RTLOGFLAGS_RESTRICT_GROUPS      = 0x00000400,
+    /** Format into per-thread ring buffers without taking the logger lock and
+     * let a writer thread merge them in timestamp order (ring-3 only, ignored
+     * elsewhere).  Records not yet written are lost unless RTLogFlush or
+     * RTLogDestroy is called before the process exits. */
+    RTLOGFLAGS_ASYNC                = 0x00000800,
+    /** With RTLOGFLAGS_ASYNC: drop (and count) messages when the thread's ring
+     * buffer is full instead of writing them out synchronously. */
+    RTLOGFLAGS_ASYNC_DROP           = 0x00001000,
     /** New lines should be prefixed with the write and read lock counts. */
     RTLOGFLAGS_PREFIX_LOCK_COUNTS   = 0x00008000,
     /** New lines should be prefixed with the CPU id (ApicID on intel/amd). */
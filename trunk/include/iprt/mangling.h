@@ -562,6 +562,14 @@
 # define RTAvlULInsert                                  RT_MANGLER(RTAvlULInsert)
 # define RTAvlULRemove                                  RT_MANGLER(RTAvlULRemove)
 # define RTAvlULRemoveBestFit                           RT_MANGLER(RTAvlULRemoveBestFit)
+# define RTBTreeRU64Destroy                             RT_MANGLER(RTBTreeRU64Destroy)
+# define RTBTreeRU64DoWithAll                           RT_MANGLER(RTBTreeRU64DoWithAll)
+# define RTBTreeRU64Get                                 RT_MANGLER(RTBTreeRU64Get)
+# define RTBTreeRU64GetBestFit                          RT_MANGLER(RTBTreeRU64GetBestFit)
+# define RTBTreeRU64Insert                              RT_MANGLER(RTBTreeRU64Insert)
+# define RTBTreeRU64RangeGet                            RT_MANGLER(RTBTreeRU64RangeGet)
+# define RTBTreeRU64RangeRemove                         RT_MANGLER(RTBTreeRU64RangeRemove)
+# define RTBTreeRU64Remove                              RT_MANGLER(RTBTreeRU64Remove)
 # define RTBase64Decode                                 RT_MANGLER(RTBase64Decode)
 # define RTBase64DecodeEx                               RT_MANGLER(RTBase64DecodeEx)
 # define RTBase64DecodedSize                            RT_MANGLER(RTBase64DecodedSize)
@@ -1228,11 +1236,20 @@
 # define RTMemAllocVarTag                               RT_MANGLER(RTMemAllocVarTag)
 # define RTMemAllocZTag                                 RT_MANGLER(RTMemAllocZTag)
 # define RTMemAllocZVarTag                              RT_MANGLER(RTMemAllocZVarTag)
+# define RTMemArenaAlloc                                RT_MANGLER(RTMemArenaAlloc)
+# define RTMemArenaAllocZ                               RT_MANGLER(RTMemArenaAllocZ)
+# define RTMemArenaCreate                               RT_MANGLER(RTMemArenaCreate)
+# define RTMemArenaDestroy                              RT_MANGLER(RTMemArenaDestroy)
+# define RTMemArenaMark                                 RT_MANGLER(RTMemArenaMark)
+# define RTMemArenaQueryStats                           RT_MANGLER(RTMemArenaQueryStats)
+# define RTMemArenaReset                                RT_MANGLER(RTMemArenaReset)
+# define RTMemArenaResetToMark                          RT_MANGLER(RTMemArenaResetToMark)
 # define RTMemCacheAlloc                                RT_MANGLER(RTMemCacheAlloc)
 # define RTMemCacheAllocEx                              RT_MANGLER(RTMemCacheAllocEx)
 # define RTMemCacheCreate                               RT_MANGLER(RTMemCacheCreate)
 # define RTMemCacheDestroy                              RT_MANGLER(RTMemCacheDestroy)
 # define RTMemCacheFree                                 RT_MANGLER(RTMemCacheFree)
+# define RTMemCacheQueryStats                           RT_MANGLER(RTMemCacheQueryStats)
 # define RTMemContAlloc                                 RT_MANGLER(RTMemContAlloc) /* r0drv */
 # define RTMemContFree                                  RT_MANGLER(RTMemContFree) /* r0drv */
 # define RTMemDump                                      RT_MANGLER(RTMemDump)
@@ -1353,6 +1370,7 @@
 # define RTMsgWarning                                   RT_MANGLER(RTMsgWarning)
 # define RTMsgWarningV                                  RT_MANGLER(RTMsgWarningV)
 # define RTNetIPv4AddDataChecksum                       RT_MANGLER(RTNetIPv4AddDataChecksum)
+# define RTNetIPv4AddDataChecksumCopy                   RT_MANGLER(RTNetIPv4AddDataChecksumCopy)
 # define RTNetIPv4AddTCPChecksum                        RT_MANGLER(RTNetIPv4AddTCPChecksum)
 # define RTNetIPv4AddUDPChecksum                        RT_MANGLER(RTNetIPv4AddUDPChecksum)
 # define RTNetIPv4FinalizeChecksum                      RT_MANGLER(RTNetIPv4FinalizeChecksum)
@@ -1779,9 +1797,14 @@
 # define RTSocketWriteNB                                RT_MANGLER(RTSocketWriteNB)
 # define RTSocketWriteTo                                RT_MANGLER(RTSocketWriteTo)
 # define RTSocketWriteToNB                              RT_MANGLER(RTSocketWriteToNB)
+# define RTSortApvIntro                                 RT_MANGLER(RTSortApvIntro)
 # define RTSortApvIsSorted                              RT_MANGLER(RTSortApvIsSorted)
+# define RTSortApvMerge                                 RT_MANGLER(RTSortApvMerge)
 # define RTSortApvShell                                 RT_MANGLER(RTSortApvShell)
+# define RTSortIntro                                    RT_MANGLER(RTSortIntro)
 # define RTSortIsSorted                                 RT_MANGLER(RTSortIsSorted)
+# define RTSortMerge                                    RT_MANGLER(RTSortMerge)
+# define RTSortParallel                                 RT_MANGLER(RTSortParallel)
 # define RTSortShell                                    RT_MANGLER(RTSortShell)
 # define RTSpinlockAcquire                              RT_MANGLER(RTSpinlockAcquire)
 # define RTSpinlockAcquireNoInts                        RT_MANGLER(RTSpinlockAcquireNoInts)
@@ -1797,6 +1820,7 @@
 # define RTStrAPrintfVTag                               RT_MANGLER(RTStrAPrintfVTag)
 # define RTStrATruncateTag                              RT_MANGLER(RTStrATruncateTag)
 # define RTStrCacheCreate                               RT_MANGLER(RTStrCacheCreate)
+# define RTStrCacheCreateEx                             RT_MANGLER(RTStrCacheCreateEx)
 # define RTStrCacheDestroy                              RT_MANGLER(RTStrCacheDestroy)
 # define RTStrCacheEnter                                RT_MANGLER(RTStrCacheEnter)
 # define RTStrCacheEnterLower                           RT_MANGLER(RTStrCacheEnterLower)
@@ -2195,6 +2219,8 @@
 # define RTTlsGet                                       RT_MANGLER(RTTlsGet)
 # define RTTlsGetEx                                     RT_MANGLER(RTTlsGetEx)
 # define RTTlsSet                                       RT_MANGLER(RTTlsSet)
+# define RTTraceBufAddBinMsgF                           RT_MANGLER(RTTraceBufAddBinMsgF)
+# define RTTraceBufAddBinMsgV                           RT_MANGLER(RTTraceBufAddBinMsgV)
 # define RTTraceBufAddMsg                               RT_MANGLER(RTTraceBufAddMsg)
 # define RTTraceBufAddMsgEx                             RT_MANGLER(RTTraceBufAddMsgEx)
 # define RTTraceBufAddMsgF                              RT_MANGLER(RTTraceBufAddMsgF)
@@ -2206,6 +2232,7 @@
 # define RTTraceBufAddPosMsgV                           RT_MANGLER(RTTraceBufAddPosMsgV)
 # define RTTraceBufCarve                                RT_MANGLER(RTTraceBufCarve)
 # define RTTraceBufCreate                               RT_MANGLER(RTTraceBufCreate)
+# define RTTraceBufDecodeFile                           RT_MANGLER(RTTraceBufDecodeFile)
 # define RTTraceBufDisable                              RT_MANGLER(RTTraceBufDisable)
 # define RTTraceBufDumpToAssert                         RT_MANGLER(RTTraceBufDumpToAssert)
 # define RTTraceBufDumpToLog                            RT_MANGLER(RTTraceBufDumpToLog)
@@ -2215,6 +2242,7 @@
 # define RTTraceBufGetEntrySize                         RT_MANGLER(RTTraceBufGetEntrySize)
 # define RTTraceBufRelease                              RT_MANGLER(RTTraceBufRelease)
 # define RTTraceBufRetain                               RT_MANGLER(RTTraceBufRetain)
+# define RTTraceBufSaveToFile                           RT_MANGLER(RTTraceBufSaveToFile)
 # define RTTraceGetDefaultBuf                           RT_MANGLER(RTTraceGetDefaultBuf)
 # define RTTraceSetDefaultBuf                           RT_MANGLER(RTTraceSetDefaultBuf)
 # define RTUdpCreateClientSocket                        RT_MANGLER(RTUdpCreateClientSocket)
@@ -0,0 +1,186 @@
+/** @file
+ * IPRT - Memory Arena (Bump Allocator).
+ */
+
+/*
+ * Copyright (C) 2016 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ *
+ * The contents of this file may alternatively be used under the terms
+ * of the Common Development and Distribution License Version 1.0
+ * (CDDL) only, as it comes in the "COPYING.CDDL" file of the
+ * VirtualBox OSE distribution, in which case the provisions of the
+ * CDDL are applicable instead of those of the GPL.
+ *
+ * You may elect to license modified versions of this file under the
+ * terms and conditions of either the GPL or the CDDL or both.
+ */
+
+#ifndef ___iprt_memarena_h
+#define ___iprt_memarena_h
+
+
+#include <iprt/cdefs.h>
+#include <iprt/types.h>
+
+RT_C_DECLS_BEGIN
+
+
+/** @defgroup grp_rt_memarena   RTMemArena - Memory Arena (Bump Allocator)
+ * @ingroup grp_rt
+ *
+ * Allocates memory by bumping a pointer in a chunk, for short lived data with
+ * a common lifetime, e.g. everything belonging to one request.  There is no
+ * way of freeing individual allocations; instead the user takes a mark
+ * (RTMemArenaMark) and later releases everything allocated since then in one
+ * go (RTMemArenaResetToMark), or releases everything (RTMemArenaReset).
+ *
+ * The chunks are kept for reuse after a reset, so an arena that has reached
+ * its working set size no longer calls the heap.  Requests larger than a
+ * quarter of the chunk size get their own heap block, which is freed by the
+ * reset.
+ *
+ * The arena does no serialization, the user must provide that if it's used by
+ * more than one thread.
+ *
+ * @{
+ */
+
+/** A memory arena handle. */
+typedef R3R0PTRTYPE(struct RTMEMARENAINT *)     RTMEMARENA;
+/** Pointer to a memory arena handle. */
+typedef RTMEMARENA                             *PRTMEMARENA;
+/** Nil memory arena handle. */
+#define NIL_RTMEMARENA                          ((RTMEMARENA)0)
+
+
+/**
+ * Memory arena mark, see RTMemArenaMark.
+ *
+ * The members are private to the implementation.
+ */
+typedef struct RTMEMARENAMARK
+{
+    /** The current chunk. */
+    void               *pvChunk;
+    /** The free offset into the current chunk. */
+    size_t              offChunk;
+    /** The head of the large block list. */
+    void               *pvLarge;
+    /** The number of bytes in use. */
+    size_t              cbUsed;
+} RTMEMARENAMARK;
+/** Pointer to a memory arena mark. */
+typedef RTMEMARENAMARK *PRTMEMARENAMARK;
+/** Pointer to a const memory arena mark. */
+typedef RTMEMARENAMARK const *PCRTMEMARENAMARK;
+
+
+/**
+ * Memory arena statistics, see RTMemArenaQueryStats.
+ */
+typedef struct RTMEMARENASTATS
+{
+    /** The number of allocations made. */
+    uint64_t            cAllocs;
+    /** The number of heap allocations made for chunks and large blocks. */
+    uint64_t            cHeapAllocs;
+    /** The number of resets, including resets to a mark. */
+    uint64_t            cResets;
+    /** The number of bytes currently allocated, including alignment padding. */
+    size_t              cbUsed;
+    /** The number of bytes held in chunks and large blocks. */
+    size_t              cbReserved;
+} RTMEMARENASTATS;
+/** Pointer to memory arena statistics. */
+typedef RTMEMARENASTATS *PRTMEMARENASTATS;
+
+
+/**
+ * Creates a memory arena.
+ *
+ * @returns IPRT status code.
+ * @param   phArena             Where to return the arena handle.
+ * @param   cbChunk             The chunk size, 0 for the default (16 KB).
+ * @param   fFlags              Flags reserved for future use.  Must be zero.
+ */
+RTDECL(int)     RTMemArenaCreate(PRTMEMARENA phArena, size_t cbChunk, uint32_t fFlags);
+
+/**
+ * Destroys a memory arena, freeing all its memory.
+ *
+ * @returns IPRT status code.
+ * @param   hArena              The arena handle.  NIL is quietly ignored
+ *                              (VINF_SUCCESS).
+ */
+RTDECL(int)     RTMemArenaDestroy(RTMEMARENA hArena);
+
+/**
+ * Allocates memory from the arena.
+ *
+ * The memory is aligned like RTMemAlloc memory (RTMEM_ALIGNMENT).
+ *
+ * @returns Pointer to the memory, NULL on failure.
+ * @param   hArena              The arena handle.
+ * @param   cb                  The number of bytes to allocate.
+ */
+RTDECL(void *)  RTMemArenaAlloc(RTMEMARENA hArena, size_t cb);
+
+/**
+ * Allocates zeroed memory from the arena.
+ *
+ * @returns Pointer to the memory, NULL on failure.
+ * @param   hArena              The arena handle.
+ * @param   cb                  The number of bytes to allocate.
+ */
+RTDECL(void *)  RTMemArenaAllocZ(RTMEMARENA hArena, size_t cb);
+
+/**
+ * Records the current allocation state of the arena.
+ *
+ * @param   hArena              The arena handle.
+ * @param   pMark               Where to store the mark.
+ */
+RTDECL(void)    RTMemArenaMark(RTMEMARENA hArena, PRTMEMARENAMARK pMark);
+
+/**
+ * Releases everything allocated since the given mark was taken.
+ *
+ * Marks taken after @a pMark become invalid.
+ *
+ * @param   hArena              The arena handle.
+ * @param   pMark               The mark returned by RTMemArenaMark.
+ */
+RTDECL(void)    RTMemArenaResetToMark(RTMEMARENA hArena, PCRTMEMARENAMARK pMark);
+
+/**
+ * Releases all allocations, keeping the chunks for reuse.
+ *
+ * All marks become invalid.
+ *
+ * @param   hArena              The arena handle.
+ */
+RTDECL(void)    RTMemArenaReset(RTMEMARENA hArena);
+
+/**
+ * Queries the arena statistics.
+ *
+ * @returns IPRT status code.
+ * @param   hArena              The arena handle.
+ * @param   pStats              Where to return the statistics.
+ */
+RTDECL(int)     RTMemArenaQueryStats(RTMEMARENA hArena, PRTMEMARENASTATS pStats);
+
+/** @} */
+
+RT_C_DECLS_END
+
+#endif
+
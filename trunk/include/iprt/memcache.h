@@ -47,6 +47,16 @@ RT_C_DECLS_BEGIN
  * objects are not touched by the cache after that, so that RTMemCacheAlloc will
  * return the object in the same state as when it as handed to RTMemCacheFree.
  *
+ * Caches that see a lot of traffic from several threads can be created with
+ * RTMEMCACHE_F_MAGAZINES.  Each thread then gets a pair of magazines, small
+ * object stacks, that it allocates from and frees into without touching any
+ * shared state.  Empty and full magazines are exchanged with a depot, objects
+ * only go back to the pages in batches when the depot is full.  The objects
+ * held by a thread's magazines are not available to other threads, unless the
+ * cache has a size limit and runs out of objects.  The idle threads' magazines
+ * are then drained, at the cost of a locked instruction per allocation and
+ * free in such caches.
+ *
  * @todo A callback for the reuse (at alloc time) might be of interest.
  *
  * @{
@@ -59,6 +69,54 @@ typedef RTMEMCACHE                             *PRTMEMCACHE;
 /** Nil memory cache handle. */
 #define NIL_RTMEMCACHE                          ((RTMEMCACHE)0)
 
+/** @name RTMEMCACHE_F_XXX - RTMemCacheCreate flags.
+ * @{ */
+/** Use per-thread magazines on top of the shared cache (ring-3 only).  On
+ * hosts where thread-local storage has no destructor callbacks, the magazines
+ * of terminated threads are only reclaimed when the cache is destroyed. */
+#define RTMEMCACHE_F_MAGAZINES                  RT_BIT_32(0)
+/** Mask of valid flags. */
+#define RTMEMCACHE_F_VALID_MASK                 UINT32_C(0x00000001)
+/** @} */
+
+
+/**
+ * Memory cache statistics, see RTMemCacheQueryStats.
+ *
+ * The magazine counters are only updated by RTMEMCACHE_F_MAGAZINES caches and
+ * are not exact while other threads are using the cache.
+ */
+typedef struct RTMEMCACHESTATS
+{
+    /** Allocations served by the calling thread's magazines. */
+    uint64_t            cAllocMagHits;
+    /** Allocations served by exchanging an empty magazine for a full one in the
+     * depot. */
+    uint64_t            cAllocDepotHits;
+    /** Allocations that had to go to the pages (refilling the magazine). */
+    uint64_t            cAllocMisses;
+    /** Frees absorbed by the calling thread's magazines. */
+    uint64_t            cFreeMagHits;
+    /** Frees that handed a full magazine to the depot. */
+    uint64_t            cFreeDepotHits;
+    /** Frees that had to return objects to the pages. */
+    uint64_t            cFreeMisses;
+    /** The total number of objects in the cache pages. */
+    uint32_t            cTotal;
+    /** The number of objects free at the page level. */
+    uint32_t            cFree;
+    /** The number of full magazines in the depot. */
+    uint32_t            cDepotFull;
+    /** The number of empty magazines in the depot. */
+    uint32_t            cDepotEmpty;
+    /** The number of threads currently owning magazines. */
+    uint32_t            cThreads;
+    /** Reserved. */
+    uint32_t            u32Reserved;
+} RTMEMCACHESTATS;
+/** Pointer to memory cache statistics. */
+typedef RTMEMCACHESTATS *PRTMEMCACHESTATS;
+
 
 /**
  * Object constructor.
@@ -106,7 +164,7 @@ typedef FNMEMCACHEDTOR *PFNMEMCACHEDTOR;
  * @param   pfnCtor             Object constructor callback.  Optional.
  * @param   pfnDtor             Object destructor callback.  Optional.
  * @param   pvUser              User argument for the two callbacks.
- * @param   fFlags              Flags reserved for future use.  Must be zero.
+ * @param   fFlags              RTMEMCACHE_F_XXX.
  */
 RTDECL(int)     RTMemCacheCreate(PRTMEMCACHE phMemCache, size_t cbObject, size_t cbAlignment, uint32_t cMaxObjects,
                                  PFNMEMCACHECTOR pfnCtor, PFNMEMCACHEDTOR pfnDtor, void *pvUser, uint32_t fFlags);
@@ -149,6 +207,15 @@ RTDECL(int)     RTMemCacheAllocEx(RTMEMCACHE hMemCache, void **ppvObj);
  */
 RTDECL(void)    RTMemCacheFree(RTMEMCACHE hMemCache, void *pvObj);
 
+/**
+ * Queries the cache statistics.
+ *
+ * @returns IPRT status code.
+ * @param   hMemCache           The cache handle.
+ * @param   pStats              Where to return the statistics.
+ */
+RTDECL(int)     RTMemCacheQueryStats(RTMEMCACHE hMemCache, PRTMEMCACHESTATS pStats);
+
 /** @} */
 
 RT_C_DECLS_END
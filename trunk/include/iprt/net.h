@@ -394,6 +394,7 @@ RTDECL(bool)     RTNetIPv4IsHdrValid(PCRTNETIPV4 pIpHdr, size_t cbHdrMax, size_t
 RTDECL(uint32_t) RTNetIPv4PseudoChecksum(PCRTNETIPV4 pIpHdr);
 RTDECL(uint32_t) RTNetIPv4PseudoChecksumBits(RTNETADDRIPV4 SrcAddr, RTNETADDRIPV4 DstAddr, uint8_t bProtocol, uint16_t cbPkt);
 RTDECL(uint32_t) RTNetIPv4AddDataChecksum(void const *pvData, size_t cbData, uint32_t u32Sum, bool *pfOdd);
+RTDECL(uint32_t) RTNetIPv4AddDataChecksumCopy(void *pvDst, void const *pvData, size_t cbData, uint32_t u32Sum, bool *pfOdd);
 RTDECL(uint16_t) RTNetIPv4FinalizeChecksum(uint32_t u32Sum);
 
 
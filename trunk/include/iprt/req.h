@@ -352,6 +352,14 @@ typedef enum RTREQPOOLCFGVAR
     RTREQPOOLCFGVAR_PUSH_BACK_MAX_MS,
     /** The maximum number of free requests to keep handy for recycling. */
     RTREQPOOLCFGVAR_MAX_FREE_REQUESTS,
+    /** Non-zero to use the work-stealing scheduler: each worker thread has
+     * its own request deque, runs what it submits itself LIFO and steals from
+     * the other workers when it runs dry, while requests from other threads
+     * are handed over without taking the pool lock.  Submitters are only
+     * pushed back when all workers are busy and the creation of a new one is
+     * being throttled.  The number of workers is capped at 256.  Can only be
+     * changed before the first request is submitted. */
+    RTREQPOOLCFGVAR_WORK_STEALING,
     /** The end of the range of valid config variables. */
     RTREQPOOLCFGVAR_END,
     /** Blow the type up to 32-bits. */
@@ -409,6 +417,9 @@ typedef enum RTREQPOOLSTAT
     /** Average time the requests had to wait in the queue before being
      * scheduled. */
     RTREQPOOLSTAT_NS_AVERAGE_REQ_QUEUED,
+    /** The number of requests a worker stole from another worker's deque
+     * (work-stealing mode only). */
+    RTREQPOOLSTAT_REQUESTS_STOLEN,
     /** The end of the valid statistics value names. */
     RTREQPOOLSTAT_END,
     /** Blow the type up to 32-bit. */
@@ -27,6 +27,7 @@
 #define ___iprt_sort_h
 
 #include <iprt/types.h>
+#include <iprt/req.h>
 
 /** @defgroup grp_rt_sort       RTSort - Sorting Algorithms
  * @ingroup grp_rt
@@ -96,6 +97,82 @@ RTDECL(void) RTSortShell(void *pvArray, size_t cElements, size_t cbElement, PFNR
  */
 RTDECL(void) RTSortApvShell(void **papvArray, size_t cElements, PFNRTSORTCMP pfnCmp, void *pvUser);
 
+/**
+ * Introsort an array of variable sized elementes.
+ *
+ * This is a pattern defeating quicksort falling back on heap sort, so it is
+ * O(n log n) in the worst case, and O(n) for presorted input and for arrays
+ * with few distinct values.  The sort is not stable.
+ *
+ * @param   pvArray         The array to sort.
+ * @param   cElements       The number of elements in the array.
+ * @param   cbElement       The size of an array element.
+ * @param   pfnCmp          Callback function comparing two elements.
+ * @param   pvUser          User argument for the callback.
+ */
+RTDECL(void) RTSortIntro(void *pvArray, size_t cElements, size_t cbElement, PFNRTSORTCMP pfnCmp, void *pvUser);
+
+/**
+ * Same as RTSortIntro but speciallized for an array containing element
+ * pointers.
+ *
+ * @param   papvArray       The array to sort.
+ * @param   cElements       The number of elements in the array.
+ * @param   pfnCmp          Callback function comparing two elements.
+ * @param   pvUser          User argument for the callback.
+ */
+RTDECL(void) RTSortApvIntro(void **papvArray, size_t cElements, PFNRTSORTCMP pfnCmp, void *pvUser);
+
+/**
+ * Stable merge sort of an array of variable sized elementes.
+ *
+ * Elements comparing equal keep their relative order.
+ *
+ * @returns IPRT status code.
+ * @retval  VERR_NO_TMP_MEMORY if the merge buffer (half the array size)
+ *          couldn't be allocated.  The array is unchanged.
+ * @param   pvArray         The array to sort.
+ * @param   cElements       The number of elements in the array.
+ * @param   cbElement       The size of an array element.
+ * @param   pfnCmp          Callback function comparing two elements.
+ * @param   pvUser          User argument for the callback.
+ */
+RTDECL(int) RTSortMerge(void *pvArray, size_t cElements, size_t cbElement, PFNRTSORTCMP pfnCmp, void *pvUser);
+
+/**
+ * Same as RTSortMerge but speciallized for an array containing element
+ * pointers.
+ *
+ * @returns IPRT status code.
+ * @param   papvArray       The array to sort.
+ * @param   cElements       The number of elements in the array.
+ * @param   pfnCmp          Callback function comparing two elements.
+ * @param   pvUser          User argument for the callback.
+ */
+RTDECL(int) RTSortApvMerge(void **papvArray, size_t cElements, PFNRTSORTCMP pfnCmp, void *pvUser);
+
+/**
+ * Stable merge sort of an array of variable sized elementes using the worker
+ * threads of a request pool.
+ *
+ * The array is split into up to one chunk per online CPU, which are sorted
+ * concurrently and then merged pairwise.  Small arrays and NIL_RTREQPOOL
+ * make this the same as RTSortMerge.
+ *
+ * @returns IPRT status code.
+ * @retval  VERR_NO_TMP_MEMORY if the merge buffer (the size of the array)
+ *          couldn't be allocated.  The array is unchanged.
+ * @param   hPool           The request pool to use.
+ * @param   pvArray         The array to sort.
+ * @param   cElements       The number of elements in the array.
+ * @param   cbElement       The size of an array element.
+ * @param   pfnCmp          Callback function comparing two elements.  This is
+ *                          called concurrently on several threads.
+ * @param   pvUser          User argument for the callback.
+ */
+RTDECL(int) RTSortParallel(RTREQPOOL hPool, void *pvArray, size_t cElements, size_t cbElement,
+                           PFNRTSORTCMP pfnCmp, void *pvUser);
+
 /**
  * Checks if an array of variable sized elementes is sorted.
  *
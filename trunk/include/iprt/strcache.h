@@ -42,6 +42,26 @@ RT_C_DECLS_BEGIN
  */
 RTDECL(int) RTStrCacheCreate(PRTSTRCACHE phStrCache, const char *pszName);
 
+/** @name RTSTRCACHE_F_XXX - String cache creation flags.
+ * @{ */
+/** Optimize for concurrent use by splitting the cache into several
+ * independently locked shards.  Costs some extra memory. */
+#define RTSTRCACHE_F_CONCURRENT     RT_BIT_32(0)
+/** Mask of valid flags. */
+#define RTSTRCACHE_F_VALID_MASK     UINT32_C(0x00000001)
+/** @} */
+
+/**
+ * Create a new string cache, extended version.
+ *
+ * @returns IPRT status code
+ *
+ * @param   phStrCache          Where to return the string cache handle.
+ * @param   pszName             The name of the cache (for debug purposes).
+ * @param   fFlags              RTSTRCACHE_F_XXX.
+ */
+RTDECL(int) RTStrCacheCreateEx(PRTSTRCACHE phStrCache, const char *pszName, uint32_t fFlags);
+
 
 /**
  * Destroys a string cache.
@@ -179,6 +179,25 @@ RTDECL(int)         RTTraceBufAddMsgF(     RTTRACEBUF hTraceBuf, const char *psz
 RTDECL(int)         RTTraceBufAddMsgV(     RTTRACEBUF hTraceBuf, const char *pszMsgFmt, va_list va) RT_IPRT_FORMAT_ATTR(2, 0);
 RTDECL(int)         RTTraceBufAddMsgEx(    RTTRACEBUF hTraceBuf, const char *pszMsg, size_t cbMaxMsg);
 
+/**
+ * Adds a message to the trace buffer without formatting it.
+ *
+ * The entry records the format string address and the raw arguments, the
+ * formatting is done when the entries are enumerated, dumped or decoded from a
+ * file (RTTraceBufSaveToFile, RTTraceBufDecodeFile).  This is only done in
+ * ring-3 and only for integer, pointer and string (copied) arguments, in other
+ * cases the message is formatted right away like RTTraceBufAddMsgV does.
+ *
+ * @returns IPRT status code.
+ * @param   hTraceBuf           The trace buffer handle.  Special handles are
+ *                              accepted.
+ * @param   pszMsgFmt           The format string.  Must stay valid for as long
+ *                              as the trace buffer (i.e. string literals).
+ * @param   va                  The format arguments.
+ */
+RTDECL(int)         RTTraceBufAddBinMsgV(  RTTRACEBUF hTraceBuf, const char *pszMsgFmt, va_list va) RT_IPRT_FORMAT_ATTR(2, 0);
+RTDECL(int)         RTTraceBufAddBinMsgF(  RTTRACEBUF hTraceBuf, const char *pszMsgFmt, ...) RT_IPRT_FORMAT_ATTR(2, 3);
+
 RTDECL(int)         RTTraceBufAddPos(      RTTRACEBUF hTraceBuf, RT_SRC_POS_DECL);
 RTDECL(int)         RTTraceBufAddPosMsg(   RTTRACEBUF hTraceBuf, RT_SRC_POS_DECL, const char *pszMsg);
 RTDECL(int)         RTTraceBufAddPosMsgEx( RTTRACEBUF hTraceBuf, RT_SRC_POS_DECL, const char *pszMsg, size_t cbMaxMsg);
@@ -186,6 +205,36 @@ RTDECL(int)         RTTraceBufAddPosMsgF(  RTTRACEBUF hTraceBuf, RT_SRC_POS_DECL
 RTDECL(int)         RTTraceBufAddPosMsgV(  RTTRACEBUF hTraceBuf, RT_SRC_POS_DECL, const char *pszMsgFmt, va_list va) RT_IPRT_FORMAT_ATTR(5, 0);
 
 
+#ifdef IN_RING3
+/**
+ * Saves the trace buffer entries to a file for offline decoding.
+ *
+ * The format strings of binary entries (RTTraceBufAddBinMsgV) are saved along
+ * with them.
+ *
+ * @returns IPRT status code.
+ * @param   hTraceBuf           The trace buffer handle.  Special handles are
+ *                              accepted.
+ * @param   pszFilename         The file to create (replaced if it exists).
+ */
+RTR3DECL(int)       RTTraceBufSaveToFile(RTTRACEBUF hTraceBuf, const char *pszFilename);
+
+/**
+ * Decodes a file created by RTTraceBufSaveToFile, calling @a pfnCallback for
+ * each entry.
+ *
+ * @returns IPRT status code.  Should the callback (@a pfnCallback) return
+ *          anything other than VINF_SUCCESS, then the enumeration will be
+ *          aborted and the status code will be returned by this function.
+ * @param   pszFilename         The trace buffer file.
+ * @param   pfnCallback         The callback to call for each entry.  The trace
+ *                              buffer handle passed to it is NIL_RTTRACEBUF.
+ * @param   pvUser              The user argument for the callback.
+ */
+RTR3DECL(int)       RTTraceBufDecodeFile(const char *pszFilename, PFNRTTRACEBUFCALLBACK pfnCallback, void *pvUser);
+#endif
+
+
 RTDECL(int)         RTTraceSetDefaultBuf(RTTRACEBUF hTraceBuf);
 RTDECL(RTTRACEBUF)  RTTraceGetDefaultBuf(void);
 
@@ -152,8 +152,11 @@
  * E1K_RXD_CACHE_SIZE specifies the maximum number of RX descriptors stored
  * in the state structure. It limits the amount of descriptors loaded in one
  * batch read. For example, XP guest adds 15 RX descriptors at a time.
+ * Once half of the cache has been consumed it gets topped up from the ring
+ * (see e1kRxDGet), so the number of guest memory reads per received packet
+ * goes down as the cache grows.
  */
-# define E1K_RXD_CACHE_SIZE 16u
+# define E1K_RXD_CACHE_SIZE 32u
 #endif /* E1K_WITH_RXD_CACHE */
 
 
@@ -1091,6 +1094,10 @@ struct E1kState_st
     PDMPCIDEV   pciDevice;
     /** EMT: Last time the interrupt was acknowledged.  */
     uint64_t    u64AckedAt;
+    /** All: Last time the interrupt was raised (for ITR throttling). */
+    uint64_t    u64LastIntAt;
+    /** All: Start of the current interrupt rate measurement window. */
+    uint64_t    u64IntRateStart;
     /** All: Used for eliminating spurious interrupts. */
     bool        fIntRaised;
     /** EMT: false if the cable is disconnected by the GUI. */
@@ -1107,8 +1114,12 @@ struct E1kState_st
     bool        fItrRxEnabled;
     /** All: Delay TX interrupts using TIDV/TADV. */
     bool        fTidEnabled;
+    /** All: Delay RX interrupts using RDTR/RADV. */
+    bool        fRidEnabled;
     /** Link up delay (in milliseconds). */
     uint32_t    cMsLinkUpDelay;
+    /** All: Number of interrupts raised in the current rate window. */
+    uint32_t    cIntsInWindow;
 
     /** All: Device register storage. */
     uint32_t    auRegs[E1K_NUM_OF_32BIT_REGS];
@@ -1214,6 +1225,18 @@ struct E1kState_st
 
     STAMCOUNTER                         StatReceiveBytes;
     STAMCOUNTER                         StatTransmitBytes;
+    /** Interrupts per second, sampled over roughly one second windows. */
+    STAMPROFILE                         StatIntsPerSec;
+    /** Interrupts postponed because of ITR throttling. */
+    STAMCOUNTER                         StatIntsItrDelayed;
+    /** RX interrupts deferred to the RDTR/RADV timers. */
+    STAMCOUNTER                         StatIntsRxDelayed;
+    /** Number of guest memory reads done to fetch RX descriptors. */
+    STAMCOUNTER                         StatRxDescFetches;
+    /** Number of RX descriptors fetched per batch. */
+    STAMPROFILE                         StatRxDescPerFetch;
+    /** Number of frames stored in guest memory. */
+    STAMCOUNTER                         StatRxFrames;
 #if defined(VBOX_WITH_STATISTICS)
     STAMPROFILEADV                      StatMMIOReadRZ;
     STAMPROFILEADV                      StatMMIOReadR3;
@@ -1687,6 +1710,10 @@ static void e1kHardReset(PE1KSTATE pThis)
  */
 static uint16_t e1kCSum16(const void *pvBuf, size_t cb)
 {
+#ifndef IN_RC
+    bool fOdd = false;
+    return RTNetIPv4FinalizeChecksum(RTNetIPv4AddDataChecksum(pvBuf, cb, 0, &fOdd));
+#else  /* The RC runtime doesn't include the IPRT checksum code. */
     uint32_t  csum = 0;
     uint16_t *pu16 = (uint16_t *)pvBuf;
 
@@ -1700,6 +1727,7 @@ static uint16_t e1kCSum16(const void *pvBuf, size_t cb)
     while (csum >> 16)
         csum = (csum >> 16) + (csum & 0xFFFF);
     return ~csum;
+#endif
 }
 
 /**
@@ -1926,17 +1954,38 @@ static int e1kRaiseInterrupt(PE1KSTATE pThis, int rcBusy, uint32_t u32IntCause =
         }
         else
         {
-            uint64_t tsNow = TMTimerGet(pThis->CTX_SUFF(pIntTimer));
-            if (!!ITR && tsNow - pThis->u64AckedAt < ITR * 256
-                     && pThis->fItrEnabled && (pThis->fItrRxEnabled || !(ICR & ICR_RXT0)))
+            /*
+             * ITR specifies the minimum interval between two interrupts in
+             * 256 ns units, so measure it from the last assertion and only
+             * wait for what is left of it.
+             */
+            uint64_t const tsNow   = TMTimerGet(pThis->CTX_SUFF(pIntTimer));
+            uint64_t const cNsItr  = (uint64_t)ITR * 256;
+            uint64_t const cNsSince = tsNow - pThis->u64LastIntAt;
+            if (   cNsItr
+                && cNsSince < cNsItr
+                && pThis->fItrEnabled && (pThis->fItrRxEnabled || !(ICR & ICR_RXT0)))
             {
                 E1K_INC_ISTAT_CNT(pThis->uStatIntEarly);
-                E1kLog2(("%s e1kRaiseInterrupt: Too early to raise again: %d ns < %d ns.\n",
-                        pThis->szPrf, (uint32_t)(tsNow - pThis->u64AckedAt), ITR * 256));
-                e1kPostponeInterrupt(pThis, ITR * 256);
+                STAM_REL_COUNTER_INC(&pThis->StatIntsItrDelayed);
+                E1kLog2(("%s e1kRaiseInterrupt: Too early to raise again: %RU64 ns < %RU64 ns.\n",
+                        pThis->szPrf, cNsSince, cNsItr));
+                e1kPostponeInterrupt(pThis, cNsItr - cNsSince);
             }
             else
             {
+                pThis->u64LastIntAt = tsNow;
+                /* Update the interrupt rate once a second or so. */
+                if (tsNow - pThis->u64IntRateStart >= RT_NS_1SEC)
+                {
+                    if (pThis->u64IntRateStart)
+                        STAM_REL_PROFILE_ADD_PERIOD(&pThis->StatIntsPerSec,
+                                                    (uint64_t)pThis->cIntsInWindow * RT_NS_1SEC
+                                                    / (tsNow - pThis->u64IntRateStart));
+                    pThis->u64IntRateStart = tsNow;
+                    pThis->cIntsInWindow   = 0;
+                }
+                pThis->cIntsInWindow++;
 
                 /* Since we are delivering the interrupt now
                  * there is no need to do it later -- stop the timer.
@@ -2084,6 +2133,7 @@ DECLINLINE(unsigned) e1kRxDPrefetch(PE1KSTATE pThis)
     PDMDevHlpPhysRead(pThis->CTX_SUFF(pDevIns),
                       ((uint64_t)RDBAH << 32) + RDBAL + nFirstNotLoaded * sizeof(E1KRXDESC),
                       pFirstEmptyDesc, nDescsInSingleRead * sizeof(E1KRXDESC));
+    STAM_REL_COUNTER_INC(&pThis->StatRxDescFetches);
     // uint64_t addrBase = ((uint64_t)RDBAH << 32) + RDBAL;
     // unsigned i, j;
     // for (i = pThis->nRxDFetched; i < pThis->nRxDFetched + nDescsInSingleRead; ++i)
@@ -2101,6 +2151,7 @@ DECLINLINE(unsigned) e1kRxDPrefetch(PE1KSTATE pThis)
                           ((uint64_t)RDBAH << 32) + RDBAL,
                           pFirstEmptyDesc + nDescsInSingleRead,
                           (nDescsToFetch - nDescsInSingleRead) * sizeof(E1KRXDESC));
+        STAM_REL_COUNTER_INC(&pThis->StatRxDescFetches);
         // Assert(i == pThis->nRxDFetched  + nDescsInSingleRead);
         // for (j = 0; i < pThis->nRxDFetched + nDescsToFetch; ++i, ++j)
         // {
@@ -2112,6 +2163,7 @@ DECLINLINE(unsigned) e1kRxDPrefetch(PE1KSTATE pThis)
                  RDBAH, RDBAL));
     }
     pThis->nRxDFetched += nDescsToFetch;
+    STAM_REL_PROFILE_ADD_PERIOD(&pThis->StatRxDescPerFetch, nDescsToFetch);
     return nDescsToFetch;
 }
 
@@ -2121,6 +2173,11 @@ DECLINLINE(unsigned) e1kRxDPrefetch(PE1KSTATE pThis)
  * Obtain the next RX descriptor from RXD cache, fetching descriptors from the
  * RX ring if the cache is empty.
  *
+ * When at least half of the cache has been consumed and the guest has made
+ * more descriptors available, the unused ones are moved to the front and the
+ * freed slots are refilled in one go, so we don't have to wait for the cache
+ * to run dry (and fetch a single descriptor per packet) under a steady load.
+ *
  * Note that we cannot advance the cache pointer (iRxDCurrent) yet as it will
  * go out of sync with RDH which will cause trouble when EMT checks if the
  * cache is empty to do pre-fetch @bugref(6217).
@@ -2133,7 +2190,25 @@ DECLINLINE(E1KRXDESC*) e1kRxDGet(PE1KSTATE pThis)
     Assert(e1kCsRxIsOwner(pThis));
     /* Check the cache first. */
     if (pThis->iRxDCurrent < pThis->nRxDFetched)
+    {
+        /*
+         * Top it up if it is getting low. No descriptor obtained from the
+         * cache is outstanding at this point and EMT only ever appends to
+         * the cache, so moving the entries around is safe.
+         */
+        if (   pThis->iRxDCurrent >= E1K_RXD_CACHE_SIZE / 2
+            && e1kGetRxLen(pThis) > e1kRxDInCache(pThis)
+            && (RCTL & RCTL_EN))
+        {
+            unsigned const cLeft = pThis->nRxDFetched - pThis->iRxDCurrent;
+            memmove(&pThis->aRxDescriptors[0], &pThis->aRxDescriptors[pThis->iRxDCurrent],
+                    cLeft * sizeof(E1KRXDESC));
+            pThis->iRxDCurrent = 0;
+            pThis->nRxDFetched = cLeft;
+            e1kRxDPrefetch(pThis);
+        }
         return &pThis->aRxDescriptors[pThis->iRxDCurrent];
+    }
     /* Cache is empty, reset it and check if we can fetch more. */
     pThis->iRxDCurrent = pThis->nRxDFetched = 0;
     if (e1kRxDPrefetch(pThis))
@@ -2216,10 +2291,11 @@ static DECLCALLBACK(void) e1kStoreRxFragment(PE1KSTATE pThis, E1KRXDESC *pDesc,
     if (pDesc->status.fEOP)
     {
         /* Complete packet has been stored -- it is time to let the guest know. */
-#ifdef E1K_USE_RX_TIMERS
-        if (RDTR)
+        STAM_REL_COUNTER_INC(&pThis->StatRxFrames);
+        if (pThis->fRidEnabled && RDTR)
         {
-            /* Arm the timer to fire in RDTR usec (discard .024) */
+            /* (Re-)arm the timer to fire in RDTR usec (discard .024) */
+            STAM_REL_COUNTER_INC(&pThis->StatIntsRxDelayed);
             e1kArmTimer(pThis, pThis->CTX_SUFF(pRIDTimer), RDTR);
             /* If absolute timer delay is enabled and the timer is not running yet, arm it. */
             if (RADV != 0 && !TMTimerIsActive(pThis->CTX_SUFF(pRADTimer)))
@@ -2227,13 +2303,10 @@ static DECLCALLBACK(void) e1kStoreRxFragment(PE1KSTATE pThis, E1KRXDESC *pDesc,
         }
         else
         {
-#endif
             /* 0 delay means immediate interrupt */
             E1K_INC_ISTAT_CNT(pThis->uStatIntRx);
             e1kRaiseInterrupt(pThis, VERR_SEM_BUSY, ICR_RXT0);
-#ifdef E1K_USE_RX_TIMERS
         }
-#endif
     }
     STAM_PROFILE_ADV_STOP(&pThis->StatReceiveStore, a);
 }
@@ -2344,6 +2417,10 @@ static int e1kHandleRxPacket(PE1KSTATE pThis, const void *pvBuf, size_t cb, E1KR
 
     Assert(cb <= E1K_MAX_RX_PKT_SIZE);
     Assert(cb > 16);
+    size_t const offCSum   = GET_BITS(RXCSUM, PCSS);
+    uint32_t     u32CSum   = 0;
+    bool         fCSumOdd  = false;
+    bool         fCSumDone = false;
     size_t cbMax = ((RCTL & RCTL_LPE) ? E1K_MAX_RX_PKT_SIZE - 4 : 1518) - (status.fVP ? 0 : 4);
     E1kLog3(("%s Max RX packet size is %u\n", pThis->szPrf, cbMax));
     if (status.fVP)
@@ -2362,6 +2439,14 @@ static int e1kHandleRxPacket(PE1KSTATE pThis, const void *pvBuf, size_t cb, E1KR
         else
             status.fVP = false; /* Set VP only if we stripped the tag */
     }
+    else if (offCSum < cb)
+    {
+        /* Copy the frame, summing up the part covered by the packet checksum on the way. */
+        memcpy(rxPacket, pvBuf, offCSum);
+        u32CSum = RTNetIPv4AddDataChecksumCopy(rxPacket + offCSum, (uint8_t const *)pvBuf + offCSum, cb - offCSum,
+                                               0, &fCSumOdd);
+        fCSumDone = true;
+    }
     else
         memcpy(rxPacket, pvBuf, cb);
     /* Pad short packets */
@@ -2369,6 +2454,7 @@ static int e1kHandleRxPacket(PE1KSTATE pThis, const void *pvBuf, size_t cb, E1KR
     {
         memset(rxPacket + cb, 0, 60 - cb);
         cb = 60;
+        fCSumOdd = ((cb - offCSum) & 1) != 0; /* zeros don't change the sum, only the parity. */
     }
     if (!(RCTL & RCTL_SECRC) && cb <= cbMax)
     {
@@ -2380,12 +2466,15 @@ static int e1kHandleRxPacket(PE1KSTATE pThis, const void *pvBuf, size_t cb, E1KR
          */
         if (pThis->fEthernetCRC)
             *(uint32_t*)(rxPacket + cb) = RTCrc32(rxPacket, cb);
+        if (fCSumDone)
+            u32CSum = RTNetIPv4AddDataChecksum(rxPacket + cb, sizeof(uint32_t), u32CSum, &fCSumOdd);
         cb += sizeof(uint32_t);
         STAM_PROFILE_ADV_STOP(&pThis->StatReceiveCRC, a);
         E1kLog3(("%s Added FCS (cb=%u)\n", pThis->szPrf, cb));
     }
     /* Compute checksum of complete packet */
-    uint16_t checksum = e1kCSum16(rxPacket + GET_BITS(RXCSUM, PCSS), cb);
+    uint16_t checksum = fCSumDone ? RTNetIPv4FinalizeChecksum(u32CSum)
+                      : e1kCSum16(rxPacket + offCSum, offCSum < cb ? cb - offCSum : 0);
     e1kRxChecksumOffload(pThis, rxPacket, cb, &status);
 
     /* Update stats */
@@ -2509,10 +2598,15 @@ static int e1kHandleRxPacket(PE1KSTATE pThis, const void *pvBuf, size_t cb, E1KR
     e1kCsRxLeave(pThis);
 # ifdef E1K_WITH_RXD_CACHE
     /* Complete packet has been stored -- it is time to let the guest know. */
-#  ifdef E1K_USE_RX_TIMERS
-    if (RDTR)
+    STAM_REL_COUNTER_INC(&pThis->StatRxFrames);
+    if (pThis->fRidEnabled && RDTR)
     {
-        /* Arm the timer to fire in RDTR usec (discard .024) */
+        /*
+         * (Re-)arm the timer to fire in RDTR usec (discard .024), each new
+         * packet pushes it further out while RADV puts an upper bound on
+         * the delay of the first one.
+         */
+        STAM_REL_COUNTER_INC(&pThis->StatIntsRxDelayed);
         e1kArmTimer(pThis, pThis->CTX_SUFF(pRIDTimer), RDTR);
         /* If absolute timer delay is enabled and the timer is not running yet, arm it. */
         if (RADV != 0 && !TMTimerIsActive(pThis->CTX_SUFF(pRADTimer)))
@@ -2520,13 +2614,10 @@ static int e1kHandleRxPacket(PE1KSTATE pThis, const void *pvBuf, size_t cb, E1KR
     }
     else
     {
-#  endif /* E1K_USE_RX_TIMERS */
         /* 0 delay means immediate interrupt */
         E1K_INC_ISTAT_CNT(pThis->uStatIntRx);
         e1kRaiseInterrupt(pThis, VERR_SEM_BUSY, ICR_RXT0);
-#  ifdef E1K_USE_RX_TIMERS
     }
-#  endif /* E1K_USE_RX_TIMERS */
 # endif /* E1K_WITH_RXD_CACHE */
 
     return VINF_SUCCESS;
@@ -3230,10 +3321,11 @@ static int e1kRegWriteRDTR(PE1KSTATE pThis, uint32_t offset, uint32_t index, uin
     if (value & RDTR_FPD)
     {
         /* Flush requested, cancel both timers and raise interrupt */
-#ifdef E1K_USE_RX_TIMERS
-        e1kCancelTimer(pThis, pThis->CTX_SUFF(pRIDTimer));
-        e1kCancelTimer(pThis, pThis->CTX_SUFF(pRADTimer));
-#endif
+        if (pThis->fRidEnabled)
+        {
+            TMTimerStop(pThis->CTX_SUFF(pRIDTimer));
+            TMTimerStop(pThis->CTX_SUFF(pRADTimer));
+        }
         E1K_INC_ISTAT_CNT(pThis->uStatIntRDTR);
         return e1kRaiseInterrupt(pThis, VINF_IOM_R3_MMIO_WRITE, ICR_RXT0);
     }
@@ -3303,7 +3395,7 @@ static DECLCALLBACK(void) e1kTxIntDelayTimer(PPDMDEVINS pDevIns, PTMTIMER pTimer
 #  ifndef E1K_NO_TAD
     e1kCancelTimer(pThis, pThis->CTX_SUFF(pTADTimer));
 #  endif
-    e1kRaiseInterrupt(pThis, ICR_TXDW);
+    e1kRaiseInterrupt(pThis, VERR_SEM_BUSY, ICR_TXDW);
 }
 
 /**
@@ -3325,11 +3417,10 @@ static DECLCALLBACK(void) e1kTxAbsDelayTimer(PPDMDEVINS pDevIns, PTMTIMER pTimer
     E1K_INC_ISTAT_CNT(pThis->uStatTAD);
     /* Cancel interrupt delay timer as we have already got attention */
     e1kCancelTimer(pThis, pThis->CTX_SUFF(pTIDTimer));
-    e1kRaiseInterrupt(pThis, ICR_TXDW);
+    e1kRaiseInterrupt(pThis, VERR_SEM_BUSY, ICR_TXDW);
 }
 
 //# endif /* E1K_USE_TX_TIMERS */
-# ifdef E1K_USE_RX_TIMERS
 
 /**
  * Receive Interrupt Delay Timer handler.
@@ -3343,12 +3434,14 @@ static DECLCALLBACK(void) e1kTxAbsDelayTimer(PPDMDEVINS pDevIns, PTMTIMER pTimer
  */
 static DECLCALLBACK(void) e1kRxIntDelayTimer(PPDMDEVINS pDevIns, PTMTIMER pTimer, void *pvUser)
 {
+    RT_NOREF(pDevIns);
+    RT_NOREF(pTimer);
     PE1KSTATE pThis = (PE1KSTATE )pvUser;
 
     E1K_INC_ISTAT_CNT(pThis->uStatRID);
     /* Cancel absolute delay timer as we have already got attention */
     e1kCancelTimer(pThis, pThis->CTX_SUFF(pRADTimer));
-    e1kRaiseInterrupt(pThis, ICR_RXT0);
+    e1kRaiseInterrupt(pThis, VERR_SEM_BUSY, ICR_RXT0);
 }
 
 /**
@@ -3363,16 +3456,16 @@ static DECLCALLBACK(void) e1kRxIntDelayTimer(PPDMDEVINS pDevIns, PTMTIMER pTimer
  */
 static DECLCALLBACK(void) e1kRxAbsDelayTimer(PPDMDEVINS pDevIns, PTMTIMER pTimer, void *pvUser)
 {
+    RT_NOREF(pDevIns);
+    RT_NOREF(pTimer);
     PE1KSTATE pThis = (PE1KSTATE )pvUser;
 
     E1K_INC_ISTAT_CNT(pThis->uStatRAD);
     /* Cancel interrupt delay timer as we have already got attention */
     e1kCancelTimer(pThis, pThis->CTX_SUFF(pRIDTimer));
-    e1kRaiseInterrupt(pThis, ICR_RXT0);
+    e1kRaiseInterrupt(pThis, VERR_SEM_BUSY, ICR_RXT0);
 }
 
-# endif /* E1K_USE_RX_TIMERS */
-
 /**
  * Late Interrupt Timer handler.
  *
@@ -6699,10 +6792,11 @@ static DECLCALLBACK(int) e1kSavePrep(PPDMDEVINS pDevIns, PSSMHANDLE pSSM)
 #endif /* E1K_NO_TAD */
     }
 //#endif /* E1K_USE_TX_TIMERS */
-#ifdef E1K_USE_RX_TIMERS
-    e1kCancelTimer(pThis, pThis->CTX_SUFF(pRIDTimer));
-    e1kCancelTimer(pThis, pThis->CTX_SUFF(pRADTimer));
-#endif /* E1K_USE_RX_TIMERS */
+    if (pThis->fRidEnabled)
+    {
+        e1kCancelTimer(pThis, pThis->CTX_SUFF(pRIDTimer));
+        e1kCancelTimer(pThis, pThis->CTX_SUFF(pRADTimer));
+    }
     e1kCancelTimer(pThis, pThis->CTX_SUFF(pIntTimer));
     /* 3) Did I forget anything? */
     E1kLog(("%s Locked\n", pThis->szPrf));
@@ -7362,6 +7456,7 @@ static DECLCALLBACK(void) e1kR3Reset(PPDMDEVINS pDevIns)
     pThis->fDelayInts   = false;
     pThis->fLocked      = false;
     pThis->u64AckedAt   = 0;
+    pThis->u64LastIntAt = 0;
     e1kHardReset(pThis);
 }
 
@@ -7397,10 +7492,11 @@ static DECLCALLBACK(void) e1kR3Relocate(PPDMDEVINS pDevIns, RTGCINTPTR offDelta)
     pThis->pDevInsRC     = PDMDEVINS_2_RCPTR(pDevIns);
     pThis->pTxQueueRC    = PDMQueueRCPtr(pThis->pTxQueueR3);
     pThis->pCanRxQueueRC = PDMQueueRCPtr(pThis->pCanRxQueueR3);
-#ifdef E1K_USE_RX_TIMERS
-    pThis->pRIDTimerRC   = TMTimerRCPtr(pThis->pRIDTimerR3);
-    pThis->pRADTimerRC   = TMTimerRCPtr(pThis->pRADTimerR3);
-#endif /* E1K_USE_RX_TIMERS */
+    if (pThis->fRidEnabled)
+    {
+        pThis->pRIDTimerRC   = TMTimerRCPtr(pThis->pRIDTimerR3);
+        pThis->pRADTimerRC   = TMTimerRCPtr(pThis->pRADTimerR3);
+    }
 //#ifdef E1K_USE_TX_TIMERS
     if (pThis->fTidEnabled)
     {
@@ -7550,6 +7646,7 @@ static DECLCALLBACK(int) e1kR3Construct(PPDMDEVINS pDevIns, int iInstance, PCFGM
     pThis->fDelayInts   = false;
     pThis->fLocked      = false;
     pThis->u64AckedAt   = 0;
+    pThis->u64LastIntAt = 0;
     pThis->led.u32Magic = PDMLED_MAGIC;
     pThis->u32PktNo     = 1;
 
@@ -7583,7 +7680,7 @@ static DECLCALLBACK(int) e1kR3Construct(PPDMDEVINS pDevIns, int iInstance, PCFGM
      */
     if (!CFGMR3AreValuesValid(pCfg, "MAC\0" "CableConnected\0" "AdapterType\0"
                                     "LineSpeed\0" "GCEnabled\0" "R0Enabled\0"
-                                    "ItrEnabled\0" "ItrRxEnabled\0"
+                                    "ItrEnabled\0" "ItrRxEnabled\0" "TidEnabled\0" "RidEnabled\0"
                                     "EthernetCRC\0" "GSOEnabled\0" "LinkUpDelay\0"))
         return PDMDEV_SET_ERROR(pDevIns, VERR_PDM_DEVINS_UNKNOWN_CFG_VALUES,
                                 N_("Invalid configuration for E1000 device"));
@@ -7639,6 +7736,11 @@ static DECLCALLBACK(int) e1kR3Construct(PPDMDEVINS pDevIns, int iInstance, PCFGM
         return PDMDEV_SET_ERROR(pDevIns, rc,
                                 N_("Configuration error: Failed to get the value of 'TidEnabled'"));
 
+    rc = CFGMR3QueryBoolDef(pCfg, "RidEnabled", &pThis->fRidEnabled, false);
+    if (RT_FAILURE(rc))
+        return PDMDEV_SET_ERROR(pDevIns, rc,
+                                N_("Configuration error: Failed to get the value of 'RidEnabled'"));
+
     rc = CFGMR3QueryU32Def(pCfg, "LinkUpDelay", (uint32_t*)&pThis->cMsLinkUpDelay, 5000); /* ms */
     if (RT_FAILURE(rc))
         return PDMDEV_SET_ERROR(pDevIns, rc,
@@ -7649,13 +7751,14 @@ static DECLCALLBACK(int) e1kR3Construct(PPDMDEVINS pDevIns, int iInstance, PCFGM
     else if (pThis->cMsLinkUpDelay == 0)
         LogRel(("%s WARNING! Link up delay is disabled!\n", pThis->szPrf));
 
-    LogRel(("%s Chip=%s LinkUpDelay=%ums EthernetCRC=%s GSO=%s Itr=%s ItrRx=%s TID=%s R0=%s GC=%s\n", pThis->szPrf,
+    LogRel(("%s Chip=%s LinkUpDelay=%ums EthernetCRC=%s GSO=%s Itr=%s ItrRx=%s TID=%s RID=%s R0=%s GC=%s\n", pThis->szPrf,
             g_aChips[pThis->eChip].pcszName, pThis->cMsLinkUpDelay,
             pThis->fEthernetCRC ? "on" : "off",
             pThis->fGSOEnabled ? "enabled" : "disabled",
             pThis->fItrEnabled ? "enabled" : "disabled",
             pThis->fItrRxEnabled ? "enabled" : "disabled",
             pThis->fTidEnabled ? "enabled" : "disabled",
+            pThis->fRidEnabled ? "enabled" : "disabled",
             pThis->fR0Enabled ? "enabled" : "disabled",
             pThis->fRCEnabled ? "enabled" : "disabled"));
 
@@ -7778,25 +7881,26 @@ static DECLCALLBACK(int) e1kR3Construct(PPDMDEVINS pDevIns, int iInstance, PCFGM
     }
 //#endif /* E1K_USE_TX_TIMERS */
 
-#ifdef E1K_USE_RX_TIMERS
-    /* Create Receive Interrupt Delay Timer */
-    rc = PDMDevHlpTMTimerCreate(pDevIns, TMCLOCK_VIRTUAL, e1kRxIntDelayTimer, pThis,
-                                TMTIMER_FLAGS_NO_CRIT_SECT,
-                                "E1000 Receive Interrupt Delay Timer", &pThis->pRIDTimerR3);
-    if (RT_FAILURE(rc))
-        return rc;
-    pThis->pRIDTimerR0 = TMTimerR0Ptr(pThis->pRIDTimerR3);
-    pThis->pRIDTimerRC = TMTimerRCPtr(pThis->pRIDTimerR3);
+    if (pThis->fRidEnabled)
+    {
+        /* Create Receive Interrupt Delay Timer */
+        rc = PDMDevHlpTMTimerCreate(pDevIns, TMCLOCK_VIRTUAL, e1kRxIntDelayTimer, pThis,
+                                    TMTIMER_FLAGS_NO_CRIT_SECT,
+                                    "E1000 Receive Interrupt Delay Timer", &pThis->pRIDTimerR3);
+        if (RT_FAILURE(rc))
+            return rc;
+        pThis->pRIDTimerR0 = TMTimerR0Ptr(pThis->pRIDTimerR3);
+        pThis->pRIDTimerRC = TMTimerRCPtr(pThis->pRIDTimerR3);
 
-    /* Create Receive Absolute Delay Timer */
-    rc = PDMDevHlpTMTimerCreate(pDevIns, TMCLOCK_VIRTUAL, e1kRxAbsDelayTimer, pThis,
-                                TMTIMER_FLAGS_NO_CRIT_SECT,
-                                "E1000 Receive Absolute Delay Timer", &pThis->pRADTimerR3);
-    if (RT_FAILURE(rc))
-        return rc;
-    pThis->pRADTimerR0 = TMTimerR0Ptr(pThis->pRADTimerR3);
-    pThis->pRADTimerRC = TMTimerRCPtr(pThis->pRADTimerR3);
-#endif /* E1K_USE_RX_TIMERS */
+        /* Create Receive Absolute Delay Timer */
+        rc = PDMDevHlpTMTimerCreate(pDevIns, TMCLOCK_VIRTUAL, e1kRxAbsDelayTimer, pThis,
+                                    TMTIMER_FLAGS_NO_CRIT_SECT,
+                                    "E1000 Receive Absolute Delay Timer", &pThis->pRADTimerR3);
+        if (RT_FAILURE(rc))
+            return rc;
+        pThis->pRADTimerR0 = TMTimerR0Ptr(pThis->pRADTimerR3);
+        pThis->pRADTimerRC = TMTimerRCPtr(pThis->pRADTimerR3);
+    }
 
     /* Create Late Interrupt Timer */
     rc = PDMDevHlpTMTimerCreate(pDevIns, TMCLOCK_VIRTUAL, e1kLateIntTimer, pThis,
@@ -7865,6 +7969,12 @@ static DECLCALLBACK(int) e1kR3Construct(PPDMDEVINS pDevIns, int iInstance, PCFGM
 
     PDMDevHlpSTAMRegisterF(pDevIns, &pThis->StatReceiveBytes,       STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS, STAMUNIT_BYTES,          "Amount of data received",            "/Devices/E1k%d/ReceiveBytes", iInstance);
     PDMDevHlpSTAMRegisterF(pDevIns, &pThis->StatTransmitBytes,      STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS, STAMUNIT_BYTES,          "Amount of data transmitted",         "/Devices/E1k%d/TransmitBytes", iInstance);
+    PDMDevHlpSTAMRegisterF(pDevIns, &pThis->StatIntsPerSec,         STAMTYPE_PROFILE, STAMVISIBILITY_ALWAYS, STAMUNIT_OCCURENCES,     "Interrupts raised per second",       "/Devices/E1k%d/Interrupts/PerSec", iInstance);
+    PDMDevHlpSTAMRegisterF(pDevIns, &pThis->StatIntsItrDelayed,     STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS, STAMUNIT_OCCURENCES,     "Interrupts postponed by ITR",        "/Devices/E1k%d/Interrupts/ItrDelayed", iInstance);
+    PDMDevHlpSTAMRegisterF(pDevIns, &pThis->StatIntsRxDelayed,      STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS, STAMUNIT_OCCURENCES,     "RX interrupts deferred to RDTR/RADV","/Devices/E1k%d/Interrupts/RxDelayed", iInstance);
+    PDMDevHlpSTAMRegisterF(pDevIns, &pThis->StatRxDescFetches,      STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS, STAMUNIT_OCCURENCES,     "Guest memory reads of RX descriptors","/Devices/E1k%d/RxDesc/Fetches", iInstance);
+    PDMDevHlpSTAMRegisterF(pDevIns, &pThis->StatRxDescPerFetch,     STAMTYPE_PROFILE, STAMVISIBILITY_ALWAYS, STAMUNIT_OCCURENCES,     "RX descriptors fetched per batch",   "/Devices/E1k%d/RxDesc/PerFetch", iInstance);
+    PDMDevHlpSTAMRegisterF(pDevIns, &pThis->StatRxFrames,           STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS, STAMUNIT_OCCURENCES,     "Frames stored in guest memory",      "/Devices/E1k%d/RxDesc/Frames", iInstance);
 
 #if defined(VBOX_WITH_STATISTICS)
     PDMDevHlpSTAMRegisterF(pDevIns, &pThis->StatMMIOReadRZ,         STAMTYPE_PROFILE, STAMVISIBILITY_ALWAYS, STAMUNIT_TICKS_PER_CALL, "Profiling MMIO reads in RZ",         "/Devices/E1k%d/MMIO/ReadRZ", iInstance);
@@ -49,7 +49,8 @@
 #ifdef IN_RING3
 
 #define VNET_PCI_CLASS               0x0200
-#define VNET_N_QUEUES                3
+/** Number of virtqueues for a_cPairs RX/TX pairs, the control queue comes last. */
+#define VNET_N_QUEUES(a_cPairs)      ((a_cPairs) * 2 + 1)
 #define VNET_NAME_FMT                "VNet%d"
 
 #if 0
@@ -68,6 +69,15 @@
 #define VNET_MAX_FRAME_SIZE     65535 + 18  /**< Max IP packet size + Ethernet header with VLAN tag */
 #define VNET_MAC_FILTER_LEN     32
 #define VNET_MAX_VID            (1 << 12)
+/** Maximum number of RX/TX queue pairs (VIRTIO_NET_F_MQ). */
+#define VNET_MAX_QUEUE_PAIRS    8
+/** Size of the Toeplitz hash key used for receive side scaling. */
+#define VNET_RSS_KEY_SIZE       40
+/** Number of entries in the receive side scaling indirection table (power of two). */
+#define VNET_RSS_INDIRECTION_SIZE 128
+/** Upper bound of the back-off a TX worker polls a busy driver with (ms). */
+#define VNET_TX_RETRY_MAX_MS    16
+AssertCompile(VNET_MAX_QUEUE_PAIRS * 2 + 1 <= VIRTIO_MAX_NQUEUES);
 
 /** @name Virtio net features
  * @{  */
@@ -88,6 +98,7 @@
 #define VNET_F_CTRL_VQ    0x00020000  /**< Control channel available */
 #define VNET_F_CTRL_RX    0x00040000  /**< Control channel RX mode support */
 #define VNET_F_CTRL_VLAN  0x00080000  /**< Control channel VLAN filtering */
+#define VNET_F_MQ         0x00400000  /**< Multiple RX/TX queue pairs with receive steering */
 /** @} */
 
 #define VNET_S_LINK_UP    1
@@ -104,8 +115,53 @@ struct __attribute__ ((__packed__)) VNetPCIConfig /** @todo r=bird: Use #pragma
 {
     RTMAC    mac;
     uint16_t uStatus;
+    uint16_t uMaxVirtqueuePairs;
 };
 AssertCompileMemberOffset(struct VNetPCIConfig, uStatus, 6);
+AssertCompileMemberOffset(struct VNetPCIConfig, uMaxVirtqueuePairs, 8);
+
+/**
+ * State of an RX/TX virtqueue pair.
+ *
+ * Each pair has its own locks, so traffic on different pairs (typically
+ * driven by different guest vCPUs) does not serialize on the device lock.
+ */
+typedef struct VNETQUEUEPAIR
+{
+    /** Protects the RX virtqueue. */
+    PDMCRITSECT             CritSectRx;
+    /** Protects the notification state of the TX virtqueue. */
+    PDMCRITSECT             CritSectTx;
+    /** The receive virtqueue. */
+    R3PTRTYPE(PVQUEUE)      pRxQueue;
+    /** The transmit virtqueue. */
+    R3PTRTYPE(PVQUEUE)      pTxQueue;
+    /** The TX worker thread (NULL if the pair is serviced by EMT). */
+    R3PTRTYPE(PPDMTHREAD)   pTxThread;
+    /** Event the TX worker thread waits on. */
+    RTSEMEVENT              hEvtTx;
+    /** Indicates transmission in progress -- only one thread is allowed. */
+    uint32_t volatile       uIsTransmitting;
+    /** Set when the TX worker has been kicked and has yet to look at the queue. */
+    bool volatile           fTxPending;
+    /** Set while the TX worker is (about to go) sleeping on hEvtTx. */
+    bool volatile           fTxSleeping;
+    /** The index of this pair. */
+    uint16_t                iPair;
+
+    /** @name Statistics
+     * @{ */
+    STAMCOUNTER             StatReceivePackets;
+    STAMCOUNTER             StatReceiveBytes;
+    STAMCOUNTER             StatReceiveQueueFull;
+    STAMCOUNTER             StatTransmitPackets;
+    STAMCOUNTER             StatTransmitBytes;
+    STAMCOUNTER             StatTransmitWakeups;
+    STAMCOUNTER             StatTransmitRetries;
+    /** @} */
+} VNETQUEUEPAIR;
+/** Pointer to the state of an RX/TX virtqueue pair. */
+typedef VNETQUEUEPAIR *PVNETQUEUEPAIR;
 
 /**
  * Device state structure. Holds the current state of device.
@@ -119,8 +175,6 @@ typedef struct VNetState_st
     /* VPCISTATE must be the first member! */
     VPCISTATE               VPCI;
 
-//    PDMCRITSECT             csRx;                           /**< Protects RX queue. */
-
     PDMINETWORKDOWN         INetworkDown;
     PDMINETWORKCONFIG       INetworkConfig;
     R3PTRTYPE(PPDMIBASE)    pDrvBase;                 /**< Attached network driver. */
@@ -155,9 +209,6 @@ typedef struct VNetState_st
     uint64_t                u64NanoTS;
 #endif /* VNET_TX_DELAY */
 
-    /** Indicates transmission in progress -- only one thread is allowed. */
-    uint32_t                uIsTransmitting;
-
     /** PCI config area holding MAC address as well as TBD. */
     struct VNetPCIConfig    config;
     /** MAC address obtained from the configuration. */
@@ -186,9 +237,19 @@ typedef struct VNetState_st
     /** Bit array of VLAN filter, one bit per VLAN ID. */
     uint8_t                 aVlanFilter[VNET_MAX_VID / sizeof(uint8_t)];
 
-    R3PTRTYPE(PVQUEUE)      pRxQueue;
-    R3PTRTYPE(PVQUEUE)      pTxQueue;
     R3PTRTYPE(PVQUEUE)      pCtlQueue;
+
+    /** Number of RX/TX queue pairs the device was configured with. */
+    uint16_t                cQueuePairs;
+    /** Number of queue pairs enabled by the guest (VQ_PAIRS_SET), 1 by default. */
+    uint16_t volatile       cActivePairs;
+    /** Whether the TX queues are serviced by per-pair worker threads. */
+    bool                    fTxThreads;
+    uint8_t                 abAlignment2[3];
+    /** The Toeplitz hash key used for steering received frames. */
+    uint8_t                 abRssKey[VNET_RSS_KEY_SIZE];
+    /** Maps the low bits of the receive hash to a queue pair. */
+    uint8_t                 abRssIndirection[VNET_RSS_INDIRECTION_SIZE];
     /* Receive-blocking-related fields ***************************************/
 
     /** EMT: Gets signalled when more RX descriptors become available. */
@@ -211,6 +272,9 @@ typedef struct VNetState_st
     STAMCOUNTER             StatRxOverflowWakeup;
 #endif /* VBOX_WITH_STATISTICS */
     /** @}  */
+
+    /** The RX/TX queue pairs, cQueuePairs are in use. */
+    VNETQUEUEPAIR           aQueuePairs[VNET_MAX_QUEUE_PAIRS];
 } VNETSTATE;
 /** Pointer to a virtual I/O network device state. */
 typedef VNETSTATE *PVNETSTATE;
@@ -264,6 +328,9 @@ typedef uint8_t VNETCTLACK;
 #define VNET_CTRL_CMD_VLAN_ADD         0
 #define VNET_CTRL_CMD_VLAN_DEL         1
 
+#define VNET_CTRL_CLS_MQ               4
+#define VNET_CTRL_CMD_MQ_VQ_PAIRS_SET  0
+
 
 struct VNetCtlHdr
 {
@@ -292,23 +359,94 @@ DECLINLINE(void) vnetCsLeave(PVNETSTATE pThis)
     vpciCsLeave(&pThis->VPCI);
 }
 
+DECLINLINE(int) vnetCsTxEnter(PVNETQUEUEPAIR pPair, int rcBusy)
+{
+    return PDMCritSectEnter(&pPair->CritSectTx, rcBusy);
+}
+
+DECLINLINE(void) vnetCsTxLeave(PVNETQUEUEPAIR pPair)
+{
+    PDMCritSectLeave(&pPair->CritSectTx);
+}
+
+/** Returns the queue pair a RX or TX virtqueue belongs to. */
+DECLINLINE(PVNETQUEUEPAIR) vnetQueuePairFromQueue(PVNETSTATE pThis, PVQUEUE pQueue)
+{
+    uintptr_t const iQueue = pQueue - &pThis->VPCI.Queues[0];
+    Assert(iQueue < 2U * pThis->cQueuePairs);
+    return &pThis->aQueuePairs[iQueue / 2];
+}
+
+/**
+ * Checks whether a virtqueue is serving as the control queue of a guest that
+ * did not acknowledge VNET_F_MQ.
+ *
+ * Such a guest only knows about the first queue pair and expects the control
+ * queue right after it, which is where the RX queue of the second pair lives
+ * when more than one pair is configured.
+ */
+DECLINLINE(bool) vnetIsLegacyCtlQueue(PVNETSTATE pThis, PVQUEUE pQueue)
+{
+    return pQueue == &pThis->VPCI.Queues[2]
+        && pThis->cQueuePairs > 1
+        && !(pThis->VPCI.uGuestFeatures & VNET_F_MQ);
+}
+
 #endif /* IN_RING3 */
 
-DECLINLINE(int) vnetCsRxEnter(PVNETSTATE pThis, int rcBusy)
+DECLINLINE(int) vnetCsRxEnter(PVNETQUEUEPAIR pPair, int rcBusy)
+{
+    return PDMCritSectEnter(&pPair->CritSectRx, rcBusy);
+}
+
+DECLINLINE(void) vnetCsRxLeave(PVNETQUEUEPAIR pPair)
+{
+    PDMCritSectLeave(&pPair->CritSectRx);
+}
+
+/**
+ * Enters the RX critical sections of all queue pairs, in ascending order.
+ *
+ * @returns VINF_SUCCESS or @a rcBusy, in which case no section is held.
+ * @param   pThis       The device state structure.
+ * @param   rcBusy      Status code to return when a section is busy.
+ */
+static int vnetCsRxEnterAll(PVNETSTATE pThis, int rcBusy)
 {
-    RT_NOREF_PV(pThis);
-    RT_NOREF_PV(rcBusy);
-    // STAM_PROFILE_START(&pThis->CTXSUFF(StatCsRx), a);
-    // int rc = PDMCritSectEnter(&pThis->csRx, rcBusy);
-    // STAM_PROFILE_STOP(&pThis->CTXSUFF(StatCsRx), a);
-    // return rc;
+    for (unsigned i = 0; i < pThis->cQueuePairs; i++)
+    {
+        int rc = vnetCsRxEnter(&pThis->aQueuePairs[i], rcBusy);
+        if (RT_UNLIKELY(rc != VINF_SUCCESS))
+        {
+            while (i-- > 0)
+                vnetCsRxLeave(&pThis->aQueuePairs[i]);
+            return rc;
+        }
+    }
     return VINF_SUCCESS;
 }
 
-DECLINLINE(void) vnetCsRxLeave(PVNETSTATE pThis)
+static void vnetCsRxLeaveAll(PVNETSTATE pThis)
 {
-    RT_NOREF_PV(pThis);
-    // PDMCritSectLeave(&pThis->csRx);
+    for (unsigned i = pThis->cQueuePairs; i-- > 0;)
+        vnetCsRxLeave(&pThis->aQueuePairs[i]);
+}
+
+/**
+ * Sets the number of queue pairs in use and spreads the RSS indirection
+ * table evenly over them.
+ *
+ * @param   pThis       The device state structure.
+ * @param   cPairs      The number of pairs, 1 to cQueuePairs.
+ */
+static void vnetSetActivePairs(PVNETSTATE pThis, uint16_t cPairs)
+{
+    Assert(cPairs >= 1 && cPairs <= pThis->cQueuePairs);
+    /* The receive path falls back on pair 0 for entries beyond cActivePairs,
+       so this may race frames being steered. */
+    for (unsigned i = 0; i < VNET_RSS_INDIRECTION_SIZE; i++)
+        pThis->abRssIndirection[i] = (uint8_t)(i % cPairs);
+    ASMAtomicWriteU16(&pThis->cActivePairs, cPairs);
 }
 
 #ifdef IN_RING3
@@ -368,7 +506,8 @@ DECLINLINE(void) vnetPrintFeatures(PVNETSTATE pThis, uint32_t fFeatures, const c
         { VNET_F_STATUS,     "virtio_net_config.status available" },
         { VNET_F_CTRL_VQ,    "control channel available" },
         { VNET_F_CTRL_RX,    "control channel RX mode support" },
-        { VNET_F_CTRL_VLAN,  "control channel VLAN filtering" }
+        { VNET_F_CTRL_VLAN,  "control channel VLAN filtering" },
+        { VNET_F_MQ,         "multiple queue pairs with receive steering" }
     };
 
     Log3(("%s %s:\n", INSTANCE(pThis), pcszText));
@@ -384,7 +523,7 @@ DECLINLINE(void) vnetPrintFeatures(PVNETSTATE pThis, uint32_t fFeatures, const c
 
 static DECLCALLBACK(uint32_t) vnetIoCb_GetHostFeatures(void *pvState)
 {
-    RT_NOREF_PV(pvState);
+    PVNETSTATE pThis = (PVNETSTATE)pvState;
 
     /* We support:
      * - Host-provided MAC address
@@ -393,8 +532,10 @@ static DECLCALLBACK(uint32_t) vnetIoCb_GetHostFeatures(void *pvState)
      * - RX mode setting
      * - MAC filter table
      * - VLAN filter
+     * - Multiple queue pairs, if configured
      */
     return VNET_F_MAC
+        | (pThis->cQueuePairs > 1 ? VNET_F_MQ : 0)
         | VNET_F_STATUS
         | VNET_F_CTRL_VQ
         | VNET_F_CTRL_RX
@@ -466,14 +607,14 @@ static DECLCALLBACK(int) vnetIoCb_Reset(void *pvState)
     PVNETSTATE pThis = (PVNETSTATE)pvState;
     Log(("%s Reset triggered\n", INSTANCE(pThis)));
 
-    int rc = vnetCsRxEnter(pThis, VERR_SEM_BUSY);
+    int rc = vnetCsRxEnterAll(pThis, VINF_IOM_R3_IOPORT_WRITE);
     if (RT_UNLIKELY(rc != VINF_SUCCESS))
     {
-        LogRel(("vnetIoCb_Reset failed to enter RX critical section!\n"));
+        Log(("%s vnetIoCb_Reset: RX critical section busy (%Rrc)\n", INSTANCE(pThis), rc));
         return rc;
     }
     vpciReset(&pThis->VPCI);
-    vnetCsRxLeave(pThis);
+    vnetCsRxLeaveAll(pThis);
 
     /// @todo Implement reset
     if (pThis->fCableConnected)
@@ -491,7 +632,10 @@ static DECLCALLBACK(int) vnetIoCb_Reset(void *pvState)
     pThis->nMacFilterEntries = 0;
     memset(pThis->aMacFilter,  0, VNET_MAC_FILTER_LEN * sizeof(RTMAC));
     memset(pThis->aVlanFilter, 0, sizeof(pThis->aVlanFilter));
-    pThis->uIsTransmitting   = 0;
+    for (unsigned i = 0; i < pThis->cQueuePairs; i++)
+        ASMAtomicWriteU32(&pThis->aQueuePairs[i].uIsTransmitting, 0);
+    /* Only the first pair is used until the guest says otherwise. */
+    vnetSetActivePairs(pThis, 1);
 #ifndef IN_RING3
     return VINF_IOM_R3_IOPORT_WRITE;
 #else
@@ -640,35 +784,81 @@ PDMBOTHCBDECL(int) vnetIOPortOut(PPDMDEVINS pDevIns, void *pvUser, RTIOPORT port
  *          It disables notification if it can receive.
  *
  * @returns VERR_NET_NO_BUFFER_SPACE if it cannot.
- * @param   pInterface      Pointer to the interface structure containing the called function pointer.
+ * @param   pThis           The device state structure.
+ * @param   pPair           The queue pair to check the RX queue of.
  * @thread  RX
  */
-static int vnetCanReceive(PVNETSTATE pThis)
+static int vnetCanReceive(PVNETSTATE pThis, PVNETQUEUEPAIR pPair)
 {
-    int rc = vnetCsRxEnter(pThis, VERR_SEM_BUSY);
+    int rc = vnetCsRxEnter(pPair, VERR_SEM_BUSY);
     AssertRCReturn(rc, rc);
 
-    LogFlow(("%s vnetCanReceive\n", INSTANCE(pThis)));
+    LogFlow(("%s vnetCanReceive: pair %u\n", INSTANCE(pThis), pPair->iPair));
     if (!(pThis->VPCI.uStatus & VPCI_STATUS_DRV_OK))
         rc = VERR_NET_NO_BUFFER_SPACE;
-    else if (!vqueueIsReady(&pThis->VPCI, pThis->pRxQueue))
+    else if (!vqueueIsReady(&pThis->VPCI, pPair->pRxQueue))
         rc = VERR_NET_NO_BUFFER_SPACE;
-    else if (vqueueIsEmpty(&pThis->VPCI, pThis->pRxQueue))
+    else if (vqueueIsEmpty(&pThis->VPCI, pPair->pRxQueue))
     {
-        vringSetNotification(&pThis->VPCI, &pThis->pRxQueue->VRing, true);
+        vqueueSetNotification(&pThis->VPCI, pPair->pRxQueue, true);
         rc = VERR_NET_NO_BUFFER_SPACE;
     }
     else
     {
-        vringSetNotification(&pThis->VPCI, &pThis->pRxQueue->VRing, false);
+        vqueueSetNotification(&pThis->VPCI, pPair->pRxQueue, false);
         rc = VINF_SUCCESS;
     }
 
     LogFlow(("%s vnetCanReceive -> %Rrc\n", INSTANCE(pThis), rc));
-    vnetCsRxLeave(pThis);
+    vnetCsRxLeave(pPair);
+    return rc;
+}
+
+/**
+ * Checks if the RX queue of any active queue pair has buffers.
+ *
+ * @returns VINF_SUCCESS or VERR_NET_NO_BUFFER_SPACE.
+ * @param   pThis           The device state structure.
+ * @thread  RX
+ */
+static int vnetCanReceiveAny(PVNETSTATE pThis)
+{
+    int            rc           = VERR_NET_NO_BUFFER_SPACE;
+    uint32_t const cActivePairs = ASMAtomicReadU16(&pThis->cActivePairs);
+    for (uint32_t i = 0; i < cActivePairs && RT_FAILURE(rc); i++)
+        rc = vnetCanReceive(pThis, &pThis->aQueuePairs[i]);
     return rc;
 }
 
+/**
+ * Picks the queue pair to store a received frame in, preferring the one it
+ * was steered to.
+ *
+ * vnetNetworkDown_WaitReceiveAvail only tells the driver that some pair has
+ * buffers, so a frame whose pair is full goes to the next one with room
+ * instead of being dropped.
+ *
+ * @returns The queue pair, NULL if none of the active ones has buffers.
+ * @param   pThis           The device state structure.
+ * @param   pPair           The queue pair the frame was steered to.
+ * @thread  RX
+ */
+static PVNETQUEUEPAIR vnetRxPairWithBuffers(PVNETSTATE pThis, PVNETQUEUEPAIR pPair)
+{
+    if (RT_SUCCESS(vnetCanReceive(pThis, pPair)))
+        return pPair;
+    STAM_REL_COUNTER_INC(&pPair->StatReceiveQueueFull);
+
+    uint32_t const cActivePairs = ASMAtomicReadU16(&pThis->cActivePairs);
+    for (uint32_t i = 1; i < cActivePairs; i++)
+    {
+        PVNETQUEUEPAIR pOther = &pThis->aQueuePairs[(pPair->iPair + i) % cActivePairs];
+        if (pOther != pPair && RT_SUCCESS(vnetCanReceive(pThis, pOther)))
+            return pOther;
+    }
+    return NULL;
+}
+
 /**
  * @interface_method_impl{PDMINETWORKDOWN,pfnWaitReceiveAvail}
  */
@@ -676,7 +866,7 @@ static DECLCALLBACK(int) vnetNetworkDown_WaitReceiveAvail(PPDMINETWORKDOWN pInte
 {
     PVNETSTATE pThis = RT_FROM_MEMBER(pInterface, VNETSTATE, INetworkDown);
     LogFlow(("%s vnetNetworkDown_WaitReceiveAvail(cMillies=%u)\n", INSTANCE(pThis), cMillies));
-    int rc = vnetCanReceive(pThis);
+    int rc = vnetCanReceiveAny(pThis);
 
     if (RT_SUCCESS(rc))
         return VINF_SUCCESS;
@@ -691,7 +881,7 @@ static DECLCALLBACK(int) vnetNetworkDown_WaitReceiveAvail(PPDMINETWORKDOWN pInte
     while (RT_LIKELY(   (enmVMState = PDMDevHlpVMState(pThis->VPCI.CTX_SUFF(pDevIns))) == VMSTATE_RUNNING
                      ||  enmVMState == VMSTATE_RUNNING_LS))
     {
-        int rc2 = vnetCanReceive(pThis);
+        int rc2 = vnetCanReceiveAny(pThis);
         if (RT_SUCCESS(rc2))
         {
             rc = VINF_SUCCESS;
@@ -788,6 +978,101 @@ static bool vnetAddressFilter(PVNETSTATE pThis, const void *pvBuf, size_t cb)
     return false;
 }
 
+/**
+ * Computes the Toeplitz hash of the given input.
+ *
+ * @returns The 32-bit hash.
+ * @param   pabKey          The hash key, at least @a cbInput + 4 bytes long.
+ * @param   pbInput         The input (addresses and ports in network order).
+ * @param   cbInput         The number of input bytes.
+ */
+static uint32_t vnetRssToeplitz(const uint8_t *pabKey, const uint8_t *pbInput, size_t cbInput)
+{
+    uint32_t uHash   = 0;
+    uint32_t uWindow = RT_MAKE_U32_FROM_U8(pabKey[3], pabKey[2], pabKey[1], pabKey[0]);
+    for (size_t i = 0; i < cbInput; i++)
+    {
+        uint8_t const bInput   = pbInput[i];
+        uint8_t const bNextKey = pabKey[i + 4];
+        for (int iBit = 7; iBit >= 0; iBit--)
+        {
+            if (bInput & RT_BIT(iBit))
+                uHash ^= uWindow;
+            uWindow = (uWindow << 1) | ((bNextKey >> iBit) & 1);
+        }
+    }
+    return uHash;
+}
+
+/**
+ * Picks the queue pair to deliver a received frame to.
+ *
+ * The frame is hashed over the IP addresses, plus the ports for unfragmented
+ * TCP and UDP, the same way RSS capable NICs do by default.  Everything that
+ * isn't IP goes to the first pair.
+ *
+ * @returns The queue pair.
+ * @param   pThis           The device state structure.
+ * @param   pbFrame         The ethernet frame.
+ * @param   cb              The size of the frame.
+ * @thread  RX
+ */
+static PVNETQUEUEPAIR vnetRssSelectPair(PVNETSTATE pThis, const uint8_t *pbFrame, size_t cb)
+{
+    uint32_t const cActivePairs = ASMAtomicReadU16(&pThis->cActivePairs);
+    if (cActivePairs <= 1)
+        return &pThis->aQueuePairs[0];
+
+    size_t off = sizeof(RTNETETHERHDR);
+    if (cb < off + 4)
+        return &pThis->aQueuePairs[0];
+    uint16_t uEtherType = RT_MAKE_U16(pbFrame[off - 1], pbFrame[off - 2]);
+    if (uEtherType == RTNET_ETHERTYPE_VLAN)
+    {
+        uEtherType = RT_MAKE_U16(pbFrame[off + 3], pbFrame[off + 2]);
+        off += 4;
+    }
+
+    uint8_t abInput[2 * sizeof(RTNETADDRIPV6) + 2 * sizeof(uint16_t)];
+    size_t  cbInput;
+    size_t  offL4;
+    uint8_t bProto;
+    if (uEtherType == RTNET_ETHERTYPE_IPV4 && cb >= off + RTNETIPV4_MIN_LEN)
+    {
+        PCRTNETIPV4 pIpHdr = (PCRTNETIPV4)(pbFrame + off);
+        memcpy(&abInput[0], &pIpHdr->ip_src, sizeof(RTNETADDRIPV4));
+        memcpy(&abInput[4], &pIpHdr->ip_dst, sizeof(RTNETADDRIPV4));
+        cbInput = 2 * sizeof(RTNETADDRIPV4);
+        offL4   = off + pIpHdr->ip_hl * 4;
+        bProto  = pIpHdr->ip_p;
+        if (RT_BE2H_U16(pIpHdr->ip_off) & (RTNETIPV4_FLAGS_MF | UINT16_C(0x1fff)))
+            bProto = 0; /* Fragments are hashed on the addresses only. */
+    }
+    else if (uEtherType == RTNET_ETHERTYPE_IPV6 && cb >= off + sizeof(RTNETIPV6))
+    {
+        PCRTNETIPV6 pIpHdr = (PCRTNETIPV6)(pbFrame + off);
+        memcpy(&abInput[0],  &pIpHdr->ip6_src, sizeof(RTNETADDRIPV6));
+        memcpy(&abInput[16], &pIpHdr->ip6_dst, sizeof(RTNETADDRIPV6));
+        cbInput = 2 * sizeof(RTNETADDRIPV6);
+        offL4   = off + sizeof(RTNETIPV6);
+        bProto  = pIpHdr->ip6_nxt;
+    }
+    else
+        return &pThis->aQueuePairs[0];
+
+    if (   (bProto == RTNETIPV4_PROT_TCP || bProto == RTNETIPV4_PROT_UDP)
+        && cb >= offL4 + 2 * sizeof(uint16_t))
+    {
+        /* The source and destination ports lead both headers. */
+        memcpy(&abInput[cbInput], pbFrame + offL4, 2 * sizeof(uint16_t));
+        cbInput += 2 * sizeof(uint16_t);
+    }
+
+    uint32_t const uHash = vnetRssToeplitz(pThis->abRssKey, abInput, cbInput);
+    uint32_t const iPair = pThis->abRssIndirection[uHash & (VNET_RSS_INDIRECTION_SIZE - 1)];
+    return &pThis->aQueuePairs[iPair < cActivePairs ? iPair : 0];
+}
+
 /**
  * Pad and store received packet.
  *
@@ -796,11 +1081,12 @@ static bool vnetAddressFilter(PVNETSTATE pThis, const void *pvBuf, size_t cb)
  *
  * @returns VBox status code.
  * @param   pThis          The device state structure.
+ * @param   pPair           The queue pair to store the packet in.
  * @param   pvBuf           The available data.
  * @param   cb              Number of bytes available in the buffer.
  * @thread  RX
  */
-static int vnetHandleRxPacket(PVNETSTATE pThis, const void *pvBuf, size_t cb,
+static int vnetHandleRxPacket(PVNETSTATE pThis, PVNETQUEUEPAIR pPair, const void *pvBuf, size_t cb,
                               PCPDMNETWORKGSO pGso)
 {
     VNETHDRMRX   Hdr;
@@ -854,7 +1140,7 @@ static int vnetHandleRxPacket(PVNETSTATE pThis, const void *pvBuf, size_t cb,
         VQUEUEELEM elem;
         unsigned int nSeg = 0, uElemSize = 0, cbReserved = 0;
 
-        if (!vqueueGet(&pThis->VPCI, pThis->pRxQueue, &elem))
+        if (!vqueueGet(&pThis->VPCI, pPair->pRxQueue, &elem))
         {
             /*
              * @todo: It is possible to run out of RX buffers if only a few
@@ -898,7 +1184,7 @@ static int vnetHandleRxPacket(PVNETSTATE pThis, const void *pvBuf, size_t cb,
             uElemSize += uSize;
         }
         STAM_PROFILE_START(&pThis->StatReceiveStore, a);
-        vqueuePut(&pThis->VPCI, pThis->pRxQueue, &elem, uElemSize, cbReserved);
+        vqueuePut(&pThis->VPCI, pPair->pRxQueue, &elem, uElemSize, cbReserved);
         STAM_PROFILE_STOP(&pThis->StatReceiveStore, a);
         if (!vnetMergeableRxBuffers(pThis))
             break;
@@ -915,7 +1201,7 @@ static int vnetHandleRxPacket(PVNETSTATE pThis, const void *pvBuf, size_t cb,
             return rc;
         }
     }
-    vqueueSync(&pThis->VPCI, pThis->pRxQueue);
+    vqueueSync(&pThis->VPCI, pPair->pRxQueue);
     if (uOffset < cb)
     {
         Log(("%s vnetHandleRxPacket: Packet did not fit into RX queue (packet size=%u)!\n", INSTANCE(pThis), cb));
@@ -962,9 +1248,10 @@ static DECLCALLBACK(int) vnetNetworkDown_ReceiveGso(PPDMINETWORKDOWN pInterface,
     }
 
     Log2(("%s vnetNetworkDown_ReceiveGso: pvBuf=%p cb=%u pGso=%p\n", INSTANCE(pThis), pvBuf, cb, pGso));
-    int rc = vnetCanReceive(pThis);
-    if (RT_FAILURE(rc))
-        return rc;
+    PVNETQUEUEPAIR pPair = vnetRxPairWithBuffers(pThis, vnetRssSelectPair(pThis, (const uint8_t *)pvBuf, cb));
+    if (!pPair)
+        return VERR_NET_NO_BUFFER_SPACE;
+    int rc = VINF_SUCCESS;
 
     /* Drop packets if VM is not running or cable is disconnected. */
     VMSTATE enmVMState = PDMDevHlpVMState(pThis->VPCI.CTX_SUFF(pDevIns));
@@ -977,12 +1264,14 @@ static DECLCALLBACK(int) vnetNetworkDown_ReceiveGso(PPDMINETWORKDOWN pInterface,
     vpciSetReadLed(&pThis->VPCI, true);
     if (vnetAddressFilter(pThis, pvBuf, cb))
     {
-        rc = vnetCsRxEnter(pThis, VERR_SEM_BUSY);
+        rc = vnetCsRxEnter(pPair, VERR_SEM_BUSY);
         if (RT_SUCCESS(rc))
         {
-            rc = vnetHandleRxPacket(pThis, pvBuf, cb, pGso);
+            rc = vnetHandleRxPacket(pThis, pPair, pvBuf, cb, pGso);
             STAM_REL_COUNTER_ADD(&pThis->StatReceiveBytes, cb);
-            vnetCsRxLeave(pThis);
+            STAM_REL_COUNTER_INC(&pPair->StatReceivePackets);
+            STAM_REL_COUNTER_ADD(&pPair->StatReceiveBytes, cb);
+            vnetCsRxLeave(pPair);
         }
     }
     vpciSetReadLed(&pThis->VPCI, false);
@@ -1078,10 +1367,16 @@ static DECLCALLBACK(int) vnetSetLinkState(PPDMINETWORKCONFIG pInterface, PDMNETW
     return VINF_SUCCESS;
 }
 
+static DECLCALLBACK(void) vnetQueueControl(void *pvState, PVQUEUE pQueue);
+
 static DECLCALLBACK(void) vnetQueueReceive(void *pvState, PVQUEUE pQueue)
 {
-    RT_NOREF(pQueue);
     PVNETSTATE pThis = (PVNETSTATE)pvState;
+    if (vnetIsLegacyCtlQueue(pThis, pQueue))
+    {
+        vnetQueueControl(pvState, pQueue);
+        return;
+    }
     Log(("%s Receive buffers has been added, waking up receive thread.\n", INSTANCE(pThis)));
     vnetWakeupReceive(pThis->VPCI.CTX_SUFF(pDevIns));
 }
@@ -1133,19 +1428,8 @@ DECLINLINE(PPDMNETWORKGSO) vnetSetupGsoCtx(PPDMNETWORKGSO pGso, VNETHDR const *p
 
 DECLINLINE(uint16_t) vnetCSum16(const void *pvBuf, size_t cb)
 {
-    uint32_t  csum = 0;
-    uint16_t *pu16 = (uint16_t *)pvBuf;
-
-    while (cb > 1)
-    {
-        csum += *pu16++;
-        cb -= 2;
-    }
-    if (cb)
-        csum += *(uint8_t*)pu16;
-    while (csum >> 16)
-        csum = (csum >> 16) + (csum & 0xFFFF);
-    return ~csum;
+    bool fOdd = false;
+    return RTNetIPv4FinalizeChecksum(RTNetIPv4AddDataChecksum(pvBuf, cb, 0, &fOdd));
 }
 
 DECLINLINE(void) vnetCompleteChecksum(uint8_t *pBuf, size_t cbSize, uint16_t uStart, uint16_t uOffset)
@@ -1153,20 +1437,30 @@ DECLINLINE(void) vnetCompleteChecksum(uint8_t *pBuf, size_t cbSize, uint16_t uSt
     *(uint16_t*)(pBuf + uStart + uOffset) = vnetCSum16(pBuf + uStart, cbSize - uStart);
 }
 
-static void vnetTransmitPendingPackets(PVNETSTATE pThis, PVQUEUE pQueue, bool fOnWorkerThread)
+/**
+ * Transmits the packets pending in the TX queue of a queue pair.
+ *
+ * @returns Number of descriptor chains consumed.
+ * @param   pThis           The device state structure.
+ * @param   pPair           The queue pair.
+ * @param   fOnWorkerThread Whether we're on a worker thread or on an EMT.
+ */
+static uint32_t vnetTransmitPendingPackets(PVNETSTATE pThis, PVNETQUEUEPAIR pPair, bool fOnWorkerThread)
 {
+    PVQUEUE const pQueue = pPair->pTxQueue;
+
     /*
      * Only one thread is allowed to transmit at a time, others should skip
      * transmission as the packets will be picked up by the transmitting
      * thread.
      */
-    if (!ASMAtomicCmpXchgU32(&pThis->uIsTransmitting, 1, 0))
-        return;
+    if (!ASMAtomicCmpXchgU32(&pPair->uIsTransmitting, 1, 0))
+        return 0;
 
     if ((pThis->VPCI.uStatus & VPCI_STATUS_DRV_OK) == 0)
     {
         Log(("%s Ignoring transmit requests from non-existent driver (status=0x%x).\n", INSTANCE(pThis), pThis->VPCI.uStatus));
-        return;
+        return 0;
     }
 
     PPDMINETWORKUP pDrv = pThis->pDrv;
@@ -1176,8 +1470,8 @@ static void vnetTransmitPendingPackets(PVNETSTATE pThis, PVQUEUE pQueue, bool fO
         Assert(rc == VINF_SUCCESS || rc == VERR_TRY_AGAIN);
         if (rc == VERR_TRY_AGAIN)
         {
-            ASMAtomicWriteU32(&pThis->uIsTransmitting, 0);
-            return;
+            ASMAtomicWriteU32(&pPair->uIsTransmitting, 0);
+            return 0;
         }
     }
 
@@ -1187,11 +1481,12 @@ static void vnetTransmitPendingPackets(PVNETSTATE pThis, PVQUEUE pQueue, bool fO
     else
         uHdrLen = sizeof(VNETHDR);
 
-    Log3(("%s vnetTransmitPendingPackets: About to transmit %d pending packets\n",
-          INSTANCE(pThis), vringReadAvailIndex(&pThis->VPCI, &pThis->pTxQueue->VRing) - pThis->pTxQueue->uNextAvailIndex));
+    Log3(("%s vnetTransmitPendingPackets: About to transmit %d pending packets on pair %u\n",
+          INSTANCE(pThis), vringReadAvailIndex(&pThis->VPCI, &pQueue->VRing) - pQueue->uNextAvailIndex, pPair->iPair));
 
     vpciSetWriteLed(&pThis->VPCI, true);
 
+    uint32_t   cChains = 0;
     VQUEUEELEM elem;
     /*
      * Do not remove descriptors from available ring yet, try to allocate the
@@ -1227,6 +1522,7 @@ static void vnetTransmitPendingPackets(PVNETSTATE pThis, PVQUEUE pQueue, bool fO
                                   &Hdr, sizeof(Hdr));
 
                 STAM_REL_COUNTER_INC(&pThis->StatTransmitPackets);
+                STAM_REL_COUNTER_INC(&pPair->StatTransmitPackets);
 
                 STAM_PROFILE_START(&pThis->StatTransmitSend, a);
 
@@ -1306,19 +1602,107 @@ static void vnetTransmitPendingPackets(PVNETSTATE pThis, PVQUEUE pQueue, bool fO
 
                 STAM_PROFILE_STOP(&pThis->StatTransmitSend, a);
                 STAM_REL_COUNTER_ADD(&pThis->StatTransmitBytes, uOffset);
+                STAM_REL_COUNTER_ADD(&pPair->StatTransmitBytes, uOffset);
             }
         }
         /* Remove this descriptor chain from the available ring */
         vqueueSkip(&pThis->VPCI, pQueue);
         vqueuePut(&pThis->VPCI, pQueue, &elem, sizeof(VNETHDR) + uOffset);
-        vqueueSync(&pThis->VPCI, pQueue);
+        vqueueSync(&pThis->VPCI, pQueue, false /*fFlush*/);
         STAM_PROFILE_ADV_STOP(&pThis->StatTransmit, a);
+        cChains++;
     }
+    /* Publish the rest of the burst and interrupt the guest once for all of it. */
+    if (cChains)
+        vqueueSync(&pThis->VPCI, pQueue);
     vpciSetWriteLed(&pThis->VPCI, false);
 
     if (pDrv)
         pDrv->pfnEndXmit(pDrv);
-    ASMAtomicWriteU32(&pThis->uIsTransmitting, 0);
+    ASMAtomicWriteU32(&pPair->uIsTransmitting, 0);
+    return cChains;
+}
+
+/**
+ * Kicks the TX worker thread of a queue pair.
+ *
+ * @param   pPair           The queue pair.
+ */
+static void vnetTxThreadKick(PVNETQUEUEPAIR pPair)
+{
+    ASMAtomicWriteBool(&pPair->fTxPending, true);
+    if (ASMAtomicReadBool(&pPair->fTxSleeping))
+        RTSemEventSignal(pPair->hEvtTx);
+}
+
+/**
+ * @callback_method_impl{FNPDMTHREADDEV, Transmits the packets of one queue
+ *                      pair, so guest vCPUs kicking different pairs do not
+ *                      have to wait for each other.}
+ */
+static DECLCALLBACK(int) vnetTxThread(PPDMDEVINS pDevIns, PPDMTHREAD pThread)
+{
+    PVNETSTATE     pThis = PDMINS_2_DATA(pDevIns, PVNETSTATE);
+    PVNETQUEUEPAIR pPair = (PVNETQUEUEPAIR)pThread->pvUser;
+    RTMSINTERVAL   cMsRetry = 0;
+
+    if (pThread->enmState == PDMTHREADSTATE_INITIALIZING)
+        return VINF_SUCCESS;
+
+    while (pThread->enmState == PDMTHREADSTATE_RUNNING)
+    {
+        ASMAtomicWriteBool(&pPair->fTxSleeping, true);
+        if (!ASMAtomicXchgBool(&pPair->fTxPending, false))
+        {
+            int rc = RTSemEventWait(pPair->hEvtTx, cMsRetry ? cMsRetry : RT_INDEFINITE_WAIT);
+            AssertLogRelMsgReturn(RT_SUCCESS(rc) || rc == VERR_INTERRUPTED || rc == VERR_TIMEOUT, ("%Rrc\n", rc), rc);
+            if (RT_UNLIKELY(pThread->enmState != PDMTHREADSTATE_RUNNING))
+                break;
+            ASMAtomicWriteBool(&pPair->fTxPending, false);
+        }
+        ASMAtomicWriteBool(&pPair->fTxSleeping, false);
+        STAM_REL_COUNTER_INC(&pPair->StatTransmitWakeups);
+
+        uint32_t cChains = vnetTransmitPendingPackets(pThis, pPair, true /*fOnWorkerThread*/);
+
+        /*
+         * Re-enable the notification and go for another round if the guest
+         * queued more while it was off.  If nothing could be sent the driver
+         * was busy, typically with another pair's worker holding its transmit
+         * lock, or out of buffers.  Not all drivers call pfnXmitPending once
+         * that clears (DrvNAT never does, DrvIntNet not for worker threads),
+         * so retry after a back-off that doubles while no progress is made.
+         */
+        RTMSINTERVAL const cMsPrevRetry = cMsRetry;
+        cMsRetry = 0;
+        if (RT_SUCCESS(vnetCsTxEnter(pPair, VERR_SEM_BUSY)))
+        {
+            vqueueSetNotification(&pThis->VPCI, pPair->pTxQueue, true);
+            if (!vqueueIsEmpty(&pThis->VPCI, pPair->pTxQueue))
+            {
+                if (cChains)
+                    ASMAtomicWriteBool(&pPair->fTxPending, true);
+                else
+                {
+                    cMsRetry = RT_MIN(cMsPrevRetry ? cMsPrevRetry * 2 : 1, VNET_TX_RETRY_MAX_MS);
+                    STAM_REL_COUNTER_INC(&pPair->StatTransmitRetries);
+                }
+            }
+            vnetCsTxLeave(pPair);
+        }
+    }
+
+    return VINF_SUCCESS;
+}
+
+/**
+ * @callback_method_impl{FNPDMTHREADWAKEUPDEV}
+ */
+static DECLCALLBACK(int) vnetTxThreadWakeUp(PPDMDEVINS pDevIns, PPDMTHREAD pThread)
+{
+    RT_NOREF(pDevIns);
+    PVNETQUEUEPAIR pPair = (PVNETQUEUEPAIR)pThread->pvUser;
+    return RTSemEventSignal(pPair->hEvtTx);
 }
 
 /**
@@ -1327,38 +1711,58 @@ static void vnetTransmitPendingPackets(PVNETSTATE pThis, PVQUEUE pQueue, bool fO
 static DECLCALLBACK(void) vnetNetworkDown_XmitPending(PPDMINETWORKDOWN pInterface)
 {
     PVNETSTATE pThis = RT_FROM_MEMBER(pInterface, VNETSTATE, INetworkDown);
-    vnetTransmitPendingPackets(pThis, pThis->pTxQueue, false /*fOnWorkerThread*/);
+    uint32_t const cActivePairs = ASMAtomicReadU16(&pThis->cActivePairs);
+    for (uint32_t i = 0; i < cActivePairs; i++)
+    {
+        if (pThis->fTxThreads)
+            vnetTxThreadKick(&pThis->aQueuePairs[i]);
+        else
+            vnetTransmitPendingPackets(pThis, &pThis->aQueuePairs[i], false /*fOnWorkerThread*/);
+    }
 }
 
 #ifdef VNET_TX_DELAY
 
 static DECLCALLBACK(void) vnetQueueTransmit(void *pvState, PVQUEUE pQueue)
 {
-    PVNETSTATE pThis = (PVNETSTATE)pvState;
+    PVNETSTATE     pThis = (PVNETSTATE)pvState;
+    PVNETQUEUEPAIR pPair = vnetQueuePairFromQueue(pThis, pQueue);
 
-    if (TMTimerIsActive(pThis->CTX_SUFF(pTxTimer)))
+    if (pThis->fTxThreads)
+    {
+        /* The worker re-enables the notification once it has drained the queue. */
+        if (RT_FAILURE(vnetCsTxEnter(pPair, VERR_SEM_BUSY)))
+            LogRel(("vnetQueueTransmit: Failed to enter critical section!/n"));
+        else
+        {
+            vqueueSetNotification(&pThis->VPCI, pQueue, false);
+            vnetCsTxLeave(pPair);
+        }
+        vnetTxThreadKick(pPair);
+    }
+    else if (TMTimerIsActive(pThis->CTX_SUFF(pTxTimer)))
     {
         TMTimerStop(pThis->CTX_SUFF(pTxTimer));
         Log3(("%s vnetQueueTransmit: Got kicked with notification disabled, re-enable notification and flush TX queue\n", INSTANCE(pThis)));
-        vnetTransmitPendingPackets(pThis, pQueue, false /*fOnWorkerThread*/);
-        if (RT_FAILURE(vnetCsEnter(pThis, VERR_SEM_BUSY)))
+        vnetTransmitPendingPackets(pThis, pPair, false /*fOnWorkerThread*/);
+        if (RT_FAILURE(vnetCsTxEnter(pPair, VERR_SEM_BUSY)))
             LogRel(("vnetQueueTransmit: Failed to enter critical section!/n"));
         else
         {
-            vringSetNotification(&pThis->VPCI, &pThis->pTxQueue->VRing, true);
-            vnetCsLeave(pThis);
+            vqueueSetNotification(&pThis->VPCI, pQueue, true);
+            vnetCsTxLeave(pPair);
         }
     }
     else
     {
-        if (RT_FAILURE(vnetCsEnter(pThis, VERR_SEM_BUSY)))
+        if (RT_FAILURE(vnetCsTxEnter(pPair, VERR_SEM_BUSY)))
             LogRel(("vnetQueueTransmit: Failed to enter critical section!/n"));
         else
         {
-            vringSetNotification(&pThis->VPCI, &pThis->pTxQueue->VRing, false);
+            vqueueSetNotification(&pThis->VPCI, pQueue, false);
             TMTimerSetMicro(pThis->CTX_SUFF(pTxTimer), VNET_TX_DELAY);
             pThis->u64NanoTS = RTTimeNanoTS();
-            vnetCsLeave(pThis);
+            vnetCsTxLeave(pPair);
         }
     }
 }
@@ -1382,23 +1786,33 @@ static DECLCALLBACK(void) vnetTxTimer(PPDMDEVINS pDevIns, PTMTIMER pTimer, void
           u32MicroDiff, pThis->u32AvgDiff, pThis->u32MinDiff, pThis->u32MaxDiff));
 
 //    Log3(("%s vnetTxTimer: Expired\n", INSTANCE(pThis)));
-    vnetTransmitPendingPackets(pThis, pThis->pTxQueue, false /*fOnWorkerThread*/);
-    if (RT_FAILURE(vnetCsEnter(pThis, VERR_SEM_BUSY)))
+    /* The timer is shared, so flush every pair that may have been kicked. */
+    uint32_t const cActivePairs = ASMAtomicReadU16(&pThis->cActivePairs);
+    for (uint32_t i = 0; i < cActivePairs; i++)
     {
-        LogRel(("vnetTxTimer: Failed to enter critical section!/n"));
-        return;
+        PVNETQUEUEPAIR pPair = &pThis->aQueuePairs[i];
+        vnetTransmitPendingPackets(pThis, pPair, false /*fOnWorkerThread*/);
+        if (RT_FAILURE(vnetCsTxEnter(pPair, VERR_SEM_BUSY)))
+        {
+            LogRel(("vnetTxTimer: Failed to enter critical section!/n"));
+            return;
+        }
+        vqueueSetNotification(&pThis->VPCI, pPair->pTxQueue, true);
+        vnetCsTxLeave(pPair);
     }
-    vringSetNotification(&pThis->VPCI, &pThis->pTxQueue->VRing, true);
-    vnetCsLeave(pThis);
 }
 
 #else /* !VNET_TX_DELAY */
 
 static DECLCALLBACK(void) vnetQueueTransmit(void *pvState, PVQUEUE pQueue)
 {
-    PVNETSTATE pThis = (PVNETSTATE)pvState;
+    PVNETSTATE     pThis = (PVNETSTATE)pvState;
+    PVNETQUEUEPAIR pPair = vnetQueuePairFromQueue(pThis, pQueue);
 
-    vnetTransmitPendingPackets(pThis, pQueue, false /*fOnWorkerThread*/);
+    if (pThis->fTxThreads)
+        vnetTxThreadKick(pPair);
+    else
+        vnetTransmitPendingPackets(pThis, pPair, false /*fOnWorkerThread*/);
 }
 
 #endif /* !VNET_TX_DELAY */
@@ -1549,6 +1963,35 @@ static uint8_t vnetControlVlan(PVNETSTATE pThis, PVNETCTLHDR pCtlHdr, PVQUEUEELE
     return u8Ack;
 }
 
+static uint8_t vnetControlMq(PVNETSTATE pThis, PVNETCTLHDR pCtlHdr, PVQUEUEELEM pElem)
+{
+    uint16_t cPairs;
+
+    if (   !(pThis->VPCI.uGuestFeatures & VNET_F_MQ)
+        || pCtlHdr->u8Command != VNET_CTRL_CMD_MQ_VQ_PAIRS_SET
+        || pElem->nOut != 2
+        || pElem->aSegsOut[1].cb < sizeof(cPairs))
+    {
+        Log(("%s vnetControlMq: Segment layout is wrong or MQ not negotiated (u8Command=%u nOut=%u)\n",
+             INSTANCE(pThis), pCtlHdr->u8Command, pElem->nOut));
+        return VNET_ERROR;
+    }
+
+    PDMDevHlpPhysRead(pThis->VPCI.CTX_SUFF(pDevIns),
+                      pElem->aSegsOut[1].addr,
+                      &cPairs, sizeof(cPairs));
+
+    if (cPairs < 1 || cPairs > pThis->cQueuePairs)
+    {
+        Log(("%s vnetControlMq: Number of queue pairs is out of range (cPairs=%u)\n", INSTANCE(pThis), cPairs));
+        return VNET_ERROR;
+    }
+
+    LogRel(("%s: Guest enabled %u of %u queue pairs\n", INSTANCE(pThis), cPairs, pThis->cQueuePairs));
+    vnetSetActivePairs(pThis, cPairs);
+    return VNET_OK;
+}
+
 
 static DECLCALLBACK(void) vnetQueueControl(void *pvState, PVQUEUE pQueue)
 {
@@ -1587,6 +2030,9 @@ static DECLCALLBACK(void) vnetQueueControl(void *pvState, PVQUEUE pQueue)
                 case VNET_CTRL_CLS_VLAN:
                     u8Ack = vnetControlVlan(pThis, &CtlHdr, &elem);
                     break;
+                case VNET_CTRL_CLS_MQ:
+                    u8Ack = vnetControlMq(pThis, &CtlHdr, &elem);
+                    break;
                 default:
                     u8Ack = VNET_ERROR;
             }
@@ -1612,6 +2058,7 @@ static DECLCALLBACK(void) vnetQueueControl(void *pvState, PVQUEUE pQueue)
 static void vnetSaveConfig(PVNETSTATE pThis, PSSMHANDLE pSSM)
 {
     SSMR3PutMem(pSSM, &pThis->macConfigured, sizeof(pThis->macConfigured));
+    SSMR3PutU16(pSSM, pThis->cQueuePairs);
 }
 
 
@@ -1635,10 +2082,10 @@ static DECLCALLBACK(int) vnetSavePrep(PPDMDEVINS pDevIns, PSSMHANDLE pSSM)
     RT_NOREF(pSSM);
     PVNETSTATE pThis = PDMINS_2_DATA(pDevIns, PVNETSTATE);
 
-    int rc = vnetCsRxEnter(pThis, VERR_SEM_BUSY);
+    int rc = vnetCsRxEnterAll(pThis, VERR_SEM_BUSY);
     if (RT_UNLIKELY(rc != VINF_SUCCESS))
         return rc;
-    vnetCsRxLeave(pThis);
+    vnetCsRxLeaveAll(pThis);
     return VINF_SUCCESS;
 }
 
@@ -1670,6 +2117,8 @@ static DECLCALLBACK(int) vnetSaveExec(PPDMDEVINS pDevIns, PSSMHANDLE pSSM)
     AssertRCReturn(rc, rc);
     rc = SSMR3PutMem( pSSM, pThis->aVlanFilter, sizeof(pThis->aVlanFilter));
     AssertRCReturn(rc, rc);
+    rc = SSMR3PutU16( pSSM, pThis->cActivePairs);
+    AssertRCReturn(rc, rc);
     Log(("%s State has been saved\n", INSTANCE(pThis)));
     return VINF_SUCCESS;
 }
@@ -1684,10 +2133,10 @@ static DECLCALLBACK(int) vnetLoadPrep(PPDMDEVINS pDevIns, PSSMHANDLE pSSM)
     RT_NOREF(pSSM);
     PVNETSTATE pThis = PDMINS_2_DATA(pDevIns, PVNETSTATE);
 
-    int rc = vnetCsRxEnter(pThis, VERR_SEM_BUSY);
+    int rc = vnetCsRxEnterAll(pThis, VERR_SEM_BUSY);
     if (RT_UNLIKELY(rc != VINF_SUCCESS))
         return rc;
-    vnetCsRxLeave(pThis);
+    vnetCsRxLeaveAll(pThis);
     return VINF_SUCCESS;
 }
 
@@ -1707,8 +2156,17 @@ static DECLCALLBACK(int) vnetLoadExec(PPDMDEVINS pDevIns, PSSMHANDLE pSSM, uint3
     if (memcmp(&macConfigured, &pThis->macConfigured, sizeof(macConfigured))
         && (uPass == 0 || !PDMDevHlpVMTeleportedAndNotFullyResumedYet(pDevIns)))
         LogRel(("%s: The mac address differs: config=%RTmac saved=%RTmac\n", INSTANCE(pThis), &pThis->macConfigured, &macConfigured));
+    uint16_t cQueuePairs = 1;
+    if (uVersion > VIRTIO_SAVEDSTATE_VERSION_PRE_MQ)
+    {
+        rc = SSMR3GetU16(pSSM, &cQueuePairs);
+        AssertRCReturn(rc, rc);
+    }
+    if (cQueuePairs != pThis->cQueuePairs)
+        return SSMR3SetCfgError(pSSM, RT_SRC_POS, N_("The number of queue pairs differs: config=%u saved=%u"),
+                                pThis->cQueuePairs, cQueuePairs);
 
-    rc = vpciLoadExec(&pThis->VPCI, pSSM, uVersion, uPass, VNET_N_QUEUES);
+    rc = vpciLoadExec(&pThis->VPCI, pSSM, uVersion, uPass, VNET_N_QUEUES(pThis->cQueuePairs));
     AssertRCReturn(rc, rc);
 
     if (uPass == SSM_PASS_FINAL)
@@ -1748,6 +2206,16 @@ static DECLCALLBACK(int) vnetLoadExec(PPDMDEVINS pDevIns, PSSMHANDLE pSSM, uint3
             if (pThis->pDrv)
                 pThis->pDrv->pfnSetPromiscuousMode(pThis->pDrv, true);
         }
+
+        uint16_t cActivePairs = 1;
+        if (uVersion > VIRTIO_SAVEDSTATE_VERSION_PRE_MQ)
+        {
+            rc = SSMR3GetU16(pSSM, &cActivePairs);
+            AssertRCReturn(rc, rc);
+            AssertLogRelMsgReturn(cActivePairs >= 1 && cActivePairs <= pThis->cQueuePairs,
+                                  ("cActivePairs=%u\n", cActivePairs), VERR_SSM_DATA_UNIT_FORMAT_CHANGED);
+        }
+        vnetSetActivePairs(pThis, cActivePairs);
     }
 
     return rc;
@@ -1958,8 +2426,26 @@ static DECLCALLBACK(int) vnetDestruct(PPDMDEVINS pDevIns)
         pThis->hEventMoreRxDescAvail = NIL_RTSEMEVENT;
     }
 
-    // if (PDMCritSectIsInitialized(&pThis->csRx))
-    //     PDMR3CritSectDelete(&pThis->csRx);
+    for (unsigned i = 0; i < RT_ELEMENTS(pThis->aQueuePairs); i++)
+    {
+        PVNETQUEUEPAIR pPair = &pThis->aQueuePairs[i];
+        if (pPair->pTxThread)
+        {
+            int rcThread;
+            int rc = PDMR3ThreadDestroy(pPair->pTxThread, &rcThread);
+            AssertRC(rc);
+            pPair->pTxThread = NULL;
+        }
+        if (pPair->hEvtTx != NIL_RTSEMEVENT)
+        {
+            RTSemEventDestroy(pPair->hEvtTx);
+            pPair->hEvtTx = NIL_RTSEMEVENT;
+        }
+        if (PDMCritSectIsInitialized(&pPair->CritSectRx))
+            PDMR3CritSectDelete(&pPair->CritSectRx);
+        if (PDMCritSectIsInitialized(&pPair->CritSectTx))
+            PDMR3CritSectDelete(&pPair->CritSectTx);
+    }
 
     return vpciDestruct(&pThis->VPCI);
 }
@@ -1976,29 +2462,53 @@ static DECLCALLBACK(int) vnetConstruct(PPDMDEVINS pDevIns, int iInstance, PCFGMN
 
     /* Initialize the instance data suffiencently for the destructor not to blow up. */
     pThis->hEventMoreRxDescAvail = NIL_RTSEMEVENT;
+    for (unsigned i = 0; i < RT_ELEMENTS(pThis->aQueuePairs); i++)
+    {
+        pThis->aQueuePairs[i].hEvtTx = NIL_RTSEMEVENT;
+        pThis->aQueuePairs[i].iPair  = (uint16_t)i;
+    }
 
     /* Do our own locking. */
     rc = PDMDevHlpSetDeviceCritSect(pDevIns, PDMDevHlpCritSectGetNop(pDevIns));
     AssertRCReturn(rc, rc);
 
+    /*
+     * Validate configuration.
+     */
+    if (!CFGMR3AreValuesValid(pCfg, "MAC\0" "CableConnected\0" "LineSpeed\0" "LinkUpDelay\0" "QueuePairs\0" "TxThreads\0"))
+                    return PDMDEV_SET_ERROR(pDevIns, VERR_PDM_DEVINS_UNKNOWN_CFG_VALUES,
+                                            N_("Invalid configuration for VirtioNet device"));
+
+    /* The number of queue pairs determines the number of virtqueues. */
+    rc = CFGMR3QueryU16Def(pCfg, "QueuePairs", &pThis->cQueuePairs, 1);
+    if (RT_FAILURE(rc))
+        return PDMDEV_SET_ERROR(pDevIns, rc,
+                                N_("Configuration error: Failed to get the value of 'QueuePairs'"));
+    if (pThis->cQueuePairs < 1 || pThis->cQueuePairs > VNET_MAX_QUEUE_PAIRS)
+        return PDMDevHlpVMSetError(pDevIns, VERR_OUT_OF_RANGE, RT_SRC_POS,
+                                   N_("Configuration error: 'QueuePairs' must be between 1 and %u"),
+                                   VNET_MAX_QUEUE_PAIRS);
+    rc = CFGMR3QueryBoolDef(pCfg, "TxThreads", &pThis->fTxThreads, pThis->cQueuePairs > 1);
+    if (RT_FAILURE(rc))
+        return PDMDEV_SET_ERROR(pDevIns, rc,
+                                N_("Configuration error: Failed to get the value of 'TxThreads'"));
+
     /* Initialize PCI part. */
+    static const char * const s_apszRxNames[VNET_MAX_QUEUE_PAIRS] = { "RX ", "RX1", "RX2", "RX3", "RX4", "RX5", "RX6", "RX7" };
+    static const char * const s_apszTxNames[VNET_MAX_QUEUE_PAIRS] = { "TX ", "TX1", "TX2", "TX3", "TX4", "TX5", "TX6", "TX7" };
     pThis->VPCI.IBase.pfnQueryInterface    = vnetQueryInterface;
     rc = vpciConstruct(pDevIns, &pThis->VPCI, iInstance,
                        VNET_NAME_FMT, VIRTIO_NET_ID,
-                       VNET_PCI_CLASS, VNET_N_QUEUES);
-    pThis->pRxQueue  = vpciAddQueue(&pThis->VPCI, 256, vnetQueueReceive,  "RX ");
-    pThis->pTxQueue  = vpciAddQueue(&pThis->VPCI, 256, vnetQueueTransmit, "TX ");
+                       VNET_PCI_CLASS, VNET_N_QUEUES(pThis->cQueuePairs));
+    for (unsigned i = 0; i < pThis->cQueuePairs; i++)
+    {
+        pThis->aQueuePairs[i].pRxQueue = vpciAddQueue(&pThis->VPCI, 256, vnetQueueReceive,  s_apszRxNames[i]);
+        pThis->aQueuePairs[i].pTxQueue = vpciAddQueue(&pThis->VPCI, 256, vnetQueueTransmit, s_apszTxNames[i]);
+    }
     pThis->pCtlQueue = vpciAddQueue(&pThis->VPCI, 16,  vnetQueueControl,  "CTL");
 
     Log(("%s Constructing new instance\n", INSTANCE(pThis)));
 
-    /*
-     * Validate configuration.
-     */
-    if (!CFGMR3AreValuesValid(pCfg, "MAC\0" "CableConnected\0" "LineSpeed\0" "LinkUpDelay\0"))
-                    return PDMDEV_SET_ERROR(pDevIns, VERR_PDM_DEVINS_UNKNOWN_CFG_VALUES,
-                                            N_("Invalid configuration for VirtioNet device"));
-
     /* Get config params */
     rc = CFGMR3QueryBytes(pCfg, "MAC", pThis->macConfigured.au8,
                           sizeof(pThis->macConfigured));
@@ -2028,6 +2538,17 @@ static DECLCALLBACK(int) vnetConstruct(PPDMDEVINS pDevIns, int iInstance, PCFGMN
     /* Initialize PCI config space */
     memcpy(pThis->config.mac.au8, pThis->macConfigured.au8, sizeof(pThis->config.mac.au8));
     pThis->config.uStatus = 0;
+    pThis->config.uMaxVirtqueuePairs = pThis->cQueuePairs;
+
+    /* The default key from the Microsoft RSS specification, which is what
+       guests expect when they don't program their own. */
+    static const uint8_t s_abDefaultRssKey[VNET_RSS_KEY_SIZE] =
+    {
+        0x6d, 0x5a, 0x56, 0xda, 0x25, 0x5b, 0x0e, 0xc2, 0x41, 0x67, 0x25, 0x3d, 0x43, 0xa3, 0x8f, 0xb0,
+        0xd0, 0xca, 0x2b, 0xcb, 0xae, 0x7b, 0x30, 0xb4, 0x77, 0xcb, 0x2d, 0xa3, 0x80, 0x30, 0xf2, 0x0c,
+        0x6a, 0x42, 0xb7, 0x3b, 0xbe, 0xac, 0x01, 0xfa
+    };
+    memcpy(pThis->abRssKey, s_abDefaultRssKey, sizeof(pThis->abRssKey));
 
     /* Initialize state structure */
     pThis->u32PktNo     = 1;
@@ -2042,12 +2563,16 @@ static DECLCALLBACK(int) vnetConstruct(PPDMDEVINS pDevIns, int iInstance, PCFGMN
     pThis->INetworkConfig.pfnGetLinkState   = vnetGetLinkState;
     pThis->INetworkConfig.pfnSetLinkState   = vnetSetLinkState;
 
-    /* Initialize critical section. */
-    // char szTmp[sizeof(pThis->VPCI.szInstance) + 2];
-    // RTStrPrintf(szTmp, sizeof(szTmp), "%sRX", pThis->VPCI.szInstance);
-    // rc = PDMDevHlpCritSectInit(pDevIns, &pThis->csRx, szTmp);
-    // if (RT_FAILURE(rc))
-    //     return rc;
+    /* Initialize the per queue pair critical sections. */
+    for (unsigned i = 0; i < pThis->cQueuePairs; i++)
+    {
+        rc = PDMDevHlpCritSectInit(pDevIns, &pThis->aQueuePairs[i].CritSectRx, RT_SRC_POS, "%sRX%u", INSTANCE(pThis), i);
+        if (RT_FAILURE(rc))
+            return rc;
+        rc = PDMDevHlpCritSectInit(pDevIns, &pThis->aQueuePairs[i].CritSectTx, RT_SRC_POS, "%sTX%u", INSTANCE(pThis), i);
+        if (RT_FAILURE(rc))
+            return rc;
+    }
 
     /* Map our ports to IO space. */
     rc = PDMDevHlpPCIIORegionRegister(pDevIns, 0,
@@ -2075,7 +2600,7 @@ static DECLCALLBACK(int) vnetConstruct(PPDMDEVINS pDevIns, int iInstance, PCFGMN
 
     /* Create Link Up Timer */
     rc = PDMDevHlpTMTimerCreate(pDevIns, TMCLOCK_VIRTUAL, vnetLinkUpTimer, pThis,
-                                TMTIMER_FLAGS_NO_CRIT_SECT,
+                                TMTIMER_FLAGS_NO_CRIT_SECT | TMTIMER_FLAGS_NO_EMT,
                                 "VirtioNet Link Up Timer", &pThis->pLinkUpTimer);
     if (RT_FAILURE(rc))
         return rc;
@@ -2119,6 +2644,27 @@ static DECLCALLBACK(int) vnetConstruct(PPDMDEVINS pDevIns, int iInstance, PCFGMN
     if (RT_FAILURE(rc))
         return rc;
 
+    if (pThis->fTxThreads)
+    {
+        for (unsigned i = 0; i < pThis->cQueuePairs; i++)
+        {
+            PVNETQUEUEPAIR pPair = &pThis->aQueuePairs[i];
+            rc = RTSemEventCreate(&pPair->hEvtTx);
+            if (RT_FAILURE(rc))
+                return rc;
+
+            char szName[16];
+            RTStrPrintf(szName, sizeof(szName), "%sTx%u", INSTANCE(pThis), i);
+            rc = PDMDevHlpThreadCreate(pDevIns, &pPair->pTxThread, pPair, vnetTxThread, vnetTxThreadWakeUp, 0,
+                                       RTTHREADTYPE_IO, szName);
+            if (RT_FAILURE(rc))
+                return PDMDevHlpVMSetError(pDevIns, rc, RT_SRC_POS,
+                                           N_("VirtioNet: Failed to create TX worker thread %s"), szName);
+        }
+    }
+    LogRel(("%s: %u queue pair(s), TX %s\n", INSTANCE(pThis), pThis->cQueuePairs,
+            pThis->fTxThreads ? "worker threads" : "on EMT"));
+
     rc = vnetIoCb_Reset(pThis);
     AssertRC(rc);
 
@@ -2139,6 +2685,17 @@ static DECLCALLBACK(int) vnetConstruct(PPDMDEVINS pDevIns, int iInstance, PCFGMN
     PDMDevHlpSTAMRegisterF(pDevIns, &pThis->StatTransmit,           STAMTYPE_PROFILE, STAMVISIBILITY_ALWAYS, STAMUNIT_TICKS_PER_CALL, "Profiling transmits in HC",          "/Devices/VNet%d/Transmit/Total", iInstance);
     PDMDevHlpSTAMRegisterF(pDevIns, &pThis->StatTransmitSend,       STAMTYPE_PROFILE, STAMVISIBILITY_ALWAYS, STAMUNIT_TICKS_PER_CALL, "Profiling send transmit in HC",      "/Devices/VNet%d/Transmit/Send", iInstance);
 #endif /* VBOX_WITH_STATISTICS */
+    for (unsigned i = 0; i < pThis->cQueuePairs; i++)
+    {
+        PVNETQUEUEPAIR pPair = &pThis->aQueuePairs[i];
+        PDMDevHlpSTAMRegisterF(pDevIns, &pPair->StatReceivePackets,   STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS, STAMUNIT_COUNT,          "Number of received packets",         "/Devices/VNet%d/Queue%u/ReceivePackets", iInstance, i);
+        PDMDevHlpSTAMRegisterF(pDevIns, &pPair->StatReceiveBytes,     STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS, STAMUNIT_BYTES,          "Amount of data received",            "/Devices/VNet%d/Queue%u/ReceiveBytes", iInstance, i);
+        PDMDevHlpSTAMRegisterF(pDevIns, &pPair->StatReceiveQueueFull, STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS, STAMUNIT_OCCURENCES,     "Frames steered to a full RX queue",  "/Devices/VNet%d/Queue%u/ReceiveQueueFull", iInstance, i);
+        PDMDevHlpSTAMRegisterF(pDevIns, &pPair->StatTransmitPackets,  STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS, STAMUNIT_COUNT,          "Number of sent packets",             "/Devices/VNet%d/Queue%u/TransmitPackets", iInstance, i);
+        PDMDevHlpSTAMRegisterF(pDevIns, &pPair->StatTransmitBytes,    STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS, STAMUNIT_BYTES,          "Amount of data transmitted",         "/Devices/VNet%d/Queue%u/TransmitBytes", iInstance, i);
+        PDMDevHlpSTAMRegisterF(pDevIns, &pPair->StatTransmitWakeups,  STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS, STAMUNIT_OCCURENCES,     "Number of TX worker wakeups",        "/Devices/VNet%d/Queue%u/TransmitWakeups", iInstance, i);
+        PDMDevHlpSTAMRegisterF(pDevIns, &pPair->StatTransmitRetries,  STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS, STAMUNIT_OCCURENCES,     "TX worker retries on a busy driver", "/Devices/VNet%d/Queue%u/TransmitRetries", iInstance, i);
+    }
 
     return VINF_SUCCESS;
 }
@@ -154,6 +154,25 @@ typedef struct DRVINTNET
     /** The network name. */
     char                            szNetwork[INTNET_MAX_NETWORK_NAME];
 
+    /** @name Transmit batching.
+     * Frames committed by pfnSendBuf are left in the send ring and pushed thru
+     * the switch with a single IntNetR0IfSend call when one of the thresholds
+     * is reached, or at the latest by pfnEndXmit.  Owned by the XmitLock.
+     * @{ */
+    /** The RTTimeNanoTS of the first frame in the current batch. */
+    uint64_t                        nsXmitBatchStart;
+    /** Max time to hold back frames in nanoseconds (config). */
+    uint64_t                        cNsXmitBatchMax;
+    /** Number of frames committed since the last flush. */
+    uint32_t                        cXmitBatchFrames;
+    /** Number of bytes committed since the last flush. */
+    uint32_t                        cbXmitBatch;
+    /** Max frames per batch, 1 disables batching (config). */
+    uint32_t                        cXmitBatchMaxFrames;
+    /** Max bytes per batch (config). */
+    uint32_t                        cbXmitBatchMax;
+    /** @} */
+
     /** Number of GSO packets sent. */
     STAMCOUNTER                     StatSentGso;
     /** Number of GSO packets received. */
@@ -168,6 +187,18 @@ typedef struct DRVINTNET
     STAMCOUNTER                     StatXmitWakeupR3;
     /** The times the xmit thread has been told to process the ring. */
     STAMCOUNTER                     StatXmitProcessRing;
+    /** Batches flushed because of the frame count threshold. */
+    STAMCOUNTER                     StatXmitFlushFrames;
+    /** Batches flushed because of the byte count threshold. */
+    STAMCOUNTER                     StatXmitFlushBytes;
+    /** Batches flushed because of the time threshold. */
+    STAMCOUNTER                     StatXmitFlushTime;
+    /** Batches flushed by pfnEndXmit. */
+    STAMCOUNTER                     StatXmitFlushEnd;
+    /** Frames pushed thru the switch per IntNetR0IfSend call. */
+    STAMPROFILE                     StatXmitFramesPerCall;
+    /** Frames passed up per receive thread wakeup. */
+    STAMPROFILE                     StatRecvFramesPerWakeup;
 #ifdef VBOX_WITH_STATISTICS
     /** Profiling packet transmit runs. */
     STAMPROFILE                     StatTransmit;
@@ -293,6 +324,13 @@ DECLINLINE(int) drvIntNetProcessXmit(PDRVINTNET pThis)
 {
     Assert(PDMCritSectIsOwner(&pThis->XmitLock));
 
+    if (pThis->cXmitBatchFrames)
+    {
+        STAM_REL_PROFILE_ADD_PERIOD(&pThis->StatXmitFramesPerCall, pThis->cXmitBatchFrames);
+        pThis->cXmitBatchFrames = 0;
+        pThis->cbXmitBatch      = 0;
+    }
+
 #ifdef IN_RING3
     INTNETIFSENDREQ SendReq;
     SendReq.Hdr.u32Magic = SUPVMMR0REQHDR_MAGIC;
@@ -313,6 +351,43 @@ DECLINLINE(int) drvIntNetProcessXmit(PDRVINTNET pThis)
 }
 
 
+/**
+ * Helper for adding a committed frame to the current transmit batch and
+ * flushing it if any of the thresholds has been reached.
+ *
+ * The caller MUST own the xmit lock.
+ *
+ * @returns Status code from drvIntNetProcessXmit, VINF_SUCCESS if deferred.
+ * @param   pThis               The instance data.
+ * @param   cbFrame             The size of the frame.
+ */
+DECLINLINE(int) drvIntNetQueueXmit(PDRVINTNET pThis, uint32_t cbFrame)
+{
+    Assert(PDMCritSectIsOwner(&pThis->XmitLock));
+
+    pThis->cbXmitBatch += cbFrame;
+    if (++pThis->cXmitBatchFrames >= pThis->cXmitBatchMaxFrames)
+    {
+        STAM_REL_COUNTER_INC(&pThis->StatXmitFlushFrames);
+        return drvIntNetProcessXmit(pThis);
+    }
+    if (pThis->cbXmitBatch >= pThis->cbXmitBatchMax)
+    {
+        STAM_REL_COUNTER_INC(&pThis->StatXmitFlushBytes);
+        return drvIntNetProcessXmit(pThis);
+    }
+
+    uint64_t const nsNow = RTTimeNanoTS();
+    if (pThis->cXmitBatchFrames == 1)
+        pThis->nsXmitBatchStart = nsNow;
+    else if (nsNow - pThis->nsXmitBatchStart >= pThis->cNsXmitBatchMax)
+    {
+        STAM_REL_COUNTER_INC(&pThis->StatXmitFlushTime);
+        return drvIntNetProcessXmit(pThis);
+    }
+    return VINF_SUCCESS;
+}
+
 
 /**
  * @interface_method_impl{PDMINETWORKUP,pfnBeginXmit}
@@ -388,7 +463,7 @@ PDMBOTHCBDECL(int) drvIntNetUp_AllocBuf(PPDMINETWORKUP pInterface, size_t cbMin,
      *
      * In ring-3 we may have to process the xmit ring before there is
      * sufficient buffer space since we might have stacked up a few frames to the
-     * trunk while in ring-0.  (There is not point of doing this in ring-0.)
+     * trunk while in ring-0.  In ring-0 we only flush our own pending batch.
      */
     PINTNETHDR pHdr = NULL;             /* gcc silliness */
     if (pGso)
@@ -400,6 +475,10 @@ PDMBOTHCBDECL(int) drvIntNetUp_AllocBuf(PPDMINETWORKUP pInterface, size_t cbMin,
 #ifdef IN_RING3
     if (    RT_FAILURE(rc)
         &&  pThis->CTX_SUFF(pBuf)->cbSend >= cbMin * 2 + sizeof(INTNETHDR))
+#else
+    if (    RT_FAILURE(rc)
+        &&  pThis->cXmitBatchFrames > 0)
+#endif
     {
         drvIntNetProcessXmit(pThis);
         if (pGso)
@@ -409,7 +488,6 @@ PDMBOTHCBDECL(int) drvIntNetUp_AllocBuf(PPDMINETWORKUP pInterface, size_t cbMin,
             rc = IntNetRingAllocateFrame(&pThis->CTX_SUFF(pBuf)->Send, (uint32_t)cbMin,
                                          &pHdr, &pSgBuf->aSegs[0].pvSeg);
     }
-#endif
     if (RT_SUCCESS(rc))
     {
         /*
@@ -503,11 +581,11 @@ PDMBOTHCBDECL(int) drvIntNetUp_SendBuf(PPDMINETWORKUP pInterface, PPDMSCATTERGAT
     PDMDrvHlpFTSetCheckpoint(pThis->CTX_SUFF(pDrvIns), FTMCHECKPOINTTYPE_NETWORK);
 
     /*
-     * Commit the frame and push it thru the switch.
+     * Commit the frame and push it thru the switch, unless we're batching.
      */
     PINTNETHDR pHdr = (PINTNETHDR)pSgBuf->pvAllocator;
     IntNetRingCommitFrameEx(&pThis->CTX_SUFF(pBuf)->Send, pHdr, pSgBuf->cbUsed);
-    int rc = drvIntNetProcessXmit(pThis);
+    int rc = drvIntNetQueueXmit(pThis, (uint32_t)pSgBuf->cbUsed);
     STAM_PROFILE_STOP(&pThis->StatTransmit, a);
 
     /*
@@ -529,6 +607,14 @@ PDMBOTHCBDECL(int) drvIntNetUp_SendBuf(PPDMINETWORKUP pInterface, PPDMSCATTERGAT
 PDMBOTHCBDECL(void) drvIntNetUp_EndXmit(PPDMINETWORKUP pInterface)
 {
     PDRVINTNET pThis = RT_FROM_MEMBER(pInterface, DRVINTNET, CTX_SUFF(INetworkUp));
+
+    /* Push whatever is left of the batch thru the switch. */
+    if (pThis->cXmitBatchFrames)
+    {
+        STAM_REL_COUNTER_INC(&pThis->StatXmitFlushEnd);
+        drvIntNetProcessXmit(pThis);
+    }
+
     ASMAtomicUoWriteBool(&pThis->fXmitOnXmitThread, false);
     PDMCritSectLeave(&pThis->XmitLock);
 }
@@ -687,8 +773,10 @@ static int drvR3IntNetRecvRun(PDRVINTNET pThis)
      * The running loop - processing received data and waiting for more to arrive.
      */
     STAM_PROFILE_ADV_START(&pThis->StatReceive, a);
-    PINTNETBUF      pBuf     = pThis->CTX_SUFF(pBuf);
-    PINTNETRINGBUF  pRingBuf = &pBuf->Recv;
+    PINTNETBUF      pBuf          = pThis->CTX_SUFF(pBuf);
+    PINTNETRINGBUF  pRingBuf      = &pBuf->Recv;
+    uint32_t        cFramesWakeup = 0;
+    bool            fPolled       = false;
     for (;;)
     {
         /*
@@ -739,6 +827,7 @@ static int drvR3IntNetRecvRun(PDRVINTNET pThis)
 #endif
                         rc = pThis->pIAboveNet->pfnReceive(pThis->pIAboveNet, IntNetHdrGetFramePtr(pHdr, pBuf), cbFrame);
                         AssertRC(rc);
+                        cFramesWakeup++;
 
                         /* skip to the next frame. */
                         IntNetRingSkipFrame(pRingBuf);
@@ -749,6 +838,7 @@ static int drvR3IntNetRecvRun(PDRVINTNET pThis)
                          * Generic segment offload frame (INTNETHDR_TYPE_GSO).
                          */
                         STAM_COUNTER_INC(&pThis->StatReceivedGso);
+                        cFramesWakeup++;
                         PCPDMNETWORKGSO pGso = IntNetHdrGetGsoContext(pHdr, pBuf);
                         if (PDMNetGsoIsValid(pGso, cbFrame, cbFrame - sizeof(PDMNETWORKGSO)))
                         {
@@ -842,6 +932,22 @@ static int drvR3IntNetRecvRun(PDRVINTNET pThis)
             }
         } /* while more received data */
 
+        /*
+         * If we were busy, give the senders a chance to queue more frames before
+         * paying for a ring-0 wait call, so we pass more frames up per wakeup.
+         */
+        if (cFramesWakeup && !fPolled)
+        {
+            fPolled = true;
+            RTThreadYield();
+            if (IntNetRingHasMoreToRead(pRingBuf))
+                continue;
+        }
+        if (cFramesWakeup)
+            STAM_REL_PROFILE_ADD_PERIOD(&pThis->StatRecvFramesPerWakeup, cFramesWakeup);
+        cFramesWakeup = 0;
+        fPolled       = false;
+
         /*
          * Wait for data, checking the state before we block.
          */
@@ -1243,6 +1349,12 @@ static DECLCALLBACK(void) drvR3IntNetDestruct(PPDMDRVINS pDrvIns)
         PDMDrvHlpSTAMDeregister(pDrvIns, &pThis->StatXmitWakeupR0);
         PDMDrvHlpSTAMDeregister(pDrvIns, &pThis->StatXmitWakeupR3);
         PDMDrvHlpSTAMDeregister(pDrvIns, &pThis->StatXmitProcessRing);
+        PDMDrvHlpSTAMDeregister(pDrvIns, &pThis->StatXmitFlushFrames);
+        PDMDrvHlpSTAMDeregister(pDrvIns, &pThis->StatXmitFlushBytes);
+        PDMDrvHlpSTAMDeregister(pDrvIns, &pThis->StatXmitFlushTime);
+        PDMDrvHlpSTAMDeregister(pDrvIns, &pThis->StatXmitFlushEnd);
+        PDMDrvHlpSTAMDeregister(pDrvIns, &pThis->StatXmitFramesPerCall);
+        PDMDrvHlpSTAMDeregister(pDrvIns, &pThis->StatRecvFramesPerWakeup);
     }
 
     /*
@@ -1411,7 +1523,10 @@ static DECLCALLBACK(int) drvR3IntNetConstruct(PPDMDRVINS pDrvIns, PCFGMNODE pCfg
                                   "|TrunkPolicyWire"
                                   "|IsService"
                                   "|IgnoreConnectFailure"
-                                  "|Workaround1",
+                                  "|Workaround1"
+                                  "|XmitBatchFrames"
+                                  "|XmitBatchBytes"
+                                  "|XmitBatchMaxLatencyUs",
                                   "");
 
     /*
@@ -1657,6 +1772,38 @@ static DECLCALLBACK(int) drvR3IntNetConstruct(PPDMDRVINS pDrvIns, PCFGMNODE pCfg
     if (OpenReq.cbSend < VBOX_MAX_GSO_SIZE * 3)
         LogRel(("DrvIntNet: Warning! SendBufferSize=%u, Recommended minimum size %u butes.\n", OpenReq.cbSend, VBOX_MAX_GSO_SIZE * 4));
 
+    /** @cfgm{XmitBatchFrames, uint32_t, 32}
+     * The max number of frames to commit to the send buffer before pushing them
+     * thru the switch in one go.  1 sends every frame right away.  The batch is
+     * always flushed when the device is done transmitting (pfnEndXmit).
+     */
+    rc = CFGMR3QueryU32Def(pCfg, "XmitBatchFrames", &pThis->cXmitBatchMaxFrames, 32);
+    if (RT_FAILURE(rc))
+        return PDMDRV_SET_ERROR(pDrvIns, rc,
+                                N_("Configuration error: Failed to get the \"XmitBatchFrames\" value"));
+    if (!pThis->cXmitBatchMaxFrames)
+        pThis->cXmitBatchMaxFrames = 1;
+
+    /** @cfgm{XmitBatchBytes, uint32_t, SendBufferSize / 4}
+     * The max number of bytes to batch before pushing them thru the switch.
+     */
+    rc = CFGMR3QueryU32Def(pCfg, "XmitBatchBytes", &pThis->cbXmitBatchMax, OpenReq.cbSend / 4);
+    if (RT_FAILURE(rc))
+        return PDMDRV_SET_ERROR(pDrvIns, rc,
+                                N_("Configuration error: Failed to get the \"XmitBatchBytes\" value"));
+    if (pThis->cbXmitBatchMax > OpenReq.cbSend / 2)
+        pThis->cbXmitBatchMax = OpenReq.cbSend / 2;
+
+    /** @cfgm{XmitBatchMaxLatencyUs, uint32_t, 50}
+     * The max time in microseconds a frame may be held back while batching.
+     */
+    uint32_t cUsXmitBatchMax;
+    rc = CFGMR3QueryU32Def(pCfg, "XmitBatchMaxLatencyUs", &cUsXmitBatchMax, 50);
+    if (RT_FAILURE(rc))
+        return PDMDRV_SET_ERROR(pDrvIns, rc,
+                                N_("Configuration error: Failed to get the \"XmitBatchMaxLatencyUs\" value"));
+    pThis->cNsXmitBatchMax = cUsXmitBatchMax * UINT64_C(1000);
+
     /** @cfgm{IsService, boolean, true}
      * This alterns the way the thread is suspended and resumed. When it's being used by
      * a service such as LWIP/iSCSI it shouldn't suspend immediately like for a NIC.
@@ -1820,6 +1967,12 @@ static DECLCALLBACK(int) drvR3IntNetConstruct(PPDMDRVINS pDrvIns, PCFGMNODE pCfg
     PDMDrvHlpSTAMRegCounter(pDrvIns, &pThis->StatXmitWakeupR0,           "XmitWakeup-R0",        "Xmit thread wakeups from ring-0.");
     PDMDrvHlpSTAMRegCounter(pDrvIns, &pThis->StatXmitWakeupR3,           "XmitWakeup-R3",        "Xmit thread wakeups from ring-3.");
     PDMDrvHlpSTAMRegCounter(pDrvIns, &pThis->StatXmitProcessRing,        "XmitProcessRing",      "Time xmit thread was told to process the ring.");
+    PDMDrvHlpSTAMRegCounter(pDrvIns, &pThis->StatXmitFlushFrames,        "XmitFlush-Frames",     "Batches flushed because of the frame count threshold.");
+    PDMDrvHlpSTAMRegCounter(pDrvIns, &pThis->StatXmitFlushBytes,         "XmitFlush-Bytes",      "Batches flushed because of the byte count threshold.");
+    PDMDrvHlpSTAMRegCounter(pDrvIns, &pThis->StatXmitFlushTime,          "XmitFlush-Time",       "Batches flushed because of the time threshold.");
+    PDMDrvHlpSTAMRegCounter(pDrvIns, &pThis->StatXmitFlushEnd,           "XmitFlush-End",        "Batches flushed at the end of a transmit run.");
+    PDMDrvHlpSTAMRegProfileEx(pDrvIns, &pThis->StatXmitFramesPerCall,    "XmitFramesPerCall",    STAMUNIT_OCCURENCES, "Frames pushed thru the switch per send call.");
+    PDMDrvHlpSTAMRegProfileEx(pDrvIns, &pThis->StatRecvFramesPerWakeup,  "RecvFramesPerWakeup",  STAMUNIT_OCCURENCES, "Frames passed up per receive thread wakeup.");
 
     /*
      * Create the async I/O threads.
@@ -33,14 +33,18 @@ extern "C" {
 #include <VBox/vmm/pdmnetifs.h>
 #include <VBox/vmm/pdmnetinline.h>
 
+#include <iprt/asm.h>
 #include <iprt/assert.h>
+#include <iprt/avl.h>
 #include <iprt/critsect.h>
 #include <iprt/cidr.h>
 #include <iprt/file.h>
 #include <iprt/mem.h>
+#include <iprt/net.h>
 #include <iprt/pipe.h>
 #include <iprt/string.h>
 #include <iprt/stream.h>
+#include <iprt/time.h>
 #include <iprt/uuid.h>
 
 #include "VBoxDD.h"
@@ -71,6 +75,25 @@ extern "C" {
 
 #define DRVNAT_MAXFRAMESIZE (16 * 1024)
 
+/** Extra bytes allocated behind GSO buffers so slirp_ext_m_wrap can keep its
+ * reference counter there. */
+#define DRVNAT_GSO_TAIL     16
+
+/** The max number of NAT engine instances (shards) per driver instance. */
+#define DRVNAT_MAX_SHARDS   16
+
+/** How long a port-forwarded UDP flow may be idle before it is forgotten (ms).
+ * Slirp expires its UDP sockets a bit earlier.  TCP flows are forgotten when
+ * slirp closes their socket, see slirp_fwd_tcp_closed. */
+#define DRVNAT_FWD_FLOW_UDP_IDLE_MS     (5 * RT_MS_1MIN)
+/** The interval of the sweeps for expired port-forwarded flows (ms). */
+#define DRVNAT_FWD_FLOW_SWEEP_MS        (10 * RT_MS_1SEC)
+/** The max number of flows removed by one sweep. */
+#define DRVNAT_FWD_FLOW_SWEEP_MAX       32
+/** The number of fragmented datagrams whose shard is remembered, a power of
+ * two. */
+#define DRVNAT_PINNED_FRAGS             8
+
 /**
  * @todo: This is a bad hack to prevent freezing the guest during high network
  *        activity. Windows host only. This needs to be fixed properly.
@@ -135,6 +158,79 @@ do                                                      \
 /*********************************************************************************************************************************
 *   Structures and Typedefs                                                                                                      *
 *********************************************************************************************************************************/
+/** Pointer to the NAT driver instance data. */
+typedef struct DRVNAT *PDRVNAT;
+
+/**
+ * A NAT engine instance with the thread polling it.
+ *
+ * TCP and UDP flows of the guest are spread over the shards by a hash of
+ * their addresses, ports and protocol, so every shard owns a disjoint set of
+ * sockets.
+ * The first shard also gets everything that can't be attributed to a flow
+ * (ARP, DHCP, ICMP) and owns the port-forwarding rules.
+ */
+typedef struct DRVNATSHARD
+{
+    /** Back pointer to the driver instance. */
+    PDRVNAT                 pThis;
+    /** NAT state of this shard. */
+    PNATState               pNATState;
+    /** Polling thread. */
+    PPDMTHREAD              pSlirpThread;
+    /** Queue for NAT-thread-external events. */
+    RTREQQUEUE              hSlirpReqQueue;
+    /** The shard index. */
+    uint32_t                iShard;
+    /** The link state last applied to the engine. */
+    PDMNETWORKLINKSTATE     enmLinkState;
+    /** The guest IP last passed to slirp_arp_learn (network order). */
+    uint32_t                uLearnedIp;
+    /** The guest MAC last passed to slirp_arp_learn. */
+    RTMAC                   LearnedMac;
+#ifndef RT_OS_WINDOWS
+    /** The write end of the control pipe. */
+    RTPIPE                  hPipeWrite;
+    /** The read end of the control pipe. */
+    RTPIPE                  hPipeRead;
+#else
+    /** for external notification */
+    HANDLE                  hWakeupEvent;
+#endif
+} DRVNATSHARD;
+/** Pointer to a NAT engine shard. */
+typedef DRVNATSHARD *PDRVNATSHARD;
+
+/**
+ * A flow to a port-forwarded guest port owned by the first shard.
+ */
+typedef struct DRVNATFWDFLOW
+{
+    /** AVL node, the key is made by drvNATFwdFlowKey. */
+    AVLRU64NODECORE         Core;
+    /** When a frame of the flow was last seen (RTTimeMilliTS). */
+    uint64_t                msLastSeen;
+} DRVNATFWDFLOW;
+/** Pointer to a port-forwarded flow. */
+typedef DRVNATFWDFLOW *PDRVNATFWDFLOW;
+
+/**
+ * A fragmented datagram and the shard its first fragment went to.
+ */
+typedef struct DRVNATPINNEDFRAG
+{
+    /** The source address (network order). */
+    uint32_t                uSrc;
+    /** The destination address (network order), zero if the entry is unused. */
+    uint32_t                uDst;
+    /** The IP ID (network order). */
+    uint16_t                uId;
+    /** The IP protocol. */
+    uint8_t                 uProto;
+    /** The shard the first fragment went to. */
+    uint8_t                 iShard;
+} DRVNATPINNEDFRAG;
+
 /**
  * NAT network transport driver instance data.
  *
@@ -154,34 +250,26 @@ typedef struct DRVNAT
     PPDMDRVINS              pDrvIns;
     /** Link state */
     PDMNETWORKLINKSTATE     enmLinkState;
-    /** NAT state for this instance. */
-    PNATState               pNATState;
     /** TFTP directory prefix. */
     char                   *pszTFTPPrefix;
     /** Boot file name to provide in the DHCP server response. */
     char                   *pszBootFile;
     /** tftp server name to provide in the DHCP server response. */
     char                   *pszNextServer;
-    /** Polling thread. */
-    PPDMTHREAD              pSlirpThread;
-    /** Queue for NAT-thread-external events. */
-    RTREQQUEUE              hSlirpReqQueue;
     /** The guest IP for port-forwarding. */
     uint32_t                GuestIP;
     /** Link state set when the VM is suspended. */
     PDMNETWORKLINKSTATE     enmLinkStateWant;
-
-#ifndef RT_OS_WINDOWS
-    /** The write end of the control pipe. */
-    RTPIPE                  hPipeWrite;
-    /** The read end of the control pipe. */
-    RTPIPE                  hPipeRead;
-# if HC_ARCH_BITS == 32
+    /** Number of active shards. */
+    uint32_t                cShards;
+    /** The NAT engine instances. */
+    DRVNATSHARD             aShards[DRVNAT_MAX_SHARDS];
+    /** Bitmaps of guest ports that are port-forwarding targets, TCP followed
+     * by UDP.  Frames to these ports are checked for flows to remember in
+     * apFwdFlows.  Bits are never cleared, another rule may use the port. */
+    uint32_t               *pbmFwdPorts;
+#if HC_ARCH_BITS == 32
     uint32_t                u32Padding;
-# endif
-#else
-    /** for external notification */
-    HANDLE                  hWakeupEvent;
 #endif
 
 #define DRV_PROFILE_COUNTER(name, dsc)     STAMPROFILE Stat ## name
@@ -210,6 +298,18 @@ typedef struct DRVNAT
     /** Transmit lock taken by BeginXmit and released by EndXmit. */
     RTCRITSECT              XmitLock;
 
+    /** Protects apFwdFlows and msFwdFlowSweep. */
+    RTCRITSECT              FwdFlowLock;
+    /** Flows to port-forwarded guest ports the first shard delivered frames
+     * for, TCP and UDP (DRVNATFWDFLOW).  Frames of these flows go to the first
+     * shard, which owns their sockets. */
+    AVLRU64TREE             apFwdFlows[2];
+    /** When apFwdFlows was last swept for expired flows (RTTimeMilliTS). */
+    uint64_t                msFwdFlowSweep;
+    /** Fragmented datagrams and the shards their first fragments went to,
+     * indexed by the IP ID.  Protected by XmitLock. */
+    DRVNATPINNEDFRAG        aPinnedFrags[DRVNAT_PINNED_FRAGS];
+
     /** Request queue for the async host resolver. */
     RTREQQUEUE               hHostResQueue;
     /** Async host resolver thread. */
@@ -221,16 +321,14 @@ typedef struct DRVNAT
 #endif
 } DRVNAT;
 AssertCompileMemberAlignment(DRVNAT, StatNATRecvWakeups, 8);
-/** Pointer to the NAT driver instance data. */
-typedef DRVNAT *PDRVNAT;
 
 
 /*********************************************************************************************************************************
 *   Internal Functions                                                                                                           *
 *********************************************************************************************************************************/
-static void drvNATNotifyNATThread(PDRVNAT pThis, const char *pszWho);
+static void drvNATNotifyNATThread(PDRVNATSHARD pShard, const char *pszWho);
 DECLINLINE(void) drvNATUpdateDNS(PDRVNAT pThis, bool fFlapLink);
-static DECLCALLBACK(int) drvNATReinitializeHostNameResolving(PDRVNAT pThis);
+static DECLCALLBACK(int) drvNATReinitializeHostNameResolving(PDRVNATSHARD pShard);
 
 
 /**
@@ -305,8 +403,219 @@ static DECLCALLBACK(int) drvNATUrgRecvWakeup(PPDMDRVINS pDrvIns, PPDMTHREAD pThr
 }
 
 
-static DECLCALLBACK(void) drvNATUrgRecvWorker(PDRVNAT pThis, uint8_t *pu8Buf, int cb, struct mbuf *m)
+/**
+ * Locates the IPv4 header and the ports of a TCP or UDP frame.
+ *
+ * @returns Pointer to the IPv4 header, NULL if not TCP or UDP over IPv4.
+ * @param   pbFrame             The Ethernet frame.
+ * @param   cbFrame             The size of the frame.
+ * @param   piProto             Where to return the protocol, 0 for TCP and 1
+ *                              for UDP.
+ * @param   ppau16Ports         Where to return the source and destination
+ *                              ports (network order).  NULL if the frame is a
+ *                              fragment other than the first or too short.
+ */
+static PCRTNETIPV4 drvNATParseFlowFrame(uint8_t const *pbFrame, size_t cbFrame, unsigned *piProto,
+                                        uint16_t const **ppau16Ports)
+{
+    if (   cbFrame < sizeof(RTNETETHERHDR) + RTNETIPV4_MIN_LEN
+        || ((PCRTNETETHERHDR)pbFrame)->EtherType != RT_H2BE_U16_C(RTNET_ETHERTYPE_IPV4))
+        return NULL;
+    PCRTNETIPV4 pIpHdr = (PCRTNETIPV4)(pbFrame + sizeof(RTNETETHERHDR));
+    size_t const cbIpHdr = pIpHdr->ip_hl * 4;
+    if (   pIpHdr->ip_v != 4
+        || cbIpHdr < RTNETIPV4_MIN_LEN
+        || cbFrame < sizeof(RTNETETHERHDR) + cbIpHdr)
+        return NULL;
+
+    if (pIpHdr->ip_p == RTNETIPV4_PROT_TCP)
+        *piProto = 0;
+    else if (pIpHdr->ip_p == RTNETIPV4_PROT_UDP)
+        *piProto = 1;
+    else
+        return NULL;
+
+    if (   !(pIpHdr->ip_off & RT_H2BE_U16_C(UINT16_C(0x1fff)))
+        && cbFrame >= sizeof(RTNETETHERHDR) + cbIpHdr + 4)
+        *ppau16Ports = (uint16_t const *)((uint8_t const *)pIpHdr + cbIpHdr);
+    else
+        *ppau16Ports = NULL;
+    return pIpHdr;
+}
+
+/**
+ * Gets the TCP flags of a frame parsed by drvNATParseFlowFrame.
+ *
+ * @returns The TCP flags, 0 if not TCP or too short.
+ * @param   pIpHdr              The IPv4 header.
+ * @param   iProto              The protocol index.
+ * @param   pau16Ports          The ports, NULL if not available.
+ * @param   pbFrame             The Ethernet frame.
+ * @param   cbFrame             The size of the frame.
+ */
+DECLINLINE(uint8_t) drvNATTcpFlags(PCRTNETIPV4 pIpHdr, unsigned iProto, uint16_t const *pau16Ports,
+                                   uint8_t const *pbFrame, size_t cbFrame)
+{
+    if (   iProto != 0
+        || !pau16Ports
+        || cbFrame < sizeof(RTNETETHERHDR) + pIpHdr->ip_hl * 4 + RTNETTCP_MIN_LEN)
+        return 0;
+    return ((PCRTNETTCP)pau16Ports)->th_flags;
+}
+
+/**
+ * Makes the key of a port-forwarded flow.
+ *
+ * @returns The key.
+ * @param   uRemoteIp           The remote address (network order).
+ * @param   uRemotePort         The remote port.
+ * @param   uGuestPort          The guest port.
+ */
+DECLINLINE(uint64_t) drvNATFwdFlowKey(uint32_t uRemoteIp, uint16_t uRemotePort, uint16_t uGuestPort)
+{
+    return (uint64_t)uRemoteIp << 32 | (uint32_t)uRemotePort << 16 | uGuestPort;
+}
+
+/**
+ * Argument package for drvNATFwdFlowSweepCallback.
+ */
+typedef struct DRVNATFWDFLOWSWEEP
+{
+    /** The current time (RTTimeMilliTS). */
+    uint64_t                msNow;
+    /** How long a flow may be idle. */
+    uint32_t                cMsIdle;
+    /** Number of entries in auKeys. */
+    uint32_t                cKeys;
+    /** The keys of the expired flows. */
+    uint64_t                auKeys[DRVNAT_FWD_FLOW_SWEEP_MAX];
+} DRVNATFWDFLOWSWEEP;
+
+/**
+ * @callback_method_impl{AVLRU64CALLBACK, Collects expired flows.}
+ */
+static DECLCALLBACK(int) drvNATFwdFlowSweepCallback(PAVLRU64NODECORE pNode, void *pvUser)
+{
+    DRVNATFWDFLOWSWEEP *pArgs = (DRVNATFWDFLOWSWEEP *)pvUser;
+    PDRVNATFWDFLOW      pFlow = (PDRVNATFWDFLOW)pNode;
+    if (pArgs->msNow - pFlow->msLastSeen >= pArgs->cMsIdle)
+    {
+        pArgs->auKeys[pArgs->cKeys++] = pFlow->Core.Key;
+        if (pArgs->cKeys >= RT_ELEMENTS(pArgs->auKeys))
+            return VINF_CALLBACK_RETURN;
+    }
+    return VINF_SUCCESS;
+}
+
+/**
+ * @callback_method_impl{AVLRU64CALLBACK, Frees a flow.}
+ */
+static DECLCALLBACK(int) drvNATFwdFlowFreeCallback(PAVLRU64NODECORE pNode, void *pvUser)
+{
+    RT_NOREF(pvUser);
+    RTMemFree(pNode);
+    return VINF_SUCCESS;
+}
+
+/**
+ * Removes port-forwarded UDP flows which have been idle for too long.
+ *
+ * TCP flows are not swept, they stay until slirp closes their socket no
+ * matter how long the connection is idle (slirp_fwd_tcp_closed).
+ *
+ * @param   pThis               Pointer to the NAT instance.
+ * @param   msNow               The current time (RTTimeMilliTS).
+ * @remarks Caller must own FwdFlowLock.
+ */
+static void drvNATFwdFlowSweep(PDRVNAT pThis, uint64_t msNow)
 {
+    DRVNATFWDFLOWSWEEP Args;
+    Args.msNow   = msNow;
+    Args.cMsIdle = DRVNAT_FWD_FLOW_UDP_IDLE_MS;
+    Args.cKeys   = 0;
+    RTAvlrU64DoWithAll(&pThis->apFwdFlows[1], true /*fFromLeft*/, drvNATFwdFlowSweepCallback, &Args);
+    for (uint32_t i = 0; i < Args.cKeys; i++)
+        RTMemFree(RTAvlrU64Remove(&pThis->apFwdFlows[1], Args.auKeys[i]));
+    pThis->msFwdFlowSweep = msNow;
+}
+
+/**
+ * Remembers the flow of a frame the first shard delivers to a port-forwarded
+ * guest port, so the replies of the guest go to the same shard.
+ *
+ * Only flows the first shard actually has a socket for are recorded.  Flows of
+ * the guest from the same port to other shards, e.g. ones set up before the
+ * port-forwarding rule was added at runtime, keep their shard.  A FIN or RST
+ * doesn't create a TCP flow, as it may be delivered after the socket closed
+ * and slirp_fwd_tcp_closed forgot the flow.
+ *
+ * @param   pShard              The shard delivering the frame.
+ * @param   pbFrame             The Ethernet frame.
+ * @param   cbFrame             The size of the frame.
+ * @thread  Receive threads.
+ */
+static void drvNATFwdFlowLearn(PDRVNATSHARD pShard, uint8_t const *pbFrame, size_t cbFrame)
+{
+    PDRVNAT pThis = pShard->pThis;
+    if (pShard->iShard != 0 || pThis->cShards <= 1)
+        return;
+
+    unsigned        iProto;
+    uint16_t const *pau16Ports;
+    PCRTNETIPV4     pIpHdr = drvNATParseFlowFrame(pbFrame, cbFrame, &iProto, &pau16Ports);
+    if (!pIpHdr || !pau16Ports)
+        return;
+    uint16_t const uGuestPort = RT_BE2H_U16(pau16Ports[1]);
+    if (!ASMBitTest(pThis->pbmFwdPorts, iProto * _64K + uGuestPort))
+        return;
+    uint8_t const  fTcpFlags = drvNATTcpFlags(pIpHdr, iProto, pau16Ports, pbFrame, cbFrame);
+    uint64_t const uKey      = drvNATFwdFlowKey(pIpHdr->ip_src.u, RT_BE2H_U16(pau16Ports[0]), uGuestPort);
+
+    RTCritSectEnter(&pThis->FwdFlowLock);
+    uint64_t const msNow = RTTimeMilliTS();
+    PDRVNATFWDFLOW pFlow = (PDRVNATFWDFLOW)RTAvlrU64Get(&pThis->apFwdFlows[iProto], uKey);
+    if (   !pFlow
+        && !(fTcpFlags & (RTNETTCP_F_FIN | RTNETTCP_F_RST)))
+    {
+        pFlow = (PDRVNATFWDFLOW)RTMemAllocZ(sizeof(*pFlow));
+        if (pFlow)
+        {
+            pFlow->Core.Key     = uKey;
+            pFlow->Core.KeyLast = uKey;
+            RTAvlrU64Insert(&pThis->apFwdFlows[iProto], &pFlow->Core);
+        }
+    }
+    if (pFlow)
+        pFlow->msLastSeen = msNow;
+    if (msNow - pThis->msFwdFlowSweep >= DRVNAT_FWD_FLOW_SWEEP_MS)
+        drvNATFwdFlowSweep(pThis, msNow);
+    RTCritSectLeave(&pThis->FwdFlowLock);
+}
+
+/**
+ * Checks whether a frame from the guest belongs to a flow remembered by
+ * drvNATFwdFlowLearn.
+ *
+ * @returns true if it does, false if not.
+ * @param   pThis               Pointer to the NAT instance.
+ * @param   iProto              The protocol index, 0 for TCP and 1 for UDP.
+ * @param   uKey                The flow key, see drvNATFwdFlowKey.
+ */
+static bool drvNATFwdFlowLookup(PDRVNAT pThis, unsigned iProto, uint64_t uKey)
+{
+    RTCritSectEnter(&pThis->FwdFlowLock);
+    PDRVNATFWDFLOW pFlow = (PDRVNATFWDFLOW)RTAvlrU64Get(&pThis->apFwdFlows[iProto], uKey);
+    if (pFlow)
+        pFlow->msLastSeen = RTTimeMilliTS();
+    RTCritSectLeave(&pThis->FwdFlowLock);
+    return pFlow != NULL;
+}
+
+
+static DECLCALLBACK(void) drvNATUrgRecvWorker(PDRVNATSHARD pShard, uint8_t *pu8Buf, int cb, struct mbuf *m)
+{
+    PDRVNAT pThis = pShard->pThis;
+    drvNATFwdFlowLearn(pShard, pu8Buf, cb);
     int rc = RTCritSectEnter(&pThis->DevAccessLock);
     AssertRC(rc);
     rc = pThis->pIAboveNet->pfnWaitReceiveAvail(pThis->pIAboveNet, RT_INDEFINITE_WAIT);
@@ -324,20 +633,23 @@ static DECLCALLBACK(void) drvNATUrgRecvWorker(PDRVNAT pThis, uint8_t *pu8Buf, in
     rc = RTCritSectLeave(&pThis->DevAccessLock);
     AssertRC(rc);
 
-    slirp_ext_m_free(pThis->pNATState, m, pu8Buf);
+    slirp_ext_m_free(pShard->pNATState, m, pu8Buf);
     if (ASMAtomicDecU32(&pThis->cUrgPkts) == 0)
     {
         drvNATRecvWakeup(pThis->pDrvIns, pThis->pRecvThread);
-        drvNATNotifyNATThread(pThis, "drvNATUrgRecvWorker");
+        drvNATNotifyNATThread(pShard, "drvNATUrgRecvWorker");
     }
 }
 
 
-static DECLCALLBACK(void) drvNATRecvWorker(PDRVNAT pThis, uint8_t *pu8Buf, int cb, struct mbuf *m)
+static DECLCALLBACK(void) drvNATRecvWorker(PDRVNATSHARD pShard, uint8_t *pu8Buf, int cb, struct mbuf *m)
 {
+    PDRVNAT pThis = pShard->pThis;
     int rc;
     STAM_PROFILE_START(&pThis->StatNATRecv, a);
 
+    drvNATFwdFlowLearn(pShard, pu8Buf, cb);
+
 
     while (ASMAtomicReadU32(&pThis->cUrgPkts) != 0)
     {
@@ -370,10 +682,10 @@ static DECLCALLBACK(void) drvNATRecvWorker(PDRVNAT pThis, uint8_t *pu8Buf, int c
     AssertRC(rc);
 
 done_unlocked:
-    slirp_ext_m_free(pThis->pNATState, m, pu8Buf);
+    slirp_ext_m_free(pShard->pNATState, m, pu8Buf);
     ASMAtomicDecU32(&pThis->cPkts);
 
-    drvNATNotifyNATThread(pThis, "drvNATRecvWorker");
+    drvNATNotifyNATThread(pShard, "drvNATRecvWorker");
 
     STAM_PROFILE_STOP(&pThis->StatNATRecv, a);
 }
@@ -391,7 +703,7 @@ static void drvNATFreeSgBuf(PDRVNAT pThis, PPDMSCATTERGATHER pSgBuf)
     if (pSgBuf->pvAllocator)
     {
         Assert(!pSgBuf->pvUser);
-        slirp_ext_m_free(pThis->pNATState, (struct mbuf *)pSgBuf->pvAllocator, NULL);
+        slirp_ext_m_free(pThis->aShards[0].pNATState, (struct mbuf *)pSgBuf->pvAllocator, NULL);
         pSgBuf->pvAllocator = NULL;
     }
     else if (pSgBuf->pvUser)
@@ -405,19 +717,136 @@ static void drvNATFreeSgBuf(PDRVNAT pThis, PPDMSCATTERGATHER pSgBuf)
 }
 
 /**
- * Worker function for drvNATSend().
+ * Hashes the addresses, ports and protocol of a TCP or UDP frame.
+ *
+ * @returns The hash.
+ * @param   pIpHdr              The IPv4 header.
+ * @param   pau16Ports          The source and destination ports.
+ */
+DECLINLINE(uint32_t) drvNATFlowHash(PCRTNETIPV4 pIpHdr, uint16_t const *pau16Ports)
+{
+    uint32_t uHash = pIpHdr->ip_src.u * UINT32_C(0x9e3779b1);
+    uHash = (uHash ^ pIpHdr->ip_dst.u) * UINT32_C(0x85ebca6b);
+    uHash = (uHash ^ pau16Ports[0] ^ ((uint32_t)pau16Ports[1] << 16)) * UINT32_C(0xc2b2ae35);
+    uHash ^= pIpHdr->ip_p;
+    uHash ^= uHash >> 16;
+    uHash *= UINT32_C(0x85ebca6b);
+    uHash ^= uHash >> 13;
+    return uHash;
+}
+
+/**
+ * Picks the shard a frame from the guest is processed by.
+ *
+ * TCP and UDP go by a hash of the addresses, ports and protocol, so that all
+ * frames of a flow end up on the same shard.  Everything else, DHCP, and the
+ * flows the first shard delivered to port-forwarded guest ports go to the
+ * first shard.  As only the first fragment of a datagram carries the ports,
+ * the shard it went to is remembered so the other fragments follow it.  This
+ * relies on the guest sending the first fragment first, which common stacks
+ * do; other fragments seen without it go to the first shard.
  *
+ * @returns Shard index.
  * @param   pThis               Pointer to the NAT instance.
+ * @param   pbFrame             The Ethernet frame.
+ * @param   cbFrame             The size of the frame.
+ * @remarks Caller must own XmitLock.
+ */
+static uint32_t drvNATSelectShard(PDRVNAT pThis, uint8_t const *pbFrame, size_t cbFrame)
+{
+    if (pThis->cShards <= 1)
+        return 0;
+
+    unsigned        iProto;
+    uint16_t const *pau16Ports;
+    PCRTNETIPV4     pIpHdr = drvNATParseFlowFrame(pbFrame, cbFrame, &iProto, &pau16Ports);
+    if (!pIpHdr)
+        return 0;
+
+    DRVNATPINNEDFRAG *pFrag = &pThis->aPinnedFrags[RT_BE2H_U16(pIpHdr->ip_id) & (DRVNAT_PINNED_FRAGS - 1)];
+    if (!pau16Ports)
+    {
+        if (   (pIpHdr->ip_off & RT_H2BE_U16_C(UINT16_C(0x1fff)))
+            && pFrag->uDst   == pIpHdr->ip_dst.u
+            && pFrag->uSrc   == pIpHdr->ip_src.u
+            && pFrag->uId    == pIpHdr->ip_id
+            && pFrag->uProto == pIpHdr->ip_p)
+            return pFrag->iShard;
+        return 0; /* Too short to be of any use, or the first fragment wasn't seen. */
+    }
+
+    uint32_t       iShard;
+    uint16_t const uSrcPort = RT_BE2H_U16(pau16Ports[0]);
+    uint16_t const uDstPort = RT_BE2H_U16(pau16Ports[1]);
+    if (   (iProto == 1 && uDstPort == RTNETIPV4_PORT_BOOTPS)
+        || (   ASMBitTest(pThis->pbmFwdPorts, iProto * _64K + uSrcPort)
+            && drvNATFwdFlowLookup(pThis, iProto, drvNATFwdFlowKey(pIpHdr->ip_dst.u, uDstPort, uSrcPort))))
+        iShard = 0;
+    else
+        iShard = drvNATFlowHash(pIpHdr, pau16Ports) % pThis->cShards;
+
+    if (pIpHdr->ip_off & RT_H2BE_U16_C(RTNETIPV4_FLAGS_MF))
+    {
+        pFrag->uSrc   = pIpHdr->ip_src.u;
+        pFrag->uDst   = pIpHdr->ip_dst.u;
+        pFrag->uId    = pIpHdr->ip_id;
+        pFrag->uProto = pIpHdr->ip_p;
+        pFrag->iShard = (uint8_t)iShard;
+    }
+    return iShard;
+}
+
+/**
+ * Checks whether a GSO frame can be fed to the NAT engine in one piece.
+ *
+ * Only TCP over IPv4 qualifies, as UDP would need IP fragmentation and the
+ * NAT engine doesn't speak IPv6.  The IP total length field limits the size.
+ *
+ * @returns true if it can, false if it must be segmented.
+ * @param   pGso                The GSO context.
+ * @param   cbFrame             The size of the GSO frame.
+ */
+DECLINLINE(bool) drvNATGsoCanPassDirectly(PCPDMNETWORKGSO pGso, size_t cbFrame)
+{
+    return pGso->u8Type == PDMNETWORKGSOTYPE_IPV4_TCP
+        && cbFrame - pGso->offHdr1 <= UINT16_MAX
+        && PDMNetGsoIsValid(pGso, sizeof(*pGso), cbFrame);
+}
+
+/**
+ * Worker function for drvNATSend().
+ *
+ * @param   pShard              The shard the frame was queued to.
  * @param   pSgBuf              The scatter/gather buffer.
  * @thread  NAT
  */
-static void drvNATSendWorker(PDRVNAT pThis, PPDMSCATTERGATHER pSgBuf)
+static void drvNATSendWorker(PDRVNATSHARD pShard, PPDMSCATTERGATHER pSgBuf)
 {
+    PDRVNAT pThis = pShard->pThis;
 #if 0 /* Assertion happens often to me after resuming a VM -- no time to investigate this now. */
     Assert(pThis->enmLinkState == PDMNETWORKLINKSTATE_UP);
 #endif
     if (pThis->enmLinkState == PDMNETWORKLINKSTATE_UP)
     {
+        /*
+         * The other shards never see the guest's ARP and DHCP traffic, so
+         * tell them where the guest sends from.
+         */
+        if (   pShard->iShard != 0
+            && pSgBuf->cbUsed >= sizeof(RTNETETHERHDR) + RTNETIPV4_MIN_LEN)
+        {
+            PCRTNETETHERHDR pEthHdr = (PCRTNETETHERHDR)pSgBuf->aSegs[0].pvSeg;
+            PCRTNETIPV4     pIpHdr  = (PCRTNETIPV4)(pEthHdr + 1);
+            if (   pEthHdr->EtherType == RT_H2BE_U16_C(RTNET_ETHERTYPE_IPV4)
+                && (   pIpHdr->ip_src.u != pShard->uLearnedIp
+                    || memcmp(&pEthHdr->SrcMac, &pShard->LearnedMac, sizeof(RTMAC))))
+            {
+                pShard->uLearnedIp = pIpHdr->ip_src.u;
+                pShard->LearnedMac = pEthHdr->SrcMac;
+                slirp_arp_learn(pShard->pNATState, pIpHdr->ip_src.u, &pEthHdr->SrcMac.au8[0]);
+            }
+        }
+
         struct mbuf *m = (struct mbuf *)pSgBuf->pvAllocator;
         if (m)
         {
@@ -425,43 +854,67 @@ static void drvNATSendWorker(PDRVNAT pThis, PPDMSCATTERGATHER pSgBuf)
              * A normal frame.
              */
             pSgBuf->pvAllocator = NULL;
-            slirp_input(pThis->pNATState, m, pSgBuf->cbUsed);
+            slirp_input(pShard->pNATState, m, pSgBuf->cbUsed);
         }
         else
         {
-            /*
-             * GSO frame, need to segment it.
-             */
-            /** @todo Make the NAT engine grok large frames?  Could be more efficient... */
+            PCPDMNETWORKGSO pGso = (PCPDMNETWORKGSO)pSgBuf->pvUser;
+            if (drvNATGsoCanPassDirectly(pGso, pSgBuf->cbUsed))
+            {
+                /*
+                 * TCP/IPv4 GSO frame: let an mbuf wrap the buffer and fix up
+                 * the headers.  The NAT engine treats it as one big segment
+                 * and hands the payload to the host socket in one go.  The
+                 * guest offloaded the checksum, so there is nothing to verify
+                 * either.  The headers are left alone until the mbuf is ours,
+                 * as segmenting needs them as the guest wrote them.
+                 */
+                m = slirp_ext_m_wrap(pShard->pNATState, pSgBuf->aSegs[0].pvSeg, pSgBuf->cbUsed,
+                                     pSgBuf->aSegs[0].cbSeg + DRVNAT_GSO_TAIL, true /*fCsumValid*/);
+                if (m)
+                {
+                    PDMNetGsoPrepForDirectUse(pGso, pSgBuf->aSegs[0].pvSeg, pSgBuf->cbUsed, PDMNETCSUMTYPE_NONE);
+                    pSgBuf->aSegs[0].pvSeg = NULL; /* the mbuf owns it now */
+                    STAM_COUNTER_INC(&pThis->StatGsoDirect);
+                    slirp_input(pShard->pNATState, m, pSgBuf->cbUsed);
+                }
+            }
+            if (!m)
+            {
+                /*
+                 * GSO frame, need to segment it.  Also done for TCP/IPv4
+                 * when out of mbufs for wrapping, the segment mbufs come
+                 * from a different zone.
+                 */
 #if 0 /* this is for testing PDMNetGsoCarveSegmentQD. */
-            uint8_t         abHdrScratch[256];
+                uint8_t         abHdrScratch[256];
 #endif
-            uint8_t const  *pbFrame = (uint8_t const *)pSgBuf->aSegs[0].pvSeg;
-            PCPDMNETWORKGSO pGso    = (PCPDMNETWORKGSO)pSgBuf->pvUser;
-            uint32_t const  cSegs   = PDMNetGsoCalcSegmentCount(pGso, pSgBuf->cbUsed);  Assert(cSegs > 1);
-            for (uint32_t iSeg = 0; iSeg < cSegs; iSeg++)
-            {
-                size_t cbSeg;
-                void  *pvSeg;
-                m = slirp_ext_m_get(pThis->pNATState, pGso->cbHdrsTotal + pGso->cbMaxSeg, &pvSeg, &cbSeg);
-                if (!m)
-                    break;
+                uint8_t const  *pbFrame = (uint8_t const *)pSgBuf->aSegs[0].pvSeg;
+                uint32_t const  cSegs   = PDMNetGsoCalcSegmentCount(pGso, pSgBuf->cbUsed);  Assert(cSegs > 1);
+                for (uint32_t iSeg = 0; iSeg < cSegs; iSeg++)
+                {
+                    size_t cbSeg;
+                    void  *pvSeg;
+                    m = slirp_ext_m_get(pShard->pNATState, pGso->cbHdrsTotal + pGso->cbMaxSeg, &pvSeg, &cbSeg);
+                    if (!m)
+                        break;
 
 #if 1
-                uint32_t cbPayload, cbHdrs;
-                uint32_t offPayload = PDMNetGsoCarveSegment(pGso, pbFrame, pSgBuf->cbUsed,
-                                                            iSeg, cSegs, (uint8_t *)pvSeg, &cbHdrs, &cbPayload);
-                memcpy((uint8_t *)pvSeg + cbHdrs, pbFrame + offPayload, cbPayload);
+                    uint32_t cbPayload, cbHdrs;
+                    uint32_t offPayload = PDMNetGsoCarveSegment(pGso, pbFrame, pSgBuf->cbUsed,
+                                                                iSeg, cSegs, (uint8_t *)pvSeg, &cbHdrs, &cbPayload);
+                    memcpy((uint8_t *)pvSeg + cbHdrs, pbFrame + offPayload, cbPayload);
 
-                slirp_input(pThis->pNATState, m, cbPayload + cbHdrs);
+                    slirp_input(pShard->pNATState, m, cbPayload + cbHdrs);
 #else
-                uint32_t cbSegFrame;
-                void *pvSegFrame = PDMNetGsoCarveSegmentQD(pGso, (uint8_t *)pbFrame, pSgBuf->cbUsed, abHdrScratch,
-                                                           iSeg, cSegs, &cbSegFrame);
-                memcpy((uint8_t *)pvSeg, pvSegFrame, cbSegFrame);
+                    uint32_t cbSegFrame;
+                    void *pvSegFrame = PDMNetGsoCarveSegmentQD(pGso, (uint8_t *)pbFrame, pSgBuf->cbUsed, abHdrScratch,
+                                                               iSeg, cSegs, &cbSegFrame);
+                    memcpy((uint8_t *)pvSeg, pvSegFrame, cbSegFrame);
 
-                slirp_input(pThis->pNATState, m, cbSegFrame);
+                    slirp_input(pShard->pNATState, m, cbSegFrame);
 #endif
+                }
             }
         }
     }
@@ -498,7 +951,7 @@ static DECLCALLBACK(int) drvNATNetworkUp_AllocBuf(PPDMINETWORKUP pInterface, siz
     /*
      * Drop the incoming frame if the NAT thread isn't running.
      */
-    if (pThis->pSlirpThread->enmState != PDMTHREADSTATE_RUNNING)
+    if (pThis->aShards[0].pSlirpThread->enmState != PDMTHREADSTATE_RUNNING)
     {
         Log(("drvNATNetowrkUp_AllocBuf: returns VERR_NET_NO_NETWORK\n"));
         return VERR_NET_NO_NETWORK;
@@ -524,7 +977,7 @@ static DECLCALLBACK(int) drvNATNetworkUp_AllocBuf(PPDMINETWORKUP pInterface, siz
         }
 
         pSgBuf->pvUser      = NULL;
-        pSgBuf->pvAllocator = slirp_ext_m_get(pThis->pNATState, cbMin,
+        pSgBuf->pvAllocator = slirp_ext_m_get(pThis->aShards[0].pNATState, cbMin,
                                               &pSgBuf->aSegs[0].pvSeg, &pSgBuf->aSegs[0].cbSeg);
         if (!pSgBuf->pvAllocator)
         {
@@ -548,7 +1001,7 @@ static DECLCALLBACK(int) drvNATNetworkUp_AllocBuf(PPDMINETWORKUP pInterface, siz
         pSgBuf->pvUser      = RTMemDup(pGso, sizeof(*pGso));
         pSgBuf->pvAllocator = NULL;
         pSgBuf->aSegs[0].cbSeg = RT_ALIGN_Z(cbMin, 16);
-        pSgBuf->aSegs[0].pvSeg = RTMemAlloc(pSgBuf->aSegs[0].cbSeg);
+        pSgBuf->aSegs[0].pvSeg = RTMemAlloc(pSgBuf->aSegs[0].cbSeg + DRVNAT_GSO_TAIL);
         if (!pSgBuf->pvUser || !pSgBuf->aSegs[0].pvSeg)
         {
             RTMemFree(pSgBuf->aSegs[0].pvSeg);
@@ -594,18 +1047,20 @@ static DECLCALLBACK(int) drvNATNetworkUp_SendBuf(PPDMINETWORKUP pInterface, PPDM
     Assert((pSgBuf->fFlags & PDMSCATTERGATHER_FLAGS_OWNER_MASK) == PDMSCATTERGATHER_FLAGS_OWNER_1);
     Assert(RTCritSectIsOwner(&pThis->XmitLock));
 
+    PDRVNATSHARD pShard = &pThis->aShards[drvNATSelectShard(pThis, (uint8_t const *)pSgBuf->aSegs[0].pvSeg,
+                                                            pSgBuf->cbUsed)];
     int rc;
-    if (pThis->pSlirpThread->enmState == PDMTHREADSTATE_RUNNING)
+    if (pShard->pSlirpThread->enmState == PDMTHREADSTATE_RUNNING)
     {
         /* Set an FTM checkpoint as this operation changes the state permanently. */
         PDMDrvHlpFTSetCheckpoint(pThis->pDrvIns, FTMCHECKPOINTTYPE_NETWORK);
 
-        rc = RTReqQueueCallEx(pThis->hSlirpReqQueue, NULL /*ppReq*/, 0 /*cMillies*/,
+        rc = RTReqQueueCallEx(pShard->hSlirpReqQueue, NULL /*ppReq*/, 0 /*cMillies*/,
                               RTREQFLAGS_VOID | RTREQFLAGS_NO_WAIT,
-                              (PFNRT)drvNATSendWorker, 2, pThis, pSgBuf);
+                              (PFNRT)drvNATSendWorker, 2, pShard, pSgBuf);
         if (RT_SUCCESS(rc))
         {
-            drvNATNotifyNATThread(pThis, "drvNATNetworkUp_SendBuf");
+            drvNATNotifyNATThread(pShard, "drvNATNetworkUp_SendBuf");
             return VINF_SUCCESS;
         }
 
@@ -629,17 +1084,17 @@ static DECLCALLBACK(void) drvNATNetworkUp_EndXmit(PPDMINETWORKUP pInterface)
 /**
  * Get the NAT thread out of poll/WSAWaitForMultipleEvents
  */
-static void drvNATNotifyNATThread(PDRVNAT pThis, const char *pszWho)
+static void drvNATNotifyNATThread(PDRVNATSHARD pShard, const char *pszWho)
 {
     RT_NOREF(pszWho);
     int rc;
 #ifndef RT_OS_WINDOWS
     /* kick poll() */
     size_t cbIgnored;
-    rc = RTPipeWrite(pThis->hPipeWrite, "", 1, &cbIgnored);
+    rc = RTPipeWrite(pShard->hPipeWrite, "", 1, &cbIgnored);
 #else
     /* kick WSAWaitForMultipleEvents */
-    rc = WSASetEvent(pThis->hWakeupEvent);
+    rc = WSASetEvent(pShard->hWakeupEvent);
 #endif
     AssertRC(rc);
 }
@@ -658,20 +1113,24 @@ static DECLCALLBACK(void) drvNATNetworkUp_SetPromiscuousMode(PPDMINETWORKUP pInt
  * Worker function for drvNATNetworkUp_NotifyLinkChanged().
  * @thread "NAT" thread.
  */
-static void drvNATNotifyLinkChangedWorker(PDRVNAT pThis, PDMNETWORKLINKSTATE enmLinkState)
+static void drvNATNotifyLinkChangedWorker(PDRVNATSHARD pShard, PDMNETWORKLINKSTATE enmLinkState)
 {
+    PDRVNAT pThis = pShard->pThis;
     pThis->enmLinkState = pThis->enmLinkStateWant = enmLinkState;
+    pShard->enmLinkState = enmLinkState;
     switch (enmLinkState)
     {
         case PDMNETWORKLINKSTATE_UP:
-            LogRel(("NAT: Link up\n"));
-            slirp_link_up(pThis->pNATState);
+            if (pShard->iShard == 0)
+                LogRel(("NAT: Link up\n"));
+            slirp_link_up(pShard->pNATState);
             break;
 
         case PDMNETWORKLINKSTATE_DOWN:
         case PDMNETWORKLINKSTATE_DOWN_RESUME:
-            LogRel(("NAT: Link down\n"));
-            slirp_link_down(pThis->pNATState);
+            if (pShard->iShard == 0)
+                LogRel(("NAT: Link down\n"));
+            slirp_link_down(pShard->pNATState);
             break;
 
         default:
@@ -694,24 +1153,28 @@ static DECLCALLBACK(void) drvNATNetworkUp_NotifyLinkChanged(PPDMINETWORKUP pInte
 
     /* Don't queue new requests if the NAT thread is not running (e.g. paused,
      * stopping), otherwise we would deadlock. Memorize the change. */
-    if (pThis->pSlirpThread->enmState != PDMTHREADSTATE_RUNNING)
+    if (pThis->aShards[0].pSlirpThread->enmState != PDMTHREADSTATE_RUNNING)
     {
         pThis->enmLinkStateWant = enmLinkState;
         return;
     }
 
-    PRTREQ pReq;
-    int rc = RTReqQueueCallEx(pThis->hSlirpReqQueue, &pReq, 0 /*cMillies*/, RTREQFLAGS_VOID,
-                              (PFNRT)drvNATNotifyLinkChangedWorker, 2, pThis, enmLinkState);
-    if (rc == VERR_TIMEOUT)
+    for (uint32_t iShard = 0; iShard < pThis->cShards; iShard++)
     {
-        drvNATNotifyNATThread(pThis, "drvNATNetworkUp_NotifyLinkChanged");
-        rc = RTReqWait(pReq, RT_INDEFINITE_WAIT);
-        AssertRC(rc);
+        PDRVNATSHARD pShard = &pThis->aShards[iShard];
+        PRTREQ pReq;
+        int rc = RTReqQueueCallEx(pShard->hSlirpReqQueue, &pReq, 0 /*cMillies*/, RTREQFLAGS_VOID,
+                                  (PFNRT)drvNATNotifyLinkChangedWorker, 2, pShard, enmLinkState);
+        if (rc == VERR_TIMEOUT)
+        {
+            drvNATNotifyNATThread(pShard, "drvNATNetworkUp_NotifyLinkChanged");
+            rc = RTReqWait(pReq, RT_INDEFINITE_WAIT);
+            AssertRC(rc);
+        }
+        else
+            AssertRC(rc);
+        RTReqRelease(pReq);
     }
-    else
-        AssertRC(rc);
-    RTReqRelease(pReq);
 }
 
 static void drvNATNotifyApplyPortForwardCommand(PDRVNAT pThis, bool fRemove,
@@ -729,9 +1192,12 @@ static void drvNATNotifyApplyPortForwardCommand(PDRVNAT pThis, bool fRemove,
         guestIp.s_addr = pThis->GuestIP;
 
     if (fRemove)
-        slirp_remove_redirect(pThis->pNATState, fUdp, hostIp, u16HostPort, guestIp, u16GuestPort);
+        slirp_remove_redirect(pThis->aShards[0].pNATState, fUdp, hostIp, u16HostPort, guestIp, u16GuestPort);
     else
-        slirp_add_redirect(pThis->pNATState, fUdp, hostIp, u16HostPort, guestIp, u16GuestPort);
+    {
+        ASMAtomicBitSet(pThis->pbmFwdPorts, (fUdp ? _64K : 0) + u16GuestPort);
+        slirp_add_redirect(pThis->aShards[0].pNATState, fUdp, hostIp, u16HostPort, guestIp, u16GuestPort);
+    }
 }
 
 static DECLCALLBACK(int) drvNATNetworkNatConfigRedirect(PPDMINETWORKNATCONFIG pInterface, bool fRemove,
@@ -743,7 +1209,8 @@ static DECLCALLBACK(int) drvNATNetworkNatConfigRedirect(PPDMINETWORKNATCONFIG pI
     PDRVNAT pThis = RT_FROM_MEMBER(pInterface, DRVNAT, INetworkNATCfg);
     /* Execute the command directly if the VM is not running. */
     int rc;
-    if (pThis->pSlirpThread->enmState != PDMTHREADSTATE_RUNNING)
+    PDRVNATSHARD pShard = &pThis->aShards[0];
+    if (pShard->pSlirpThread->enmState != PDMTHREADSTATE_RUNNING)
     {
         drvNATNotifyApplyPortForwardCommand(pThis, fRemove, fUdp, pHostIp,
                                            u16HostPort, pGuestIp,u16GuestPort);
@@ -752,12 +1219,12 @@ static DECLCALLBACK(int) drvNATNetworkNatConfigRedirect(PPDMINETWORKNATCONFIG pI
     else
     {
         PRTREQ pReq;
-        rc = RTReqQueueCallEx(pThis->hSlirpReqQueue, &pReq, 0 /*cMillies*/, RTREQFLAGS_VOID,
+        rc = RTReqQueueCallEx(pShard->hSlirpReqQueue, &pReq, 0 /*cMillies*/, RTREQFLAGS_VOID,
                               (PFNRT)drvNATNotifyApplyPortForwardCommand, 7, pThis, fRemove,
                               fUdp, pHostIp, u16HostPort, pGuestIp, u16GuestPort);
         if (rc == VERR_TIMEOUT)
         {
-            drvNATNotifyNATThread(pThis, "drvNATNetworkNatConfigRedirect");
+            drvNATNotifyNATThread(pShard, "drvNATNetworkNatConfigRedirect");
             rc = RTReqWait(pReq, RT_INDEFINITE_WAIT);
             AssertRC(rc);
         }
@@ -778,13 +1245,16 @@ static DECLCALLBACK(int) drvNATNetworkNatConfigRedirect(PPDMINETWORKNATCONFIG pI
  * hSlirpReqQueue and handled asynchronously by this thread.  If this thread
  * wants to deliver packets to the guest, it enqueues a request into
  * hRecvReqQueue which is later handled by the Recv thread.
+ *
+ * There is one such thread per shard, each running its own slirp instance.
  */
 static DECLCALLBACK(int) drvNATAsyncIoThread(PPDMDRVINS pDrvIns, PPDMTHREAD pThread)
 {
-    PDRVNAT pThis = PDMINS_2_DATA(pDrvIns, PDRVNAT);
+    PDRVNAT      pThis  = PDMINS_2_DATA(pDrvIns, PDRVNAT);
+    PDRVNATSHARD pShard = (PDRVNATSHARD)pThread->pvUser;
     int     nFDs = -1;
 #ifdef RT_OS_WINDOWS
-    HANDLE  *phEvents = slirp_get_events(pThis->pNATState);
+    HANDLE  *phEvents = slirp_get_events(pShard->pNATState);
     unsigned int cBreak = 0;
 #else /* RT_OS_WINDOWS */
     unsigned int cPollNegRet = 0;
@@ -795,8 +1265,8 @@ static DECLCALLBACK(int) drvNATAsyncIoThread(PPDMDRVINS pDrvIns, PPDMTHREAD pThr
     if (pThread->enmState == PDMTHREADSTATE_INITIALIZING)
         return VINF_SUCCESS;
 
-    if (pThis->enmLinkStateWant != pThis->enmLinkState)
-        drvNATNotifyLinkChangedWorker(pThis, pThis->enmLinkStateWant);
+    if (pThis->enmLinkStateWant != pShard->enmLinkState)
+        drvNATNotifyLinkChangedWorker(pShard, pThis->enmLinkStateWant);
 
     /*
      * Polling loop.
@@ -807,21 +1277,21 @@ static DECLCALLBACK(int) drvNATAsyncIoThread(PPDMDRVINS pDrvIns, PPDMTHREAD pThr
          * To prevent concurrent execution of sending/receiving threads
          */
 #ifndef RT_OS_WINDOWS
-        nFDs = slirp_get_nsock(pThis->pNATState);
+        nFDs = slirp_get_nsock(pShard->pNATState);
         /* allocation for all sockets + Management pipe */
         struct pollfd *polls = (struct pollfd *)RTMemAlloc((1 + nFDs) * sizeof(struct pollfd) + sizeof(uint32_t));
         if (polls == NULL)
             return VERR_NO_MEMORY;
 
         /* don't pass the management pipe */
-        slirp_select_fill(pThis->pNATState, &nFDs, &polls[1]);
+        slirp_select_fill(pShard->pNATState, &nFDs, &polls[1]);
 
-        polls[0].fd = RTPipeToNative(pThis->hPipeRead);
+        polls[0].fd = RTPipeToNative(pShard->hPipeRead);
         /* POLLRDBAND usually doesn't used on Linux but seems used on Solaris */
         polls[0].events = POLLRDNORM | POLLPRI | POLLRDBAND;
         polls[0].revents = 0;
 
-        int cChangedFDs = poll(polls, nFDs + 1, slirp_get_timeout_ms(pThis->pNATState));
+        int cChangedFDs = poll(polls, nFDs + 1, slirp_get_timeout_ms(pShard->pNATState));
         if (cChangedFDs < 0)
         {
             if (errno == EINTR)
@@ -839,7 +1309,7 @@ static DECLCALLBACK(int) drvNATAsyncIoThread(PPDMDRVINS pDrvIns, PPDMTHREAD pThr
 
         if (cChangedFDs >= 0)
         {
-            slirp_select_poll(pThis->pNATState, &polls[1], nFDs);
+            slirp_select_poll(pShard->pNATState, &polls[1], nFDs);
             if (polls[0].revents & (POLLRDNORM|POLLPRI|POLLRDBAND))
             {
                 /* drain the pipe
@@ -856,18 +1326,18 @@ static DECLCALLBACK(int) drvNATAsyncIoThread(PPDMDRVINS pDrvIns, PPDMTHREAD pThr
                  * pipe.*/
                 char ch;
                 size_t cbRead;
-                RTPipeRead(pThis->hPipeRead, &ch, 1, &cbRead);
+                RTPipeRead(pShard->hPipeRead, &ch, 1, &cbRead);
             }
         }
         /* process _all_ outstanding requests but don't wait */
-        RTReqQueueProcess(pThis->hSlirpReqQueue, 0);
+        RTReqQueueProcess(pShard->hSlirpReqQueue, 0);
         RTMemFree(polls);
 
 #else /* RT_OS_WINDOWS */
         nFDs = -1;
-        slirp_select_fill(pThis->pNATState, &nFDs);
+        slirp_select_fill(pShard->pNATState, &nFDs);
         DWORD dwEvent = WSAWaitForMultipleEvents(nFDs, phEvents, FALSE,
-                                                 slirp_get_timeout_ms(pThis->pNATState),
+                                                 slirp_get_timeout_ms(pShard->pNATState),
                                                  /* :fAlertable */ TRUE);
         AssertCompile(WSA_WAIT_EVENT_0 == 0);
         if (   (/*dwEvent < WSA_WAIT_EVENT_0 ||*/ dwEvent > WSA_WAIT_EVENT_0 + nFDs - 1)
@@ -881,14 +1351,14 @@ static DECLCALLBACK(int) drvNATAsyncIoThread(PPDMDRVINS pDrvIns, PPDMTHREAD pThr
         if (dwEvent == WSA_WAIT_TIMEOUT)
         {
             /* only check for slow/fast timers */
-            slirp_select_poll(pThis->pNATState, /* fTimeout=*/true);
+            slirp_select_poll(pShard->pNATState, /* fTimeout=*/true);
             continue;
         }
         /* poll the sockets in any case */
         Log2(("%s: poll\n", __FUNCTION__));
-        slirp_select_poll(pThis->pNATState, /* fTimeout=*/false);
+        slirp_select_poll(pShard->pNATState, /* fTimeout=*/false);
         /* process _all_ outstanding requests but don't wait */
-        RTReqQueueProcess(pThis->hSlirpReqQueue, 0);
+        RTReqQueueProcess(pShard->hSlirpReqQueue, 0);
 # ifdef VBOX_NAT_DELAY_HACK
         if (cBreak++ > 128)
         {
@@ -912,10 +1382,8 @@ static DECLCALLBACK(int) drvNATAsyncIoThread(PPDMDRVINS pDrvIns, PPDMTHREAD pThr
  */
 static DECLCALLBACK(int) drvNATAsyncIoWakeup(PPDMDRVINS pDrvIns, PPDMTHREAD pThread)
 {
-    RT_NOREF(pThread);
-    PDRVNAT pThis = PDMINS_2_DATA(pDrvIns, PDRVNAT);
-
-    drvNATNotifyNATThread(pThis, "drvNATAsyncIoWakeup");
+    RT_NOREF(pDrvIns);
+    drvNATNotifyNATThread((PDRVNATSHARD)pThread->pvUser, "drvNATAsyncIoWakeup");
     return VINF_SUCCESS;
 }
 
@@ -973,23 +1441,24 @@ int slirp_can_output(void *pvUser)
 
 void slirp_push_recv_thread(void *pvUser)
 {
-    PDRVNAT pThis = (PDRVNAT)pvUser;
+    PDRVNAT pThis = ((PDRVNATSHARD)pvUser)->pThis;
     Assert(pThis);
     drvNATUrgRecvWakeup(pThis->pDrvIns, pThis->pUrgRecvThread);
 }
 
 void slirp_urg_output(void *pvUser, struct mbuf *m, const uint8_t *pu8Buf, int cb)
 {
-    PDRVNAT pThis = (PDRVNAT)pvUser;
-    Assert(pThis);
+    PDRVNATSHARD pShard = (PDRVNATSHARD)pvUser;
+    Assert(pShard);
+    PDRVNAT pThis = pShard->pThis;
 
     /* don't queue new requests when the NAT thread is about to stop */
-    if (pThis->pSlirpThread->enmState != PDMTHREADSTATE_RUNNING)
+    if (pShard->pSlirpThread->enmState != PDMTHREADSTATE_RUNNING)
         return;
 
     ASMAtomicIncU32(&pThis->cUrgPkts);
     int rc = RTReqQueueCallEx(pThis->hUrgRecvReqQueue, NULL /*ppReq*/, 0 /*cMillies*/, RTREQFLAGS_VOID | RTREQFLAGS_NO_WAIT,
-                              (PFNRT)drvNATUrgRecvWorker, 4, pThis, pu8Buf, cb, m);
+                              (PFNRT)drvNATUrgRecvWorker, 4, pShard, pu8Buf, cb, m);
     AssertRC(rc);
     drvNATUrgRecvWakeup(pThis->pDrvIns, pThis->pUrgRecvThread);
 }
@@ -999,31 +1468,58 @@ void slirp_urg_output(void *pvUser, struct mbuf *m, const uint8_t *pu8Buf, int c
  */
 void slirp_output_pending(void *pvUser)
 {
-    PDRVNAT pThis = (PDRVNAT)pvUser;
+    PDRVNAT pThis = ((PDRVNATSHARD)pvUser)->pThis;
     Assert(pThis);
     LogFlowFuncEnter();
     pThis->pIAboveNet->pfnXmitPending(pThis->pIAboveNet);
     LogFlowFuncLeave();
 }
 
+/**
+ * Function called by slirp when it frees a TCP socket accepted for a
+ * port-forwarding rule.
+ *
+ * Forgets the flow so frames of the guest from the guest port to the remote
+ * end go by the hash again.
+ *
+ * @param   pvUser              The shard.
+ * @param   uRemoteIp           The remote address as seen by the guest
+ *                              (network order).
+ * @param   uRemotePort         The remote port.
+ * @param   uGuestPort          The guest port.
+ * @thread  NAT
+ */
+void slirp_fwd_tcp_closed(void *pvUser, uint32_t uRemoteIp, uint16_t uRemotePort, uint16_t uGuestPort)
+{
+    PDRVNATSHARD pShard = (PDRVNATSHARD)pvUser;
+    PDRVNAT      pThis  = pShard->pThis;
+    if (pShard->iShard != 0 || pThis->cShards <= 1)
+        return;
+
+    RTCritSectEnter(&pThis->FwdFlowLock);
+    RTMemFree(RTAvlrU64Remove(&pThis->apFwdFlows[0], drvNATFwdFlowKey(uRemoteIp, uRemotePort, uGuestPort)));
+    RTCritSectLeave(&pThis->FwdFlowLock);
+}
+
 /**
  * Function called by slirp to feed incoming data to the NIC.
  */
 void slirp_output(void *pvUser, struct mbuf *m, const uint8_t *pu8Buf, int cb)
 {
-    PDRVNAT pThis = (PDRVNAT)pvUser;
-    Assert(pThis);
+    PDRVNATSHARD pShard = (PDRVNATSHARD)pvUser;
+    Assert(pShard);
+    PDRVNAT pThis = pShard->pThis;
 
     LogFlow(("slirp_output BEGIN %p %d\n", pu8Buf, cb));
     Log6(("slirp_output: pu8Buf=%p cb=%#x (pThis=%p)\n%.*Rhxd\n", pu8Buf, cb, pThis, cb, pu8Buf));
 
     /* don't queue new requests when the NAT thread is about to stop */
-    if (pThis->pSlirpThread->enmState != PDMTHREADSTATE_RUNNING)
+    if (pShard->pSlirpThread->enmState != PDMTHREADSTATE_RUNNING)
         return;
 
     ASMAtomicIncU32(&pThis->cPkts);
     int rc = RTReqQueueCallEx(pThis->hRecvReqQueue, NULL /*ppReq*/, 0 /*cMillies*/, RTREQFLAGS_VOID | RTREQFLAGS_NO_WAIT,
-                              (PFNRT)drvNATRecvWorker, 4, pThis, pu8Buf, cb, m);
+                              (PFNRT)drvNATRecvWorker, 4, pShard, pu8Buf, cb, m);
     AssertRC(rc);
     drvNATRecvWakeup(pThis->pDrvIns, pThis->pRecvThread);
     STAM_COUNTER_INC(&pThis->StatQueuePktSent);
@@ -1037,20 +1533,20 @@ void slirp_output(void *pvUser, struct mbuf *m, const uint8_t *pu8Buf, int cb)
 int slirp_call(void *pvUser, PRTREQ *ppReq, RTMSINTERVAL cMillies,
                unsigned fFlags, PFNRT pfnFunction, unsigned cArgs, ...)
 {
-    PDRVNAT pThis = (PDRVNAT)pvUser;
-    Assert(pThis);
+    PDRVNATSHARD pShard = (PDRVNATSHARD)pvUser;
+    Assert(pShard);
 
     int rc;
 
     va_list va;
     va_start(va, cArgs);
 
-    rc = RTReqQueueCallV(pThis->hSlirpReqQueue, ppReq, cMillies, fFlags, pfnFunction, cArgs, va);
+    rc = RTReqQueueCallV(pShard->hSlirpReqQueue, ppReq, cMillies, fFlags, pfnFunction, cArgs, va);
 
     va_end(va);
 
     if (RT_SUCCESS(rc))
-        drvNATNotifyNATThread(pThis, "slirp_vcall");
+        drvNATNotifyNATThread(pShard, "slirp_vcall");
 
     return rc;
 }
@@ -1062,7 +1558,7 @@ int slirp_call(void *pvUser, PRTREQ *ppReq, RTMSINTERVAL cMillies,
 int slirp_call_hostres(void *pvUser, PRTREQ *ppReq, RTMSINTERVAL cMillies,
                        unsigned fFlags, PFNRT pfnFunction, unsigned cArgs, ...)
 {
-    PDRVNAT pThis = (PDRVNAT)pvUser;
+    PDRVNAT pThis = ((PDRVNATSHARD)pvUser)->pThis;
     Assert(pThis);
 
     int rc;
@@ -1243,10 +1739,10 @@ static DECLCALLBACK(void) drvNATResume(PPDMDRVINS pDrvIns)
 }
 
 
-static DECLCALLBACK(int) drvNATReinitializeHostNameResolving(PDRVNAT pThis)
+static DECLCALLBACK(int) drvNATReinitializeHostNameResolving(PDRVNATSHARD pShard)
 {
-    slirpReleaseDnsSettings(pThis->pNATState);
-    slirpInitializeDnsSettings(pThis->pNATState);
+    slirpReleaseDnsSettings(pShard->pNATState);
+    slirpInitializeDnsSettings(pShard->pNATState);
     return VINF_SUCCESS;
 }
 
@@ -1265,7 +1761,7 @@ static DECLCALLBACK(int) drvNATReinitializeHostNameResolving(PDRVNAT pThis)
  */
 DECLINLINE(void) drvNATUpdateDNS(PDRVNAT pThis, bool fFlapLink)
 {
-    int strategy = slirp_host_network_configuration_change_strategy_selector(pThis->pNATState);
+    int strategy = slirp_host_network_configuration_change_strategy_selector(pThis->aShards[0].pNATState);
     switch (strategy)
     {
         case VBOX_NAT_DNS_DNSPROXY:
@@ -1278,13 +1774,17 @@ DECLINLINE(void) drvNATUpdateDNS(PDRVNAT pThis, bool fFlapLink)
              */
             /**
              * It's unsafe to to do it directly on non-NAT thread
-             * so we schedule the worker and kick the NAT thread.
+             * so we schedule the worker and kick the NAT threads.
              */
-            int rc = RTReqQueueCallEx(pThis->hSlirpReqQueue, NULL /*ppReq*/, 0 /*cMillies*/,
-                                      RTREQFLAGS_VOID | RTREQFLAGS_NO_WAIT,
-                                      (PFNRT)drvNATReinitializeHostNameResolving, 1, pThis);
-            if (RT_SUCCESS(rc))
-                drvNATNotifyNATThread(pThis, "drvNATUpdateDNS");
+            for (uint32_t iShard = 0; iShard < pThis->cShards; iShard++)
+            {
+                PDRVNATSHARD pShard = &pThis->aShards[iShard];
+                int rc = RTReqQueueCallEx(pShard->hSlirpReqQueue, NULL /*ppReq*/, 0 /*cMillies*/,
+                                          RTREQFLAGS_VOID | RTREQFLAGS_NO_WAIT,
+                                          (PFNRT)drvNATReinitializeHostNameResolving, 1, pShard);
+                if (RT_SUCCESS(rc))
+                    drvNATNotifyNATThread(pShard, "drvNATUpdateDNS");
+            }
 
             return;
         }
@@ -1312,7 +1812,12 @@ DECLINLINE(void) drvNATUpdateDNS(PDRVNAT pThis, bool fFlapLink)
 static DECLCALLBACK(void) drvNATInfo(PPDMDRVINS pDrvIns, PCDBGFINFOHLP pHlp, const char *pszArgs)
 {
     PDRVNAT pThis = PDMINS_2_DATA(pDrvIns, PDRVNAT);
-    slirp_info(pThis->pNATState, pHlp, pszArgs);
+    for (uint32_t iShard = 0; iShard < pThis->cShards; iShard++)
+    {
+        if (pThis->cShards > 1)
+            pHlp->pfnPrintf(pHlp, "Shard #%u:\n", iShard);
+        slirp_info(pThis->aShards[iShard].pNATState, pHlp, pszArgs);
+    }
 }
 
 #ifdef VBOX_WITH_DNSMAPPING_IN_HOSTRESOLVER
@@ -1351,7 +1856,8 @@ static int drvNATConstructDNSMappings(unsigned iInstance, PDRVNAT pThis, PCFGMNO
             LogRel(("NAT: DNS mapping %s is ignored (address not pointed)\n", szHostNameOrPattern));
             continue;
         }
-        slirp_add_host_resolver_mapping(pThis->pNATState, szHostNameOrPattern, fPattern, HostIP.s_addr);
+        for (uint32_t iShard = 0; iShard < pThis->cShards; iShard++)
+            slirp_add_host_resolver_mapping(pThis->aShards[iShard].pNATState, szHostNameOrPattern, fPattern, HostIP.s_addr);
     }
     LogFlowFunc(("LEAVE: %Rrc\n", rc));
     return rc;
@@ -1431,7 +1937,8 @@ static int drvNATConstructRedir(unsigned iInstance, PDRVNAT pThis, PCFGMNODE pCf
         /*
          * Call slirp about it.
          */
-        if (slirp_add_redirect(pThis->pNATState, fUDP, BindIP, iHostPort, GuestIP, iGuestPort) < 0)
+        ASMBitSet(pThis->pbmFwdPorts, (fUDP ? _64K : 0) + (uint16_t)iGuestPort);
+        if (slirp_add_redirect(pThis->aShards[0].pNATState, fUDP, BindIP, iHostPort, GuestIP, iGuestPort) < 0)
             return PDMDrvHlpVMSetError(pThis->pDrvIns, VERR_NAT_REDIR_SETUP, RT_SRC_POS,
                                        N_("NAT#%d: configuration error: failed to set up "
                                        "redirection of %d to %d. Probably a conflict with "
@@ -1457,24 +1964,45 @@ static DECLCALLBACK(void) drvNATDestruct(PPDMDRVINS pDrvIns)
     LogFlow(("drvNATDestruct:\n"));
     PDMDRV_CHECK_VERSIONS_RETURN_VOID(pDrvIns);
 
-    if (pThis->pNATState)
+    /* The other shards may hold mbufs from the first one's zones, so go backwards. */
+    for (uint32_t iShard = pThis->cShards; iShard-- > 0;)
     {
-        slirp_term(pThis->pNATState);
-        slirp_deregister_statistics(pThis->pNATState, pDrvIns);
+        PDRVNATSHARD pShard = &pThis->aShards[iShard];
+        if (pShard->pNATState)
+        {
+            slirp_term(pShard->pNATState);
+            if (iShard == 0)
+            {
+                slirp_deregister_statistics(pShard->pNATState, pDrvIns);
 #ifdef VBOX_WITH_STATISTICS
 # define DRV_PROFILE_COUNTER(name, dsc)     DEREGISTER_COUNTER(name, pThis)
 # define DRV_COUNTING_COUNTER(name, dsc)    DEREGISTER_COUNTER(name, pThis)
 # include "counters.h"
 #endif
-        pThis->pNATState = NULL;
+            }
+            pShard->pNATState = NULL;
+        }
+
+        RTReqQueueDestroy(pShard->hSlirpReqQueue);
+        pShard->hSlirpReqQueue = NIL_RTREQQUEUE;
+
+#ifndef RT_OS_WINDOWS
+        RTPipeClose(pShard->hPipeRead);
+        pShard->hPipeRead = NIL_RTPIPE;
+        RTPipeClose(pShard->hPipeWrite);
+        pShard->hPipeWrite = NIL_RTPIPE;
+#endif
     }
 
+    RTMemFree(pThis->pbmFwdPorts);
+    pThis->pbmFwdPorts = NULL;
+
+    for (unsigned iProto = 0; iProto < RT_ELEMENTS(pThis->apFwdFlows); iProto++)
+        RTAvlrU64Destroy(&pThis->apFwdFlows[iProto], drvNATFwdFlowFreeCallback, NULL);
+
     RTReqQueueDestroy(pThis->hHostResQueue);
     pThis->hHostResQueue = NIL_RTREQQUEUE;
 
-    RTReqQueueDestroy(pThis->hSlirpReqQueue);
-    pThis->hSlirpReqQueue = NIL_RTREQQUEUE;
-
     RTReqQueueDestroy(pThis->hUrgRecvReqQueue);
     pThis->hUrgRecvReqQueue = NIL_RTREQQUEUE;
 
@@ -1493,10 +2021,8 @@ static DECLCALLBACK(void) drvNATDestruct(PPDMDRVINS pDrvIns)
     if (RTCritSectIsInitialized(&pThis->XmitLock))
         RTCritSectDelete(&pThis->XmitLock);
 
-#ifndef RT_OS_WINDOWS
-    RTPipeClose(pThis->hPipeRead);
-    RTPipeClose(pThis->hPipeWrite);
-#endif
+    if (RTCritSectIsInitialized(&pThis->FwdFlowLock))
+        RTCritSectDelete(&pThis->FwdFlowLock);
 
 #ifdef RT_OS_DARWIN
     /* Cleanup the DNS watcher. */
@@ -1526,11 +2052,26 @@ static DECLCALLBACK(int) drvNATConstruct(PPDMDRVINS pDrvIns, PCFGMNODE pCfg, uin
      * Init the static parts.
      */
     pThis->pDrvIns                      = pDrvIns;
-    pThis->pNATState                    = NULL;
     pThis->pszTFTPPrefix                = NULL;
     pThis->pszBootFile                  = NULL;
     pThis->pszNextServer                = NULL;
-    pThis->hSlirpReqQueue               = NIL_RTREQQUEUE;
+    pThis->cShards                      = 0;
+    for (uint32_t iShard = 0; iShard < RT_ELEMENTS(pThis->aShards); iShard++)
+    {
+        PDRVNATSHARD pShard = &pThis->aShards[iShard];
+        pShard->pThis                   = pThis;
+        pShard->pNATState               = NULL;
+        pShard->hSlirpReqQueue          = NIL_RTREQQUEUE;
+        pShard->iShard                  = iShard;
+        pShard->enmLinkState            = PDMNETWORKLINKSTATE_UP;
+#ifndef RT_OS_WINDOWS
+        pShard->hPipeRead               = NIL_RTPIPE;
+        pShard->hPipeWrite              = NIL_RTPIPE;
+#endif
+    }
+    pThis->pbmFwdPorts                  = NULL;
+    pThis->apFwdFlows[0]                = NULL;
+    pThis->apFwdFlows[1]                = NULL;
     pThis->hUrgRecvReqQueue             = NIL_RTREQQUEUE;
     pThis->hHostResQueue                = NIL_RTREQQUEUE;
     pThis->EventRecv                    = NIL_RTSEMEVENT;
@@ -1576,6 +2117,7 @@ static DECLCALLBACK(int) drvNATConstruct(PPDMDRVINS pDrvIns, PCFGMNODE pCfg, uin
                               "SockRcv\0SockSnd\0TcpRcv\0TcpSnd\0"
                               "ICMPCacheLimit\0"
                               "SoMaxConnection\0"
+                              "EngineThreads\0"
 #ifdef VBOX_WITH_DNSMAPPING_IN_HOSTRESOLVER
                               "HostResolverMappings\0"
 #endif
@@ -1612,6 +2154,16 @@ static DECLCALLBACK(int) drvNATConstruct(PPDMDRVINS pDrvIns, PCFGMNODE pCfg, uin
     i32AliasMode |= (i32MainAliasMode & 0x4 ? 0x4 : 0);
     int i32SoMaxConn = 10;
     GET_S32(rc, pThis, pCfg, "SoMaxConnection", i32SoMaxConn);
+    /* Number of NAT engine instances, each with its own thread, the TCP and
+       UDP flows of the guest are spread over. */
+    uint32_t cShards = 1;
+    rc = CFGMR3QueryU32Def(pCfg, "EngineThreads", &cShards, 1);
+    if (RT_FAILURE(rc))
+        return PDMDRV_SET_ERROR(pDrvIns, rc, N_("NAT: configuration query for \"EngineThreads\" failed"));
+    if (cShards < 1 || cShards > DRVNAT_MAX_SHARDS)
+        return PDMDrvHlpVMSetError(pDrvIns, VERR_OUT_OF_RANGE, RT_SRC_POS,
+                                   N_("NAT#%d: configuration error: \"EngineThreads\" must be between 1 and %u"),
+                                   pDrvIns->iInstance, DRVNAT_MAX_SHARDS);
     /*
      * Query the network port interface.
      */
@@ -1641,43 +2193,58 @@ static DECLCALLBACK(int) drvNATConstruct(PPDMDRVINS pDrvIns, PCFGMNODE pCfg, uin
                                    N_("NAT#%d: Configuration error: network '%s' describes not a valid IPv4 network"),
                                    pDrvIns->iInstance, szNetwork);
 
+    pThis->pbmFwdPorts = (uint32_t *)RTMemAllocZ(2 * _64K / 8);
+    if (!pThis->pbmFwdPorts)
+        return VERR_NO_MEMORY;
+
     /*
-     * Initialize slirp.
+     * Initialize slirp, one instance per shard.
      */
-    rc = slirp_init(&pThis->pNATState, RT_H2N_U32(Network.u), Netmask.u,
-                    fPassDomain, !!fUseHostResolver, i32AliasMode,
-                    iIcmpCacheLimit, pThis);
+    for (uint32_t iShard = 0; iShard < cShards; iShard++)
+    {
+        rc = slirp_init(&pThis->aShards[iShard].pNATState, RT_H2N_U32(Network.u), Netmask.u,
+                        fPassDomain, !!fUseHostResolver, i32AliasMode,
+                        iIcmpCacheLimit, &pThis->aShards[iShard]);
+        if (RT_FAILURE(rc))
+            break;
+        pThis->cShards = iShard + 1;
+    }
     if (RT_SUCCESS(rc))
     {
-        slirp_set_dhcp_TFTP_prefix(pThis->pNATState, pThis->pszTFTPPrefix);
-        slirp_set_dhcp_TFTP_bootfile(pThis->pNATState, pThis->pszBootFile);
-        slirp_set_dhcp_next_server(pThis->pNATState, pThis->pszNextServer);
-        slirp_set_dhcp_dns_proxy(pThis->pNATState, !!fDNSProxy);
-        slirp_set_mtu(pThis->pNATState, MTU);
-        slirp_set_somaxconn(pThis->pNATState, i32SoMaxConn);
         char *pszBindIP = NULL;
         GET_STRING_ALLOC(rc, pThis, pCfg, "BindIP", pszBindIP);
-        rc = slirp_set_binding_address(pThis->pNATState, pszBindIP);
-        if (rc != 0 && pszBindIP && *pszBindIP)
-            LogRel(("NAT: Value of BindIP has been ignored\n"));
-
-        if(pszBindIP != NULL)
-            MMR3HeapFree(pszBindIP);
+        for (uint32_t iShard = 0; iShard < pThis->cShards; iShard++)
+        {
+            PNATState pNATState = pThis->aShards[iShard].pNATState;
+            slirp_set_dhcp_TFTP_prefix(pNATState, pThis->pszTFTPPrefix);
+            slirp_set_dhcp_TFTP_bootfile(pNATState, pThis->pszBootFile);
+            slirp_set_dhcp_next_server(pNATState, pThis->pszNextServer);
+            slirp_set_dhcp_dns_proxy(pNATState, !!fDNSProxy);
+            slirp_set_mtu(pNATState, MTU);
+            slirp_set_somaxconn(pNATState, i32SoMaxConn);
+            rc = slirp_set_binding_address(pNATState, pszBindIP);
+            if (rc != 0 && pszBindIP && *pszBindIP && iShard == 0)
+                LogRel(("NAT: Value of BindIP has been ignored\n"));
 #define SLIRP_SET_TUNING_VALUE(name, setter)                    \
             do                                                  \
             {                                                   \
                 int len = 0;                                    \
                 rc = CFGMR3QueryS32(pCfg, name, &len);    \
                 if (RT_SUCCESS(rc))                             \
-                    setter(pThis->pNATState, len);              \
+                    setter(pNATState, len);                     \
             } while(0)
 
-        SLIRP_SET_TUNING_VALUE("SockRcv", slirp_set_rcvbuf);
-        SLIRP_SET_TUNING_VALUE("SockSnd", slirp_set_sndbuf);
-        SLIRP_SET_TUNING_VALUE("TcpRcv", slirp_set_tcp_rcvspace);
-        SLIRP_SET_TUNING_VALUE("TcpSnd", slirp_set_tcp_sndspace);
+            SLIRP_SET_TUNING_VALUE("SockRcv", slirp_set_rcvbuf);
+            SLIRP_SET_TUNING_VALUE("SockSnd", slirp_set_sndbuf);
+            SLIRP_SET_TUNING_VALUE("TcpRcv", slirp_set_tcp_rcvspace);
+            SLIRP_SET_TUNING_VALUE("TcpSnd", slirp_set_tcp_sndspace);
+        }
+
+        if(pszBindIP != NULL)
+            MMR3HeapFree(pszBindIP);
 
-        slirp_register_statistics(pThis->pNATState, pDrvIns);
+        /* The counter names don't include the shard, so only the first one is registered. */
+        slirp_register_statistics(pThis->aShards[0].pNATState, pDrvIns);
 #ifdef VBOX_WITH_STATISTICS
 # define DRV_PROFILE_COUNTER(name, dsc)     REGISTER_COUNTER(name, pThis, STAMTYPE_PROFILE, STAMUNIT_TICKS_PER_CALL, dsc)
 # define DRV_COUNTING_COUNTER(name, dsc)    REGISTER_COUNTER(name, pThis, STAMTYPE_COUNTER, STAMUNIT_COUNT,          dsc)
@@ -1703,9 +2270,6 @@ static DECLCALLBACK(int) drvNATConstruct(PPDMDRVINS pDrvIns, PCFGMNODE pCfg, uin
             rc = PDMDrvHlpSSMRegisterLoadDone(pDrvIns, drvNATLoadDone);
             AssertLogRelRCReturn(rc, rc);
 
-            rc = RTReqQueueCreate(&pThis->hSlirpReqQueue);
-            AssertLogRelRCReturn(rc, rc);
-
             rc = RTReqQueueCreate(&pThis->hRecvReqQueue);
             AssertLogRelRCReturn(rc, rc);
 
@@ -1740,25 +2304,43 @@ static DECLCALLBACK(int) drvNATConstruct(PPDMDRVINS pDrvIns, PCFGMNODE pCfg, uin
             rc = RTCritSectInit(&pThis->XmitLock);
             AssertRCReturn(rc, rc);
 
+            rc = RTCritSectInit(&pThis->FwdFlowLock);
+            AssertRCReturn(rc, rc);
+
             char szTmp[128];
             RTStrPrintf(szTmp, sizeof(szTmp), "nat%d", pDrvIns->iInstance);
             PDMDrvHlpDBGFInfoRegister(pDrvIns, szTmp, "NAT info.", drvNATInfo);
 
+            for (uint32_t iShard = 0; iShard < pThis->cShards; iShard++)
+            {
+                PDRVNATSHARD pShard = &pThis->aShards[iShard];
+
+                rc = RTReqQueueCreate(&pShard->hSlirpReqQueue);
+                AssertLogRelRCReturn(rc, rc);
+
 #ifndef RT_OS_WINDOWS
-            /*
-             * Create the control pipe.
-             */
-            rc = RTPipeCreate(&pThis->hPipeRead, &pThis->hPipeWrite, 0 /*fFlags*/);
-            AssertRCReturn(rc, rc);
+                /*
+                 * Create the control pipe.
+                 */
+                rc = RTPipeCreate(&pShard->hPipeRead, &pShard->hPipeWrite, 0 /*fFlags*/);
+                AssertRCReturn(rc, rc);
 #else
-            pThis->hWakeupEvent = CreateEvent(NULL, FALSE, FALSE, NULL); /* auto-reset event */
-            slirp_register_external_event(pThis->pNATState, pThis->hWakeupEvent,
-                                          VBOX_WAKEUP_EVENT_INDEX);
+                pShard->hWakeupEvent = CreateEvent(NULL, FALSE, FALSE, NULL); /* auto-reset event */
+                slirp_register_external_event(pShard->pNATState, pShard->hWakeupEvent,
+                                              VBOX_WAKEUP_EVENT_INDEX);
 #endif
 
-            rc = PDMDrvHlpThreadCreate(pDrvIns, &pThis->pSlirpThread, pThis, drvNATAsyncIoThread,
-                                       drvNATAsyncIoWakeup, 128 * _1K, RTTHREADTYPE_IO, "NAT");
-            AssertRCReturn(rc, rc);
+                char szThreadName[16];
+                if (iShard == 0)
+                    RTStrCopy(szThreadName, sizeof(szThreadName), "NAT");
+                else
+                    RTStrPrintf(szThreadName, sizeof(szThreadName), "NAT%u", iShard);
+                rc = PDMDrvHlpThreadCreate(pDrvIns, &pShard->pSlirpThread, pShard, drvNATAsyncIoThread,
+                                           drvNATAsyncIoWakeup, 128 * _1K, RTTHREADTYPE_IO, szThreadName);
+                AssertRCReturn(rc, rc);
+            }
+            if (pThis->cShards > 1)
+                LogRel(("NAT#%d: Using %u engine threads\n", pDrvIns->iInstance, pThis->cShards));
 
             pThis->enmLinkState = pThis->enmLinkStateWant = PDMNETWORKLINKSTATE_UP;
 
@@ -1821,8 +2403,12 @@ static DECLCALLBACK(int) drvNATConstruct(PPDMDRVINS pDrvIns, PCFGMNODE pCfg, uin
         }
 
         /* failure path */
-        slirp_term(pThis->pNATState);
-        pThis->pNATState = NULL;
+        for (uint32_t iShard = pThis->cShards; iShard-- > 0;)
+        {
+            slirp_term(pThis->aShards[iShard].pNATState);
+            pThis->aShards[iShard].pNATState = NULL;
+        }
+        pThis->cShards = 0;
     }
     else
     {
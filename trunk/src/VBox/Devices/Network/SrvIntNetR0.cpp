@@ -136,6 +136,30 @@ typedef struct INTNETMACTAB
 /** Pointer to a MAC address .  */
 typedef INTNETMACTAB *PINTNETMACTAB;
 
+/**
+ * Read-only snapshot of a network's MAC address table.
+ *
+ * Interfaces switch their frames using this copy without taking the address
+ * spinlock for as long as INTNETSWSNAP::uGen matches
+ * INTNETNETWORK::uMacTabGen.  The snapshot is replaced (never modified) while
+ * owning the create/open/destroy mutex and the old one is only freed after
+ * every interface has left the switching section it may have entered using
+ * it, see intnetR0NetworkSwSnapSync.
+ */
+typedef struct INTNETSWSNAP
+{
+    /** The INTNETNETWORK::uMacTabGen value this is a copy of. */
+    uint32_t                uGen;
+    /** Explicit padding. */
+    uint32_t                u32Padding;
+    /** The MAC table copy, paEntries points to aEntries. */
+    INTNETMACTAB            MacTab;
+    /** The entries.  Variable sized array. */
+    INTNETMACTABENTRY       aEntries[1];
+} INTNETSWSNAP;
+/** Pointer to a MAC address table snapshot. */
+typedef INTNETSWSNAP *PINTNETSWSNAP;
+
 /**
  * Destination table.
  */
@@ -268,6 +292,9 @@ typedef struct INTNETIF
      * This is NULL when it's in use as a precaution against unserialized
      * transmitting.  This is grown when new interfaces are added to the network. */
     PINTNETDSTTAB volatile  pDstTab;
+    /** Switching section sequence number.  Odd while the interface is switching
+     * a frame using the MAC table snapshot (INTNETNETWORK::pSwSnap). */
+    uint32_t volatile       uSwSnapSeq;
     /** Pointer to the trunk's per interface data.  Can be NULL. */
     void                   *pvIfData;
     /** Header buffer for when we're carving GSO frames. */
@@ -344,6 +371,12 @@ typedef struct INTNETNETWORK
     /** MAC address table.
      * This doubles as interface collection. */
     INTNETMACTAB            MacTab;
+    /** MacTab generation number, incremented (while owning the address spinlock)
+     * whenever MacTab is modified.  See intnetR0NetworkMacTabChanged. */
+    uint32_t volatile       uMacTabGen;
+    /** The MacTab snapshot used for lockless switching of interface frames.
+     * Replaced while owning the create/open/destroy mutex.  Can be NULL. */
+    PINTNETSWSNAP volatile  pSwSnap;
 
     /** The network layer address cache. (Indexed by type, 0 entry isn't used.
      * Contains host addresses.  We don't let guests spoof them. */
@@ -413,6 +446,10 @@ typedef struct INTNET *PINTNET;
 *********************************************************************************************************************************/
 /** Pointer to the internal network instance data. */
 static PINTNET volatile g_pIntNet = NULL;
+#ifdef IN_INTNET_TESTCASE
+/** Testcase knob for disabling the lockless switching (benchmark baseline). */
+static bool volatile    g_fIntNetNoSwSnap = false;
+#endif
 
 static const struct INTNETOPENNETWORKFLAGS
 {
@@ -869,6 +906,148 @@ DECLINLINE(PINTNETMACTABENTRY) intnetR0NetworkFindMacAddrEntry(PINTNETNETWORK pN
 }
 
 
+/**
+ * Marks the MAC address table as changed, invalidating the snapshot used for
+ * lockless switching.
+ *
+ * The caller holds the MAC address table spinlock.
+ *
+ * @param   pNetwork        The network.
+ */
+DECLINLINE(void) intnetR0NetworkMacTabChanged(PINTNETNETWORK pNetwork)
+{
+    ASMAtomicIncU32(&pNetwork->uMacTabGen);
+}
+
+
+/**
+ * Enters the lockless switching section for a frame sent by @a pIfSender.
+ *
+ * @returns Pointer to the snapshot MAC table if it is current, the caller must
+ *          call intnetR0IfSwSnapLeave when done with it.  NULL if the caller
+ *          must use INTNETNETWORK::MacTab while owning the address spinlock.
+ * @param   pNetwork        The network.
+ * @param   pIfSender       The sending interface.  The caller must make sure
+ *                          there are no concurrent sends on it.
+ */
+DECLINLINE(PINTNETMACTAB) intnetR0IfSwSnapEnter(PINTNETNETWORK pNetwork, PINTNETIF pIfSender)
+{
+#ifdef IN_INTNET_TESTCASE
+    if (g_fIntNetNoSwSnap)
+        return NULL;
+#endif
+    ASMAtomicIncU32(&pIfSender->uSwSnapSeq);
+    PINTNETSWSNAP pSnap = ASMAtomicReadPtrT(&pNetwork->pSwSnap, PINTNETSWSNAP);
+    if (RT_LIKELY(   pSnap
+                  && pSnap->uGen == ASMAtomicReadU32(&pNetwork->uMacTabGen)))
+        return &pSnap->MacTab;
+    ASMAtomicIncU32(&pIfSender->uSwSnapSeq);
+    return NULL;
+}
+
+
+/**
+ * Leaves the lockless switching section entered by intnetR0IfSwSnapEnter.
+ *
+ * @param   pIfSender       The sending interface.
+ */
+DECLINLINE(void) intnetR0IfSwSnapLeave(PINTNETIF pIfSender)
+{
+    ASMAtomicIncU32(&pIfSender->uSwSnapSeq);
+}
+
+
+/**
+ * Waits for all the interfaces on the network to leave any lockless switching
+ * section they might've entered using a snapshot which is no longer current.
+ *
+ * Once this returns, nobody can pick up an interface or trunk that has been
+ * removed from the MAC table (or deactivated) before this call was made, so
+ * the normal busy waiting can be used to make sure they are idle.
+ *
+ * The caller must own the create/open/destroy mutex (the interface
+ * collection is stable), and must not be in a switching section itself.
+ *
+ * @param   pNetwork        The network.
+ */
+static void intnetR0NetworkSwSnapSync(PINTNETNETWORK pNetwork)
+{
+    uint32_t const cEntries = pNetwork->MacTab.cEntries;
+    for (uint32_t iIf = 0; iIf < cEntries; iIf++)
+    {
+        PINTNETIF       pIf  = pNetwork->MacTab.paEntries[iIf].pIf;
+        uint32_t const  uSeq = ASMAtomicReadU32(&pIf->uSwSnapSeq);
+        if (uSeq & 1)
+            while (ASMAtomicReadU32(&pIf->uSwSnapSeq) == uSeq)
+                RTThreadYield();
+    }
+}
+
+
+/**
+ * Replaces the MAC table snapshot with a fresh copy of INTNETNETWORK::MacTab.
+ *
+ * This must be called after removing or deactivating an interface or the trunk
+ * and before waiting for it to become idle.  If we're out of memory, the old
+ * snapshot remains, but as it's stale all interfaces will take the spinlock.
+ *
+ * The caller must own the create/open/destroy mutex.
+ *
+ * @param   pNetwork        The network.
+ */
+static void intnetR0NetworkSwSnapUpdate(PINTNETNETWORK pNetwork)
+{
+    /* The entry count only changes while owning the big mutex, so the
+       allocation size is good. */
+    uint32_t const  cEntries = pNetwork->MacTab.cEntries;
+    PINTNETSWSNAP   pNew     = (PINTNETSWSNAP)RTMemAlloc(RT_OFFSETOF(INTNETSWSNAP, aEntries[RT_MAX(cEntries, 1)]));
+    if (pNew)
+    {
+        RTSpinlockAcquire(pNetwork->hAddrSpinlock);
+        Assert(pNetwork->MacTab.cEntries == cEntries);
+        pNew->uGen             = pNetwork->uMacTabGen;
+        pNew->u32Padding       = 0;
+        pNew->MacTab           = pNetwork->MacTab;
+        pNew->MacTab.paEntries = &pNew->aEntries[0];
+        memcpy(&pNew->aEntries[0], pNetwork->MacTab.paEntries, cEntries * sizeof(pNew->aEntries[0]));
+        RTSpinlockRelease(pNetwork->hAddrSpinlock);
+
+        PINTNETSWSNAP pOld = ASMAtomicXchgPtrT(&pNetwork->pSwSnap, pNew, PINTNETSWSNAP);
+        intnetR0NetworkSwSnapSync(pNetwork);
+        RTMemFree(pOld);
+    }
+    else
+        intnetR0NetworkSwSnapSync(pNetwork);
+}
+
+
+/**
+ * Refreshes a stale MAC table snapshot if the create/open/destroy mutex is
+ * immediately available.
+ *
+ * This is used in places which modify the MAC table without owning the big
+ * mutex, and by the send path so the network recovers from changes made by
+ * the trunk and MAC address learning.
+ *
+ * @param   pIntNet         The instance data.
+ * @param   pNetwork        The network.
+ */
+static void intnetR0NetworkSwSnapTryUpdate(PINTNET pIntNet, PINTNETNETWORK pNetwork)
+{
+    if (!RTThreadPreemptIsEnabled(NIL_RTTHREAD))
+        return;
+    int rc = RTSemMutexRequest(pIntNet->hMtxCreateOpenDestroy, 0 /*cMillies*/);
+    if (RT_SUCCESS(rc))
+    {
+        PINTNETSWSNAP pSnap = ASMAtomicReadPtrT(&pNetwork->pSwSnap, PINTNETSWSNAP);
+        if (   !pSnap
+            || pSnap->uGen != ASMAtomicReadU32(&pNetwork->uMacTabGen))
+            intnetR0NetworkSwSnapUpdate(pNetwork);
+        RTSemMutexRelease(pIntNet->hMtxCreateOpenDestroy);
+    }
+}
+
+
 /**
  * Checks if the IPv6 address is a good interface address.
  * @returns true/false.
@@ -1820,29 +1999,23 @@ static INTNETSWDECISION intnetR0NetworkPreSwitchUnicast(PINTNETNETWORK pNetwork,
 
 
 /**
- * Switch a unicast MAC address and return a destination table.
+ * Worker for intnetR0NetworkSwitchUnicast that does the actual switching.
  *
  * @returns INTNETSWDECISION_DROP, INTNETSWDECISION_TRUNK,
  *          INTNETSWDECISION_INTNET or INTNETSWDECISION_BROADCAST (misnomer).
  * @param   pNetwork            The network to switch on.
+ * @param   pTab                The MAC address table to use, i.e. either the
+ *                              snapshot or the network one (owning the
+ *                              address spinlock).
  * @param   fSrc                The frame source.
- * @param   pIfSender           The sender interface, NULL if trunk.  Used to
- *                              prevent sending an echo to the sender.
+ * @param   pIfSender           The sender interface, NULL if trunk.
  * @param   pDstAddr            The destination address of the frame.
  * @param   pDstTab             The destination output table.
  */
-static INTNETSWDECISION intnetR0NetworkSwitchUnicast(PINTNETNETWORK pNetwork, uint32_t fSrc, PINTNETIF pIfSender,
-                                                     PCRTMAC pDstAddr, PINTNETDSTTAB pDstTab)
+static INTNETSWDECISION intnetR0NetworkSwitchUnicastWorker(PINTNETNETWORK pNetwork, PINTNETMACTAB pTab, uint32_t fSrc,
+                                                           PINTNETIF pIfSender, PCRTMAC pDstAddr, PINTNETDSTTAB pDstTab)
 {
-    AssertPtr(pDstTab);
-    Assert(!intnetR0IsMacAddrMulticast(pDstAddr));
-
-    /*
-     * Grab the spinlock first and do the switching.
-     */
-    PINTNETMACTAB   pTab = &pNetwork->MacTab;
-    RTSpinlockAcquire(pNetwork->hAddrSpinlock);
-
+    NOREF(pNetwork);
     pDstTab->fTrunkDst  = 0;
     pDstTab->pTrunk     = 0;
     pDstTab->cIfs       = 0;
@@ -1878,7 +2051,7 @@ static INTNETSWDECISION intnetR0NetworkSwitchUnicast(PINTNETNETWORK pNetwork, ui
     /* Network only promicuous mode ifs should see related trunk traffic. */
     if (   cExactHits
         && fSrc
-        && pNetwork->MacTab.cPromiscuousNoTrunkEntries)
+        && pTab->cPromiscuousNoTrunkEntries)
     {
         iIfMac = pTab->cEntries;
         while (iIfMac-- > 0)
@@ -1927,7 +2100,6 @@ static INTNETSWDECISION intnetR0NetworkSwitchUnicast(PINTNETNETWORK pNetwork, ui
         intnetR0BusyIncTrunk(pTrunk);
     }
 
-    RTSpinlockRelease(pNetwork->hAddrSpinlock);
     return pDstTab->cIfs
          ? (!pDstTab->fTrunkDst ? INTNETSWDECISION_INTNET : INTNETSWDECISION_BROADCAST)
          : (!pDstTab->fTrunkDst ? INTNETSWDECISION_DROP   : INTNETSWDECISION_TRUNK);
@@ -1935,26 +2107,60 @@ static INTNETSWDECISION intnetR0NetworkSwitchUnicast(PINTNETNETWORK pNetwork, ui
 
 
 /**
- * Create a destination table for a broadcast frame.
+ * Switch a unicast MAC address and return a destination table.
  *
- * @returns INTNETSWDECISION_BROADCAST.
+ * Frames from interfaces are switched using the MAC table snapshot when it's
+ * current, everything else takes the address spinlock.
+ *
+ * @returns INTNETSWDECISION_DROP, INTNETSWDECISION_TRUNK,
+ *          INTNETSWDECISION_INTNET or INTNETSWDECISION_BROADCAST (misnomer).
  * @param   pNetwork            The network to switch on.
  * @param   fSrc                The frame source.
  * @param   pIfSender           The sender interface, NULL if trunk.  Used to
  *                              prevent sending an echo to the sender.
+ * @param   pDstAddr            The destination address of the frame.
  * @param   pDstTab             The destination output table.
  */
-static INTNETSWDECISION intnetR0NetworkSwitchBroadcast(PINTNETNETWORK pNetwork, uint32_t fSrc, PINTNETIF pIfSender,
-                                                       PINTNETDSTTAB pDstTab)
+static INTNETSWDECISION intnetR0NetworkSwitchUnicast(PINTNETNETWORK pNetwork, uint32_t fSrc, PINTNETIF pIfSender,
+                                                     PCRTMAC pDstAddr, PINTNETDSTTAB pDstTab)
 {
     AssertPtr(pDstTab);
+    Assert(!intnetR0IsMacAddrMulticast(pDstAddr));
+
+    INTNETSWDECISION enmSwDecision;
+    PINTNETMACTAB    pSnapTab;
+    if (   pIfSender
+        && (pSnapTab = intnetR0IfSwSnapEnter(pNetwork, pIfSender)) != NULL)
+    {
+        enmSwDecision = intnetR0NetworkSwitchUnicastWorker(pNetwork, pSnapTab, fSrc, pIfSender, pDstAddr, pDstTab);
+        intnetR0IfSwSnapLeave(pIfSender);
+    }
+    else
+    {
+        RTSpinlockAcquire(pNetwork->hAddrSpinlock);
+        enmSwDecision = intnetR0NetworkSwitchUnicastWorker(pNetwork, &pNetwork->MacTab, fSrc, pIfSender, pDstAddr, pDstTab);
+        RTSpinlockRelease(pNetwork->hAddrSpinlock);
+    }
+    return enmSwDecision;
+}
 
-    /*
-     * Grab the spinlock first and record all active interfaces.
-     */
-    PINTNETMACTAB   pTab    = &pNetwork->MacTab;
-    RTSpinlockAcquire(pNetwork->hAddrSpinlock);
 
+/**
+ * Worker for intnetR0NetworkSwitchBroadcast that records all the active
+ * interfaces.
+ *
+ * @param   pNetwork            The network to switch on.
+ * @param   pTab                The MAC address table to use, i.e. either the
+ *                              snapshot or the network one (owning the
+ *                              address spinlock).
+ * @param   fSrc                The frame source.
+ * @param   pIfSender           The sender interface, NULL if trunk.
+ * @param   pDstTab             The destination output table.
+ */
+static void intnetR0NetworkSwitchBroadcastWorker(PINTNETNETWORK pNetwork, PINTNETMACTAB pTab, uint32_t fSrc,
+                                                 PINTNETIF pIfSender, PINTNETDSTTAB pDstTab)
+{
+    NOREF(pNetwork);
     pDstTab->fTrunkDst  = 0;
     pDstTab->pTrunk     = 0;
     pDstTab->cIfs       = 0;
@@ -1988,8 +2194,37 @@ static INTNETSWDECISION intnetR0NetworkSwitchBroadcast(PINTNETNETWORK pNetwork,
         pDstTab->pTrunk = pTrunk;
         intnetR0BusyIncTrunk(pTrunk);
     }
+}
 
-    RTSpinlockRelease(pNetwork->hAddrSpinlock);
+
+/**
+ * Create a destination table for a broadcast frame.
+ *
+ * @returns INTNETSWDECISION_BROADCAST.
+ * @param   pNetwork            The network to switch on.
+ * @param   fSrc                The frame source.
+ * @param   pIfSender           The sender interface, NULL if trunk.  Used to
+ *                              prevent sending an echo to the sender.
+ * @param   pDstTab             The destination output table.
+ */
+static INTNETSWDECISION intnetR0NetworkSwitchBroadcast(PINTNETNETWORK pNetwork, uint32_t fSrc, PINTNETIF pIfSender,
+                                                       PINTNETDSTTAB pDstTab)
+{
+    AssertPtr(pDstTab);
+
+    PINTNETMACTAB pSnapTab;
+    if (   pIfSender
+        && (pSnapTab = intnetR0IfSwSnapEnter(pNetwork, pIfSender)) != NULL)
+    {
+        intnetR0NetworkSwitchBroadcastWorker(pNetwork, pSnapTab, fSrc, pIfSender, pDstTab);
+        intnetR0IfSwSnapLeave(pIfSender);
+    }
+    else
+    {
+        RTSpinlockAcquire(pNetwork->hAddrSpinlock);
+        intnetR0NetworkSwitchBroadcastWorker(pNetwork, &pNetwork->MacTab, fSrc, pIfSender, pDstTab);
+        RTSpinlockRelease(pNetwork->hAddrSpinlock);
+    }
     return INTNETSWDECISION_BROADCAST;
 }
 
@@ -2972,26 +3207,10 @@ DECLINLINE(bool) intnetR0TrunkIfCanHandleGsoFrame(PINTNETTRUNKIF pThis, PINTNETS
  */
 static uint16_t computeIPv6FullChecksum(PCRTNETIPV6 pIpHdr)
 {
-    uint16_t const *data;
-    int len         = RT_BE2H_U16(pIpHdr->ip6_plen);
-    uint32_t sum    = RTNetIPv6PseudoChecksum(pIpHdr);
-
-    /* add the payload */
-    data = (uint16_t *) (pIpHdr + 1);
-    while(len > 1)
-    {
-        sum += *(data);
-        data++;
-        len -= 2;
-    }
-
-    if(len > 0)
-        sum += *((uint8_t *) data);
-
-    while(sum >> 16)
-        sum = (sum & 0xffff) + (sum >> 16);
-
-    return (uint16_t) ~sum;
+    bool     fOdd = false;
+    uint32_t sum  = RTNetIPv6PseudoChecksum(pIpHdr);
+    sum = RTNetIPv4AddDataChecksum(pIpHdr + 1, RT_BE2H_U16(pIpHdr->ip6_plen), sum, &fOdd);
+    return RTNetIPv4FinalizeChecksum(sum);
 }
 
 
@@ -3973,6 +4192,7 @@ static INTNETSWDECISION intnetR0NetworkSend(PINTNETNETWORK pNetwork, PINTNETIF p
         if (pIfEntry)
             pIfEntry->MacAddr = EthHdr.SrcMac;
         pIfSender->MacAddr    = EthHdr.SrcMac;
+        intnetR0NetworkMacTabChanged(pNetwork);
 
         RTSpinlockRelease(pNetwork->hAddrSpinlock);
     }
@@ -4125,6 +4345,15 @@ INTNETR0DECL(int) IntNetR0IfSend(INTNETIFHANDLE hIf, PSUPDRVSESSION pSession)
              */
             Assert(!pIf->pDstTab);
             ASMAtomicWritePtr(&pIf->pDstTab, pDstTab);
+
+            /*
+             * Refresh the switching snapshot if the MAC table was changed
+             * without the big mutex (address learning, trunk reports).
+             */
+            PINTNETSWSNAP pSnap = ASMAtomicReadPtrT(&pNetwork->pSwSnap, PINTNETSWSNAP);
+            if (RT_UNLIKELY(   !pSnap
+                            || pSnap->uGen != ASMAtomicReadU32(&pNetwork->uMacTabGen)))
+                intnetR0NetworkSwSnapTryUpdate(pIntNet, pNetwork);
         }
         else
             rc = VERR_INTERNAL_ERROR_4;
@@ -4342,10 +4571,13 @@ INTNETR0DECL(int) IntNetR0IfSetPromiscuousMode(INTNETIFHANDLE hIf, PSUPDRVSESSIO
                 }
                 Assert(pNetwork->MacTab.cPromiscuousEntries        <= pNetwork->MacTab.cEntries);
                 Assert(pNetwork->MacTab.cPromiscuousNoTrunkEntries <= pNetwork->MacTab.cEntries);
+                intnetR0NetworkMacTabChanged(pNetwork);
             }
         }
 
         RTSpinlockRelease(pNetwork->hAddrSpinlock);
+
+        intnetR0NetworkSwSnapTryUpdate(pIntNet, pNetwork);
     }
     else
         rc = VERR_WRONG_ORDER;
@@ -4422,6 +4654,7 @@ INTNETR0DECL(int) IntNetR0IfSetMacAddress(INTNETIFHANDLE hIf, PSUPDRVSESSION pSe
                 pEntry->MacAddr = *pMac;
             pIf->MacAddr        = *pMac;
             pIf->fMacSet        = true;
+            intnetR0NetworkMacTabChanged(pNetwork);
 
             /* Grab a busy reference to the trunk so we release the lock before notifying it. */
             pTrunk = pNetwork->MacTab.pTrunk;
@@ -4431,6 +4664,8 @@ INTNETR0DECL(int) IntNetR0IfSetMacAddress(INTNETIFHANDLE hIf, PSUPDRVSESSION pSe
 
         RTSpinlockRelease(pNetwork->hAddrSpinlock);
 
+        intnetR0NetworkSwSnapTryUpdate(pIntNet, pNetwork);
+
         if (pTrunk)
         {
             Log(("IntNetR0IfSetMacAddress: pfnNotifyMacAddress hIf=%RX32\n", hIf));
@@ -4501,6 +4736,7 @@ static int intnetR0NetworkSetIfActive(PINTNETNETWORK pNetwork, PINTNETIF pIf, bo
         {
             pEntry->fActive = fActive;
             pIf->fActive    = fActive;
+            intnetR0NetworkMacTabChanged(pNetwork);
 
             if (fActive)
             {
@@ -4530,6 +4766,13 @@ static int intnetR0NetworkSetIfActive(PINTNETNETWORK pNetwork, PINTNETIF pIf, bo
 
     RTSpinlockRelease(pNetwork->hAddrSpinlock);
 
+    /*
+     * Publish the change to the lockless switching.  When deactivating, this
+     * makes sure nobody is still picking up the interface or trunk from the
+     * old snapshot before we or our caller wait for them to idle.
+     */
+    intnetR0NetworkSwSnapUpdate(pNetwork);
+
     /*
      * Tell the trunk if necessary.
      * The wait for !busy is for the Solaris streams trunk driver (mostly).
@@ -4944,6 +5187,7 @@ static DECLCALLBACK(void) intnetR0IfDestruct(void *pvObj, void *pvUser1, void *p
                             &pNetwork->MacTab.paEntries[iIf + 1],
                             (pNetwork->MacTab.cEntries - iIf - 1) * sizeof(pNetwork->MacTab.paEntries[0]));
                 pNetwork->MacTab.cEntries--;
+                intnetR0NetworkMacTabChanged(pNetwork);
                 break;
             }
 
@@ -4966,6 +5210,9 @@ static DECLCALLBACK(void) intnetR0IfDestruct(void *pvObj, void *pvUser1, void *p
 
         RTSpinlockRelease(pNetwork->hAddrSpinlock);
 
+        /* Make sure the lockless switching no longer sees us. */
+        intnetR0NetworkSwSnapUpdate(pNetwork);
+
         /* Notify the trunk about the interface being destroyed. */
         if (pTrunk && pTrunk->pIfPort)
             pTrunk->pIfPort->pfnDisconnectInterface(pTrunk->pIfPort, pIf->pvIfData);
@@ -5127,6 +5374,7 @@ static int intnetR0NetworkCreateIf(PINTNETNETWORK pNetwork, PSUPDRVSESSION pSess
     pIf->hRecvInSpinlock    = NIL_RTSPINLOCK;
     pIf->cBusy              = 0;
     //pIf->pDstTab          = NULL;
+    //pIf->uSwSnapSeq       = 0;
     //pIf->pvIfData         = NULL;
 
     for (int i = kIntNetAddrType_Invalid + 1; i < kIntNetAddrType_End && RT_SUCCESS(rc); i++)
@@ -5183,6 +5431,7 @@ static int intnetR0NetworkCreateIf(PINTNETNETWORK pNetwork, PSUPDRVSESSION pSess
 
                     pNetwork->MacTab.cEntries = iIf + 1;
                     pIf->pNetwork = pNetwork;
+                    intnetR0NetworkMacTabChanged(pNetwork);
 
                     /*
                      * Grab a busy reference (paranoia) to the trunk before releasing
@@ -5194,6 +5443,8 @@ static int intnetR0NetworkCreateIf(PINTNETNETWORK pNetwork, PSUPDRVSESSION pSess
 
                     RTSpinlockRelease(pNetwork->hAddrSpinlock);
 
+                    intnetR0NetworkSwSnapUpdate(pNetwork);
+
                     if (pTrunk)
                     {
                         Log(("intnetR0NetworkCreateIf: pfnConnectInterface hIf=%RX32\n", pIf->hIf));
@@ -5265,6 +5516,7 @@ static DECLCALLBACK(void) intnetR0TrunkIfPortReportMacAddress(PINTNETTRUNKSWPORT
 
         pNetwork->MacTab.HostMac = *pMacAddr;
         pThis->MacAddr           = *pMacAddr;
+        intnetR0NetworkMacTabChanged(pNetwork);
 
         RTSpinlockRelease(pNetwork->hAddrSpinlock);
     }
@@ -5293,6 +5545,7 @@ static DECLCALLBACK(void) intnetR0TrunkIfPortReportPromiscuousMode(PINTNETTRUNKS
                                              || (pNetwork->fFlags & INTNET_OPEN_FLAGS_TRUNK_HOST_PROMISC_MODE);
         pNetwork->MacTab.fHostPromiscuousEff  = pNetwork->MacTab.fHostPromiscuousReal
                                              && (pNetwork->fFlags & INTNET_OPEN_FLAGS_PROMISC_ALLOW_TRUNK_HOST);
+        intnetR0NetworkMacTabChanged(pNetwork);
 
         RTSpinlockRelease(pNetwork->hAddrSpinlock);
     }
@@ -5374,6 +5627,7 @@ static DECLCALLBACK(void) intnetR0TrunkIfPortDisconnect(PINTNETTRUNKSWPORT pSwit
 
             RTSpinlockAcquire(pNetwork->hAddrSpinlock);
             pNetwork->MacTab.pTrunk = NULL;
+            intnetR0NetworkMacTabChanged(pNetwork);
             RTSpinlockRelease(pNetwork->hAddrSpinlock);
 
             intnetR0TrunkIfDestroy(pThis, pNetwork);
@@ -5651,6 +5905,13 @@ static void intnetR0TrunkIfDestroy(PINTNETTRUNKIF pThis, PINTNETNETWORK pNetwork
     Assert(pThis->pNetwork == pNetwork);
     AssertPtrNull(pThis->pIfPort);
 
+    /*
+     * The caller has zapped the MacTab trunk pointer, make sure the lockless
+     * switching isn't still picking it up from the snapshot.
+     */
+    Assert(pNetwork->MacTab.pTrunk != pThis);
+    intnetR0NetworkSwSnapUpdate(pNetwork);
+
     /*
      * The interface has already been deactivated, we just to wait for
      * it to become idle before we can disconnect and release it.
@@ -5843,6 +6104,7 @@ static int intnetR0NetworkCreateTrunkIf(PINTNETNETWORK pNetwork, PSUPDRVSESSION
             pNetwork->MacTab.fWirePromiscuousEff  = pNetwork->MacTab.fWirePromiscuousReal
                                                  && (pNetwork->fFlags & INTNET_OPEN_FLAGS_PROMISC_ALLOW_TRUNK_WIRE);
             pNetwork->MacTab.fWireActive          = false;
+            intnetR0NetworkMacTabChanged(pNetwork);
 
 #ifdef IN_RING0 /* (testcase is ring-3) */
             /*
@@ -5875,6 +6137,7 @@ static int intnetR0NetworkCreateTrunkIf(PINTNETNETWORK pNetwork, PSUPDRVSESSION
 #endif /* IN_RING3 */
 
             pNetwork->MacTab.pTrunk      = NULL;
+            intnetR0NetworkMacTabChanged(pNetwork);
         }
 
         /* bail out and clean up. */
@@ -5940,9 +6203,13 @@ static DECLCALLBACK(void) intnetR0NetworkDestruct(void *pvObj, void *pvUser1, vo
 
     pNetwork->MacTab.fHostActive = false;
     pNetwork->MacTab.fWireActive = false;
+    intnetR0NetworkMacTabChanged(pNetwork);
 
     RTSpinlockRelease(pNetwork->hAddrSpinlock);
 
+    /* Make sure the lockless switching has caught up before waiting. */
+    intnetR0NetworkSwSnapUpdate(pNetwork);
+
     /* Wait for all the interfaces to quiesce.  (Interfaces cannot be
        removed / added since we're holding the big lock.) */
     if (pTrunk)
@@ -5976,6 +6243,7 @@ static DECLCALLBACK(void) intnetR0NetworkDestruct(void *pvObj, void *pvUser1, vo
      * trunk after we've left it.  Note that this might take a while...
      */
     pNetwork->MacTab.pTrunk = NULL;
+    intnetR0NetworkMacTabChanged(pNetwork);
 
     RTSpinlockRelease(pNetwork->hAddrSpinlock);
 
@@ -6010,6 +6278,8 @@ static DECLCALLBACK(void) intnetR0NetworkDestruct(void *pvObj, void *pvUser1, vo
     pNetwork->hAddrSpinlock = NIL_RTSPINLOCK;
     RTMemFree(pNetwork->MacTab.paEntries);
     pNetwork->MacTab.paEntries = NULL;
+    RTMemFree(pNetwork->pSwSnap);
+    pNetwork->pSwSnap = NULL;
     for (int i = kIntNetAddrType_Invalid + 1; i < kIntNetAddrType_End; i++)
         intnetR0IfAddrCacheDestroy(&pNetwork->aAddrBlacklist[i]);
     RTMemFree(pNetwork);
@@ -6171,7 +6441,10 @@ static int intnetR0AdaptOpenNetworkFlags(PINTNETNETWORK pNetwork, uint32_t fFlag
             }
         }
 
+        intnetR0NetworkMacTabChanged(pNetwork);
         RTSpinlockRelease(pNetwork->hAddrSpinlock);
+
+        intnetR0NetworkSwSnapUpdate(pNetwork);
     }
 
     return VINF_SUCCESS;
@@ -6362,6 +6635,8 @@ static int intnetR0CreateNetwork(PINTNET pIntNet, PSUPDRVSESSION pSession, const
     pNetwork->MacTab.fWirePromiscuousEff    = false;
     pNetwork->MacTab.fWireActive            = false;
     pNetwork->MacTab.pTrunk                 = NULL;
+    //pNetwork->uMacTabGen                  = 0;
+    //pNetwork->pSwSnap                     = NULL;
     pNetwork->hEvtBusyIf                    = NIL_RTSEMEVENT;
     pNetwork->pIntNet                       = pIntNet;
     //pNetwork->pvObj                       = NULL;
@@ -70,6 +70,7 @@ int slirp_can_output(void * pvUser);
 void slirp_output(void * pvUser, struct mbuf *m, const uint8_t *pkt, int pkt_len);
 void slirp_output_pending(void * pvUser);
 void slirp_urg_output(void *pvUser, struct mbuf *, const uint8_t *pu8Buf, int cb);
+void slirp_fwd_tcp_closed(void *pvUser, uint32_t uRemoteIp, uint16_t uRemotePort, uint16_t uGuestPort);
 void slirp_post_sent(PNATState pData, void *pvArg);
 
 int slirp_call(void *pvUser, PRTREQ *ppReq, RTMSINTERVAL cMillies,
@@ -80,6 +81,7 @@ int slirp_call_hostres(void *pvUser, PRTREQ *ppReq, RTMSINTERVAL cMillies,
 
 
 void slirp_update_guest_addr_guess(PNATState pData, uint32_t guess, const char *msg);
+void slirp_arp_learn(PNATState pData, uint32_t ip, const uint8_t *ether);
 
 int slirp_add_redirect(PNATState pData, int is_udp, struct in_addr host_addr,
                 int host_port, struct in_addr guest_addr,
@@ -163,6 +165,7 @@ void slirp_register_external_event(PNATState pData, HANDLE hEvent, int index);
 #endif /* RT_OS_WINDOWS */
 
 struct mbuf *slirp_ext_m_get(PNATState pData, size_t cbMin, void **ppvBuf, size_t *pcbBuf);
+struct mbuf *slirp_ext_m_wrap(PNATState pData, void *pvBuf, size_t cbBuf, size_t cbAlloc, bool fCsumValid);
 void slirp_ext_m_free(PNATState pData, struct mbuf *, uint8_t *pu8Buf);
 
 /*
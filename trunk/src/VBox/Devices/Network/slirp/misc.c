@@ -419,10 +419,16 @@ void uma_zfree_arg(uma_zone_t zone, void *mem, void *flags)
     NOREF(flags);
 # endif
 
-    RTCritSectEnter(&zone->csZone);
+    /*
+     * The item goes back to the zone it was allocated from.  When the driver
+     * runs several engine instances a frame allocated from the first one may
+     * be consumed and freed by another, hence the zone passed in is ignored.
+     */
     it = &((struct item *)mem)[-1];
     Assert((it->magic == ITEM_MAGIC));
-    Assert((zone->magic == ZONE_MAGIC && zone == it->zone));
+    Assert((it->zone && it->zone->magic == ZONE_MAGIC));
+    zone = it->zone;
+    RTCritSectEnter(&zone->csZone);
 
     zone->pfFree(mem,  0, 0);
     RTCritSectLeave(&zone->csZone);
@@ -523,6 +529,57 @@ struct mbuf *slirp_ext_m_get(PNATState pData, size_t cbMin, void **ppvBuf, size_
     return m;
 }
 
+/**
+ * Frees the storage of an mbuf created by slirp_ext_m_wrap.
+ */
+static void slirp_ext_m_wrap_free(void *pvBuf, void *pvArgs)
+{
+    NOREF(pvArgs);
+    LogFlowFunc(("ENTER: pvBuf:%p\n", pvBuf));
+    RTMemFree(pvBuf);
+}
+
+/**
+ * Wraps a heap buffer holding an ethernet frame in an mbuf without copying it.
+ *
+ * The mbuf takes over the buffer and frees it with RTMemFree when the last
+ * reference goes away.  The reference counter lives in the buffer right after
+ * the frame, so the allocation must be at least
+ * RT_ALIGN_Z(cbBuf, sizeof(uint32_t)) + sizeof(uint32_t) bytes.
+ *
+ * @returns The mbuf on success, NULL if out of mbufs or the buffer is too
+ *          small (the caller still owns the buffer then).
+ * @param   pData       The NAT state.
+ * @param   pvBuf       The frame, allocated by RTMemAlloc.
+ * @param   cbBuf       The size of the frame.
+ * @param   cbAlloc     The size of the allocation.
+ * @param   fCsumValid  Whether the caller vouches for the TCP/UDP checksum
+ *                      (the guest offloaded it), so the stack skips checking.
+ */
+struct mbuf *slirp_ext_m_wrap(PNATState pData, void *pvBuf, size_t cbBuf, size_t cbAlloc, bool fCsumValid)
+{
+    struct mbuf *m;
+    size_t const offRefCnt = RT_ALIGN_Z(cbBuf, sizeof(uint32_t));
+    LogFlowFunc(("ENTER: pvBuf:%p, cbBuf:%zu, cbAlloc:%zu\n", pvBuf, cbBuf, cbAlloc));
+
+    AssertReturn(offRefCnt + sizeof(u_int) <= cbAlloc, NULL);
+    AssertReturn(cbBuf <= INT32_MAX, NULL);
+
+    m = m_gethdr(pData, M_NOWAIT, MT_HEADER);
+    if (m == NULL)
+    {
+        LogFlowFunc(("LEAVE: NULL\n"));
+        return NULL;
+    }
+    m->m_ext.ref_cnt = (u_int *)((uint8_t *)pvBuf + offRefCnt);
+    m_extadd(pData, m, (caddr_t)pvBuf, (u_int)cbBuf, slirp_ext_m_wrap_free, NULL, 0, EXT_EXTREF);
+    m->m_len = (int)cbBuf;
+    if (fCsumValid)
+        m->m_pkthdr.csum_flags |= CSUM_DATA_VALID;
+    LogFlowFunc(("LEAVE: %p\n", m));
+    return m;
+}
+
 void slirp_ext_m_free(PNATState pData, struct mbuf *m, uint8_t *pu8Buf)
 {
 
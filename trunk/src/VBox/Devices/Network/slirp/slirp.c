@@ -1944,6 +1944,19 @@ int slirp_arp_cache_update_or_add(PNATState pData, uint32_t dst, const uint8_t *
     return 0;
 }
 
+/**
+ * Records the source addresses of a frame the guest sent.
+ *
+ * Engine instances that only get a subset of the guest's flows do not see
+ * its ARP and DHCP traffic, so they learn its Ethernet address this way.
+ */
+void slirp_arp_learn(PNATState pData, uint32_t ip, const uint8_t *ether)
+{
+    if ((ip & RT_H2N_U32(pData->netmask)) != pData->special_addr.s_addr)
+        return;
+    slirp_arp_cache_update_or_add(pData, ip, ether);
+}
+
 
 void slirp_set_mtu(PNATState pData, int mtu)
 {
@@ -195,6 +195,9 @@ sofree(PNATState pData, struct socket *so)
         LogFlowFunc(("LEAVE:%R[natsock] postponed deletion\n", so));
         return;
     }
+    if (so->fPortFwdAccepted)
+        slirp_fwd_tcp_closed(pData->pvUser, so->so_faddr.s_addr,
+                             RT_N2H_U16(so->so_fport), RT_N2H_U16(so->so_lport));
     /**
      * Check that we don't freeng socket with tcbcb
      */
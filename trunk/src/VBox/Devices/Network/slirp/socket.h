@@ -123,6 +123,10 @@ struct socket
      *  alter value ''fShouldBeRemoved'' to 1, else we do removal.
      */
     int fShouldBeRemoved;
+    /** Set on TCP sockets accepted for a port-forwarding rule, ''sofree''
+     *  reports them to the driver with slirp_fwd_tcp_closed.
+     *  @note: it's used like a bool, see above. */
+    int fPortFwdAccepted;
 };
 
 # define SOCKET_LOCK(so) do {} while (0)
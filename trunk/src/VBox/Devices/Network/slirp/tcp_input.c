@@ -402,7 +402,8 @@ tcp_input(PNATState pData, register struct mbuf *m, int iphlen, struct socket *i
     /* keep checksum for ICMP reply
      * ti->ti_sum = cksum(m, len);
      * if (ti->ti_sum) { */
-    if (cksum(m, len))
+    if (   !(m->m_pkthdr.csum_flags & CSUM_DATA_VALID)
+        && cksum(m, len))
     {
         tcpstat.tcps_rcvbadsum++;
         LogFlowFunc(("%d -> drop\n", __LINE__));
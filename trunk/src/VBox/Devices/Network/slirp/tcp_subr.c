@@ -525,6 +525,7 @@ tcp_connect(PNATState pData, struct socket *inso)
         }
         so->so_laddr = inso->so_laddr;
         so->so_lport = inso->so_lport;
+        so->fPortFwdAccepted = 1;
     }
 
     if (so->so_laddr.s_addr == INADDR_ANY)
@@ -0,0 +1,851 @@
+/* $Id$ */
+/** @file
+ * Virtio-net Testcase - Drives the device like a guest driver would (a bit hackish).
+ *
+ * Includes the device code and runs it against a fake set of device helpers
+ * backed by a flat chunk of "guest" memory and a fake network driver.
+ */
+
+/*
+ * Copyright (C) 2016 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ */
+
+
+/*********************************************************************************************************************************
+*   Header Files                                                                                                                 *
+*********************************************************************************************************************************/
+#include "../DevVirtioNet.cpp"
+#undef LOG_GROUP
+#undef INSTANCE
+#include "../../VirtIO/Virtio.cpp"
+
+#include <iprt/critsect.h>
+#include <iprt/initterm.h>
+#include <iprt/test.h>
+
+
+/*********************************************************************************************************************************
+*   Defined Constants And Macros                                                                                                 *
+*********************************************************************************************************************************/
+/** Size of the fake guest memory. */
+#define TST_GUEST_MEM_SIZE      _1M
+/** Where the rings of virtqueue N start in guest memory (three pages each). */
+#define TST_RING_ADDR(a_iQueue) (0x10000 + (a_iQueue) * 0x4000)
+/** Where the buffers handed to the device start in guest memory. */
+#define TST_BUF_ADDR            0x80000
+/** Size of each buffer handed to the device. */
+#define TST_BUF_SIZE            0x800
+
+
+/*********************************************************************************************************************************
+*   Structures and Typedefs                                                                                                      *
+*********************************************************************************************************************************/
+/**
+ * The guest driver's view of a virtqueue.
+ */
+typedef struct TSTRING
+{
+    /** The virtqueue index. */
+    uint16_t    iQueue;
+    /** Number of entries (from VPCI_QUEUE_NUM). */
+    uint16_t    cEntries;
+    /** The next descriptor to hand out. */
+    uint16_t    iNextDesc;
+    /** The avail index written last. */
+    uint16_t    idxAvail;
+    RTGCPHYS    GCPhysDesc;
+    RTGCPHYS    GCPhysAvail;
+    RTGCPHYS    GCPhysUsed;
+} TSTRING;
+typedef TSTRING *PTSTRING;
+
+/**
+ * A buffer making up part of a descriptor chain.
+ */
+typedef struct TSTSEG
+{
+    RTGCPHYS    GCPhys;
+    uint32_t    cb;
+    bool        fWrite;
+} TSTSEG;
+
+
+/*********************************************************************************************************************************
+*   Global Variables                                                                                                             *
+*********************************************************************************************************************************/
+/** The test handle.*/
+static RTTEST               g_hTest;
+/** The fake guest memory. */
+static uint8_t              g_abGuestMem[TST_GUEST_MEM_SIZE];
+/** Next free buffer address. */
+static RTGCPHYS             g_GCPhysNextBuf = TST_BUF_ADDR;
+/** The 'QueuePairs' configuration value. */
+static uint16_t             g_cCfgQueuePairs = 2;
+/** The device critical section, unused. */
+static PDMCRITSECT          g_CritSectNop;
+/** Dummy timer handle contents. */
+static uint8_t              g_abDummyTimer[64];
+/** Dummy queue handle contents. */
+static uint8_t              g_abDummyQueue[64];
+
+/** Number of pfnBeginXmit calls to fail with VERR_TRY_AGAIN. */
+static uint32_t volatile    g_cDrvBusyXmits;
+/** Number of frames passed to pfnSendBuf. */
+static uint32_t volatile    g_cDrvFramesSent;
+/** The last promiscuous mode setting. */
+static bool volatile        g_fDrvPromiscuous;
+
+
+/*
+ *
+ * Fake VMM APIs.
+ *
+ */
+
+/* PDMCRITSECT starts with an RTCRITSECT, which is all we need here. */
+#undef PDMCritSectEnter
+VMMDECL(int) PDMCritSectEnter(PPDMCRITSECT pCritSect, int rcBusy)
+{
+    RT_NOREF(rcBusy);
+    return RTCritSectEnter((PRTCRITSECT)pCritSect);
+}
+
+VMMDECL(int) PDMCritSectEnterDebug(PPDMCRITSECT pCritSect, int rcBusy, RTHCUINTPTR uId, RT_SRC_POS_DECL)
+{
+    RT_NOREF(uId); RT_SRC_POS_NOREF();
+    return PDMCritSectEnter(pCritSect, rcBusy);
+}
+
+VMMDECL(int) PDMCritSectLeave(PPDMCRITSECT pCritSect)
+{
+    return RTCritSectLeave((PRTCRITSECT)pCritSect);
+}
+
+VMMDECL(bool) PDMCritSectIsInitialized(PCPDMCRITSECT pCritSect)
+{
+    return RTCritSectIsInitialized((PCRTCRITSECT)pCritSect);
+}
+
+VMMR3DECL(int) PDMR3CritSectDelete(PPDMCRITSECT pCritSect)
+{
+    return RTCritSectDelete((PRTCRITSECT)pCritSect);
+}
+
+VMMDECL(R0PTRTYPE(PPDMQUEUE)) PDMQueueR0Ptr(PPDMQUEUE pQueue)
+{
+    RT_NOREF(pQueue);
+    return NIL_RTR0PTR;
+}
+
+VMMDECL(RCPTRTYPE(PPDMQUEUE)) PDMQueueRCPtr(PPDMQUEUE pQueue)
+{
+    RT_NOREF(pQueue);
+    return NIL_RTRCPTR;
+}
+
+static DECLCALLBACK(int) tstThreadMain(RTTHREAD hThreadSelf, void *pvUser)
+{
+    RT_NOREF(hThreadSelf);
+    PPDMTHREAD pThread = (PPDMTHREAD)pvUser;
+    return pThread->u.Dev.pfnThread(pThread->u.Dev.pDevIns, pThread);
+}
+
+VMMR3DECL(int) PDMR3ThreadDestroy(PPDMTHREAD pThread, int *pRcThread)
+{
+    ASMAtomicWriteU32((uint32_t volatile *)&pThread->enmState, PDMTHREADSTATE_TERMINATING);
+    pThread->u.Dev.pfnWakeUp(pThread->u.Dev.pDevIns, pThread);
+    int rc = RTThreadWait(pThread->Thread, 30 * RT_MS_1SEC, pRcThread);
+    RTMemFree(pThread);
+    return rc;
+}
+
+VMMDECL(bool) TMTimerIsActive(PTMTIMER pTimer)                       { RT_NOREF(pTimer); return false; }
+VMMDECL(PTMTIMERR0) TMTimerR0Ptr(PTMTIMER pTimer)                    { RT_NOREF(pTimer); return NIL_RTR0PTR; }
+VMMDECL(PTMTIMERRC) TMTimerRCPtr(PTMTIMER pTimer)                    { RT_NOREF(pTimer); return NIL_RTRCPTR; }
+VMMDECL(int) TMTimerSetMicro(PTMTIMER pTimer, uint64_t cMicrosToNext)  { RT_NOREF(pTimer, cMicrosToNext); return VINF_SUCCESS; }
+VMMDECL(int) TMTimerSetMillies(PTMTIMER pTimer, uint32_t cMilliesToNext) { RT_NOREF(pTimer, cMilliesToNext); return VINF_SUCCESS; }
+VMMDECL(int) TMTimerStop(PTMTIMER pTimer)                            { RT_NOREF(pTimer); return VINF_SUCCESS; }
+
+VMMR3DECL(bool) CFGMR3AreValuesValid(PCFGMNODE pNode, const char *pszzValid)
+{
+    RT_NOREF(pNode, pszzValid);
+    return true;
+}
+
+VMMR3DECL(int) CFGMR3QueryBool(PCFGMNODE pNode, const char *pszName, bool *pf)
+{
+    RT_NOREF(pNode);
+    RTTEST_CHECK(g_hTest, !strcmp(pszName, "CableConnected"));
+    *pf = true;
+    return VINF_SUCCESS;
+}
+
+VMMR3DECL(int) CFGMR3QueryBoolDef(PCFGMNODE pNode, const char *pszName, bool *pf, bool fDef)
+{
+    RT_NOREF(pNode, pszName);
+    *pf = fDef;
+    return VINF_SUCCESS;
+}
+
+VMMR3DECL(int) CFGMR3QueryBytes(PCFGMNODE pNode, const char *pszName, void *pvData, size_t cbData)
+{
+    RT_NOREF(pNode);
+    static const uint8_t s_abMac[6] = { 0x08, 0x00, 0x27, 0x01, 0x02, 0x03 };
+    RTTEST_CHECK_RET(g_hTest, !strcmp(pszName, "MAC") && cbData == sizeof(s_abMac), VERR_CFGM_VALUE_NOT_FOUND);
+    memcpy(pvData, s_abMac, sizeof(s_abMac));
+    return VINF_SUCCESS;
+}
+
+VMMR3DECL(int) CFGMR3QueryU16Def(PCFGMNODE pNode, const char *pszName, uint16_t *pu16, uint16_t u16Def)
+{
+    RT_NOREF(pNode);
+    *pu16 = !strcmp(pszName, "QueuePairs") ? g_cCfgQueuePairs : u16Def;
+    return VINF_SUCCESS;
+}
+
+VMMR3DECL(int) CFGMR3QueryU32Def(PCFGMNODE pNode, const char *pszName, uint32_t *pu32, uint32_t u32Def)
+{
+    RT_NOREF(pNode, pszName);
+    *pu32 = u32Def;
+    return VINF_SUCCESS;
+}
+
+/* Saved state isn't exercised. */
+VMMR3DECL(int) SSMR3GetBool(PSSMHANDLE pSSM, bool *pfBool)              { RT_NOREF(pSSM, pfBool); return VERR_NOT_IMPLEMENTED; }
+VMMR3DECL(int) SSMR3GetU8(PSSMHANDLE pSSM, uint8_t *pu8)                { RT_NOREF(pSSM, pu8); return VERR_NOT_IMPLEMENTED; }
+VMMR3DECL(int) SSMR3GetU16(PSSMHANDLE pSSM, uint16_t *pu16)             { RT_NOREF(pSSM, pu16); return VERR_NOT_IMPLEMENTED; }
+VMMR3DECL(int) SSMR3GetU32(PSSMHANDLE pSSM, uint32_t *pu32)             { RT_NOREF(pSSM, pu32); return VERR_NOT_IMPLEMENTED; }
+VMMR3DECL(int) SSMR3GetMem(PSSMHANDLE pSSM, void *pv, size_t cb)        { RT_NOREF(pSSM, pv, cb); return VERR_NOT_IMPLEMENTED; }
+VMMR3DECL(int) SSMR3PutBool(PSSMHANDLE pSSM, bool fBool)                { RT_NOREF(pSSM, fBool); return VERR_NOT_IMPLEMENTED; }
+VMMR3DECL(int) SSMR3PutU8(PSSMHANDLE pSSM, uint8_t u8)                  { RT_NOREF(pSSM, u8); return VERR_NOT_IMPLEMENTED; }
+VMMR3DECL(int) SSMR3PutU16(PSSMHANDLE pSSM, uint16_t u16)               { RT_NOREF(pSSM, u16); return VERR_NOT_IMPLEMENTED; }
+VMMR3DECL(int) SSMR3PutU32(PSSMHANDLE pSSM, uint32_t u32)               { RT_NOREF(pSSM, u32); return VERR_NOT_IMPLEMENTED; }
+VMMR3DECL(int) SSMR3PutMem(PSSMHANDLE pSSM, const void *pv, size_t cb)  { RT_NOREF(pSSM, pv, cb); return VERR_NOT_IMPLEMENTED; }
+VMMR3DECL(int) SSMR3SetCfgError(PSSMHANDLE pSSM, RT_SRC_POS_DECL, const char *pszFormat, ...)
+{
+    RT_NOREF(pSSM, pszFormat); RT_SRC_POS_NOREF();
+    return VERR_NOT_IMPLEMENTED;
+}
+
+
+/*
+ *
+ * Fake device helpers.
+ *
+ */
+
+static DECLCALLBACK(int) tstDevHlpSetDeviceCritSect(PPDMDEVINS pDevIns, PPDMCRITSECT pCritSect)
+{
+    RT_NOREF(pDevIns, pCritSect);
+    return VINF_SUCCESS;
+}
+
+static DECLCALLBACK(PPDMCRITSECT) tstDevHlpCritSectGetNop(PPDMDEVINS pDevIns)
+{
+    RT_NOREF(pDevIns);
+    return &g_CritSectNop;
+}
+
+static DECLCALLBACK(int) tstDevHlpCritSectInit(PPDMDEVINS pDevIns, PPDMCRITSECT pCritSect, RT_SRC_POS_DECL,
+                                               const char *pszNameFmt, va_list va)
+{
+    RT_NOREF(pDevIns, pszNameFmt, va); RT_SRC_POS_NOREF();
+    return RTCritSectInit((PRTCRITSECT)pCritSect);
+}
+
+static DECLCALLBACK(int) tstDevHlpPCIRegister(PPDMDEVINS pDevIns, PPDMPCIDEV pPciDev, uint32_t idxDevCfg, uint32_t fFlags,
+                                              uint8_t uPciDevNo, uint8_t uPciFunNo, const char *pszName)
+{
+    RT_NOREF(pDevIns, pPciDev, idxDevCfg, fFlags, uPciDevNo, uPciFunNo, pszName);
+    return VINF_SUCCESS;
+}
+
+static DECLCALLBACK(int) tstDevHlpPCIIORegionRegister(PPDMDEVINS pDevIns, PPDMPCIDEV pPciDev, uint32_t iRegion, RTGCPHYS cbRegion,
+                                                      PCIADDRESSSPACE enmType, PFNPCIIOREGIONMAP pfnCallback)
+{
+    RT_NOREF(pDevIns, pPciDev, iRegion, cbRegion, enmType, pfnCallback);
+    return VINF_SUCCESS;
+}
+
+static DECLCALLBACK(int) tstDevHlpSSMRegister(PPDMDEVINS pDevIns, uint32_t uVersion, size_t cbGuess, const char *pszBefore,
+                                              PFNSSMDEVLIVEPREP pfnLivePrep, PFNSSMDEVLIVEEXEC pfnLiveExec, PFNSSMDEVLIVEVOTE pfnLiveVote,
+                                              PFNSSMDEVSAVEPREP pfnSavePrep, PFNSSMDEVSAVEEXEC pfnSaveExec, PFNSSMDEVSAVEDONE pfnSaveDone,
+                                              PFNSSMDEVLOADPREP pfnLoadPrep, PFNSSMDEVLOADEXEC pfnLoadExec, PFNSSMDEVLOADDONE pfnLoadDone)
+{
+    RT_NOREF(pDevIns, uVersion, cbGuess, pszBefore, pfnLivePrep, pfnLiveExec, pfnLiveVote);
+    RT_NOREF(pfnSavePrep, pfnSaveExec, pfnSaveDone, pfnLoadPrep, pfnLoadExec, pfnLoadDone);
+    return VINF_SUCCESS;
+}
+
+static DECLCALLBACK(int) tstDevHlpQueueCreate(PPDMDEVINS pDevIns, size_t cbItem, uint32_t cItems, uint32_t cMilliesInterval,
+                                              PFNPDMQUEUEDEV pfnCallback, bool fRZEnabled, const char *pszName, PPDMQUEUE *ppQueue)
+{
+    RT_NOREF(pDevIns, cbItem, cItems, cMilliesInterval, pfnCallback, fRZEnabled, pszName);
+    *ppQueue = (PPDMQUEUE)&g_abDummyQueue[0];
+    return VINF_SUCCESS;
+}
+
+static DECLCALLBACK(int) tstDevHlpTMTimerCreate(PPDMDEVINS pDevIns, TMCLOCK enmClock, PFNTMTIMERDEV pfnCallback,
+                                                void *pvUser, uint32_t fFlags, const char *pszDesc, PPTMTIMERR3 ppTimer)
+{
+    RT_NOREF(pDevIns, enmClock, pfnCallback, pvUser, fFlags, pszDesc);
+    *ppTimer = (PTMTIMERR3)&g_abDummyTimer[0];
+    return VINF_SUCCESS;
+}
+
+static DECLCALLBACK(int) tstDevHlpThreadCreate(PPDMDEVINS pDevIns, PPPDMTHREAD ppThread, void *pvUser, PFNPDMTHREADDEV pfnThread,
+                                               PFNPDMTHREADWAKEUPDEV pfnWakeup, size_t cbStack, RTTHREADTYPE enmType, const char *pszName)
+{
+    PPDMTHREAD pThread = (PPDMTHREAD)RTMemAllocZ(sizeof(*pThread));
+    RTTEST_CHECK_RET(g_hTest, pThread, VERR_NO_MEMORY);
+    pThread->u32Version      = PDMTHREAD_VERSION;
+    pThread->enmState        = PDMTHREADSTATE_INITIALIZING;
+    pThread->pvUser          = pvUser;
+    pThread->u.Dev.pDevIns   = pDevIns;
+    pThread->u.Dev.pfnThread = pfnThread;
+    pThread->u.Dev.pfnWakeUp = pfnWakeup;
+
+    int rc = pfnThread(pDevIns, pThread);
+    if (RT_SUCCESS(rc))
+    {
+        pThread->enmState = PDMTHREADSTATE_RUNNING;
+        rc = RTThreadCreate(&pThread->Thread, tstThreadMain, pThread, cbStack, enmType, RTTHREADFLAGS_WAITABLE, pszName);
+    }
+    if (RT_FAILURE(rc))
+    {
+        RTMemFree(pThread);
+        return rc;
+    }
+    *ppThread = pThread;
+    return VINF_SUCCESS;
+}
+
+static DECLCALLBACK(void) tstDevHlpSTAMRegisterV(PPDMDEVINS pDevIns, void *pvSample, STAMTYPE enmType,
+                                                 STAMVISIBILITY enmVisibility, STAMUNIT enmUnit, const char *pszDesc,
+                                                 const char *pszName, va_list args)
+{
+    RT_NOREF(pDevIns, pvSample, enmType, enmVisibility, enmUnit, pszDesc, pszName, args);
+}
+
+static DECLCALLBACK(int) tstDevHlpVMSetErrorV(PPDMDEVINS pDevIns, int rc, RT_SRC_POS_DECL, const char *pszFormat, va_list va)
+{
+    RT_NOREF(pDevIns); RT_SRC_POS_NOREF();
+    RTTestFailed(g_hTest, "VMSetError: %Rrc %N", rc, pszFormat, &va);
+    return rc;
+}
+
+static DECLCALLBACK(int) tstDevHlpVMSetRuntimeErrorV(PPDMDEVINS pDevIns, uint32_t fFlags, const char *pszErrorId,
+                                                     const char *pszFormat, va_list va)
+{
+    RT_NOREF(pDevIns, fFlags);
+    RTTestFailed(g_hTest, "VMSetRuntimeError: %s: %N", pszErrorId, pszFormat, &va);
+    return VINF_SUCCESS;
+}
+
+static DECLCALLBACK(int) tstDevHlpPhysRead(PPDMDEVINS pDevIns, RTGCPHYS GCPhys, void *pvBuf, size_t cbRead)
+{
+    RT_NOREF(pDevIns);
+    RTTEST_CHECK_MSG_RET(g_hTest, GCPhys < TST_GUEST_MEM_SIZE && cbRead <= TST_GUEST_MEM_SIZE - GCPhys,
+                         (g_hTest, "GCPhys=%RGp cbRead=%#zx\n", GCPhys, cbRead), VERR_OUT_OF_RANGE);
+    memcpy(pvBuf, &g_abGuestMem[GCPhys], cbRead);
+    return VINF_SUCCESS;
+}
+
+static DECLCALLBACK(int) tstDevHlpPhysWrite(PPDMDEVINS pDevIns, RTGCPHYS GCPhys, const void *pvBuf, size_t cbWrite)
+{
+    RT_NOREF(pDevIns);
+    RTTEST_CHECK_MSG_RET(g_hTest, GCPhys < TST_GUEST_MEM_SIZE && cbWrite <= TST_GUEST_MEM_SIZE - GCPhys,
+                         (g_hTest, "GCPhys=%RGp cbWrite=%#zx\n", GCPhys, cbWrite), VERR_OUT_OF_RANGE);
+    memcpy(&g_abGuestMem[GCPhys], pvBuf, cbWrite);
+    return VINF_SUCCESS;
+}
+
+static DECLCALLBACK(int) tstDevHlpPCIPhysWrite(PPDMDEVINS pDevIns, PPDMPCIDEV pPciDev, RTGCPHYS GCPhys, const void *pvBuf, size_t cbWrite)
+{
+    RT_NOREF(pPciDev);
+    return tstDevHlpPhysWrite(pDevIns, GCPhys, pvBuf, cbWrite);
+}
+
+static DECLCALLBACK(void) tstDevHlpPCISetIrq(PPDMDEVINS pDevIns, PPDMPCIDEV pPciDev, int iIrq, int iLevel)
+{
+    RT_NOREF(pDevIns, pPciDev, iIrq, iLevel);
+}
+
+static DECLCALLBACK(VMSTATE) tstDevHlpVMState(PPDMDEVINS pDevIns)
+{
+    RT_NOREF(pDevIns);
+    return VMSTATE_RUNNING;
+}
+
+static DECLCALLBACK(int) tstDevHlpDBGFStopV(PPDMDEVINS pDevIns, const char *pszFile, unsigned iLine, const char *pszFunction,
+                                            const char *pszFormat, va_list args)
+{
+    RT_NOREF(pDevIns, pszFile, iLine, pszFunction);
+    RTTestFailed(g_hTest, "DBGFStop: %N", pszFormat, &args);
+    return VINF_SUCCESS;
+}
+
+
+/*
+ *
+ * Fake network driver and status driver.
+ *
+ */
+
+static DECLCALLBACK(int) tstDrvBeginXmit(PPDMINETWORKUP pInterface, bool fOnWorkerThread)
+{
+    RT_NOREF(pInterface, fOnWorkerThread);
+    uint32_t cBusy = ASMAtomicReadU32(&g_cDrvBusyXmits);
+    if (cBusy && ASMAtomicCmpXchgU32(&g_cDrvBusyXmits, cBusy - 1, cBusy))
+        return VERR_TRY_AGAIN;
+    return VINF_SUCCESS;
+}
+
+static DECLCALLBACK(int) tstDrvAllocBuf(PPDMINETWORKUP pInterface, size_t cbMin, PCPDMNETWORKGSO pGso, PPPDMSCATTERGATHER ppSgBuf)
+{
+    RT_NOREF(pInterface);
+    RTTEST_CHECK_RET(g_hTest, pGso == NULL, VERR_NOT_SUPPORTED);
+    PPDMSCATTERGATHER pSgBuf = (PPDMSCATTERGATHER)RTMemAllocZ(sizeof(*pSgBuf) + cbMin);
+    if (!pSgBuf)
+        return VERR_NO_MEMORY;
+    pSgBuf->fFlags          = PDMSCATTERGATHER_FLAGS_MAGIC | PDMSCATTERGATHER_FLAGS_OWNER_1;
+    pSgBuf->cbAvailable     = cbMin;
+    pSgBuf->cSegs           = 1;
+    pSgBuf->aSegs[0].cbSeg  = cbMin;
+    pSgBuf->aSegs[0].pvSeg  = pSgBuf + 1;
+    *ppSgBuf = pSgBuf;
+    return VINF_SUCCESS;
+}
+
+static DECLCALLBACK(int) tstDrvFreeBuf(PPDMINETWORKUP pInterface, PPDMSCATTERGATHER pSgBuf)
+{
+    RT_NOREF(pInterface);
+    RTMemFree(pSgBuf);
+    return VINF_SUCCESS;
+}
+
+static DECLCALLBACK(int) tstDrvSendBuf(PPDMINETWORKUP pInterface, PPDMSCATTERGATHER pSgBuf, bool fOnWorkerThread)
+{
+    RT_NOREF(fOnWorkerThread);
+    ASMAtomicIncU32(&g_cDrvFramesSent);
+    return tstDrvFreeBuf(pInterface, pSgBuf);
+}
+
+static DECLCALLBACK(void) tstDrvEndXmit(PPDMINETWORKUP pInterface)
+{
+    RT_NOREF(pInterface);
+}
+
+static DECLCALLBACK(void) tstDrvSetPromiscuousMode(PPDMINETWORKUP pInterface, bool fPromiscuous)
+{
+    RT_NOREF(pInterface);
+    ASMAtomicWriteBool(&g_fDrvPromiscuous, fPromiscuous);
+}
+
+static DECLCALLBACK(void) tstDrvNotifyLinkChanged(PPDMINETWORKUP pInterface, PDMNETWORKLINKSTATE enmLinkState)
+{
+    RT_NOREF(pInterface, enmLinkState);
+}
+
+static PDMINETWORKUP g_DrvNetworkUp =
+{
+    tstDrvBeginXmit,
+    tstDrvAllocBuf,
+    tstDrvFreeBuf,
+    tstDrvSendBuf,
+    tstDrvEndXmit,
+    tstDrvSetPromiscuousMode,
+    tstDrvNotifyLinkChanged
+};
+
+static DECLCALLBACK(void *) tstDrvQueryInterface(PPDMIBASE pInterface, const char *pszIID)
+{
+    PDMIBASE_RETURN_INTERFACE(pszIID, PDMIBASE, pInterface);
+    PDMIBASE_RETURN_INTERFACE(pszIID, PDMINETWORKUP, &g_DrvNetworkUp);
+    return NULL;
+}
+
+static DECLCALLBACK(void *) tstStatusQueryInterface(PPDMIBASE pInterface, const char *pszIID)
+{
+    PDMIBASE_RETURN_INTERFACE(pszIID, PDMIBASE, pInterface);
+    return NULL;
+}
+
+static PDMIBASE g_DrvIBase    = { tstDrvQueryInterface };
+static PDMIBASE g_StatusIBase = { tstStatusQueryInterface };
+
+static DECLCALLBACK(int) tstDevHlpDriverAttach(PPDMDEVINS pDevIns, uint32_t iLun, PPDMIBASE pBaseInterface,
+                                               PPDMIBASE *ppBaseInterface, const char *pszDesc)
+{
+    RT_NOREF(pDevIns, pBaseInterface, pszDesc);
+    *ppBaseInterface = iLun == PDM_STATUS_LUN ? &g_StatusIBase : &g_DrvIBase;
+    return VINF_SUCCESS;
+}
+
+
+/*
+ *
+ * The guest driver.
+ *
+ */
+
+static uint32_t tstIoIn(PPDMDEVINS pDevIns, RTIOPORT Port, unsigned cb)
+{
+    uint32_t u32 = 0;
+    int rc = vnetIOPortIn(pDevIns, NULL, Port, &u32, cb);
+    RTTEST_CHECK_RC_OK(g_hTest, rc);
+    return u32;
+}
+
+static void tstIoOut(PPDMDEVINS pDevIns, RTIOPORT Port, uint32_t u32, unsigned cb)
+{
+    int rc = vnetIOPortOut(pDevIns, NULL, Port, u32, cb);
+    RTTEST_CHECK_RC_OK(g_hTest, rc);
+}
+
+static uint16_t tstReadU16(RTGCPHYS GCPhys)
+{
+    uint16_t u16;
+    memcpy(&u16, &g_abGuestMem[GCPhys], sizeof(u16));
+    return ASMAtomicReadU16(&u16);
+}
+
+/** Allocates a guest buffer. */
+static RTGCPHYS tstAllocBuf(void)
+{
+    RTGCPHYS GCPhys = g_GCPhysNextBuf;
+    g_GCPhysNextBuf += TST_BUF_SIZE;
+    RTTEST_CHECK(g_hTest, g_GCPhysNextBuf <= TST_GUEST_MEM_SIZE);
+    return GCPhys;
+}
+
+/**
+ * Resets the device and negotiates @a fFeatures like a guest driver probing
+ * the device would.
+ */
+static void tstGuestProbe(PPDMDEVINS pDevIns, uint32_t fFeatures)
+{
+    tstIoOut(pDevIns, VPCI_STATUS, 0, 1);
+    tstIoOut(pDevIns, VPCI_STATUS, VPCI_STATUS_ACK | VPCI_STATUS_DRV, 1);
+    uint32_t const fHostFeatures = tstIoIn(pDevIns, VPCI_HOST_FEATURES, 4);
+    RTTEST_CHECK_MSG(g_hTest, (fFeatures & fHostFeatures) == fFeatures,
+                     (g_hTest, "fFeatures=%#x fHostFeatures=%#x\n", fFeatures, fHostFeatures));
+    tstIoOut(pDevIns, VPCI_GUEST_FEATURES, fFeatures & fHostFeatures, 4);
+    g_GCPhysNextBuf = TST_BUF_ADDR;
+    RT_ZERO(g_abGuestMem);
+}
+
+/** Marks the guest driver as ready. */
+static void tstGuestReady(PPDMDEVINS pDevIns)
+{
+    tstIoOut(pDevIns, VPCI_STATUS, VPCI_STATUS_ACK | VPCI_STATUS_DRV | VPCI_STATUS_DRV_OK, 1);
+}
+
+/** Sets up the rings of a virtqueue, mirroring vqueueInit. */
+static void tstRingInit(PPDMDEVINS pDevIns, PTSTRING pRing, uint16_t iQueue)
+{
+    tstIoOut(pDevIns, VPCI_QUEUE_SEL, iQueue, 2);
+    pRing->iQueue      = iQueue;
+    pRing->cEntries    = (uint16_t)tstIoIn(pDevIns, VPCI_QUEUE_NUM, 2);
+    pRing->iNextDesc   = 0;
+    pRing->idxAvail    = 0;
+    pRing->GCPhysDesc  = TST_RING_ADDR(iQueue);
+    pRing->GCPhysAvail = pRing->GCPhysDesc + sizeof(VRINGDESC) * pRing->cEntries;
+    pRing->GCPhysUsed  = RT_ALIGN_64(pRing->GCPhysAvail + RT_OFFSETOF(VRINGAVAIL, auRing[pRing->cEntries + 1]), PAGE_SIZE);
+    RTTEST_CHECK(g_hTest, pRing->cEntries > 0 && pRing->cEntries <= 256);
+    tstIoOut(pDevIns, VPCI_QUEUE_PFN, (uint32_t)(pRing->GCPhysDesc >> PAGE_SHIFT), 4);
+}
+
+/** Makes a descriptor chain available to the device, without notifying it. */
+static void tstRingAdd(PTSTRING pRing, TSTSEG const *paSegs, unsigned cSegs)
+{
+    uint16_t const iHead = pRing->iNextDesc;
+    for (unsigned i = 0; i < cSegs; i++)
+    {
+        uint16_t const iDesc = (uint16_t)((iHead + i) % pRing->cEntries);
+        VRINGDESC Desc;
+        Desc.u64Addr  = paSegs[i].GCPhys;
+        Desc.uLen     = paSegs[i].cb;
+        Desc.u16Flags = (uint16_t)(  (paSegs[i].fWrite ? VRINGDESC_F_WRITE : 0)
+                                   | (i + 1 < cSegs ? VRINGDESC_F_NEXT : 0));
+        Desc.u16Next  = (uint16_t)((iDesc + 1) % pRing->cEntries);
+        memcpy(&g_abGuestMem[pRing->GCPhysDesc + iDesc * sizeof(VRINGDESC)], &Desc, sizeof(Desc));
+    }
+    pRing->iNextDesc = (uint16_t)((iHead + cSegs) % pRing->cEntries);
+
+    memcpy(&g_abGuestMem[pRing->GCPhysAvail + RT_OFFSETOF(VRINGAVAIL, auRing[pRing->idxAvail % pRing->cEntries])],
+           &iHead, sizeof(iHead));
+    pRing->idxAvail++;
+    ASMAtomicWriteU16((uint16_t volatile *)&g_abGuestMem[pRing->GCPhysAvail + RT_OFFSETOF(VRINGAVAIL, uNextFreeIndex)],
+                      pRing->idxAvail);
+}
+
+/** Returns the used index the device has published for a virtqueue. */
+static uint16_t tstRingUsedIdx(PTSTRING pRing)
+{
+    return tstReadU16(pRing->GCPhysUsed + RT_OFFSETOF(VRINGUSED, uIndex));
+}
+
+/**
+ * Sends a control command and returns the acknowledge, 0xff if the device
+ * did not complete the command.
+ */
+static uint8_t tstCtlCommand(PPDMDEVINS pDevIns, PTSTRING pCtlRing, uint8_t u8Class, uint8_t u8Command,
+                             const void *pvData, uint32_t cbData)
+{
+    RTGCPHYS const GCPhysHdr  = tstAllocBuf();
+    RTGCPHYS const GCPhysData = tstAllocBuf();
+    RTGCPHYS const GCPhysAck  = tstAllocBuf();
+    g_abGuestMem[GCPhysHdr]     = u8Class;
+    g_abGuestMem[GCPhysHdr + 1] = u8Command;
+    memcpy(&g_abGuestMem[GCPhysData], pvData, cbData);
+    g_abGuestMem[GCPhysAck]     = 0xff;
+
+    TSTSEG aSegs[3] =
+    {
+        { GCPhysHdr,  sizeof(VNETCTLHDR), false },
+        { GCPhysData, cbData,             false },
+        { GCPhysAck,  sizeof(VNETCTLACK), true  },
+    };
+    uint16_t const idxUsed = tstRingUsedIdx(pCtlRing);
+    tstRingAdd(pCtlRing, aSegs, RT_ELEMENTS(aSegs));
+    tstIoOut(pDevIns, VPCI_QUEUE_NOTIFY, pCtlRing->iQueue, 2);
+    if (tstRingUsedIdx(pCtlRing) != (uint16_t)(idxUsed + 1))
+        return 0xff;
+    return g_abGuestMem[GCPhysAck];
+}
+
+/** Hands a receive buffer to the device (non-mergeable layout). */
+static void tstAddRxBuf(PTSTRING pRxRing)
+{
+    TSTSEG aSegs[2] =
+    {
+        { tstAllocBuf(), sizeof(VNETHDR), true },
+        { tstAllocBuf(), TST_BUF_SIZE,    true },
+    };
+    tstRingAdd(pRxRing, aSegs, RT_ELEMENTS(aSegs));
+}
+
+/** Builds a UDP/IPv4 frame from 10.0.2.2 to the guest. */
+static size_t tstMakeUdpFrame(uint8_t *pbFrame, uint16_t uSrcPort)
+{
+    size_t const cbFrame = sizeof(RTNETETHERHDR) + RTNETIPV4_MIN_LEN + sizeof(RTNETUDP) + 18;
+    memset(pbFrame, 0, cbFrame);
+
+    PRTNETETHERHDR pEthHdr = (PRTNETETHERHDR)pbFrame;
+    memset(&pEthHdr->DstMac, 0xff, sizeof(pEthHdr->DstMac));
+    pEthHdr->SrcMac.au8[0] = 0x52;
+    pEthHdr->SrcMac.au8[5] = 0x02;
+    pEthHdr->EtherType     = RT_H2BE_U16_C(RTNET_ETHERTYPE_IPV4);
+
+    PRTNETIPV4 pIpHdr = (PRTNETIPV4)(pEthHdr + 1);
+    pIpHdr->ip_v        = 4;
+    pIpHdr->ip_hl       = RTNETIPV4_MIN_LEN / 4;
+    pIpHdr->ip_len      = RT_H2BE_U16((uint16_t)(cbFrame - sizeof(RTNETETHERHDR)));
+    pIpHdr->ip_ttl      = 64;
+    pIpHdr->ip_p        = RTNETIPV4_PROT_UDP;
+    pIpHdr->ip_src.u    = RT_H2BE_U32_C(0x0a000202);
+    pIpHdr->ip_dst.u    = RT_H2BE_U32_C(0x0a00020f);
+
+    PRTNETUDP pUdpHdr = (PRTNETUDP)((uint8_t *)pIpHdr + RTNETIPV4_MIN_LEN);
+    pUdpHdr->uh_sport   = RT_H2BE_U16(uSrcPort);
+    pUdpHdr->uh_dport   = RT_H2BE_U16_C(53);
+    pUdpHdr->uh_ulen    = RT_H2BE_U16((uint16_t)(sizeof(RTNETUDP) + 18));
+    return cbFrame;
+}
+
+
+/*
+ *
+ * The tests.
+ *
+ */
+
+/**
+ * A guest that does not acknowledge VNET_F_MQ must find the control queue
+ * right after the first pair, no matter how many pairs are configured.
+ */
+static void tstLegacyGuest(PPDMDEVINS pDevIns, PVNETSTATE pThis)
+{
+    RTTestSub(g_hTest, "Guest without VNET_F_MQ");
+
+    tstGuestProbe(pDevIns, VNET_F_MAC | VNET_F_CTRL_VQ | VNET_F_CTRL_RX);
+    TSTRING RxRing, TxRing, CtlRing;
+    tstRingInit(pDevIns, &RxRing,  0);
+    tstRingInit(pDevIns, &TxRing,  1);
+    tstRingInit(pDevIns, &CtlRing, 2);
+    tstGuestReady(pDevIns);
+
+    RTTEST_CHECK(g_hTest, pThis->fPromiscuous);
+    uint8_t fOn = 0;
+    RTTEST_CHECK(g_hTest, tstCtlCommand(pDevIns, &CtlRing, VNET_CTRL_CLS_RX_MODE, VNET_CTRL_CMD_RX_MODE_PROMISC,
+                                        &fOn, sizeof(fOn)) == VNET_OK);
+    RTTEST_CHECK(g_hTest, !pThis->fPromiscuous);
+    RTTEST_CHECK(g_hTest, !g_fDrvPromiscuous);
+
+    /* Turning on all multicast must be answered too, and nothing ends up on the second pair. */
+    fOn = 1;
+    RTTEST_CHECK(g_hTest, tstCtlCommand(pDevIns, &CtlRing, VNET_CTRL_CLS_RX_MODE, VNET_CTRL_CMD_RX_MODE_ALLMULTI,
+                                        &fOn, sizeof(fOn)) == VNET_OK);
+    RTTEST_CHECK(g_hTest, pThis->fAllMulti);
+    RTTEST_CHECK(g_hTest, pThis->cActivePairs == 1);
+
+    /* Frames are still received on the one pair the guest knows about. */
+    for (unsigned i = 0; i < 4; i++)
+        tstAddRxBuf(&RxRing);
+    tstIoOut(pDevIns, VPCI_QUEUE_NOTIFY, 0, 2);
+    uint8_t abFrame[128];
+    for (uint16_t i = 0; i < 4; i++)
+    {
+        size_t cbFrame = tstMakeUdpFrame(abFrame, (uint16_t)(1024 + i));
+        RTTEST_CHECK_RC(g_hTest, pThis->INetworkDown.pfnReceive(&pThis->INetworkDown, abFrame, cbFrame), VINF_SUCCESS);
+    }
+    RTTEST_CHECK(g_hTest, tstRingUsedIdx(&RxRing) == 4);
+}
+
+/**
+ * A guest that enables both pairs but only posts receive buffers on the
+ * first must still get every frame the driver was told it can deliver.
+ */
+static void tstMqGuestReceive(PPDMDEVINS pDevIns, PVNETSTATE pThis)
+{
+    RTTestSub(g_hTest, "Receive with one full pair");
+
+    tstGuestProbe(pDevIns, VNET_F_MAC | VNET_F_CTRL_VQ | VNET_F_CTRL_RX | VNET_F_MQ);
+    TSTRING aRings[5];
+    for (uint16_t i = 0; i < RT_ELEMENTS(aRings); i++)
+        tstRingInit(pDevIns, &aRings[i], i);
+    tstGuestReady(pDevIns);
+
+    uint16_t cPairs = 2;
+    RTTEST_CHECK(g_hTest, tstCtlCommand(pDevIns, &aRings[4], VNET_CTRL_CLS_MQ, VNET_CTRL_CMD_MQ_VQ_PAIRS_SET,
+                                        &cPairs, sizeof(cPairs)) == VNET_OK);
+    RTTEST_CHECK(g_hTest, pThis->cActivePairs == 2);
+
+    unsigned const cFrames = 32;
+    for (unsigned i = 0; i < cFrames; i++)
+        tstAddRxBuf(&aRings[0]);
+    tstIoOut(pDevIns, VPCI_QUEUE_NOTIFY, 0, 2);
+
+    uint8_t abFrame[128];
+    for (unsigned i = 0; i < cFrames; i++)
+    {
+        RTTEST_CHECK_RC(g_hTest, pThis->INetworkDown.pfnWaitReceiveAvail(&pThis->INetworkDown, 0), VINF_SUCCESS);
+        size_t cbFrame = tstMakeUdpFrame(abFrame, (uint16_t)(40000 + i * 7));
+        RTTEST_CHECK_RC(g_hTest, pThis->INetworkDown.pfnReceive(&pThis->INetworkDown, abFrame, cbFrame), VINF_SUCCESS);
+    }
+    RTTEST_CHECK(g_hTest, tstRingUsedIdx(&aRings[0]) == cFrames);
+    RTTEST_CHECK(g_hTest, tstRingUsedIdx(&aRings[2]) == 0);
+    /* Some of the frames must have been steered to the second pair for this to mean anything. */
+    RTTEST_CHECK(g_hTest, pThis->aQueuePairs[1].StatReceiveQueueFull.c > 0);
+    RTTEST_CHECK_RC(g_hTest, pThis->INetworkDown.pfnWaitReceiveAvail(&pThis->INetworkDown, 0), VERR_NET_NO_BUFFER_SPACE);
+}
+
+/**
+ * A TX worker that finds the driver busy must retry on its own, as not all
+ * drivers call pfnXmitPending.
+ */
+static void tstMqGuestTransmitBusy(PPDMDEVINS pDevIns, PVNETSTATE pThis)
+{
+    RTTestSub(g_hTest, "Transmit with a busy driver");
+    RTTEST_CHECK_RETV(g_hTest, pThis->fTxThreads);
+
+    tstGuestProbe(pDevIns, VNET_F_MAC | VNET_F_CTRL_VQ | VNET_F_MQ);
+    TSTRING aRings[5];
+    for (uint16_t i = 0; i < RT_ELEMENTS(aRings); i++)
+        tstRingInit(pDevIns, &aRings[i], i);
+    tstGuestReady(pDevIns);
+
+    uint16_t cPairs = 2;
+    RTTEST_CHECK(g_hTest, tstCtlCommand(pDevIns, &aRings[4], VNET_CTRL_CLS_MQ, VNET_CTRL_CMD_MQ_VQ_PAIRS_SET,
+                                        &cPairs, sizeof(cPairs)) == VNET_OK);
+
+    uint32_t const cSentBefore = ASMAtomicReadU32(&g_cDrvFramesSent);
+    ASMAtomicWriteU32(&g_cDrvBusyXmits, 3);
+
+    RTGCPHYS const GCPhysFrame = tstAllocBuf();
+    size_t const   cbFrame     = tstMakeUdpFrame(&g_abGuestMem[GCPhysFrame], 4242);
+    TSTSEG aSegs[2] =
+    {
+        { tstAllocBuf(), sizeof(VNETHDR),     false },
+        { GCPhysFrame,   (uint32_t)cbFrame,   false },
+    };
+    tstRingAdd(&aRings[3], aSegs, RT_ELEMENTS(aSegs));
+    tstIoOut(pDevIns, VPCI_QUEUE_NOTIFY, 3, 2);
+
+    /* No further kick and no pfnXmitPending, the worker is on its own. */
+    uint64_t const msStart = RTTimeMilliTS();
+    while (   ASMAtomicReadU32(&g_cDrvFramesSent) == cSentBefore
+           && RTTimeMilliTS() - msStart < 10 * RT_MS_1SEC)
+        RTThreadSleep(1);
+    RTTEST_CHECK(g_hTest, ASMAtomicReadU32(&g_cDrvFramesSent) == cSentBefore + 1);
+    RTTEST_CHECK(g_hTest, ASMAtomicReadU32(&g_cDrvBusyXmits) == 0);
+    RTTEST_CHECK(g_hTest, pThis->aQueuePairs[1].StatTransmitRetries.c >= 1);
+}
+
+
+int main()
+{
+    RTEXITCODE rcExit = RTTestInitAndCreate("tstDevVirtioNet", &g_hTest);
+    if (rcExit != RTEXITCODE_SUCCESS)
+        return rcExit;
+    RTTestBanner(g_hTest);
+
+    /*
+     * Construct a device instance with two queue pairs.
+     */
+    static PDMDEVHLPR3 s_DevHlp;
+    s_DevHlp.u32Version             = PDM_DEVHLPR3_VERSION;
+    s_DevHlp.pfnSetDeviceCritSect   = tstDevHlpSetDeviceCritSect;
+    s_DevHlp.pfnCritSectGetNop      = tstDevHlpCritSectGetNop;
+    s_DevHlp.pfnCritSectInit        = tstDevHlpCritSectInit;
+    s_DevHlp.pfnPCIRegister         = tstDevHlpPCIRegister;
+    s_DevHlp.pfnPCIIORegionRegister = tstDevHlpPCIIORegionRegister;
+    s_DevHlp.pfnSSMRegister         = tstDevHlpSSMRegister;
+    s_DevHlp.pfnQueueCreate         = tstDevHlpQueueCreate;
+    s_DevHlp.pfnTMTimerCreate       = tstDevHlpTMTimerCreate;
+    s_DevHlp.pfnDriverAttach        = tstDevHlpDriverAttach;
+    s_DevHlp.pfnThreadCreate        = tstDevHlpThreadCreate;
+    s_DevHlp.pfnSTAMRegisterV       = tstDevHlpSTAMRegisterV;
+    s_DevHlp.pfnVMSetErrorV         = tstDevHlpVMSetErrorV;
+    s_DevHlp.pfnVMSetRuntimeErrorV  = tstDevHlpVMSetRuntimeErrorV;
+    s_DevHlp.pfnPhysRead            = tstDevHlpPhysRead;
+    s_DevHlp.pfnPhysWrite           = tstDevHlpPhysWrite;
+    s_DevHlp.pfnPCIPhysWrite        = tstDevHlpPCIPhysWrite;
+    s_DevHlp.pfnPCISetIrq           = tstDevHlpPCISetIrq;
+    s_DevHlp.pfnVMState             = tstDevHlpVMState;
+    s_DevHlp.pfnDBGFStopV           = tstDevHlpDBGFStopV;
+
+    PPDMDEVINS pDevIns = (PPDMDEVINS)RTTestGuardedAllocTail(g_hTest, RT_OFFSETOF(PDMDEVINS, achInstanceData[sizeof(VNETSTATE)]));
+    RTTEST_CHECK_RET(g_hTest, pDevIns, RTTestSummaryAndDestroy(g_hTest));
+    RT_BZERO(pDevIns, RT_OFFSETOF(PDMDEVINS, achInstanceData[sizeof(VNETSTATE)]));
+    pDevIns->u32Version       = PDM_DEVINS_VERSION;
+    pDevIns->pHlpR3           = &s_DevHlp;
+    pDevIns->pReg             = &g_DeviceVirtioNet;
+    pDevIns->pvInstanceDataR3 = &pDevIns->achInstanceData[0];
+    PVNETSTATE pThis = PDMINS_2_DATA(pDevIns, PVNETSTATE);
+
+    g_cCfgQueuePairs = 2;
+    int rc = g_DeviceVirtioNet.pfnConstruct(pDevIns, 0, NULL);
+    RTTEST_CHECK_RC_OK(g_hTest, rc);
+    if (RT_SUCCESS(rc))
+    {
+        RTTEST_CHECK(g_hTest, pThis->cQueuePairs == 2);
+
+        tstLegacyGuest(pDevIns, pThis);
+        tstMqGuestReceive(pDevIns, pThis);
+        tstMqGuestTransmitBusy(pDevIns, pThis);
+    }
+
+    g_DeviceVirtioNet.pfnDestruct(pDevIns);
+    return RTTestSummaryAndDestroy(g_hTest);
+}
+
@@ -0,0 +1,524 @@
+/* $Id$ */
+/** @file
+ * NAT Testcase - Shard selection, port-forwarded flow tracking and sending.
+ *
+ * Includes the driver code and runs its frame classification against a bare
+ * driver instance, with the NAT engine stubbed out.
+ */
+
+/*
+ * Copyright (C) 2016 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ */
+
+
+/*********************************************************************************************************************************
+*   Header Files                                                                                                                 *
+*********************************************************************************************************************************/
+#include "../DrvNAT.cpp"
+
+#include <iprt/initterm.h>
+#include <iprt/test.h>
+
+
+/*********************************************************************************************************************************
+*   Defined Constants And Macros                                                                                                 *
+*********************************************************************************************************************************/
+/** The number of shards of the test instance. */
+#define TST_SHARDS          4
+/** The guest address (network order). */
+#define TST_GUEST_IP        RT_H2N_U32_C(UINT32_C(0x0a00020f))
+/** Size of the test frames: ethernet + IPv4 + TCP headers. */
+#define TST_CB_FRAME        (sizeof(RTNETETHERHDR) + RTNETIPV4_MIN_LEN + RTNETTCP_MIN_LEN)
+
+
+/*********************************************************************************************************************************
+*   Global Variables                                                                                                             *
+*********************************************************************************************************************************/
+/** The test handle.*/
+static RTTEST           g_hTest;
+/** The driver instance under test. */
+static DRVNAT           g_This;
+/** Whether slirp_ext_m_wrap fails, as when out of mbufs. */
+static bool             g_fWrapFails;
+/** Number of frames wrapped by slirp_ext_m_wrap. */
+static uint32_t         g_cWrapped;
+/** Number of frames passed to slirp_input. */
+static uint32_t         g_cInput;
+/** The TCP payload bytes passed to slirp_input, in sequence order. */
+static uint8_t          g_abPayload[8192];
+/** Number of bytes in g_abPayload, i.e. the highest sequence number seen. */
+static uint32_t         g_cbPayload;
+
+
+/*
+ *
+ * Fake NAT engine and VMM APIs.  Apart from the mbuf ones and slirp_input
+ * none of these are expected to be called.  The fake mbufs are simply the
+ * frame buffers.
+ *
+ */
+
+int slirp_init(PNATState *ppData, uint32_t u32NetAddr, uint32_t u32Netmask, bool fPassDomain, bool fUseHostResolver,
+               int i32AliasMode, int iIcmpCacheLimit, void *pvUser)
+{
+    RT_NOREF(ppData, u32NetAddr, u32Netmask, fPassDomain, fUseHostResolver, i32AliasMode, iIcmpCacheLimit, pvUser);
+    return VERR_NOT_IMPLEMENTED;
+}
+void slirp_register_statistics(PNATState pData, PPDMDRVINS pDrvIns)     { RT_NOREF(pData, pDrvIns); }
+void slirp_deregister_statistics(PNATState pData, PPDMDRVINS pDrvIns)   { RT_NOREF(pData, pDrvIns); }
+void slirp_term(PNATState pData)                                        { RT_NOREF(pData); }
+void slirp_link_up(PNATState pData)                                     { RT_NOREF(pData); }
+void slirp_link_down(PNATState pData)                                   { RT_NOREF(pData); }
+#ifdef RT_OS_WINDOWS
+void slirp_select_fill(PNATState pData, int *pndfs)                     { RT_NOREF(pData, pndfs); }
+void slirp_select_poll(PNATState pData, int fTimeout)                   { RT_NOREF(pData, fTimeout); }
+HANDLE *slirp_get_events(PNATState pData)                               { RT_NOREF(pData); return NULL; }
+void slirp_register_external_event(PNATState pData, HANDLE hEvent, int index) { RT_NOREF(pData, hEvent, index); }
+#else
+void slirp_select_fill(PNATState pData, int *pnfds, struct pollfd *polls) { RT_NOREF(pData, pnfds, polls); }
+void slirp_select_poll(PNATState pData, struct pollfd *polls, int ndfs) { RT_NOREF(pData, polls, ndfs); }
+int slirp_get_nsock(PNATState pData)                                    { RT_NOREF(pData); return 0; }
+#endif
+void slirp_arp_learn(PNATState pData, uint32_t ip, const uint8_t *ether) { RT_NOREF(pData, ip, ether); }
+int slirp_add_redirect(PNATState pData, int is_udp, struct in_addr host_addr, int host_port,
+                       struct in_addr guest_addr, int guest_port)
+{
+    RT_NOREF(pData, is_udp, host_addr, host_port, guest_addr, guest_port);
+    return -1;
+}
+int slirp_remove_redirect(PNATState pData, int is_udp, struct in_addr host_addr, int host_port,
+                          struct in_addr guest_addr, int guest_port)
+{
+    RT_NOREF(pData, is_udp, host_addr, host_port, guest_addr, guest_port);
+    return -1;
+}
+void slirp_set_dhcp_TFTP_prefix(PNATState pData, const char *tftpPrefix) { RT_NOREF(pData, tftpPrefix); }
+void slirp_set_dhcp_TFTP_bootfile(PNATState pData, const char *bootFile) { RT_NOREF(pData, bootFile); }
+void slirp_set_dhcp_next_server(PNATState pData, const char *nextServer) { RT_NOREF(pData, nextServer); }
+void slirp_set_dhcp_dns_proxy(PNATState pData, bool fDNSProxy)          { RT_NOREF(pData, fDNSProxy); }
+void slirp_set_rcvbuf(PNATState pData, int kilobytes)                   { RT_NOREF(pData, kilobytes); }
+void slirp_set_sndbuf(PNATState pData, int kilobytes)                   { RT_NOREF(pData, kilobytes); }
+void slirp_set_tcp_rcvspace(PNATState pData, int kilobytes)             { RT_NOREF(pData, kilobytes); }
+void slirp_set_tcp_sndspace(PNATState pData, int kilobytes)             { RT_NOREF(pData, kilobytes); }
+int  slirp_set_binding_address(PNATState pData, char *addr)             { RT_NOREF(pData, addr); return -1; }
+void slirp_set_mtu(PNATState pData, int mtu)                            { RT_NOREF(pData, mtu); }
+void slirp_info(PNATState pData, const void *pvArg, const char *pszArgs) { RT_NOREF(pData, pvArg, pszArgs); }
+void slirp_set_somaxconn(PNATState pData, int iSoMaxConn)               { RT_NOREF(pData, iSoMaxConn); }
+int slirp_host_network_configuration_change_strategy_selector(const PNATState pData) { RT_NOREF(pData); return 0; }
+unsigned int slirp_get_timeout_ms(PNATState pData)                      { RT_NOREF(pData); return 0; }
+#ifdef VBOX_WITH_DNSMAPPING_IN_HOSTRESOLVER
+void slirp_add_host_resolver_mapping(PNATState pData, const char *pszHostName, bool fPattern, uint32_t u32HostIP)
+{
+    RT_NOREF(pData, pszHostName, fPattern, u32HostIP);
+}
+#endif
+struct mbuf *slirp_ext_m_get(PNATState pData, size_t cbMin, void **ppvBuf, size_t *pcbBuf)
+{
+    RT_NOREF(pData);
+    *ppvBuf = RTMemAlloc(cbMin);
+    *pcbBuf = cbMin;
+    return (struct mbuf *)*ppvBuf;
+}
+struct mbuf *slirp_ext_m_wrap(PNATState pData, void *pvBuf, size_t cbBuf, size_t cbAlloc, bool fCsumValid)
+{
+    RT_NOREF(pData, cbBuf, cbAlloc, fCsumValid);
+    if (g_fWrapFails)
+        return NULL;
+    g_cWrapped++;
+    return (struct mbuf *)pvBuf;
+}
+void slirp_ext_m_free(PNATState pData, struct mbuf *m, uint8_t *pu8Buf) { RT_NOREF(pData, pu8Buf); RTMemFree(m); }
+
+/** Collects the TCP payload of the frames into g_abPayload. */
+void slirp_input(PNATState pData, struct mbuf *m, size_t cbBuf)
+{
+    RT_NOREF(pData);
+    g_cInput++;
+    uint8_t const  *pbFrame = (uint8_t const *)m;
+    PCRTNETIPV4     pIpHdr  = (PCRTNETIPV4)(pbFrame + sizeof(RTNETETHERHDR));
+    PCRTNETTCP      pTcpHdr = (PCRTNETTCP)((uint8_t const *)pIpHdr + pIpHdr->ip_hl * 4);
+    uint32_t const  cbHdrs  = sizeof(RTNETETHERHDR) + pIpHdr->ip_hl * 4 + pTcpHdr->th_off * 4;
+    uint32_t const  offSeq  = RT_BE2H_U32(pTcpHdr->th_seq);
+    RTTEST_CHECK(g_hTest, RT_BE2H_U16(pIpHdr->ip_len) == cbBuf - sizeof(RTNETETHERHDR));
+    if (   cbBuf > cbHdrs
+        && offSeq + cbBuf - cbHdrs <= sizeof(g_abPayload))
+    {
+        memcpy(&g_abPayload[offSeq], pbFrame + cbHdrs, cbBuf - cbHdrs);
+        g_cbPayload = RT_MAX(g_cbPayload, offSeq + (uint32_t)(cbBuf - cbHdrs));
+    }
+    else
+        RTTestFailed(g_hTest, "Bad frame: cbBuf=%zu offSeq=%#x", cbBuf, offSeq);
+    RTMemFree(m);
+}
+int slirpInitializeDnsSettings(PNATState pData)                         { RT_NOREF(pData); return VERR_NOT_IMPLEMENTED; }
+int slirpReleaseDnsSettings(PNATState pData)                            { RT_NOREF(pData); return VINF_SUCCESS; }
+
+VMMR3DECL(bool) CFGMR3AreValuesValid(PCFGMNODE pNode, const char *pszzValid)
+{
+    RT_NOREF(pNode, pszzValid);
+    return false;
+}
+VMMR3DECL(PCFGMNODE) CFGMR3GetChild(PCFGMNODE pNode, const char *pszPath)
+{
+    RT_NOREF(pNode, pszPath);
+    return NULL;
+}
+VMMR3DECL(PCFGMNODE) CFGMR3GetFirstChild(PCFGMNODE pNode)
+{
+    RT_NOREF(pNode);
+    return NULL;
+}
+VMMR3DECL(PCFGMNODE) CFGMR3GetNextChild(PCFGMNODE pCur)
+{
+    RT_NOREF(pCur);
+    return NULL;
+}
+VMMR3DECL(int) CFGMR3GetName(PCFGMNODE pCur, char *pszName, size_t cchName)
+{
+    RT_NOREF(pCur, pszName, cchName);
+    return VERR_CFGM_NO_NODE;
+}
+VMMR3DECL(int) CFGMR3QueryBool(PCFGMNODE pNode, const char *pszName, bool *pf)
+{
+    RT_NOREF(pNode, pszName, pf);
+    return VERR_CFGM_VALUE_NOT_FOUND;
+}
+VMMR3DECL(int) CFGMR3QueryS32(PCFGMNODE pNode, const char *pszName, int32_t *pi32)
+{
+    RT_NOREF(pNode, pszName, pi32);
+    return VERR_CFGM_VALUE_NOT_FOUND;
+}
+VMMR3DECL(int) CFGMR3QueryString(PCFGMNODE pNode, const char *pszName, char *pszString, size_t cchString)
+{
+    RT_NOREF(pNode, pszName, pszString, cchString);
+    return VERR_CFGM_VALUE_NOT_FOUND;
+}
+VMMR3DECL(int) CFGMR3QueryStringAlloc(PCFGMNODE pNode, const char *pszName, char **ppszString)
+{
+    RT_NOREF(pNode, pszName, ppszString);
+    return VERR_CFGM_VALUE_NOT_FOUND;
+}
+VMMR3DECL(int) CFGMR3QueryU32Def(PCFGMNODE pNode, const char *pszName, uint32_t *pu32, uint32_t u32Def)
+{
+    RT_NOREF(pNode, pszName);
+    *pu32 = u32Def;
+    return VINF_SUCCESS;
+}
+VMMR3DECL(void) MMR3HeapFree(void *pv)
+{
+    RT_NOREF(pv);
+}
+
+
+/**
+ * Builds a TCP or UDP over IPv4 frame from the guest (or to it).
+ *
+ * @returns The frame size.
+ * @param   pbFrame     The frame buffer, TST_CB_FRAME bytes.
+ * @param   uSrc        The source address (network order).
+ * @param   uDst        The destination address (network order).
+ * @param   bProto      RTNETIPV4_PROT_TCP or RTNETIPV4_PROT_UDP.
+ * @param   uSrcPort    The source port, ignored for non-first fragments.
+ * @param   uDstPort    The destination port, ignored for non-first fragments.
+ * @param   uId         The IP ID.
+ * @param   fOff        The IP flags and fragment offset.
+ * @param   fTcpFlags   The TCP flags.
+ */
+static size_t tstMakeFrame(uint8_t *pbFrame, uint32_t uSrc, uint32_t uDst, uint8_t bProto, uint16_t uSrcPort,
+                           uint16_t uDstPort, uint16_t uId, uint16_t fOff, uint8_t fTcpFlags)
+{
+    RT_BZERO(pbFrame, TST_CB_FRAME);
+    PRTNETETHERHDR pEthHdr = (PRTNETETHERHDR)pbFrame;
+    pEthHdr->EtherType = RT_H2BE_U16_C(RTNET_ETHERTYPE_IPV4);
+
+    PRTNETIPV4 pIpHdr = (PRTNETIPV4)(pEthHdr + 1);
+    pIpHdr->ip_v     = 4;
+    pIpHdr->ip_hl    = RTNETIPV4_MIN_LEN / 4;
+    pIpHdr->ip_len   = RT_H2BE_U16(RTNETIPV4_MIN_LEN + RTNETTCP_MIN_LEN);
+    pIpHdr->ip_id    = RT_H2BE_U16(uId);
+    pIpHdr->ip_off   = RT_H2BE_U16(fOff);
+    pIpHdr->ip_ttl   = 64;
+    pIpHdr->ip_p     = bProto;
+    pIpHdr->ip_src.u = uSrc;
+    pIpHdr->ip_dst.u = uDst;
+
+    if (!(fOff & UINT16_C(0x1fff)))
+    {
+        PRTNETTCP pTcpHdr = (PRTNETTCP)((uint8_t *)pIpHdr + RTNETIPV4_MIN_LEN);
+        pTcpHdr->th_sport = RT_H2BE_U16(uSrcPort);
+        pTcpHdr->th_dport = RT_H2BE_U16(uDstPort);
+        if (bProto == RTNETIPV4_PROT_TCP)
+        {
+            pTcpHdr->th_off   = RTNETTCP_MIN_LEN / 4;
+            pTcpHdr->th_flags = fTcpFlags;
+        }
+    }
+    return TST_CB_FRAME;
+}
+
+
+/**
+ * Returns the shard a frame from the guest goes to.
+ */
+static uint32_t tstShardOf(uint32_t uDst, uint8_t bProto, uint16_t uSrcPort, uint16_t uDstPort,
+                           uint16_t uId = 1, uint16_t fOff = 0, uint8_t fTcpFlags = RTNETTCP_F_ACK)
+{
+    uint8_t abFrame[TST_CB_FRAME];
+    size_t  cbFrame = tstMakeFrame(abFrame, TST_GUEST_IP, uDst, bProto, uSrcPort, uDstPort, uId, fOff, fTcpFlags);
+    return drvNATSelectShard(&g_This, abFrame, cbFrame);
+}
+
+
+/**
+ * Lets the first shard deliver a frame to the guest.
+ */
+static void tstDeliver(uint32_t uSrc, uint8_t bProto, uint16_t uSrcPort, uint16_t uDstPort, uint8_t fTcpFlags)
+{
+    uint8_t abFrame[TST_CB_FRAME];
+    size_t  cbFrame = tstMakeFrame(abFrame, uSrc, TST_GUEST_IP, bProto, uSrcPort, uDstPort, 1, 0, fTcpFlags);
+    drvNATFwdFlowLearn(&g_This.aShards[0], abFrame, cbFrame);
+}
+
+
+/**
+ * Finds a remote port, starting at uFirst, for which a flow from the guest port
+ * hashes to a shard other than the first.
+ */
+static uint16_t tstFindHashedPort(uint32_t uDst, uint8_t bProto, uint16_t uSrcPort, uint16_t uFirst, uint32_t *piShard)
+{
+    for (uint16_t uDstPort = uFirst; uDstPort < uFirst + 1000; uDstPort++)
+    {
+        uint32_t iShard = tstShardOf(uDst, bProto, uSrcPort, uDstPort);
+        if (iShard != 0)
+        {
+            *piShard = iShard;
+            return uDstPort;
+        }
+    }
+    RTTestFailed(g_hTest, "No flow hashing to another shard than the first");
+    *piShard = 0;
+    return 0;
+}
+
+
+/**
+ * Flows between the same two addresses are spread by their ports.
+ */
+static void tstSpread(void)
+{
+    RTTestSub(g_hTest, "Spreading");
+
+    uint32_t const uDst = RT_H2N_U32_C(UINT32_C(0xc0a80101));
+    uint32_t       acHits[TST_SHARDS] = { 0 };
+    for (uint16_t uSrcPort = 40000; uSrcPort < 40256; uSrcPort++)
+    {
+        uint32_t iShard = tstShardOf(uDst, RTNETIPV4_PROT_TCP, uSrcPort, 80);
+        RTTEST_CHECK_RETV(g_hTest, iShard < TST_SHARDS);
+        RTTEST_CHECK(g_hTest, tstShardOf(uDst, RTNETIPV4_PROT_TCP, uSrcPort, 80) == iShard);
+        acHits[iShard]++;
+    }
+    for (uint32_t iShard = 0; iShard < TST_SHARDS; iShard++)
+        RTTEST_CHECK_MSG(g_hTest, acHits[iShard] >= 256 / TST_SHARDS / 2,
+                         (g_hTest, "shard #%u got %u of 256 flows\n", iShard, acHits[iShard]));
+
+    /* DHCP always goes to the first shard. */
+    RTTEST_CHECK(g_hTest, tstShardOf(UINT32_MAX, RTNETIPV4_PROT_UDP, RTNETIPV4_PORT_BOOTPC, RTNETIPV4_PORT_BOOTPS) == 0);
+}
+
+
+/**
+ * The fragments of a datagram follow its first fragment.
+ */
+static void tstFragments(void)
+{
+    RTTestSub(g_hTest, "Fragments");
+
+    uint32_t const uDst = RT_H2N_U32_C(UINT32_C(0xc0a80102));
+    uint32_t       iShard;
+    uint16_t const uDstPort = tstFindHashedPort(uDst, RTNETIPV4_PROT_UDP, 5000, 1000, &iShard);
+
+    RTTEST_CHECK(g_hTest, tstShardOf(uDst, RTNETIPV4_PROT_UDP, 5000, uDstPort, 0x1234, RTNETIPV4_FLAGS_MF) == iShard);
+    RTTEST_CHECK(g_hTest, tstShardOf(uDst, RTNETIPV4_PROT_UDP, 0, 0, 0x1234, RTNETIPV4_FLAGS_MF | 185) == iShard);
+    RTTEST_CHECK(g_hTest, tstShardOf(uDst, RTNETIPV4_PROT_UDP, 0, 0, 0x1234, 370) == iShard);
+
+    /* Another datagram interleaved with the first one. */
+    uint32_t       iShard2;
+    uint16_t const uDstPort2 = tstFindHashedPort(uDst, RTNETIPV4_PROT_UDP, 5001, 1000, &iShard2);
+    RTTEST_CHECK(g_hTest, tstShardOf(uDst, RTNETIPV4_PROT_UDP, 5001, uDstPort2, 0x1235, RTNETIPV4_FLAGS_MF) == iShard2);
+    RTTEST_CHECK(g_hTest, tstShardOf(uDst, RTNETIPV4_PROT_UDP, 0, 0, 0x1234, 555) == iShard);
+    RTTEST_CHECK(g_hTest, tstShardOf(uDst, RTNETIPV4_PROT_UDP, 0, 0, 0x1235, 185) == iShard2);
+
+    /* Fragments of a datagram whose first fragment wasn't seen, or of another
+       protocol or source with the same ID, go to the first shard. */
+    RTTEST_CHECK(g_hTest, tstShardOf(uDst, RTNETIPV4_PROT_UDP, 0, 0, 0x4321, 185) == 0);
+    RTTEST_CHECK(g_hTest, tstShardOf(uDst, RTNETIPV4_PROT_TCP, 0, 0, 0x1234, 185) == 0);
+    RTTEST_CHECK(g_hTest, tstShardOf(uDst ^ RT_H2N_U32_C(1), RTNETIPV4_PROT_UDP, 0, 0, 0x1234, 185) == 0);
+}
+
+
+/**
+ * Replies of port-forwarded flows go to the first shard while slirp keeps
+ * their socket, no matter how long they are idle.
+ */
+static void tstPortForward(void)
+{
+    RTTestSub(g_hTest, "Port-forwarding");
+
+    uint32_t const uRemote = RT_H2N_U32_C(UINT32_C(0xc0a80103));
+    ASMBitSet(g_This.pbmFwdPorts, 2222);
+    ASMBitSet(g_This.pbmFwdPorts, _64K + 7777);
+
+    /* An outbound flow from the forwarded port keeps its shard. */
+    uint32_t       iShardOut;
+    uint16_t const uOutPort = tstFindHashedPort(uRemote, RTNETIPV4_PROT_TCP, 2222, 80, &iShardOut);
+
+    /* An inbound connection delivered by the first shard. */
+    uint32_t       iShardIn;
+    uint16_t const uInPort = tstFindHashedPort(uRemote, RTNETIPV4_PROT_TCP, 2222, 50000, &iShardIn);
+    tstDeliver(uRemote, RTNETIPV4_PROT_TCP, uInPort, 2222, RTNETTCP_F_SYN);
+    RTTEST_CHECK(g_hTest, tstShardOf(uRemote, RTNETIPV4_PROT_TCP, 2222, uInPort, 1, 0, RTNETTCP_F_SYN | RTNETTCP_F_ACK) == 0);
+    RTTEST_CHECK(g_hTest, tstShardOf(uRemote, RTNETIPV4_PROT_TCP, 2222, uOutPort) == iShardOut);
+
+    /* Idle for hours, still there. */
+    RTCritSectEnter(&g_This.FwdFlowLock);
+    drvNATFwdFlowSweep(&g_This, RTTimeMilliTS() + 24 * RT_MS_1HOUR);
+    RTCritSectLeave(&g_This.FwdFlowLock);
+    RTTEST_CHECK(g_hTest, tstShardOf(uRemote, RTNETIPV4_PROT_TCP, 2222, uInPort) == 0);
+
+    /* Closing the connection doesn't forget it, only slirp freeing the socket does. */
+    tstDeliver(uRemote, RTNETIPV4_PROT_TCP, uInPort, 2222, RTNETTCP_F_FIN | RTNETTCP_F_ACK);
+    RTTEST_CHECK(g_hTest, tstShardOf(uRemote, RTNETIPV4_PROT_TCP, 2222, uInPort, 1, 0, RTNETTCP_F_FIN | RTNETTCP_F_ACK) == 0);
+    slirp_fwd_tcp_closed(&g_This.aShards[0], uRemote, uInPort, 2222);
+    RTTEST_CHECK(g_hTest, tstShardOf(uRemote, RTNETIPV4_PROT_TCP, 2222, uInPort) == iShardIn);
+
+    /* A late RST doesn't bring it back. */
+    tstDeliver(uRemote, RTNETIPV4_PROT_TCP, uInPort, 2222, RTNETTCP_F_RST);
+    RTTEST_CHECK(g_hTest, tstShardOf(uRemote, RTNETIPV4_PROT_TCP, 2222, uInPort) == iShardIn);
+
+    /* UDP flows expire when idle, fragments included. */
+    uint32_t       iShardUdp;
+    uint16_t const uUdpPort = tstFindHashedPort(uRemote, RTNETIPV4_PROT_UDP, 7777, 50000, &iShardUdp);
+    tstDeliver(uRemote, RTNETIPV4_PROT_UDP, uUdpPort, 7777, 0);
+    RTTEST_CHECK(g_hTest, tstShardOf(uRemote, RTNETIPV4_PROT_UDP, 7777, uUdpPort, 0x777, RTNETIPV4_FLAGS_MF) == 0);
+    RTTEST_CHECK(g_hTest, tstShardOf(uRemote, RTNETIPV4_PROT_UDP, 0, 0, 0x777, 185) == 0);
+    RTCritSectEnter(&g_This.FwdFlowLock);
+    drvNATFwdFlowSweep(&g_This, RTTimeMilliTS() + DRVNAT_FWD_FLOW_UDP_IDLE_MS + RT_MS_1SEC);
+    RTCritSectLeave(&g_This.FwdFlowLock);
+    RTTEST_CHECK(g_hTest, tstShardOf(uRemote, RTNETIPV4_PROT_UDP, 7777, uUdpPort) == iShardUdp);
+}
+
+
+/**
+ * Sends a TCP/IPv4 GSO frame the way the NIC does and checks what the NAT
+ * engine gets.
+ */
+static void tstGsoSendOne(uint32_t cbPayload, uint32_t cExpectInput, uint32_t cExpectWrapped)
+{
+    uint32_t const cbHdrs = TST_CB_FRAME;
+    PDMNETWORKGSO  Gso;
+    Gso.u8Type      = PDMNETWORKGSOTYPE_IPV4_TCP;
+    Gso.cbHdrsTotal = cbHdrs;
+    Gso.cbHdrsSeg   = cbHdrs;
+    Gso.offHdr1     = sizeof(RTNETETHERHDR);
+    Gso.offHdr2     = sizeof(RTNETETHERHDR) + RTNETIPV4_MIN_LEN;
+    Gso.cbMaxSeg    = 1000;
+
+    /* Mirrors the GSO branch of drvNATNetworkUp_AllocBuf. */
+    PPDMSCATTERGATHER pSgBuf = (PPDMSCATTERGATHER)RTMemAlloc(sizeof(*pSgBuf));
+    RTTEST_CHECK_RETV(g_hTest, pSgBuf);
+    pSgBuf->fFlags         = PDMSCATTERGATHER_FLAGS_MAGIC | PDMSCATTERGATHER_FLAGS_OWNER_1;
+    pSgBuf->pvUser         = RTMemDup(&Gso, sizeof(Gso));
+    pSgBuf->pvAllocator    = NULL;
+    pSgBuf->cbUsed         = cbHdrs + cbPayload;
+    pSgBuf->cSegs          = 1;
+    pSgBuf->aSegs[0].cbSeg = RT_ALIGN_Z(pSgBuf->cbUsed, 16);
+    pSgBuf->aSegs[0].pvSeg = RTMemAlloc(pSgBuf->aSegs[0].cbSeg + DRVNAT_GSO_TAIL);
+    pSgBuf->cbAvailable    = pSgBuf->aSegs[0].cbSeg;
+    RTTEST_CHECK_RETV(g_hTest, pSgBuf->pvUser && pSgBuf->aSegs[0].pvSeg);
+
+    uint8_t *pbFrame = (uint8_t *)pSgBuf->aSegs[0].pvSeg;
+    tstMakeFrame(pbFrame, TST_GUEST_IP, RT_H2N_U32_C(UINT32_C(0xc0a80104)), RTNETIPV4_PROT_TCP, 40000, 80, 1, 0,
+                 RTNETTCP_F_ACK | RTNETTCP_F_PSH);
+    for (uint32_t off = 0; off < cbPayload; off++)
+        pbFrame[cbHdrs + off] = (uint8_t)(off * 7 + off / 251);
+
+    g_cInput    = 0;
+    g_cWrapped  = 0;
+    g_cbPayload = 0;
+    RT_ZERO(g_abPayload);
+    drvNATSendWorker(&g_This.aShards[0], pSgBuf);
+
+    RTTEST_CHECK_MSG(g_hTest, g_cInput == cExpectInput, (g_hTest, "g_cInput=%u, expected %u\n", g_cInput, cExpectInput));
+    RTTEST_CHECK_MSG(g_hTest, g_cWrapped == cExpectWrapped,
+                     (g_hTest, "g_cWrapped=%u, expected %u\n", g_cWrapped, cExpectWrapped));
+    RTTEST_CHECK_MSG(g_hTest, g_cbPayload == cbPayload, (g_hTest, "g_cbPayload=%u, expected %u\n", g_cbPayload, cbPayload));
+    for (uint32_t off = 0; off < RT_MIN(g_cbPayload, cbPayload); off++)
+        if (g_abPayload[off] != (uint8_t)(off * 7 + off / 251))
+        {
+            RTTestFailed(g_hTest, "Payload differs at offset %#x", off);
+            break;
+        }
+}
+
+
+/**
+ * TCP/IPv4 GSO frames are passed on in one piece, or segmented when that
+ * isn't possible.
+ */
+static void tstGsoSend(void)
+{
+    RTTestSub(g_hTest, "GSO sending");
+
+    g_This.enmLinkState = PDMNETWORKLINKSTATE_UP;
+
+    g_fWrapFails = false;
+    tstGsoSendOne(4500, 1, 1);
+
+    /* Out of mbufs for wrapping, must fall back on segmenting. */
+    g_fWrapFails = true;
+    tstGsoSendOne(4500, 5, 0);
+
+    g_fWrapFails = false;
+    g_This.enmLinkState = PDMNETWORKLINKSTATE_DOWN;
+}
+
+
+int main()
+{
+    RTEXITCODE rcExit = RTTestInitAndCreate("tstDrvNAT", &g_hTest);
+    if (rcExit != RTEXITCODE_SUCCESS)
+        return rcExit;
+    RTTestBanner(g_hTest);
+
+    /*
+     * Just enough of a driver instance for classifying frames.
+     */
+    g_This.cShards = TST_SHARDS;
+    for (uint32_t iShard = 0; iShard < TST_SHARDS; iShard++)
+    {
+        g_This.aShards[iShard].pThis  = &g_This;
+        g_This.aShards[iShard].iShard = iShard;
+    }
+    g_This.pbmFwdPorts = (uint32_t *)RTMemAllocZ(2 * _64K / 8);
+    RTTEST_CHECK_RET(g_hTest, g_This.pbmFwdPorts, RTTestSummaryAndDestroy(g_hTest));
+    RTTEST_CHECK_RC_RET(g_hTest, RTCritSectInit(&g_This.FwdFlowLock), VINF_SUCCESS, RTTestSummaryAndDestroy(g_hTest));
+
+    tstSpread();
+    tstFragments();
+    tstPortForward();
+    tstGsoSend();
+
+    for (unsigned iProto = 0; iProto < RT_ELEMENTS(g_This.apFwdFlows); iProto++)
+        RTAvlrU64Destroy(&g_This.apFwdFlows[iProto], drvNATFwdFlowFreeCallback, NULL);
+    RTCritSectDelete(&g_This.FwdFlowLock);
+    RTMemFree(g_This.pbmFwdPorts);
+    return RTTestSummaryAndDestroy(g_hTest);
+}
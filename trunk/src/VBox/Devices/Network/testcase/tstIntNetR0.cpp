@@ -731,6 +731,183 @@ static void doTest(PTSTSTATE pThis, uint32_t cbRecv, uint32_t cbSend)
 }
 
 
+/**
+ * Switching benchmark sender/receiver pair.
+ */
+typedef struct TSTSWPAIR
+{
+    INTNETIFHANDLE      hIfSend;
+    PINTNETBUF          pBufSend;
+    INTNETIFHANDLE      hIfRecv;
+    PINTNETBUF          pBufRecv;
+    RTMAC               MacSend;
+    RTMAC               MacRecv;
+    uint32_t            cFrames;
+    uint32_t            cReceived;
+    bool volatile      *pfGo;
+    RTTHREAD            hThread;
+} TSTSWPAIR;
+typedef TSTSWPAIR *PTSTSWPAIR;
+
+
+/**
+ * Switching benchmark sender thread.
+ *
+ * Sends small unicast frames to the receiver interface of the pair in bursts
+ * and drains the receiver after each burst, so we measure the switching and
+ * not the ring buffer space.
+ */
+static DECLCALLBACK(int) tstSwitchSendThread(RTTHREAD hThreadSelf, void *pvArg)
+{
+    PTSTSWPAIR pPair = (PTSTSWPAIR)pvArg;
+    NOREF(hThreadSelf);
+
+    uint8_t     abFrame[64];
+    RT_ZERO(abFrame);
+    MYFRAMEHDR *pHdr = (MYFRAMEHDR *)&abFrame[0];
+    pHdr->DstMac = pPair->MacRecv;
+    pHdr->SrcMac = pPair->MacSend;
+
+    while (!ASMAtomicReadBool(pPair->pfGo))
+        ASMNopPause();
+
+    int      rc     = VINF_SUCCESS;
+    uint32_t iFrame = 0;
+    while (iFrame < pPair->cFrames && RT_SUCCESS(rc))
+    {
+        for (uint32_t i = 0; i < 16 && iFrame < pPair->cFrames; i++, iFrame++)
+        {
+            pHdr->iFrame = iFrame;
+            INTNETSG Sg;
+            IntNetSgInitTemp(&Sg, abFrame, sizeof(abFrame));
+            rc = intnetR0RingWriteFrame(&pPair->pBufSend->Send, &Sg, NULL);
+            if (RT_FAILURE(rc))
+                break;
+        }
+        if (RT_SUCCESS(rc))
+            rc = IntNetR0IfSend(pPair->hIfSend, g_pSession);
+
+        while (IntNetRingHasMoreToRead(&pPair->pBufRecv->Recv))
+        {
+            IntNetRingSkipFrame(&pPair->pBufRecv->Recv);
+            pPair->cReceived++;
+        }
+    }
+    return rc;
+}
+
+
+/**
+ * Measures the switching rate with an increasing number of concurrent senders.
+ *
+ * Each sender has its own receiver, so the only thing the senders share is the
+ * network and its MAC address table.  The runs are done both with and without
+ * the lockless switching for comparison.  This takes a while, so it is only
+ * done when asked to (--switch-bench).
+ *
+ * @param   cMaxSenders         The max number of concurrent senders.
+ * @param   cFrames             Number of frames each sender transmits.
+ */
+static void doSwitchBenchmark(uint32_t cMaxSenders, uint32_t cFrames)
+{
+    RTTestISub("Switching benchmark setup");
+    RTTESTI_CHECK_RC_RETV(IntNetR0Init(), VINF_SUCCESS);
+
+    PTSTSWPAIR paPairs = (PTSTSWPAIR)RTMemAllocZ(sizeof(paPairs[0]) * cMaxSenders);
+    RTTESTI_CHECK_RETV(paPairs);
+
+    bool volatile fGo = false;
+    uint32_t iPair;
+    for (iPair = 0; iPair < cMaxSenders; iPair++)
+    {
+        PTSTSWPAIR pPair = &paPairs[iPair];
+        pPair->pfGo            = &fGo;
+        pPair->MacSend.au16[0] = 0x8086;
+        pPair->MacSend.au16[1] = 0x5000;
+        pPair->MacSend.au16[2] = (uint16_t)(iPair * 2);
+        pPair->MacRecv         = pPair->MacSend;
+        pPair->MacRecv.au16[2] = (uint16_t)(iPair * 2 + 1);
+
+        int rc;
+        RTTESTI_CHECK_RC_OK_BREAK(rc = IntNetR0Open(g_pSession, "switch", kIntNetTrunkType_None, "", 0 /*fFlags*/,
+                                                    1536 * 8, 0x8000, &pPair->hIfSend));
+        RTTESTI_CHECK_RC_OK_BREAK(rc = IntNetR0Open(g_pSession, "switch", kIntNetTrunkType_None, "", 0 /*fFlags*/,
+                                                    1536 * 2, 0x8000, &pPair->hIfRecv));
+        RTTESTI_CHECK_RC_OK_BREAK(rc = IntNetR0IfGetBufferPtrs(pPair->hIfSend, g_pSession, &pPair->pBufSend, NULL));
+        RTTESTI_CHECK_RC_OK_BREAK(rc = IntNetR0IfGetBufferPtrs(pPair->hIfRecv, g_pSession, &pPair->pBufRecv, NULL));
+        RTTESTI_CHECK_RC_OK_BREAK(rc = IntNetR0IfSetMacAddress(pPair->hIfSend, g_pSession, &pPair->MacSend));
+        RTTESTI_CHECK_RC_OK_BREAK(rc = IntNetR0IfSetMacAddress(pPair->hIfRecv, g_pSession, &pPair->MacRecv));
+        RTTESTI_CHECK_RC_OK_BREAK(rc = IntNetR0IfSetActive(pPair->hIfSend, g_pSession, true));
+        RTTESTI_CHECK_RC_OK_BREAK(rc = IntNetR0IfSetActive(pPair->hIfRecv, g_pSession, true));
+    }
+
+    if (!RTTestIErrorCount())
+    {
+        for (uint32_t cSenders = 1; cSenders <= cMaxSenders; cSenders *= 2)
+            for (unsigned iMode = 0; iMode < 2; iMode++)
+            {
+                bool const fLockless = iMode != 0;
+                RTTestISubF("Switching %u sender(s), %s", cSenders, fLockless ? "lockless" : "spinlock");
+                g_fIntNetNoSwSnap = !fLockless;
+                ASMAtomicWriteBool(&fGo, false);
+
+                uint32_t cStarted = 0;
+                for (; cStarted < cSenders; cStarted++)
+                {
+                    paPairs[cStarted].cFrames   = cFrames;
+                    paPairs[cStarted].cReceived = 0;
+                    int rc = RTThreadCreateF(&paPairs[cStarted].hThread, tstSwitchSendThread, &paPairs[cStarted], 0,
+                                             RTTHREADTYPE_EMULATION, RTTHREADFLAGS_WAITABLE, "SWSEND%u", cStarted);
+                    if (RT_FAILURE(rc))
+                    {
+                        RTTestIFailed("RTThreadCreateF -> %Rrc", rc);
+                        break;
+                    }
+                }
+
+                uint64_t const nsStart = RTTimeNanoTS();
+                ASMAtomicWriteBool(&fGo, true);
+                uint64_t cTotal = 0;
+                for (uint32_t i = 0; i < cStarted; i++)
+                {
+                    int rcThread = VERR_INTERNAL_ERROR;
+                    RTTESTI_CHECK_RC_OK(RTThreadWait(paPairs[i].hThread, 5*60*1000, &rcThread));
+                    RTTESTI_CHECK_RC_OK(rcThread);
+                    while (IntNetRingHasMoreToRead(&paPairs[i].pBufRecv->Recv))
+                    {
+                        IntNetRingSkipFrame(&paPairs[i].pBufRecv->Recv);
+                        paPairs[i].cReceived++;
+                    }
+                    if (paPairs[i].cReceived != cFrames)
+                        RTTestIFailed("pair #%u: received %u frames, sent %u", i, paPairs[i].cReceived, cFrames);
+                    cTotal += paPairs[i].cReceived;
+                }
+                uint64_t const cNsElapsed = RT_MAX(RTTimeNanoTS() - nsStart, 1);
+
+                RTTestIValue("Throughput", cTotal * RT_NS_1SEC / cNsElapsed, RTTESTUNIT_FRAMES_PER_SEC);
+                RTTestPrintf(g_hTest, RTTESTLVL_ALWAYS, "%u sender(s), %s: %u.%03u Mpps\n", cSenders,
+                             fLockless ? "lockless" : "spinlock", (unsigned)(cTotal * 1000 / cNsElapsed),
+                             (unsigned)(cTotal * 1000000 / cNsElapsed % 1000));
+            }
+        g_fIntNetNoSwSnap = false;
+    }
+
+    /*
+     * Cleanup.
+     */
+    for (iPair = 0; iPair < cMaxSenders; iPair++)
+    {
+        if (paPairs[iPair].hIfSend != INTNET_HANDLE_INVALID)
+            RTTESTI_CHECK_RC_OK(IntNetR0IfClose(paPairs[iPair].hIfSend, g_pSession));
+        if (paPairs[iPair].hIfRecv != INTNET_HANDLE_INVALID)
+            RTTESTI_CHECK_RC_OK(IntNetR0IfClose(paPairs[iPair].hIfRecv, g_pSession));
+    }
+    RTTESTI_CHECK(IntNetR0GetNetworkCount() == 0);
+    RTMemFree(paPairs);
+    IntNetR0Term();
+}
+
+
 int main(int argc, char **argv)
 {
     int rc = RTTestInitAndCreate("tstIntNetR0", &g_hTest);
@@ -745,10 +922,16 @@ int main(int argc, char **argv)
         { "--recv-buffer",   'r', RTGETOPT_REQ_UINT32 },
         { "--send-buffer",   's', RTGETOPT_REQ_UINT32 },
         { "--transfer-size", 'l', RTGETOPT_REQ_UINT32 },
+        { "--max-senders",   'c', RTGETOPT_REQ_UINT32 },
+        { "--switch-frames", 'f', RTGETOPT_REQ_UINT32 },
+        { "--switch-bench",  'b', RTGETOPT_REQ_NOTHING },
     };
 
-    uint32_t cbSend = 1536*2 + 4;
-    uint32_t cbRecv = 0x8000;
+    uint32_t cbSend      = 1536*2 + 4;
+    uint32_t cbRecv      = 0x8000;
+    uint32_t cMaxSenders = RT_MIN(RT_MAX(RTMpGetOnlineCount(), 1), 16);
+    uint32_t cSwFrames   = 400000;
+    bool     fSwBench    = false;
 
     int ch;
     RTGETOPTUNION Value;
@@ -769,6 +952,18 @@ int main(int argc, char **argv)
                 cbSend = Value.u32;
                 break;
 
+            case 'c':
+                cMaxSenders = RT_MAX(Value.u32, 1);
+                break;
+
+            case 'f':
+                cSwFrames = RT_MAX(Value.u32, 1);
+                break;
+
+            case 'b':
+                fSwBench = true;
+                break;
+
             default:
                 return RTGetOptPrintError(ch, &Value);
         }
@@ -779,6 +974,8 @@ int main(int argc, char **argv)
     TSTSTATE This;
     RT_ZERO(This);
     doTest(&This, cbRecv, cbSend);
+    if (fSwBench && !RTTestIErrorCount())
+        doSwitchBenchmark(cMaxSenders, cSwFrames);
 
     return RTTestSummaryAndDestroy(g_hTest);
 }
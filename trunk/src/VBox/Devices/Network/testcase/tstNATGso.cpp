@@ -0,0 +1,248 @@
+/* $Id$ */
+/** @file
+ * NAT Testcase: GSO frame hand-off throughput into a local TCP sink.
+ *
+ * Compares the two ways DrvNAT passes a TCP/IPv4 GSO frame from the guest to
+ * a host socket: carving it into MSS sized segments that are copied and
+ * checksummed one at a time, and fixing up the headers in place and writing
+ * the whole payload at once.
+ */
+
+/*
+ * Copyright (C) 2016 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ */
+
+
+/*********************************************************************************************************************************
+*   Header Files                                                                                                                 *
+*********************************************************************************************************************************/
+#include <VBox/vmm/pdmnetinline.h>
+#include <VBox/err.h>
+
+#include <iprt/asm.h>
+#include <iprt/getopt.h>
+#include <iprt/initterm.h>
+#include <iprt/mem.h>
+#include <iprt/rand.h>
+#include <iprt/semaphore.h>
+#include <iprt/string.h>
+#include <iprt/tcp.h>
+#include <iprt/test.h>
+#include <iprt/time.h>
+
+
+/*********************************************************************************************************************************
+*   Defined Constants And Macros                                                                                                 *
+*********************************************************************************************************************************/
+/** Size of the ethernet + IPv4 + TCP headers of the test frame. */
+#define TST_CB_HDRS     (sizeof(RTNETETHERHDR) + RTNETIPV4_MIN_LEN + RTNETTCP_MIN_LEN)
+
+
+/*********************************************************************************************************************************
+*   Global Variables                                                                                                             *
+*********************************************************************************************************************************/
+static RTTEST           g_hTest;
+/** Bytes received by the sink in the current run. */
+static uint64_t volatile g_cbSunk;
+/** Signalled by the sink when the client has disconnected. */
+static RTSEMEVENT       g_hEvtSinkDone;
+
+
+/**
+ * The sink: reads and discards everything until the client disconnects.
+ */
+static DECLCALLBACK(int) tstSinkServe(RTSOCKET hSocket, void *pvUser)
+{
+    RT_NOREF(pvUser);
+    static uint8_t s_abBuf[_64K];
+    uint64_t cbTotal = 0;
+    for (;;)
+    {
+        size_t cbRead = 0;
+        int rc = RTTcpRead(hSocket, s_abBuf, sizeof(s_abBuf), &cbRead);
+        if (RT_FAILURE(rc) || !cbRead)
+            break;
+        cbTotal += cbRead;
+    }
+    ASMAtomicWriteU64(&g_cbSunk, cbTotal);
+    RTSemEventSignal(g_hEvtSinkDone);
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Builds a TCP/IPv4 GSO frame with @a cbPayload bytes of random payload.
+ */
+static void tstBuildFrame(uint8_t *pbFrame, uint32_t cbPayload, PPDMNETWORKGSO pGso)
+{
+    RT_BZERO(pbFrame, TST_CB_HDRS);
+    PRTNETETHERHDR pEthHdr = (PRTNETETHERHDR)pbFrame;
+    pEthHdr->EtherType = RT_H2BE_U16_C(RTNET_ETHERTYPE_IPV4);
+    pEthHdr->SrcMac.au8[0] = 0x08;
+    pEthHdr->DstMac.au8[0] = 0x52;
+
+    PRTNETIPV4 pIpHdr = (PRTNETIPV4)(pEthHdr + 1);
+    pIpHdr->ip_v     = 4;
+    pIpHdr->ip_hl    = RTNETIPV4_MIN_LEN / 4;
+    pIpHdr->ip_ttl   = 64;
+    pIpHdr->ip_p     = RTNETIPV4_PROT_TCP;
+    pIpHdr->ip_src.u = RT_H2N_U32_C(UINT32_C(0x0a00020f)); /* 10.0.2.15 */
+    pIpHdr->ip_dst.u = RT_H2N_U32_C(UINT32_C(0x0a000202)); /* 10.0.2.2 */
+
+    PRTNETTCP pTcpHdr = (PRTNETTCP)(pIpHdr + 1);
+    pTcpHdr->th_sport = RT_H2N_U16_C(40000);
+    pTcpHdr->th_dport = RT_H2N_U16_C(9999);
+    pTcpHdr->th_seq   = RT_H2N_U32_C(1);
+    pTcpHdr->th_off   = RTNETTCP_MIN_LEN / 4;
+    pTcpHdr->th_flags = RTNETTCP_F_ACK | RTNETTCP_F_PSH;
+    pTcpHdr->th_win   = RT_H2N_U16_C(0xffff);
+
+    RTRandBytes(pbFrame + TST_CB_HDRS, cbPayload);
+
+    pGso->u8Type      = PDMNETWORKGSOTYPE_IPV4_TCP;
+    pGso->cbHdrsTotal = (uint8_t)TST_CB_HDRS;
+    pGso->cbHdrsSeg   = (uint8_t)TST_CB_HDRS;
+    pGso->cbMaxSeg    = 1460;
+    pGso->offHdr1     = sizeof(RTNETETHERHDR);
+    pGso->offHdr2     = sizeof(RTNETETHERHDR) + RTNETIPV4_MIN_LEN;
+    pGso->u8Unused    = 0;
+}
+
+
+/**
+ * Pushes @a cFrames GSO frames through one of the hand-off methods into the
+ * sink and reports the throughput.
+ *
+ * @param   fDirect     Whether to pass the frame as a whole (true) or to
+ *                      segment, copy and checksum it (false).
+ */
+static void tstRun(uint16_t uPort, uint8_t *pbFrame, uint32_t cbFrame, PCPDMNETWORKGSO pGso, uint32_t cFrames, bool fDirect)
+{
+    RTTestSubF(g_hTest, "%s, %u byte frames", fDirect ? "direct" : "segmented", cbFrame);
+
+    RTSOCKET hSocket;
+    int rc = RTTcpClientConnect("localhost", uPort, &hSocket);
+    if (RT_FAILURE(rc))
+    {
+        RTTestFailed(g_hTest, "RTTcpClientConnect -> %Rrc", rc);
+        return;
+    }
+
+    uint8_t        abHdrs[TST_CB_HDRS];
+    uint8_t       *pbSeg     = (uint8_t *)RTMemAlloc(TST_CB_HDRS + pGso->cbMaxSeg);
+    uint32_t const cSegs     = PDMNetGsoCalcSegmentCount(pGso, cbFrame);
+    uint32_t const cbPayload = cbFrame - TST_CB_HDRS;
+    uint64_t       cbSent    = 0;
+    memcpy(abHdrs, pbFrame, sizeof(abHdrs));
+
+    uint64_t const nsStart = RTTimeNanoTS();
+    for (uint32_t iFrame = 0; iFrame < cFrames && RT_SUCCESS(rc) && pbSeg; iFrame++)
+    {
+        if (fDirect)
+        {
+            /* What DrvNAT does now: headers fixed in place, one write. */
+            memcpy(pbFrame, abHdrs, sizeof(abHdrs));
+            PDMNetGsoPrepForDirectUse(pGso, pbFrame, cbFrame, PDMNETCSUMTYPE_NONE);
+            rc = RTTcpWrite(hSocket, pbFrame + TST_CB_HDRS, cbPayload);
+            cbSent += cbPayload;
+        }
+        else
+        {
+            /* What it did before: carve, copy into an mbuf, verify the checksum
+               in tcp_input and write each segment. */
+            for (uint32_t iSeg = 0; iSeg < cSegs && RT_SUCCESS(rc); iSeg++)
+            {
+                uint32_t cbSegHdrs, cbSegPayload;
+                uint32_t offPayload = PDMNetGsoCarveSegment(pGso, pbFrame, cbFrame, iSeg, cSegs, pbSeg,
+                                                            &cbSegHdrs, &cbSegPayload);
+                memcpy(pbSeg + cbSegHdrs, pbFrame + offPayload, cbSegPayload);
+                uint32_t const cbTcpHdr = cbSegHdrs - pGso->offHdr2;
+                if (!RTNetIPv4IsTCPValid((PCRTNETIPV4)(pbSeg + pGso->offHdr1), (PCRTNETTCP)(pbSeg + pGso->offHdr2), cbTcpHdr,
+                                         pbSeg + cbSegHdrs, cbTcpHdr + cbSegPayload, true /*fChecksum*/))
+                    RTTestFailed(g_hTest, "bad checksum on segment %u", iSeg);
+                rc = RTTcpWrite(hSocket, pbSeg + cbSegHdrs, cbSegPayload);
+                cbSent += cbSegPayload;
+            }
+        }
+    }
+    uint64_t const cNsElapsed = RT_MAX(RTTimeNanoTS() - nsStart, 1);
+    if (RT_FAILURE(rc))
+        RTTestFailed(g_hTest, "RTTcpWrite -> %Rrc", rc);
+
+    RTTcpClientClose(hSocket);
+    RTTESTI_CHECK_RC(RTSemEventWait(g_hEvtSinkDone, RT_MS_1MIN), VINF_SUCCESS);
+    if (ASMAtomicReadU64(&g_cbSunk) != cbSent)
+        RTTestFailed(g_hTest, "sink got %RU64 bytes, sent %RU64", ASMAtomicReadU64(&g_cbSunk), cbSent);
+
+    RTTestValue(g_hTest, "throughput", cbSent * RT_NS_1SEC / cNsElapsed / _1M, RTTESTUNIT_MEGABYTES_PER_SEC);
+    RTTestValue(g_hTest, "frame", cNsElapsed / RT_MAX(cFrames, 1), RTTESTUNIT_NS_PER_CALL);
+    RTMemFree(pbSeg);
+}
+
+
+int main(int argc, char **argv)
+{
+    RTEXITCODE rcExit = RTTestInitAndCreate("tstNATGso", &g_hTest);
+    if (rcExit != RTEXITCODE_SUCCESS)
+        return rcExit;
+    RTTestBanner(g_hTest);
+
+    /*
+     * Parse arguments.
+     */
+    static const RTGETOPTDEF s_aOptions[] =
+    {
+        { "--port",     'p', RTGETOPT_REQ_UINT16 },
+        { "--frames",   'f', RTGETOPT_REQ_UINT32 },
+    };
+    uint16_t uPort   = 9998;
+    uint32_t cFrames = 4096;
+
+    RTGETOPTSTATE GetState;
+    RTGetOptInit(&GetState, argc, argv, s_aOptions, RT_ELEMENTS(s_aOptions), 1, 0 /*fFlags*/);
+    RTGETOPTUNION ValueUnion;
+    int ch;
+    while ((ch = RTGetOpt(&GetState, &ValueUnion)))
+    {
+        switch (ch)
+        {
+            case 'p': uPort   = ValueUnion.u16; break;
+            case 'f': cFrames = RT_MAX(ValueUnion.u32, 1); break;
+            default:
+                return RTGetOptPrintError(ch, &ValueUnion);
+        }
+    }
+
+    RTTESTI_CHECK_RC_RET(RTSemEventCreate(&g_hEvtSinkDone), VINF_SUCCESS, RTTestSummaryAndDestroy(g_hTest));
+    PRTTCPSERVER pServer;
+    int rc = RTTcpServerCreate("localhost", uPort, RTTHREADTYPE_DEFAULT, "sink", tstSinkServe, NULL, &pServer);
+    if (RT_SUCCESS(rc))
+    {
+        static uint32_t const s_acbFrames[] = { 8192 + TST_CB_HDRS, 32768 + TST_CB_HDRS, UINT16_MAX - RTNETIPV4_MIN_LEN };
+        uint8_t *pbFrame = (uint8_t *)RTMemAlloc(_64K);
+        RTTESTI_CHECK(pbFrame != NULL);
+        for (unsigned i = 0; i < RT_ELEMENTS(s_acbFrames) && pbFrame; i++)
+        {
+            PDMNETWORKGSO Gso;
+            tstBuildFrame(pbFrame, s_acbFrames[i] - TST_CB_HDRS, &Gso);
+            RTTESTI_CHECK(PDMNetGsoIsValid(&Gso, sizeof(Gso), s_acbFrames[i]));
+            tstRun(uPort, pbFrame, s_acbFrames[i], &Gso, cFrames, false /*fDirect*/);
+            tstRun(uPort, pbFrame, s_acbFrames[i], &Gso, cFrames, true /*fDirect*/);
+        }
+        RTMemFree(pbFrame);
+        RTTcpServerDestroy(pServer);
+    }
+    else
+        RTTestFailed(g_hTest, "RTTcpServerCreate -> %Rrc", rc);
+
+    RTSemEventDestroy(g_hEvtSinkDone);
+    return RTTestSummaryAndDestroy(g_hTest);
+}
@@ -440,6 +440,10 @@ typedef struct VBOXDISK
     STAMCOUNTER              StatReqsDiscard;
     /** Release statistics: Number of I/O requests processed per second. */
     STAMCOUNTER              StatReqsPerSec;
+    /** Release statistics: Number of auxiliary allocations made by VD on the I/O path. */
+    STAMCOUNTER              StatIoAuxAllocs;
+    /** Release statistics: Number of heap allocations made by VD on the I/O path. */
+    STAMCOUNTER              StatIoAuxHeapAllocs;
     /** @} */
 } VBOXDISK;
 
@@ -453,6 +457,7 @@ static void drvvdPowerOffOrDestructOrUnmount(PPDMDRVINS pDrvIns);
 DECLINLINE(void) drvvdMediaExIoReqBufFree(PVBOXDISK pThis, PPDMMEDIAEXIOREQINT pIoReq);
 static int drvvdMediaExIoReqCompleteWorker(PVBOXDISK pThis, PPDMMEDIAEXIOREQINT pIoReq, int rcReq, bool fUpNotify);
 static int drvvdMediaExIoReqReadWriteProcess(PVBOXDISK pThis, PPDMMEDIAEXIOREQINT pIoReq, bool fUpNotify);
+static void drvvdStatsUpdateIoAlloc(PVBOXDISK pThis);
 
 /**
  * Internal: allocate new image descriptor and put it in the list
@@ -1951,6 +1956,7 @@ static DECLCALLBACK(int) drvvdRead(PPDMIMEDIA pInterface,
     if (RT_SUCCESS(rc))
     {
         STAM_REL_COUNTER_INC(&pThis->StatReqsSucceeded);
+        drvvdStatsUpdateIoAlloc(pThis);
         STAM_REL_COUNTER_ADD(&pThis->StatBytesRead, cbRead);
         Log2(("%s: off=%#llx pvBuf=%p cbRead=%d\n%.*Rhxd\n", __FUNCTION__,
               off, pvBuf, cbRead, cbRead, pvBuf));
@@ -2078,6 +2084,7 @@ static DECLCALLBACK(int) drvvdWrite(PPDMIMEDIA pInterface,
     if (RT_SUCCESS(rc))
     {
         STAM_REL_COUNTER_INC(&pThis->StatReqsSucceeded);
+        drvvdStatsUpdateIoAlloc(pThis);
         STAM_REL_COUNTER_ADD(&pThis->StatBytesWritten, cbWrite);
     }
     else
@@ -2996,6 +3003,7 @@ static void drvvdMediaExIoReqRetire(PVBOXDISK pThis, PPDMMEDIAEXIOREQINT pIoReq,
     else
     {
         STAM_REL_COUNTER_INC(&pThis->StatReqsSucceeded);
+        drvvdStatsUpdateIoAlloc(pThis);
 
         switch (pIoReq->enmType)
         {
@@ -4476,6 +4484,13 @@ static int drvvdStatsRegister(PVBOXDISK pThis)
                                    "Number of processed I/O requests per second.", "/Devices/%s%u/Port%u/ReqsPerSec",
                                    pszCtrlUpper, iInstance, iLUN);
 
+            PDMDrvHlpSTAMRegisterF(pDrvIns, &pThis->StatIoAuxAllocs, STAMTYPE_COUNTER, STAMVISIBILITY_USED, STAMUNIT_COUNT,
+                                   "Number of auxiliary allocations made for I/O requests.", "/Devices/%s%u/Port%u/IoAuxAllocs",
+                                   pszCtrlUpper, iInstance, iLUN);
+            PDMDrvHlpSTAMRegisterF(pDrvIns, &pThis->StatIoAuxHeapAllocs, STAMTYPE_COUNTER, STAMVISIBILITY_USED, STAMUNIT_COUNT,
+                                   "Number of heap allocations made for I/O requests.", "/Devices/%s%u/Port%u/IoAuxHeapAllocs",
+                                   pszCtrlUpper, iInstance, iLUN);
+
             RTStrFree(pszCtrlUpper);
         }
         else
@@ -4508,6 +4523,25 @@ static void drvvdStatsDeregister(PVBOXDISK pThis)
     PDMDrvHlpSTAMDeregister(pDrvIns, &pThis->StatReqsRead);
     PDMDrvHlpSTAMDeregister(pDrvIns, &pThis->StatReqsDiscard);
     PDMDrvHlpSTAMDeregister(pDrvIns, &pThis->StatReqsPerSec);
+    PDMDrvHlpSTAMDeregister(pDrvIns, &pThis->StatIoAuxAllocs);
+    PDMDrvHlpSTAMDeregister(pDrvIns, &pThis->StatIoAuxHeapAllocs);
+}
+
+/**
+ * Updates the I/O path allocation statistics from the disk container.
+ *
+ * @returns nothing.
+ * @param   pThis      The media driver instance.
+ */
+static void drvvdStatsUpdateIoAlloc(PVBOXDISK pThis)
+{
+    VDIOALLOCSTATS Stats;
+    int rc = VDQueryIoAllocStats(pThis->pDisk, &Stats);
+    if (RT_SUCCESS(rc))
+    {
+        pThis->StatIoAuxAllocs.c     = Stats.cAllocs;
+        pThis->StatIoAuxHeapAllocs.c = Stats.cHeapAllocs;
+    }
 }
 
 /*********************************************************************************************************************************
@@ -21,6 +21,7 @@
 *********************************************************************************************************************************/
 #define LOG_GROUP LOG_GROUP_DEV_VIRTIO
 
+#include <iprt/asm.h>
 #include <iprt/param.h>
 #include <iprt/uuid.h>
 #include <VBox/vmm/pdmdev.h>
@@ -33,6 +34,10 @@
 # define QUEUENAME(s, q) (q->pcszName)
 #endif
 
+/** The smallest number of used elements published in one go in the middle of
+ * a burst, see vqueueSync. */
+#define VQUEUE_USED_BATCH_MIN 4
+
 
 
 #ifndef VBOX_DEVICE_STRUCT_TESTCASE
@@ -49,6 +54,10 @@ static void vqueueReset(PVQUEUE pQueue)
     pQueue->uNextAvailIndex       = 0;
     pQueue->uNextUsedIndex        = 0;
     pQueue->uPageNumber           = 0;
+    pQueue->uPublishedUsedIndex   = 0;
+    pQueue->uSignalledUsedIndex   = 0;
+    pQueue->uKickedAvailIndex     = 0;
+    pQueue->cUsedBatch            = VQUEUE_USED_BATCH_MIN;
 }
 
 static void vqueueInit(PVQUEUE pQueue, uint32_t uPageNumber)
@@ -56,11 +65,17 @@ static void vqueueInit(PVQUEUE pQueue, uint32_t uPageNumber)
     pQueue->VRing.addrDescriptors = (uint64_t)uPageNumber << PAGE_SHIFT;
     pQueue->VRing.addrAvail       = pQueue->VRing.addrDescriptors
         + sizeof(VRINGDESC) * pQueue->VRing.uSize;
+    /* The used ring must start from the next page. The avail ring is followed
+       by the used_event index, see VPCI_F_RING_EVENT_IDX. */
     pQueue->VRing.addrUsed        = RT_ALIGN(
-        pQueue->VRing.addrAvail + RT_OFFSETOF(VRINGAVAIL, auRing[pQueue->VRing.uSize]),
-        PAGE_SIZE); /* The used ring must start from the next page. */
+        pQueue->VRing.addrAvail + RT_OFFSETOF(VRINGAVAIL, auRing[pQueue->VRing.uSize + 1]),
+        PAGE_SIZE);
     pQueue->uNextAvailIndex       = 0;
     pQueue->uNextUsedIndex        = 0;
+    pQueue->uPublishedUsedIndex   = 0;
+    pQueue->uSignalledUsedIndex   = 0;
+    pQueue->uKickedAvailIndex     = 0;
+    pQueue->cUsedBatch            = VQUEUE_USED_BATCH_MIN;
 }
 
 // void vqueueElemFree(PVQUEUEELEM pElem)
@@ -95,10 +110,65 @@ uint16_t vringReadAvailFlags(PVPCISTATE pState, PVRING pVRing)
     return tmp;
 }
 
-void vringSetNotification(PVPCISTATE pState, PVRING pVRing, bool fEnabled)
+/**
+ * Reads the used_event index the guest placed after the avail ring.
+ *
+ * Only meaningful when VPCI_F_RING_EVENT_IDX has been negotiated.
+ */
+static uint16_t vringReadUsedEvent(PVPCISTATE pState, PVRING pVRing)
 {
     uint16_t tmp;
 
+    PDMDevHlpPhysRead(pState->CTX_SUFF(pDevIns),
+                      pVRing->addrAvail + RT_OFFSETOF(VRINGAVAIL, auRing[pVRing->uSize]),
+                      &tmp, sizeof(tmp));
+    return tmp;
+}
+
+/**
+ * Writes the avail_event index after the used ring, telling the guest at
+ * which avail index it should notify us next.
+ *
+ * Only meaningful when VPCI_F_RING_EVENT_IDX has been negotiated.
+ */
+static void vringWriteAvailEvent(PVPCISTATE pState, PVRING pVRing, uint16_t u16Value)
+{
+    PDMDevHlpPCIPhysWrite(pState->CTX_SUFF(pDevIns),
+                          pVRing->addrUsed + RT_OFFSETOF(VRINGUSED, aRing[pVRing->uSize]),
+                          &u16Value, sizeof(u16Value));
+}
+
+/**
+ * Enables or disables guest notifications (kicks) for a queue.
+ *
+ * With VPCI_F_RING_EVENT_IDX the guest ignores VRINGUSED_F_NO_NOTIFY and
+ * looks at avail_event instead: enabling publishes the next avail index we are
+ * going to consume, while disabling simply leaves the stale value behind so
+ * the guest stops crossing it.  This saves a guest memory write per toggle in
+ * the disabled case.
+ *
+ * The caller must re-check the queue after enabling notifications, as the
+ * guest may have added buffers before it could see the update.
+ *
+ * @param   pState      The device state structure.
+ * @param   pQueue      The queue.
+ * @param   fEnabled    Whether to enable or suppress notifications.
+ */
+void vqueueSetNotification(PVPCISTATE pState, PVQUEUE pQueue, bool fEnabled)
+{
+    PVRING pVRing = &pQueue->VRing;
+    if (pState->uGuestFeatures & VPCI_F_RING_EVENT_IDX)
+    {
+        if (fEnabled)
+        {
+            vringWriteAvailEvent(pState, pVRing, pQueue->uNextAvailIndex);
+            ASMMemoryFence();
+        }
+        return;
+    }
+
+    uint16_t tmp;
+
     PDMDevHlpPhysRead(pState->CTX_SUFF(pDevIns),
                       pVRing->addrUsed + RT_OFFSETOF(VRINGUSED, uFlags),
                       &tmp, sizeof(tmp));
@@ -285,7 +355,24 @@ void vqueueNotify(PVPCISTATE pState, PVQUEUE pQueue)
              INSTANCE(pState), QUEUENAME(pState, pQueue),
              vringReadAvailFlags(pState, &pQueue->VRing),
              pState->uGuestFeatures, vqueueIsEmpty(pState, pQueue)?"":"not "));
-    if (!(vringReadAvailFlags(pState, &pQueue->VRing) & VRINGAVAIL_F_NO_INTERRUPT)
+    bool fWanted;
+    if (pState->uGuestFeatures & VPCI_F_RING_EVENT_IDX)
+    {
+        /*
+         * Interrupt only if used_event lies within the range of elements
+         * published since the last time we got here (vring_need_event).  The
+         * used index must be visible to the guest before we read used_event.
+         */
+        ASMMemoryFence();
+        uint16_t const uNew   = pQueue->uPublishedUsedIndex;
+        uint16_t const uOld   = pQueue->uSignalledUsedIndex;
+        uint16_t const uEvent = vringReadUsedEvent(pState, &pQueue->VRing);
+        fWanted = (uint16_t)(uNew - uEvent - 1) < (uint16_t)(uNew - uOld);
+    }
+    else
+        fWanted = !(vringReadAvailFlags(pState, &pQueue->VRing) & VRINGAVAIL_F_NO_INTERRUPT);
+    pQueue->uSignalledUsedIndex = pQueue->uPublishedUsedIndex;
+    if (   fWanted
         || ((pState->uGuestFeatures & VPCI_F_NOTIFY_ON_EMPTY) && vqueueIsEmpty(pState, pQueue)))
     {
         int rc = vpciRaiseInterrupt(pState, VERR_INTERNAL_ERROR, VPCI_ISR_QUEUE);
@@ -299,12 +386,54 @@ void vqueueNotify(PVPCISTATE pState, PVQUEUE pQueue)
 
 }
 
-void vqueueSync(PVPCISTATE pState, PVQUEUE pQueue)
+/**
+ * Publishes the used elements added by vqueuePut to the guest.
+ *
+ * Devices completing a burst of elements pass @a fFlush = false after each
+ * element and @a fFlush = true at the end of the burst.  In the middle of a
+ * burst the used index is only written once cUsedBatch elements have piled
+ * up, letting a polling guest start reclaiming buffers without paying a guest
+ * memory write per element, and no interrupt is raised.  The flush publishes
+ * whatever is left and raises at most one interrupt for the entire burst.
+ *
+ * The batch size adapts to the burst length seen at each flush, aiming at
+ * about four used index updates per burst within
+ * [VQUEUE_USED_BATCH_MIN, ring size / 4].
+ *
+ * @param   pState      The device state structure.
+ * @param   pQueue      The queue.
+ * @param   fFlush      Whether this is the end of a burst.
+ */
+void vqueueSync(PVPCISTATE pState, PVQUEUE pQueue, bool fFlush)
 {
-    Log2(("%s vqueueSync: %s old_used_idx=%u new_used_idx=%u\n", INSTANCE(pState),
-          QUEUENAME(pState, pQueue), vringReadUsedIndex(pState, &pQueue->VRing), pQueue->uNextUsedIndex));
-    vringWriteUsedIndex(pState, &pQueue->VRing, pQueue->uNextUsedIndex);
-    vqueueNotify(pState, pQueue);
+    uint16_t const cUnpublished = pQueue->uNextUsedIndex - pQueue->uPublishedUsedIndex;
+    if (!fFlush)
+    {
+        if (cUnpublished < pQueue->cUsedBatch)
+        {
+            STAM_COUNTER_INC(&pState->StatUsedBatched);
+            return;
+        }
+    }
+    else
+    {
+        /* Adjust the batch size to the length of the burst we've just completed. */
+        uint16_t const cBurst  = pQueue->uNextUsedIndex - pQueue->uSignalledUsedIndex;
+        uint16_t const cMax    = RT_MAX(pQueue->VRing.uSize / 4, VQUEUE_USED_BATCH_MIN);
+        uint16_t const cTarget = RT_MIN(RT_MAX(cBurst / 4, VQUEUE_USED_BATCH_MIN), cMax);
+        pQueue->cUsedBatch = (pQueue->cUsedBatch + cTarget) / 2;
+    }
+
+    Log2(("%s vqueueSync: %s old_used_idx=%u new_used_idx=%u%s\n", INSTANCE(pState),
+          QUEUENAME(pState, pQueue), pQueue->uPublishedUsedIndex, pQueue->uNextUsedIndex, fFlush ? " flush" : ""));
+    if (cUnpublished)
+    {
+        vringWriteUsedIndex(pState, &pQueue->VRing, pQueue->uNextUsedIndex);
+        pQueue->uPublishedUsedIndex = pQueue->uNextUsedIndex;
+        STAM_COUNTER_INC(&pState->StatUsedPublished);
+    }
+    if (fFlush)
+        vqueueNotify(pState, pQueue);
 }
 
 void vpciReset(PVPCISTATE pState)
@@ -312,7 +441,7 @@ void vpciReset(PVPCISTATE pState)
     pState->uGuestFeatures = 0;
     pState->uQueueSelector = 0;
     pState->uStatus        = 0;
-    pState->uISR           = 0;
+    ASMAtomicWriteU8(&pState->uISR, 0);
 
     for (unsigned i = 0; i < pState->nQueues; i++)
         vqueueReset(&pState->Queues[i]);
@@ -337,7 +466,23 @@ int vpciRaiseInterrupt(VPCISTATE *pState, int rcBusy, uint8_t u8IntCause)
     LogFlow(("%s vpciRaiseInterrupt: u8IntCause=%x\n",
              INSTANCE(pState), u8IntCause));
 
-    pState->uISR |= u8IntCause;
+    /* Several queues may be serviced by different threads concurrently. */
+    uint8_t uISR;
+    do
+        uISR = ASMAtomicUoReadU8(&pState->uISR);
+    while (!ASMAtomicCmpXchgU8(&pState->uISR, uISR | u8IntCause, uISR));
+
+    /*
+     * If the cause was already pending the line is still asserted and the
+     * guest hasn't read ISR yet, so it will see this event too.  Reading ISR
+     * lowers the line before clearing the bits, so skipping the call can't
+     * lose an interrupt.
+     */
+    if ((uISR & u8IntCause) == u8IntCause)
+    {
+        STAM_COUNTER_INC(&pState->StatIntsCoalesced);
+        return VINF_SUCCESS;
+    }
     PDMDevHlpPCISetIrq(pState->CTX_SUFF(pDevIns), 0, 1);
     // vpciCsLeave(pState);
     return VINF_SUCCESS;
@@ -358,7 +503,8 @@ DECLINLINE(uint32_t) vpciGetHostFeatures(PVPCISTATE pState,
                                          PFNGETHOSTFEATURES pfnGetHostFeatures)
 {
     return pfnGetHostFeatures(pState)
-        | VPCI_F_NOTIFY_ON_EMPTY;
+        | VPCI_F_NOTIFY_ON_EMPTY
+        | VPCI_F_RING_EVENT_IDX;
 }
 
 /**
@@ -436,9 +582,10 @@ int vpciIOPortIn(PPDMDEVINS         pDevIns,
 
         case VPCI_ISR:
             Assert(cb == 1);
-            *(uint8_t*)pu32 = pState->uISR;
-            pState->uISR = 0; /* read clears all interrupts */
+            /* Read clears all interrupts. Lower the line first, vpciRaiseInterrupt
+               skips asserting it again while the cause bit is still set. */
             vpciLowerInterrupt(pState);
+            *(uint8_t*)pu32 = ASMAtomicXchgU8(&pState->uISR, 0);
             break;
 
         default:
@@ -552,6 +699,12 @@ int vpciIOPortOut(PPDMDEVINS                pDevIns,
             if (u32 < pState->nQueues)
                 if (pState->Queues[u32].VRing.addrDescriptors)
                 {
+                    /* Account for what was consumed since the previous notification. */
+                    PVQUEUE pQueue = &pState->Queues[u32];
+                    uint16_t const uAvail = ASMAtomicUoReadU16(&pQueue->uNextAvailIndex);
+                    STAM_REL_PROFILE_ADD_PERIOD(&pState->StatElemsPerExit, (uint16_t)(uAvail - pQueue->uKickedAvailIndex));
+                    pQueue->uKickedAvailIndex = uAvail;
+
                     // rc = vpciCsEnter(pState, VERR_SEM_BUSY);
                     // if (RT_LIKELY(rc == VINF_SUCCESS))
                     // {
@@ -784,11 +937,14 @@ int vpciLoadExec(PVPCISTATE pState, PSSMHANDLE pSSM, uint32_t uVersion, uint32_t
         /* Restore queues */
         if (uVersion > VIRTIO_SAVEDSTATE_VERSION_3_1_BETA1)
         {
-            rc = SSMR3GetU32(pSSM, &pState->nQueues);
+            uint32_t nSavedQueues;
+            rc = SSMR3GetU32(pSSM, &nSavedQueues);
             AssertRCReturn(rc, rc);
+            if (nSavedQueues != nQueues)
+                return SSMR3SetCfgError(pSSM, RT_SRC_POS, N_("The number of queues differs: config=%u saved=%u"),
+                                        nQueues, nSavedQueues);
         }
-        else
-            pState->nQueues = nQueues;
+        pState->nQueues = nQueues;
         for (unsigned i = 0; i < pState->nQueues; i++)
         {
             rc = SSMR3GetU16(pSSM, &pState->Queues[i].VRing.uSize);
@@ -803,6 +959,10 @@ int vpciLoadExec(PVPCISTATE pState, PSSMHANDLE pSSM, uint32_t uVersion, uint32_t
             AssertRCReturn(rc, rc);
             rc = SSMR3GetU16(pSSM, &pState->Queues[i].uNextUsedIndex);
             AssertRCReturn(rc, rc);
+            /* Everything was flushed before saving. */
+            pState->Queues[i].uPublishedUsedIndex = pState->Queues[i].uNextUsedIndex;
+            pState->Queues[i].uSignalledUsedIndex = pState->Queues[i].uNextUsedIndex;
+            pState->Queues[i].uKickedAvailIndex   = pState->Queues[i].uNextAvailIndex;
         }
     }
 
@@ -921,7 +1081,11 @@ int vpciConstruct(PPDMDEVINS pDevIns, VPCISTATE *pState,
     PDMDevHlpSTAMRegisterF(pDevIns, &pState->StatIntsSkipped,        STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS, STAMUNIT_OCCURENCES,     "Number of skipped interrupts",   vpciCounter(pcszNameFmt, "Interrupts/Skipped"), iInstance);
     PDMDevHlpSTAMRegisterF(pDevIns, &pState->StatCsGC,               STAMTYPE_PROFILE, STAMVISIBILITY_ALWAYS, STAMUNIT_TICKS_PER_CALL, "Profiling CS wait in GC",      vpciCounter(pcszNameFmt, "Cs/CsGC"), iInstance);
     PDMDevHlpSTAMRegisterF(pDevIns, &pState->StatCsHC,               STAMTYPE_PROFILE, STAMVISIBILITY_ALWAYS, STAMUNIT_TICKS_PER_CALL, "Profiling CS wait in HC",      vpciCounter(pcszNameFmt, "Cs/CsHC"), iInstance);
+    PDMDevHlpSTAMRegisterF(pDevIns, &pState->StatIntsCoalesced,      STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS, STAMUNIT_OCCURENCES,     "Number of interrupts merged with a pending one", vpciCounter(pcszNameFmt, "Interrupts/Coalesced"), iInstance);
+    PDMDevHlpSTAMRegisterF(pDevIns, &pState->StatUsedPublished,      STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS, STAMUNIT_OCCURENCES,     "Number of used index updates", vpciCounter(pcszNameFmt, "Queues/UsedPublished"), iInstance);
+    PDMDevHlpSTAMRegisterF(pDevIns, &pState->StatUsedBatched,        STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS, STAMUNIT_OCCURENCES,     "Number of used index updates deferred by batching", vpciCounter(pcszNameFmt, "Queues/UsedBatched"), iInstance);
 #endif /* VBOX_WITH_STATISTICS */
+    PDMDevHlpSTAMRegisterF(pDevIns, &pState->StatElemsPerExit,       STAMTYPE_PROFILE, STAMVISIBILITY_ALWAYS, STAMUNIT_OCCURENCES,     "Descriptor chains (packets) consumed per queue notification exit", "/Devices/%s/Queues/PacketsPerExit", pState->szInstance);
 
     return rc;
 }
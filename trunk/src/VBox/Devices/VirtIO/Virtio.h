@@ -28,7 +28,8 @@
  * for example.
  */
 #define VIRTIO_SAVEDSTATE_VERSION_3_1_BETA1 1
-#define VIRTIO_SAVEDSTATE_VERSION           2
+#define VIRTIO_SAVEDSTATE_VERSION_PRE_MQ    2
+#define VIRTIO_SAVEDSTATE_VERSION           3
 /** @} */
 
 #define DEVICE_PCI_VENDOR_ID                0x1AF4
@@ -36,7 +37,8 @@
 #define DEVICE_PCI_SUBSYSTEM_VENDOR_ID      0x1AF4
 #define DEVICE_PCI_SUBSYSTEM_BASE_ID       1
 
-#define VIRTIO_MAX_NQUEUES                  3
+/** Enough for eight virtio-net RX/TX queue pairs plus the control queue. */
+#define VIRTIO_MAX_NQUEUES                  17
 
 #define VPCI_HOST_FEATURES                  0x0
 #define VPCI_GUEST_FEATURES                 0x4
@@ -129,6 +131,15 @@ typedef struct VQueue
     uint16_t uNextAvailIndex;
     uint16_t uNextUsedIndex;
     uint32_t uPageNumber;
+    /** The used index last written to the guest's used ring. */
+    uint16_t uPublishedUsedIndex;
+    /** The used index at the last interrupt decision (VPCI_F_RING_EVENT_IDX). */
+    uint16_t uSignalledUsedIndex;
+    /** uNextAvailIndex at the last guest notification, for the elements per exit statistics. */
+    uint16_t uKickedAvailIndex;
+    /** Number of used elements to accumulate before publishing them in the
+     * middle of a burst, adjusted at every flush (see vqueueSync). */
+    uint16_t cUsedBatch;
     R3PTRTYPE(PFNVPCIQUEUECALLBACK) pfnCallback;
     R3PTRTYPE(const char *)         pcszName;
 } VQUEUE;
@@ -220,7 +231,12 @@ typedef struct VPCIState_st
     STAMCOUNTER            StatIntsSkipped;
     STAMPROFILE            StatCsGC;
     STAMPROFILE            StatCsHC;
+    STAMCOUNTER            StatIntsCoalesced;
+    STAMCOUNTER            StatUsedPublished;
+    STAMCOUNTER            StatUsedBatched;
 #endif /* VBOX_WITH_STATISTICS */
+    /** Descriptor chains consumed per queue notification, i.e. packets per exit for virtio-net. */
+    STAMPROFILE            StatElemsPerExit;
 } VPCISTATE;
 /** Pointer to the core (/common) state of a VirtIO PCI device. */
 typedef VPCISTATE *PVPCISTATE;
@@ -291,7 +307,7 @@ DECLINLINE(void) vpciCsLeave(VPCISTATE *pState)
 #endif
 }
 
-void vringSetNotification(PVPCISTATE pState, PVRING pVRing, bool fEnabled);
+void vqueueSetNotification(PVPCISTATE pState, PVQUEUE pQueue, bool fEnabled);
 
 DECLINLINE(uint16_t) vringReadAvailIndex(PVPCISTATE pState, PVRING pVRing)
 {
@@ -307,7 +323,7 @@ bool vqueueSkip(PVPCISTATE pState, PVQUEUE pQueue);
 bool vqueueGet(PVPCISTATE pState, PVQUEUE pQueue, PVQUEUEELEM pElem, bool fRemove = true);
 void vqueuePut(PVPCISTATE pState, PVQUEUE pQueue, PVQUEUEELEM pElem, uint32_t uLen, uint32_t uReserved = 0);
 void vqueueNotify(PVPCISTATE pState, PVQUEUE pQueue);
-void vqueueSync(PVPCISTATE pState, PVQUEUE pQueue);
+void vqueueSync(PVPCISTATE pState, PVQUEUE pQueue, bool fFlush = true);
 
 DECLINLINE(bool) vqueuePeek(PVPCISTATE pState, PVQUEUE pQueue, PVQUEUEELEM pElem)
 {
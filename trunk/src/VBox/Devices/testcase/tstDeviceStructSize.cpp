@@ -300,6 +300,9 @@ int main()
 #endif
 #ifdef VBOX_WITH_VIRTIO
     CHECK_MEMBER_ALIGNMENT(VNETSTATE, StatReceiveBytes, 8);
+    CHECK_MEMBER_ALIGNMENT(VNETSTATE, aQueuePairs, 8);
+    CHECK_MEMBER_ALIGNMENT(VNETQUEUEPAIR, CritSectTx, 8);
+    CHECK_MEMBER_ALIGNMENT(VNETQUEUEPAIR, StatReceivePackets, 8);
 #endif
     //CHECK_MEMBER_ALIGNMENT(E1KSTATE, csTx, 8);
 #ifdef VBOX_WITH_USB
@@ -368,6 +371,7 @@ int main()
     CHECK_MEMBER_ALIGNMENT(VPCISTATE, cs, 8);
     CHECK_MEMBER_ALIGNMENT(VPCISTATE, led, 4);
     CHECK_MEMBER_ALIGNMENT(VPCISTATE, Queues, 8);
+    CHECK_MEMBER_ALIGNMENT(VPCISTATE, StatElemsPerExit, 8);
 #endif
 #ifdef VBOX_WITH_PCI_PASSTHROUGH_IMPL
     CHECK_MEMBER_ALIGNMENT(PCIRAWSENDREQ, u.aGetRegionInfo.u64RegionSize, 8);
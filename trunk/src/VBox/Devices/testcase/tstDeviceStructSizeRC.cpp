@@ -1426,6 +1426,8 @@ int main()
     GEN_CHECK_OFF(E1KSTATE, IOPortBase);
     GEN_CHECK_OFF(E1KSTATE, pciDevice);
     GEN_CHECK_OFF(E1KSTATE, u64AckedAt);
+    GEN_CHECK_OFF(E1KSTATE, u64LastIntAt);
+    GEN_CHECK_OFF(E1KSTATE, u64IntRateStart);
     GEN_CHECK_OFF(E1KSTATE, fIntRaised);
     GEN_CHECK_OFF(E1KSTATE, fCableConnected);
     GEN_CHECK_OFF(E1KSTATE, fR0Enabled);
@@ -1467,6 +1469,8 @@ int main()
     GEN_CHECK_OFF(E1KSTATE, eeprom);
     GEN_CHECK_OFF(E1KSTATE, phy);
     GEN_CHECK_OFF(E1KSTATE, StatReceiveBytes);
+    GEN_CHECK_OFF(E1KSTATE, StatIntsPerSec);
+    GEN_CHECK_OFF(E1KSTATE, StatRxDescPerFetch);
 #endif /* VBOX_WITH_E1000 */
 
 #ifdef VBOX_WITH_VIRTIO
@@ -1487,6 +1491,7 @@ int main()
     GEN_CHECK_OFF(VPCISTATE, uISR);
     GEN_CHECK_OFF(VPCISTATE, Queues);
     GEN_CHECK_OFF(VPCISTATE, Queues[VIRTIO_MAX_NQUEUES]);
+    GEN_CHECK_OFF(VPCISTATE, StatElemsPerExit);
     GEN_CHECK_OFF(VNETSTATE, VPCI);
     GEN_CHECK_OFF(VNETSTATE, INetworkDown);
     GEN_CHECK_OFF(VNETSTATE, INetworkConfig);
@@ -1506,11 +1511,23 @@ int main()
     GEN_CHECK_OFF(VNETSTATE, u32PktNo);
     GEN_CHECK_OFF(VNETSTATE, fPromiscuous);
     GEN_CHECK_OFF(VNETSTATE, fAllMulti);
-    GEN_CHECK_OFF(VNETSTATE, pRxQueue);
-    GEN_CHECK_OFF(VNETSTATE, pTxQueue);
     GEN_CHECK_OFF(VNETSTATE, pCtlQueue);
+    GEN_CHECK_OFF(VNETSTATE, cQueuePairs);
+    GEN_CHECK_OFF(VNETSTATE, cActivePairs);
+    GEN_CHECK_OFF(VNETSTATE, abRssKey);
+    GEN_CHECK_OFF(VNETSTATE, abRssIndirection);
     GEN_CHECK_OFF(VNETSTATE, fMaybeOutOfSpace);
     GEN_CHECK_OFF(VNETSTATE, hEventMoreRxDescAvail);
+    GEN_CHECK_OFF(VNETSTATE, aQueuePairs);
+    GEN_CHECK_OFF(VNETSTATE, aQueuePairs[VNET_MAX_QUEUE_PAIRS - 1]);
+    GEN_CHECK_SIZE(VNETQUEUEPAIR);
+    GEN_CHECK_OFF(VNETQUEUEPAIR, CritSectRx);
+    GEN_CHECK_OFF(VNETQUEUEPAIR, CritSectTx);
+    GEN_CHECK_OFF(VNETQUEUEPAIR, pRxQueue);
+    GEN_CHECK_OFF(VNETQUEUEPAIR, pTxQueue);
+    GEN_CHECK_OFF(VNETQUEUEPAIR, hEvtTx);
+    GEN_CHECK_OFF(VNETQUEUEPAIR, uIsTransmitting);
+    GEN_CHECK_OFF(VNETQUEUEPAIR, StatReceivePackets);
 #endif /* VBOX_WITH_VIRTIO */
 
 #ifdef VBOX_WITH_SCSI
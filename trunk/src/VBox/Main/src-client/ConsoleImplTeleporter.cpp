@@ -67,6 +67,8 @@ public:
     bool volatile       mfStopReading;
     bool volatile       mfEndOfStream;
     bool volatile       mfIOError;
+    /** The striped data connections, NULL if the stream goes over mhSocket. */
+    PSSMTCPSTRIPE       mpStripe;
     /** @} */
 
     TeleporterState(Console *pConsole, PUVM pUVM, Progress *pProgress, bool fIsSource)
@@ -80,12 +82,15 @@ public:
         , mfStopReading(false)
         , mfEndOfStream(false)
         , mfIOError(false)
+        , mpStripe(NULL)
     {
         VMR3RetainUVM(mpUVM);
     }
 
     ~TeleporterState()
     {
+        SSMR3TcpStripeDestroy(mpStripe);
+        mpStripe = NULL;
         VMR3ReleaseUVM(mpUVM);
         mpUVM = NULL;
     }
@@ -101,6 +106,9 @@ public:
     Utf8Str             mstrHostname;
     uint32_t            muPort;
     uint32_t            mcMsMaxDowntime;
+    /** The number of data connections to stripe the stream over, 1 for the
+     * classic single connection stream. */
+    uint32_t            mcStreams;
     MachineState_T      menmOldMachineState;
     bool                mfSuspendedByUs;
     bool                mfUnlockedMedia;
@@ -109,6 +117,7 @@ public:
         : TeleporterState(pConsole, pUVM, pProgress, true /*fIsSource*/)
         , muPort(UINT32_MAX)
         , mcMsMaxDowntime(250)
+        , mcStreams(1)
         , menmOldMachineState(enmOldMachineState)
         , mfSuspendedByUs(false)
         , mfUnlockedMedia(false)
@@ -126,6 +135,8 @@ public:
     IMachine                   *mpMachine;
     IInternalMachineControl    *mpControl;
     PRTTCPSERVER                mhServer;
+    /** The address the server listens on, empty for any. */
+    Utf8Str                     mstrAddress;
     PRTTIMERLR                  mphTimerLR;
     bool                        mfLockedMedia;
     int                         mRc;
@@ -677,6 +688,25 @@ HRESULT Console::i_teleporterSrc(TeleporterStateSrc *pState)
     if (FAILED(hrc))
         return hrc;
 
+    /*
+     * Set up the striped data connections if requested.  The control
+     * connection is kept for the command/ACK traffic.
+     */
+    if (pState->mcStreams > 1)
+    {
+        char szCmd[32];
+        RTStrPrintf(szCmd, sizeof(szCmd), "streams=%u", pState->mcStreams);
+        hrc = i_teleporterSrcSubmitCommand(pState, szCmd);
+        if (FAILED(hrc))
+            return hrc;
+        vrc = SSMR3TcpStripeConnect(pState->mhSocket, pState->mstrHostname.c_str(), pState->mcStreams,
+                                    true /*fWrite*/, &pState->mpStripe);
+        if (RT_FAILURE(vrc))
+            return setError(E_FAIL, tr("Failed to establish %u data connections to '%s': %Rrc"),
+                            pState->mcStreams, pState->mstrHostname.c_str(), vrc);
+        LogRel(("Teleporter: Striping the stream over %u connections.\n", pState->mcStreams));
+    }
+
     /*
      * Start loading the state.
      *
@@ -692,7 +722,8 @@ HRESULT Console::i_teleporterSrc(TeleporterStateSrc *pState)
     void *pvUser = static_cast<void *>(static_cast<TeleporterState *>(pState));
     vrc = VMR3Teleport(pState->mpUVM,
                        pState->mcMsMaxDowntime,
-                       &g_teleporterTcpOps,         pvUser,
+                       pState->mpStripe ? SSMR3TcpStripeGetOps() : &g_teleporterTcpOps,
+                       pState->mpStripe ? (void *)pState->mpStripe : pvUser,
                        teleporterProgressCallback,  pvUser,
                        &pState->mfSuspendedByUs);
     RTSocketRelease(pState->mhSocket);
@@ -779,6 +810,8 @@ Console::i_teleporterSrcThreadWrapper(RTTHREAD hThreadSelf, void *pvUser)
         hrc = pState->mptrConsole->i_teleporterSrc(pState);
 
     /* Close the connection ASAP on so that the other side can complete. */
+    SSMR3TcpStripeDestroy(pState->mpStripe);
+    pState->mpStripe = NULL;
     if (pState->mhSocket != NIL_RTSOCKET)
     {
         RTTcpClientClose(pState->mhSocket);
@@ -992,6 +1025,19 @@ HRESULT Console::teleport(const com::Utf8Str &aHostname, ULONG aTcpport, const c
     pState->muPort          = aTcpport;
     pState->mcMsMaxDowntime = aMaxDowntime;
 
+    /* Striping the stream over several connections is opt-in as older targets
+       don't understand the 'streams' command. */
+    Bstr bstrStreams;
+    hrc = mMachine->GetExtraData(Bstr("VBoxInternal2/TeleporterStreams").raw(), bstrStreams.asOutParam());
+    if (SUCCEEDED(hrc) && !bstrStreams.isEmpty())
+    {
+        uint32_t cStreams = Utf8Str(bstrStreams).toUInt32();
+        if (cStreams >= 1 && cStreams <= SSM_TCP_STRIPE_MAX_CONNS)
+            pState->mcStreams = cStreams;
+        else
+            LogRel(("Teleporter: Ignoring invalid TeleporterStreams value '%ls'\n", bstrStreams.raw()));
+    }
+
     void *pvUser = static_cast<void *>(static_cast<TeleporterState *>(pState));
     ptrProgress->i_setCancelCallback(teleporterProgressCancelCallback, pvUser);
 
@@ -1114,6 +1160,7 @@ HRESULT Console::i_teleporterTrg(PUVM pUVM, IMachine *pMachine, Utf8Str *pErrorM
             TeleporterStateTrg theState(this, pUVM, pProgress, pMachine, mControl, &hTimerLR, fStartPaused);
             theState.mstrPassword      = strPassword;
             theState.mhServer          = hServer;
+            theState.mstrAddress       = strAddress;
 
             void *pvUser = static_cast<void *>(static_cast<TeleporterState *>(&theState));
             if (pProgress->i_setCancelCallback(teleporterProgressCancelCallback, pvUser))
@@ -1338,7 +1385,32 @@ Console::i_teleporterTrgServeConnection(RTSOCKET hSocket, void *pvUser)
         if (RT_FAILURE(vrc))
             break;
 
-        if (!strcmp(szCmd, "load"))
+        if (!strncmp(szCmd, RT_STR_TUPLE("streams=")))
+        {
+            uint32_t cStreams;
+            vrc = RTStrToUInt32Full(&szCmd[sizeof("streams=") - 1], 10, &cStreams);
+            if (   vrc != VINF_SUCCESS
+                || cStreams < 1
+                || cStreams > SSM_TCP_STRIPE_MAX_CONNS
+                || pState->mpStripe)
+            {
+                LogRel(("Teleporter: Bad stream count '%s' (%Rrc)\n", szCmd, vrc));
+                vrc = VERR_INVALID_PARAMETER;
+                teleporterTcpWriteNACK(pState, vrc);
+                break;
+            }
+            vrc = teleporterTcpWriteACK(pState);
+            if (RT_FAILURE(vrc))
+                break;
+
+            vrc = SSMR3TcpStripeListen(pState->mhSocket,
+                                       pState->mstrAddress.isEmpty() ? NULL : pState->mstrAddress.c_str(),
+                                       cStreams, false /*fWrite*/, &pState->mpStripe);
+            if (RT_FAILURE(vrc))
+                break;
+            LogRel(("Teleporter: Receiving the stream over %u connections.\n", cStreams));
+        }
+        else if (!strcmp(szCmd, "load"))
         {
             vrc = teleporterTcpWriteACK(pState);
             if (RT_FAILURE(vrc))
@@ -1350,8 +1422,10 @@ Console::i_teleporterTrgServeConnection(RTSOCKET hSocket, void *pvUser)
             pState->moffStream = 0;
 
             void *pvUser2 = static_cast<void *>(static_cast<TeleporterState *>(pState));
+            PCSSMSTRMOPS pStreamOps      = pState->mpStripe ? SSMR3TcpStripeGetOps() : &g_teleporterTcpOps;
+            void        *pvStreamOpsUser = pState->mpStripe ? (void *)pState->mpStripe : pvUser2;
             vrc = VMR3LoadFromStream(pState->mpUVM,
-                                     &g_teleporterTcpOps, pvUser2,
+                                     pStreamOps, pvStreamOpsUser,
                                      teleporterProgressCallback, pvUser2);
 
             RTSocketRelease(pState->mhSocket);
@@ -1368,7 +1442,7 @@ Console::i_teleporterTrgServeConnection(RTSOCKET hSocket, void *pvUser)
             /* The EOS might not have been read, make sure it is. */
             pState->mfStopReading = false;
             size_t cbRead;
-            vrc = teleporterTcpOpRead(pvUser2, pState->moffStream, szCmd, 1, &cbRead);
+            vrc = pStreamOps->pfnRead(pvStreamOpsUser, pState->moffStream, szCmd, 1, &cbRead);
             if (vrc != VERR_EOF)
             {
                 LogRel(("Teleporter: Draining teleporterTcpOpRead -> %Rrc\n", vrc));
@@ -1448,6 +1522,8 @@ Console::i_teleporterTrgServeConnection(RTSOCKET hSocket, void *pvUser)
     if (RT_FAILURE(vrc))
         teleporterTrgUnlockMedia(pState);
 
+    SSMR3TcpStripeDestroy(pState->mpStripe);
+    pState->mpStripe = NULL;
     pState->mRc = vrc;
     pState->mhSocket = NIL_RTSOCKET;
     LogFlowFunc(("returns mRc=%Rrc\n", vrc));
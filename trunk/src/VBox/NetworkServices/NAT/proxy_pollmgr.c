@@ -17,6 +17,16 @@
 
 #define LOG_GROUP LOG_GROUP_NAT_SERVICE
 
+/*
+ * On Linux we use epoll(7) instead of poll(2), so that the cost of a
+ * wakeup is proportional to the number of ready sockets, not to the
+ * number of sockets we watch.  Define POLLMGR_NO_EPOLL to use poll(2)
+ * there as well.
+ */
+#if defined(RT_OS_LINUX) && !defined(POLLMGR_NO_EPOLL)
+# define POLLMGR_EPOLL 1
+#endif
+
 #include "winutils.h"
 
 #include "proxy_pollmgr.h"
@@ -28,6 +38,10 @@
 #include <err.h>
 #include <errno.h>
 #include <poll.h>
+#ifdef POLLMGR_EPOLL
+#include <sys/epoll.h>
+#include <fcntl.h>
+#endif
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -42,11 +56,39 @@
 
 #define POLLMGR_GARBAGE (-1)
 
+#ifdef POLLMGR_EPOLL
+/* max number of events we fetch with one epoll_wait() */
+#define POLLMGR_EPOLL_NEVENTS 256
+
+/*
+ * Registered sockets.  The slot number and its generation are stored
+ * in the epoll event data, so that events for a slot that has been
+ * deleted (and maybe reused) by an earlier callback in the same batch
+ * can be recognized and ignored.
+ */
+struct pollmgr_slot {
+    SOCKET fd;                  /* INVALID_SOCKET if not in use */
+    int events;                 /* poll(2) events we are interested in */
+    u32_t gen;                  /* incremented when the slot is freed */
+    int nextfree;               /* free list link */
+    struct pollmgr_handler *handler;
+};
+#endif
+
 struct pollmgr {
+#ifdef POLLMGR_EPOLL
+    int epfd;
+    struct pollmgr_slot *slots;
+    int capacity;               /* allocated size of the slots array */
+    int nslots;                 /* part of the array ever used */
+    int freelist;               /* first free dynamic slot or -1 */
+    struct epoll_event events[POLLMGR_EPOLL_NEVENTS];
+#else
     struct pollfd *fds;
     struct pollmgr_handler **handlers;
     nfds_t capacity;            /* allocated size of the arrays */
     nfds_t nfds;                /* part of the arrays in use */
+#endif
 
     /* channels (socketpair) for static slots */
     SOCKET chan[POLLMGR_SLOT_STATIC_COUNT][2];
@@ -57,8 +99,12 @@ struct pollmgr {
 
 static void pollmgr_loop(void);
 
-static void pollmgr_add_at(int, struct pollmgr_handler *, SOCKET, int);
+static int pollmgr_add_at(int, struct pollmgr_handler *, SOCKET, int);
 static void pollmgr_refptr_delete(struct pollmgr_refptr *);
+#ifdef POLLMGR_EPOLL
+static int pollmgr_epoll_init(void);
+static void pollmgr_epoll_free(int);
+#endif
 
 
 /*
@@ -78,16 +124,26 @@ u8_t pollmgr_udpbuf[64 * 1024];
 int
 pollmgr_init(void)
 {
+#ifndef POLLMGR_EPOLL
     struct pollfd *newfds;
     struct pollmgr_handler **newhdls;
     nfds_t newcap;
+#endif
     int status;
     nfds_t i;
 
+#ifdef POLLMGR_EPOLL
+    pollmgr.epfd = -1;
+    pollmgr.slots = NULL;
+    pollmgr.capacity = 0;
+    pollmgr.nslots = 0;
+    pollmgr.freelist = -1;
+#else
     pollmgr.fds = NULL;
     pollmgr.handlers = NULL;
     pollmgr.capacity = 0;
     pollmgr.nfds = 0;
+#endif
 
     for (i = 0; i < POLLMGR_SLOT_STATIC_COUNT; ++i) {
         pollmgr.chan[i][POLLMGR_CHFD_RD] = INVALID_SOCKET;
@@ -109,7 +165,12 @@ pollmgr_init(void)
 #endif
     }
 
-
+#ifdef POLLMGR_EPOLL
+    if (pollmgr_epoll_init() < 0) {
+        goto cleanup_close;
+    }
+    return 0;
+#else
     newcap = 16;                /* XXX: magic */
     LWIP_ASSERT1(newcap >= POLLMGR_SLOT_STATIC_COUNT);
 
@@ -141,6 +202,7 @@ pollmgr_init(void)
     }
 
     return 0;
+#endif
 
   cleanup_close:
     for (i = 0; i < POLLMGR_SLOT_STATIC_COUNT; ++i) {
@@ -166,11 +228,216 @@ pollmgr_add_chan(int slot, struct pollmgr_handler *handler)
         return INVALID_SOCKET;
     }
 
-    pollmgr_add_at(slot, handler, pollmgr.chan[slot][POLLMGR_CHFD_RD], POLLIN);
+    if (pollmgr_add_at(slot, handler, pollmgr.chan[slot][POLLMGR_CHFD_RD], POLLIN) < 0) {
+        return INVALID_SOCKET;
+    }
     return pollmgr.chan[slot][POLLMGR_CHFD_WR];
 }
 
 
+#ifdef POLLMGR_EPOLL
+
+/*
+ * Translate poll(2) events to epoll(7) events and back.  They happen
+ * to have the same values on Linux, but don't rely on that.
+ */
+static u32_t
+pollmgr_epoll_events(int events)
+{
+    u32_t epevents = 0;
+
+    if (events & POLLIN)
+        epevents |= EPOLLIN;
+    if (events & POLLPRI)
+        epevents |= EPOLLPRI;
+    if (events & POLLOUT)
+        epevents |= EPOLLOUT;
+
+    return epevents;
+}
+
+
+static int
+pollmgr_poll_revents(u32_t epevents)
+{
+    int revents = 0;
+
+    if (epevents & EPOLLIN)
+        revents |= POLLIN;
+    if (epevents & EPOLLPRI)
+        revents |= POLLPRI;
+    if (epevents & EPOLLOUT)
+        revents |= POLLOUT;
+    if (epevents & EPOLLERR)
+        revents |= POLLERR;
+    if (epevents & EPOLLHUP)
+        revents |= POLLHUP;
+
+    return revents;
+}
+
+
+static int
+pollmgr_epoll_ctl(int op, int slot)
+{
+    struct epoll_event ev;
+    int status;
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events = pollmgr_epoll_events(pollmgr.slots[slot].events);
+    ev.data.u64 = ((uint64_t)pollmgr.slots[slot].gen << 32) | (u32_t)slot;
+
+    status = epoll_ctl(pollmgr.epfd, op, pollmgr.slots[slot].fd, &ev);
+    if (status < 0) {
+        DPRINTF(("%s: epoll_ctl(%d, fd %d): %R[sockerr]\n",
+                 __func__, op, pollmgr.slots[slot].fd, SOCKERRNO()));
+    }
+    return status;
+}
+
+
+static int
+pollmgr_epoll_init(void)
+{
+    int i;
+
+    /* epoll_create1() is too new for some of the hosts we support */
+    pollmgr.epfd = epoll_create(POLLMGR_EPOLL_NEVENTS);
+    if (pollmgr.epfd < 0) {
+        DPRINTF(("epoll_create: %R[sockerr]\n", SOCKERRNO()));
+        return -1;
+    }
+    fcntl(pollmgr.epfd, F_SETFD, FD_CLOEXEC);
+
+    pollmgr.capacity = 16;      /* XXX: magic */
+    LWIP_ASSERT1(pollmgr.capacity >= POLLMGR_SLOT_STATIC_COUNT);
+
+    pollmgr.slots = (struct pollmgr_slot *)
+        malloc(pollmgr.capacity * sizeof(*pollmgr.slots));
+    if (pollmgr.slots == NULL) {
+        DPRINTF(("%s: Failed to allocate slots array\n", __func__));
+        close(pollmgr.epfd);
+        pollmgr.epfd = -1;
+        return -1;
+    }
+
+    for (i = 0; i < pollmgr.capacity; ++i) {
+        pollmgr.slots[i].fd = INVALID_SOCKET;
+        pollmgr.slots[i].events = 0;
+        pollmgr.slots[i].gen = 0;
+        pollmgr.slots[i].nextfree = -1;
+        pollmgr.slots[i].handler = NULL;
+    }
+
+    /* static slots are never on the free list */
+    pollmgr.nslots = POLLMGR_SLOT_STATIC_COUNT;
+    return 0;
+}
+
+
+/*
+ * Must be called from pollmgr loop (via callbacks), so no locking.
+ */
+int
+pollmgr_add(struct pollmgr_handler *handler, SOCKET fd, int events)
+{
+    int slot;
+
+    DPRINTF2(("%s: new fd %d\n", __func__, fd));
+
+    if (pollmgr.freelist >= 0) {
+        slot = pollmgr.freelist;
+        pollmgr.freelist = pollmgr.slots[slot].nextfree;
+    }
+    else {
+        if (pollmgr.nslots == pollmgr.capacity) {
+            struct pollmgr_slot *newslots;
+            int newcap;
+            int i;
+
+            newcap = pollmgr.capacity * 2;
+            newslots = (struct pollmgr_slot *)
+                realloc(pollmgr.slots, newcap * sizeof(*pollmgr.slots));
+            if (newslots == NULL) {
+                DPRINTF(("%s: Failed to reallocate slots array\n", __func__));
+                handler->slot = -1;
+                return -1;
+            }
+
+            for (i = pollmgr.capacity; i < newcap; ++i) {
+                newslots[i].fd = INVALID_SOCKET;
+                newslots[i].events = 0;
+                newslots[i].gen = 0;
+                newslots[i].nextfree = -1;
+                newslots[i].handler = NULL;
+            }
+
+            pollmgr.slots = newslots;
+            pollmgr.capacity = newcap;
+        }
+
+        slot = pollmgr.nslots;
+        ++pollmgr.nslots;
+    }
+
+    if (pollmgr_add_at(slot, handler, fd, events) < 0) {
+        pollmgr.slots[slot].nextfree = pollmgr.freelist;
+        pollmgr.freelist = slot;
+        return -1;
+    }
+    return slot;
+}
+
+
+static int
+pollmgr_add_at(int slot, struct pollmgr_handler *handler, SOCKET fd, int events)
+{
+    pollmgr.slots[slot].fd = fd;
+    pollmgr.slots[slot].events = events;
+    pollmgr.slots[slot].handler = handler;
+
+    if (pollmgr_epoll_ctl(EPOLL_CTL_ADD, slot) < 0) {
+        pollmgr.slots[slot].fd = INVALID_SOCKET;
+        pollmgr.slots[slot].events = 0;
+        pollmgr.slots[slot].handler = NULL;
+        handler->slot = -1;
+        return -1;
+    }
+
+    handler->slot = slot;
+    return 0;
+}
+
+
+/*
+ * Forget the socket in the slot and put a dynamic slot on the free
+ * list.  Bumping the generation makes any events for it that are
+ * still in the current batch stale.
+ */
+static void
+pollmgr_epoll_free(int slot)
+{
+    struct pollmgr_slot *ps = &pollmgr.slots[slot];
+
+    if (ps->fd != INVALID_SOCKET) {
+        /* the fd may be already closed, so ignore errors */
+        epoll_ctl(pollmgr.epfd, EPOLL_CTL_DEL, ps->fd, NULL);
+    }
+
+    ps->fd = INVALID_SOCKET;
+    ps->events = 0;
+    ps->handler = NULL;
+    ++ps->gen;
+
+    if (slot >= POLLMGR_SLOT_FIRST_DYNAMIC) {
+        ps->nextfree = pollmgr.freelist;
+        pollmgr.freelist = slot;
+    }
+}
+
+#else /* !POLLMGR_EPOLL */
+
+
 /*
  * Must be called from pollmgr loop (via callbacks), so no locking.
  */
@@ -229,7 +496,7 @@ pollmgr_add(struct pollmgr_handler *handler, SOCKET fd, int events)
 }
 
 
-static void
+static int
 pollmgr_add_at(int slot, struct pollmgr_handler *handler, SOCKET fd, int events)
 {
     pollmgr.fds[slot].fd = fd;
@@ -238,8 +505,11 @@ pollmgr_add_at(int slot, struct pollmgr_handler *handler, SOCKET fd, int events)
     pollmgr.handlers[slot] = handler;
 
     handler->slot = slot;
+    return 0;
 }
 
+#endif /* !POLLMGR_EPOLL */
+
 
 ssize_t
 pollmgr_chan_send(int slot, void *buf, size_t nbytes)
@@ -304,6 +574,36 @@ pollmgr_chan_recv_ptr(struct pollmgr_handler *handler, SOCKET fd, int revents)
 }
 
 
+#ifdef POLLMGR_EPOLL
+
+void
+pollmgr_update_events(int slot, int events)
+{
+    LWIP_ASSERT1(slot >= POLLMGR_SLOT_FIRST_DYNAMIC);
+    LWIP_ASSERT1(slot < pollmgr.nslots);
+    LWIP_ASSERT1(pollmgr.slots[slot].fd != INVALID_SOCKET);
+
+    if (pollmgr.slots[slot].events != events) {
+        pollmgr.slots[slot].events = events;
+        pollmgr_epoll_ctl(EPOLL_CTL_MOD, slot);
+    }
+}
+
+
+void
+pollmgr_del_slot(int slot)
+{
+    LWIP_ASSERT1(slot >= POLLMGR_SLOT_FIRST_DYNAMIC);
+    LWIP_ASSERT1(slot < pollmgr.nslots);
+
+    DPRINTF2(("%s(%d): fd %d ! DELETED\n",
+              __func__, slot, pollmgr.slots[slot].fd));
+
+    pollmgr_epoll_free(slot);
+}
+
+#else /* !POLLMGR_EPOLL */
+
 void
 pollmgr_update_events(int slot, int events)
 {
@@ -325,6 +625,8 @@ pollmgr_del_slot(int slot)
     pollmgr.fds[slot].fd = INVALID_SOCKET; /* see poll loop */
 }
 
+#endif /* !POLLMGR_EPOLL */
+
 
 void
 pollmgr_thread(void *ignored)
@@ -334,6 +636,109 @@ pollmgr_thread(void *ignored)
 }
 
 
+#ifdef POLLMGR_EPOLL
+
+/*
+ * We use level-triggered notifications: callbacks are written for
+ * poll(2) and are free to leave data in the socket (e.g. when the
+ * ring buffer is full) expecting to be called again.  Each wakeup
+ * only visits the sockets that are ready.
+ */
+static void
+pollmgr_loop(void)
+{
+    int nready;
+    int i;
+
+    for (;;) {
+        nready = epoll_wait(pollmgr.epfd, pollmgr.events,
+                            POLLMGR_EPOLL_NEVENTS, -1);
+
+        DPRINTF2(("%s: ready %d fd%s\n",
+                  __func__, nready, (nready == 1 ? "" : "s")));
+
+        if (nready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            err(EXIT_FAILURE, "epoll_wait"); /* XXX: what to do on error? */
+            /* NOTREACHED*/
+        }
+
+        for (i = 0; i < nready; ++i) {
+            const uint64_t data = pollmgr.events[i].data.u64;
+            const int slot = (int)(u32_t)data;
+            const u32_t gen = (u32_t)(data >> 32);
+            struct pollmgr_handler *handler;
+            SOCKET fd;
+            int revents, nevents;
+
+            LWIP_ASSERT1(slot < pollmgr.nslots);
+
+            /*
+             * The slot could have been deleted (and even reused) by
+             * an earlier callback in this batch.
+             */
+            if (pollmgr.slots[slot].gen != gen
+                || pollmgr.slots[slot].fd == INVALID_SOCKET)
+            {
+                continue;
+            }
+
+            fd = pollmgr.slots[slot].fd;
+            handler = pollmgr.slots[slot].handler;
+
+            /* interest could have been changed by an earlier callback too */
+            revents = pollmgr_poll_revents(pollmgr.events[i].events)
+                & (pollmgr.slots[slot].events | POLLERR | POLLHUP);
+            if (revents == 0) {
+                continue;
+            }
+
+            if (handler != NULL && handler->callback != NULL) {
+                DPRINTF2(("%s: %s %d @ revents 0x%x\n", __func__,
+                          slot < POLLMGR_SLOT_FIRST_DYNAMIC ? "ch" : "fd",
+                          slot < POLLMGR_SLOT_FIRST_DYNAMIC ? slot : fd,
+                          revents));
+                nevents = (*handler->callback)(handler, fd, revents);
+            }
+            else {
+                DPRINTF0(("%s: invalid handler for fd %d: %p\n",
+                          __func__, fd, (void *)handler));
+                nevents = -1;   /* delete it */
+            }
+
+            /*
+             * Callback may have added sockets (so don't keep pointers
+             * into the slots array) or deleted its own slot.
+             */
+            if (pollmgr.slots[slot].gen != gen
+                || pollmgr.slots[slot].fd == INVALID_SOCKET)
+            {
+                continue;
+            }
+
+            if (nevents >= 0) {
+                if (nevents != pollmgr.slots[slot].events) {
+                    DPRINTF2(("%s: fd %d ! nevents 0x%x\n",
+                              __func__, fd, nevents));
+                    pollmgr.slots[slot].events = nevents;
+                    pollmgr_epoll_ctl(EPOLL_CTL_MOD, slot);
+                }
+            }
+            else {
+                DPRINTF2(("%s: fd %d ! DELETED%s\n", __func__, fd,
+                          slot < POLLMGR_SLOT_FIRST_DYNAMIC ? " (channel)" : ""));
+                /* channels are not put on the free list */
+                pollmgr_epoll_free(slot);
+            }
+        }
+    } /* epoll loop */
+}
+
+#else /* !POLLMGR_EPOLL */
+
 static void
 pollmgr_loop(void)
 {
@@ -520,6 +925,8 @@ pollmgr_loop(void)
     } /* poll loop */
 }
 
+#endif /* !POLLMGR_EPOLL */
+
 
 /**
  * Create strongly held refptr.
@@ -0,0 +1,346 @@
+/* $Id$ */
+/** @file
+ * NAT Network - poll manager connection scaling benchmark.
+ *
+ * Runs an echo server on the poll manager thread and measures the round
+ * trip rate of a fixed number of active connections while the number of
+ * idle connections the poll manager has to watch grows.
+ */
+
+/*
+ * Copyright (C) 2016 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ */
+
+#define LOG_GROUP LOG_GROUP_NAT_SERVICE
+
+#include "winutils.h"
+#include "proxy_pollmgr.h"
+#include "proxy.h"
+
+#include <iprt/getopt.h>
+#include <iprt/initterm.h>
+#include <iprt/mem.h>
+#include <iprt/string.h>
+#include <iprt/test.h>
+#include <iprt/thread.h>
+#include <iprt/time.h>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+
+
+/** Size of the messages bounced off the echo server. */
+#define TST_MSG_SIZE    64
+
+static RTTEST g_hTest;
+static struct pollmgr_handler g_ListenHdl;
+
+
+/**
+ * Echo callback for an accepted connection, runs on the poll manager
+ * thread.
+ */
+static int
+tstEchoPump(struct pollmgr_handler *handler, SOCKET fd, int revents)
+{
+    char buf[4 * TST_MSG_SIZE];
+    ssize_t nread, nsent, off;
+
+    if (revents & (POLLERR | POLLHUP | POLLNVAL)) {
+        goto drop;
+    }
+
+    nread = recv(fd, buf, sizeof(buf), 0);
+    if (nread <= 0) {
+        goto drop;
+    }
+
+    for (off = 0; off < nread; off += nsent) {
+        nsent = send(fd, buf + off, nread - off, 0);
+        if (nsent <= 0) {
+            goto drop;
+        }
+    }
+    return POLLIN;
+
+  drop:
+    closesocket(fd);
+    RTMemFree(handler);
+    return -1;
+}
+
+
+/**
+ * Accepts a new connection and registers it with the poll manager.
+ */
+static int
+tstListen(struct pollmgr_handler *handler, SOCKET fd, int revents)
+{
+    struct pollmgr_handler *echo;
+    SOCKET s;
+    int on = 1;
+    RT_NOREF2(handler, revents);
+
+    s = accept(fd, NULL, NULL);
+    if (s == INVALID_SOCKET) {
+        return POLLIN;
+    }
+    setsockopt(s, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+    echo = (struct pollmgr_handler *)RTMemAllocZ(sizeof(*echo));
+    if (echo == NULL) {
+        closesocket(s);
+        return POLLIN;
+    }
+    echo->callback = tstEchoPump;
+    echo->slot = -1;
+    if (pollmgr_add(echo, s, POLLIN) < 0) {
+        RTTestFailed(g_hTest, "pollmgr_add failed");
+        RTMemFree(echo);
+        closesocket(s);
+    }
+    return POLLIN;
+}
+
+
+static DECLCALLBACK(int)
+tstPollMgrThread(RTTHREAD hThreadSelf, void *pvUser)
+{
+    RT_NOREF(hThreadSelf);
+    pollmgr_thread(pvUser);
+    return VINF_SUCCESS;
+}
+
+
+static int
+tstSendAll(SOCKET s, const char *pb, size_t cb)
+{
+    while (cb > 0) {
+        ssize_t n = send(s, pb, cb, 0);
+        if (n <= 0) {
+            return -1;
+        }
+        pb += n;
+        cb -= n;
+    }
+    return 0;
+}
+
+
+static int
+tstRecvAll(SOCKET s, char *pb, size_t cb)
+{
+    while (cb > 0) {
+        ssize_t n = recv(s, pb, cb, 0);
+        if (n <= 0) {
+            return -1;
+        }
+        pb += n;
+        cb -= n;
+    }
+    return 0;
+}
+
+
+/**
+ * Bounces one message off the echo server on each of the given
+ * connections, sending all of them first so several are ready at once.
+ */
+static int
+tstPingPong(SOCKET *paSocks, unsigned cSocks, unsigned uStride)
+{
+    char abMsg[TST_MSG_SIZE];
+    char abReply[TST_MSG_SIZE];
+    unsigned i;
+
+    for (i = 0; i < cSocks; ++i) {
+        memset(abMsg, (int)(i & 0xff), sizeof(abMsg));
+        if (tstSendAll(paSocks[i * uStride], abMsg, sizeof(abMsg)) < 0) {
+            return -1;
+        }
+    }
+    for (i = 0; i < cSocks; ++i) {
+        memset(abMsg, (int)(i & 0xff), sizeof(abMsg));
+        if (   tstRecvAll(paSocks[i * uStride], abReply, sizeof(abReply)) < 0
+            || memcmp(abMsg, abReply, sizeof(abReply)) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+
+int
+main(int argc, char **argv)
+{
+    static const RTGETOPTDEF s_aOptions[] = {
+        { "--max-conns",    'c', RTGETOPT_REQ_UINT32 },
+        { "--active",       'a', RTGETOPT_REQ_UINT32 },
+        { "--rounds",       'r', RTGETOPT_REQ_UINT32 },
+    };
+    uint32_t cMaxConns = 8192;
+    uint32_t cActive = 16;
+    uint32_t cRounds = 20000;
+    RTGETOPTSTATE GetState;
+    RTGETOPTUNION ValueUnion;
+    struct sockaddr_in sin;
+    socklen_t cbSin = sizeof(sin);
+    struct rlimit rlim;
+    SOCKET sockListen;
+    SOCKET *paSocks;
+    RTTHREAD hThread;
+    uint32_t cConns, cOpen, cLimit;
+    int on = 1;
+    int ch;
+    int rc;
+    RTEXITCODE rcExit;
+
+    rcExit = RTTestInitAndCreate("tstNATPollMgr", &g_hTest);
+    if (rcExit != RTEXITCODE_SUCCESS) {
+        return rcExit;
+    }
+    RTTestBanner(g_hTest);
+
+    RTGetOptInit(&GetState, argc, argv, s_aOptions, RT_ELEMENTS(s_aOptions), 1, 0 /*fFlags*/);
+    while ((ch = RTGetOpt(&GetState, &ValueUnion)) != 0) {
+        switch (ch) {
+        case 'c':
+            cMaxConns = RT_MAX(ValueUnion.u32, 1);
+            break;
+        case 'a':
+            cActive = RT_MAX(ValueUnion.u32, 1);
+            break;
+        case 'r':
+            cRounds = RT_MAX(ValueUnion.u32, 1);
+            break;
+        default:
+            return RTGetOptPrintError(ch, &ValueUnion);
+        }
+    }
+
+    /*
+     * Each connection costs us two descriptors, so get as many as we can.
+     */
+    if (getrlimit(RLIMIT_NOFILE, &rlim) == 0) {
+        rlim.rlim_cur = rlim.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rlim);
+        getrlimit(RLIMIT_NOFILE, &rlim);
+        cLimit = rlim.rlim_cur > 64 ? (uint32_t)RT_MIN((rlim.rlim_cur - 64) / 2, UINT32_MAX) : 0;
+        if (cMaxConns > cLimit) {
+            RTTestPrintf(g_hTest, RTTESTLVL_ALWAYS, "Descriptor limit caps connections at %u\n", cLimit);
+            cMaxConns = cLimit;
+        }
+    }
+    cActive = RT_MIN(cActive, cMaxConns);
+    RTTESTI_CHECK_RET(cActive > 0, RTTestSummaryAndDestroy(g_hTest));
+
+    /*
+     * Start the echo server on the poll manager.
+     */
+    RTTESTI_CHECK_RET(pollmgr_init() == 0, RTTestSummaryAndDestroy(g_hTest));
+
+    sockListen = socket(AF_INET, SOCK_STREAM, 0);
+    RTTESTI_CHECK_RET(sockListen != INVALID_SOCKET, RTTestSummaryAndDestroy(g_hTest));
+    setsockopt(sockListen, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    RT_ZERO(sin);
+    sin.sin_family = AF_INET;
+    sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    sin.sin_port = 0;
+    RTTESTI_CHECK_RET(bind(sockListen, (struct sockaddr *)&sin, sizeof(sin)) == 0, RTTestSummaryAndDestroy(g_hTest));
+    RTTESTI_CHECK_RET(listen(sockListen, 1024) == 0, RTTestSummaryAndDestroy(g_hTest));
+    RTTESTI_CHECK_RET(getsockname(sockListen, (struct sockaddr *)&sin, &cbSin) == 0, RTTestSummaryAndDestroy(g_hTest));
+
+    /* the loop isn't running yet, so we can add it from here */
+    g_ListenHdl.callback = tstListen;
+    g_ListenHdl.data = NULL;
+    g_ListenHdl.slot = -1;
+    RTTESTI_CHECK_RET(pollmgr_add(&g_ListenHdl, sockListen, POLLIN) >= 0, RTTestSummaryAndDestroy(g_hTest));
+
+    rc = RTThreadCreate(&hThread, tstPollMgrThread, NULL, 0, RTTHREADTYPE_IO, 0, "pollmgr");
+    RTTESTI_CHECK_RC_RET(rc, VINF_SUCCESS, RTTestSummaryAndDestroy(g_hTest));
+
+    paSocks = (SOCKET *)RTMemAllocZ(sizeof(SOCKET) * cMaxConns);
+    RTTESTI_CHECK_RET(paSocks != NULL, RTTestSummaryAndDestroy(g_hTest));
+
+    /*
+     * Grow the number of connections, keeping the number of active
+     * ones constant.  The rest just sit there and have to be watched.
+     */
+    cOpen = 0;
+    for (cConns = cActive; ; cConns = RT_MIN(cConns * 4, cMaxConns)) {
+        uint64_t nsStart, cNsElapsed;
+        uint32_t i;
+
+        RTTestSubF(g_hTest, "%u connections, %u active", cConns, cActive);
+
+        for (; cOpen < cConns; ++cOpen) {
+            SOCKET s = socket(AF_INET, SOCK_STREAM, 0);
+            if (s == INVALID_SOCKET || connect(s, (struct sockaddr *)&sin, sizeof(sin)) != 0) {
+                RTTestFailed(g_hTest, "connection #%u: %s", cOpen, strerror(errno));
+                if (s != INVALID_SOCKET) {
+                    closesocket(s);
+                }
+                break;
+            }
+            setsockopt(s, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+            paSocks[cOpen] = s;
+
+            /* make sure it has been accepted and works */
+            if (tstPingPong(&paSocks[cOpen], 1, 1) < 0) {
+                RTTestFailed(g_hTest, "connection #%u: echo failed", cOpen);
+                ++cOpen;
+                break;
+            }
+        }
+        if (RTTestSubErrorCount(g_hTest)) {
+            break;
+        }
+
+        /* spread the active connections over the whole set */
+        nsStart = RTTimeNanoTS();
+        for (i = 0; i < cRounds; ++i) {
+            if (tstPingPong(paSocks, cActive, cConns / cActive) < 0) {
+                RTTestFailed(g_hTest, "round %u: echo failed", i);
+                break;
+            }
+        }
+        cNsElapsed = RT_MAX(RTTimeNanoTS() - nsStart, 1);
+
+        if (!RTTestSubErrorCount(g_hTest)) {
+            RTTestValueF(g_hTest, (uint64_t)cRounds * cActive * RT_NS_1SEC / cNsElapsed, RTTESTUNIT_OCCURRENCES_PER_SEC,
+                         "round trips, %u conns", cConns);
+            RTTestValueF(g_hTest, cNsElapsed / ((uint64_t)cRounds * cActive), RTTESTUNIT_NS_PER_OCCURRENCE,
+                         "per round trip, %u conns", cConns);
+        }
+
+        if (cConns >= cMaxConns) {
+            break;
+        }
+    }
+
+    /*
+     * Close the client ends.  The poll manager thread is left running, it
+     * has no way to stop, and goes away with the process.
+     */
+    while (cOpen > 0) {
+        closesocket(paSocks[--cOpen]);
+    }
+    RTMemFree(paSocks);
+
+    return RTTestSummaryAndDestroy(g_hTest);
+}
@@ -0,0 +1,345 @@
+/* $Id$ */
+/** @file
+ * IPRT - Memory Arena (Bump Allocator).
+ */
+
+/*
+ * Copyright (C) 2016 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ *
+ * The contents of this file may alternatively be used under the terms
+ * of the Common Development and Distribution License Version 1.0
+ * (CDDL) only, as it comes in the "COPYING.CDDL" file of the
+ * VirtualBox OSE distribution, in which case the provisions of the
+ * CDDL are applicable instead of those of the GPL.
+ *
+ * You may elect to license modified versions of this file under the
+ * terms and conditions of either the GPL or the CDDL or both.
+ */
+
+
+/*********************************************************************************************************************************
+*   Header Files                                                                                                                 *
+*********************************************************************************************************************************/
+#include <iprt/memarena.h>
+#include "internal/iprt.h"
+
+#include <iprt/assert.h>
+#include <iprt/err.h>
+#include <iprt/mem.h>
+#include <iprt/string.h>
+
+#include "internal/magics.h"
+
+
+/*********************************************************************************************************************************
+*   Defined Constants And Macros                                                                                                 *
+*********************************************************************************************************************************/
+/** The default chunk size. */
+#define RTMEMARENA_DEFAULT_CHUNK_SIZE   _16K
+/** The smallest chunk size we accept. */
+#define RTMEMARENA_MIN_CHUNK_SIZE       _1K
+/** The allocation alignment. */
+#define RTMEMARENA_ALIGNMENT            RTMEM_ALIGNMENT
+
+
+/*********************************************************************************************************************************
+*   Structures and Typedefs                                                                                                      *
+*********************************************************************************************************************************/
+/**
+ * A chunk of arena memory, the allocations follow the header.
+ */
+typedef struct RTMEMARENACHUNK
+{
+    /** The next chunk.  The ones following RTMEMARENAINT::pChunkCur are spares. */
+    struct RTMEMARENACHUNK *pNext;
+    /** The offset of the free space in the chunk (relative to the data). */
+    size_t                  offFree;
+} RTMEMARENACHUNK;
+/** Pointer to an arena chunk. */
+typedef RTMEMARENACHUNK *PRTMEMARENACHUNK;
+
+/**
+ * A large allocation with a heap block of its own.
+ */
+typedef struct RTMEMARENALARGE
+{
+    /** The next large block (LIFO). */
+    struct RTMEMARENALARGE *pNext;
+    /** The size of the block, including this header. */
+    size_t                  cb;
+} RTMEMARENALARGE;
+/** Pointer to a large allocation. */
+typedef RTMEMARENALARGE *PRTMEMARENALARGE;
+
+/** The aligned chunk header size. */
+#define RTMEMARENA_CHUNK_HDR_SIZE       RT_ALIGN_Z(sizeof(RTMEMARENACHUNK), RTMEMARENA_ALIGNMENT)
+/** The aligned large block header size. */
+#define RTMEMARENA_LARGE_HDR_SIZE       RT_ALIGN_Z(sizeof(RTMEMARENALARGE), RTMEMARENA_ALIGNMENT)
+
+/**
+ * Memory arena instance.
+ */
+typedef struct RTMEMARENAINT
+{
+    /** Magic value (RTMEMARENA_MAGIC). */
+    uint32_t                u32Magic;
+    /** Reserved flags. */
+    uint32_t                fFlags;
+    /** The usable size of each chunk. */
+    size_t                  cbChunk;
+    /** Allocations larger than this get a heap block of their own. */
+    size_t                  cbLargeThreshold;
+    /** The first chunk. */
+    PRTMEMARENACHUNK        pChunkHead;
+    /** The chunk we're currently allocating from, NULL if none. */
+    PRTMEMARENACHUNK        pChunkCur;
+    /** The large allocations, most recent first. */
+    PRTMEMARENALARGE        pLargeHead;
+    /** The number of bytes currently allocated. */
+    size_t                  cbUsed;
+    /** The number of bytes held by chunks and large blocks. */
+    size_t                  cbReserved;
+    /** Number of allocations. */
+    uint64_t                cAllocs;
+    /** Number of heap allocations. */
+    uint64_t                cHeapAllocs;
+    /** Number of resets. */
+    uint64_t                cResets;
+} RTMEMARENAINT;
+
+
+RTDECL(int) RTMemArenaCreate(PRTMEMARENA phArena, size_t cbChunk, uint32_t fFlags)
+{
+    AssertPtrReturn(phArena, VERR_INVALID_POINTER);
+    AssertReturn(!fFlags, VERR_INVALID_PARAMETER);
+    if (!cbChunk)
+        cbChunk = RTMEMARENA_DEFAULT_CHUNK_SIZE;
+    AssertReturn(cbChunk >= RTMEMARENA_MIN_CHUNK_SIZE && cbChunk <= _1G, VERR_OUT_OF_RANGE);
+
+    RTMEMARENAINT *pThis = (RTMEMARENAINT *)RTMemAlloc(sizeof(*pThis));
+    if (!pThis)
+        return VERR_NO_MEMORY;
+
+    pThis->u32Magic         = RTMEMARENA_MAGIC;
+    pThis->fFlags           = fFlags;
+    pThis->cbChunk          = RT_ALIGN_Z(cbChunk, RTMEMARENA_ALIGNMENT) - RTMEMARENA_CHUNK_HDR_SIZE;
+    pThis->cbLargeThreshold = pThis->cbChunk / 4;
+    pThis->pChunkHead       = NULL;
+    pThis->pChunkCur        = NULL;
+    pThis->pLargeHead       = NULL;
+    pThis->cbUsed           = 0;
+    pThis->cbReserved       = 0;
+    pThis->cAllocs          = 0;
+    pThis->cHeapAllocs      = 0;
+    pThis->cResets          = 0;
+
+    *phArena = pThis;
+    return VINF_SUCCESS;
+}
+RT_EXPORT_SYMBOL(RTMemArenaCreate);
+
+
+/**
+ * Frees the large blocks until reaching @a pStop.
+ *
+ * @param   pThis               The arena.
+ * @param   pStop               The block to stop at (kept), NULL for all.
+ */
+static void rtMemArenaFreeLarge(RTMEMARENAINT *pThis, PRTMEMARENALARGE pStop)
+{
+    PRTMEMARENALARGE pLarge = pThis->pLargeHead;
+    while (pLarge != pStop)
+    {
+        AssertBreak(pLarge); /* Invalid mark. */
+        PRTMEMARENALARGE pNext = pLarge->pNext;
+        pThis->cbReserved -= pLarge->cb;
+        RTMemFree(pLarge);
+        pLarge = pNext;
+    }
+    pThis->pLargeHead = pLarge;
+}
+
+
+RTDECL(int) RTMemArenaDestroy(RTMEMARENA hArena)
+{
+    RTMEMARENAINT *pThis = hArena;
+    if (pThis == NIL_RTMEMARENA)
+        return VINF_SUCCESS;
+    AssertPtrReturn(pThis, VERR_INVALID_HANDLE);
+    AssertReturn(pThis->u32Magic == RTMEMARENA_MAGIC, VERR_INVALID_HANDLE);
+
+    pThis->u32Magic = RTMEMARENA_MAGIC_DEAD;
+    rtMemArenaFreeLarge(pThis, NULL);
+    PRTMEMARENACHUNK pChunk = pThis->pChunkHead;
+    while (pChunk)
+    {
+        PRTMEMARENACHUNK pNext = pChunk->pNext;
+        RTMemFree(pChunk);
+        pChunk = pNext;
+    }
+    RTMemFree(pThis);
+    return VINF_SUCCESS;
+}
+RT_EXPORT_SYMBOL(RTMemArenaDestroy);
+
+
+/**
+ * Slow path of RTMemArenaAlloc: moves on to the next chunk or makes a large
+ * allocation.
+ *
+ * @returns Pointer to the memory, NULL on failure.
+ * @param   pThis               The arena.
+ * @param   cbAligned           The aligned allocation size.
+ */
+static void *rtMemArenaAllocSlow(RTMEMARENAINT *pThis, size_t cbAligned)
+{
+    if (cbAligned > pThis->cbLargeThreshold)
+    {
+        size_t const cbBlock = RTMEMARENA_LARGE_HDR_SIZE + cbAligned;
+        AssertReturn(cbBlock > cbAligned, NULL);
+        PRTMEMARENALARGE pLarge = (PRTMEMARENALARGE)RTMemAlloc(cbBlock);
+        if (!pLarge)
+            return NULL;
+        pLarge->pNext       = pThis->pLargeHead;
+        pLarge->cb          = cbBlock;
+        pThis->pLargeHead   = pLarge;
+        pThis->cbReserved  += cbBlock;
+        pThis->cbUsed      += cbAligned;
+        pThis->cHeapAllocs++;
+        return (uint8_t *)pLarge + RTMEMARENA_LARGE_HDR_SIZE;
+    }
+
+    /*
+     * Use the next spare chunk or allocate a new one.  All chunks have the
+     * same size, so the request will fit in an empty one.
+     */
+    PRTMEMARENACHUNK pChunk = pThis->pChunkCur ? pThis->pChunkCur->pNext : pThis->pChunkHead;
+    if (!pChunk)
+    {
+        pChunk = (PRTMEMARENACHUNK)RTMemAlloc(RTMEMARENA_CHUNK_HDR_SIZE + pThis->cbChunk);
+        if (!pChunk)
+            return NULL;
+        pChunk->pNext = NULL;
+        if (pThis->pChunkCur)
+            pThis->pChunkCur->pNext = pChunk;
+        else
+            pThis->pChunkHead = pChunk;
+        pThis->cbReserved += RTMEMARENA_CHUNK_HDR_SIZE + pThis->cbChunk;
+        pThis->cHeapAllocs++;
+    }
+    pThis->pChunkCur = pChunk;
+
+    pChunk->offFree = cbAligned;
+    pThis->cbUsed  += cbAligned;
+    return (uint8_t *)pChunk + RTMEMARENA_CHUNK_HDR_SIZE;
+}
+
+
+RTDECL(void *) RTMemArenaAlloc(RTMEMARENA hArena, size_t cb)
+{
+    RTMEMARENAINT *pThis = hArena;
+    AssertPtrReturn(pThis, NULL);
+    AssertReturn(pThis->u32Magic == RTMEMARENA_MAGIC, NULL);
+
+    size_t const cbAligned = cb ? RT_ALIGN_Z(cb, RTMEMARENA_ALIGNMENT) : RTMEMARENA_ALIGNMENT;
+    AssertReturn(cbAligned >= cb, NULL);
+    pThis->cAllocs++;
+
+    PRTMEMARENACHUNK pChunk = pThis->pChunkCur;
+    if (RT_LIKELY(   pChunk
+                  && pThis->cbChunk - pChunk->offFree >= cbAligned))
+    {
+        void *pv = (uint8_t *)pChunk + RTMEMARENA_CHUNK_HDR_SIZE + pChunk->offFree;
+        pChunk->offFree += cbAligned;
+        pThis->cbUsed   += cbAligned;
+        return pv;
+    }
+    return rtMemArenaAllocSlow(pThis, cbAligned);
+}
+RT_EXPORT_SYMBOL(RTMemArenaAlloc);
+
+
+RTDECL(void *) RTMemArenaAllocZ(RTMEMARENA hArena, size_t cb)
+{
+    void *pv = RTMemArenaAlloc(hArena, cb);
+    if (pv)
+        RT_BZERO(pv, cb);
+    return pv;
+}
+RT_EXPORT_SYMBOL(RTMemArenaAllocZ);
+
+
+RTDECL(void) RTMemArenaMark(RTMEMARENA hArena, PRTMEMARENAMARK pMark)
+{
+    RTMEMARENAINT *pThis = hArena;
+    AssertPtrReturnVoid(pThis);
+    AssertReturnVoid(pThis->u32Magic == RTMEMARENA_MAGIC);
+    AssertPtrReturnVoid(pMark);
+
+    pMark->pvChunk  = pThis->pChunkCur;
+    pMark->offChunk = pThis->pChunkCur ? pThis->pChunkCur->offFree : 0;
+    pMark->pvLarge  = pThis->pLargeHead;
+    pMark->cbUsed   = pThis->cbUsed;
+}
+RT_EXPORT_SYMBOL(RTMemArenaMark);
+
+
+RTDECL(void) RTMemArenaResetToMark(RTMEMARENA hArena, PCRTMEMARENAMARK pMark)
+{
+    RTMEMARENAINT *pThis = hArena;
+    AssertPtrReturnVoid(pThis);
+    AssertReturnVoid(pThis->u32Magic == RTMEMARENA_MAGIC);
+    AssertPtrReturnVoid(pMark);
+    AssertReturnVoid(pMark->cbUsed <= pThis->cbUsed);
+
+    rtMemArenaFreeLarge(pThis, (PRTMEMARENALARGE)pMark->pvLarge);
+
+    /* The chunks after the marked one become spares. */
+    pThis->pChunkCur = (PRTMEMARENACHUNK)pMark->pvChunk;
+    if (pThis->pChunkCur)
+    {
+        Assert(pMark->offChunk <= pThis->pChunkCur->offFree);
+        pThis->pChunkCur->offFree = pMark->offChunk;
+    }
+    pThis->cbUsed = pMark->cbUsed;
+    pThis->cResets++;
+}
+RT_EXPORT_SYMBOL(RTMemArenaResetToMark);
+
+
+RTDECL(void) RTMemArenaReset(RTMEMARENA hArena)
+{
+    RTMEMARENAMARK Mark;
+    Mark.pvChunk  = NULL;
+    Mark.offChunk = 0;
+    Mark.pvLarge  = NULL;
+    Mark.cbUsed   = 0;
+    RTMemArenaResetToMark(hArena, &Mark);
+}
+RT_EXPORT_SYMBOL(RTMemArenaReset);
+
+
+RTDECL(int) RTMemArenaQueryStats(RTMEMARENA hArena, PRTMEMARENASTATS pStats)
+{
+    RTMEMARENAINT *pThis = hArena;
+    AssertPtrReturn(pThis, VERR_INVALID_HANDLE);
+    AssertReturn(pThis->u32Magic == RTMEMARENA_MAGIC, VERR_INVALID_HANDLE);
+    AssertPtrReturn(pStats, VERR_INVALID_POINTER);
+
+    pStats->cAllocs     = pThis->cAllocs;
+    pStats->cHeapAllocs = pThis->cHeapAllocs;
+    pStats->cResets     = pThis->cResets;
+    pStats->cbUsed      = pThis->cbUsed;
+    pStats->cbReserved  = pThis->cbReserved;
+    return VINF_SUCCESS;
+}
+RT_EXPORT_SYMBOL(RTMemArenaQueryStats);
+
@@ -36,11 +36,38 @@
 #include <iprt/critsect.h>
 #include <iprt/err.h>
 #include <iprt/mem.h>
+#include <iprt/once.h>
 #include <iprt/param.h>
+#include <iprt/string.h>
+#include <iprt/thread.h>
 
 #include "internal/magics.h"
 
 
+/*********************************************************************************************************************************
+*   Defined Constants And Macros                                                                                                 *
+*********************************************************************************************************************************/
+/** The number of objects (rounds) a magazine holds. */
+#define RTMEMCACHE_MAG_ROUNDS               32
+/** The max number of full magazines in the depot.  Once reached, threads
+ * return objects to the pages instead. */
+#define RTMEMCACHE_DEPOT_MAX_FULL           16
+
+/** @name RTMEMCACHETHREAD::u32State values.
+ * @{ */
+/** In use by the thread, but the magazines are idle. */
+#define RTMEMCACHETHREAD_STATE_ACTIVE       UINT32_C(0)
+/** The thread is terminating and cleaning up. */
+#define RTMEMCACHETHREAD_STATE_EXITING      UINT32_C(1)
+/** The cache has been destroyed, the thread frees the structure when it
+ * terminates or next sets up magazines for a cache. */
+#define RTMEMCACHETHREAD_STATE_DESTROYING   UINT32_C(2)
+/** The magazines are being worked on, either by the owner thread or by
+ * somebody draining them (RTMEMCACHEINT::fMagReap only). */
+#define RTMEMCACHETHREAD_STATE_BUSY         UINT32_C(3)
+/** @} */
+
+
 /*********************************************************************************************************************************
 *   Structures and Typedefs                                                                                                      *
 *********************************************************************************************************************************/
@@ -50,6 +77,62 @@ typedef struct RTMEMCACHEINT  *PRTMEMCACHEINT;
 typedef struct RTMEMCACHEPAGE *PRTMEMCACHEPAGE;
 
 
+/**
+ * A magazine, a stack of allocated objects.
+ */
+typedef struct RTMEMCACHEMAG
+{
+    /** Next magazine in the depot list. */
+    struct RTMEMCACHEMAG       *pNext;
+    /** The number of objects in the magazine. */
+    uint32_t                    cRounds;
+    /** The objects. */
+    void                       *apvRounds[RTMEMCACHE_MAG_ROUNDS];
+} RTMEMCACHEMAG;
+/** Pointer to a magazine. */
+typedef RTMEMCACHEMAG *PRTMEMCACHEMAG;
+
+
+/**
+ * Per-thread magazine state.
+ *
+ * Only the owner thread touches the magazines and the statistics, except when
+ * the thread or the cache is going away.  In caches with a size limit
+ * (RTMEMCACHEINT::fMagReap), whoever moves u32State from ACTIVE to BUSY owns
+ * the magazines, so a thread running out of objects can drain the magazines of
+ * idle threads.
+ *
+ * On hosts with TLS destructors, the structure is only ever freed by the owner
+ * thread, so the destructor cannot race RTMemCacheDestroy freeing it.
+ */
+typedef struct RTMEMCACHETHREAD
+{
+    /** The cache. */
+    PRTMEMCACHEINT              pCache;
+    /** Next in the RTMEMCACHEINT::pThreads list. */
+    struct RTMEMCACHETHREAD    *pNext;
+    /** Next state of the same thread (g_iMemCacheThreadTls list). */
+    struct RTMEMCACHETHREAD    *pNextInThread;
+    /** RTMEMCACHETHREAD_STATE_XXX. */
+    uint32_t volatile           u32State;
+    /** The magazine we're allocating from and freeing into. */
+    PRTMEMCACHEMAG              pLoaded;
+    /** The previously loaded magazine, either full or empty. */
+    PRTMEMCACHEMAG              pPrevious;
+    /** @name Statistics
+     * @{ */
+    uint64_t                    cAllocMagHits;
+    uint64_t                    cAllocDepotHits;
+    uint64_t                    cAllocMisses;
+    uint64_t                    cFreeMagHits;
+    uint64_t                    cFreeDepotHits;
+    uint64_t                    cFreeMisses;
+    /** @} */
+} RTMEMCACHETHREAD;
+/** Pointer to per-thread magazine state. */
+typedef RTMEMCACHETHREAD *PRTMEMCACHETHREAD;
+
+
 
 /**
  * A free object.
@@ -143,16 +226,59 @@ typedef struct RTMEMCACHEINT
      * These are marked as used in the allocation bitmaps.
      *
      * @todo This doesn't scale well when several threads are beating on the
-     *       cache.  Also, it totally doesn't work when the objects are too
-     *       small. */
+     *       cache (see RTMEMCACHE_F_MAGAZINES).  Also, it totally doesn't work
+     *       when the objects are too small. */
     PRTMEMCACHEFREEOBJ volatile pFreeTop;
+
+    /** @name Magazine layer (RTMEMCACHE_F_MAGAZINES).
+     * The depot lists and the thread list are protected by CritSect.
+     * @{ */
+    /** Whether to use per-thread magazines. */
+    bool                        fMagazines;
+    /** Whether the magazines of other threads are drained when running out of
+     * objects.  Only caches with a size limit do this, as it requires a locked
+     * instruction on each access to the magazines. */
+    bool                        fMagReap;
+    /** TLS entry for the per-thread magazine state. */
+    RTTLS                       iTls;
+    /** List of threads with magazines. */
+    PRTMEMCACHETHREAD           pThreads;
+    /** The number of entries in the pThreads list. */
+    uint32_t                    cThreads;
+    /** Depot: the number of full magazines (read without locking). */
+    uint32_t volatile           cDepotFull;
+    /** Depot: list of full magazines. */
+    PRTMEMCACHEMAG              pDepotFull;
+    /** Depot: the number of empty magazines. */
+    uint32_t                    cDepotEmpty;
+    /** Depot: list of empty magazines. */
+    PRTMEMCACHEMAG              pDepotEmpty;
+    /** Statistics of threads that have terminated. */
+    RTMEMCACHESTATS             RetiredStats;
+    /** @} */
 } RTMEMCACHEINT;
 
 
+/*********************************************************************************************************************************
+*   Global Variables                                                                                                             *
+*********************************************************************************************************************************/
+/** Initialize the per-thread state list TLS entry once. */
+static RTONCE                   g_MemCacheThreadTlsOnce = RTONCE_INITIALIZER;
+/** TLS entry for the list of a thread's magazine states in all caches.
+ * This is never freed, so its destructor doesn't race cache destruction. */
+static RTTLS                    g_iMemCacheThreadTls = NIL_RTTLS;
+/** Whether we get called when a thread terminates. */
+static bool                     g_fMemCacheThreadDtor = false;
+
+
 /*********************************************************************************************************************************
 *   Internal Functions                                                                                                           *
 *********************************************************************************************************************************/
 static void rtMemCacheFreeList(RTMEMCACHEINT *pThis, PRTMEMCACHEFREEOBJ pHead);
+static void rtMemCacheFreeObj(RTMEMCACHEINT *pThis, void *pvObj);
+static DECLCALLBACK(int)  rtMemCacheMagInitOnce(void *pvUser);
+static DECLCALLBACK(void) rtMemCacheMagThreadDtor(void *pvValue);
+static void rtMemCacheMagDestroy(RTMEMCACHEINT *pThis);
 
 
 RTDECL(int) RTMemCacheCreate(PRTMEMCACHE phMemCache, size_t cbObject, size_t cbAlignment, uint32_t cMaxObjects,
@@ -165,7 +291,7 @@ RTDECL(int) RTMemCacheCreate(PRTMEMCACHE phMemCache, size_t cbObject, size_t cbA
     AssertReturn(!pfnDtor || pfnCtor, VERR_INVALID_PARAMETER);
     AssertReturn(cbObject > 0, VERR_INVALID_PARAMETER);
     AssertReturn(cbObject <= PAGE_SIZE / 8, VERR_INVALID_PARAMETER);
-    AssertReturn(!fFlags, VERR_INVALID_PARAMETER);
+    AssertReturn(!(fFlags & ~RTMEMCACHE_F_VALID_MASK), VERR_INVALID_PARAMETER);
 
     if (cbAlignment == 0)
     {
@@ -201,6 +327,22 @@ RTDECL(int) RTMemCacheCreate(PRTMEMCACHE phMemCache, size_t cbObject, size_t cbA
         return rc;
     }
 
+    pThis->fMagazines       = RT_BOOL(fFlags & RTMEMCACHE_F_MAGAZINES);
+    pThis->fMagReap         = pThis->fMagazines && cMaxObjects != UINT32_MAX;
+    pThis->iTls             = NIL_RTTLS;
+    if (pThis->fMagazines)
+    {
+        rc = RTOnce(&g_MemCacheThreadTlsOnce, rtMemCacheMagInitOnce, NULL);
+        if (RT_SUCCESS(rc))
+            rc = RTTlsAllocEx(&pThis->iTls, NULL);
+        if (RT_FAILURE(rc))
+        {
+            RTCritSectDelete(&pThis->CritSect);
+            RTMemFree(pThis);
+            return rc;
+        }
+    }
+
     pThis->u32Magic         = RTMEMCACHE_MAGIC;
     pThis->cbObject         = (uint32_t)RT_ALIGN_Z(cbObject, cbAlignment);
     pThis->cbAlignment      = (uint32_t)cbAlignment;
@@ -224,6 +366,13 @@ RTDECL(int) RTMemCacheCreate(PRTMEMCACHE phMemCache, size_t cbObject, size_t cbA
     pThis->cFree            = 0;
     pThis->pPageHint        = NULL;
     pThis->pFreeTop         = NULL;
+    pThis->pThreads         = NULL;
+    pThis->cThreads         = 0;
+    pThis->cDepotFull       = 0;
+    pThis->pDepotFull       = NULL;
+    pThis->cDepotEmpty      = 0;
+    pThis->pDepotEmpty      = NULL;
+    RT_ZERO(pThis->RetiredStats);
 
     *phMemCache = pThis;
     return VINF_SUCCESS;
@@ -249,6 +398,8 @@ RTDECL(int) RTMemCacheDestroy(RTMEMCACHE hMemCache)
      * Destroy it.
      */
     AssertReturn(ASMAtomicCmpXchgU32(&pThis->u32Magic, RTMEMCACHE_MAGIC_DEAD, RTMEMCACHE_MAGIC), VERR_INVALID_HANDLE);
+    if (pThis->fMagazines)
+        rtMemCacheMagDestroy(pThis);
     RTCritSectDelete(&pThis->CritSect);
 
     while (pThis->pPageHead)
@@ -360,12 +511,15 @@ DECL_FORCE_INLINE(int32_t) rtMemCacheGrabObj(PRTMEMCACHEPAGE pPage)
 }
 
 
-RTDECL(int) RTMemCacheAllocEx(RTMEMCACHE hMemCache, void **ppvObj)
+/**
+ * Allocates one object from the free stack or the pages.
+ *
+ * @returns IPRT status code.
+ * @param   pThis               The memory cache instance.
+ * @param   ppvObj              Where to return the object.
+ */
+static int rtMemCacheAllocOne(RTMEMCACHEINT *pThis, void **ppvObj)
 {
-    RTMEMCACHEINT *pThis = hMemCache;
-    AssertPtrReturn(pThis, VERR_INVALID_PARAMETER);
-    AssertReturn(pThis->u32Magic == RTMEMCACHE_MAGIC, VERR_INVALID_PARAMETER);
-
     /*
      * Try grab a free object from the stack.
      */
@@ -468,11 +622,11 @@ RTDECL(int) RTMemCacheAllocEx(RTMEMCACHE hMemCache, void **ppvObj)
     if (   pThis->pfnCtor
         && !ASMAtomicBitTestAndSet(pPage->pbmCtor, iObj))
     {
-        int rc = pThis->pfnCtor(hMemCache, pvObj, pThis->pvUser);
+        int rc = pThis->pfnCtor(pThis, pvObj, pThis->pvUser);
         if (RT_FAILURE(rc))
         {
             ASMAtomicBitClear(pPage->pbmCtor, iObj);
-            RTMemCacheFree(pThis, pvObj);
+            rtMemCacheFreeObj(pThis, pvObj);
             return rc;
         }
     }
@@ -482,6 +636,264 @@ RTDECL(int) RTMemCacheAllocEx(RTMEMCACHE hMemCache, void **ppvObj)
 }
 
 
+/**
+ * Gets the calling thread's magazine state, creating it if necessary.
+ *
+ * @returns Pointer to the state, NULL if we couldn't allocate it.
+ * @param   pThis               The memory cache instance.
+ */
+static PRTMEMCACHETHREAD rtMemCacheMagGetThread(RTMEMCACHEINT *pThis)
+{
+    PRTMEMCACHETHREAD pThread = (PRTMEMCACHETHREAD)RTTlsGet(pThis->iTls);
+    if (RT_LIKELY(pThread))
+        return pThread;
+
+    /*
+     * First time around, set up two empty magazines.
+     */
+    pThread = (PRTMEMCACHETHREAD)RTMemAllocZ(sizeof(*pThread));
+    if (!pThread)
+        return NULL;
+    pThread->pCache   = pThis;
+    pThread->u32State = RTMEMCACHETHREAD_STATE_ACTIVE;
+
+    RTCritSectEnter(&pThis->CritSect);
+    PRTMEMCACHEMAG apMags[2];
+    for (unsigned i = 0; i < RT_ELEMENTS(apMags); i++)
+    {
+        apMags[i] = pThis->pDepotEmpty;
+        if (apMags[i])
+        {
+            pThis->pDepotEmpty = apMags[i]->pNext;
+            pThis->cDepotEmpty--;
+        }
+    }
+    RTCritSectLeave(&pThis->CritSect);
+
+    for (unsigned i = 0; i < RT_ELEMENTS(apMags); i++)
+        if (!apMags[i])
+            apMags[i] = (PRTMEMCACHEMAG)RTMemAlloc(sizeof(RTMEMCACHEMAG));
+    if (apMags[0] && apMags[1])
+    {
+        apMags[0]->pNext   = apMags[1]->pNext   = NULL;
+        apMags[0]->cRounds = apMags[1]->cRounds = 0;
+        pThread->pLoaded   = apMags[0];
+        pThread->pPrevious = apMags[1];
+
+        int rc = RTTlsSet(pThis->iTls, pThread);
+        if (RT_SUCCESS(rc) && g_fMemCacheThreadDtor)
+        {
+            /* Link it into the thread's own list, freeing the states of
+               destroyed caches while at it. */
+            PRTMEMCACHETHREAD pHead = NULL;
+            for (PRTMEMCACHETHREAD pCur = (PRTMEMCACHETHREAD)RTTlsGet(g_iMemCacheThreadTls); pCur; )
+            {
+                PRTMEMCACHETHREAD pNextCur = pCur->pNextInThread;
+                if (ASMAtomicReadU32(&pCur->u32State) == RTMEMCACHETHREAD_STATE_DESTROYING)
+                    RTMemFree(pCur);
+                else
+                {
+                    pCur->pNextInThread = pHead;
+                    pHead = pCur;
+                }
+                pCur = pNextCur;
+            }
+            pThread->pNextInThread = pHead;
+            rc = RTTlsSet(g_iMemCacheThreadTls, pThread);
+            if (RT_FAILURE(rc))
+            {
+                RTTlsSet(g_iMemCacheThreadTls, pHead);
+                RTTlsSet(pThis->iTls, NULL);
+            }
+        }
+        if (RT_SUCCESS(rc))
+        {
+            RTCritSectEnter(&pThis->CritSect);
+            pThread->pNext  = pThis->pThreads;
+            pThis->pThreads = pThread;
+            pThis->cThreads++;
+            RTCritSectLeave(&pThis->CritSect);
+            return pThread;
+        }
+    }
+
+    RTMemFree(apMags[0]);
+    RTMemFree(apMags[1]);
+    RTMemFree(pThread);
+    return NULL;
+}
+
+
+/**
+ * Returns the full magazines in the depot to the pages.
+ *
+ * Called when we're out of objects to give some back to other threads.
+ *
+ * @returns true if anything was returned, false if the depot was empty.
+ * @param   pThis               The memory cache instance.
+ */
+static bool rtMemCacheMagReapDepot(RTMEMCACHEINT *pThis)
+{
+    RTCritSectEnter(&pThis->CritSect);
+    PRTMEMCACHEMAG pHead = pThis->pDepotFull;
+    pThis->pDepotFull = NULL;
+    ASMAtomicWriteU32(&pThis->cDepotFull, 0);
+
+    bool const fReaped = pHead != NULL;
+    while (pHead)
+    {
+        PRTMEMCACHEMAG pMag = pHead;
+        pHead = pMag->pNext;
+        while (pMag->cRounds > 0)
+            rtMemCacheFreeObj(pThis, pMag->apvRounds[--pMag->cRounds]);
+        pMag->pNext = pThis->pDepotEmpty;
+        pThis->pDepotEmpty = pMag;
+        pThis->cDepotEmpty++;
+    }
+    RTCritSectLeave(&pThis->CritSect);
+    return fReaped;
+}
+
+
+/**
+ * Returns the objects in the magazines of idle threads to the pages.
+ *
+ * Called when we're out of objects and the depot didn't help.  Threads busy
+ * with their magazines (like the caller) are skipped.
+ *
+ * @returns true if anything was returned, false if not.
+ * @param   pThis               The memory cache instance.
+ */
+static bool rtMemCacheMagReapThreads(RTMEMCACHEINT *pThis)
+{
+    bool fReaped = false;
+    RTCritSectEnter(&pThis->CritSect);
+    for (PRTMEMCACHETHREAD pThread = pThis->pThreads; pThread; pThread = pThread->pNext)
+        if (ASMAtomicCmpXchgU32(&pThread->u32State, RTMEMCACHETHREAD_STATE_BUSY, RTMEMCACHETHREAD_STATE_ACTIVE))
+        {
+            PRTMEMCACHEMAG apMags[2] = { pThread->pLoaded, pThread->pPrevious };
+            for (unsigned i = 0; i < RT_ELEMENTS(apMags); i++)
+                while (apMags[i]->cRounds > 0)
+                {
+                    rtMemCacheFreeObj(pThis, apMags[i]->apvRounds[--apMags[i]->cRounds]);
+                    fReaped = true;
+                }
+            ASMAtomicWriteU32(&pThread->u32State, RTMEMCACHETHREAD_STATE_ACTIVE);
+        }
+    RTCritSectLeave(&pThis->CritSect);
+    return fReaped;
+}
+
+
+/**
+ * Allocates an object via the calling thread's magazines.
+ *
+ * @returns IPRT status code.
+ * @param   pThis               The memory cache instance.
+ * @param   pThread             The calling thread's magazine state.
+ * @param   ppvObj              Where to return the object.
+ */
+static int rtMemCacheMagAlloc(RTMEMCACHEINT *pThis, PRTMEMCACHETHREAD pThread, void **ppvObj)
+{
+    /*
+     * The loaded magazine is empty.  If the previous one has something in it,
+     * swap them.  (We check the loaded one again, so the caller can just
+     * call us for everything.)
+     */
+    PRTMEMCACHEMAG pMag = pThread->pLoaded;
+    if (RT_LIKELY(pMag->cRounds > 0))
+    {
+        pThread->cAllocMagHits++;
+        *ppvObj = pMag->apvRounds[--pMag->cRounds];
+        return VINF_SUCCESS;
+    }
+    if (pThread->pPrevious->cRounds > 0)
+    {
+        pThread->pLoaded   = pThread->pPrevious;
+        pThread->pPrevious = pMag;
+        pMag = pThread->pLoaded;
+        pThread->cAllocMagHits++;
+        *ppvObj = pMag->apvRounds[--pMag->cRounds];
+        return VINF_SUCCESS;
+    }
+
+    /*
+     * Both are empty, trade the previous one for a full one from the depot.
+     */
+    if (ASMAtomicUoReadU32(&pThis->cDepotFull) > 0)
+    {
+        RTCritSectEnter(&pThis->CritSect);
+        PRTMEMCACHEMAG pFull = pThis->pDepotFull;
+        if (pFull)
+        {
+            pThis->pDepotFull = pFull->pNext;
+            ASMAtomicWriteU32(&pThis->cDepotFull, pThis->cDepotFull - 1);
+            pThread->pPrevious->pNext = pThis->pDepotEmpty;
+            pThis->pDepotEmpty = pThread->pPrevious;
+            pThis->cDepotEmpty++;
+        }
+        RTCritSectLeave(&pThis->CritSect);
+        if (pFull)
+        {
+            pFull->pNext       = NULL;
+            pThread->pPrevious = pMag;
+            pThread->pLoaded   = pFull;
+            pThread->cAllocDepotHits++;
+            *ppvObj = pFull->apvRounds[--pFull->cRounds];
+            return VINF_SUCCESS;
+        }
+    }
+
+    /*
+     * Nothing cached, refill half the loaded magazine from the pages so the
+     * next few allocations are hits.  If the pages are exhausted, drain the
+     * depot back into them and try again, then do the same with the
+     * magazines of the other threads.
+     */
+    pThread->cAllocMisses++;
+    int rc = rtMemCacheAllocOne(pThis, ppvObj);
+    if (RT_FAILURE(rc) && rtMemCacheMagReapDepot(pThis))
+        rc = rtMemCacheAllocOne(pThis, ppvObj);
+    if (RT_FAILURE(rc) && pThis->fMagReap && rtMemCacheMagReapThreads(pThis))
+        rc = rtMemCacheAllocOne(pThis, ppvObj);
+    if (RT_SUCCESS(rc))
+        while (pMag->cRounds < RTMEMCACHE_MAG_ROUNDS / 2 - 1)
+        {
+            void *pvObj;
+            if (RT_FAILURE(rtMemCacheAllocOne(pThis, &pvObj)))
+                break;
+            pMag->apvRounds[pMag->cRounds++] = pvObj;
+        }
+    return rc;
+}
+
+
+RTDECL(int) RTMemCacheAllocEx(RTMEMCACHE hMemCache, void **ppvObj)
+{
+    RTMEMCACHEINT *pThis = hMemCache;
+    AssertPtrReturn(pThis, VERR_INVALID_PARAMETER);
+    AssertReturn(pThis->u32Magic == RTMEMCACHE_MAGIC, VERR_INVALID_PARAMETER);
+
+    if (pThis->fMagazines)
+    {
+        PRTMEMCACHETHREAD pThread = rtMemCacheMagGetThread(pThis);
+        if (RT_LIKELY(pThread))
+        {
+            if (!pThis->fMagReap)
+                return rtMemCacheMagAlloc(pThis, pThread, ppvObj);
+            if (ASMAtomicCmpXchgU32(&pThread->u32State, RTMEMCACHETHREAD_STATE_BUSY, RTMEMCACHETHREAD_STATE_ACTIVE))
+            {
+                int rc = rtMemCacheMagAlloc(pThis, pThread, ppvObj);
+                ASMAtomicWriteU32(&pThread->u32State, RTMEMCACHETHREAD_STATE_ACTIVE);
+                return rc;
+            }
+            /* Another thread is draining our magazines, go straight to the pages. */
+        }
+    }
+    return rtMemCacheAllocOne(pThis, ppvObj);
+}
+
+
 RTDECL(void *) RTMemCacheAlloc(RTMEMCACHE hMemCache)
 {
     void *pvObj;
@@ -544,18 +956,14 @@ static void rtMemCacheFreeList(RTMEMCACHEINT *pThis, PRTMEMCACHEFREEOBJ pHead)
 
 
 
-RTDECL(void) RTMemCacheFree(RTMEMCACHE hMemCache, void *pvObj)
+/**
+ * Frees one object to the free stack or the pages.
+ *
+ * @param   pThis               The memory cache.
+ * @param   pvObj               The memory object to free.
+ */
+static void rtMemCacheFreeObj(RTMEMCACHEINT *pThis, void *pvObj)
 {
-    if (!pvObj)
-        return;
-
-    RTMEMCACHEINT *pThis = hMemCache;
-    AssertPtrReturnVoid(pThis);
-    AssertReturnVoid(pThis->u32Magic == RTMEMCACHE_MAGIC);
-
-    AssertPtr(pvObj);
-    Assert(RT_ALIGN_P(pvObj, pThis->cbAlignment) == pvObj);
-
     if (!pThis->fUseFreeList)
         rtMemCacheFreeOne(pThis, pvObj);
     else
@@ -583,3 +991,292 @@ RTDECL(void) RTMemCacheFree(RTMEMCACHE hMemCache, void *pvObj)
     }
 }
 
+
+
+/**
+ * Frees an object via the calling thread's magazines.
+ *
+ * @param   pThis               The memory cache.
+ * @param   pThread             The calling thread's magazine state.
+ * @param   pvObj               The memory object to free.
+ */
+static void rtMemCacheMagFree(RTMEMCACHEINT *pThis, PRTMEMCACHETHREAD pThread, void *pvObj)
+{
+    PRTMEMCACHEMAG pMag = pThread->pLoaded;
+    if (RT_LIKELY(pMag->cRounds < RTMEMCACHE_MAG_ROUNDS))
+    {
+        pThread->cFreeMagHits++;
+        pMag->apvRounds[pMag->cRounds++] = pvObj;
+        return;
+    }
+    if (pThread->pPrevious->cRounds < RTMEMCACHE_MAG_ROUNDS)
+    {
+        pThread->pLoaded   = pThread->pPrevious;
+        pThread->pPrevious = pMag;
+        pMag = pThread->pLoaded;
+        pThread->cFreeMagHits++;
+        pMag->apvRounds[pMag->cRounds++] = pvObj;
+        return;
+    }
+
+    /*
+     * Both are full, hand the previous one to the depot in exchange for an
+     * empty one, unless the depot already holds enough.
+     */
+    if (ASMAtomicUoReadU32(&pThis->cDepotFull) < RTMEMCACHE_DEPOT_MAX_FULL)
+    {
+        PRTMEMCACHEMAG pEmpty = NULL;
+        RTCritSectEnter(&pThis->CritSect);
+        if (pThis->cDepotFull < RTMEMCACHE_DEPOT_MAX_FULL)
+        {
+            pEmpty = pThis->pDepotEmpty;
+            if (pEmpty)
+            {
+                pThis->pDepotEmpty = pEmpty->pNext;
+                pThis->cDepotEmpty--;
+            }
+            else
+                pEmpty = (PRTMEMCACHEMAG)RTMemAlloc(sizeof(*pEmpty));
+            if (pEmpty)
+            {
+                pThread->pPrevious->pNext = pThis->pDepotFull;
+                pThis->pDepotFull = pThread->pPrevious;
+                ASMAtomicWriteU32(&pThis->cDepotFull, pThis->cDepotFull + 1);
+            }
+        }
+        RTCritSectLeave(&pThis->CritSect);
+        if (pEmpty)
+        {
+            pEmpty->pNext      = NULL;
+            pEmpty->cRounds    = 1;
+            pEmpty->apvRounds[0] = pvObj;
+            pThread->pPrevious = pMag;
+            pThread->pLoaded   = pEmpty;
+            pThread->cFreeDepotHits++;
+            return;
+        }
+    }
+
+    /*
+     * The depot is full, return half the loaded magazine to the pages.
+     */
+    pThread->cFreeMisses++;
+    while (pMag->cRounds > RTMEMCACHE_MAG_ROUNDS / 2)
+        rtMemCacheFreeObj(pThis, pMag->apvRounds[--pMag->cRounds]);
+    pMag->apvRounds[pMag->cRounds++] = pvObj;
+}
+
+
+RTDECL(void) RTMemCacheFree(RTMEMCACHE hMemCache, void *pvObj)
+{
+    if (!pvObj)
+        return;
+
+    RTMEMCACHEINT *pThis = hMemCache;
+    AssertPtrReturnVoid(pThis);
+    AssertReturnVoid(pThis->u32Magic == RTMEMCACHE_MAGIC);
+
+    AssertPtr(pvObj);
+    Assert(RT_ALIGN_P(pvObj, pThis->cbAlignment) == pvObj);
+
+    if (pThis->fMagazines)
+    {
+        PRTMEMCACHETHREAD pThread = rtMemCacheMagGetThread(pThis);
+        if (RT_LIKELY(pThread))
+        {
+            if (!pThis->fMagReap)
+            {
+                rtMemCacheMagFree(pThis, pThread, pvObj);
+                return;
+            }
+            if (ASMAtomicCmpXchgU32(&pThread->u32State, RTMEMCACHETHREAD_STATE_BUSY, RTMEMCACHETHREAD_STATE_ACTIVE))
+            {
+                rtMemCacheMagFree(pThis, pThread, pvObj);
+                ASMAtomicWriteU32(&pThread->u32State, RTMEMCACHETHREAD_STATE_ACTIVE);
+                return;
+            }
+        }
+    }
+    rtMemCacheFreeObj(pThis, pvObj);
+}
+
+
+/**
+ * Returns the objects in a thread's magazines to the pages and frees the
+ * magazines.
+ *
+ * @param   pThis               The memory cache.
+ * @param   pThread             The thread state.
+ */
+static void rtMemCacheMagFlushThread(RTMEMCACHEINT *pThis, PRTMEMCACHETHREAD pThread)
+{
+    PRTMEMCACHEMAG apMags[2] = { pThread->pLoaded, pThread->pPrevious };
+    for (unsigned i = 0; i < RT_ELEMENTS(apMags); i++)
+    {
+        PRTMEMCACHEMAG pMag = apMags[i];
+        while (pMag->cRounds > 0)
+            rtMemCacheFreeObj(pThis, pMag->apvRounds[--pMag->cRounds]);
+        RTMemFree(pMag);
+    }
+    pThread->pLoaded = pThread->pPrevious = NULL;
+
+    pThis->RetiredStats.cAllocMagHits   += pThread->cAllocMagHits;
+    pThis->RetiredStats.cAllocDepotHits += pThread->cAllocDepotHits;
+    pThis->RetiredStats.cAllocMisses    += pThread->cAllocMisses;
+    pThis->RetiredStats.cFreeMagHits    += pThread->cFreeMagHits;
+    pThis->RetiredStats.cFreeDepotHits  += pThread->cFreeDepotHits;
+    pThis->RetiredStats.cFreeMisses     += pThread->cFreeMisses;
+}
+
+
+/**
+ * @callback_method_impl{FNRTONCE, Allocates the per-thread state list TLS entry.}
+ */
+static DECLCALLBACK(int) rtMemCacheMagInitOnce(void *pvUser)
+{
+    RT_NOREF_PV(pvUser);
+
+    /* Not all hosts can call us when a thread terminates. */
+    int rc = RTTlsAllocEx(&g_iMemCacheThreadTls, rtMemCacheMagThreadDtor);
+    if (RT_SUCCESS(rc))
+        g_fMemCacheThreadDtor = true;
+    else if (rc == VERR_NOT_SUPPORTED)
+        rc = VINF_SUCCESS;
+    return rc;
+}
+
+
+/**
+ * @callback_method_impl{FNRTTLSDTOR, Returns a terminating thread's magazines
+ *                      and frees its states.}
+ */
+static DECLCALLBACK(void) rtMemCacheMagThreadDtor(void *pvValue)
+{
+    PRTMEMCACHETHREAD pNext = (PRTMEMCACHETHREAD)pvValue;
+    while (pNext)
+    {
+        PRTMEMCACHETHREAD pThread = pNext;
+        pNext = pThread->pNextInThread;
+
+        /* Wait for anybody draining our magazines to finish. */
+        uint32_t u32State;
+        while (   (u32State = ASMAtomicReadU32(&pThread->u32State)) != RTMEMCACHETHREAD_STATE_DESTROYING
+               && !ASMAtomicCmpXchgU32(&pThread->u32State, RTMEMCACHETHREAD_STATE_EXITING, RTMEMCACHETHREAD_STATE_ACTIVE))
+            RTThreadYield();
+
+        if (u32State != RTMEMCACHETHREAD_STATE_DESTROYING)
+        {
+            RTMEMCACHEINT *pThis = pThread->pCache;
+            RTCritSectEnter(&pThis->CritSect);
+
+            rtMemCacheMagFlushThread(pThis, pThread);
+            PRTMEMCACHETHREAD *ppPrev = &pThis->pThreads;
+            while (*ppPrev != pThread)
+                ppPrev = &(*ppPrev)->pNext;
+            *ppPrev = pThread->pNext;
+            pThis->cThreads--;
+
+            RTCritSectLeave(&pThis->CritSect);
+        }
+        /* else: RTMemCacheDestroy got the magazines and left the rest to us. */
+        RTMemFree(pThread);
+    }
+}
+
+
+/**
+ * Frees the magazine layer when destroying the cache.
+ *
+ * The objects don't need returning to the pages as RTMemCacheDestroy takes
+ * care of that, so we only have to free the magazines.  The thread states
+ * are left to their threads when they can clean up after themselves.
+ *
+ * @param   pThis               The memory cache.
+ */
+static void rtMemCacheMagDestroy(RTMEMCACHEINT *pThis)
+{
+    RTTlsFree(pThis->iTls);
+    pThis->iTls = NIL_RTTLS;
+
+    /* Take the thread states, waiting for any terminating threads to finish. */
+    RTCritSectEnter(&pThis->CritSect);
+    for (;;)
+    {
+        bool fBusy = false;
+        PRTMEMCACHETHREAD *ppPrev = &pThis->pThreads;
+        PRTMEMCACHETHREAD  pThread;
+        while ((pThread = *ppPrev) != NULL)
+        {
+            /* The thread frees the structure once it sees DESTROYING, so pick
+               up what we need first.  Nobody else touches these fields while
+               the cache is being destroyed (the reaper needs CritSect). */
+            PRTMEMCACHETHREAD const pNext     = pThread->pNext;
+            PRTMEMCACHEMAG const    pLoaded   = pThread->pLoaded;
+            PRTMEMCACHEMAG const    pPrevious = pThread->pPrevious;
+            if (ASMAtomicCmpXchgU32(&pThread->u32State, RTMEMCACHETHREAD_STATE_DESTROYING, RTMEMCACHETHREAD_STATE_ACTIVE))
+            {
+                *ppPrev = pNext;
+                pThis->cThreads--;
+                RTMemFree(pLoaded);
+                RTMemFree(pPrevious);
+                if (!g_fMemCacheThreadDtor)
+                    RTMemFree(pThread);
+            }
+            else
+            {
+                fBusy = true;
+                ppPrev = &pThread->pNext;
+            }
+        }
+        if (!fBusy)
+            break;
+        RTCritSectLeave(&pThis->CritSect);
+        RTThreadYield();
+        RTCritSectEnter(&pThis->CritSect);
+    }
+
+    PRTMEMCACHEMAG apLists[2] = { pThis->pDepotFull, pThis->pDepotEmpty };
+    pThis->pDepotFull  = pThis->pDepotEmpty = NULL;
+    pThis->cDepotFull  = pThis->cDepotEmpty = 0;
+    RTCritSectLeave(&pThis->CritSect);
+
+    for (unsigned i = 0; i < RT_ELEMENTS(apLists); i++)
+        while (apLists[i])
+        {
+            PRTMEMCACHEMAG pMag = apLists[i];
+            apLists[i] = pMag->pNext;
+            RTMemFree(pMag);
+        }
+}
+
+
+RTDECL(int) RTMemCacheQueryStats(RTMEMCACHE hMemCache, PRTMEMCACHESTATS pStats)
+{
+    RTMEMCACHEINT *pThis = hMemCache;
+    AssertPtrReturn(pThis, VERR_INVALID_HANDLE);
+    AssertReturn(pThis->u32Magic == RTMEMCACHE_MAGIC, VERR_INVALID_HANDLE);
+    AssertPtrReturn(pStats, VERR_INVALID_POINTER);
+
+    RTCritSectEnter(&pThis->CritSect);
+
+    *pStats = pThis->RetiredStats;
+    for (PRTMEMCACHETHREAD pThread = pThis->pThreads; pThread; pThread = pThread->pNext)
+    {
+        /* Unlocked reads of the owner's counters; close enough for statistics. */
+        pStats->cAllocMagHits   += pThread->cAllocMagHits;
+        pStats->cAllocDepotHits += pThread->cAllocDepotHits;
+        pStats->cAllocMisses    += pThread->cAllocMisses;
+        pStats->cFreeMagHits    += pThread->cFreeMagHits;
+        pStats->cFreeDepotHits  += pThread->cFreeDepotHits;
+        pStats->cFreeMisses     += pThread->cFreeMisses;
+    }
+    pStats->cTotal      = ASMAtomicReadU32(&pThis->cTotal);
+    pStats->cFree       = (uint32_t)RT_MAX(ASMAtomicReadS32(&pThis->cFree), 0);
+    pStats->cDepotFull  = pThis->cDepotFull;
+    pStats->cDepotEmpty = pThis->cDepotEmpty;
+    pStats->cThreads    = pThis->cThreads;
+    pStats->u32Reserved = 0;
+
+    RTCritSectLeave(&pThis->CritSect);
+    return VINF_SUCCESS;
+}
@@ -44,6 +44,8 @@
 #include <iprt/asm.h>
 #include <iprt/string.h>
 
+#include "internal/sha.h"
+
 
 /** Our private context structure. */
 typedef struct RTSHA1ALTPRIVATECTX
@@ -68,6 +70,14 @@ AssertCompile(RT_SIZEOFMEMB(RTSHA1CONTEXT, abPadding) >= RT_SIZEOFMEMB(RTSHA1CON
 AssertCompileMemberSize(RTSHA1ALTPRIVATECTX, auH, RTSHA1_HASH_SIZE);
 
 
+/*********************************************************************************************************************************
+*   Global Variables                                                                                                             *
+*********************************************************************************************************************************/
+#ifdef RTSHA_WITH_SHANI
+/** RTSHA_F_XXX for the host CPU, 0 if not yet determined. */
+static uint32_t volatile g_fSha1Cpu = 0;
+#endif
+
 
 
 RTDECL(void) RTSha1Init(PRTSHA1CONTEXT pCtx)
@@ -366,6 +376,103 @@ static void rtSha1BlockProcess(PRTSHA1CONTEXT pCtx)
     pCtx->AltPrivate.auH[4] += uE;
 }
 
+#ifdef RTSHA_WITH_SHANI
+/**
+ * Processes one or more blocks using the SHA extensions.
+ *
+ * This works directly on the big endian input and doesn't touch the auW array.
+ *
+ * @param   pauH                The 5 hash values.
+ * @param   pbBlocks            The blocks, no alignment requirements.
+ * @param   cBlocks             The number of blocks to process.
+ */
+RTSHA_SHANI_FN static void rtSha1BlocksShaNi(uint32_t *pauH, uint8_t const *pbBlocks, size_t cBlocks)
+{
+    __m128i const uBSwapMask = _mm_set_epi64x(INT64_C(0x0001020304050607), INT64_C(0x08090a0b0c0d0e0f));
+    __m128i       uAbcd      = _mm_shuffle_epi32(_mm_loadu_si128((__m128i const *)&pauH[0]), 0x1b);
+    __m128i       uE0        = _mm_set_epi32((int)pauH[4], 0, 0, 0);
+    __m128i       uE1;
+
+/** Does four rounds with the message words in a_uMsg0 and advances the
+ *  message schedule: finishes a_uMsg1 and continues a_uMsg2 and a_uMsg3.
+ *  a_uECur holds E for these rounds, a_uENext receives it for the next four. */
+# define RTSHA1_SHANI_4ROUNDS(a_iQuad, a_uECur, a_uENext, a_uMsg0, a_uMsg1, a_uMsg2, a_uMsg3) \
+        do { \
+            if ((a_iQuad) == 0) \
+                a_uECur = _mm_add_epi32(a_uECur, a_uMsg0); \
+            else \
+                a_uECur = _mm_sha1nexte_epu32(a_uECur, a_uMsg0); \
+            a_uENext = uAbcd; \
+            if ((a_iQuad) + 1 >= 4 && (a_iQuad) + 1 < 20) \
+                a_uMsg1 = _mm_sha1msg2_epu32(a_uMsg1, a_uMsg0); \
+            uAbcd = _mm_sha1rnds4_epu32(uAbcd, a_uECur, (a_iQuad) / 5); \
+            if ((a_iQuad) + 3 >= 4 && (a_iQuad) + 3 < 20) \
+                a_uMsg3 = _mm_sha1msg1_epu32(a_uMsg3, a_uMsg0); \
+            if ((a_iQuad) + 2 >= 4 && (a_iQuad) + 2 < 20) \
+                a_uMsg2 = _mm_xor_si128(a_uMsg2, a_uMsg0); \
+        } while (0)
+
+    while (cBlocks-- > 0)
+    {
+        __m128i const uSavedAbcd = uAbcd;
+        __m128i const uSavedE0   = uE0;
+
+        __m128i uMsg0 = _mm_shuffle_epi8(_mm_loadu_si128((__m128i const *)&pbBlocks[0]),  uBSwapMask);
+        __m128i uMsg1 = _mm_shuffle_epi8(_mm_loadu_si128((__m128i const *)&pbBlocks[16]), uBSwapMask);
+        __m128i uMsg2 = _mm_shuffle_epi8(_mm_loadu_si128((__m128i const *)&pbBlocks[32]), uBSwapMask);
+        __m128i uMsg3 = _mm_shuffle_epi8(_mm_loadu_si128((__m128i const *)&pbBlocks[48]), uBSwapMask);
+
+        RTSHA1_SHANI_4ROUNDS( 0, uE0, uE1, uMsg0, uMsg1, uMsg2, uMsg3);
+        RTSHA1_SHANI_4ROUNDS( 1, uE1, uE0, uMsg1, uMsg2, uMsg3, uMsg0);
+        RTSHA1_SHANI_4ROUNDS( 2, uE0, uE1, uMsg2, uMsg3, uMsg0, uMsg1);
+        RTSHA1_SHANI_4ROUNDS( 3, uE1, uE0, uMsg3, uMsg0, uMsg1, uMsg2);
+        RTSHA1_SHANI_4ROUNDS( 4, uE0, uE1, uMsg0, uMsg1, uMsg2, uMsg3);
+        RTSHA1_SHANI_4ROUNDS( 5, uE1, uE0, uMsg1, uMsg2, uMsg3, uMsg0);
+        RTSHA1_SHANI_4ROUNDS( 6, uE0, uE1, uMsg2, uMsg3, uMsg0, uMsg1);
+        RTSHA1_SHANI_4ROUNDS( 7, uE1, uE0, uMsg3, uMsg0, uMsg1, uMsg2);
+        RTSHA1_SHANI_4ROUNDS( 8, uE0, uE1, uMsg0, uMsg1, uMsg2, uMsg3);
+        RTSHA1_SHANI_4ROUNDS( 9, uE1, uE0, uMsg1, uMsg2, uMsg3, uMsg0);
+        RTSHA1_SHANI_4ROUNDS(10, uE0, uE1, uMsg2, uMsg3, uMsg0, uMsg1);
+        RTSHA1_SHANI_4ROUNDS(11, uE1, uE0, uMsg3, uMsg0, uMsg1, uMsg2);
+        RTSHA1_SHANI_4ROUNDS(12, uE0, uE1, uMsg0, uMsg1, uMsg2, uMsg3);
+        RTSHA1_SHANI_4ROUNDS(13, uE1, uE0, uMsg1, uMsg2, uMsg3, uMsg0);
+        RTSHA1_SHANI_4ROUNDS(14, uE0, uE1, uMsg2, uMsg3, uMsg0, uMsg1);
+        RTSHA1_SHANI_4ROUNDS(15, uE1, uE0, uMsg3, uMsg0, uMsg1, uMsg2);
+        RTSHA1_SHANI_4ROUNDS(16, uE0, uE1, uMsg0, uMsg1, uMsg2, uMsg3);
+        RTSHA1_SHANI_4ROUNDS(17, uE1, uE0, uMsg1, uMsg2, uMsg3, uMsg0);
+        RTSHA1_SHANI_4ROUNDS(18, uE0, uE1, uMsg2, uMsg3, uMsg0, uMsg1);
+        RTSHA1_SHANI_4ROUNDS(19, uE1, uE0, uMsg3, uMsg0, uMsg1, uMsg2);
+
+        uE0   = _mm_sha1nexte_epu32(uE0, uSavedE0);
+        uAbcd = _mm_add_epi32(uAbcd, uSavedAbcd);
+        pbBlocks += RTSHA1_BLOCK_SIZE;
+    }
+# undef RTSHA1_SHANI_4ROUNDS
+
+    _mm_storeu_si128((__m128i *)&pauH[0], _mm_shuffle_epi32(uAbcd, 0x1b));
+    pauH[4] = (uint32_t)_mm_extract_epi32(uE0, 3);
+}
+#endif /* RTSHA_WITH_SHANI */
+
+
+/**
+ * Processes the block buffered in the auW array.
+ *
+ * @param   pCtx                The SHA1 context.
+ */
+DECLINLINE(void) rtSha1BlockProcessBuffered(PRTSHA1CONTEXT pCtx)
+{
+#ifdef RTSHA_WITH_SHANI
+    if (rtShaHasShaNi(&g_fSha1Cpu))
+        rtSha1BlocksShaNi(&pCtx->AltPrivate.auH[0], (uint8_t const *)&pCtx->AltPrivate.auW[0], 1);
+    else
+#endif
+    {
+        rtSha1BlockInitBuffered(pCtx);
+        rtSha1BlockProcess(pCtx);
+    }
+}
+
 
 RTDECL(void) RTSha1Update(PRTSHA1CONTEXT pCtx, const void *pvBuf, size_t cbBuf)
 {
@@ -386,8 +493,7 @@ RTDECL(void) RTSha1Update(PRTSHA1CONTEXT pCtx, const void *pvBuf, size_t cbBuf)
             pbBuf += cbMissing;
             cbBuf -= cbMissing;
 
-            rtSha1BlockInitBuffered(pCtx);
-            rtSha1BlockProcess(pCtx);
+            rtSha1BlockProcessBuffered(pCtx);
         }
         else
         {
@@ -397,6 +503,21 @@ RTDECL(void) RTSha1Update(PRTSHA1CONTEXT pCtx, const void *pvBuf, size_t cbBuf)
         }
     }
 
+#ifdef RTSHA_WITH_SHANI
+    if (cbBuf >= RTSHA1_BLOCK_SIZE && rtShaHasShaNi(&g_fSha1Cpu))
+    {
+        /*
+         * The SHA extensions do all full blocks in one go, alignment doesn't matter.
+         */
+        size_t const cbBlocks = cbBuf & ~(size_t)(RTSHA1_BLOCK_SIZE - 1U);
+        rtSha1BlocksShaNi(&pCtx->AltPrivate.auH[0], pbBuf, cbBlocks / RTSHA1_BLOCK_SIZE);
+
+        pCtx->AltPrivate.cbMessage += cbBlocks;
+        pbBuf += cbBlocks;
+        cbBuf -= cbBlocks;
+    }
+    else
+#endif
     if (!((uintptr_t)pbBuf & 3))
     {
         /*
@@ -469,8 +590,7 @@ static void rtSha1FinalInternal(PRTSHA1CONTEXT pCtx)
     /*
      * Process the last buffered block constructed/completed above.
      */
-    rtSha1BlockInitBuffered(pCtx);
-    rtSha1BlockProcess(pCtx);
+    rtSha1BlockProcessBuffered(pCtx);
 
     /*
      * Convert the byte order of the hash words and we're done.
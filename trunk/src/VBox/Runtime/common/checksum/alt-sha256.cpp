@@ -44,6 +44,8 @@
 #include <iprt/asm.h>
 #include <iprt/string.h>
 
+#include "internal/sha.h"
+
 
 /** Our private context structure. */
 typedef struct RTSHA256ALTPRIVATECTX
@@ -70,7 +72,7 @@ AssertCompileMemberSize(RTSHA256ALTPRIVATECTX, auH, RTSHA256_HASH_SIZE);
 /*********************************************************************************************************************************
 *   Global Variables                                                                                                             *
 *********************************************************************************************************************************/
-#ifndef RTSHA256_UNROLLED
+#if !defined(RTSHA256_UNROLLED) || defined(RTSHA_WITH_SHANI)
 /** The K constants */
 static uint32_t const g_auKs[] =
 {
@@ -91,7 +93,12 @@ static uint32_t const g_auKs[] =
     UINT32_C(0x748f82ee), UINT32_C(0x78a5636f), UINT32_C(0x84c87814), UINT32_C(0x8cc70208),
     UINT32_C(0x90befffa), UINT32_C(0xa4506ceb), UINT32_C(0xbef9a3f7), UINT32_C(0xc67178f2),
 };
-#endif /* !RTSHA256_UNROLLED */
+#endif /* !RTSHA256_UNROLLED || RTSHA_WITH_SHANI */
+
+#ifdef RTSHA_WITH_SHANI
+/** RTSHA_F_XXX for the host CPU, 0 if not yet determined. */
+static uint32_t volatile g_fSha256Cpu = 0;
+#endif
 
 
 
@@ -457,6 +464,97 @@ static void rtSha256BlockProcess(PRTSHA256CONTEXT pCtx)
     pCtx->AltPrivate.auH[7] += uH;
 }
 
+#ifdef RTSHA_WITH_SHANI
+/**
+ * Processes one or more blocks using the SHA extensions.
+ *
+ * This works directly on the big endian input and doesn't touch the auW array.
+ *
+ * @param   pauH                The 8 hash values.
+ * @param   pbBlocks            The blocks, no alignment requirements.
+ * @param   cBlocks             The number of blocks to process.
+ */
+RTSHA_SHANI_FN static void rtSha256BlocksShaNi(uint32_t *pauH, uint8_t const *pbBlocks, size_t cBlocks)
+{
+    __m128i const uBSwapMask = _mm_set_epi64x(INT64_C(0x0c0d0e0f08090a0b), INT64_C(0x0405060700010203));
+
+    /* Rearrange the hash values into the ABEF and CDGH order the instructions want. */
+    __m128i uTmp    = _mm_shuffle_epi32(_mm_loadu_si128((__m128i const *)&pauH[0]), 0xb1); /* CDAB */
+    __m128i uState1 = _mm_shuffle_epi32(_mm_loadu_si128((__m128i const *)&pauH[4]), 0x1b); /* EFGH */
+    __m128i uState0 = _mm_alignr_epi8(uTmp, uState1, 8);                                   /* ABEF */
+    uState1 = _mm_blend_epi16(uState1, uTmp, 0xf0);                                        /* CDGH */
+
+/** Does four rounds with the message words in a_uMsg. */
+# define RTSHA256_SHANI_4ROUNDS(a_iQuad, a_uMsg) \
+        do { \
+            __m128i uMsgK = _mm_add_epi32(a_uMsg, _mm_loadu_si128((__m128i const *)&g_auKs[(a_iQuad) * 4])); \
+            uState1 = _mm_sha256rnds2_epu32(uState1, uState0, uMsgK); \
+            uState0 = _mm_sha256rnds2_epu32(uState0, uState1, _mm_shuffle_epi32(uMsgK, 0x0e)); \
+        } while (0)
+/** Calculates the next four message words into a_uMsg0 from the previous 16. */
+# define RTSHA256_SHANI_SCHEDULE(a_uMsg0, a_uMsg1, a_uMsg2, a_uMsg3) \
+        a_uMsg0 = _mm_sha256msg2_epu32(_mm_add_epi32(_mm_sha256msg1_epu32(a_uMsg0, a_uMsg1), \
+                                                     _mm_alignr_epi8(a_uMsg3, a_uMsg2, 4)), a_uMsg3)
+
+    while (cBlocks-- > 0)
+    {
+        __m128i const uSavedState0 = uState0;
+        __m128i const uSavedState1 = uState1;
+
+        __m128i uMsg0 = _mm_shuffle_epi8(_mm_loadu_si128((__m128i const *)&pbBlocks[0]),  uBSwapMask);
+        __m128i uMsg1 = _mm_shuffle_epi8(_mm_loadu_si128((__m128i const *)&pbBlocks[16]), uBSwapMask);
+        __m128i uMsg2 = _mm_shuffle_epi8(_mm_loadu_si128((__m128i const *)&pbBlocks[32]), uBSwapMask);
+        __m128i uMsg3 = _mm_shuffle_epi8(_mm_loadu_si128((__m128i const *)&pbBlocks[48]), uBSwapMask);
+        RTSHA256_SHANI_4ROUNDS(0, uMsg0);
+        RTSHA256_SHANI_4ROUNDS(1, uMsg1);
+        RTSHA256_SHANI_4ROUNDS(2, uMsg2);
+        RTSHA256_SHANI_4ROUNDS(3, uMsg3);
+        for (unsigned iQuad = 4; iQuad < 16; iQuad += 4)
+        {
+            RTSHA256_SHANI_SCHEDULE(uMsg0, uMsg1, uMsg2, uMsg3);
+            RTSHA256_SHANI_4ROUNDS(iQuad + 0, uMsg0);
+            RTSHA256_SHANI_SCHEDULE(uMsg1, uMsg2, uMsg3, uMsg0);
+            RTSHA256_SHANI_4ROUNDS(iQuad + 1, uMsg1);
+            RTSHA256_SHANI_SCHEDULE(uMsg2, uMsg3, uMsg0, uMsg1);
+            RTSHA256_SHANI_4ROUNDS(iQuad + 2, uMsg2);
+            RTSHA256_SHANI_SCHEDULE(uMsg3, uMsg0, uMsg1, uMsg2);
+            RTSHA256_SHANI_4ROUNDS(iQuad + 3, uMsg3);
+        }
+
+        uState0 = _mm_add_epi32(uState0, uSavedState0);
+        uState1 = _mm_add_epi32(uState1, uSavedState1);
+        pbBlocks += RTSHA256_BLOCK_SIZE;
+    }
+# undef RTSHA256_SHANI_4ROUNDS
+# undef RTSHA256_SHANI_SCHEDULE
+
+    /* Back to the A..H order. */
+    uTmp    = _mm_shuffle_epi32(uState0, 0x1b);                 /* FEBA */
+    uState1 = _mm_shuffle_epi32(uState1, 0xb1);                 /* DCHG */
+    _mm_storeu_si128((__m128i *)&pauH[0], _mm_blend_epi16(uTmp, uState1, 0xf0)); /* DCBA */
+    _mm_storeu_si128((__m128i *)&pauH[4], _mm_alignr_epi8(uState1, uTmp, 8));    /* HGFE */
+}
+#endif /* RTSHA_WITH_SHANI */
+
+
+/**
+ * Processes the block buffered in the auW array.
+ *
+ * @param   pCtx                The SHA-256 context.
+ */
+DECLINLINE(void) rtSha256BlockProcessBuffered(PRTSHA256CONTEXT pCtx)
+{
+#ifdef RTSHA_WITH_SHANI
+    if (rtShaHasShaNi(&g_fSha256Cpu))
+        rtSha256BlocksShaNi(&pCtx->AltPrivate.auH[0], (uint8_t const *)&pCtx->AltPrivate.auW[0], 1);
+    else
+#endif
+    {
+        rtSha256BlockInitBuffered(pCtx);
+        rtSha256BlockProcess(pCtx);
+    }
+}
+
 
 RTDECL(void) RTSha256Update(PRTSHA256CONTEXT pCtx, const void *pvBuf, size_t cbBuf)
 {
@@ -477,8 +575,7 @@ RTDECL(void) RTSha256Update(PRTSHA256CONTEXT pCtx, const void *pvBuf, size_t cbB
             pbBuf += cbMissing;
             cbBuf -= cbMissing;
 
-            rtSha256BlockInitBuffered(pCtx);
-            rtSha256BlockProcess(pCtx);
+            rtSha256BlockProcessBuffered(pCtx);
         }
         else
         {
@@ -488,6 +585,21 @@ RTDECL(void) RTSha256Update(PRTSHA256CONTEXT pCtx, const void *pvBuf, size_t cbB
         }
     }
 
+#ifdef RTSHA_WITH_SHANI
+    if (cbBuf >= RTSHA256_BLOCK_SIZE && rtShaHasShaNi(&g_fSha256Cpu))
+    {
+        /*
+         * The SHA extensions do all full blocks in one go, alignment doesn't matter.
+         */
+        size_t const cbBlocks = cbBuf & ~(size_t)(RTSHA256_BLOCK_SIZE - 1U);
+        rtSha256BlocksShaNi(&pCtx->AltPrivate.auH[0], pbBuf, cbBlocks / RTSHA256_BLOCK_SIZE);
+
+        pCtx->AltPrivate.cbMessage += cbBlocks;
+        pbBuf += cbBlocks;
+        cbBuf -= cbBlocks;
+    }
+    else
+#endif
     if (!((uintptr_t)pbBuf & (sizeof(void *) - 1)))
     {
         /*
@@ -566,8 +678,7 @@ static void rtSha256FinalInternal(PRTSHA256CONTEXT pCtx)
     /*
      * Process the last buffered block constructed/completed above.
      */
-    rtSha256BlockInitBuffered(pCtx);
-    rtSha256BlockProcess(pCtx);
+    rtSha256BlockProcessBuffered(pCtx);
 
     /*
      * Convert the byte order of the hash words and we're done.
@@ -36,12 +36,14 @@
 #include <iprt/crc.h>
 #include "internal/iprt.h"
 
+#include "internal/crc.h"
+
 
 /*********************************************************************************************************************************
 *   Global Variables                                                                                                             *
 *********************************************************************************************************************************/
 /**
- * Lookup table (precomputed CRC64 values for each 8 bit string) computation
+ * Lookup tables (precomputed CRC64 values for each 8 bit string) computation
  * takes into account the fact that the reverse polynom has zeros in lower 8 bits:
  *
  * @code
@@ -77,77 +79,625 @@
  *    }
  * @endcode
  *
- * @remark  Since the lookup table elements have 0 in the lower 32 bit word,
- *          the 32 bit assembler implementation of CRC64Process can be optimized,
- *          avoiding at least one 'xor' operation.
+ * The remaining seven tables are for slicing-by-8, table N holding the effect
+ * of a byte followed by N zero bytes.
  */
-static const uint64_t g_au64CRC64[] =
+static uint64_t const g_aau64Crc64[8][256] =
+{
+    {
+        0x0000000000000000ULL, 0x01B0000000000000ULL, 0x0360000000000000ULL, 0x02D0000000000000ULL,
+        0x06C0000000000000ULL, 0x0770000000000000ULL, 0x05A0000000000000ULL, 0x0410000000000000ULL,
+        0x0D80000000000000ULL, 0x0C30000000000000ULL, 0x0EE0000000000000ULL, 0x0F50000000000000ULL,
+        0x0B40000000000000ULL, 0x0AF0000000000000ULL, 0x0820000000000000ULL, 0x0990000000000000ULL,
+        0x1B00000000000000ULL, 0x1AB0000000000000ULL, 0x1860000000000000ULL, 0x19D0000000000000ULL,
+        0x1DC0000000000000ULL, 0x1C70000000000000ULL, 0x1EA0000000000000ULL, 0x1F10000000000000ULL,
+        0x1680000000000000ULL, 0x1730000000000000ULL, 0x15E0000000000000ULL, 0x1450000000000000ULL,
+        0x1040000000000000ULL, 0x11F0000000000000ULL, 0x1320000000000000ULL, 0x1290000000000000ULL,
+        0x3600000000000000ULL, 0x37B0000000000000ULL, 0x3560000000000000ULL, 0x34D0000000000000ULL,
+        0x30C0000000000000ULL, 0x3170000000000000ULL, 0x33A0000000000000ULL, 0x3210000000000000ULL,
+        0x3B80000000000000ULL, 0x3A30000000000000ULL, 0x38E0000000000000ULL, 0x3950000000000000ULL,
+        0x3D40000000000000ULL, 0x3CF0000000000000ULL, 0x3E20000000000000ULL, 0x3F90000000000000ULL,
+        0x2D00000000000000ULL, 0x2CB0000000000000ULL, 0x2E60000000000000ULL, 0x2FD0000000000000ULL,
+        0x2BC0000000000000ULL, 0x2A70000000000000ULL, 0x28A0000000000000ULL, 0x2910000000000000ULL,
+        0x2080000000000000ULL, 0x2130000000000000ULL, 0x23E0000000000000ULL, 0x2250000000000000ULL,
+        0x2640000000000000ULL, 0x27F0000000000000ULL, 0x2520000000000000ULL, 0x2490000000000000ULL,
+        0x6C00000000000000ULL, 0x6DB0000000000000ULL, 0x6F60000000000000ULL, 0x6ED0000000000000ULL,
+        0x6AC0000000000000ULL, 0x6B70000000000000ULL, 0x69A0000000000000ULL, 0x6810000000000000ULL,
+        0x6180000000000000ULL, 0x6030000000000000ULL, 0x62E0000000000000ULL, 0x6350000000000000ULL,
+        0x6740000000000000ULL, 0x66F0000000000000ULL, 0x6420000000000000ULL, 0x6590000000000000ULL,
+        0x7700000000000000ULL, 0x76B0000000000000ULL, 0x7460000000000000ULL, 0x75D0000000000000ULL,
+        0x71C0000000000000ULL, 0x7070000000000000ULL, 0x72A0000000000000ULL, 0x7310000000000000ULL,
+        0x7A80000000000000ULL, 0x7B30000000000000ULL, 0x79E0000000000000ULL, 0x7850000000000000ULL,
+        0x7C40000000000000ULL, 0x7DF0000000000000ULL, 0x7F20000000000000ULL, 0x7E90000000000000ULL,
+        0x5A00000000000000ULL, 0x5BB0000000000000ULL, 0x5960000000000000ULL, 0x58D0000000000000ULL,
+        0x5CC0000000000000ULL, 0x5D70000000000000ULL, 0x5FA0000000000000ULL, 0x5E10000000000000ULL,
+        0x5780000000000000ULL, 0x5630000000000000ULL, 0x54E0000000000000ULL, 0x5550000000000000ULL,
+        0x5140000000000000ULL, 0x50F0000000000000ULL, 0x5220000000000000ULL, 0x5390000000000000ULL,
+        0x4100000000000000ULL, 0x40B0000000000000ULL, 0x4260000000000000ULL, 0x43D0000000000000ULL,
+        0x47C0000000000000ULL, 0x4670000000000000ULL, 0x44A0000000000000ULL, 0x4510000000000000ULL,
+        0x4C80000000000000ULL, 0x4D30000000000000ULL, 0x4FE0000000000000ULL, 0x4E50000000000000ULL,
+        0x4A40000000000000ULL, 0x4BF0000000000000ULL, 0x4920000000000000ULL, 0x4890000000000000ULL,
+        0xD800000000000000ULL, 0xD9B0000000000000ULL, 0xDB60000000000000ULL, 0xDAD0000000000000ULL,
+        0xDEC0000000000000ULL, 0xDF70000000000000ULL, 0xDDA0000000000000ULL, 0xDC10000000000000ULL,
+        0xD580000000000000ULL, 0xD430000000000000ULL, 0xD6E0000000000000ULL, 0xD750000000000000ULL,
+        0xD340000000000000ULL, 0xD2F0000000000000ULL, 0xD020000000000000ULL, 0xD190000000000000ULL,
+        0xC300000000000000ULL, 0xC2B0000000000000ULL, 0xC060000000000000ULL, 0xC1D0000000000000ULL,
+        0xC5C0000000000000ULL, 0xC470000000000000ULL, 0xC6A0000000000000ULL, 0xC710000000000000ULL,
+        0xCE80000000000000ULL, 0xCF30000000000000ULL, 0xCDE0000000000000ULL, 0xCC50000000000000ULL,
+        0xC840000000000000ULL, 0xC9F0000000000000ULL, 0xCB20000000000000ULL, 0xCA90000000000000ULL,
+        0xEE00000000000000ULL, 0xEFB0000000000000ULL, 0xED60000000000000ULL, 0xECD0000000000000ULL,
+        0xE8C0000000000000ULL, 0xE970000000000000ULL, 0xEBA0000000000000ULL, 0xEA10000000000000ULL,
+        0xE380000000000000ULL, 0xE230000000000000ULL, 0xE0E0000000000000ULL, 0xE150000000000000ULL,
+        0xE540000000000000ULL, 0xE4F0000000000000ULL, 0xE620000000000000ULL, 0xE790000000000000ULL,
+        0xF500000000000000ULL, 0xF4B0000000000000ULL, 0xF660000000000000ULL, 0xF7D0000000000000ULL,
+        0xF3C0000000000000ULL, 0xF270000000000000ULL, 0xF0A0000000000000ULL, 0xF110000000000000ULL,
+        0xF880000000000000ULL, 0xF930000000000000ULL, 0xFBE0000000000000ULL, 0xFA50000000000000ULL,
+        0xFE40000000000000ULL, 0xFFF0000000000000ULL, 0xFD20000000000000ULL, 0xFC90000000000000ULL,
+        0xB400000000000000ULL, 0xB5B0000000000000ULL, 0xB760000000000000ULL, 0xB6D0000000000000ULL,
+        0xB2C0000000000000ULL, 0xB370000000000000ULL, 0xB1A0000000000000ULL, 0xB010000000000000ULL,
+        0xB980000000000000ULL, 0xB830000000000000ULL, 0xBAE0000000000000ULL, 0xBB50000000000000ULL,
+        0xBF40000000000000ULL, 0xBEF0000000000000ULL, 0xBC20000000000000ULL, 0xBD90000000000000ULL,
+        0xAF00000000000000ULL, 0xAEB0000000000000ULL, 0xAC60000000000000ULL, 0xADD0000000000000ULL,
+        0xA9C0000000000000ULL, 0xA870000000000000ULL, 0xAAA0000000000000ULL, 0xAB10000000000000ULL,
+        0xA280000000000000ULL, 0xA330000000000000ULL, 0xA1E0000000000000ULL, 0xA050000000000000ULL,
+        0xA440000000000000ULL, 0xA5F0000000000000ULL, 0xA720000000000000ULL, 0xA690000000000000ULL,
+        0x8200000000000000ULL, 0x83B0000000000000ULL, 0x8160000000000000ULL, 0x80D0000000000000ULL,
+        0x84C0000000000000ULL, 0x8570000000000000ULL, 0x87A0000000000000ULL, 0x8610000000000000ULL,
+        0x8F80000000000000ULL, 0x8E30000000000000ULL, 0x8CE0000000000000ULL, 0x8D50000000000000ULL,
+        0x8940000000000000ULL, 0x88F0000000000000ULL, 0x8A20000000000000ULL, 0x8B90000000000000ULL,
+        0x9900000000000000ULL, 0x98B0000000000000ULL, 0x9A60000000000000ULL, 0x9BD0000000000000ULL,
+        0x9FC0000000000000ULL, 0x9E70000000000000ULL, 0x9CA0000000000000ULL, 0x9D10000000000000ULL,
+        0x9480000000000000ULL, 0x9530000000000000ULL, 0x97E0000000000000ULL, 0x9650000000000000ULL,
+        0x9240000000000000ULL, 0x93F0000000000000ULL, 0x9120000000000000ULL, 0x9090000000000000ULL
+    },
+    {
+        0x0000000000000000ULL, 0x0001B00000000000ULL, 0x0003600000000000ULL, 0x0002D00000000000ULL,
+        0x0006C00000000000ULL, 0x0007700000000000ULL, 0x0005A00000000000ULL, 0x0004100000000000ULL,
+        0x000D800000000000ULL, 0x000C300000000000ULL, 0x000EE00000000000ULL, 0x000F500000000000ULL,
+        0x000B400000000000ULL, 0x000AF00000000000ULL, 0x0008200000000000ULL, 0x0009900000000000ULL,
+        0x001B000000000000ULL, 0x001AB00000000000ULL, 0x0018600000000000ULL, 0x0019D00000000000ULL,
+        0x001DC00000000000ULL, 0x001C700000000000ULL, 0x001EA00000000000ULL, 0x001F100000000000ULL,
+        0x0016800000000000ULL, 0x0017300000000000ULL, 0x0015E00000000000ULL, 0x0014500000000000ULL,
+        0x0010400000000000ULL, 0x0011F00000000000ULL, 0x0013200000000000ULL, 0x0012900000000000ULL,
+        0x0036000000000000ULL, 0x0037B00000000000ULL, 0x0035600000000000ULL, 0x0034D00000000000ULL,
+        0x0030C00000000000ULL, 0x0031700000000000ULL, 0x0033A00000000000ULL, 0x0032100000000000ULL,
+        0x003B800000000000ULL, 0x003A300000000000ULL, 0x0038E00000000000ULL, 0x0039500000000000ULL,
+        0x003D400000000000ULL, 0x003CF00000000000ULL, 0x003E200000000000ULL, 0x003F900000000000ULL,
+        0x002D000000000000ULL, 0x002CB00000000000ULL, 0x002E600000000000ULL, 0x002FD00000000000ULL,
+        0x002BC00000000000ULL, 0x002A700000000000ULL, 0x0028A00000000000ULL, 0x0029100000000000ULL,
+        0x0020800000000000ULL, 0x0021300000000000ULL, 0x0023E00000000000ULL, 0x0022500000000000ULL,
+        0x0026400000000000ULL, 0x0027F00000000000ULL, 0x0025200000000000ULL, 0x0024900000000000ULL,
+        0x006C000000000000ULL, 0x006DB00000000000ULL, 0x006F600000000000ULL, 0x006ED00000000000ULL,
+        0x006AC00000000000ULL, 0x006B700000000000ULL, 0x0069A00000000000ULL, 0x0068100000000000ULL,
+        0x0061800000000000ULL, 0x0060300000000000ULL, 0x0062E00000000000ULL, 0x0063500000000000ULL,
+        0x0067400000000000ULL, 0x0066F00000000000ULL, 0x0064200000000000ULL, 0x0065900000000000ULL,
+        0x0077000000000000ULL, 0x0076B00000000000ULL, 0x0074600000000000ULL, 0x0075D00000000000ULL,
+        0x0071C00000000000ULL, 0x0070700000000000ULL, 0x0072A00000000000ULL, 0x0073100000000000ULL,
+        0x007A800000000000ULL, 0x007B300000000000ULL, 0x0079E00000000000ULL, 0x0078500000000000ULL,
+        0x007C400000000000ULL, 0x007DF00000000000ULL, 0x007F200000000000ULL, 0x007E900000000000ULL,
+        0x005A000000000000ULL, 0x005BB00000000000ULL, 0x0059600000000000ULL, 0x0058D00000000000ULL,
+        0x005CC00000000000ULL, 0x005D700000000000ULL, 0x005FA00000000000ULL, 0x005E100000000000ULL,
+        0x0057800000000000ULL, 0x0056300000000000ULL, 0x0054E00000000000ULL, 0x0055500000000000ULL,
+        0x0051400000000000ULL, 0x0050F00000000000ULL, 0x0052200000000000ULL, 0x0053900000000000ULL,
+        0x0041000000000000ULL, 0x0040B00000000000ULL, 0x0042600000000000ULL, 0x0043D00000000000ULL,
+        0x0047C00000000000ULL, 0x0046700000000000ULL, 0x0044A00000000000ULL, 0x0045100000000000ULL,
+        0x004C800000000000ULL, 0x004D300000000000ULL, 0x004FE00000000000ULL, 0x004E500000000000ULL,
+        0x004A400000000000ULL, 0x004BF00000000000ULL, 0x0049200000000000ULL, 0x0048900000000000ULL,
+        0x00D8000000000000ULL, 0x00D9B00000000000ULL, 0x00DB600000000000ULL, 0x00DAD00000000000ULL,
+        0x00DEC00000000000ULL, 0x00DF700000000000ULL, 0x00DDA00000000000ULL, 0x00DC100000000000ULL,
+        0x00D5800000000000ULL, 0x00D4300000000000ULL, 0x00D6E00000000000ULL, 0x00D7500000000000ULL,
+        0x00D3400000000000ULL, 0x00D2F00000000000ULL, 0x00D0200000000000ULL, 0x00D1900000000000ULL,
+        0x00C3000000000000ULL, 0x00C2B00000000000ULL, 0x00C0600000000000ULL, 0x00C1D00000000000ULL,
+        0x00C5C00000000000ULL, 0x00C4700000000000ULL, 0x00C6A00000000000ULL, 0x00C7100000000000ULL,
+        0x00CE800000000000ULL, 0x00CF300000000000ULL, 0x00CDE00000000000ULL, 0x00CC500000000000ULL,
+        0x00C8400000000000ULL, 0x00C9F00000000000ULL, 0x00CB200000000000ULL, 0x00CA900000000000ULL,
+        0x00EE000000000000ULL, 0x00EFB00000000000ULL, 0x00ED600000000000ULL, 0x00ECD00000000000ULL,
+        0x00E8C00000000000ULL, 0x00E9700000000000ULL, 0x00EBA00000000000ULL, 0x00EA100000000000ULL,
+        0x00E3800000000000ULL, 0x00E2300000000000ULL, 0x00E0E00000000000ULL, 0x00E1500000000000ULL,
+        0x00E5400000000000ULL, 0x00E4F00000000000ULL, 0x00E6200000000000ULL, 0x00E7900000000000ULL,
+        0x00F5000000000000ULL, 0x00F4B00000000000ULL, 0x00F6600000000000ULL, 0x00F7D00000000000ULL,
+        0x00F3C00000000000ULL, 0x00F2700000000000ULL, 0x00F0A00000000000ULL, 0x00F1100000000000ULL,
+        0x00F8800000000000ULL, 0x00F9300000000000ULL, 0x00FBE00000000000ULL, 0x00FA500000000000ULL,
+        0x00FE400000000000ULL, 0x00FFF00000000000ULL, 0x00FD200000000000ULL, 0x00FC900000000000ULL,
+        0x00B4000000000000ULL, 0x00B5B00000000000ULL, 0x00B7600000000000ULL, 0x00B6D00000000000ULL,
+        0x00B2C00000000000ULL, 0x00B3700000000000ULL, 0x00B1A00000000000ULL, 0x00B0100000000000ULL,
+        0x00B9800000000000ULL, 0x00B8300000000000ULL, 0x00BAE00000000000ULL, 0x00BB500000000000ULL,
+        0x00BF400000000000ULL, 0x00BEF00000000000ULL, 0x00BC200000000000ULL, 0x00BD900000000000ULL,
+        0x00AF000000000000ULL, 0x00AEB00000000000ULL, 0x00AC600000000000ULL, 0x00ADD00000000000ULL,
+        0x00A9C00000000000ULL, 0x00A8700000000000ULL, 0x00AAA00000000000ULL, 0x00AB100000000000ULL,
+        0x00A2800000000000ULL, 0x00A3300000000000ULL, 0x00A1E00000000000ULL, 0x00A0500000000000ULL,
+        0x00A4400000000000ULL, 0x00A5F00000000000ULL, 0x00A7200000000000ULL, 0x00A6900000000000ULL,
+        0x0082000000000000ULL, 0x0083B00000000000ULL, 0x0081600000000000ULL, 0x0080D00000000000ULL,
+        0x0084C00000000000ULL, 0x0085700000000000ULL, 0x0087A00000000000ULL, 0x0086100000000000ULL,
+        0x008F800000000000ULL, 0x008E300000000000ULL, 0x008CE00000000000ULL, 0x008D500000000000ULL,
+        0x0089400000000000ULL, 0x0088F00000000000ULL, 0x008A200000000000ULL, 0x008B900000000000ULL,
+        0x0099000000000000ULL, 0x0098B00000000000ULL, 0x009A600000000000ULL, 0x009BD00000000000ULL,
+        0x009FC00000000000ULL, 0x009E700000000000ULL, 0x009CA00000000000ULL, 0x009D100000000000ULL,
+        0x0094800000000000ULL, 0x0095300000000000ULL, 0x0097E00000000000ULL, 0x0096500000000000ULL,
+        0x0092400000000000ULL, 0x0093F00000000000ULL, 0x0091200000000000ULL, 0x0090900000000000ULL
+    },
+    {
+        0x0000000000000000ULL, 0x000001B000000000ULL, 0x0000036000000000ULL, 0x000002D000000000ULL,
+        0x000006C000000000ULL, 0x0000077000000000ULL, 0x000005A000000000ULL, 0x0000041000000000ULL,
+        0x00000D8000000000ULL, 0x00000C3000000000ULL, 0x00000EE000000000ULL, 0x00000F5000000000ULL,
+        0x00000B4000000000ULL, 0x00000AF000000000ULL, 0x0000082000000000ULL, 0x0000099000000000ULL,
+        0x00001B0000000000ULL, 0x00001AB000000000ULL, 0x0000186000000000ULL, 0x000019D000000000ULL,
+        0x00001DC000000000ULL, 0x00001C7000000000ULL, 0x00001EA000000000ULL, 0x00001F1000000000ULL,
+        0x0000168000000000ULL, 0x0000173000000000ULL, 0x000015E000000000ULL, 0x0000145000000000ULL,
+        0x0000104000000000ULL, 0x000011F000000000ULL, 0x0000132000000000ULL, 0x0000129000000000ULL,
+        0x0000360000000000ULL, 0x000037B000000000ULL, 0x0000356000000000ULL, 0x000034D000000000ULL,
+        0x000030C000000000ULL, 0x0000317000000000ULL, 0x000033A000000000ULL, 0x0000321000000000ULL,
+        0x00003B8000000000ULL, 0x00003A3000000000ULL, 0x000038E000000000ULL, 0x0000395000000000ULL,
+        0x00003D4000000000ULL, 0x00003CF000000000ULL, 0x00003E2000000000ULL, 0x00003F9000000000ULL,
+        0x00002D0000000000ULL, 0x00002CB000000000ULL, 0x00002E6000000000ULL, 0x00002FD000000000ULL,
+        0x00002BC000000000ULL, 0x00002A7000000000ULL, 0x000028A000000000ULL, 0x0000291000000000ULL,
+        0x0000208000000000ULL, 0x0000213000000000ULL, 0x000023E000000000ULL, 0x0000225000000000ULL,
+        0x0000264000000000ULL, 0x000027F000000000ULL, 0x0000252000000000ULL, 0x0000249000000000ULL,
+        0x00006C0000000000ULL, 0x00006DB000000000ULL, 0x00006F6000000000ULL, 0x00006ED000000000ULL,
+        0x00006AC000000000ULL, 0x00006B7000000000ULL, 0x000069A000000000ULL, 0x0000681000000000ULL,
+        0x0000618000000000ULL, 0x0000603000000000ULL, 0x000062E000000000ULL, 0x0000635000000000ULL,
+        0x0000674000000000ULL, 0x000066F000000000ULL, 0x0000642000000000ULL, 0x0000659000000000ULL,
+        0x0000770000000000ULL, 0x000076B000000000ULL, 0x0000746000000000ULL, 0x000075D000000000ULL,
+        0x000071C000000000ULL, 0x0000707000000000ULL, 0x000072A000000000ULL, 0x0000731000000000ULL,
+        0x00007A8000000000ULL, 0x00007B3000000000ULL, 0x000079E000000000ULL, 0x0000785000000000ULL,
+        0x00007C4000000000ULL, 0x00007DF000000000ULL, 0x00007F2000000000ULL, 0x00007E9000000000ULL,
+        0x00005A0000000000ULL, 0x00005BB000000000ULL, 0x0000596000000000ULL, 0x000058D000000000ULL,
+        0x00005CC000000000ULL, 0x00005D7000000000ULL, 0x00005FA000000000ULL, 0x00005E1000000000ULL,
+        0x0000578000000000ULL, 0x0000563000000000ULL, 0x000054E000000000ULL, 0x0000555000000000ULL,
+        0x0000514000000000ULL, 0x000050F000000000ULL, 0x0000522000000000ULL, 0x0000539000000000ULL,
+        0x0000410000000000ULL, 0x000040B000000000ULL, 0x0000426000000000ULL, 0x000043D000000000ULL,
+        0x000047C000000000ULL, 0x0000467000000000ULL, 0x000044A000000000ULL, 0x0000451000000000ULL,
+        0x00004C8000000000ULL, 0x00004D3000000000ULL, 0x00004FE000000000ULL, 0x00004E5000000000ULL,
+        0x00004A4000000000ULL, 0x00004BF000000000ULL, 0x0000492000000000ULL, 0x0000489000000000ULL,
+        0x0000D80000000000ULL, 0x0000D9B000000000ULL, 0x0000DB6000000000ULL, 0x0000DAD000000000ULL,
+        0x0000DEC000000000ULL, 0x0000DF7000000000ULL, 0x0000DDA000000000ULL, 0x0000DC1000000000ULL,
+        0x0000D58000000000ULL, 0x0000D43000000000ULL, 0x0000D6E000000000ULL, 0x0000D75000000000ULL,
+        0x0000D34000000000ULL, 0x0000D2F000000000ULL, 0x0000D02000000000ULL, 0x0000D19000000000ULL,
+        0x0000C30000000000ULL, 0x0000C2B000000000ULL, 0x0000C06000000000ULL, 0x0000C1D000000000ULL,
+        0x0000C5C000000000ULL, 0x0000C47000000000ULL, 0x0000C6A000000000ULL, 0x0000C71000000000ULL,
+        0x0000CE8000000000ULL, 0x0000CF3000000000ULL, 0x0000CDE000000000ULL, 0x0000CC5000000000ULL,
+        0x0000C84000000000ULL, 0x0000C9F000000000ULL, 0x0000CB2000000000ULL, 0x0000CA9000000000ULL,
+        0x0000EE0000000000ULL, 0x0000EFB000000000ULL, 0x0000ED6000000000ULL, 0x0000ECD000000000ULL,
+        0x0000E8C000000000ULL, 0x0000E97000000000ULL, 0x0000EBA000000000ULL, 0x0000EA1000000000ULL,
+        0x0000E38000000000ULL, 0x0000E23000000000ULL, 0x0000E0E000000000ULL, 0x0000E15000000000ULL,
+        0x0000E54000000000ULL, 0x0000E4F000000000ULL, 0x0000E62000000000ULL, 0x0000E79000000000ULL,
+        0x0000F50000000000ULL, 0x0000F4B000000000ULL, 0x0000F66000000000ULL, 0x0000F7D000000000ULL,
+        0x0000F3C000000000ULL, 0x0000F27000000000ULL, 0x0000F0A000000000ULL, 0x0000F11000000000ULL,
+        0x0000F88000000000ULL, 0x0000F93000000000ULL, 0x0000FBE000000000ULL, 0x0000FA5000000000ULL,
+        0x0000FE4000000000ULL, 0x0000FFF000000000ULL, 0x0000FD2000000000ULL, 0x0000FC9000000000ULL,
+        0x0000B40000000000ULL, 0x0000B5B000000000ULL, 0x0000B76000000000ULL, 0x0000B6D000000000ULL,
+        0x0000B2C000000000ULL, 0x0000B37000000000ULL, 0x0000B1A000000000ULL, 0x0000B01000000000ULL,
+        0x0000B98000000000ULL, 0x0000B83000000000ULL, 0x0000BAE000000000ULL, 0x0000BB5000000000ULL,
+        0x0000BF4000000000ULL, 0x0000BEF000000000ULL, 0x0000BC2000000000ULL, 0x0000BD9000000000ULL,
+        0x0000AF0000000000ULL, 0x0000AEB000000000ULL, 0x0000AC6000000000ULL, 0x0000ADD000000000ULL,
+        0x0000A9C000000000ULL, 0x0000A87000000000ULL, 0x0000AAA000000000ULL, 0x0000AB1000000000ULL,
+        0x0000A28000000000ULL, 0x0000A33000000000ULL, 0x0000A1E000000000ULL, 0x0000A05000000000ULL,
+        0x0000A44000000000ULL, 0x0000A5F000000000ULL, 0x0000A72000000000ULL, 0x0000A69000000000ULL,
+        0x0000820000000000ULL, 0x000083B000000000ULL, 0x0000816000000000ULL, 0x000080D000000000ULL,
+        0x000084C000000000ULL, 0x0000857000000000ULL, 0x000087A000000000ULL, 0x0000861000000000ULL,
+        0x00008F8000000000ULL, 0x00008E3000000000ULL, 0x00008CE000000000ULL, 0x00008D5000000000ULL,
+        0x0000894000000000ULL, 0x000088F000000000ULL, 0x00008A2000000000ULL, 0x00008B9000000000ULL,
+        0x0000990000000000ULL, 0x000098B000000000ULL, 0x00009A6000000000ULL, 0x00009BD000000000ULL,
+        0x00009FC000000000ULL, 0x00009E7000000000ULL, 0x00009CA000000000ULL, 0x00009D1000000000ULL,
+        0x0000948000000000ULL, 0x0000953000000000ULL, 0x000097E000000000ULL, 0x0000965000000000ULL,
+        0x0000924000000000ULL, 0x000093F000000000ULL, 0x0000912000000000ULL, 0x0000909000000000ULL
+    },
+    {
+        0x0000000000000000ULL, 0x00000001B0000000ULL, 0x0000000360000000ULL, 0x00000002D0000000ULL,
+        0x00000006C0000000ULL, 0x0000000770000000ULL, 0x00000005A0000000ULL, 0x0000000410000000ULL,
+        0x0000000D80000000ULL, 0x0000000C30000000ULL, 0x0000000EE0000000ULL, 0x0000000F50000000ULL,
+        0x0000000B40000000ULL, 0x0000000AF0000000ULL, 0x0000000820000000ULL, 0x0000000990000000ULL,
+        0x0000001B00000000ULL, 0x0000001AB0000000ULL, 0x0000001860000000ULL, 0x00000019D0000000ULL,
+        0x0000001DC0000000ULL, 0x0000001C70000000ULL, 0x0000001EA0000000ULL, 0x0000001F10000000ULL,
+        0x0000001680000000ULL, 0x0000001730000000ULL, 0x00000015E0000000ULL, 0x0000001450000000ULL,
+        0x0000001040000000ULL, 0x00000011F0000000ULL, 0x0000001320000000ULL, 0x0000001290000000ULL,
+        0x0000003600000000ULL, 0x00000037B0000000ULL, 0x0000003560000000ULL, 0x00000034D0000000ULL,
+        0x00000030C0000000ULL, 0x0000003170000000ULL, 0x00000033A0000000ULL, 0x0000003210000000ULL,
+        0x0000003B80000000ULL, 0x0000003A30000000ULL, 0x00000038E0000000ULL, 0x0000003950000000ULL,
+        0x0000003D40000000ULL, 0x0000003CF0000000ULL, 0x0000003E20000000ULL, 0x0000003F90000000ULL,
+        0x0000002D00000000ULL, 0x0000002CB0000000ULL, 0x0000002E60000000ULL, 0x0000002FD0000000ULL,
+        0x0000002BC0000000ULL, 0x0000002A70000000ULL, 0x00000028A0000000ULL, 0x0000002910000000ULL,
+        0x0000002080000000ULL, 0x0000002130000000ULL, 0x00000023E0000000ULL, 0x0000002250000000ULL,
+        0x0000002640000000ULL, 0x00000027F0000000ULL, 0x0000002520000000ULL, 0x0000002490000000ULL,
+        0x0000006C00000000ULL, 0x0000006DB0000000ULL, 0x0000006F60000000ULL, 0x0000006ED0000000ULL,
+        0x0000006AC0000000ULL, 0x0000006B70000000ULL, 0x00000069A0000000ULL, 0x0000006810000000ULL,
+        0x0000006180000000ULL, 0x0000006030000000ULL, 0x00000062E0000000ULL, 0x0000006350000000ULL,
+        0x0000006740000000ULL, 0x00000066F0000000ULL, 0x0000006420000000ULL, 0x0000006590000000ULL,
+        0x0000007700000000ULL, 0x00000076B0000000ULL, 0x0000007460000000ULL, 0x00000075D0000000ULL,
+        0x00000071C0000000ULL, 0x0000007070000000ULL, 0x00000072A0000000ULL, 0x0000007310000000ULL,
+        0x0000007A80000000ULL, 0x0000007B30000000ULL, 0x00000079E0000000ULL, 0x0000007850000000ULL,
+        0x0000007C40000000ULL, 0x0000007DF0000000ULL, 0x0000007F20000000ULL, 0x0000007E90000000ULL,
+        0x0000005A00000000ULL, 0x0000005BB0000000ULL, 0x0000005960000000ULL, 0x00000058D0000000ULL,
+        0x0000005CC0000000ULL, 0x0000005D70000000ULL, 0x0000005FA0000000ULL, 0x0000005E10000000ULL,
+        0x0000005780000000ULL, 0x0000005630000000ULL, 0x00000054E0000000ULL, 0x0000005550000000ULL,
+        0x0000005140000000ULL, 0x00000050F0000000ULL, 0x0000005220000000ULL, 0x0000005390000000ULL,
+        0x0000004100000000ULL, 0x00000040B0000000ULL, 0x0000004260000000ULL, 0x00000043D0000000ULL,
+        0x00000047C0000000ULL, 0x0000004670000000ULL, 0x00000044A0000000ULL, 0x0000004510000000ULL,
+        0x0000004C80000000ULL, 0x0000004D30000000ULL, 0x0000004FE0000000ULL, 0x0000004E50000000ULL,
+        0x0000004A40000000ULL, 0x0000004BF0000000ULL, 0x0000004920000000ULL, 0x0000004890000000ULL,
+        0x000000D800000000ULL, 0x000000D9B0000000ULL, 0x000000DB60000000ULL, 0x000000DAD0000000ULL,
+        0x000000DEC0000000ULL, 0x000000DF70000000ULL, 0x000000DDA0000000ULL, 0x000000DC10000000ULL,
+        0x000000D580000000ULL, 0x000000D430000000ULL, 0x000000D6E0000000ULL, 0x000000D750000000ULL,
+        0x000000D340000000ULL, 0x000000D2F0000000ULL, 0x000000D020000000ULL, 0x000000D190000000ULL,
+        0x000000C300000000ULL, 0x000000C2B0000000ULL, 0x000000C060000000ULL, 0x000000C1D0000000ULL,
+        0x000000C5C0000000ULL, 0x000000C470000000ULL, 0x000000C6A0000000ULL, 0x000000C710000000ULL,
+        0x000000CE80000000ULL, 0x000000CF30000000ULL, 0x000000CDE0000000ULL, 0x000000CC50000000ULL,
+        0x000000C840000000ULL, 0x000000C9F0000000ULL, 0x000000CB20000000ULL, 0x000000CA90000000ULL,
+        0x000000EE00000000ULL, 0x000000EFB0000000ULL, 0x000000ED60000000ULL, 0x000000ECD0000000ULL,
+        0x000000E8C0000000ULL, 0x000000E970000000ULL, 0x000000EBA0000000ULL, 0x000000EA10000000ULL,
+        0x000000E380000000ULL, 0x000000E230000000ULL, 0x000000E0E0000000ULL, 0x000000E150000000ULL,
+        0x000000E540000000ULL, 0x000000E4F0000000ULL, 0x000000E620000000ULL, 0x000000E790000000ULL,
+        0x000000F500000000ULL, 0x000000F4B0000000ULL, 0x000000F660000000ULL, 0x000000F7D0000000ULL,
+        0x000000F3C0000000ULL, 0x000000F270000000ULL, 0x000000F0A0000000ULL, 0x000000F110000000ULL,
+        0x000000F880000000ULL, 0x000000F930000000ULL, 0x000000FBE0000000ULL, 0x000000FA50000000ULL,
+        0x000000FE40000000ULL, 0x000000FFF0000000ULL, 0x000000FD20000000ULL, 0x000000FC90000000ULL,
+        0x000000B400000000ULL, 0x000000B5B0000000ULL, 0x000000B760000000ULL, 0x000000B6D0000000ULL,
+        0x000000B2C0000000ULL, 0x000000B370000000ULL, 0x000000B1A0000000ULL, 0x000000B010000000ULL,
+        0x000000B980000000ULL, 0x000000B830000000ULL, 0x000000BAE0000000ULL, 0x000000BB50000000ULL,
+        0x000000BF40000000ULL, 0x000000BEF0000000ULL, 0x000000BC20000000ULL, 0x000000BD90000000ULL,
+        0x000000AF00000000ULL, 0x000000AEB0000000ULL, 0x000000AC60000000ULL, 0x000000ADD0000000ULL,
+        0x000000A9C0000000ULL, 0x000000A870000000ULL, 0x000000AAA0000000ULL, 0x000000AB10000000ULL,
+        0x000000A280000000ULL, 0x000000A330000000ULL, 0x000000A1E0000000ULL, 0x000000A050000000ULL,
+        0x000000A440000000ULL, 0x000000A5F0000000ULL, 0x000000A720000000ULL, 0x000000A690000000ULL,
+        0x0000008200000000ULL, 0x00000083B0000000ULL, 0x0000008160000000ULL, 0x00000080D0000000ULL,
+        0x00000084C0000000ULL, 0x0000008570000000ULL, 0x00000087A0000000ULL, 0x0000008610000000ULL,
+        0x0000008F80000000ULL, 0x0000008E30000000ULL, 0x0000008CE0000000ULL, 0x0000008D50000000ULL,
+        0x0000008940000000ULL, 0x00000088F0000000ULL, 0x0000008A20000000ULL, 0x0000008B90000000ULL,
+        0x0000009900000000ULL, 0x00000098B0000000ULL, 0x0000009A60000000ULL, 0x0000009BD0000000ULL,
+        0x0000009FC0000000ULL, 0x0000009E70000000ULL, 0x0000009CA0000000ULL, 0x0000009D10000000ULL,
+        0x0000009480000000ULL, 0x0000009530000000ULL, 0x00000097E0000000ULL, 0x0000009650000000ULL,
+        0x0000009240000000ULL, 0x00000093F0000000ULL, 0x0000009120000000ULL, 0x0000009090000000ULL
+    },
+    {
+        0x0000000000000000ULL, 0x0000000001B00000ULL, 0x0000000003600000ULL, 0x0000000002D00000ULL,
+        0x0000000006C00000ULL, 0x0000000007700000ULL, 0x0000000005A00000ULL, 0x0000000004100000ULL,
+        0x000000000D800000ULL, 0x000000000C300000ULL, 0x000000000EE00000ULL, 0x000000000F500000ULL,
+        0x000000000B400000ULL, 0x000000000AF00000ULL, 0x0000000008200000ULL, 0x0000000009900000ULL,
+        0x000000001B000000ULL, 0x000000001AB00000ULL, 0x0000000018600000ULL, 0x0000000019D00000ULL,
+        0x000000001DC00000ULL, 0x000000001C700000ULL, 0x000000001EA00000ULL, 0x000000001F100000ULL,
+        0x0000000016800000ULL, 0x0000000017300000ULL, 0x0000000015E00000ULL, 0x0000000014500000ULL,
+        0x0000000010400000ULL, 0x0000000011F00000ULL, 0x0000000013200000ULL, 0x0000000012900000ULL,
+        0x0000000036000000ULL, 0x0000000037B00000ULL, 0x0000000035600000ULL, 0x0000000034D00000ULL,
+        0x0000000030C00000ULL, 0x0000000031700000ULL, 0x0000000033A00000ULL, 0x0000000032100000ULL,
+        0x000000003B800000ULL, 0x000000003A300000ULL, 0x0000000038E00000ULL, 0x0000000039500000ULL,
+        0x000000003D400000ULL, 0x000000003CF00000ULL, 0x000000003E200000ULL, 0x000000003F900000ULL,
+        0x000000002D000000ULL, 0x000000002CB00000ULL, 0x000000002E600000ULL, 0x000000002FD00000ULL,
+        0x000000002BC00000ULL, 0x000000002A700000ULL, 0x0000000028A00000ULL, 0x0000000029100000ULL,
+        0x0000000020800000ULL, 0x0000000021300000ULL, 0x0000000023E00000ULL, 0x0000000022500000ULL,
+        0x0000000026400000ULL, 0x0000000027F00000ULL, 0x0000000025200000ULL, 0x0000000024900000ULL,
+        0x000000006C000000ULL, 0x000000006DB00000ULL, 0x000000006F600000ULL, 0x000000006ED00000ULL,
+        0x000000006AC00000ULL, 0x000000006B700000ULL, 0x0000000069A00000ULL, 0x0000000068100000ULL,
+        0x0000000061800000ULL, 0x0000000060300000ULL, 0x0000000062E00000ULL, 0x0000000063500000ULL,
+        0x0000000067400000ULL, 0x0000000066F00000ULL, 0x0000000064200000ULL, 0x0000000065900000ULL,
+        0x0000000077000000ULL, 0x0000000076B00000ULL, 0x0000000074600000ULL, 0x0000000075D00000ULL,
+        0x0000000071C00000ULL, 0x0000000070700000ULL, 0x0000000072A00000ULL, 0x0000000073100000ULL,
+        0x000000007A800000ULL, 0x000000007B300000ULL, 0x0000000079E00000ULL, 0x0000000078500000ULL,
+        0x000000007C400000ULL, 0x000000007DF00000ULL, 0x000000007F200000ULL, 0x000000007E900000ULL,
+        0x000000005A000000ULL, 0x000000005BB00000ULL, 0x0000000059600000ULL, 0x0000000058D00000ULL,
+        0x000000005CC00000ULL, 0x000000005D700000ULL, 0x000000005FA00000ULL, 0x000000005E100000ULL,
+        0x0000000057800000ULL, 0x0000000056300000ULL, 0x0000000054E00000ULL, 0x0000000055500000ULL,
+        0x0000000051400000ULL, 0x0000000050F00000ULL, 0x0000000052200000ULL, 0x0000000053900000ULL,
+        0x0000000041000000ULL, 0x0000000040B00000ULL, 0x0000000042600000ULL, 0x0000000043D00000ULL,
+        0x0000000047C00000ULL, 0x0000000046700000ULL, 0x0000000044A00000ULL, 0x0000000045100000ULL,
+        0x000000004C800000ULL, 0x000000004D300000ULL, 0x000000004FE00000ULL, 0x000000004E500000ULL,
+        0x000000004A400000ULL, 0x000000004BF00000ULL, 0x0000000049200000ULL, 0x0000000048900000ULL,
+        0x00000000D8000000ULL, 0x00000000D9B00000ULL, 0x00000000DB600000ULL, 0x00000000DAD00000ULL,
+        0x00000000DEC00000ULL, 0x00000000DF700000ULL, 0x00000000DDA00000ULL, 0x00000000DC100000ULL,
+        0x00000000D5800000ULL, 0x00000000D4300000ULL, 0x00000000D6E00000ULL, 0x00000000D7500000ULL,
+        0x00000000D3400000ULL, 0x00000000D2F00000ULL, 0x00000000D0200000ULL, 0x00000000D1900000ULL,
+        0x00000000C3000000ULL, 0x00000000C2B00000ULL, 0x00000000C0600000ULL, 0x00000000C1D00000ULL,
+        0x00000000C5C00000ULL, 0x00000000C4700000ULL, 0x00000000C6A00000ULL, 0x00000000C7100000ULL,
+        0x00000000CE800000ULL, 0x00000000CF300000ULL, 0x00000000CDE00000ULL, 0x00000000CC500000ULL,
+        0x00000000C8400000ULL, 0x00000000C9F00000ULL, 0x00000000CB200000ULL, 0x00000000CA900000ULL,
+        0x00000000EE000000ULL, 0x00000000EFB00000ULL, 0x00000000ED600000ULL, 0x00000000ECD00000ULL,
+        0x00000000E8C00000ULL, 0x00000000E9700000ULL, 0x00000000EBA00000ULL, 0x00000000EA100000ULL,
+        0x00000000E3800000ULL, 0x00000000E2300000ULL, 0x00000000E0E00000ULL, 0x00000000E1500000ULL,
+        0x00000000E5400000ULL, 0x00000000E4F00000ULL, 0x00000000E6200000ULL, 0x00000000E7900000ULL,
+        0x00000000F5000000ULL, 0x00000000F4B00000ULL, 0x00000000F6600000ULL, 0x00000000F7D00000ULL,
+        0x00000000F3C00000ULL, 0x00000000F2700000ULL, 0x00000000F0A00000ULL, 0x00000000F1100000ULL,
+        0x00000000F8800000ULL, 0x00000000F9300000ULL, 0x00000000FBE00000ULL, 0x00000000FA500000ULL,
+        0x00000000FE400000ULL, 0x00000000FFF00000ULL, 0x00000000FD200000ULL, 0x00000000FC900000ULL,
+        0x00000000B4000000ULL, 0x00000000B5B00000ULL, 0x00000000B7600000ULL, 0x00000000B6D00000ULL,
+        0x00000000B2C00000ULL, 0x00000000B3700000ULL, 0x00000000B1A00000ULL, 0x00000000B0100000ULL,
+        0x00000000B9800000ULL, 0x00000000B8300000ULL, 0x00000000BAE00000ULL, 0x00000000BB500000ULL,
+        0x00000000BF400000ULL, 0x00000000BEF00000ULL, 0x00000000BC200000ULL, 0x00000000BD900000ULL,
+        0x00000000AF000000ULL, 0x00000000AEB00000ULL, 0x00000000AC600000ULL, 0x00000000ADD00000ULL,
+        0x00000000A9C00000ULL, 0x00000000A8700000ULL, 0x00000000AAA00000ULL, 0x00000000AB100000ULL,
+        0x00000000A2800000ULL, 0x00000000A3300000ULL, 0x00000000A1E00000ULL, 0x00000000A0500000ULL,
+        0x00000000A4400000ULL, 0x00000000A5F00000ULL, 0x00000000A7200000ULL, 0x00000000A6900000ULL,
+        0x0000000082000000ULL, 0x0000000083B00000ULL, 0x0000000081600000ULL, 0x0000000080D00000ULL,
+        0x0000000084C00000ULL, 0x0000000085700000ULL, 0x0000000087A00000ULL, 0x0000000086100000ULL,
+        0x000000008F800000ULL, 0x000000008E300000ULL, 0x000000008CE00000ULL, 0x000000008D500000ULL,
+        0x0000000089400000ULL, 0x0000000088F00000ULL, 0x000000008A200000ULL, 0x000000008B900000ULL,
+        0x0000000099000000ULL, 0x0000000098B00000ULL, 0x000000009A600000ULL, 0x000000009BD00000ULL,
+        0x000000009FC00000ULL, 0x000000009E700000ULL, 0x000000009CA00000ULL, 0x000000009D100000ULL,
+        0x0000000094800000ULL, 0x0000000095300000ULL, 0x0000000097E00000ULL, 0x0000000096500000ULL,
+        0x0000000092400000ULL, 0x0000000093F00000ULL, 0x0000000091200000ULL, 0x0000000090900000ULL
+    },
+    {
+        0x0000000000000000ULL, 0x000000000001B000ULL, 0x0000000000036000ULL, 0x000000000002D000ULL,
+        0x000000000006C000ULL, 0x0000000000077000ULL, 0x000000000005A000ULL, 0x0000000000041000ULL,
+        0x00000000000D8000ULL, 0x00000000000C3000ULL, 0x00000000000EE000ULL, 0x00000000000F5000ULL,
+        0x00000000000B4000ULL, 0x00000000000AF000ULL, 0x0000000000082000ULL, 0x0000000000099000ULL,
+        0x00000000001B0000ULL, 0x00000000001AB000ULL, 0x0000000000186000ULL, 0x000000000019D000ULL,
+        0x00000000001DC000ULL, 0x00000000001C7000ULL, 0x00000000001EA000ULL, 0x00000000001F1000ULL,
+        0x0000000000168000ULL, 0x0000000000173000ULL, 0x000000000015E000ULL, 0x0000000000145000ULL,
+        0x0000000000104000ULL, 0x000000000011F000ULL, 0x0000000000132000ULL, 0x0000000000129000ULL,
+        0x0000000000360000ULL, 0x000000000037B000ULL, 0x0000000000356000ULL, 0x000000000034D000ULL,
+        0x000000000030C000ULL, 0x0000000000317000ULL, 0x000000000033A000ULL, 0x0000000000321000ULL,
+        0x00000000003B8000ULL, 0x00000000003A3000ULL, 0x000000000038E000ULL, 0x0000000000395000ULL,
+        0x00000000003D4000ULL, 0x00000000003CF000ULL, 0x00000000003E2000ULL, 0x00000000003F9000ULL,
+        0x00000000002D0000ULL, 0x00000000002CB000ULL, 0x00000000002E6000ULL, 0x00000000002FD000ULL,
+        0x00000000002BC000ULL, 0x00000000002A7000ULL, 0x000000000028A000ULL, 0x0000000000291000ULL,
+        0x0000000000208000ULL, 0x0000000000213000ULL, 0x000000000023E000ULL, 0x0000000000225000ULL,
+        0x0000000000264000ULL, 0x000000000027F000ULL, 0x0000000000252000ULL, 0x0000000000249000ULL,
+        0x00000000006C0000ULL, 0x00000000006DB000ULL, 0x00000000006F6000ULL, 0x00000000006ED000ULL,
+        0x00000000006AC000ULL, 0x00000000006B7000ULL, 0x000000000069A000ULL, 0x0000000000681000ULL,
+        0x0000000000618000ULL, 0x0000000000603000ULL, 0x000000000062E000ULL, 0x0000000000635000ULL,
+        0x0000000000674000ULL, 0x000000000066F000ULL, 0x0000000000642000ULL, 0x0000000000659000ULL,
+        0x0000000000770000ULL, 0x000000000076B000ULL, 0x0000000000746000ULL, 0x000000000075D000ULL,
+        0x000000000071C000ULL, 0x0000000000707000ULL, 0x000000000072A000ULL, 0x0000000000731000ULL,
+        0x00000000007A8000ULL, 0x00000000007B3000ULL, 0x000000000079E000ULL, 0x0000000000785000ULL,
+        0x00000000007C4000ULL, 0x00000000007DF000ULL, 0x00000000007F2000ULL, 0x00000000007E9000ULL,
+        0x00000000005A0000ULL, 0x00000000005BB000ULL, 0x0000000000596000ULL, 0x000000000058D000ULL,
+        0x00000000005CC000ULL, 0x00000000005D7000ULL, 0x00000000005FA000ULL, 0x00000000005E1000ULL,
+        0x0000000000578000ULL, 0x0000000000563000ULL, 0x000000000054E000ULL, 0x0000000000555000ULL,
+        0x0000000000514000ULL, 0x000000000050F000ULL, 0x0000000000522000ULL, 0x0000000000539000ULL,
+        0x0000000000410000ULL, 0x000000000040B000ULL, 0x0000000000426000ULL, 0x000000000043D000ULL,
+        0x000000000047C000ULL, 0x0000000000467000ULL, 0x000000000044A000ULL, 0x0000000000451000ULL,
+        0x00000000004C8000ULL, 0x00000000004D3000ULL, 0x00000000004FE000ULL, 0x00000000004E5000ULL,
+        0x00000000004A4000ULL, 0x00000000004BF000ULL, 0x0000000000492000ULL, 0x0000000000489000ULL,
+        0x0000000000D80000ULL, 0x0000000000D9B000ULL, 0x0000000000DB6000ULL, 0x0000000000DAD000ULL,
+        0x0000000000DEC000ULL, 0x0000000000DF7000ULL, 0x0000000000DDA000ULL, 0x0000000000DC1000ULL,
+        0x0000000000D58000ULL, 0x0000000000D43000ULL, 0x0000000000D6E000ULL, 0x0000000000D75000ULL,
+        0x0000000000D34000ULL, 0x0000000000D2F000ULL, 0x0000000000D02000ULL, 0x0000000000D19000ULL,
+        0x0000000000C30000ULL, 0x0000000000C2B000ULL, 0x0000000000C06000ULL, 0x0000000000C1D000ULL,
+        0x0000000000C5C000ULL, 0x0000000000C47000ULL, 0x0000000000C6A000ULL, 0x0000000000C71000ULL,
+        0x0000000000CE8000ULL, 0x0000000000CF3000ULL, 0x0000000000CDE000ULL, 0x0000000000CC5000ULL,
+        0x0000000000C84000ULL, 0x0000000000C9F000ULL, 0x0000000000CB2000ULL, 0x0000000000CA9000ULL,
+        0x0000000000EE0000ULL, 0x0000000000EFB000ULL, 0x0000000000ED6000ULL, 0x0000000000ECD000ULL,
+        0x0000000000E8C000ULL, 0x0000000000E97000ULL, 0x0000000000EBA000ULL, 0x0000000000EA1000ULL,
+        0x0000000000E38000ULL, 0x0000000000E23000ULL, 0x0000000000E0E000ULL, 0x0000000000E15000ULL,
+        0x0000000000E54000ULL, 0x0000000000E4F000ULL, 0x0000000000E62000ULL, 0x0000000000E79000ULL,
+        0x0000000000F50000ULL, 0x0000000000F4B000ULL, 0x0000000000F66000ULL, 0x0000000000F7D000ULL,
+        0x0000000000F3C000ULL, 0x0000000000F27000ULL, 0x0000000000F0A000ULL, 0x0000000000F11000ULL,
+        0x0000000000F88000ULL, 0x0000000000F93000ULL, 0x0000000000FBE000ULL, 0x0000000000FA5000ULL,
+        0x0000000000FE4000ULL, 0x0000000000FFF000ULL, 0x0000000000FD2000ULL, 0x0000000000FC9000ULL,
+        0x0000000000B40000ULL, 0x0000000000B5B000ULL, 0x0000000000B76000ULL, 0x0000000000B6D000ULL,
+        0x0000000000B2C000ULL, 0x0000000000B37000ULL, 0x0000000000B1A000ULL, 0x0000000000B01000ULL,
+        0x0000000000B98000ULL, 0x0000000000B83000ULL, 0x0000000000BAE000ULL, 0x0000000000BB5000ULL,
+        0x0000000000BF4000ULL, 0x0000000000BEF000ULL, 0x0000000000BC2000ULL, 0x0000000000BD9000ULL,
+        0x0000000000AF0000ULL, 0x0000000000AEB000ULL, 0x0000000000AC6000ULL, 0x0000000000ADD000ULL,
+        0x0000000000A9C000ULL, 0x0000000000A87000ULL, 0x0000000000AAA000ULL, 0x0000000000AB1000ULL,
+        0x0000000000A28000ULL, 0x0000000000A33000ULL, 0x0000000000A1E000ULL, 0x0000000000A05000ULL,
+        0x0000000000A44000ULL, 0x0000000000A5F000ULL, 0x0000000000A72000ULL, 0x0000000000A69000ULL,
+        0x0000000000820000ULL, 0x000000000083B000ULL, 0x0000000000816000ULL, 0x000000000080D000ULL,
+        0x000000000084C000ULL, 0x0000000000857000ULL, 0x000000000087A000ULL, 0x0000000000861000ULL,
+        0x00000000008F8000ULL, 0x00000000008E3000ULL, 0x00000000008CE000ULL, 0x00000000008D5000ULL,
+        0x0000000000894000ULL, 0x000000000088F000ULL, 0x00000000008A2000ULL, 0x00000000008B9000ULL,
+        0x0000000000990000ULL, 0x000000000098B000ULL, 0x00000000009A6000ULL, 0x00000000009BD000ULL,
+        0x00000000009FC000ULL, 0x00000000009E7000ULL, 0x00000000009CA000ULL, 0x00000000009D1000ULL,
+        0x0000000000948000ULL, 0x0000000000953000ULL, 0x000000000097E000ULL, 0x0000000000965000ULL,
+        0x0000000000924000ULL, 0x000000000093F000ULL, 0x0000000000912000ULL, 0x0000000000909000ULL
+    },
+    {
+        0x0000000000000000ULL, 0x00000000000001B0ULL, 0x0000000000000360ULL, 0x00000000000002D0ULL,
+        0x00000000000006C0ULL, 0x0000000000000770ULL, 0x00000000000005A0ULL, 0x0000000000000410ULL,
+        0x0000000000000D80ULL, 0x0000000000000C30ULL, 0x0000000000000EE0ULL, 0x0000000000000F50ULL,
+        0x0000000000000B40ULL, 0x0000000000000AF0ULL, 0x0000000000000820ULL, 0x0000000000000990ULL,
+        0x0000000000001B00ULL, 0x0000000000001AB0ULL, 0x0000000000001860ULL, 0x00000000000019D0ULL,
+        0x0000000000001DC0ULL, 0x0000000000001C70ULL, 0x0000000000001EA0ULL, 0x0000000000001F10ULL,
+        0x0000000000001680ULL, 0x0000000000001730ULL, 0x00000000000015E0ULL, 0x0000000000001450ULL,
+        0x0000000000001040ULL, 0x00000000000011F0ULL, 0x0000000000001320ULL, 0x0000000000001290ULL,
+        0x0000000000003600ULL, 0x00000000000037B0ULL, 0x0000000000003560ULL, 0x00000000000034D0ULL,
+        0x00000000000030C0ULL, 0x0000000000003170ULL, 0x00000000000033A0ULL, 0x0000000000003210ULL,
+        0x0000000000003B80ULL, 0x0000000000003A30ULL, 0x00000000000038E0ULL, 0x0000000000003950ULL,
+        0x0000000000003D40ULL, 0x0000000000003CF0ULL, 0x0000000000003E20ULL, 0x0000000000003F90ULL,
+        0x0000000000002D00ULL, 0x0000000000002CB0ULL, 0x0000000000002E60ULL, 0x0000000000002FD0ULL,
+        0x0000000000002BC0ULL, 0x0000000000002A70ULL, 0x00000000000028A0ULL, 0x0000000000002910ULL,
+        0x0000000000002080ULL, 0x0000000000002130ULL, 0x00000000000023E0ULL, 0x0000000000002250ULL,
+        0x0000000000002640ULL, 0x00000000000027F0ULL, 0x0000000000002520ULL, 0x0000000000002490ULL,
+        0x0000000000006C00ULL, 0x0000000000006DB0ULL, 0x0000000000006F60ULL, 0x0000000000006ED0ULL,
+        0x0000000000006AC0ULL, 0x0000000000006B70ULL, 0x00000000000069A0ULL, 0x0000000000006810ULL,
+        0x0000000000006180ULL, 0x0000000000006030ULL, 0x00000000000062E0ULL, 0x0000000000006350ULL,
+        0x0000000000006740ULL, 0x00000000000066F0ULL, 0x0000000000006420ULL, 0x0000000000006590ULL,
+        0x0000000000007700ULL, 0x00000000000076B0ULL, 0x0000000000007460ULL, 0x00000000000075D0ULL,
+        0x00000000000071C0ULL, 0x0000000000007070ULL, 0x00000000000072A0ULL, 0x0000000000007310ULL,
+        0x0000000000007A80ULL, 0x0000000000007B30ULL, 0x00000000000079E0ULL, 0x0000000000007850ULL,
+        0x0000000000007C40ULL, 0x0000000000007DF0ULL, 0x0000000000007F20ULL, 0x0000000000007E90ULL,
+        0x0000000000005A00ULL, 0x0000000000005BB0ULL, 0x0000000000005960ULL, 0x00000000000058D0ULL,
+        0x0000000000005CC0ULL, 0x0000000000005D70ULL, 0x0000000000005FA0ULL, 0x0000000000005E10ULL,
+        0x0000000000005780ULL, 0x0000000000005630ULL, 0x00000000000054E0ULL, 0x0000000000005550ULL,
+        0x0000000000005140ULL, 0x00000000000050F0ULL, 0x0000000000005220ULL, 0x0000000000005390ULL,
+        0x0000000000004100ULL, 0x00000000000040B0ULL, 0x0000000000004260ULL, 0x00000000000043D0ULL,
+        0x00000000000047C0ULL, 0x0000000000004670ULL, 0x00000000000044A0ULL, 0x0000000000004510ULL,
+        0x0000000000004C80ULL, 0x0000000000004D30ULL, 0x0000000000004FE0ULL, 0x0000000000004E50ULL,
+        0x0000000000004A40ULL, 0x0000000000004BF0ULL, 0x0000000000004920ULL, 0x0000000000004890ULL,
+        0x000000000000D800ULL, 0x000000000000D9B0ULL, 0x000000000000DB60ULL, 0x000000000000DAD0ULL,
+        0x000000000000DEC0ULL, 0x000000000000DF70ULL, 0x000000000000DDA0ULL, 0x000000000000DC10ULL,
+        0x000000000000D580ULL, 0x000000000000D430ULL, 0x000000000000D6E0ULL, 0x000000000000D750ULL,
+        0x000000000000D340ULL, 0x000000000000D2F0ULL, 0x000000000000D020ULL, 0x000000000000D190ULL,
+        0x000000000000C300ULL, 0x000000000000C2B0ULL, 0x000000000000C060ULL, 0x000000000000C1D0ULL,
+        0x000000000000C5C0ULL, 0x000000000000C470ULL, 0x000000000000C6A0ULL, 0x000000000000C710ULL,
+        0x000000000000CE80ULL, 0x000000000000CF30ULL, 0x000000000000CDE0ULL, 0x000000000000CC50ULL,
+        0x000000000000C840ULL, 0x000000000000C9F0ULL, 0x000000000000CB20ULL, 0x000000000000CA90ULL,
+        0x000000000000EE00ULL, 0x000000000000EFB0ULL, 0x000000000000ED60ULL, 0x000000000000ECD0ULL,
+        0x000000000000E8C0ULL, 0x000000000000E970ULL, 0x000000000000EBA0ULL, 0x000000000000EA10ULL,
+        0x000000000000E380ULL, 0x000000000000E230ULL, 0x000000000000E0E0ULL, 0x000000000000E150ULL,
+        0x000000000000E540ULL, 0x000000000000E4F0ULL, 0x000000000000E620ULL, 0x000000000000E790ULL,
+        0x000000000000F500ULL, 0x000000000000F4B0ULL, 0x000000000000F660ULL, 0x000000000000F7D0ULL,
+        0x000000000000F3C0ULL, 0x000000000000F270ULL, 0x000000000000F0A0ULL, 0x000000000000F110ULL,
+        0x000000000000F880ULL, 0x000000000000F930ULL, 0x000000000000FBE0ULL, 0x000000000000FA50ULL,
+        0x000000000000FE40ULL, 0x000000000000FFF0ULL, 0x000000000000FD20ULL, 0x000000000000FC90ULL,
+        0x000000000000B400ULL, 0x000000000000B5B0ULL, 0x000000000000B760ULL, 0x000000000000B6D0ULL,
+        0x000000000000B2C0ULL, 0x000000000000B370ULL, 0x000000000000B1A0ULL, 0x000000000000B010ULL,
+        0x000000000000B980ULL, 0x000000000000B830ULL, 0x000000000000BAE0ULL, 0x000000000000BB50ULL,
+        0x000000000000BF40ULL, 0x000000000000BEF0ULL, 0x000000000000BC20ULL, 0x000000000000BD90ULL,
+        0x000000000000AF00ULL, 0x000000000000AEB0ULL, 0x000000000000AC60ULL, 0x000000000000ADD0ULL,
+        0x000000000000A9C0ULL, 0x000000000000A870ULL, 0x000000000000AAA0ULL, 0x000000000000AB10ULL,
+        0x000000000000A280ULL, 0x000000000000A330ULL, 0x000000000000A1E0ULL, 0x000000000000A050ULL,
+        0x000000000000A440ULL, 0x000000000000A5F0ULL, 0x000000000000A720ULL, 0x000000000000A690ULL,
+        0x0000000000008200ULL, 0x00000000000083B0ULL, 0x0000000000008160ULL, 0x00000000000080D0ULL,
+        0x00000000000084C0ULL, 0x0000000000008570ULL, 0x00000000000087A0ULL, 0x0000000000008610ULL,
+        0x0000000000008F80ULL, 0x0000000000008E30ULL, 0x0000000000008CE0ULL, 0x0000000000008D50ULL,
+        0x0000000000008940ULL, 0x00000000000088F0ULL, 0x0000000000008A20ULL, 0x0000000000008B90ULL,
+        0x0000000000009900ULL, 0x00000000000098B0ULL, 0x0000000000009A60ULL, 0x0000000000009BD0ULL,
+        0x0000000000009FC0ULL, 0x0000000000009E70ULL, 0x0000000000009CA0ULL, 0x0000000000009D10ULL,
+        0x0000000000009480ULL, 0x0000000000009530ULL, 0x00000000000097E0ULL, 0x0000000000009650ULL,
+        0x0000000000009240ULL, 0x00000000000093F0ULL, 0x0000000000009120ULL, 0x0000000000009090ULL
+    },
+    {
+        0x0000000000000000ULL, 0xF500000000000001ULL, 0x5A00000000000003ULL, 0xAF00000000000002ULL,
+        0xB400000000000006ULL, 0x4100000000000007ULL, 0xEE00000000000005ULL, 0x1B00000000000004ULL,
+        0xD80000000000000DULL, 0x2D0000000000000CULL, 0x820000000000000EULL, 0x770000000000000FULL,
+        0x6C0000000000000BULL, 0x990000000000000AULL, 0x3600000000000008ULL, 0xC300000000000009ULL,
+        0x000000000000001BULL, 0xF50000000000001AULL, 0x5A00000000000018ULL, 0xAF00000000000019ULL,
+        0xB40000000000001DULL, 0x410000000000001CULL, 0xEE0000000000001EULL, 0x1B0000000000001FULL,
+        0xD800000000000016ULL, 0x2D00000000000017ULL, 0x8200000000000015ULL, 0x7700000000000014ULL,
+        0x6C00000000000010ULL, 0x9900000000000011ULL, 0x3600000000000013ULL, 0xC300000000000012ULL,
+        0x0000000000000036ULL, 0xF500000000000037ULL, 0x5A00000000000035ULL, 0xAF00000000000034ULL,
+        0xB400000000000030ULL, 0x4100000000000031ULL, 0xEE00000000000033ULL, 0x1B00000000000032ULL,
+        0xD80000000000003BULL, 0x2D0000000000003AULL, 0x8200000000000038ULL, 0x7700000000000039ULL,
+        0x6C0000000000003DULL, 0x990000000000003CULL, 0x360000000000003EULL, 0xC30000000000003FULL,
+        0x000000000000002DULL, 0xF50000000000002CULL, 0x5A0000000000002EULL, 0xAF0000000000002FULL,
+        0xB40000000000002BULL, 0x410000000000002AULL, 0xEE00000000000028ULL, 0x1B00000000000029ULL,
+        0xD800000000000020ULL, 0x2D00000000000021ULL, 0x8200000000000023ULL, 0x7700000000000022ULL,
+        0x6C00000000000026ULL, 0x9900000000000027ULL, 0x3600000000000025ULL, 0xC300000000000024ULL,
+        0x000000000000006CULL, 0xF50000000000006DULL, 0x5A0000000000006FULL, 0xAF0000000000006EULL,
+        0xB40000000000006AULL, 0x410000000000006BULL, 0xEE00000000000069ULL, 0x1B00000000000068ULL,
+        0xD800000000000061ULL, 0x2D00000000000060ULL, 0x8200000000000062ULL, 0x7700000000000063ULL,
+        0x6C00000000000067ULL, 0x9900000000000066ULL, 0x3600000000000064ULL, 0xC300000000000065ULL,
+        0x0000000000000077ULL, 0xF500000000000076ULL, 0x5A00000000000074ULL, 0xAF00000000000075ULL,
+        0xB400000000000071ULL, 0x4100000000000070ULL, 0xEE00000000000072ULL, 0x1B00000000000073ULL,
+        0xD80000000000007AULL, 0x2D0000000000007BULL, 0x8200000000000079ULL, 0x7700000000000078ULL,
+        0x6C0000000000007CULL, 0x990000000000007DULL, 0x360000000000007FULL, 0xC30000000000007EULL,
+        0x000000000000005AULL, 0xF50000000000005BULL, 0x5A00000000000059ULL, 0xAF00000000000058ULL,
+        0xB40000000000005CULL, 0x410000000000005DULL, 0xEE0000000000005FULL, 0x1B0000000000005EULL,
+        0xD800000000000057ULL, 0x2D00000000000056ULL, 0x8200000000000054ULL, 0x7700000000000055ULL,
+        0x6C00000000000051ULL, 0x9900000000000050ULL, 0x3600000000000052ULL, 0xC300000000000053ULL,
+        0x0000000000000041ULL, 0xF500000000000040ULL, 0x5A00000000000042ULL, 0xAF00000000000043ULL,
+        0xB400000000000047ULL, 0x4100000000000046ULL, 0xEE00000000000044ULL, 0x1B00000000000045ULL,
+        0xD80000000000004CULL, 0x2D0000000000004DULL, 0x820000000000004FULL, 0x770000000000004EULL,
+        0x6C0000000000004AULL, 0x990000000000004BULL, 0x3600000000000049ULL, 0xC300000000000048ULL,
+        0x00000000000000D8ULL, 0xF5000000000000D9ULL, 0x5A000000000000DBULL, 0xAF000000000000DAULL,
+        0xB4000000000000DEULL, 0x41000000000000DFULL, 0xEE000000000000DDULL, 0x1B000000000000DCULL,
+        0xD8000000000000D5ULL, 0x2D000000000000D4ULL, 0x82000000000000D6ULL, 0x77000000000000D7ULL,
+        0x6C000000000000D3ULL, 0x99000000000000D2ULL, 0x36000000000000D0ULL, 0xC3000000000000D1ULL,
+        0x00000000000000C3ULL, 0xF5000000000000C2ULL, 0x5A000000000000C0ULL, 0xAF000000000000C1ULL,
+        0xB4000000000000C5ULL, 0x41000000000000C4ULL, 0xEE000000000000C6ULL, 0x1B000000000000C7ULL,
+        0xD8000000000000CEULL, 0x2D000000000000CFULL, 0x82000000000000CDULL, 0x77000000000000CCULL,
+        0x6C000000000000C8ULL, 0x99000000000000C9ULL, 0x36000000000000CBULL, 0xC3000000000000CAULL,
+        0x00000000000000EEULL, 0xF5000000000000EFULL, 0x5A000000000000EDULL, 0xAF000000000000ECULL,
+        0xB4000000000000E8ULL, 0x41000000000000E9ULL, 0xEE000000000000EBULL, 0x1B000000000000EAULL,
+        0xD8000000000000E3ULL, 0x2D000000000000E2ULL, 0x82000000000000E0ULL, 0x77000000000000E1ULL,
+        0x6C000000000000E5ULL, 0x99000000000000E4ULL, 0x36000000000000E6ULL, 0xC3000000000000E7ULL,
+        0x00000000000000F5ULL, 0xF5000000000000F4ULL, 0x5A000000000000F6ULL, 0xAF000000000000F7ULL,
+        0xB4000000000000F3ULL, 0x41000000000000F2ULL, 0xEE000000000000F0ULL, 0x1B000000000000F1ULL,
+        0xD8000000000000F8ULL, 0x2D000000000000F9ULL, 0x82000000000000FBULL, 0x77000000000000FAULL,
+        0x6C000000000000FEULL, 0x99000000000000FFULL, 0x36000000000000FDULL, 0xC3000000000000FCULL,
+        0x00000000000000B4ULL, 0xF5000000000000B5ULL, 0x5A000000000000B7ULL, 0xAF000000000000B6ULL,
+        0xB4000000000000B2ULL, 0x41000000000000B3ULL, 0xEE000000000000B1ULL, 0x1B000000000000B0ULL,
+        0xD8000000000000B9ULL, 0x2D000000000000B8ULL, 0x82000000000000BAULL, 0x77000000000000BBULL,
+        0x6C000000000000BFULL, 0x99000000000000BEULL, 0x36000000000000BCULL, 0xC3000000000000BDULL,
+        0x00000000000000AFULL, 0xF5000000000000AEULL, 0x5A000000000000ACULL, 0xAF000000000000ADULL,
+        0xB4000000000000A9ULL, 0x41000000000000A8ULL, 0xEE000000000000AAULL, 0x1B000000000000ABULL,
+        0xD8000000000000A2ULL, 0x2D000000000000A3ULL, 0x82000000000000A1ULL, 0x77000000000000A0ULL,
+        0x6C000000000000A4ULL, 0x99000000000000A5ULL, 0x36000000000000A7ULL, 0xC3000000000000A6ULL,
+        0x0000000000000082ULL, 0xF500000000000083ULL, 0x5A00000000000081ULL, 0xAF00000000000080ULL,
+        0xB400000000000084ULL, 0x4100000000000085ULL, 0xEE00000000000087ULL, 0x1B00000000000086ULL,
+        0xD80000000000008FULL, 0x2D0000000000008EULL, 0x820000000000008CULL, 0x770000000000008DULL,
+        0x6C00000000000089ULL, 0x9900000000000088ULL, 0x360000000000008AULL, 0xC30000000000008BULL,
+        0x0000000000000099ULL, 0xF500000000000098ULL, 0x5A0000000000009AULL, 0xAF0000000000009BULL,
+        0xB40000000000009FULL, 0x410000000000009EULL, 0xEE0000000000009CULL, 0x1B0000000000009DULL,
+        0xD800000000000094ULL, 0x2D00000000000095ULL, 0x8200000000000097ULL, 0x7700000000000096ULL,
+        0x6C00000000000092ULL, 0x9900000000000093ULL, 0x3600000000000091ULL, 0xC300000000000090ULL
+    }
+};
+
+#ifdef RTCRC_WITH_PCLMUL
+/** PCLMULQDQ folding constants for the CRC-64-ISO polynomial. */
+static RTCRCFOLDCONSTS const g_Crc64FoldConsts =
 {
-    0x0000000000000000ULL, 0x01B0000000000000ULL, 0x0360000000000000ULL, 0x02D0000000000000ULL,
-    0x06C0000000000000ULL, 0x0770000000000000ULL, 0x05A0000000000000ULL, 0x0410000000000000ULL,
-    0x0D80000000000000ULL, 0x0C30000000000000ULL, 0x0EE0000000000000ULL, 0x0F50000000000000ULL,
-    0x0B40000000000000ULL, 0x0AF0000000000000ULL, 0x0820000000000000ULL, 0x0990000000000000ULL,
-    0x1B00000000000000ULL, 0x1AB0000000000000ULL, 0x1860000000000000ULL, 0x19D0000000000000ULL,
-    0x1DC0000000000000ULL, 0x1C70000000000000ULL, 0x1EA0000000000000ULL, 0x1F10000000000000ULL,
-    0x1680000000000000ULL, 0x1730000000000000ULL, 0x15E0000000000000ULL, 0x1450000000000000ULL,
-    0x1040000000000000ULL, 0x11F0000000000000ULL, 0x1320000000000000ULL, 0x1290000000000000ULL,
-    0x3600000000000000ULL, 0x37B0000000000000ULL, 0x3560000000000000ULL, 0x34D0000000000000ULL,
-    0x30C0000000000000ULL, 0x3170000000000000ULL, 0x33A0000000000000ULL, 0x3210000000000000ULL,
-    0x3B80000000000000ULL, 0x3A30000000000000ULL, 0x38E0000000000000ULL, 0x3950000000000000ULL,
-    0x3D40000000000000ULL, 0x3CF0000000000000ULL, 0x3E20000000000000ULL, 0x3F90000000000000ULL,
-    0x2D00000000000000ULL, 0x2CB0000000000000ULL, 0x2E60000000000000ULL, 0x2FD0000000000000ULL,
-    0x2BC0000000000000ULL, 0x2A70000000000000ULL, 0x28A0000000000000ULL, 0x2910000000000000ULL,
-    0x2080000000000000ULL, 0x2130000000000000ULL, 0x23E0000000000000ULL, 0x2250000000000000ULL,
-    0x2640000000000000ULL, 0x27F0000000000000ULL, 0x2520000000000000ULL, 0x2490000000000000ULL,
-    0x6C00000000000000ULL, 0x6DB0000000000000ULL, 0x6F60000000000000ULL, 0x6ED0000000000000ULL,
-    0x6AC0000000000000ULL, 0x6B70000000000000ULL, 0x69A0000000000000ULL, 0x6810000000000000ULL,
-    0x6180000000000000ULL, 0x6030000000000000ULL, 0x62E0000000000000ULL, 0x6350000000000000ULL,
-    0x6740000000000000ULL, 0x66F0000000000000ULL, 0x6420000000000000ULL, 0x6590000000000000ULL,
-    0x7700000000000000ULL, 0x76B0000000000000ULL, 0x7460000000000000ULL, 0x75D0000000000000ULL,
-    0x71C0000000000000ULL, 0x7070000000000000ULL, 0x72A0000000000000ULL, 0x7310000000000000ULL,
-    0x7A80000000000000ULL, 0x7B30000000000000ULL, 0x79E0000000000000ULL, 0x7850000000000000ULL,
-    0x7C40000000000000ULL, 0x7DF0000000000000ULL, 0x7F20000000000000ULL, 0x7E90000000000000ULL,
-    0x5A00000000000000ULL, 0x5BB0000000000000ULL, 0x5960000000000000ULL, 0x58D0000000000000ULL,
-    0x5CC0000000000000ULL, 0x5D70000000000000ULL, 0x5FA0000000000000ULL, 0x5E10000000000000ULL,
-    0x5780000000000000ULL, 0x5630000000000000ULL, 0x54E0000000000000ULL, 0x5550000000000000ULL,
-    0x5140000000000000ULL, 0x50F0000000000000ULL, 0x5220000000000000ULL, 0x5390000000000000ULL,
-    0x4100000000000000ULL, 0x40B0000000000000ULL, 0x4260000000000000ULL, 0x43D0000000000000ULL,
-    0x47C0000000000000ULL, 0x4670000000000000ULL, 0x44A0000000000000ULL, 0x4510000000000000ULL,
-    0x4C80000000000000ULL, 0x4D30000000000000ULL, 0x4FE0000000000000ULL, 0x4E50000000000000ULL,
-    0x4A40000000000000ULL, 0x4BF0000000000000ULL, 0x4920000000000000ULL, 0x4890000000000000ULL,
-    0xD800000000000000ULL, 0xD9B0000000000000ULL, 0xDB60000000000000ULL, 0xDAD0000000000000ULL,
-    0xDEC0000000000000ULL, 0xDF70000000000000ULL, 0xDDA0000000000000ULL, 0xDC10000000000000ULL,
-    0xD580000000000000ULL, 0xD430000000000000ULL, 0xD6E0000000000000ULL, 0xD750000000000000ULL,
-    0xD340000000000000ULL, 0xD2F0000000000000ULL, 0xD020000000000000ULL, 0xD190000000000000ULL,
-    0xC300000000000000ULL, 0xC2B0000000000000ULL, 0xC060000000000000ULL, 0xC1D0000000000000ULL,
-    0xC5C0000000000000ULL, 0xC470000000000000ULL, 0xC6A0000000000000ULL, 0xC710000000000000ULL,
-    0xCE80000000000000ULL, 0xCF30000000000000ULL, 0xCDE0000000000000ULL, 0xCC50000000000000ULL,
-    0xC840000000000000ULL, 0xC9F0000000000000ULL, 0xCB20000000000000ULL, 0xCA90000000000000ULL,
-    0xEE00000000000000ULL, 0xEFB0000000000000ULL, 0xED60000000000000ULL, 0xECD0000000000000ULL,
-    0xE8C0000000000000ULL, 0xE970000000000000ULL, 0xEBA0000000000000ULL, 0xEA10000000000000ULL,
-    0xE380000000000000ULL, 0xE230000000000000ULL, 0xE0E0000000000000ULL, 0xE150000000000000ULL,
-    0xE540000000000000ULL, 0xE4F0000000000000ULL, 0xE620000000000000ULL, 0xE790000000000000ULL,
-    0xF500000000000000ULL, 0xF4B0000000000000ULL, 0xF660000000000000ULL, 0xF7D0000000000000ULL,
-    0xF3C0000000000000ULL, 0xF270000000000000ULL, 0xF0A0000000000000ULL, 0xF110000000000000ULL,
-    0xF880000000000000ULL, 0xF930000000000000ULL, 0xFBE0000000000000ULL, 0xFA50000000000000ULL,
-    0xFE40000000000000ULL, 0xFFF0000000000000ULL, 0xFD20000000000000ULL, 0xFC90000000000000ULL,
-    0xB400000000000000ULL, 0xB5B0000000000000ULL, 0xB760000000000000ULL, 0xB6D0000000000000ULL,
-    0xB2C0000000000000ULL, 0xB370000000000000ULL, 0xB1A0000000000000ULL, 0xB010000000000000ULL,
-    0xB980000000000000ULL, 0xB830000000000000ULL, 0xBAE0000000000000ULL, 0xBB50000000000000ULL,
-    0xBF40000000000000ULL, 0xBEF0000000000000ULL, 0xBC20000000000000ULL, 0xBD90000000000000ULL,
-    0xAF00000000000000ULL, 0xAEB0000000000000ULL, 0xAC60000000000000ULL, 0xADD0000000000000ULL,
-    0xA9C0000000000000ULL, 0xA870000000000000ULL, 0xAAA0000000000000ULL, 0xAB10000000000000ULL,
-    0xA280000000000000ULL, 0xA330000000000000ULL, 0xA1E0000000000000ULL, 0xA050000000000000ULL,
-    0xA440000000000000ULL, 0xA5F0000000000000ULL, 0xA720000000000000ULL, 0xA690000000000000ULL,
-    0x8200000000000000ULL, 0x83B0000000000000ULL, 0x8160000000000000ULL, 0x80D0000000000000ULL,
-    0x84C0000000000000ULL, 0x8570000000000000ULL, 0x87A0000000000000ULL, 0x8610000000000000ULL,
-    0x8F80000000000000ULL, 0x8E30000000000000ULL, 0x8CE0000000000000ULL, 0x8D50000000000000ULL,
-    0x8940000000000000ULL, 0x88F0000000000000ULL, 0x8A20000000000000ULL, 0x8B90000000000000ULL,
-    0x9900000000000000ULL, 0x98B0000000000000ULL, 0x9A60000000000000ULL, 0x9BD0000000000000ULL,
-    0x9FC0000000000000ULL, 0x9E70000000000000ULL, 0x9CA0000000000000ULL, 0x9D10000000000000ULL,
-    0x9480000000000000ULL, 0x9530000000000000ULL, 0x97E0000000000000ULL, 0x9650000000000000ULL,
-    0x9240000000000000ULL, 0x93F0000000000000ULL, 0x9120000000000000ULL, 0x9090000000000000ULL
+    { UINT64_C(0x01b001b1b0000001), UINT64_C(0xb100010100000001) },
+    { UINT64_C(0x6b70000000000001), UINT64_C(0xf500000000000001) },
 };
+/** RTCRC_F_XXX for the current CPU, zero if not yet initialized. */
+static uint32_t volatile g_fCrc64Cpu = 0;
+#endif
+
+
+/**
+ * Updates the CRC64 shift register using the slicing-by-8 tables.
+ *
+ * @returns Updated shift register.
+ * @param   uReg        The shift register.
+ * @param   pb          The data.
+ * @param   cb          Number of bytes.
+ */
+static uint64_t rtCrc64UpdateSlice8(uint64_t uReg, uint8_t const *pb, size_t cb)
+{
+    while (cb >= 8)
+    {
+        uint64_t const u = uReg ^ rtCrcReadU64LE(pb);
+        uReg = g_aau64Crc64[7][u & 0xff]
+             ^ g_aau64Crc64[6][(u >>  8) & 0xff]
+             ^ g_aau64Crc64[5][(u >> 16) & 0xff]
+             ^ g_aau64Crc64[4][(u >> 24) & 0xff]
+             ^ g_aau64Crc64[3][(u >> 32) & 0xff]
+             ^ g_aau64Crc64[2][(u >> 40) & 0xff]
+             ^ g_aau64Crc64[1][(u >> 48) & 0xff]
+             ^ g_aau64Crc64[0][u >> 56];
+        pb += 8;
+        cb -= 8;
+    }
+    while (cb-- > 0)
+        uReg = g_aau64Crc64[0][(uReg ^ *pb++) & 0xff] ^ (uReg >> 8);
+    return uReg;
+}
+
+
+#ifdef RTCRC_WITH_PCLMUL
+/**
+ * Updates the CRC64 shift register using PCLMULQDQ folding.
+ *
+ * @returns Updated shift register.
+ * @param   uReg        The shift register.
+ * @param   pb          The data.
+ * @param   cb          Number of bytes, at least RTCRC_PCLMUL_MIN.
+ */
+static RTCRC_PCLMUL_FN uint64_t rtCrc64UpdatePclmul(uint64_t uReg, uint8_t const *pb, size_t cb)
+{
+    uint8_t      abAcc[16];
+    size_t const cBlocks = cb / 16;
+    rtCrcFoldPclmul(&g_Crc64FoldConsts, uReg, pb, cBlocks, abAcc);
+    uReg = rtCrc64UpdateSlice8(0, abAcc, sizeof(abAcc));
+    return rtCrc64UpdateSlice8(uReg, pb + cBlocks * 16, cb & 15);
+}
+#endif
+
+
+/**
+ * Updates the CRC64 shift register, picking the fastest method available.
+ *
+ * @returns Updated shift register.
+ * @param   uReg        The shift register.
+ * @param   pv          The data.
+ * @param   cb          Number of bytes.
+ */
+static uint64_t rtCrc64Update(uint64_t uReg, const void *pv, size_t cb)
+{
+#ifdef RTCRC_WITH_PCLMUL
+    if (cb >= RTCRC_PCLMUL_MIN)
+    {
+        uint32_t fCpu = g_fCrc64Cpu;
+        if (RT_UNLIKELY(!fCpu))
+            fCpu = rtCrcInitCpu(&g_fCrc64Cpu);
+        if (fCpu & RTCRC_F_PCLMUL)
+            return rtCrc64UpdatePclmul(uReg, (uint8_t const *)pv, cb);
+    }
+#endif
+    return rtCrc64UpdateSlice8(uReg, (uint8_t const *)pv, cb);
+}
 
 
 /**
@@ -159,11 +709,7 @@ static const uint64_t g_au64CRC64[] =
  */
 RTDECL(uint64_t) RTCrc64(const void *pv, size_t cb)
 {
-    const uint8_t  *pu8 = (const uint8_t *)pv;
-    uint64_t        uCRC64 = 0ULL;
-    while (cb--)
-        uCRC64 = g_au64CRC64[(uCRC64 ^ *pu8++) & 0xff] ^ (uCRC64 >> 8);
-    return uCRC64;
+    return rtCrc64Update(0, pv, cb);
 }
 RT_EXPORT_SYMBOL(RTCrc64);
 
@@ -190,10 +736,7 @@ RT_EXPORT_SYMBOL(RTCrc64Start);
  */
 RTDECL(uint64_t) RTCrc64Process(uint64_t uCRC64, const void *pv, size_t cb)
 {
-    const uint8_t *pu8 = (const uint8_t *)pv;
-    while (cb--)
-        uCRC64 = g_au64CRC64[(uCRC64 ^ *pu8++) & 0xff] ^ (uCRC64 >> 8);
-    return uCRC64;
+    return rtCrc64Update(uCRC64, pv, cb);
 }
 RT_EXPORT_SYMBOL(RTCrc64Process);
 
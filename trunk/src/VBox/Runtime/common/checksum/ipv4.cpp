@@ -33,6 +33,56 @@
 
 #include <iprt/asm.h>
 #include <iprt/assert.h>
+#if defined(IN_RING3) && defined(RT_ARCH_AMD64) && (defined(__GNUC__) || defined(_MSC_VER))
+# include <iprt/asm-amd64-x86.h>
+# include <iprt/x86.h>
+# include <emmintrin.h>
+# if defined(_MSC_VER) ? _MSC_VER >= 1700 : RT_GNUC_PREREQ(4, 9) || defined(__clang__)
+#  include <immintrin.h>
+# endif
+#endif
+
+
+/*********************************************************************************************************************************
+*   Defined Constants And Macros                                                                                                 *
+*********************************************************************************************************************************/
+/** @def RTNETCSUM_WITH_SSE2
+ * Use vector kernels for the data checksumming.  Ring-3 only, since the
+ * kernel contexts would have to save the FPU state around them, and AMD64
+ * only so SSE2 is a given. */
+#if defined(IN_RING3) && defined(RT_ARCH_AMD64) && (defined(__GNUC__) || defined(_MSC_VER))
+# define RTNETCSUM_WITH_SSE2
+/** @def RTNETCSUM_WITH_AVX2
+ * Compile the AVX2 kernel too (selected at runtime). */
+# if defined(_MSC_VER) ? _MSC_VER >= 1700 : RT_GNUC_PREREQ(4, 9) || defined(__clang__)
+#  define RTNETCSUM_WITH_AVX2
+#  ifdef _MSC_VER
+#   define RTNETCSUM_AVX2_FN
+#  else
+#   define RTNETCSUM_AVX2_FN     __attribute__((__target__("avx2")))
+#  endif
+# endif
+#endif
+/** Don't bother with the vector kernels for less than this many bytes. */
+#define RTNETCSUM_SIMD_MIN                  128
+/** Max vector blocks to sum before folding the 32-bit lanes.  Each block
+ * adds at most 2 * 0xffff to a lane, so this keeps them below 2^31. */
+#define RTNETCSUM_MAX_BLOCKS_PER_FOLD       _16K
+/** @name RTNETCSUM_F_XXX - g_fRtNetCSumCpu flags.
+ * @{ */
+#define RTNETCSUM_F_INITIALIZED             RT_BIT_32(0)
+#define RTNETCSUM_F_AVX2                    RT_BIT_32(1)
+/** @} */
+
+
+/*********************************************************************************************************************************
+*   Global Variables                                                                                                             *
+*********************************************************************************************************************************/
+#ifdef RTNETCSUM_WITH_SSE2
+/** The vector kernels the host supports (RTNETCSUM_F_XXX), 0 if not yet
+ * determined. */
+static uint32_t volatile g_fRtNetCSumCpu = 0;
+#endif
 
 
 /**
@@ -285,10 +335,252 @@ RTDECL(uint32_t) RTNetIPv4AddTCPChecksum(PCRTNETTCP pTcpHdr, uint32_t u32Sum)
 RT_EXPORT_SYMBOL(RTNetIPv4AddTCPChecksum);
 
 
+#ifdef RTNETCSUM_WITH_SSE2
 /**
- * Adds the checksum of the specified data segment to the intermediate checksum value [inlined].
+ * Detects which of the vector checksum kernels the host CPU supports.
+ *
+ * @returns RTNETCSUM_F_XXX.
+ */
+static uint32_t rtNetCSumInitCpu(void)
+{
+    uint32_t fCpu = RTNETCSUM_F_INITIALIZED;
+# ifdef RTNETCSUM_WITH_AVX2
+    uint32_t uEAX, uEBX, uECX, uEDX;
+    ASMCpuId(0, &uEAX, &uEBX, &uECX, &uEDX);
+    if (uEAX >= 7)
+    {
+        ASMCpuId(1, &uEAX, &uEBX, &uECX, &uEDX);
+        if (   (uECX & (X86_CPUID_FEATURE_ECX_OSXSAVE | X86_CPUID_FEATURE_ECX_AVX))
+            == (X86_CPUID_FEATURE_ECX_OSXSAVE | X86_CPUID_FEATURE_ECX_AVX)
+            && (ASMGetXcr0() & (XSAVE_C_SSE | XSAVE_C_YMM)) == (XSAVE_C_SSE | XSAVE_C_YMM))
+        {
+            ASMCpuId_Idx_ECX(7, 0, &uEAX, &uEBX, &uECX, &uEDX);
+            if (uEBX & X86_CPUID_STEXT_FEATURE_EBX_AVX2)
+                fCpu |= RTNETCSUM_F_AVX2;
+        }
+    }
+# endif
+    ASMAtomicWriteU32(&g_fRtNetCSumCpu, fCpu);
+    return fCpu;
+}
+
+
+/**
+ * Folds the 32-bit lanes of a SSE2 accumulator into a 64-bit sum.
+ */
+DECLINLINE(uint64_t) rtNetCSumFoldSse2(__m128i uAcc)
+{
+    uint32_t au32[4];
+    _mm_storeu_si128((__m128i *)&au32[0], uAcc);
+    return (uint64_t)au32[0] + au32[1] + au32[2] + au32[3];
+}
+
+
+/**
+ * SSE2 kernel: sums (and optionally copies) @a cBlocks blocks of 32 bytes.
+ *
+ * Each 32-bit lane is split into its two 16-bit words which are accumulated
+ * separately, so the lanes can take 0x8000 loads before they need folding.
+ *
+ * @returns 64-bit intermediate sum of the 16-bit words.
+ * @param   pbDst           Where to copy the data to, NULL if not copying.
+ * @param   pbSrc           The data.
+ * @param   cBlocks         Number of 32 byte blocks.
+ */
+static uint64_t rtNetCSumSse2(uint8_t *pbDst, uint8_t const *pbSrc, size_t cBlocks)
+{
+    __m128i const fLowWords = _mm_set1_epi32(0xffff);
+    uint64_t      uSum      = 0;
+    while (cBlocks > 0)
+    {
+        size_t  cThis = RT_MIN(cBlocks, RTNETCSUM_MAX_BLOCKS_PER_FOLD);
+        __m128i uLo   = _mm_setzero_si128();
+        __m128i uHi   = _mm_setzero_si128();
+        cBlocks -= cThis;
+        if (pbDst)
+            while (cThis-- > 0)
+            {
+                __m128i const u0 = _mm_loadu_si128((__m128i const *)pbSrc);
+                __m128i const u1 = _mm_loadu_si128((__m128i const *)(pbSrc + 16));
+                _mm_storeu_si128((__m128i *)pbDst, u0);
+                _mm_storeu_si128((__m128i *)(pbDst + 16), u1);
+                uLo = _mm_add_epi32(uLo, _mm_and_si128(u0, fLowWords));
+                uHi = _mm_add_epi32(uHi, _mm_srli_epi32(u0, 16));
+                uLo = _mm_add_epi32(uLo, _mm_and_si128(u1, fLowWords));
+                uHi = _mm_add_epi32(uHi, _mm_srli_epi32(u1, 16));
+                pbSrc += 32;
+                pbDst += 32;
+            }
+        else
+            while (cThis-- > 0)
+            {
+                __m128i const u0 = _mm_loadu_si128((__m128i const *)pbSrc);
+                __m128i const u1 = _mm_loadu_si128((__m128i const *)(pbSrc + 16));
+                uLo = _mm_add_epi32(uLo, _mm_and_si128(u0, fLowWords));
+                uHi = _mm_add_epi32(uHi, _mm_srli_epi32(u0, 16));
+                uLo = _mm_add_epi32(uLo, _mm_and_si128(u1, fLowWords));
+                uHi = _mm_add_epi32(uHi, _mm_srli_epi32(u1, 16));
+                pbSrc += 32;
+            }
+        uSum += rtNetCSumFoldSse2(uLo) + rtNetCSumFoldSse2(uHi);
+    }
+    return uSum;
+}
+
+
+# ifdef RTNETCSUM_WITH_AVX2
+/**
+ * Folds the 32-bit lanes of an AVX2 accumulator into a 64-bit sum.
+ */
+RTNETCSUM_AVX2_FN DECLINLINE(uint64_t) rtNetCSumFoldAvx2(__m256i uAcc)
+{
+    return rtNetCSumFoldSse2(_mm256_castsi256_si128(uAcc)) + rtNetCSumFoldSse2(_mm256_extracti128_si256(uAcc, 1));
+}
+
+
+/**
+ * AVX2 kernel: sums (and optionally copies) @a cBlocks blocks of 64 bytes.
+ *
+ * @returns 64-bit intermediate sum of the 16-bit words.
+ * @param   pbDst           Where to copy the data to, NULL if not copying.
+ * @param   pbSrc           The data.
+ * @param   cBlocks         Number of 64 byte blocks.
+ */
+RTNETCSUM_AVX2_FN static uint64_t rtNetCSumAvx2(uint8_t *pbDst, uint8_t const *pbSrc, size_t cBlocks)
+{
+    __m256i const fLowWords = _mm256_set1_epi32(0xffff);
+    uint64_t      uSum      = 0;
+    while (cBlocks > 0)
+    {
+        size_t  cThis = RT_MIN(cBlocks, RTNETCSUM_MAX_BLOCKS_PER_FOLD);
+        __m256i uLo   = _mm256_setzero_si256();
+        __m256i uHi   = _mm256_setzero_si256();
+        cBlocks -= cThis;
+        if (pbDst)
+            while (cThis-- > 0)
+            {
+                __m256i const u0 = _mm256_loadu_si256((__m256i const *)pbSrc);
+                __m256i const u1 = _mm256_loadu_si256((__m256i const *)(pbSrc + 32));
+                _mm256_storeu_si256((__m256i *)pbDst, u0);
+                _mm256_storeu_si256((__m256i *)(pbDst + 32), u1);
+                uLo = _mm256_add_epi32(uLo, _mm256_and_si256(u0, fLowWords));
+                uHi = _mm256_add_epi32(uHi, _mm256_srli_epi32(u0, 16));
+                uLo = _mm256_add_epi32(uLo, _mm256_and_si256(u1, fLowWords));
+                uHi = _mm256_add_epi32(uHi, _mm256_srli_epi32(u1, 16));
+                pbSrc += 64;
+                pbDst += 64;
+            }
+        else
+            while (cThis-- > 0)
+            {
+                __m256i const u0 = _mm256_loadu_si256((__m256i const *)pbSrc);
+                __m256i const u1 = _mm256_loadu_si256((__m256i const *)(pbSrc + 32));
+                uLo = _mm256_add_epi32(uLo, _mm256_and_si256(u0, fLowWords));
+                uHi = _mm256_add_epi32(uHi, _mm256_srli_epi32(u0, 16));
+                uLo = _mm256_add_epi32(uLo, _mm256_and_si256(u1, fLowWords));
+                uHi = _mm256_add_epi32(uHi, _mm256_srli_epi32(u1, 16));
+                pbSrc += 64;
+            }
+        uSum += rtNetCSumFoldAvx2(uLo) + rtNetCSumFoldAvx2(uHi);
+    }
+    _mm256_zeroupper();
+    return uSum;
+}
+# endif /* RTNETCSUM_WITH_AVX2 */
+#endif /* RTNETCSUM_WITH_SSE2 */
+
+
+/**
+ * Sums (and optionally copies) the 16-bit words of a word aligned stretch of
+ * the data stream.
+ *
+ * This picks the widest kernel the host supports for the bulk and does the
+ * rest 32 bits at the time into a 64-bit accumulator.
+ *
+ * @returns 64-bit intermediate sum of the 16-bit words.
+ * @param   pbDst           Where to copy the data to, NULL if not copying.
+ * @param   pbSrc           The data.
+ * @param   cb              The number of bytes, even.
+ */
+static uint64_t rtNetCSumWords(uint8_t *pbDst, uint8_t const *pbSrc, size_t cb)
+{
+    Assert(!(cb & 1));
+    uint64_t uSum = 0;
+
+#ifdef RTNETCSUM_WITH_SSE2
+    if (cb >= RTNETCSUM_SIMD_MIN)
+    {
+        uint32_t fCpu = g_fRtNetCSumCpu;
+        if (RT_UNLIKELY(!fCpu))
+            fCpu = rtNetCSumInitCpu();
+        size_t cbDone;
+# ifdef RTNETCSUM_WITH_AVX2
+        if (fCpu & RTNETCSUM_F_AVX2)
+        {
+            uSum   = rtNetCSumAvx2(pbDst, pbSrc, cb / 64);
+            cbDone = cb & ~(size_t)63;
+        }
+        else
+# endif
+        {
+            uSum   = rtNetCSumSse2(pbDst, pbSrc, cb / 32);
+            cbDone = cb & ~(size_t)31;
+        }
+        pbSrc += cbDone;
+        cb    -= cbDone;
+        if (pbDst)
+            pbDst += cbDone;
+    }
+#endif
+
+#if !defined(RT_ARCH_AMD64) && !defined(RT_ARCH_X86)
+    if (!((uintptr_t)pbSrc & 3) && !((uintptr_t)pbDst & 3))
+#endif
+    {
+        uint32_t const *pu32Src = (uint32_t const *)pbSrc;
+        size_t          cDWords = cb / 4;
+        if (pbDst)
+        {
+            uint32_t *pu32Dst = (uint32_t *)pbDst;
+            while (cDWords-- > 0)
+            {
+                uint32_t const u32 = *pu32Src++;
+                *pu32Dst++ = u32;
+                uSum += u32;
+            }
+            pbDst = (uint8_t *)pu32Dst;
+        }
+        else
+        {
+            for (; cDWords >= 4; cDWords -= 4, pu32Src += 4)
+                uSum += (uint64_t)pu32Src[0] + pu32Src[1] + pu32Src[2] + pu32Src[3];
+            while (cDWords-- > 0)
+                uSum += *pu32Src++;
+        }
+        pbSrc = (uint8_t const *)pu32Src;
+        cb   &= 3;
+    }
+
+    uint16_t const *pu16Src = (uint16_t const *)pbSrc;
+    for (; cb >= 2; cb -= 2)
+    {
+        uint16_t const u16 = *pu16Src++;
+        if (pbDst)
+        {
+            *(uint16_t *)pbDst = u16;
+            pbDst += 2;
+        }
+        uSum += u16;
+    }
+    return uSum;
+}
+
+
+/**
+ * Worker for RTNetIPv4AddDataChecksum and RTNetIPv4AddDataChecksumCopy.
  *
  * @returns 32-bit intermediary checksum value.
+ * @param   pvDst           Where to copy the data to, NULL if not copying.
  * @param   pvData          Pointer to the data that should be checksummed.
  * @param   cbData          The number of bytes to checksum.
  * @param   u32Sum          The 32-bit intermediate checksum value.
@@ -296,48 +588,71 @@ RT_EXPORT_SYMBOL(RTNetIPv4AddTCPChecksum);
  *                          when starting to checksum the data (aka text) after a TCP
  *                          or UDP header (data never start at an odd offset).
  */
-DECLINLINE(uint32_t) rtNetIPv4AddDataChecksum(void const *pvData, size_t cbData, uint32_t u32Sum, bool *pfOdd)
+static uint32_t rtNetIPv4AddDataChecksumWorker(void *pvDst, void const *pvData, size_t cbData, uint32_t u32Sum, bool *pfOdd)
 {
-    uint16_t const *pw = (uint16_t const *)pvData;
+    uint8_t const *pbSrc = (uint8_t const *)pvData;
+    uint8_t       *pbDst = (uint8_t *)pvDst;
+    if (!cbData)
+        return u32Sum;
+
     if (*pfOdd)
     {
 #ifdef RT_BIG_ENDIAN
         /* there was an odd byte in the previous chunk, add the lower byte. */
-        u32Sum += *(uint8_t *)pvData;
+        u32Sum += *pbSrc;
 #else
         /* there was an odd byte in the previous chunk, add the upper byte. */
-        u32Sum += (uint32_t)*(uint8_t *)pvData << 8;
+        u32Sum += (uint32_t)*pbSrc << 8;
 #endif
         /* skip the byte. */
+        if (pbDst)
+            *pbDst++ = *pbSrc;
+        pbSrc++;
         cbData--;
-        if (!cbData)
-            return u32Sum;
-        pvData = (uint8_t const *)pvData + 1;
+        *pfOdd = false;
     }
 
     /* iterate the data. */
-    while (cbData > 1)
-    {
-        u32Sum += *pw;
-        pw++;
-        cbData -= 2;
-    }
+    uint64_t uSum64 = rtNetCSumWords(pbDst, pbSrc, cbData & ~(size_t)1);
+
+    /* fold it down to 17 bits before adding it to the caller's sum. */
+    uSum64 = (uSum64 >> 32) + (uSum64 & UINT32_MAX);
+    uSum64 = (uSum64 >> 32) + (uSum64 & UINT32_MAX);
+    u32Sum += (uint32_t)(uSum64 >> 16) + (uint32_t)(uSum64 & 0xffff);
 
     /* handle odd byte. */
-    if (cbData)
+    if (cbData & 1)
     {
+        uint8_t const bLast = pbSrc[cbData - 1];
+        if (pbDst)
+            pbDst[cbData - 1] = bLast;
 #ifdef RT_BIG_ENDIAN
-        u32Sum += (uint32_t)*(uint8_t *)pw << 8;
+        u32Sum += (uint32_t)bLast << 8;
 #else
-        u32Sum += *(uint8_t *)pw;
+        u32Sum += bLast;
 #endif
         *pfOdd = true;
     }
-    else
-        *pfOdd = false;
     return u32Sum;
 }
 
+
+/**
+ * Adds the checksum of the specified data segment to the intermediate checksum value [inlined].
+ *
+ * @returns 32-bit intermediary checksum value.
+ * @param   pvData          Pointer to the data that should be checksummed.
+ * @param   cbData          The number of bytes to checksum.
+ * @param   u32Sum          The 32-bit intermediate checksum value.
+ * @param   pfOdd           This is used to keep track of odd bits, initialize to false
+ *                          when starting to checksum the data (aka text) after a TCP
+ *                          or UDP header (data never start at an odd offset).
+ */
+DECLINLINE(uint32_t) rtNetIPv4AddDataChecksum(void const *pvData, size_t cbData, uint32_t u32Sum, bool *pfOdd)
+{
+    return rtNetIPv4AddDataChecksumWorker(NULL, pvData, cbData, u32Sum, pfOdd);
+}
+
 /**
  * Adds the checksum of the specified data segment to the intermediate checksum value.
  *
@@ -356,6 +671,28 @@ RTDECL(uint32_t) RTNetIPv4AddDataChecksum(void const *pvData, size_t cbData, uin
 RT_EXPORT_SYMBOL(RTNetIPv4AddDataChecksum);
 
 
+/**
+ * Copies a data segment and adds its checksum to the intermediate checksum
+ * value, touching the data only once.
+ *
+ * @returns 32-bit intermediary checksum value.
+ * @param   pvDst           Where to copy the data to.  Must not overlap
+ *                          with @a pvData.
+ * @param   pvData          The data bits to copy and checksum.
+ * @param   cbData          The number of bytes to copy and checksum.
+ * @param   u32Sum          The 32-bit intermediate checksum value.
+ * @param   pfOdd           This is used to keep track of odd bits, initialize to false
+ *                          when starting to checksum the data (aka text) after a TCP
+ *                          or UDP header (data never start at an odd offset).
+ */
+RTDECL(uint32_t) RTNetIPv4AddDataChecksumCopy(void *pvDst, void const *pvData, size_t cbData, uint32_t u32Sum, bool *pfOdd)
+{
+    AssertPtr(pvDst);
+    return rtNetIPv4AddDataChecksumWorker(pvDst, pvData, cbData, u32Sum, pfOdd);
+}
+RT_EXPORT_SYMBOL(RTNetIPv4AddDataChecksumCopy);
+
+
 /**
  * Finalizes a IPv4 checksum [inlined].
  *
@@ -271,7 +271,7 @@ static DECLCALLBACK(int) rtDbgModInitOnce(void *pvUser)
     int rc = RTSemRWCreate(&g_hDbgModRWSem);
     AssertRCReturn(rc, rc);
 
-    rc = RTStrCacheCreate(&g_hDbgModStrCache, "RTDBGMOD");
+    rc = RTStrCacheCreateEx(&g_hDbgModStrCache, "RTDBGMOD", RTSTRCACHE_F_CONCURRENT);
     if (RT_SUCCESS(rc))
     {
         /*
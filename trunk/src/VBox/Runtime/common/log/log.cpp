@@ -88,6 +88,19 @@ AssertCompile(sizeof(RTLOG_RINGBUF_EYE_CATCHER) == 16);
 #define RTLOG_RINGBUF_EYE_CATCHER_END    "\0\0\0END RING BUF"
 AssertCompile(sizeof(RTLOG_RINGBUF_EYE_CATCHER_END) == 16);
 
+#ifdef IN_RING3
+/** The size of a per-thread async log ring (power of two). */
+# define RTLOG_ASYNC_RING_SIZE          _64K
+/** The max size of a formatted async record, larger messages are written
+ * synchronously. */
+# define RTLOG_ASYNC_MAX_RECORD         _4K
+/** The max number of per-thread async rings per logger.  Threads beyond
+ * this use the synchronous path. */
+# define RTLOG_ASYNC_MAX_RINGS          64
+/** How often the async writer thread looks for records (milliseconds). */
+# define RTLOG_ASYNC_WRITER_INTERVAL    10
+#endif
+
 
 /*********************************************************************************************************************************
 *   Structures and Typedefs                                                                                                      *
@@ -103,6 +116,10 @@ typedef struct RTLOGOUTPUTPREFIXEDARGS
     unsigned                fFlags;
     /** The group. (used for prefixing.) */
     unsigned                iGroup;
+    /** Number of write locks the logger itself holds on the calling thread,
+     * subtracted for RTLOGFLAGS_PREFIX_LOCK_COUNTS.  Zero when formatting
+     * into an async ring, which is done without the logger lock. */
+    uint32_t                cLoggerLocks;
 } RTLOGOUTPUTPREFIXEDARGS, *PRTLOGOUTPUTPREFIXEDARGS;
 
 #ifndef IN_RC
@@ -199,11 +216,19 @@ typedef struct RTLOGGERINTERNAL
     /** Pointer to filename. */
     char                    szFilename[RTPATH_MAX];
     /** @} */
+
+    /** @name Asynchronous logging (RTLOGFLAGS_ASYNC).
+     * @{ */
+    /** The async logging state (RTLOGASYNCSTATE_XXX). */
+    uint32_t volatile       uAsyncState;
+    /** The per-thread rings and writer thread.  Created on first use. */
+    struct RTLOGASYNC * volatile pAsync;
+    /** @} */
 # endif /* IN_RING3 */
 } RTLOGGERINTERNAL;
 
 /** The revision of the internal logger structure. */
-# define RTLOGGERINTERNAL_REV    UINT32_C(10)
+# define RTLOGGERINTERNAL_REV    UINT32_C(11)
 
 # ifdef IN_RING3
 /** The size of the RTLOGGERINTERNAL structure in ring-0.  */
@@ -215,6 +240,113 @@ AssertCompileMemberAlignment(RTLOGGERINTERNAL, cbRingBufUnflushed, sizeof(uint64
 
 #endif /* !IN_RC */
 
+#ifdef IN_RING3
+
+/** @name RTLOGASYNCSTATE_XXX - Async logging states.
+ * @{ */
+/** Not started yet, the first async message will try start it. */
+# define RTLOGASYNCSTATE_NONE       UINT32_C(0)
+/** Being started by some thread, the others must use the synchronous path. */
+# define RTLOGASYNCSTATE_STARTING   UINT32_C(1)
+/** Up and running. */
+# define RTLOGASYNCSTATE_RUNNING    UINT32_C(2)
+/** Failed to start or shut down, only use the synchronous path. */
+# define RTLOGASYNCSTATE_DEAD       UINT32_C(3)
+/** @} */
+
+/**
+ * Async log record header.
+ *
+ * The record text follows the header.  Records are 8 byte aligned in the ring.
+ */
+typedef struct RTLOGASYNCREC
+{
+    /** RTTimeNanoTS() when the record was produced. */
+    uint64_t                u64NanoTS;
+    /** The number of text bytes, RTLOGASYNCREC_PADDING for skipping to the
+     * start of the ring. */
+    uint32_t                cbText;
+    /** Reserved. */
+    uint32_t                u32Reserved;
+} RTLOGASYNCREC;
+/** Pointer to an async log record header. */
+typedef RTLOGASYNCREC *PRTLOGASYNCREC;
+/** RTLOGASYNCREC::cbText value of the padding record. */
+# define RTLOGASYNCREC_PADDING      UINT32_MAX
+
+/**
+ * Per-thread async log ring.
+ *
+ * Single producer (the owner thread) and single consumer (whoever holds the
+ * logger lock).
+ */
+typedef struct RTLOGASYNCRING
+{
+    /** The producer position (free running). */
+    uint32_t volatile       offWrite;
+    /** Set if a prefix is pending, i.e. the last record ended with a newline.
+     * Only accessed by the owner thread. */
+    bool                    fPendingPrefix;
+    /** Alignment padding. */
+    uint8_t                 abPadding0[64 - 5];
+    /** The consumer position (free running). */
+    uint32_t volatile       offRead;
+    /** Number of messages dropped since the consumer last looked. */
+    uint32_t volatile       cDropped;
+    /** Set by the TLS destructor when the owner thread terminates. */
+    bool volatile           fOwnerGone;
+    /** Alignment padding. */
+    bool                    afPadding1[7];
+    /** The owner thread, for the dropped messages note. */
+    RTNATIVETHREAD          hNativeOwner;
+    /** The ring buffer. */
+    uint8_t                 abRing[RTLOG_ASYNC_RING_SIZE];
+    /** Formatting buffer, only accessed by the owner thread. */
+    char                    achStaging[RTLOG_ASYNC_MAX_RECORD];
+} RTLOGASYNCRING;
+/** Pointer to a per-thread async log ring. */
+typedef RTLOGASYNCRING *PRTLOGASYNCRING;
+
+/**
+ * The async logging state of a logger (RTLOGGERINTERNAL::pAsync).
+ */
+typedef struct RTLOGASYNC
+{
+    /** The TLS index for looking up the thread's ring. */
+    RTTLS                   iTls;
+    /** Set when the writer thread should quit. */
+    bool volatile           fShutdown;
+    /** The event the writer thread waits on. */
+    RTSEMEVENT              hEvtWriter;
+    /** The writer thread. */
+    RTTHREAD                hWriterThread;
+    /** Number of entries in apRings that have been used (high water mark). */
+    uint32_t volatile       cRingsUsed;
+    /** The per-thread rings. */
+    PRTLOGASYNCRING volatile apRings[RTLOG_ASYNC_MAX_RINGS];
+} RTLOGASYNC;
+/** Pointer to the async logging state. */
+typedef RTLOGASYNC *PRTLOGASYNC;
+
+/**
+ * Arguments for rtLogOutputAsync.
+ */
+typedef struct RTLOGASYNCOUTPUTARGS
+{
+    /** The logger, flags and group for the prefix. */
+    RTLOGOUTPUTPREFIXEDARGS Prefixed;
+    /** The ring of the calling thread. */
+    PRTLOGASYNCRING         pRing;
+    /** Current offset into the staging buffer. */
+    size_t                  offStaging;
+    /** Set if the message didn't fit in the staging buffer. */
+    bool                    fOverflow;
+} RTLOGASYNCOUTPUTARGS;
+/** Pointer to rtLogOutputAsync arguments. */
+typedef RTLOGASYNCOUTPUTARGS *PRTLOGASYNCOUTPUTARGS;
+
+#endif /* IN_RING3 */
+
 
 /*********************************************************************************************************************************
 *   Internal Functions                                                                                                           *
@@ -240,6 +372,11 @@ static void rtlogLoggerExVLocked(PRTLOGGER pLogger, unsigned fFlags, unsigned iG
 #ifndef IN_RC
 static void rtlogLoggerExFLocked(PRTLOGGER pLogger, unsigned fFlags, unsigned iGroup, const char *pszFormat, ...);
 #endif
+#ifdef IN_RING3
+static bool rtlogAsyncLoggerExV(PRTLOGGER pLogger, unsigned fFlags, unsigned iGroup, const char *pszFormat, va_list args);
+static void rtlogAsyncDrainLocked(PRTLOGGER pLogger, bool fReclaim);
+static void rtlogAsyncTerm(PRTLOGGER pLogger);
+#endif
 
 
 /*********************************************************************************************************************************
@@ -317,6 +454,9 @@ static struct
     { "writethru",    sizeof("writethru"   ) - 1,   RTLOGFLAGS_WRITE_THROUGH,       false },
     { "writethrough", sizeof("writethrough") - 1,   RTLOGFLAGS_WRITE_THROUGH,       false },
     { "flush",        sizeof("flush"       ) - 1,   RTLOGFLAGS_FLUSH,               false },
+    { "asyncdrop",    sizeof("asyncdrop"   ) - 1,   RTLOGFLAGS_ASYNC_DROP,          false }, /* before async! */
+    { "async",        sizeof("async"       ) - 1,   RTLOGFLAGS_ASYNC,               false },
+    { "sync",         sizeof("sync"        ) - 1,   RTLOGFLAGS_ASYNC,               true  },
     { "lockcnts",     sizeof("lockcnts"    ) - 1,   RTLOGFLAGS_PREFIX_LOCK_COUNTS,  false },
     { "cpuid",        sizeof("cpuid"       ) - 1,   RTLOGFLAGS_PREFIX_CPUID,        false },
     { "pid",          sizeof("pid"         ) - 1,   RTLOGFLAGS_PREFIX_PID,          false },
@@ -852,6 +992,8 @@ RTDECL(int) RTLogCreateExV(PRTLOGGER *ppLogger, uint32_t fFlags, const char *psz
             pLogger->pInt->cSecsHistoryTimeSlot = UINT32_MAX;
         else
             pLogger->pInt->cSecsHistoryTimeSlot = cSecsHistoryTimeSlot;
+        pLogger->pInt->uAsyncState              = RTLOGASYNCSTATE_NONE;
+        pLogger->pInt->pAsync                   = NULL;
 # else   /* !IN_RING3 */
         RT_NOREF_PV(pfnPhase); RT_NOREF_PV(cHistory); RT_NOREF_PV(cbHistoryFileMax); RT_NOREF_PV(cSecsHistoryTimeSlot);
 # endif  /* !IN_RING3 */
@@ -1086,6 +1228,13 @@ RTDECL(int) RTLogDestroy(PRTLOGGER pLogger)
     AssertReturn(pLogger->u32Magic == RTLOGGER_MAGIC, VERR_INVALID_MAGIC);
     AssertPtrReturn(pLogger->pInt, VERR_INVALID_POINTER);
 
+# ifdef IN_RING3
+    /*
+     * Stop the async writer thread and write out what's left in the rings.
+     */
+    rtlogAsyncTerm(pLogger);
+# endif
+
     /*
      * Acquire logger instance sem and disable all logging. (paranoia)
      */
@@ -2584,6 +2733,9 @@ RTDECL(void) RTLogFlush(PRTLOGGER pLogger)
     if (   pLogger->offScratch
 #ifndef IN_RC
         || (pLogger->fDestFlags & RTLOGDEST_RINGBUF)
+#endif
+#ifdef IN_RING3
+        || pLogger->pInt->pAsync
 #endif
        )
     {
@@ -2595,6 +2747,14 @@ RTDECL(void) RTLogFlush(PRTLOGGER pLogger)
         if (RT_FAILURE(rc))
             return;
 #endif
+#ifdef IN_RING3
+        /*
+         * Pick up what the other threads have put in their async rings.
+         */
+        if (pLogger->pInt->pAsync)
+            rtlogAsyncDrainLocked(pLogger, false /*fReclaim*/);
+#endif
+
         /*
          * Call worker.
          */
@@ -2900,6 +3060,16 @@ RTDECL(void) RTLogLoggerExV(PRTLOGGER pLogger, unsigned fFlags, unsigned iGroup,
         &&  (pLogger->afGroups[iGroup] & (fFlags | RTLOGGRPFLAGS_ENABLED)) != (fFlags | RTLOGGRPFLAGS_ENABLED))
         return;
 
+#ifdef IN_RING3
+    /*
+     * Format it into the thread's ring buffer without taking the lock if
+     * async logging is enabled.
+     */
+    if (   (pLogger->fFlags & (RTLOGFLAGS_ASYNC | RTLOGFLAGS_RESTRICT_GROUPS)) == RTLOGFLAGS_ASYNC
+        && rtlogAsyncLoggerExV(pLogger, fFlags, iGroup, pszFormat, args))
+        return;
+#endif
+
     /*
      * Acquire logger instance sem.
      */
@@ -2913,6 +3083,14 @@ RTDECL(void) RTLogLoggerExV(PRTLOGGER pLogger, unsigned fFlags, unsigned iGroup,
         return;
     }
 
+#ifdef IN_RING3
+    /*
+     * Write out pending async records first to keep the thread's own ordering.
+     */
+    if (pLogger->pInt->pAsync)
+        rtlogAsyncDrainLocked(pLogger, false /*fReclaim*/);
+#endif
+
     /*
      * Check restrictions and call worker.
      */
@@ -3496,340 +3674,355 @@ DECLINLINE(char *) rtLogStPNCpyPad(char *pszDst, const char *pszSrc, size_t cchS
 
 
 /**
- * Callback for RTLogFormatV which writes to the logger instance.
- * This version supports prefixes.
+ * Formats the line prefix configured for the logger.
  *
- * See PFNLOGOUTPUT() for details.
+ * @returns Pointer to the char following the prefix.
+ * @param   pArgs       The logger instance, logging flags and group.
+ * @param   psz         Where to put the prefix.  Must have room for at least
+ *                      256 chars.
  */
-static DECLCALLBACK(size_t) rtLogOutputPrefixed(void *pv, const char *pachChars, size_t cbChars)
+static char *rtlogFormatPrefix(PRTLOGOUTPUTPREFIXEDARGS pArgs, char *psz)
 {
-    PRTLOGOUTPUTPREFIXEDARGS    pArgs = (PRTLOGOUTPUTPREFIXEDARGS)pv;
-    PRTLOGGER                   pLogger = pArgs->pLogger;
-    if (cbChars)
+    PRTLOGGER pLogger = pArgs->pLogger;
+    if (pLogger->fFlags & RTLOGFLAGS_PREFIX_TS)
     {
-        size_t cbRet = 0;
-        for (;;)
+        uint64_t     u64    = RTTimeNanoTS();
+        int          iBase  = 16;
+        unsigned int fFlags = RTSTR_F_ZEROPAD;
+        if (pLogger->fFlags & RTLOGFLAGS_DECIMAL_TS)
         {
-            uint32_t    offScratch = pLogger->offScratch;
-            size_t      cb         = sizeof(pLogger->achScratch) - offScratch - 1;
-            const char *pszNewLine;
-            char       *psz;
-#ifdef IN_RC
-            bool       *pfPendingPrefix = &pLogger->fPendingPrefix;
-#else
-            bool       *pfPendingPrefix = &pLogger->pInt->fPendingPrefix;
-#endif
-
-            /*
-             * Pending prefix?
-             */
-            if (*pfPendingPrefix)
-            {
-                *pfPendingPrefix = false;
-
-#if defined(DEBUG) && defined(IN_RING3)
-                /* sanity */
-                if (offScratch >= sizeof(pLogger->achScratch))
-                {
-                    fprintf(stderr, "offScratch >= sizeof(pLogger->achScratch) (%#x >= %#x)\n",
-                            offScratch, (unsigned)sizeof(pLogger->achScratch));
-                    AssertBreakpoint(); AssertBreakpoint();
-                }
-#endif
-
-                /*
-                 * Flush the buffer if there isn't enough room for the maximum prefix config.
-                 * Max is 256, add a couple of extra bytes.  See CCH_PREFIX check way below.
-                 */
-                if (cb < 256 + 16)
-                {
-                    rtlogFlush(pLogger);
-                    offScratch = pLogger->offScratch;
-                    cb = sizeof(pLogger->achScratch) - offScratch - 1;
-                }
-
-                /*
-                 * Write the prefixes.
-                 * psz is pointing to the current position.
-                 */
-                psz = &pLogger->achScratch[offScratch];
-                if (pLogger->fFlags & RTLOGFLAGS_PREFIX_TS)
-                {
-                    uint64_t     u64    = RTTimeNanoTS();
-                    int          iBase  = 16;
-                    unsigned int fFlags = RTSTR_F_ZEROPAD;
-                    if (pLogger->fFlags & RTLOGFLAGS_DECIMAL_TS)
-                    {
-                        iBase = 10;
-                        fFlags = 0;
-                    }
-                    if (pLogger->fFlags & RTLOGFLAGS_REL_TS)
-                    {
-                        static volatile uint64_t s_u64LastTs;
-                        uint64_t        u64DiffTs = u64 - s_u64LastTs;
-                        s_u64LastTs = u64;
-                        /* We could have been preempted just before reading of s_u64LastTs by
-                         * another thread which wrote s_u64LastTs. In that case the difference
-                         * is negative which we simply ignore. */
-                        u64         = (int64_t)u64DiffTs < 0 ? 0 : u64DiffTs;
-                    }
-                    /* 1E15 nanoseconds = 11 days */
-                    psz += RTStrFormatNumber(psz, u64, iBase, 16, 0, fFlags);
-                    *psz++ = ' ';
-                }
+            iBase = 10;
+            fFlags = 0;
+        }
+        if (pLogger->fFlags & RTLOGFLAGS_REL_TS)
+        {
+            static volatile uint64_t s_u64LastTs;
+            uint64_t        u64DiffTs = u64 - s_u64LastTs;
+            s_u64LastTs = u64;
+            /* We could have been preempted just before reading of s_u64LastTs by
+             * another thread which wrote s_u64LastTs. In that case the difference
+             * is negative which we simply ignore. */
+            u64         = (int64_t)u64DiffTs < 0 ? 0 : u64DiffTs;
+        }
+        /* 1E15 nanoseconds = 11 days */
+        psz += RTStrFormatNumber(psz, u64, iBase, 16, 0, fFlags);
+        *psz++ = ' ';
+    }
 #define CCH_PREFIX_01   0 + 17
 
-                if (pLogger->fFlags & RTLOGFLAGS_PREFIX_TSC)
-                {
+    if (pLogger->fFlags & RTLOGFLAGS_PREFIX_TSC)
+    {
 #if defined(RT_ARCH_AMD64) || defined(RT_ARCH_X86)
-                    uint64_t     u64    = ASMReadTSC();
+        uint64_t     u64    = ASMReadTSC();
 #else
-                    uint64_t     u64    = RTTimeNanoTS();
+        uint64_t     u64    = RTTimeNanoTS();
 #endif
-                    int          iBase  = 16;
-                    unsigned int fFlags = RTSTR_F_ZEROPAD;
-                    if (pLogger->fFlags & RTLOGFLAGS_DECIMAL_TS)
-                    {
-                        iBase = 10;
-                        fFlags = 0;
-                    }
-                    if (pLogger->fFlags & RTLOGFLAGS_REL_TS)
-                    {
-                        static volatile uint64_t s_u64LastTsc;
-                        int64_t        i64DiffTsc = u64 - s_u64LastTsc;
-                        s_u64LastTsc = u64;
-                        /* We could have been preempted just before reading of s_u64LastTsc by
-                         * another thread which wrote s_u64LastTsc. In that case the difference
-                         * is negative which we simply ignore. */
-                        u64          = i64DiffTsc < 0 ? 0 : i64DiffTsc;
-                    }
-                    /* 1E15 ticks at 4GHz = 69 hours */
-                    psz += RTStrFormatNumber(psz, u64, iBase, 16, 0, fFlags);
-                    *psz++ = ' ';
-                }
+        int          iBase  = 16;
+        unsigned int fFlags = RTSTR_F_ZEROPAD;
+        if (pLogger->fFlags & RTLOGFLAGS_DECIMAL_TS)
+        {
+            iBase = 10;
+            fFlags = 0;
+        }
+        if (pLogger->fFlags & RTLOGFLAGS_REL_TS)
+        {
+            static volatile uint64_t s_u64LastTsc;
+            int64_t        i64DiffTsc = u64 - s_u64LastTsc;
+            s_u64LastTsc = u64;
+            /* We could have been preempted just before reading of s_u64LastTsc by
+             * another thread which wrote s_u64LastTsc. In that case the difference
+             * is negative which we simply ignore. */
+            u64          = i64DiffTsc < 0 ? 0 : i64DiffTsc;
+        }
+        /* 1E15 ticks at 4GHz = 69 hours */
+        psz += RTStrFormatNumber(psz, u64, iBase, 16, 0, fFlags);
+        *psz++ = ' ';
+    }
 #define CCH_PREFIX_02   CCH_PREFIX_01 + 17
 
-                if (pLogger->fFlags & RTLOGFLAGS_PREFIX_MS_PROG)
-                {
+    if (pLogger->fFlags & RTLOGFLAGS_PREFIX_MS_PROG)
+    {
 #if defined(IN_RING3) || defined(IN_RC)
-                    uint64_t u64 = RTTimeProgramMilliTS();
+        uint64_t u64 = RTTimeProgramMilliTS();
 #else
-                    uint64_t u64 = 0;
+        uint64_t u64 = 0;
 #endif
-                    /* 1E8 milliseconds = 27 hours */
-                    psz += RTStrFormatNumber(psz, u64, 10, 9, 0, RTSTR_F_ZEROPAD);
-                    *psz++ = ' ';
-                }
+        /* 1E8 milliseconds = 27 hours */
+        psz += RTStrFormatNumber(psz, u64, 10, 9, 0, RTSTR_F_ZEROPAD);
+        *psz++ = ' ';
+    }
 #define CCH_PREFIX_03   CCH_PREFIX_02 + 21
 
-                if (pLogger->fFlags & RTLOGFLAGS_PREFIX_TIME)
-                {
+    if (pLogger->fFlags & RTLOGFLAGS_PREFIX_TIME)
+    {
 #if defined(IN_RING3) || defined(IN_RING0)
-                    RTTIMESPEC TimeSpec;
-                    RTTIME Time;
-                    RTTimeExplode(&Time, RTTimeNow(&TimeSpec));
-                    psz += RTStrFormatNumber(psz, Time.u8Hour, 10, 2, 0, RTSTR_F_ZEROPAD);
-                    *psz++ = ':';
-                    psz += RTStrFormatNumber(psz, Time.u8Minute, 10, 2, 0, RTSTR_F_ZEROPAD);
-                    *psz++ = ':';
-                    psz += RTStrFormatNumber(psz, Time.u8Second, 10, 2, 0, RTSTR_F_ZEROPAD);
-                    *psz++ = '.';
-                    psz += RTStrFormatNumber(psz, Time.u32Nanosecond / 1000, 10, 6, 0, RTSTR_F_ZEROPAD);
-                    *psz++ = ' ';
+        RTTIMESPEC TimeSpec;
+        RTTIME Time;
+        RTTimeExplode(&Time, RTTimeNow(&TimeSpec));
+        psz += RTStrFormatNumber(psz, Time.u8Hour, 10, 2, 0, RTSTR_F_ZEROPAD);
+        *psz++ = ':';
+        psz += RTStrFormatNumber(psz, Time.u8Minute, 10, 2, 0, RTSTR_F_ZEROPAD);
+        *psz++ = ':';
+        psz += RTStrFormatNumber(psz, Time.u8Second, 10, 2, 0, RTSTR_F_ZEROPAD);
+        *psz++ = '.';
+        psz += RTStrFormatNumber(psz, Time.u32Nanosecond / 1000, 10, 6, 0, RTSTR_F_ZEROPAD);
+        *psz++ = ' ';
 #else
-                    memset(psz, ' ', 16);
-                    psz += 16;
+        memset(psz, ' ', 16);
+        psz += 16;
 #endif
-                }
+    }
 #define CCH_PREFIX_04   CCH_PREFIX_03 + (3+1+3+1+3+1+7+1)
 
-                if (pLogger->fFlags & RTLOGFLAGS_PREFIX_TIME_PROG)
-                {
+    if (pLogger->fFlags & RTLOGFLAGS_PREFIX_TIME_PROG)
+    {
 
 #if defined(IN_RING3) || defined(IN_RC)
-                    uint64_t u64 = RTTimeProgramMicroTS();
-                    psz += RTStrFormatNumber(psz, (uint32_t)(u64 / RT_US_1HOUR), 10, 2, 0, RTSTR_F_ZEROPAD);
-                    *psz++ = ':';
-                    uint32_t u32 = (uint32_t)(u64 % RT_US_1HOUR);
-                    psz += RTStrFormatNumber(psz, u32 / RT_US_1MIN, 10, 2, 0, RTSTR_F_ZEROPAD);
-                    *psz++ = ':';
-                    u32 %= RT_US_1MIN;
-
-                    psz += RTStrFormatNumber(psz, u32 / RT_US_1SEC, 10, 2, 0, RTSTR_F_ZEROPAD);
-                    *psz++ = '.';
-                    psz += RTStrFormatNumber(psz, u32 % RT_US_1SEC, 10, 6, 0, RTSTR_F_ZEROPAD);
-                    *psz++ = ' ';
+        uint64_t u64 = RTTimeProgramMicroTS();
+        psz += RTStrFormatNumber(psz, (uint32_t)(u64 / RT_US_1HOUR), 10, 2, 0, RTSTR_F_ZEROPAD);
+        *psz++ = ':';
+        uint32_t u32 = (uint32_t)(u64 % RT_US_1HOUR);
+        psz += RTStrFormatNumber(psz, u32 / RT_US_1MIN, 10, 2, 0, RTSTR_F_ZEROPAD);
+        *psz++ = ':';
+        u32 %= RT_US_1MIN;
+
+        psz += RTStrFormatNumber(psz, u32 / RT_US_1SEC, 10, 2, 0, RTSTR_F_ZEROPAD);
+        *psz++ = '.';
+        psz += RTStrFormatNumber(psz, u32 % RT_US_1SEC, 10, 6, 0, RTSTR_F_ZEROPAD);
+        *psz++ = ' ';
 #else
-                    memset(psz, ' ', 16);
-                    psz += 16;
+        memset(psz, ' ', 16);
+        psz += 16;
 #endif
-                }
+    }
 #define CCH_PREFIX_05   CCH_PREFIX_04 + (9+1+2+1+2+1+6+1)
 
 # if 0
-                if (pLogger->fFlags & RTLOGFLAGS_PREFIX_DATETIME)
-                {
-                    char szDate[32];
-                    RTTIMESPEC Time;
-                    RTTimeSpecToString(RTTimeNow(&Time), szDate, sizeof(szDate));
-                    size_t cch = strlen(szDate);
-                    memcpy(psz, szDate, cch);
-                    psz += cch;
-                    *psz++ = ' ';
-                }
+    if (pLogger->fFlags & RTLOGFLAGS_PREFIX_DATETIME)
+    {
+        char szDate[32];
+        RTTIMESPEC Time;
+        RTTimeSpecToString(RTTimeNow(&Time), szDate, sizeof(szDate));
+        size_t cch = strlen(szDate);
+        memcpy(psz, szDate, cch);
+        psz += cch;
+        *psz++ = ' ';
+    }
 #  define CCH_PREFIX_06   CCH_PREFIX_05 + 32
 # else
 #  define CCH_PREFIX_06   CCH_PREFIX_05 + 0
 # endif
 
-                if (pLogger->fFlags & RTLOGFLAGS_PREFIX_PID)
-                {
+    if (pLogger->fFlags & RTLOGFLAGS_PREFIX_PID)
+    {
 #ifndef IN_RC
-                    RTPROCESS Process = RTProcSelf();
+        RTPROCESS Process = RTProcSelf();
 #else
-                    RTPROCESS Process = NIL_RTPROCESS;
+        RTPROCESS Process = NIL_RTPROCESS;
 #endif
-                    psz += RTStrFormatNumber(psz, Process, 16, sizeof(RTPROCESS) * 2, 0, RTSTR_F_ZEROPAD);
-                    *psz++ = ' ';
-                }
+        psz += RTStrFormatNumber(psz, Process, 16, sizeof(RTPROCESS) * 2, 0, RTSTR_F_ZEROPAD);
+        *psz++ = ' ';
+    }
 #define CCH_PREFIX_07   CCH_PREFIX_06 + 9
 
-                if (pLogger->fFlags & RTLOGFLAGS_PREFIX_TID)
-                {
+    if (pLogger->fFlags & RTLOGFLAGS_PREFIX_TID)
+    {
 #ifndef IN_RC
-                    RTNATIVETHREAD Thread = RTThreadNativeSelf();
+        RTNATIVETHREAD Thread = RTThreadNativeSelf();
 #else
-                    RTNATIVETHREAD Thread = NIL_RTNATIVETHREAD;
+        RTNATIVETHREAD Thread = NIL_RTNATIVETHREAD;
 #endif
-                    psz += RTStrFormatNumber(psz, Thread, 16, sizeof(RTNATIVETHREAD) * 2, 0, RTSTR_F_ZEROPAD);
-                    *psz++ = ' ';
-                }
+        psz += RTStrFormatNumber(psz, Thread, 16, sizeof(RTNATIVETHREAD) * 2, 0, RTSTR_F_ZEROPAD);
+        *psz++ = ' ';
+    }
 #define CCH_PREFIX_08   CCH_PREFIX_07 + 17
 
-                if (pLogger->fFlags & RTLOGFLAGS_PREFIX_THREAD)
-                {
+    if (pLogger->fFlags & RTLOGFLAGS_PREFIX_THREAD)
+    {
 #ifdef IN_RING3
-                    const char *pszName = RTThreadSelfName();
+        const char *pszName = RTThreadSelfName();
 #elif defined IN_RC
-                    const char *pszName = "EMT-RC";
+        const char *pszName = "EMT-RC";
 #else
-                    const char *pszName = "R0";
+        const char *pszName = "R0";
 #endif
-                    psz = rtLogStPNCpyPad(psz, pszName, 16, 8);
-                }
+        psz = rtLogStPNCpyPad(psz, pszName, 16, 8);
+    }
 #define CCH_PREFIX_09   CCH_PREFIX_08 + 17
 
-                if (pLogger->fFlags & RTLOGFLAGS_PREFIX_CPUID)
-                {
+    if (pLogger->fFlags & RTLOGFLAGS_PREFIX_CPUID)
+    {
 #if defined(RT_ARCH_AMD64) || defined(RT_ARCH_X86)
-                    const uint8_t idCpu = ASMGetApicId();
+        const uint8_t idCpu = ASMGetApicId();
 #else
-                    const RTCPUID idCpu = RTMpCpuId();
+        const RTCPUID idCpu = RTMpCpuId();
 #endif
-                    psz += RTStrFormatNumber(psz, idCpu, 16, sizeof(idCpu) * 2, 0, RTSTR_F_ZEROPAD);
-                    *psz++ = ' ';
-                }
+        psz += RTStrFormatNumber(psz, idCpu, 16, sizeof(idCpu) * 2, 0, RTSTR_F_ZEROPAD);
+        *psz++ = ' ';
+    }
 #define CCH_PREFIX_10   CCH_PREFIX_09 + 17
 
 #ifndef IN_RC
-                if (    (pLogger->fFlags & RTLOGFLAGS_PREFIX_CUSTOM)
-                    &&  pLogger->pInt->pfnPrefix)
-                {
-                    psz += pLogger->pInt->pfnPrefix(pLogger, psz, 31, pLogger->pInt->pvPrefixUserArg);
-                    *psz++ = ' ';                                                               /* +32 */
-                }
+    if (    (pLogger->fFlags & RTLOGFLAGS_PREFIX_CUSTOM)
+        &&  pLogger->pInt->pfnPrefix)
+    {
+        psz += pLogger->pInt->pfnPrefix(pLogger, psz, 31, pLogger->pInt->pvPrefixUserArg);
+        *psz++ = ' ';                                                               /* +32 */
+    }
 #endif
 #define CCH_PREFIX_11   CCH_PREFIX_10 + 32
 
-                if (pLogger->fFlags & RTLOGFLAGS_PREFIX_LOCK_COUNTS)
-                {
+    if (pLogger->fFlags & RTLOGFLAGS_PREFIX_LOCK_COUNTS)
+    {
 #ifdef IN_RING3 /** @todo implement these counters in ring-0 too? */
-                    RTTHREAD Thread = RTThreadSelf();
-                    if (Thread != NIL_RTTHREAD)
-                    {
-                        uint32_t cReadLocks  = RTLockValidatorReadLockGetCount(Thread);
-                        uint32_t cWriteLocks = RTLockValidatorWriteLockGetCount(Thread) - g_cLoggerLockCount;
-                        cReadLocks  = RT_MIN(0xfff, cReadLocks);
-                        cWriteLocks = RT_MIN(0xfff, cWriteLocks);
-                        psz += RTStrFormatNumber(psz, cReadLocks,  16, 1, 0, RTSTR_F_ZEROPAD);
-                        *psz++ = '/';
-                        psz += RTStrFormatNumber(psz, cWriteLocks, 16, 1, 0, RTSTR_F_ZEROPAD);
-                    }
-                    else
+        RTTHREAD Thread = RTThreadSelf();
+        if (Thread != NIL_RTTHREAD)
+        {
+            uint32_t cReadLocks  = RTLockValidatorReadLockGetCount(Thread);
+            uint32_t cWriteLocks = RTLockValidatorWriteLockGetCount(Thread) - pArgs->cLoggerLocks;
+            cReadLocks  = RT_MIN(0xfff, cReadLocks);
+            cWriteLocks = RT_MIN(0xfff, cWriteLocks);
+            psz += RTStrFormatNumber(psz, cReadLocks,  16, 1, 0, RTSTR_F_ZEROPAD);
+            *psz++ = '/';
+            psz += RTStrFormatNumber(psz, cWriteLocks, 16, 1, 0, RTSTR_F_ZEROPAD);
+        }
+        else
 #endif
-                    {
-                        *psz++ = '?';
-                        *psz++ = '/';
-                        *psz++ = '?';
-                    }
-                    *psz++ = ' ';
-                }
+        {
+            *psz++ = '?';
+            *psz++ = '/';
+            *psz++ = '?';
+        }
+        *psz++ = ' ';
+    }
 #define CCH_PREFIX_12   CCH_PREFIX_11 + 8
 
-                if (pLogger->fFlags & RTLOGFLAGS_PREFIX_FLAG_NO)
-                {
-                    psz += RTStrFormatNumber(psz, pArgs->fFlags, 16, 8, 0, RTSTR_F_ZEROPAD);
-                    *psz++ = ' ';
-                }
+    if (pLogger->fFlags & RTLOGFLAGS_PREFIX_FLAG_NO)
+    {
+        psz += RTStrFormatNumber(psz, pArgs->fFlags, 16, 8, 0, RTSTR_F_ZEROPAD);
+        *psz++ = ' ';
+    }
 #define CCH_PREFIX_13   CCH_PREFIX_12 + 9
 
-                if (pLogger->fFlags & RTLOGFLAGS_PREFIX_FLAG)
-                {
+    if (pLogger->fFlags & RTLOGFLAGS_PREFIX_FLAG)
+    {
 #ifdef IN_RING3
-                    const char *pszGroup = pArgs->iGroup != ~0U ? pLogger->pInt->papszGroups[pArgs->iGroup] : NULL;
+        const char *pszGroup = pArgs->iGroup != ~0U ? pLogger->pInt->papszGroups[pArgs->iGroup] : NULL;
 #else
-                    const char *pszGroup = NULL;
+        const char *pszGroup = NULL;
 #endif
-                    psz = rtLogStPNCpyPad(psz, pszGroup, 16, 8);
-                }
+        psz = rtLogStPNCpyPad(psz, pszGroup, 16, 8);
+    }
 #define CCH_PREFIX_14   CCH_PREFIX_13 + 17
 
-                if (pLogger->fFlags & RTLOGFLAGS_PREFIX_GROUP_NO)
+    if (pLogger->fFlags & RTLOGFLAGS_PREFIX_GROUP_NO)
+    {
+        if (pArgs->iGroup != ~0U)
+        {
+            psz += RTStrFormatNumber(psz, pArgs->iGroup, 16, 3, 0, RTSTR_F_ZEROPAD);
+            *psz++ = ' ';
+        }
+        else
+        {
+            memcpy(psz, "-1  ", sizeof("-1  ") - 1);
+            psz += sizeof("-1  ") - 1;
+        }                                                                           /* +9 */
+    }
+#define CCH_PREFIX_15   CCH_PREFIX_14 + 9
+
+    if (pLogger->fFlags & RTLOGFLAGS_PREFIX_GROUP)
+    {
+        const unsigned fGrp = pLogger->afGroups[pArgs->iGroup != ~0U ? pArgs->iGroup : 0];
+        const char *pszGroup;
+        size_t cch;
+        switch (pArgs->fFlags & fGrp)
+        {
+            case 0:                         pszGroup = "--------";  cch = sizeof("--------") - 1; break;
+            case RTLOGGRPFLAGS_ENABLED:     pszGroup = "enabled" ;  cch = sizeof("enabled" ) - 1; break;
+            case RTLOGGRPFLAGS_LEVEL_1:     pszGroup = "level 1" ;  cch = sizeof("level 1" ) - 1; break;
+            case RTLOGGRPFLAGS_LEVEL_2:     pszGroup = "level 2" ;  cch = sizeof("level 2" ) - 1; break;
+            case RTLOGGRPFLAGS_LEVEL_3:     pszGroup = "level 3" ;  cch = sizeof("level 3" ) - 1; break;
+            case RTLOGGRPFLAGS_LEVEL_4:     pszGroup = "level 4" ;  cch = sizeof("level 4" ) - 1; break;
+            case RTLOGGRPFLAGS_LEVEL_5:     pszGroup = "level 5" ;  cch = sizeof("level 5" ) - 1; break;
+            case RTLOGGRPFLAGS_LEVEL_6:     pszGroup = "level 6" ;  cch = sizeof("level 6" ) - 1; break;
+            case RTLOGGRPFLAGS_LEVEL_7:     pszGroup = "level 7" ;  cch = sizeof("level 7" ) - 1; break;
+            case RTLOGGRPFLAGS_LEVEL_8:     pszGroup = "level 8" ;  cch = sizeof("level 8" ) - 1; break;
+            case RTLOGGRPFLAGS_LEVEL_9:     pszGroup = "level 9" ;  cch = sizeof("level 9" ) - 1; break;
+            case RTLOGGRPFLAGS_LEVEL_10:    pszGroup = "level 10";  cch = sizeof("level 10") - 1; break;
+            case RTLOGGRPFLAGS_LEVEL_11:    pszGroup = "level 11";  cch = sizeof("level 11") - 1; break;
+            case RTLOGGRPFLAGS_LEVEL_12:    pszGroup = "level 12";  cch = sizeof("level 12") - 1; break;
+            case RTLOGGRPFLAGS_FLOW:        pszGroup = "flow"    ;  cch = sizeof("flow"    ) - 1; break;
+            case RTLOGGRPFLAGS_WARN:        pszGroup = "warn"    ;  cch = sizeof("warn"    ) - 1; break;
+            default:                        pszGroup = "????????";  cch = sizeof("????????") - 1; break;
+        }
+        psz = rtLogStPNCpyPad(psz, pszGroup, 16, 8);
+    }
+#define CCH_PREFIX_16   CCH_PREFIX_15 + 17
+
+#define CCH_PREFIX      ( CCH_PREFIX_16 )
+    { AssertCompile(CCH_PREFIX < 256); }
+
+    return psz;
+}
+
+
+/**
+ * Callback for RTLogFormatV which writes to the logger instance.
+ * This version supports prefixes.
+ *
+ * See PFNLOGOUTPUT() for details.
+ */
+static DECLCALLBACK(size_t) rtLogOutputPrefixed(void *pv, const char *pachChars, size_t cbChars)
+{
+    PRTLOGOUTPUTPREFIXEDARGS    pArgs = (PRTLOGOUTPUTPREFIXEDARGS)pv;
+    PRTLOGGER                   pLogger = pArgs->pLogger;
+    if (cbChars)
+    {
+        size_t cbRet = 0;
+        for (;;)
+        {
+            uint32_t    offScratch = pLogger->offScratch;
+            size_t      cb         = sizeof(pLogger->achScratch) - offScratch - 1;
+            const char *pszNewLine;
+            char       *psz;
+#ifdef IN_RC
+            bool       *pfPendingPrefix = &pLogger->fPendingPrefix;
+#else
+            bool       *pfPendingPrefix = &pLogger->pInt->fPendingPrefix;
+#endif
+
+            /*
+             * Pending prefix?
+             */
+            if (*pfPendingPrefix)
+            {
+                *pfPendingPrefix = false;
+
+#if defined(DEBUG) && defined(IN_RING3)
+                /* sanity */
+                if (offScratch >= sizeof(pLogger->achScratch))
                 {
-                    if (pArgs->iGroup != ~0U)
-                    {
-                        psz += RTStrFormatNumber(psz, pArgs->iGroup, 16, 3, 0, RTSTR_F_ZEROPAD);
-                        *psz++ = ' ';
-                    }
-                    else
-                    {
-                        memcpy(psz, "-1  ", sizeof("-1  ") - 1);
-                        psz += sizeof("-1  ") - 1;
-                    }                                                                           /* +9 */
+                    fprintf(stderr, "offScratch >= sizeof(pLogger->achScratch) (%#x >= %#x)\n",
+                            offScratch, (unsigned)sizeof(pLogger->achScratch));
+                    AssertBreakpoint(); AssertBreakpoint();
                 }
-#define CCH_PREFIX_15   CCH_PREFIX_14 + 9
+#endif
 
-                if (pLogger->fFlags & RTLOGFLAGS_PREFIX_GROUP)
+                /*
+                 * Flush the buffer if there isn't enough room for the maximum prefix config.
+                 * Max is 256, add a couple of extra bytes.  See CCH_PREFIX check in rtlogFormatPrefix.
+                 */
+                if (cb < 256 + 16)
                 {
-                    const unsigned fGrp = pLogger->afGroups[pArgs->iGroup != ~0U ? pArgs->iGroup : 0];
-                    const char *pszGroup;
-                    size_t cch;
-                    switch (pArgs->fFlags & fGrp)
-                    {
-                        case 0:                         pszGroup = "--------";  cch = sizeof("--------") - 1; break;
-                        case RTLOGGRPFLAGS_ENABLED:     pszGroup = "enabled" ;  cch = sizeof("enabled" ) - 1; break;
-                        case RTLOGGRPFLAGS_LEVEL_1:     pszGroup = "level 1" ;  cch = sizeof("level 1" ) - 1; break;
-                        case RTLOGGRPFLAGS_LEVEL_2:     pszGroup = "level 2" ;  cch = sizeof("level 2" ) - 1; break;
-                        case RTLOGGRPFLAGS_LEVEL_3:     pszGroup = "level 3" ;  cch = sizeof("level 3" ) - 1; break;
-                        case RTLOGGRPFLAGS_LEVEL_4:     pszGroup = "level 4" ;  cch = sizeof("level 4" ) - 1; break;
-                        case RTLOGGRPFLAGS_LEVEL_5:     pszGroup = "level 5" ;  cch = sizeof("level 5" ) - 1; break;
-                        case RTLOGGRPFLAGS_LEVEL_6:     pszGroup = "level 6" ;  cch = sizeof("level 6" ) - 1; break;
-                        case RTLOGGRPFLAGS_LEVEL_7:     pszGroup = "level 7" ;  cch = sizeof("level 7" ) - 1; break;
-                        case RTLOGGRPFLAGS_LEVEL_8:     pszGroup = "level 8" ;  cch = sizeof("level 8" ) - 1; break;
-                        case RTLOGGRPFLAGS_LEVEL_9:     pszGroup = "level 9" ;  cch = sizeof("level 9" ) - 1; break;
-                        case RTLOGGRPFLAGS_LEVEL_10:    pszGroup = "level 10";  cch = sizeof("level 10") - 1; break;
-                        case RTLOGGRPFLAGS_LEVEL_11:    pszGroup = "level 11";  cch = sizeof("level 11") - 1; break;
-                        case RTLOGGRPFLAGS_LEVEL_12:    pszGroup = "level 12";  cch = sizeof("level 12") - 1; break;
-                        case RTLOGGRPFLAGS_FLOW:        pszGroup = "flow"    ;  cch = sizeof("flow"    ) - 1; break;
-                        case RTLOGGRPFLAGS_WARN:        pszGroup = "warn"    ;  cch = sizeof("warn"    ) - 1; break;
-                        default:                        pszGroup = "????????";  cch = sizeof("????????") - 1; break;
-                    }
-                    psz = rtLogStPNCpyPad(psz, pszGroup, 16, 8);
+                    rtlogFlush(pLogger);
+                    offScratch = pLogger->offScratch;
+                    cb = sizeof(pLogger->achScratch) - offScratch - 1;
                 }
-#define CCH_PREFIX_16   CCH_PREFIX_15 + 17
 
-#define CCH_PREFIX      ( CCH_PREFIX_16 )
-                { AssertCompile(CCH_PREFIX < 256); }
+                /*
+                 * Write the prefixes.
+                 */
+                psz = rtlogFormatPrefix(pArgs, &pLogger->achScratch[offScratch]);
 
                 /*
                  * Done, figure what we've used and advance the buffer and free size.
@@ -3935,9 +4128,14 @@ static void rtlogLoggerExVLocked(PRTLOGGER pLogger, unsigned fFlags, unsigned iG
     if (pLogger->fFlags & (RTLOGFLAGS_PREFIX_MASK | RTLOGFLAGS_USECRLF))
     {
         RTLOGOUTPUTPREFIXEDARGS OutputArgs;
-        OutputArgs.pLogger = pLogger;
-        OutputArgs.iGroup  = iGroup;
-        OutputArgs.fFlags  = fFlags;
+        OutputArgs.pLogger      = pLogger;
+        OutputArgs.iGroup       = iGroup;
+        OutputArgs.fFlags       = fFlags;
+#ifdef IN_RING3
+        OutputArgs.cLoggerLocks = g_cLoggerLockCount;
+#else
+        OutputArgs.cLoggerLocks = 0;
+#endif
         RTLogFormatV(rtLogOutputPrefixed, &OutputArgs, pszFormat, args);
     }
     else
@@ -3969,3 +4167,513 @@ static void rtlogLoggerExFLocked(PRTLOGGER pLogger, unsigned fFlags, unsigned iG
 }
 #endif /* !IN_RC */
 
+
+#ifdef IN_RING3
+
+/**
+ * TLS destructor for the per-thread async rings.
+ *
+ * The ring is only flagged here, the writer reclaims it once it is empty.
+ *
+ * @param   pvValue     The ring.
+ */
+static DECLCALLBACK(void) rtlogAsyncRingDtor(void *pvValue)
+{
+    PRTLOGASYNCRING pRing = (PRTLOGASYNCRING)pvValue;
+    if (pRing)
+        ASMAtomicWriteBool(&pRing->fOwnerGone, true);
+}
+
+
+/**
+ * Returns the next record in the ring, skipping padding.
+ *
+ * @returns Pointer to the record header, NULL if the ring is empty.
+ * @param   pRing       The ring.  Caller owns the logger lock.
+ */
+static PRTLOGASYNCREC rtlogAsyncRingPeek(PRTLOGASYNCRING pRing)
+{
+    for (;;)
+    {
+        uint32_t const offRead  = pRing->offRead;
+        uint32_t const offWrite = ASMAtomicReadU32(&pRing->offWrite);
+        uint32_t       offIdx;
+        uint32_t       cbToEnd;
+        if (offRead == offWrite)
+            return NULL;
+
+        offIdx  = offRead & (RTLOG_ASYNC_RING_SIZE - 1);
+        cbToEnd = RTLOG_ASYNC_RING_SIZE - offIdx;
+        if (cbToEnd >= sizeof(RTLOGASYNCREC))
+        {
+            PRTLOGASYNCREC pRec = (PRTLOGASYNCREC)&pRing->abRing[offIdx];
+            if (pRec->cbText != RTLOGASYNCREC_PADDING)
+                return pRec;
+        }
+        ASMAtomicWriteU32(&pRing->offRead, offRead + cbToEnd);
+    }
+}
+
+
+/**
+ * Writes out the records of all the async rings in timestamp order.
+ *
+ * Also reports dropped messages and optionally frees the rings of terminated
+ * threads.
+ *
+ * @param   pLogger     The logger instance.  Caller owns the lock.
+ * @param   fReclaim    Whether to free the rings of terminated threads.  Only
+ *                      the writer thread may do this (or rtlogAsyncTerm once
+ *                      it has stopped), as rtlogAsyncHasWork looks at the
+ *                      rings without holding the lock.
+ */
+static void rtlogAsyncDrainLocked(PRTLOGGER pLogger, bool fReclaim)
+{
+    PRTLOGGERINTERNAL   pInt   = pLogger->pInt;
+    PRTLOGASYNC         pAsync = pInt->pAsync;
+    uint32_t const      cRings = ASMAtomicReadU32(&pAsync->cRingsUsed);
+    uint32_t            i;
+    bool                fWritten = false;
+
+    /*
+     * Merge: Keep picking the oldest head record until all rings are empty.
+     */
+    for (;;)
+    {
+        PRTLOGASYNCRING pBest    = NULL;
+        PRTLOGASYNCREC  pBestRec = NULL;
+        for (i = 0; i < cRings; i++)
+        {
+            PRTLOGASYNCRING pRing = ASMAtomicReadPtrT(&pAsync->apRings[i], PRTLOGASYNCRING);
+            if (pRing)
+            {
+                PRTLOGASYNCREC pRec = rtlogAsyncRingPeek(pRing);
+                if (   pRec
+                    && (!pBestRec || pRec->u64NanoTS < pBestRec->u64NanoTS))
+                {
+                    pBest    = pRing;
+                    pBestRec = pRec;
+                }
+            }
+        }
+        if (!pBest)
+            break;
+
+        rtLogOutput(pLogger, (const char *)(pBestRec + 1), pBestRec->cbText);
+        pInt->fPendingPrefix = pBestRec->cbText > 0 && ((const char *)(pBestRec + 1))[pBestRec->cbText - 1] == '\n';
+        ASMAtomicWriteU32(&pBest->offRead, pBest->offRead + RT_ALIGN_32(sizeof(*pBestRec) + pBestRec->cbText, 8));
+        fWritten = true;
+    }
+
+    /*
+     * Report drops and reclaim the rings of dead threads.
+     */
+    for (i = 0; i < cRings; i++)
+    {
+        PRTLOGASYNCRING pRing = ASMAtomicReadPtrT(&pAsync->apRings[i], PRTLOGASYNCRING);
+        if (pRing)
+        {
+            uint32_t cDropped = ASMAtomicXchgU32(&pRing->cDropped, 0);
+            if (cDropped)
+            {
+                rtlogLoggerExFLocked(pLogger, 0, ~0U, "Log: %u messages dropped from thread %RTnthrd (ring buffer full)\n",
+                                     cDropped, pRing->hNativeOwner);
+                fWritten = true;
+            }
+            if (   fReclaim
+                && ASMAtomicReadBool(&pRing->fOwnerGone)
+                && pRing->offRead == ASMAtomicReadU32(&pRing->offWrite))
+            {
+                ASMAtomicWriteNullPtr(&pAsync->apRings[i]);
+                RTMemFree(pRing);
+            }
+        }
+    }
+
+    if (   fWritten
+        && !(pLogger->fFlags & RTLOGFLAGS_BUFFERED)
+        && pLogger->offScratch)
+        rtlogFlush(pLogger);
+}
+
+
+/**
+ * Checks whether any of the async rings have records or drops pending.
+ *
+ * This is done without the lock, which is safe since only the calling writer
+ * thread frees rings.
+ *
+ * @returns true if there is something to write, false if not.
+ * @param   pAsync      The async logging state.
+ */
+static bool rtlogAsyncHasWork(PRTLOGASYNC pAsync)
+{
+    uint32_t const cRings = ASMAtomicReadU32(&pAsync->cRingsUsed);
+    for (uint32_t i = 0; i < cRings; i++)
+    {
+        PRTLOGASYNCRING pRing = ASMAtomicReadPtrT(&pAsync->apRings[i], PRTLOGASYNCRING);
+        if (   pRing
+            && (   ASMAtomicReadU32(&pRing->offRead) != ASMAtomicReadU32(&pRing->offWrite)
+                || ASMAtomicReadU32(&pRing->cDropped)
+                || ASMAtomicReadBool(&pRing->fOwnerGone)))
+            return true;
+    }
+    return false;
+}
+
+
+/**
+ * The async writer thread.
+ *
+ * @returns VINF_SUCCESS.
+ * @param   hThreadSelf The thread handle.
+ * @param   pvUser      The logger instance.
+ */
+static DECLCALLBACK(int) rtlogAsyncWriterThread(RTTHREAD hThreadSelf, void *pvUser)
+{
+    PRTLOGGER   pLogger = (PRTLOGGER)pvUser;
+    PRTLOGASYNC pAsync  = pLogger->pInt->pAsync;
+    RT_NOREF_PV(hThreadSelf);
+
+    while (!ASMAtomicReadBool(&pAsync->fShutdown))
+    {
+        RTSemEventWait(pAsync->hEvtWriter, RTLOG_ASYNC_WRITER_INTERVAL);
+        if (rtlogAsyncHasWork(pAsync))
+        {
+            int rc = rtlogLock(pLogger);
+            if (RT_SUCCESS(rc))
+            {
+                rtlogAsyncDrainLocked(pLogger, true /*fReclaim*/);
+                rtlogUnlock(pLogger);
+            }
+        }
+    }
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Sets up async logging for the logger.
+ *
+ * Only one thread does this, the others use the synchronous path meanwhile.
+ *
+ * @returns Pointer to the async state on success, NULL if async logging
+ *          isn't available (yet).
+ * @param   pLogger     The logger instance.
+ */
+static PRTLOGASYNC rtlogAsyncStart(PRTLOGGER pLogger)
+{
+    PRTLOGGERINTERNAL   pInt = pLogger->pInt;
+    PRTLOGASYNC         pAsync;
+    if (!ASMAtomicCmpXchgU32(&pInt->uAsyncState, RTLOGASYNCSTATE_STARTING, RTLOGASYNCSTATE_NONE))
+        return NULL;
+
+    pAsync = (PRTLOGASYNC)RTMemAllocZ(sizeof(*pAsync));
+    if (pAsync)
+    {
+        /* Windows doesn't do TLS destructors, so the rings of terminated threads
+           will stick around till the logger is destroyed. */
+# ifdef RT_OS_WINDOWS
+        int rc = RTTlsAllocEx(&pAsync->iTls, NULL);
+# else
+        int rc = RTTlsAllocEx(&pAsync->iTls, rtlogAsyncRingDtor);
+# endif
+        if (RT_SUCCESS(rc))
+        {
+            rc = RTSemEventCreate(&pAsync->hEvtWriter);
+            if (RT_SUCCESS(rc))
+            {
+                ASMAtomicWritePtr(&pInt->pAsync, pAsync);
+                rc = RTThreadCreate(&pAsync->hWriterThread, rtlogAsyncWriterThread, pLogger, 0 /*cbStack*/,
+                                    RTTHREADTYPE_DEFAULT, RTTHREADFLAGS_WAITABLE, "LogWriter");
+                if (RT_SUCCESS(rc))
+                {
+                    ASMAtomicWriteU32(&pInt->uAsyncState, RTLOGASYNCSTATE_RUNNING);
+                    return pAsync;
+                }
+
+                /* Nobody could have put anything in the rings yet, but another
+                   thread may be draining them under the lock. */
+                rc = rtlogLock(pLogger);
+                ASMAtomicWriteNullPtr(&pInt->pAsync);
+                if (RT_SUCCESS(rc))
+                    rtlogUnlock(pLogger);
+                RTSemEventDestroy(pAsync->hEvtWriter);
+            }
+            RTTlsFree(pAsync->iTls);
+        }
+        RTMemFree(pAsync);
+    }
+    ASMAtomicWriteU32(&pInt->uAsyncState, RTLOGASYNCSTATE_DEAD);
+    return NULL;
+}
+
+
+/**
+ * Gets the ring of the calling thread, creating it if necessary.
+ *
+ * @returns Pointer to the ring, NULL if the thread must use the synchronous
+ *          path (out of slots or memory).
+ * @param   pAsync      The async logging state.
+ */
+static PRTLOGASYNCRING rtlogAsyncRingGet(PRTLOGASYNC pAsync)
+{
+    PRTLOGASYNCRING pRing = (PRTLOGASYNCRING)RTTlsGet(pAsync->iTls);
+    uint32_t        i;
+    if (RT_LIKELY(pRing))
+        return pRing;
+
+    /*
+     * Check for a free slot before allocating anything.
+     */
+    for (i = 0; i < RT_ELEMENTS(pAsync->apRings); i++)
+        if (!ASMAtomicReadPtrT(&pAsync->apRings[i], PRTLOGASYNCRING))
+            break;
+    if (i >= RT_ELEMENTS(pAsync->apRings))
+        return NULL;
+
+    pRing = (PRTLOGASYNCRING)RTMemAlloc(sizeof(*pRing));
+    if (!pRing)
+        return NULL;
+    pRing->offWrite       = 0;
+    pRing->fPendingPrefix = true;
+    pRing->offRead        = 0;
+    pRing->cDropped       = 0;
+    pRing->fOwnerGone     = false;
+    pRing->hNativeOwner   = RTThreadNativeSelf();
+
+    for (; i < RT_ELEMENTS(pAsync->apRings); i++)
+        if (ASMAtomicCmpXchgPtr(&pAsync->apRings[i], pRing, NULL))
+        {
+            uint32_t cUsed;
+            while (   (cUsed = ASMAtomicReadU32(&pAsync->cRingsUsed)) <= i
+                   && !ASMAtomicCmpXchgU32(&pAsync->cRingsUsed, i + 1, cUsed))
+                ASMNopPause();
+
+            if (RT_SUCCESS(RTTlsSet(pAsync->iTls, pRing)))
+                return pRing;
+            ASMAtomicWriteBool(&pRing->fOwnerGone, true); /* the writer frees it */
+            return NULL;
+        }
+
+    RTMemFree(pRing);
+    return NULL;
+}
+
+
+/**
+ * Callback for RTLogFormatV which writes to the staging buffer of the
+ * calling thread's async ring.
+ *
+ * This does the same prefixing and CRLF conversion as rtLogOutputPrefixed.
+ *
+ * See PFNLOGOUTPUT() for details.
+ */
+static DECLCALLBACK(size_t) rtLogOutputAsync(void *pv, const char *pachChars, size_t cbChars)
+{
+    PRTLOGASYNCOUTPUTARGS   pArgs     = (PRTLOGASYNCOUTPUTARGS)pv;
+    PRTLOGASYNCRING         pRing     = pArgs->pRing;
+    uint32_t const          fLogFlags = pArgs->Prefixed.pLogger->fFlags;
+    bool const              fPrefixed = RT_BOOL(fLogFlags & (RTLOGFLAGS_PREFIX_MASK | RTLOGFLAGS_USECRLF));
+    size_t const            cbRet     = cbChars;
+
+    while (cbChars > 0 && !pArgs->fOverflow)
+    {
+        const char *pszNewLine = NULL;
+        size_t      cb         = cbChars;
+
+        if (fPrefixed)
+        {
+            /* Pending prefix?  (Same max size assumption as rtLogOutputPrefixed.) */
+            if (pRing->fPendingPrefix)
+            {
+                char *psz;
+                if (pArgs->offStaging + 256 > sizeof(pRing->achStaging))
+                {
+                    pArgs->fOverflow = true;
+                    break;
+                }
+                psz = rtlogFormatPrefix(&pArgs->Prefixed, &pRing->achStaging[pArgs->offStaging]);
+                pArgs->offStaging = psz - &pRing->achStaging[0];
+                pRing->fPendingPrefix = false;
+            }
+
+            pszNewLine = (const char *)memchr(pachChars, '\n', cb);
+            if (pszNewLine)
+            {
+                if (fLogFlags & RTLOGFLAGS_USECRLF)
+                    cb = pszNewLine - pachChars;
+                else
+                    cb = pszNewLine - pachChars + 1;
+                pRing->fPendingPrefix = true;
+            }
+        }
+
+        if (pArgs->offStaging + cb + 2 > sizeof(pRing->achStaging))
+        {
+            pArgs->fOverflow = true;
+            break;
+        }
+        memcpy(&pRing->achStaging[pArgs->offStaging], pachChars, cb);
+        pArgs->offStaging += cb;
+        pachChars += cb;
+        cbChars   -= cb;
+
+        if (pszNewLine && (fLogFlags & RTLOGFLAGS_USECRLF))
+        {
+            memcpy(&pRing->achStaging[pArgs->offStaging], "\r\n", 2);
+            pArgs->offStaging += 2;
+            pachChars++;
+            cbChars--;
+        }
+    }
+    return cbRet;
+}
+
+
+/**
+ * Formats a message into the calling thread's async ring.
+ *
+ * @returns true if the message was dealt with (queued or dropped), false if the
+ *          caller must write it synchronously.
+ * @param   pLogger     The logger instance.
+ * @param   fFlags      The logging flags.
+ * @param   iGroup      The group.
+ * @param   pszFormat   Format string.
+ * @param   args        Format arguments.  Not consumed.
+ */
+static bool rtlogAsyncLoggerExV(PRTLOGGER pLogger, unsigned fFlags, unsigned iGroup, const char *pszFormat, va_list args)
+{
+    PRTLOGGERINTERNAL       pInt = pLogger->pInt;
+    PRTLOGASYNC             pAsync;
+    PRTLOGASYNCRING         pRing;
+    RTLOGASYNCOUTPUTARGS    OutputArgs;
+    bool                    fPendingPrefix;
+    va_list                 va;
+    uint32_t                cbRec;
+
+    /*
+     * Get the async state and the ring of this thread.
+     */
+    if (RT_LIKELY(ASMAtomicReadU32(&pInt->uAsyncState) == RTLOGASYNCSTATE_RUNNING))
+        pAsync = pInt->pAsync;
+    else
+    {
+        pAsync = rtlogAsyncStart(pLogger);
+        if (!pAsync)
+            return false;
+    }
+    pRing = rtlogAsyncRingGet(pAsync);
+    if (!pRing)
+        return false;
+
+    /*
+     * Format it into the staging buffer.  Messages too big for it are
+     * written synchronously.
+     */
+    fPendingPrefix                   = pRing->fPendingPrefix;
+    OutputArgs.Prefixed.pLogger      = pLogger;
+    OutputArgs.Prefixed.fFlags       = fFlags;
+    OutputArgs.Prefixed.iGroup       = iGroup;
+    OutputArgs.Prefixed.cLoggerLocks = 0;
+    OutputArgs.pRing                 = pRing;
+    OutputArgs.offStaging            = 0;
+    OutputArgs.fOverflow             = false;
+    va_copy(va, args);
+    RTLogFormatV(rtLogOutputAsync, &OutputArgs, pszFormat, va);
+    va_end(va);
+    if (OutputArgs.fOverflow)
+    {
+        pRing->fPendingPrefix = fPendingPrefix;
+        return false;
+    }
+    if (!OutputArgs.offStaging)
+        return true;
+
+    /*
+     * Reserve space in the ring.  If it's full, either drop the message or
+     * fall back on the synchronous path (which empties the rings).
+     */
+    cbRec = RT_ALIGN_32(sizeof(RTLOGASYNCREC) + (uint32_t)OutputArgs.offStaging, 8);
+    for (;;)
+    {
+        uint32_t const offWrite = pRing->offWrite;
+        uint32_t const cbUsed   = offWrite - ASMAtomicReadU32(&pRing->offRead);
+        uint32_t const offIdx   = offWrite & (RTLOG_ASYNC_RING_SIZE - 1);
+        uint32_t const cbToEnd  = RTLOG_ASYNC_RING_SIZE - offIdx;
+        PRTLOGASYNCREC pRec;
+
+        if (cbToEnd < cbRec)
+        {
+            /* Doesn't fit before the end of the ring, pad and wrap around. */
+            if (RTLOG_ASYNC_RING_SIZE - cbUsed < cbToEnd + cbRec)
+                break;
+            if (cbToEnd >= sizeof(RTLOGASYNCREC))
+                ((PRTLOGASYNCREC)&pRing->abRing[offIdx])->cbText = RTLOGASYNCREC_PADDING;
+            ASMAtomicWriteU32(&pRing->offWrite, offWrite + cbToEnd);
+            continue;
+        }
+        if (RTLOG_ASYNC_RING_SIZE - cbUsed < cbRec)
+            break;
+
+        pRec = (PRTLOGASYNCREC)&pRing->abRing[offIdx];
+        pRec->u64NanoTS   = RTTimeNanoTS();
+        pRec->cbText      = (uint32_t)OutputArgs.offStaging;
+        pRec->u32Reserved = 0;
+        memcpy(pRec + 1, pRing->achStaging, OutputArgs.offStaging);
+        ASMAtomicWriteU32(&pRing->offWrite, offWrite + cbRec);
+
+        /* Kick the writer when passing the half full mark, it polls otherwise. */
+        if (   cbUsed < RTLOG_ASYNC_RING_SIZE / 2
+            && cbUsed + cbRec >= RTLOG_ASYNC_RING_SIZE / 2)
+            RTSemEventSignal(pAsync->hEvtWriter);
+        return true;
+    }
+
+    if (pLogger->fFlags & RTLOGFLAGS_ASYNC_DROP)
+    {
+        ASMAtomicIncU32(&pRing->cDropped);
+        RTSemEventSignal(pAsync->hEvtWriter);
+        return true;
+    }
+    pRing->fPendingPrefix = fPendingPrefix;
+    return false;
+}
+
+
+/**
+ * Stops the async writer thread and frees the async logging state.
+ *
+ * @param   pLogger     The logger instance.  Caller does not own the lock.
+ */
+static void rtlogAsyncTerm(PRTLOGGER pLogger)
+{
+    PRTLOGGERINTERNAL   pInt   = pLogger->pInt;
+    PRTLOGASYNC         pAsync = pInt->pAsync;
+    int                 rc;
+    uint32_t            i;
+    ASMAtomicWriteU32(&pInt->uAsyncState, RTLOGASYNCSTATE_DEAD);
+    if (!pAsync)
+        return;
+
+    ASMAtomicWriteBool(&pAsync->fShutdown, true);
+    RTSemEventSignal(pAsync->hEvtWriter);
+    rc = RTThreadWait(pAsync->hWriterThread, RT_INDEFINITE_WAIT, NULL);
+    AssertRC(rc);
+
+    rc = rtlogLock(pLogger);
+    if (RT_SUCCESS(rc))
+    {
+        rtlogAsyncDrainLocked(pLogger, true /*fReclaim*/);
+        ASMAtomicWriteNullPtr(&pInt->pAsync);
+        rtlogUnlock(pLogger);
+    }
+
+    RTTlsFree(pAsync->iTls);
+    for (i = 0; i < RT_ELEMENTS(pAsync->apRings); i++)
+        RTMemFree(pAsync->apRings[i]);
+    RTSemEventDestroy(pAsync->hEvtWriter);
+    RTMemFree(pAsync);
+}
+
+#endif /* IN_RING3 */
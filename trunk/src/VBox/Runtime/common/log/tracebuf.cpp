@@ -47,6 +47,10 @@
 #include <iprt/path.h>
 #include <iprt/string.h>
 #include <iprt/time.h>
+#ifdef IN_RING3
+# include <iprt/ctype.h>
+# include <iprt/file.h>
+#endif
 
 #include "internal/magics.h"
 
@@ -105,6 +109,112 @@ AssertCompile(sizeof(RTTRACEBUFENTRY) <= RTTRACEBUF_ALIGNMENT);
 typedef RTTRACEBUFENTRY *PRTTRACEBUFENTRY;
 
 
+/**
+ * Binary trace buffer entry (RTTraceBufAddBinMsgV).
+ *
+ * Instead of the message text this holds the format string address and the
+ * raw arguments.  Strings arguments are copied to the end of the entry.
+ */
+typedef struct RTTRACEBUFBINENTRY
+{
+    /** The nano second entry time stamp. */
+    uint64_t            NanoTS;
+    /** The ID of the CPU the event was recorded.  */
+    RTCPUID             idCpu;
+    /** Reserved, MBZ.  Overlays RTTRACEBUFENTRY::szMsg[0] so the entry reads
+     * as an empty string to anyone ignoring RTTRACEBUF_NANOTS_BINARY. */
+    uint8_t             bReserved;
+    /** Number of entries in au64Args. */
+    uint8_t             cArgs;
+    /** Reserved, MBZ. */
+    uint16_t            u16Reserved;
+    /** The format string address (string table index in saved files). */
+    uint64_t            uFmt;
+    /** The arguments; string arguments are entry offsets (UINT64_MAX for NULL). */
+    uint64_t            au64Args[1];
+} RTTRACEBUFBINENTRY;
+AssertCompileMemberOffset(RTTRACEBUFENTRY, szMsg, 12);
+AssertCompileMemberOffset(RTTRACEBUFBINENTRY, bReserved, 12);
+AssertCompileMemberOffset(RTTRACEBUFBINENTRY, au64Args, 24);
+/** Pointer to a binary trace buffer entry. */
+typedef RTTRACEBUFBINENTRY *PRTTRACEBUFBINENTRY;
+/** Pointer to a const binary trace buffer entry. */
+typedef RTTRACEBUFBINENTRY const *PCRTTRACEBUFBINENTRY;
+
+/** RTTRACEBUFENTRY::NanoTS flag marking a binary entry.  Kept in the header
+ * rather than the message so text entries can start with any character. */
+#define RTTRACEBUF_NANOTS_BINARY    RT_BIT_64(63)
+/** Gets the time stamp of an entry, sans RTTRACEBUF_NANOTS_BINARY. */
+#define RTTRACEBUF_ENTRY_NANOTS(a_pEntry)       ((a_pEntry)->NanoTS & ~RTTRACEBUF_NANOTS_BINARY)
+/** Checks if an entry is a binary one (RTTRACEBUFBINENTRY). */
+#define RTTRACEBUF_ENTRY_IS_BINARY(a_pEntry)    RT_BOOL((a_pEntry)->NanoTS & RTTRACEBUF_NANOTS_BINARY)
+/** The max number of arguments (including '*' width and precision) of a
+ * binary entry. */
+#define RTTRACEBUF_BIN_MAX_ARGS     32
+/** The max length of a single format specifier we handle. */
+#define RTTRACEBUF_BIN_MAX_SPEC     32
+/** The size of the buffer for decoding binary entries. */
+#ifdef IN_RING3
+# define RTTRACEBUF_BIN_MAX_TEXT    1024
+#else
+# define RTTRACEBUF_BIN_MAX_TEXT    256
+#endif
+
+/** rtTraceBufBinParseSpec precision value for '.*'. */
+#define RTTRACEBUF_BIN_PREC_STAR    (UINT32_MAX - 1)
+
+/** @name RTTRACEBUF_BINARG_XXX - How a binary entry argument is passed.
+ * @{ */
+/** Not supported, the message must be formatted right away. */
+#define RTTRACEBUF_BINARG_INVALID   0
+/** No argument (%%). */
+#define RTTRACEBUF_BINARG_NONE      1
+/** int and anything promoted to it, including 32-bit IPRT types. */
+#define RTTRACEBUF_BINARG_INT       2
+/** long. */
+#define RTTRACEBUF_BINARG_LONG      3
+/** 64-bit integers. */
+#define RTTRACEBUF_BINARG_U64       4
+/** size_t, ptrdiff_t and uintptr_t (%p). */
+#define RTTRACEBUF_BINARG_UPTR      5
+/** Zero terminated string, copied into the entry. */
+#define RTTRACEBUF_BINARG_STR       6
+/** @} */
+
+
+/**
+ * The header of a trace buffer file (RTTraceBufSaveToFile).
+ *
+ * The header is followed by cEntries entries of cbEntry bytes each, oldest
+ * first, and then cFmts zero terminated format strings (cbFmtTab bytes).  The
+ * entries are stored as-is, RTTRACEBUF_NANOTS_BINARY included, except that the
+ * RTTRACEBUFBINENTRY::uFmt members are indexes into the format strings.
+ */
+typedef struct RTTRACEBUFFILEHDR
+{
+    /** Magic (RTTRACEBUFFILEHDR_MAGIC). */
+    char                szMagic[16];
+    /** The version (RTTRACEBUFFILEHDR_VERSION). */
+    uint32_t            uVersion;
+    /** The entry size. */
+    uint32_t            cbEntry;
+    /** The number of entries in the file. */
+    uint32_t            cEntries;
+    /** The number of format strings. */
+    uint32_t            cFmts;
+    /** The size of the format string table. */
+    uint32_t            cbFmtTab;
+    /** Reserved, MBZ. */
+    uint32_t            au32Reserved[3];
+} RTTRACEBUFFILEHDR;
+AssertCompileSize(RTTRACEBUFFILEHDR, 48);
+/** The RTTRACEBUFFILEHDR::szMagic value. */
+#define RTTRACEBUFFILEHDR_MAGIC     "IPRT-TraceBuf\0\0"
+AssertCompile(sizeof(RTTRACEBUFFILEHDR_MAGIC) == 16);
+/** The RTTRACEBUFFILEHDR::uVersion value. */
+#define RTTRACEBUFFILEHDR_VERSION   UINT32_C(2)
+
+
 
 /**
  * Trace buffer structure.
@@ -458,6 +568,436 @@ static void rtTraceBufDestroy(RTTRACEBUFINT *pThis)
 }
 
 
+#ifdef IN_RING3
+
+/**
+ * Parses one format specifier for binary entries.
+ *
+ * This mirrors the parsing in RTStrFormatV and the simple integer types of
+ * rtstrFormatRt, anything else is declared unsupported.
+ *
+ * @returns How the argument is passed, RTTRACEBUF_BINARG_XXX.
+ * @param   ppszFmt     Pointer to the format string pointer, which points at
+ *                      the '%'.  Advanced past the specifier on success.
+ * @param   pcStars     Where to return the number of '*' (int) arguments
+ *                      preceding the value.
+ * @param   pcchPrec    Where to return the precision.  UINT32_MAX if none was
+ *                      given, RTTRACEBUF_BIN_PREC_STAR if it is passed as the
+ *                      last '*' argument.  Optional.
+ */
+static uint8_t rtTraceBufBinParseSpec(const char **ppszFmt, unsigned *pcStars, uint32_t *pcchPrec)
+{
+    /** Simple integer IPRT types, the part following 'R'. */
+    static const struct
+    {
+        uint8_t     cch;
+        char        sz[7];
+        uint8_t     cb;
+    } s_aRtTypes[] =
+    {
+#define RTTRACEBUF_RT_TYPE(a_sz, a_Type) { sizeof(a_sz) - 1, a_sz, sizeof(a_Type) }
+        RTTRACEBUF_RT_TYPE("X8",     uint8_t),
+        RTTRACEBUF_RT_TYPE("X16",    uint16_t),
+        RTTRACEBUF_RT_TYPE("X32",    uint32_t),
+        RTTRACEBUF_RT_TYPE("X64",    uint64_t),
+        RTTRACEBUF_RT_TYPE("U8",     uint8_t),
+        RTTRACEBUF_RT_TYPE("U16",    uint16_t),
+        RTTRACEBUF_RT_TYPE("U32",    uint32_t),
+        RTTRACEBUF_RT_TYPE("U64",    uint64_t),
+        RTTRACEBUF_RT_TYPE("I8",     int8_t),
+        RTTRACEBUF_RT_TYPE("I16",    int16_t),
+        RTTRACEBUF_RT_TYPE("I32",    int32_t),
+        RTTRACEBUF_RT_TYPE("I64",    int64_t),
+        RTTRACEBUF_RT_TYPE("Gi",     RTGCINT),
+        RTTRACEBUF_RT_TYPE("Gp",     RTGCPHYS),
+        RTTRACEBUF_RT_TYPE("Gr",     RTGCUINTREG),
+        RTTRACEBUF_RT_TYPE("Gu",     RTGCUINT),
+        RTTRACEBUF_RT_TYPE("Gv",     RTGCPTR),
+        RTTRACEBUF_RT_TYPE("Gx",     RTGCUINT),
+        RTTRACEBUF_RT_TYPE("Hi",     RTHCINT),
+        RTTRACEBUF_RT_TYPE("Hp",     RTHCPHYS),
+        RTTRACEBUF_RT_TYPE("Hr",     RTHCUINTREG),
+        RTTRACEBUF_RT_TYPE("Hu",     RTHCUINT),
+        RTTRACEBUF_RT_TYPE("Hv",     RTHCPTR),
+        RTTRACEBUF_RT_TYPE("Hx",     RTHCUINT),
+        RTTRACEBUF_RT_TYPE("Tbool",  bool),
+        RTTRACEBUF_RT_TYPE("Tint",   RTINT),
+        RTTRACEBUF_RT_TYPE("Tiop",   RTIOPORT),
+        RTTRACEBUF_RT_TYPE("Tnthrd", RTNATIVETHREAD),
+        RTTRACEBUF_RT_TYPE("Tproc",  RTPROCESS),
+        RTTRACEBUF_RT_TYPE("Tptr",   RTUINTPTR),
+        RTTRACEBUF_RT_TYPE("Treg",   RTCCUINTREG),
+        RTTRACEBUF_RT_TYPE("Tsel",   RTSEL),
+        RTTRACEBUF_RT_TYPE("Tthrd",  RTTHREAD),
+        RTTRACEBUF_RT_TYPE("Tuint",  RTUINT),
+        RTTRACEBUF_RT_TYPE("Txint",  RTUINT),
+        RTTRACEBUF_RT_TYPE("rc",     int),
+        RTTRACEBUF_RT_TYPE("rs",     int),
+        RTTRACEBUF_RT_TYPE("rf",     int),
+        RTTRACEBUF_RT_TYPE("ra",     int),
+#undef RTTRACEBUF_RT_TYPE
+    };
+    const char *psz     = *ppszFmt + 1;
+    unsigned    cStars  = 0;
+    uint32_t    cchPrec = UINT32_MAX;
+    char        chArgSize;
+    uint8_t     bArg;
+
+    /* flags */
+    while (*psz == '#' || *psz == '-' || *psz == '+' || *psz == ' ' || *psz == '0' || *psz == '\'')
+        psz++;
+
+    /* width */
+    if (*psz == '*')
+    {
+        cStars++;
+        psz++;
+    }
+    else
+        while (RT_C_IS_DIGIT(*psz))
+            psz++;
+
+    /* precision */
+    if (*psz == '.')
+    {
+        psz++;
+        if (*psz == '*')
+        {
+            cStars++;
+            psz++;
+            cchPrec = RTTRACEBUF_BIN_PREC_STAR;
+        }
+        else
+            for (cchPrec = 0; RT_C_IS_DIGIT(*psz); psz++)
+                cchPrec = RT_MIN(cchPrec * 10 + (uint32_t)(*psz - '0'), (uint32_t)RTTRACEBUF_BIN_MAX_TEXT);
+    }
+    if (pcchPrec)
+        *pcchPrec = cchPrec;
+
+    /* argument size */
+    chArgSize = *psz;
+    switch (chArgSize)
+    {
+        default:
+            chArgSize = 0;
+            break;
+        case 'z':
+        case 'L':
+        case 'j':
+        case 't':
+            psz++;
+            break;
+        case 'l':
+            psz++;
+            if (*psz == 'l')
+            {
+                chArgSize = 'L';
+                psz++;
+            }
+            break;
+        case 'h':
+            psz++;
+            if (*psz == 'h')
+                psz++;
+            break;
+        case 'I':
+            if (psz[1] == '6' && psz[2] == '4')
+            {
+                psz += 3;
+                chArgSize = 'L';
+            }
+            else if (psz[1] == '3' && psz[2] == '2')
+            {
+                psz += 3;
+                chArgSize = 0;
+            }
+            else
+            {
+                psz += 1;
+                chArgSize = 'j';
+            }
+            break;
+        case 'q':
+            psz++;
+            chArgSize = 'L';
+            break;
+    }
+
+    /* the type */
+    switch (*psz++)
+    {
+        case '%':
+            bArg = cStars || chArgSize ? RTTRACEBUF_BINARG_INVALID : RTTRACEBUF_BINARG_NONE;
+            break;
+
+        case 'c':
+            bArg = RTTRACEBUF_BINARG_INT;
+            break;
+
+        case 's':
+            bArg = chArgSize == 0 ? RTTRACEBUF_BINARG_STR : RTTRACEBUF_BINARG_INVALID;
+            break;
+
+        case 'p':
+            bArg = RTTRACEBUF_BINARG_UPTR;
+            break;
+
+        case 'd':
+        case 'i':
+        case 'o':
+        case 'u':
+        case 'x':
+        case 'X':
+            switch (chArgSize)
+            {
+                case 'L':
+                case 'j':   bArg = RTTRACEBUF_BINARG_U64;   break;
+                case 'l':   bArg = RTTRACEBUF_BINARG_LONG;  break;
+                case 'z':
+                case 't':   bArg = RTTRACEBUF_BINARG_UPTR;  break;
+                default:    bArg = RTTRACEBUF_BINARG_INT;   break;
+            }
+            break;
+
+        case 'R':
+        {
+            unsigned i;
+            bArg = RTTRACEBUF_BINARG_INVALID;
+            if (chArgSize)
+                break;
+            for (i = 0; i < RT_ELEMENTS(s_aRtTypes); i++)
+                if (!strncmp(psz, s_aRtTypes[i].sz, s_aRtTypes[i].cch))
+                {
+                    psz += s_aRtTypes[i].cch;
+                    bArg = s_aRtTypes[i].cb <= sizeof(uint32_t) ? RTTRACEBUF_BINARG_INT : RTTRACEBUF_BINARG_U64;
+                    break;
+                }
+            break;
+        }
+
+        default:
+            bArg = RTTRACEBUF_BINARG_INVALID;
+            break;
+    }
+
+    if (   bArg != RTTRACEBUF_BINARG_INVALID
+        && (size_t)(psz - *ppszFmt) < RTTRACEBUF_BIN_MAX_SPEC - 16 /* room for the '*' values */)
+    {
+        *ppszFmt = psz;
+        *pcStars = cStars;
+        return bArg;
+    }
+    return RTTRACEBUF_BINARG_INVALID;
+}
+
+
+/**
+ * Records the format string address and the raw arguments in a binary entry.
+ *
+ * @returns true on success, false if the format string has unsupported
+ *          specifiers or the arguments doesn't fit.
+ * @param   pEntry      The entry.  Only NanoTS and idCpu has been set.
+ * @param   cbEntry     The entry size.
+ * @param   pszFmt      The format string.  Must stay valid as long as the
+ *                      entry might be decoded.
+ * @param   va          The arguments.
+ */
+static bool rtTraceBufBinEncode(PRTTRACEBUFBINENTRY pEntry, uint32_t cbEntry, const char *pszFmt, va_list va)
+{
+    uint32_t const  cMaxArgs = RT_MIN((cbEntry - RT_OFFSETOF(RTTRACEBUFBINENTRY, au64Args)) / sizeof(uint64_t),
+                                      RTTRACEBUF_BIN_MAX_ARGS);
+    uint32_t        offStr   = cbEntry;
+    unsigned        cArgs    = 0;
+    const char     *psz      = pszFmt;
+
+    while ((psz = strchr(psz, '%')) != NULL)
+    {
+        unsigned cStars;
+        uint32_t cchPrec;
+        int      iLastStar = -1;
+        uint8_t  bArg = rtTraceBufBinParseSpec(&psz, &cStars, &cchPrec);
+        if (bArg == RTTRACEBUF_BINARG_INVALID)
+            return false;
+        if (bArg == RTTRACEBUF_BINARG_NONE)
+            continue;
+        if (cArgs + cStars + 1 > cMaxArgs)
+            return false;
+
+        while (cStars-- > 0)
+        {
+            iLastStar = va_arg(va, int);
+            pEntry->au64Args[cArgs++] = (uint32_t)iLastStar;
+        }
+        if (cchPrec == RTTRACEBUF_BIN_PREC_STAR)
+            cchPrec = iLastStar >= 0 ? (uint32_t)iLastStar : UINT32_MAX; /* negative means none, like printf */
+
+        switch (bArg)
+        {
+            case RTTRACEBUF_BINARG_INT:     pEntry->au64Args[cArgs] = va_arg(va, unsigned int); break;
+            case RTTRACEBUF_BINARG_LONG:    pEntry->au64Args[cArgs] = va_arg(va, unsigned long); break;
+            case RTTRACEBUF_BINARG_U64:     pEntry->au64Args[cArgs] = va_arg(va, uint64_t); break;
+            case RTTRACEBUF_BINARG_UPTR:    pEntry->au64Args[cArgs] = va_arg(va, uintptr_t); break;
+            case RTTRACEBUF_BINARG_STR:
+            {
+                /* Copy the string (or as much as fits and the precision allows)
+                   to the end of the entry.  With a precision the string needs
+                   not be terminated, so never look beyond it. */
+                const char *pszArg = va_arg(va, const char *);
+                if (!pszArg)
+                    pEntry->au64Args[cArgs] = UINT64_MAX;
+                else
+                {
+                    uint32_t const offArgsEnd = RT_OFFSETOF(RTTRACEBUFBINENTRY, au64Args) + (cArgs + 1) * sizeof(uint64_t);
+                    size_t         cchArg;
+                    if (offStr <= offArgsEnd)
+                        return false;
+                    cchArg = RTStrNLen(pszArg, RT_MIN(offStr - offArgsEnd - 1, cchPrec));
+                    offStr -= (uint32_t)cchArg + 1;
+                    memcpy((char *)pEntry + offStr, pszArg, cchArg);
+                    ((char *)pEntry)[offStr + cchArg] = '\0';
+                    pEntry->au64Args[cArgs] = offStr;
+                }
+                break;
+            }
+        }
+        cArgs++;
+        if (RT_OFFSETOF(RTTRACEBUFBINENTRY, au64Args) + cArgs * sizeof(uint64_t) > offStr)
+            return false;
+    }
+
+    pEntry->cArgs       = (uint8_t)cArgs;
+    pEntry->u16Reserved = 0;
+    pEntry->uFmt        = (uintptr_t)pszFmt;
+    pEntry->bReserved   = 0;
+    pEntry->NanoTS     |= RTTRACEBUF_NANOTS_BINARY;
+    return true;
+}
+
+
+/**
+ * Formats a binary entry.
+ *
+ * @returns @a pszDst.
+ * @param   pEntry      The entry.
+ * @param   cbEntry     The entry size.
+ * @param   pszFmt      The format string the entry was recorded with.
+ * @param   pszDst      The output buffer.
+ * @param   cbDst       The size of the output buffer.
+ */
+static const char *rtTraceBufBinDecode(PCRTTRACEBUFBINENTRY pEntry, uint32_t cbEntry, const char *pszFmt,
+                                       char *pszDst, size_t cbDst)
+{
+    size_t      offDst = 0;
+    unsigned    iArg   = 0;
+    const char *psz    = pszFmt;
+    unsigned    cArgs  = RT_MIN(pEntry->cArgs, (cbEntry - RT_OFFSETOF(RTTRACEBUFBINENTRY, au64Args)) / sizeof(uint64_t));
+    *pszDst = '\0';
+
+    while (offDst + 1 < cbDst && *psz)
+    {
+        const char *pszSpec = strchr(psz, '%');
+        size_t      cchLit  = pszSpec ? (size_t)(pszSpec - psz) : strlen(psz);
+        unsigned    cStars;
+        uint8_t     bArg;
+        char        szSpec[RTTRACEBUF_BIN_MAX_SPEC];
+        size_t      offSpec;
+        uint64_t    uValue;
+
+        /* The literal part. */
+        if (cchLit)
+        {
+            size_t cchCopy = RT_MIN(cchLit, cbDst - offDst - 1);
+            memcpy(&pszDst[offDst], psz, cchCopy);
+            offDst += cchCopy;
+            pszDst[offDst] = '\0';
+            psz += cchLit;
+            continue;
+        }
+
+        /* The specifier, with the '*' values put in place. */
+        bArg = rtTraceBufBinParseSpec(&psz, &cStars, NULL);
+        if (bArg == RTTRACEBUF_BINARG_INVALID || iArg + cStars + (bArg != RTTRACEBUF_BINARG_NONE) > cArgs)
+        {
+            RTStrPrintf(&pszDst[offDst], cbDst - offDst, "<bad entry>");
+            break;
+        }
+        offSpec = 0;
+        for (const char *pszIn = pszSpec; pszIn < psz; pszIn++)
+        {
+            if (*pszIn == '*')
+            {
+                int32_t iStar = (int32_t)pEntry->au64Args[iArg++];
+                if (iStar < 0 && pszIn[-1] == '.')
+                    iStar = 0;
+                offSpec += RTStrPrintf(&szSpec[offSpec], sizeof(szSpec) - offSpec, "%s%u",
+                                       iStar < 0 ? "-" : "", iStar < 0 ? -(uint32_t)iStar : (uint32_t)iStar);
+            }
+            else if (offSpec + 1 < sizeof(szSpec))
+                szSpec[offSpec++] = *pszIn;
+        }
+        szSpec[offSpec] = '\0';
+
+        uValue = bArg != RTTRACEBUF_BINARG_NONE ? pEntry->au64Args[iArg++] : 0;
+        switch (bArg)
+        {
+            case RTTRACEBUF_BINARG_NONE:
+                offDst += RTStrPrintf(&pszDst[offDst], cbDst - offDst, "%%");
+                break;
+            case RTTRACEBUF_BINARG_INT:
+                offDst += RTStrPrintf(&pszDst[offDst], cbDst - offDst, szSpec, (unsigned int)uValue);
+                break;
+            case RTTRACEBUF_BINARG_LONG:
+                offDst += RTStrPrintf(&pszDst[offDst], cbDst - offDst, szSpec, (unsigned long)uValue);
+                break;
+            case RTTRACEBUF_BINARG_U64:
+                offDst += RTStrPrintf(&pszDst[offDst], cbDst - offDst, szSpec, uValue);
+                break;
+            case RTTRACEBUF_BINARG_UPTR:
+                offDst += RTStrPrintf(&pszDst[offDst], cbDst - offDst, szSpec, (uintptr_t)uValue);
+                break;
+            case RTTRACEBUF_BINARG_STR:
+            {
+                const char *pszArg = NULL;
+                if (   uValue >= RT_OFFSETOF(RTTRACEBUFBINENTRY, au64Args) + cArgs * sizeof(uint64_t)
+                    && uValue < cbEntry
+                    && RTStrEnd((const char *)pEntry + uValue, cbEntry - (size_t)uValue))
+                    pszArg = (const char *)pEntry + uValue;
+                offDst += RTStrPrintf(&pszDst[offDst], cbDst - offDst, szSpec, pszArg);
+                break;
+            }
+        }
+    }
+    return pszDst;
+}
+
+#endif /* IN_RING3 */
+
+
+/**
+ * Gets the message text of an entry.
+ *
+ * @returns Pointer to the message text.
+ * @param   pThis       The trace buffer.
+ * @param   pEntry      The entry.
+ * @param   pszTmp      Buffer for decoding binary entries.
+ * @param   cbTmp       The size of the buffer.
+ */
+static const char *rtTraceBufEntryText(PCRTTRACEBUFINT pThis, PRTTRACEBUFENTRY pEntry, char *pszTmp, size_t cbTmp)
+{
+    if (!RTTRACEBUF_ENTRY_IS_BINARY(pEntry))
+        return pEntry->szMsg;
+#ifdef IN_RING3
+    return rtTraceBufBinDecode((PCRTTRACEBUFBINENTRY)pEntry, pThis->cbEntry,
+                               (const char *)(uintptr_t)((PCRTTRACEBUFBINENTRY)pEntry)->uFmt, pszTmp, cbTmp);
+#else
+    /* The format string may not be accessible in this context. */
+    RT_NOREF_PV(pThis);
+    RTStrPrintf(pszTmp, cbTmp, "<binary entry, format %#RX64>", ((PCRTTRACEBUFBINENTRY)pEntry)->uFmt);
+    return pszTmp;
+#endif
+}
+
+
 RTDECL(uint32_t) RTTraceBufRetain(RTTRACEBUF hTraceBuf)
 {
     PCRTTRACEBUFINT pThis = hTraceBuf;
@@ -516,6 +1056,32 @@ RTDECL(int) RTTraceBufAddMsgV(RTTRACEBUF hTraceBuf, const char *pszMsgFmt, va_li
 }
 
 
+RTDECL(int) RTTraceBufAddBinMsgF(RTTRACEBUF hTraceBuf, const char *pszMsgFmt, ...)
+{
+    int         rc;
+    va_list     va;
+    va_start(va, pszMsgFmt);
+    rc = RTTraceBufAddBinMsgV(hTraceBuf, pszMsgFmt, va);
+    va_end(va);
+    return rc;
+}
+
+
+RTDECL(int) RTTraceBufAddBinMsgV(RTTRACEBUF hTraceBuf, const char *pszMsgFmt, va_list va)
+{
+    RTTRACEBUF_ADD_PROLOGUE(hTraceBuf);
+#ifdef IN_RING3
+    va_list vaCopy;
+    va_copy(vaCopy, va);
+    bool fOk = rtTraceBufBinEncode((PRTTRACEBUFBINENTRY)pEntry, pThis->cbEntry, pszMsgFmt, vaCopy);
+    va_end(vaCopy);
+    if (!fOk)
+#endif
+        RTStrPrintfV(pszBuf, cchBuf, pszMsgFmt, va);
+    RTTRACEBUF_ADD_EPILOGUE();
+}
+
+
 RTDECL(int) RTTraceBufAddPos(RTTRACEBUF hTraceBuf, RT_SRC_POS_DECL)
 {
     RTTRACEBUF_ADD_PROLOGUE(hTraceBuf);
@@ -575,12 +1141,14 @@ RTDECL(int) RTTraceBufEnumEntries(RTTRACEBUF hTraceBuf, PFNRTTRACEBUFCALLBACK pf
     while (cLeft--)
     {
         PRTTRACEBUFENTRY pEntry;
+        char             szTmp[RTTRACEBUF_BIN_MAX_TEXT];
 
         iBase %= pThis->cEntries;
         pEntry = RTTRACEBUF_TO_ENTRY(pThis, iBase);
         if (pEntry->NanoTS)
         {
-            rc = pfnCallback((RTTRACEBUF)pThis, cLeft, pEntry->NanoTS, pEntry->idCpu, pEntry->szMsg, pvUser);
+            rc = pfnCallback((RTTRACEBUF)pThis, cLeft, RTTRACEBUF_ENTRY_NANOTS(pEntry), pEntry->idCpu,
+                             rtTraceBufEntryText(pThis, pEntry, szTmp, sizeof(szTmp)), pvUser);
             if (rc != VINF_SUCCESS)
                 break;
         }
@@ -648,7 +1216,11 @@ RTDECL(int) RTTraceBufDumpToLog(RTTRACEBUF hTraceBuf)
         iBase %= pThis->cEntries;
         pEntry = RTTRACEBUF_TO_ENTRY(pThis, iBase);
         if (pEntry->NanoTS)
-            RTLogPrintf("%04u/%'llu/%02x: %s\n", cLeft, pEntry->NanoTS, pEntry->idCpu, pEntry->szMsg);
+        {
+            char szTmp[RTTRACEBUF_BIN_MAX_TEXT];
+            RTLogPrintf("%04u/%'llu/%02x: %s\n", cLeft, RTTRACEBUF_ENTRY_NANOTS(pEntry), pEntry->idCpu,
+                        rtTraceBufEntryText(pThis, pEntry, szTmp, sizeof(szTmp)));
+        }
 
         /* next */
         iBase += 1;
@@ -675,7 +1247,11 @@ RTDECL(int) RTTraceBufDumpToAssert(RTTRACEBUF hTraceBuf)
         iBase %= pThis->cEntries;
         pEntry = RTTRACEBUF_TO_ENTRY(pThis, iBase);
         if (pEntry->NanoTS)
-            RTAssertMsg2AddWeak("%u/%'llu/%02x: %s\n", cLeft, pEntry->NanoTS, pEntry->idCpu, pEntry->szMsg);
+        {
+            char szTmp[RTTRACEBUF_BIN_MAX_TEXT];
+            RTAssertMsg2AddWeak("%u/%'llu/%02x: %s\n", cLeft, RTTRACEBUF_ENTRY_NANOTS(pEntry), pEntry->idCpu,
+                                rtTraceBufEntryText(pThis, pEntry, szTmp, sizeof(szTmp)));
+        }
 
         /* next */
         iBase += 1;
@@ -685,3 +1261,201 @@ RTDECL(int) RTTraceBufDumpToAssert(RTTRACEBUF hTraceBuf)
     return VINF_SUCCESS;
 }
 
+
+
+#ifdef IN_RING3
+
+RTR3DECL(int) RTTraceBufSaveToFile(RTTRACEBUF hTraceBuf, const char *pszFilename)
+{
+    /** Format string address to string table index hash entry. */
+    typedef struct RTTRACEBUFFMTHASH
+    {
+        uint64_t    uFmt;
+        uint32_t    idxFmt;
+    } RTTRACEBUFFMTHASH;
+    int                 rc;
+    uint32_t            iBase;
+    uint32_t            cLeft;
+    uint32_t            cHash;
+    RTTRACEBUFFMTHASH  *paHash;
+    const char        **papszFmts;
+    uint8_t            *pbTmp;
+    PCRTTRACEBUFINT     pThis;
+    AssertPtrReturn(pszFilename, VERR_INVALID_POINTER);
+    RTTRACEBUF_RESOLVE_VALIDATE_RETAIN_RETURN(hTraceBuf, pThis);
+
+    cHash = 16;
+    while (cHash < pThis->cEntries * 2)
+        cHash *= 2;
+    paHash    = (RTTRACEBUFFMTHASH *)RTMemTmpAllocZ(sizeof(paHash[0]) * cHash);
+    papszFmts = (const char **)RTMemTmpAlloc(sizeof(papszFmts[0]) * pThis->cEntries);
+    pbTmp     = (uint8_t *)RTMemTmpAlloc(pThis->cbEntry);
+    if (paHash && papszFmts && pbTmp)
+    {
+        RTFILE hFile;
+        rc = RTFileOpen(&hFile, pszFilename, RTFILE_O_WRITE | RTFILE_O_CREATE_REPLACE | RTFILE_O_DENY_WRITE);
+        if (RT_SUCCESS(rc))
+        {
+            RTTRACEBUFFILEHDR Hdr;
+            RT_ZERO(Hdr);
+            rc = RTFileWrite(hFile, &Hdr, sizeof(Hdr), NULL);
+
+            /*
+             * The entries, oldest first, with format string addresses
+             * replaced by string table indexes.
+             */
+            iBase = ASMAtomicReadU32(&RTTRACEBUF_TO_VOLATILE(pThis)->iEntry);
+            cLeft = pThis->cEntries;
+            while (cLeft-- && RT_SUCCESS(rc))
+            {
+                PRTTRACEBUFENTRY pEntry;
+
+                iBase %= pThis->cEntries;
+                pEntry = RTTRACEBUF_TO_ENTRY(pThis, iBase);
+                iBase += 1;
+                if (!pEntry->NanoTS)
+                    continue;
+
+                memcpy(pbTmp, pEntry, pThis->cbEntry);
+                if (RTTRACEBUF_ENTRY_IS_BINARY((PRTTRACEBUFENTRY)pbTmp))
+                {
+                    PRTTRACEBUFBINENTRY pBinEntry = (PRTTRACEBUFBINENTRY)pbTmp;
+                    uint32_t            iHash     = (uint32_t)(pBinEntry->uFmt ^ (pBinEntry->uFmt >> 17)) & (cHash - 1);
+                    while (   paHash[iHash].uFmt
+                           && paHash[iHash].uFmt != pBinEntry->uFmt)
+                        iHash = (iHash + 1) & (cHash - 1);
+                    if (!paHash[iHash].uFmt)
+                    {
+                        paHash[iHash].uFmt   = pBinEntry->uFmt;
+                        paHash[iHash].idxFmt = Hdr.cFmts;
+                        papszFmts[Hdr.cFmts++] = (const char *)(uintptr_t)pBinEntry->uFmt;
+                        Hdr.cbFmtTab += (uint32_t)strlen(papszFmts[paHash[iHash].idxFmt]) + 1;
+                    }
+                    pBinEntry->uFmt = paHash[iHash].idxFmt;
+                }
+                rc = RTFileWrite(hFile, pbTmp, pThis->cbEntry, NULL);
+                Hdr.cEntries++;
+            }
+
+            /*
+             * The format strings and the final header.
+             */
+            for (uint32_t i = 0; i < Hdr.cFmts && RT_SUCCESS(rc); i++)
+                rc = RTFileWrite(hFile, papszFmts[i], strlen(papszFmts[i]) + 1, NULL);
+            if (RT_SUCCESS(rc))
+            {
+                memcpy(Hdr.szMagic, RTTRACEBUFFILEHDR_MAGIC, sizeof(Hdr.szMagic));
+                Hdr.uVersion = RTTRACEBUFFILEHDR_VERSION;
+                Hdr.cbEntry  = pThis->cbEntry;
+                rc = RTFileWriteAt(hFile, 0, &Hdr, sizeof(Hdr), NULL);
+            }
+
+            int rc2 = RTFileClose(hFile);
+            if (RT_SUCCESS(rc))
+                rc = rc2;
+            if (RT_FAILURE(rc))
+                RTFileDelete(pszFilename);
+        }
+    }
+    else
+        rc = VERR_NO_TMP_MEMORY;
+    RTMemTmpFree(pbTmp);
+    RTMemTmpFree(papszFmts);
+    RTMemTmpFree(paHash);
+
+    RTTRACEBUF_DROP_REFERENCE(pThis);
+    return rc;
+}
+
+
+RTR3DECL(int) RTTraceBufDecodeFile(const char *pszFilename, PFNRTTRACEBUFCALLBACK pfnCallback, void *pvUser)
+{
+    void   *pvFile;
+    size_t  cbFile;
+    int     rc;
+    AssertPtrReturn(pszFilename, VERR_INVALID_POINTER);
+    AssertPtrReturn(pfnCallback, VERR_INVALID_POINTER);
+
+    rc = RTFileReadAll(pszFilename, &pvFile, &cbFile);
+    if (RT_FAILURE(rc))
+        return rc;
+
+    /*
+     * Validate the header and the string table.
+     */
+    RTTRACEBUFFILEHDR const *pHdr      = (RTTRACEBUFFILEHDR const *)pvFile;
+    const char             **papszFmts = NULL;
+    if (cbFile < sizeof(*pHdr))
+        rc = VERR_EOF;
+    else if (memcmp(pHdr->szMagic, RTTRACEBUFFILEHDR_MAGIC, sizeof(pHdr->szMagic)))
+        rc = VERR_INVALID_MAGIC;
+    else if (pHdr->uVersion != RTTRACEBUFFILEHDR_VERSION)
+        rc = VERR_VERSION_MISMATCH;
+    else if (   pHdr->cbEntry < sizeof(RTTRACEBUFENTRY)
+             || pHdr->cbEntry > RTTRACEBUF_MAX_ENTRY_SIZE
+             || (pHdr->cbEntry & (RTTRACEBUF_ALIGNMENT - 1))
+             || sizeof(*pHdr) + (uint64_t)pHdr->cEntries * pHdr->cbEntry + pHdr->cbFmtTab != cbFile
+             || pHdr->cFmts > pHdr->cbFmtTab
+             || (pHdr->cbFmtTab && ((const char *)pvFile)[cbFile - 1] != '\0'))
+        rc = VERR_OUT_OF_RANGE;
+    else if (pHdr->cFmts)
+    {
+        papszFmts = (const char **)RTMemTmpAlloc(sizeof(papszFmts[0]) * pHdr->cFmts);
+        if (papszFmts)
+        {
+            const char *psz    = (const char *)pvFile + cbFile - pHdr->cbFmtTab;
+            const char *pszEnd = (const char *)pvFile + cbFile;
+            for (uint32_t i = 0; i < pHdr->cFmts; i++)
+            {
+                if (psz >= pszEnd)
+                {
+                    rc = VERR_OUT_OF_RANGE;
+                    break;
+                }
+                papszFmts[i] = psz;
+                psz = RTStrEnd(psz, pszEnd - psz) + 1;
+            }
+        }
+        else
+            rc = VERR_NO_TMP_MEMORY;
+    }
+
+    /*
+     * Decode the entries.
+     */
+    if (RT_SUCCESS(rc))
+    {
+        const uint8_t *pbEntry = (const uint8_t *)(pHdr + 1);
+        uint32_t       cLeft   = pHdr->cEntries;
+        while (cLeft--)
+        {
+            PRTTRACEBUFENTRY pEntry = (PRTTRACEBUFENTRY)pbEntry;
+            char             szTmp[RTTRACEBUF_BIN_MAX_TEXT];
+            const char      *pszMsg;
+            if (RTTRACEBUF_ENTRY_IS_BINARY(pEntry))
+            {
+                PCRTTRACEBUFBINENTRY pBinEntry = (PCRTTRACEBUFBINENTRY)pEntry;
+                if (pBinEntry->uFmt < pHdr->cFmts)
+                    pszMsg = rtTraceBufBinDecode(pBinEntry, pHdr->cbEntry, papszFmts[pBinEntry->uFmt], szTmp, sizeof(szTmp));
+                else
+                    pszMsg = "<bad format index>";
+            }
+            else
+            {
+                RTStrCopyEx(szTmp, sizeof(szTmp), pEntry->szMsg, pHdr->cbEntry - RT_OFFSETOF(RTTRACEBUFENTRY, szMsg));
+                pszMsg = szTmp;
+            }
+
+            rc = pfnCallback(NIL_RTTRACEBUF, cLeft, RTTRACEBUF_ENTRY_NANOTS(pEntry), pEntry->idCpu, pszMsg, pvUser);
+            if (rc != VINF_SUCCESS)
+                break;
+            pbEntry += pHdr->cbEntry;
+        }
+    }
+
+    RTMemTmpFree(papszFmts);
+    RTFileReadAllFree(pvFile, cbFile);
+    return rc;
+}
+
+#endif /* IN_RING3 */
@@ -37,6 +37,7 @@
 #include <iprt/list.h>
 #include <iprt/log.h>
 #include <iprt/mem.h>
+#include <iprt/once.h>
 #include <iprt/string.h>
 #include <iprt/time.h>
 #include <iprt/semaphore.h>
@@ -56,10 +57,38 @@
 /** The max number of free requests to keep around. */
 #define RTREQPOOL_MAX_FREE_REQUESTS     (RTREQPOOL_MAX_THREADS * 2U)
 
+/** The max number of worker threads in work-stealing mode. */
+#define RTREQPOOL_WS_MAX_THREADS        UINT32_C(256)
+/** The capacity of each worker's request deque (power of two). */
+#define RTREQPOOL_WS_DEQUE_SIZE         UINT32_C(256)
+/** How many times an out of work worker scans the other workers for
+ * something to steal before parking. */
+#define RTREQPOOL_WS_STEAL_ROUNDS       2
+
 
 /*********************************************************************************************************************************
 *   Structures and Typedefs                                                                                                      *
 *********************************************************************************************************************************/
+/**
+ * Chase-Lev work-stealing deque.
+ *
+ * The owner pushes and pops at the bottom end, other workers steal from the
+ * top end.  The indexes only ever grow, the slot is the index modulo the size.
+ */
+typedef struct RTREQPOOLWSDEQUE
+{
+    /** The steal end, advanced by thieves and by the owner taking the last
+     * request. */
+    int64_t volatile        iTop;
+    /** The owner end. */
+    int64_t volatile        iBottom;
+    /** The request slots. */
+    PRTREQINT volatile      apReqs[RTREQPOOL_WS_DEQUE_SIZE];
+} RTREQPOOLWSDEQUE;
+/** Pointer to a work-stealing deque. */
+typedef RTREQPOOLWSDEQUE *PRTREQPOOLWSDEQUE;
+
+
 typedef struct RTREQPOOLTHREAD
 {
     /** Node in the  RTREQPOOLINT::IdleThreads list. */
@@ -96,6 +125,21 @@ typedef struct RTREQPOOLTHREAD
     /** Pointer to the request thread pool instance the thread is associated
      *  with. */
     struct RTREQPOOLINT    *pPool;
+
+    /** @name Work-stealing mode
+     * @{ */
+    /** Set when the thread has exited and the structure can be reused. */
+    bool volatile           fWsRetired;
+    /** The index into RTREQPOOLINT::papWsThreads. */
+    uint32_t                iWsSlot;
+    /** Victim selection state (xorshift). */
+    uint32_t                uWsRandom;
+    /** The number of requests this thread stole from others. */
+    uint64_t                cWsReqStolen;
+    /** The request deque, must be the last member (see
+     *  rtReqPoolWsAllocThread). */
+    RTREQPOOLWSDEQUE        WsDeque;
+    /** @} */
 } RTREQPOOLTHREAD;
 /** Pointer to a worker thread. */
 typedef RTREQPOOLTHREAD *PRTREQPOOLTHREAD;
@@ -177,25 +221,55 @@ typedef struct RTREQPOOLINT
     PRTREQINT               pPendingRequests;
     /** Where to insert the next request. */
     PRTREQINT              *ppPendingRequests;
-    /** The number of requests currently pending. */
-    uint32_t                cCurPendingRequests;
+    /** The number of requests currently pending.  Only atomically updated in
+     * work-stealing mode. */
+    uint32_t volatile       cCurPendingRequests;
     /** The number of requests currently being executed. */
     uint32_t volatile       cCurActiveRequests;
     /** The number of requests submitted. */
     uint64_t                cReqSubmitted;
 
-    /** Head of the request recycling LIFO. */
-    PRTREQINT               pFreeRequests;
+    /** Head of the request recycling LIFO.  This is lock-free in work-stealing
+     * mode. */
+    PRTREQINT volatile      pFreeRequests;
     /** The number of requests in the recycling LIFO.  This is read without
      * entering the critical section, thus volatile. */
     uint32_t volatile       cCurFreeRequests;
 
+    /** @name Work-stealing mode
+     * @{ */
+    /** Whether the work-stealing scheduler is used.  Parked workers go on the
+     * IdleThreads list like in the normal mode. */
+    bool                    fWorkStealing;
+    /** Number of used entries in papWsThreads (high water mark). */
+    uint32_t volatile       cWsSlotsUsed;
+    /** The workers, indexed by RTREQPOOLTHREAD::iWsSlot (RTREQPOOL_WS_MAX_THREADS
+     * entries).  The structures are reused but not freed till destruction, so
+     * thieves can access them without locking. */
+    PRTREQPOOLTHREAD volatile *papWsThreads;
+    /** LIFO of requests submitted by non-workers, pushed atomically and taken
+     * as a whole by a worker. */
+    PRTREQINT volatile      pWsInjected;
+    /** Statistics: The number of requests stolen by workers that have gone
+     * idle at some point. */
+    uint64_t                cWsReqStolen;
+    /** @} */
+
     /** Critical section serializing access to members of this structure.  */
     RTCRITSECT              CritSect;
 
 } RTREQPOOLINT;
 
 
+/*********************************************************************************************************************************
+*   Global Variables                                                                                                             *
+*********************************************************************************************************************************/
+/** Makes sure g_iRtReqPoolWsTls is allocated. */
+static RTONCE   g_rtReqPoolWsOnce = RTONCE_INITIALIZER;
+/** TLS entry pointing to the RTREQPOOLTHREAD of a work-stealing worker. */
+static RTTLS    g_iRtReqPoolWsTls = NIL_RTTLS;
+
+
 /**
  * Used by exiting thread and the pool destruction code to cancel unexpected
  * requests.
@@ -224,10 +298,13 @@ static void rtReqPoolRecalcPushBack(PRTREQPOOLINT pPool)
 {
     uint32_t const cMsRange = pPool->cMsMaxPushBack - pPool->cMsMinPushBack;
     uint32_t const cSteps   = pPool->cMaxThreads - pPool->cThreadsPushBackThreshold;
-    uint32_t const iStep    = pPool->cCurThreads - pPool->cThreadsPushBackThreshold;
+    uint32_t const iStep    = pPool->cCurThreads > pPool->cThreadsPushBackThreshold
+                            ? pPool->cCurThreads - pPool->cThreadsPushBackThreshold : 0;
 
     uint32_t cMsCurPushBack;
-    if ((cMsRange >> 2) >= cSteps)
+    if (cSteps == 0)
+        cMsCurPushBack = 0;
+    else if ((cMsRange >> 2) >= cSteps)
         cMsCurPushBack = cMsRange / cSteps * iStep;
     else
         cMsCurPushBack = (uint32_t)( (uint64_t)cMsRange * RT_NS_1MS  / cSteps * iStep / RT_NS_1MS );
@@ -275,6 +352,11 @@ static int rtReqPoolThreadExit(PRTREQPOOLINT pPool, PRTREQPOOLTHREAD pThread, bo
         rtReqPoolCancelReq(pReq);
     }
 
+    /* In work-stealing mode the structure stays in its slot for reuse by a
+       future worker, thieves may still be peeking at the (empty) deque. */
+    if (pPool->fWorkStealing)
+        ASMAtomicWriteBool(&pThread->fWsRetired, true);
+
     /* If we're the last thread terminating, ping the destruction thread before
        we leave the critical section. */
     if (   RTListIsEmpty(&pPool->WorkerThreads)
@@ -324,6 +406,372 @@ static void rtReqPoolThreadProcessRequest(PRTREQPOOLINT pPool, PRTREQPOOLTHREAD
 
 
 
+/**
+ * Pushes a request onto the bottom of a worker's deque.
+ *
+ * @returns true if pushed, false if the deque is full.
+ * @param   pDeque              The deque.  Only called by the owner.
+ * @param   pReq                The request.
+ */
+DECLINLINE(bool) rtReqPoolWsDequePush(PRTREQPOOLWSDEQUE pDeque, PRTREQINT pReq)
+{
+    int64_t const iBottom = ASMAtomicUoReadS64(&pDeque->iBottom);
+    int64_t const iTop    = ASMAtomicReadS64(&pDeque->iTop);
+    if (iBottom - iTop >= (int64_t)RTREQPOOL_WS_DEQUE_SIZE)
+        return false;
+    ASMAtomicWritePtr(&pDeque->apReqs[iBottom & (RTREQPOOL_WS_DEQUE_SIZE - 1)], pReq);
+    ASMAtomicWriteS64(&pDeque->iBottom, iBottom + 1);
+    return true;
+}
+
+
+/**
+ * Pops the most recently pushed request off the bottom of a worker's deque.
+ *
+ * @returns The request, NULL if empty.
+ * @param   pDeque              The deque.  Only called by the owner.
+ */
+DECLINLINE(PRTREQINT) rtReqPoolWsDequePop(PRTREQPOOLWSDEQUE pDeque)
+{
+    /* Only the owner adds requests, so this quick check can be trusted. */
+    int64_t iBottom = ASMAtomicUoReadS64(&pDeque->iBottom);
+    if (iBottom <= ASMAtomicReadS64(&pDeque->iTop))
+        return NULL;
+
+    /* Reserve the bottom entry before looking at the top (the write is a full
+       barrier), so a thief either sees the reservation or we see its claim. */
+    iBottom--;
+    ASMAtomicWriteS64(&pDeque->iBottom, iBottom);
+    int64_t const iTop = ASMAtomicReadS64(&pDeque->iTop);
+    if (iTop > iBottom)
+    {
+        ASMAtomicWriteS64(&pDeque->iBottom, iBottom + 1);
+        return NULL;
+    }
+
+    PRTREQINT pReq = ASMAtomicReadPtrT(&pDeque->apReqs[iBottom & (RTREQPOOL_WS_DEQUE_SIZE - 1)], PRTREQINT);
+    if (iTop == iBottom)
+    {
+        /* The last one, race the thieves for it. */
+        if (!ASMAtomicCmpXchgS64(&pDeque->iTop, iTop + 1, iTop))
+            pReq = NULL;
+        ASMAtomicWriteS64(&pDeque->iBottom, iBottom + 1);
+    }
+    return pReq;
+}
+
+
+/**
+ * Steals the oldest request from the top of another worker's deque.
+ *
+ * @returns The request, NULL if empty or if we lost a race for it.
+ * @param   pDeque              The victim's deque.
+ */
+DECLINLINE(PRTREQINT) rtReqPoolWsDequeSteal(PRTREQPOOLWSDEQUE pDeque)
+{
+    int64_t const iTop    = ASMAtomicReadS64(&pDeque->iTop);
+    int64_t const iBottom = ASMAtomicReadS64(&pDeque->iBottom);
+    if (iTop >= iBottom)
+        return NULL;
+    PRTREQINT pReq = ASMAtomicReadPtrT(&pDeque->apReqs[iTop & (RTREQPOOL_WS_DEQUE_SIZE - 1)], PRTREQINT);
+    if (!ASMAtomicCmpXchgS64(&pDeque->iTop, iTop + 1, iTop))
+        return NULL;
+    return pReq;
+}
+
+
+/**
+ * Checks whether a deque looks non-empty.
+ *
+ * @returns true if there might be something to steal.
+ * @param   pDeque              The deque.
+ */
+DECLINLINE(bool) rtReqPoolWsDequeHasWork(PRTREQPOOLWSDEQUE pDeque)
+{
+    return ASMAtomicReadS64(&pDeque->iTop) < ASMAtomicReadS64(&pDeque->iBottom);
+}
+
+
+/**
+ * Pushes a chain of requests onto a lock-free LIFO.
+ *
+ * Only pushing individual entries and taking the whole list are done on these,
+ * so there are no ABA issues.
+ *
+ * @param   ppHead              The list head.
+ * @param   pFirst              The first request in the chain.
+ * @param   pLast               The last request in the chain.
+ */
+static void rtReqPoolWsPushChain(PRTREQINT volatile *ppHead, PRTREQINT pFirst, PRTREQINT pLast)
+{
+    PRTREQINT pHead;
+    do
+    {
+        pHead = ASMAtomicReadPtrT(ppHead, PRTREQINT);
+        ASMAtomicWritePtr(&pLast->pNext, pHead);
+    } while (!ASMAtomicCmpXchgPtr(ppHead, pFirst, pHead));
+}
+
+
+/**
+ * Takes a request off the lock-free recycling LIFO.
+ *
+ * @returns The request, NULL if none.
+ * @param   pPool               The pool.
+ */
+static PRTREQINT rtReqPoolWsFreePop(PRTREQPOOLINT pPool)
+{
+    PRTREQINT pReq = ASMAtomicXchgPtrT(&pPool->pFreeRequests, NULL, PRTREQINT);
+    if (!pReq)
+        return NULL;
+    ASMAtomicDecU32(&pPool->cCurFreeRequests);
+
+    /* Put back the rest.  Normally nobody has recycled anything meanwhile. */
+    PRTREQINT pRest = pReq->pNext;
+    if (   pRest
+        && !ASMAtomicCmpXchgPtr(&pPool->pFreeRequests, pRest, NULL))
+    {
+        PRTREQINT pLast = pRest;
+        while (pLast->pNext)
+            pLast = pLast->pNext;
+        rtReqPoolWsPushChain(&pPool->pFreeRequests, pRest, pLast);
+    }
+    return pReq;
+}
+
+
+/**
+ * Wakes up the most recently parked worker, if there is any.
+ *
+ * The critical section is only entered when there are parked workers, so busy
+ * pools don't touch it.
+ *
+ * @returns true if a parked worker was signalled, false if there is none.
+ * @param   pPool               The pool.
+ */
+static bool rtReqPoolWsWakeOne(PRTREQPOOLINT pPool)
+{
+    if (!ASMAtomicReadU32(&pPool->cIdleThreads))
+        return false;
+
+    RTCritSectEnter(&pPool->CritSect);
+    PRTREQPOOLTHREAD pThread = RTListGetFirst(&pPool->IdleThreads, RTREQPOOLTHREAD, IdleNode);
+    if (pThread)
+    {
+        RTListNodeRemove(&pThread->IdleNode);
+        RTListInit(&pThread->IdleNode);
+        ASMAtomicDecU32(&pPool->cIdleThreads);
+        RTThreadUserSignal(pThread->hThread);
+    }
+    RTCritSectLeave(&pPool->CritSect);
+    return pThread != NULL;
+}
+
+
+/**
+ * Checks if there is anything for a parking worker to do.
+ *
+ * @returns true if there might be work, false if not.
+ * @param   pPool               The pool.
+ */
+static bool rtReqPoolWsHasWork(PRTREQPOOLINT pPool)
+{
+    if (ASMAtomicReadPtrT(&pPool->pWsInjected, PRTREQINT))
+        return true;
+    uint32_t const cSlots = ASMAtomicReadU32(&pPool->cWsSlotsUsed);
+    for (uint32_t i = 0; i < cSlots; i++)
+    {
+        PRTREQPOOLTHREAD pOther = ASMAtomicReadPtrT(&pPool->papWsThreads[i], PRTREQPOOLTHREAD);
+        if (pOther && rtReqPoolWsDequeHasWork(&pOther->WsDeque))
+            return true;
+    }
+    return false;
+}
+
+
+/**
+ * Takes all the requests submitted from outside the pool.
+ *
+ * The oldest one is returned, the others go onto the worker's deque so that it
+ * continues in submission order while thieves get the newest ones.
+ *
+ * @returns The oldest request, NULL if there weren't any.
+ * @param   pPool               The pool.
+ * @param   pThread             The calling worker.
+ */
+static PRTREQINT rtReqPoolWsTakeInjected(PRTREQPOOLINT pPool, PRTREQPOOLTHREAD pThread)
+{
+    if (!ASMAtomicUoReadPtrT(&pPool->pWsInjected, PRTREQINT))
+        return NULL;
+    PRTREQINT pReq = ASMAtomicXchgPtrT(&pPool->pWsInjected, NULL, PRTREQINT);
+    if (!pReq)
+        return NULL;
+
+    /* The list is newest first. */
+    bool fPushed = false;
+    while (pReq->pNext)
+    {
+        PRTREQINT pNext = pReq->pNext;
+        if (rtReqPoolWsDequePush(&pThread->WsDeque, pReq))
+            fPushed = true;
+        else
+            rtReqPoolWsPushChain(&pPool->pWsInjected, pReq, pReq);
+        pReq = pNext;
+    }
+    if (fPushed)
+        rtReqPoolWsWakeOne(pPool);
+    return pReq;
+}
+
+
+/**
+ * Tries to steal a request from a randomly picked worker.
+ *
+ * @returns The stolen request, NULL if nothing was found.
+ * @param   pPool               The pool.
+ * @param   pThread             The calling worker.
+ */
+static PRTREQINT rtReqPoolWsSteal(PRTREQPOOLINT pPool, PRTREQPOOLTHREAD pThread)
+{
+    uint32_t const cSlots = ASMAtomicReadU32(&pPool->cWsSlotsUsed);
+    if (cSlots <= 1)
+        return NULL;
+
+    for (unsigned iRound = 0; iRound < RTREQPOOL_WS_STEAL_ROUNDS; iRound++)
+    {
+        uint32_t uRandom = pThread->uWsRandom;
+        uRandom ^= uRandom << 13;
+        uRandom ^= uRandom >> 17;
+        uRandom ^= uRandom << 5;
+        pThread->uWsRandom = uRandom;
+
+        uint32_t iVictim = uRandom % cSlots;
+        for (uint32_t i = 0; i < cSlots; i++, iVictim = iVictim + 1 < cSlots ? iVictim + 1 : 0)
+        {
+            PRTREQPOOLTHREAD pVictim = ASMAtomicReadPtrT(&pPool->papWsThreads[iVictim], PRTREQPOOLTHREAD);
+            if (pVictim && pVictim != pThread)
+            {
+                PRTREQINT pReq = rtReqPoolWsDequeSteal(&pVictim->WsDeque);
+                if (pReq)
+                {
+                    pThread->cWsReqStolen++;
+                    if (rtReqPoolWsDequeHasWork(&pVictim->WsDeque))
+                        rtReqPoolWsWakeOne(pPool);
+                    return pReq;
+                }
+            }
+        }
+    }
+    return NULL;
+}
+
+
+/**
+ * The work loop of a worker thread in work-stealing mode.
+ *
+ * @returns VINF_SUCCESS.
+ * @param   hThreadSelf         The thread handle.
+ * @param   pPool               The pool.
+ * @param   pThread             The worker thread.
+ */
+static int rtReqPoolWsThreadLoop(RTTHREAD hThreadSelf, PRTREQPOOLINT pPool, PRTREQPOOLTHREAD pThread)
+{
+    RTTlsSet(g_iRtReqPoolWsTls, pThread);
+
+    uint64_t cReqPrevProcessedIdle     = UINT64_MAX;
+    uint64_t cReqPrevProcessedStat     = 0;
+    uint64_t cNsPrevTotalReqProcessing = 0;
+    uint64_t cNsPrevTotalReqQueued     = 0;
+    uint64_t cPrevReqStolen            = 0;
+    while (!pPool->fDestructing)
+    {
+        /*
+         * Our own requests first (newest first), then those submitted from
+         * outside the pool, then whatever the other workers have queued up.
+         */
+        PRTREQINT pReq = rtReqPoolWsDequePop(&pThread->WsDeque);
+        if (!pReq)
+        {
+            pReq = rtReqPoolWsTakeInjected(pPool, pThread);
+            if (!pReq)
+                pReq = rtReqPoolWsSteal(pPool, pThread);
+        }
+        if (pReq)
+        {
+            ASMAtomicDecU32(&pPool->cCurPendingRequests);
+            if (ASMAtomicXchgBool(&pReq->fSignalPushBack, true))
+                RTSemEventMultiSignal(pReq->hPushBackEvt); /* see rtReqPoolWsPushBack */
+            rtReqPoolThreadProcessRequest(pPool, pThread, pReq);
+            continue;
+        }
+
+        /*
+         * Nothing to do, park.
+         */
+        RTCritSectEnter(&pPool->CritSect);
+
+        /* Update the global statistics. */
+        if (cReqPrevProcessedStat != pThread->cReqProcessed)
+        {
+            pPool->cReqProcessed         += pThread->cReqProcessed         - cReqPrevProcessedStat;
+            cReqPrevProcessedStat         = pThread->cReqProcessed;
+            pPool->cNsTotalReqProcessing += pThread->cNsTotalReqProcessing - cNsPrevTotalReqProcessing;
+            cNsPrevTotalReqProcessing     = pThread->cNsTotalReqProcessing;
+            pPool->cNsTotalReqQueued     += pThread->cNsTotalReqQueued     - cNsPrevTotalReqQueued;
+            cNsPrevTotalReqQueued         = pThread->cNsTotalReqQueued;
+            pPool->cWsReqStolen          += pThread->cWsReqStolen          - cPrevReqStolen;
+            cPrevReqStolen                = pThread->cWsReqStolen;
+        }
+
+        /* Retire if we've been idle long enough.  One worker always stays, as
+           a submitter racing us may have concluded that no new one is needed. */
+        if (cReqPrevProcessedIdle != pThread->cReqProcessed)
+        {
+            cReqPrevProcessedIdle = pThread->cReqProcessed;
+            pThread->uIdleNanoTs  = RTTimeNanoTS();
+        }
+        else if (pPool->cCurThreads > RT_MAX(pPool->cMinThreads, 1))
+        {
+            uint64_t cNsIdle = RTTimeNanoTS() - pThread->uIdleNanoTs;
+            if (cNsIdle >= pPool->cNsMinIdle)
+            {
+                RTTlsSet(g_iRtReqPoolWsTls, NULL);
+                return rtReqPoolThreadExit(pPool, pThread, true /*fLocked*/);
+            }
+        }
+
+        Assert(RTListIsEmpty(&pThread->IdleNode));
+        RTListPrepend(&pPool->IdleThreads, &pThread->IdleNode);
+        ASMAtomicIncU32(&pPool->cIdleThreads);
+        RTThreadUserReset(hThreadSelf);
+        RTMSINTERVAL const cMsSleep = pPool->cMsIdleSleep;
+
+        RTCritSectLeave(&pPool->CritSect);
+
+        /* Now that submitters can see us, check for work one final time. */
+        if (!rtReqPoolWsHasWork(pPool))
+            RTThreadUserWait(hThreadSelf, cMsSleep);
+
+        /* Get off the idle list unless the waker took us off it already. */
+        if (!RTListIsEmpty(&pThread->IdleNode))
+        {
+            RTCritSectEnter(&pPool->CritSect);
+            if (!RTListIsEmpty(&pThread->IdleNode))
+            {
+                RTListNodeRemove(&pThread->IdleNode);
+                RTListInit(&pThread->IdleNode);
+                ASMAtomicDecU32(&pPool->cIdleThreads);
+            }
+            RTCritSectLeave(&pPool->CritSect);
+        }
+    }
+
+    RTTlsSet(g_iRtReqPoolWsTls, NULL);
+    return rtReqPoolThreadExit(pPool, pThread, false /*fLocked*/);
+}
+
+
+
 /**
  * The Worker Thread Procedure.
  *
@@ -335,6 +783,8 @@ static DECLCALLBACK(int) rtReqPoolThreadProc(RTTHREAD hThreadSelf, void *pvArg)
 {
     PRTREQPOOLTHREAD    pThread = (PRTREQPOOLTHREAD)pvArg;
     PRTREQPOOLINT       pPool   = pThread->pPool;
+    if (pPool->fWorkStealing)
+        return rtReqPoolWsThreadLoop(hThreadSelf, pPool, pThread);
 
     /*
      * The work loop.
@@ -438,6 +888,45 @@ static DECLCALLBACK(int) rtReqPoolThreadProc(RTTHREAD hThreadSelf, void *pvArg)
 }
 
 
+/**
+ * Gets a worker thread structure in work-stealing mode, reusing the one of a
+ * retired worker if possible.
+ *
+ * @returns Pointer to the zeroed thread structure, NULL if all slots are in use.
+ * @param   pPool               The pool.
+ * @remarks Caller owns the critical section
+ */
+static PRTREQPOOLTHREAD rtReqPoolWsAllocThread(PRTREQPOOLINT pPool)
+{
+    uint32_t const cSlots = pPool->cWsSlotsUsed;
+    for (uint32_t i = 0; i < cSlots; i++)
+    {
+        PRTREQPOOLTHREAD pThread = pPool->papWsThreads[i];
+        if (pThread->fWsRetired)
+        {
+            /* Keep the deque as is, thieves may still be looking at it. */
+            Assert(!rtReqPoolWsDequeHasWork(&pThread->WsDeque));
+            RT_BZERO(pThread, RT_OFFSETOF(RTREQPOOLTHREAD, WsDeque));
+            pThread->iWsSlot   = i;
+            pThread->uWsRandom = ((uint32_t)RTTimeNanoTS() ^ (i * UINT32_C(0x9e3779b9))) | 1;
+            return pThread;
+        }
+    }
+
+    if (cSlots >= RTREQPOOL_WS_MAX_THREADS)
+        return NULL;
+    PRTREQPOOLTHREAD pThread = (PRTREQPOOLTHREAD)RTMemAllocZ(sizeof(RTREQPOOLTHREAD));
+    if (pThread)
+    {
+        pThread->iWsSlot   = cSlots;
+        pThread->uWsRandom = ((uint32_t)RTTimeNanoTS() ^ (cSlots * UINT32_C(0x9e3779b9))) | 1;
+        ASMAtomicWritePtr(&pPool->papWsThreads[cSlots], pThread);
+        ASMAtomicWriteU32(&pPool->cWsSlotsUsed, cSlots + 1);
+    }
+    return pThread;
+}
+
+
 /**
  * Create a new worker thread.
  *
@@ -446,7 +935,9 @@ static DECLCALLBACK(int) rtReqPoolThreadProc(RTTHREAD hThreadSelf, void *pvArg)
  */
 static void rtReqPoolCreateNewWorker(RTREQPOOL pPool)
 {
-    PRTREQPOOLTHREAD pThread = (PRTREQPOOLTHREAD)RTMemAllocZ(sizeof(RTREQPOOLTHREAD));
+    PRTREQPOOLTHREAD pThread = !pPool->fWorkStealing
+                             ? (PRTREQPOOLTHREAD)RTMemAllocZ(sizeof(RTREQPOOLTHREAD))
+                             : rtReqPoolWsAllocThread(pPool);
     if (!pThread)
         return;
 
@@ -467,7 +958,10 @@ static void rtReqPoolCreateNewWorker(RTREQPOOL pPool)
     {
         pPool->cCurThreads--;
         RTListNodeRemove(&pThread->ListNode);
-        RTMemFree(pThread);
+        if (!pPool->fWorkStealing)
+            RTMemFree(pThread);
+        else
+            ASMAtomicWriteBool(&pThread->fWsRetired, true);
     }
 }
 
@@ -521,9 +1015,145 @@ static int rtReqPoolPushBack(PRTREQPOOLINT pPool, PRTREQINT pReq)
 }
 
 
+/**
+ * Creates a new worker thread in work-stealing mode unless there are enough
+ * already or the creation rate is being throttled.
+ *
+ * New workers are created at most every RTREQPOOLINT::cMsCurPushBack
+ * milliseconds once the push back threshold has been reached.
+ *
+ * @returns The number of nanoseconds till the next worker may be created if
+ *          throttled, 0 if a worker was created or none can be.
+ * @param   pPool               The pool.
+ */
+static uint64_t rtReqPoolWsMaybeCreateWorker(PRTREQPOOLINT pPool)
+{
+    /* Unlocked check first to keep submitters off the lock when throttled. */
+    uint64_t cNsThrottle = pPool->cMsCurPushBack * RT_NS_1MS_64;
+    uint64_t cNsElapsed  = RTTimeNanoTS() - pPool->uLastThreadCreateNanoTs;
+    if (   pPool->cCurThreads >= pPool->cThreadsPushBackThreshold
+        && cNsElapsed < cNsThrottle)
+        return cNsThrottle - cNsElapsed;
+
+    uint64_t cNsLeft = 0;
+    RTCritSectEnter(&pPool->CritSect);
+    if (   !pPool->fDestructing
+        && pPool->cCurThreads < RT_MIN(pPool->cMaxThreads, RTREQPOOL_WS_MAX_THREADS))
+    {
+        cNsThrottle = pPool->cMsCurPushBack * RT_NS_1MS_64;
+        cNsElapsed  = RTTimeNanoTS() - pPool->uLastThreadCreateNanoTs;
+        if (   pPool->cCurThreads < pPool->cThreadsPushBackThreshold
+            || cNsElapsed >= cNsThrottle)
+        {
+            rtReqPoolCreateNewWorker(pPool);
+            if (pPool->cCurThreads > pPool->cThreadsPushBackThreshold)
+                rtReqPoolRecalcPushBack(pPool);
+        }
+        else
+            cNsLeft = cNsThrottle - cNsElapsed;
+    }
+    RTCritSectLeave(&pPool->CritSect);
+    return cNsLeft;
+}
+
+
+/**
+ * Repels the submitter while worker creation is being throttled in
+ * work-stealing mode, creating a new worker once the throttling period is over
+ * unless a worker has picked up the request by then.
+ *
+ * Nobody else would create the worker otherwise, leaving the request stranded
+ * when all workers are busy or blocked (e.g. in a nested RTReqPoolCallWait).
+ *
+ * RTREQ::fSignalPushBack is cleared on submission.  Whoever of the submitter
+ * (arming the push back) and the worker (picking up the request) sets it
+ * second knows the other has been there: the submitter that the request has
+ * been picked up already, the worker that it has to signal the submitter.
+ *
+ * @param   pPool               The pool.
+ * @param   pReq                The submitted request.  The caller holds a
+ *                              reference.
+ * @param   cNsLeft             The nanoseconds till the next worker may be
+ *                              created.
+ */
+static void rtReqPoolWsPushBack(PRTREQPOOLINT pPool, PRTREQINT pReq, uint64_t cNsLeft)
+{
+    bool fArmed = false;
+    do
+    {
+        RTMSINTERVAL const cMsWait = (RTMSINTERVAL)((cNsLeft + RT_NS_1MS - 1) / RT_NS_1MS);
+        if (!fArmed)
+        {
+            /* Lazily create the push back semaphore, it is kept when the request is recycled. */
+            if (pReq->hPushBackEvt == NIL_RTSEMEVENTMULTI)
+            {
+                RTSEMEVENTMULTI hEvt;
+                int rc = RTSemEventMultiCreate(&hEvt);
+                if (RT_FAILURE(rc))
+                {
+                    RTThreadSleep(cMsWait);
+                    continue;
+                }
+                pReq->hPushBackEvt = hEvt;
+            }
+            RTSemEventMultiReset(pReq->hPushBackEvt);
+            if (ASMAtomicXchgBool(&pReq->fSignalPushBack, true))
+                break; /* Picked up already. */
+            fArmed = true;
+        }
+        if (RTSemEventMultiWait(pReq->hPushBackEvt, cMsWait) == VINF_SUCCESS)
+            break;
+    } while ((cNsLeft = rtReqPoolWsMaybeCreateWorker(pPool)) != 0);
+}
+
+
+/**
+ * Submits a request in work-stealing mode.
+ *
+ * Requests submitted by a worker of the pool go onto its own deque, others are
+ * put on the injection list.  Neither involves the pool critical section.
+ *
+ * @param   pPool               The pool.
+ * @param   pReq                The request.
+ */
+static void rtReqPoolWsSubmit(PRTREQPOOLINT pPool, PRTREQINT pReq)
+{
+    ASMAtomicIncU64(&pPool->cReqSubmitted);
+    ASMAtomicIncU32(&pPool->cCurPendingRequests);
+
+    /* The request may be completed and freed as soon as it's visible to the
+       workers, so keep a reference in case we have to push back. */
+    pReq->fSignalPushBack = false;
+    RTReqRetain(pReq);
+
+    PRTREQPOOLTHREAD pSelf = (PRTREQPOOLTHREAD)RTTlsGet(g_iRtReqPoolWsTls);
+    if (   !pSelf
+        || pSelf->pPool != pPool
+        || !rtReqPoolWsDequePush(&pSelf->WsDeque, pReq))
+        rtReqPoolWsPushChain(&pPool->pWsInjected, pReq, pReq);
+
+    /* Wake up a parked worker, or get a new one if everyone is busy,
+       waiting for the throttling period to pass if necessary. */
+    if (   !rtReqPoolWsWakeOne(pPool)
+        && pPool->cCurThreads < RT_MIN(pPool->cMaxThreads, RTREQPOOL_WS_MAX_THREADS))
+    {
+        uint64_t cNsLeft = rtReqPoolWsMaybeCreateWorker(pPool);
+        if (cNsLeft)
+            rtReqPoolWsPushBack(pPool, pReq, cNsLeft);
+    }
+    RTReqRelease(pReq);
+}
+
+
 
 DECLHIDDEN(void) rtReqPoolSubmit(PRTREQPOOLINT pPool, PRTREQINT pReq)
 {
+    if (pPool->fWorkStealing)
+    {
+        rtReqPoolWsSubmit(pPool, pReq);
+        return;
+    }
+
     RTCritSectEnter(&pPool->CritSect);
 
     pPool->cReqSubmitted++;
@@ -599,7 +1229,17 @@ DECLHIDDEN(void) rtReqPoolSubmit(PRTREQPOOLINT pPool, PRTREQINT pReq)
 DECLHIDDEN(bool) rtReqPoolRecycle(PRTREQPOOLINT pPool, PRTREQINT pReq)
 {
     if (   pPool
-        && ASMAtomicReadU32(&pPool->cCurFreeRequests) < pPool->cMaxFreeRequests)
+        && pPool->fWorkStealing)
+    {
+        if (ASMAtomicIncU32(&pPool->cCurFreeRequests) <= pPool->cMaxFreeRequests)
+        {
+            rtReqPoolWsPushChain(&pPool->pFreeRequests, pReq, pReq);
+            return true;
+        }
+        ASMAtomicDecU32(&pPool->cCurFreeRequests);
+    }
+    else if (   pPool
+             && ASMAtomicReadU32(&pPool->cCurFreeRequests) < pPool->cMaxFreeRequests)
     {
         RTCritSectEnter(&pPool->CritSect);
         if (pPool->cCurFreeRequests < pPool->cMaxFreeRequests)
@@ -618,6 +1258,78 @@ DECLHIDDEN(bool) rtReqPoolRecycle(PRTREQPOOLINT pPool, PRTREQINT pReq)
 }
 
 
+/**
+ * @callback_method_impl{FNRTONCE, Allocates the worker TLS entry.}
+ */
+static DECLCALLBACK(int32_t) rtReqPoolWsInitOnce(void *pvUser)
+{
+    RT_NOREF_PV(pvUser);
+    return RTTlsAllocEx(&g_iRtReqPoolWsTls, NULL);
+}
+
+
+/**
+ * Switches the pool to work-stealing mode.
+ *
+ * @returns IPRT status code.
+ * @param   pPool               The pool.
+ * @remarks Caller owns the critical section, no threads or submissions yet.
+ */
+static int rtReqPoolWsInit(PRTREQPOOLINT pPool)
+{
+    int rc = RTOnce(&g_rtReqPoolWsOnce, rtReqPoolWsInitOnce, NULL);
+    if (RT_FAILURE(rc))
+        return rc;
+
+    pPool->papWsThreads = (PRTREQPOOLTHREAD volatile *)RTMemAllocZ(sizeof(pPool->papWsThreads[0]) * RTREQPOOL_WS_MAX_THREADS);
+    if (!pPool->papWsThreads)
+        return VERR_NO_MEMORY;
+    pPool->fWorkStealing = true;
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Leaves work-stealing mode, freeing the associated resources.
+ *
+ * Any requests left in the deques and the injection list are cancelled.
+ *
+ * @param   pPool               The pool.
+ * @remarks Caller owns the critical section, no worker threads left.
+ */
+static void rtReqPoolWsTerm(PRTREQPOOLINT pPool)
+{
+    Assert(RTListIsEmpty(&pPool->WorkerThreads));
+
+    PRTREQINT pReq = ASMAtomicXchgPtrT(&pPool->pWsInjected, NULL, PRTREQINT);
+    Assert(!pReq);
+    while (pReq)
+    {
+        PRTREQINT pNext = pReq->pNext;
+        rtReqPoolCancelReq(pReq);
+        pReq = pNext;
+    }
+
+    for (uint32_t i = 0; i < pPool->cWsSlotsUsed; i++)
+    {
+        PRTREQPOOLTHREAD pThread = pPool->papWsThreads[i];
+        Assert(pThread->fWsRetired);
+        while ((pReq = rtReqPoolWsDequePop(&pThread->WsDeque)) != NULL)
+        {
+            AssertFailed();
+            rtReqPoolCancelReq(pReq);
+        }
+        RTMemFree(pThread);
+    }
+    pPool->cWsSlotsUsed = 0;
+    pPool->cCurPendingRequests = 0;
+
+    RTMemFree((void *)pPool->papWsThreads);
+    pPool->papWsThreads = NULL;
+    pPool->fWorkStealing = false;
+}
+
+
 RTDECL(int) RTReqPoolCreate(uint32_t cMaxThreads, RTMSINTERVAL cMsMinIdle,
                             uint32_t cThreadsPushBackThreshold, uint32_t cMsMaxPushBack,
                             const char *pszName, PRTREQPOOL phPool)
@@ -688,6 +1400,11 @@ RTDECL(int) RTReqPoolCreate(uint32_t cMaxThreads, RTMSINTERVAL cMsMinIdle,
     pPool->cReqSubmitted        = 0;
     pPool->pFreeRequests        = NULL;
     pPool->cCurFreeRequests     = 0;
+    pPool->fWorkStealing        = false;
+    pPool->cWsSlotsUsed         = 0;
+    pPool->papWsThreads         = NULL;
+    pPool->pWsInjected          = NULL;
+    pPool->cWsReqStolen         = 0;
 
     int rc = RTSemEventMultiCreate(&pPool->hThreadTermEvt);
     if (RT_SUCCESS(rc))
@@ -832,13 +1549,31 @@ RTDECL(int) RTReqPoolSetCfgVar(RTREQPOOL hPool, RTREQPOOLCFGVAR enmVar, uint64_t
 
             while (pPool->cCurFreeRequests > pPool->cMaxFreeRequests)
             {
-                PRTREQINT pReq = pPool->pFreeRequests;
-                pPool->pFreeRequests = pReq->pNext;
-                ASMAtomicDecU32(&pPool->cCurFreeRequests);
+                PRTREQINT pReq;
+                if (!pPool->fWorkStealing)
+                {
+                    pReq = pPool->pFreeRequests;
+                    pPool->pFreeRequests = pReq->pNext;
+                    ASMAtomicDecU32(&pPool->cCurFreeRequests);
+                }
+                else if ((pReq = rtReqPoolWsFreePop(pPool)) == NULL)
+                    break;
                 rtReqFreeIt(pReq);
             }
             break;
 
+        case RTREQPOOLCFGVAR_WORK_STEALING:
+            if (RT_BOOL(uValue) == pPool->fWorkStealing)
+                break;
+            AssertMsgBreakStmt(pPool->cCurThreads == 0 && pPool->cReqSubmitted == 0,
+                               ("cCurThreads=%u cReqSubmitted=%llu\n", pPool->cCurThreads, pPool->cReqSubmitted),
+                               rc = VERR_INVALID_STATE);
+            if (uValue)
+                rc = rtReqPoolWsInit(pPool);
+            else
+                rtReqPoolWsTerm(pPool);
+            break;
+
         default:
             AssertFailed();
             rc = VERR_IPE_NOT_REACHED_DEFAULT_CASE;
@@ -910,6 +1645,10 @@ RTDECL(uint64_t) RTReqPoolGetCfgVar(RTREQPOOL hPool, RTREQPOOLCFGVAR enmVar)
             u64 = pPool->cMaxFreeRequests;
             break;
 
+        case RTREQPOOLCFGVAR_WORK_STEALING:
+            u64 = pPool->fWorkStealing;
+            break;
+
         default:
             AssertFailed();
             u64 = UINT64_MAX;
@@ -946,6 +1685,7 @@ RTDECL(uint64_t) RTReqPoolGetStat(RTREQPOOL hPool, RTREQPOOLSTAT enmStat)
         case RTREQPOOLSTAT_NS_TOTAL_REQ_QUEUED:         u64 = pPool->cNsTotalReqQueued; break;
         case RTREQPOOLSTAT_NS_AVERAGE_REQ_PROCESSING:   u64 = pPool->cNsTotalReqProcessing / RT_MAX(pPool->cReqProcessed, 1); break;
         case RTREQPOOLSTAT_NS_AVERAGE_REQ_QUEUED:       u64 = pPool->cNsTotalReqQueued / RT_MAX(pPool->cReqProcessed, 1); break;
+        case RTREQPOOLSTAT_REQUESTS_STOLEN:             u64 = pPool->cWsReqStolen; break;
         default:
             AssertFailed();
             u64 = UINT64_MAX;
@@ -1023,6 +1763,10 @@ RTDECL(uint32_t) RTReqPoolRelease(RTREQPOOL hPool)
             /** @todo should we wait forever here? */
         }
 
+        /* Work-stealing leftovers. */
+        if (pPool->fWorkStealing)
+            rtReqPoolWsTerm(pPool);
+
         /* Free recycled requests. */
         for (;;)
         {
@@ -1056,15 +1800,22 @@ RTDECL(int) RTReqPoolAlloc(RTREQPOOL hPool, RTREQTYPE enmType, PRTREQ *phReq)
      */
     if (ASMAtomicReadU32(&pPool->cCurFreeRequests) > 0)
     {
-        RTCritSectEnter(&pPool->CritSect);
-        PRTREQINT pReq = pPool->pFreeRequests;
-        if (pReq)
+        PRTREQINT pReq;
+        if (!pPool->fWorkStealing)
         {
-            ASMAtomicDecU32(&pPool->cCurFreeRequests);
-            pPool->pFreeRequests = pReq->pNext;
-
+            RTCritSectEnter(&pPool->CritSect);
+            pReq = pPool->pFreeRequests;
+            if (pReq)
+            {
+                ASMAtomicDecU32(&pPool->cCurFreeRequests);
+                pPool->pFreeRequests = pReq->pNext;
+            }
             RTCritSectLeave(&pPool->CritSect);
-
+        }
+        else
+            pReq = rtReqPoolWsFreePop(pPool);
+        if (pReq)
+        {
             Assert(pReq->fPoolOrQueue);
             Assert(pReq->uOwner.hPool == pPool);
 
@@ -1076,8 +1827,6 @@ RTDECL(int) RTReqPoolAlloc(RTREQPOOL hPool, RTREQTYPE enmType, PRTREQ *phReq)
                 return rc;
             }
         }
-        else
-            RTCritSectLeave(&pPool->CritSect);
     }
 
     /*
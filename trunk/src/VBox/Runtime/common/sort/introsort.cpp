@@ -0,0 +1,367 @@
+/* $Id$ */
+/** @file
+ * IPRT - RTSortIntro, RTSortApvIntro.
+ */
+
+/*
+ * Copyright (C) 2016 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ *
+ * The contents of this file may alternatively be used under the terms
+ * of the Common Development and Distribution License Version 1.0
+ * (CDDL) only, as it comes in the "COPYING.CDDL" file of the
+ * VirtualBox OSE distribution, in which case the provisions of the
+ * CDDL are applicable instead of those of the GPL.
+ *
+ * You may elect to license modified versions of this file under the
+ * terms and conditions of either the GPL or the CDDL or both.
+ */
+
+
+/*********************************************************************************************************************************
+*   Header Files                                                                                                                 *
+*********************************************************************************************************************************/
+#include "internal/iprt.h"
+#include <iprt/sort.h>
+
+#include <iprt/alloca.h>
+#include <iprt/asm.h>
+#include <iprt/assert.h>
+#include <iprt/string.h>
+#include "internal/sort.h"
+
+
+/*********************************************************************************************************************************
+*   Defined Constants And Macros                                                                                                 *
+*********************************************************************************************************************************/
+/** Ranges larger than this use the pseudo median of nine as pivot. */
+#define RTSORT_NINTHER_THRESHOLD        128
+/** Max number of elements partial insertion sort may move before giving up. */
+#define RTSORT_PARTIAL_INSERTION_LIMIT  8
+/** Gets the address of element @a a_i relative to @a a_pb. */
+#define RTSORT_ELEM(a_pb, a_i)          ((a_pb) + (a_i) * pCtx->cbElement)
+
+
+
+/**
+ * Insertion sort which gives up after moving a few elements.
+ *
+ * Used on ranges that looked sorted while partitioning.
+ *
+ * @returns true if the range is now sorted, false if it gave up.
+ * @param   pCtx        The sorting context.
+ * @param   pbBegin     The first element.
+ * @param   cElements   The number of elements in the range.
+ */
+static bool rtSortPartialInsertion(PRTSORTCTX pCtx, uint8_t *pbBegin, size_t cElements)
+{
+    size_t const cb     = pCtx->cbElement;
+    size_t       cMoved = 0;
+    for (size_t i = 1; i < cElements; i++)
+    {
+        uint8_t *pbCur = pbBegin + i * cb;
+        if (rtSortCmp(pCtx, pbCur - cb, pbCur) > 0)
+        {
+            uint8_t *pbHole = pbCur - cb;
+            memcpy(pCtx->pbTmp, pbCur, cb);
+            while (   pbHole > pbBegin
+                   && rtSortCmp(pCtx, pbHole - cb, pCtx->pbTmp) > 0)
+                pbHole -= cb;
+            memmove(pbHole + cb, pbHole, pbCur - pbHole);
+            memcpy(pbHole, pCtx->pbTmp, cb);
+
+            cMoved += (size_t)(pbCur - pbHole) / cb;
+            if (cMoved > RTSORT_PARTIAL_INSERTION_LIMIT)
+                return false;
+        }
+    }
+    return true;
+}
+
+
+/**
+ * Heap sort, the fallback when the partitioning keeps going bad.
+ *
+ * @param   pCtx        The sorting context.
+ * @param   pb          The first element.
+ * @param   cElements   The number of elements in the range.
+ */
+static void rtSortHeap(PRTSORTCTX pCtx, uint8_t *pb, size_t cElements)
+{
+    size_t i = cElements / 2;
+    size_t cHeap = cElements;
+    for (;;)
+    {
+        /* Build the heap first, then move the top to the end one by one. */
+        if (i > 0)
+            i--;
+        else
+        {
+            if (--cHeap == 0)
+                break;
+            rtSortSwap(pCtx, pb, RTSORT_ELEM(pb, cHeap));
+        }
+
+        /* Sift down. */
+        size_t iRoot = i;
+        for (;;)
+        {
+            size_t iChild = iRoot * 2 + 1;
+            if (iChild >= cHeap)
+                break;
+            if (   iChild + 1 < cHeap
+                && rtSortCmp(pCtx, RTSORT_ELEM(pb, iChild), RTSORT_ELEM(pb, iChild + 1)) < 0)
+                iChild++;
+            if (rtSortCmp(pCtx, RTSORT_ELEM(pb, iRoot), RTSORT_ELEM(pb, iChild)) >= 0)
+                break;
+            rtSortSwap(pCtx, RTSORT_ELEM(pb, iRoot), RTSORT_ELEM(pb, iChild));
+            iRoot = iChild;
+        }
+    }
+}
+
+
+/**
+ * Orders three elements.
+ */
+DECLINLINE(void) rtSortThree(PRTSORTCTX pCtx, uint8_t *pb1, uint8_t *pb2, uint8_t *pb3)
+{
+    if (rtSortCmp(pCtx, pb2, pb1) < 0)
+        rtSortSwap(pCtx, pb1, pb2);
+    if (rtSortCmp(pCtx, pb3, pb2) < 0)
+    {
+        rtSortSwap(pCtx, pb2, pb3);
+        if (rtSortCmp(pCtx, pb2, pb1) < 0)
+            rtSortSwap(pCtx, pb1, pb2);
+    }
+}
+
+
+/**
+ * Partitions the range around the pivot in the first element, elements equal
+ * to the pivot goes to the right.
+ *
+ * @returns The final index of the pivot.  Elements before it are smaller,
+ *          elements after it are larger or equal.
+ * @param   pCtx                    The sorting context.
+ * @param   pb                      The first element (the pivot).
+ * @param   cElements               The number of elements in the range.
+ * @param   pfAlreadyPartitioned    Where to return whether no elements had to
+ *                                  be moved.
+ */
+static size_t rtSortPartitionRight(PRTSORTCTX pCtx, uint8_t *pb, size_t cElements, bool *pfAlreadyPartitioned)
+{
+    size_t i = 1;
+    size_t j = cElements;
+    while (i < j && rtSortCmp(pCtx, RTSORT_ELEM(pb, i), pb) < 0)
+        i++;
+    while (j > i && rtSortCmp(pCtx, RTSORT_ELEM(pb, j - 1), pb) >= 0)
+        j--;
+    *pfAlreadyPartitioned = i >= j;
+
+    while (i < j)
+    {
+        rtSortSwap(pCtx, RTSORT_ELEM(pb, i), RTSORT_ELEM(pb, j - 1));
+        i++;
+        j--;
+        while (i < j && rtSortCmp(pCtx, RTSORT_ELEM(pb, i), pb) < 0)
+            i++;
+        while (j > i && rtSortCmp(pCtx, RTSORT_ELEM(pb, j - 1), pb) >= 0)
+            j--;
+    }
+
+    if (i > 1)
+        rtSortSwap(pCtx, pb, RTSORT_ELEM(pb, i - 1));
+    return i - 1;
+}
+
+
+/**
+ * Partitions the range around the pivot in the first element, elements equal
+ * to the pivot goes to the left.
+ *
+ * This is used when the pivot equals the element preceeding the range, i.e.
+ * when it is the smallest value in it, so that runs of equal elements are dealt
+ * with in linear time.
+ *
+ * @returns The final index of the pivot.  Elements before it are smaller or
+ *          equal, elements after it are larger.
+ * @param   pCtx        The sorting context.
+ * @param   pb          The first element (the pivot).
+ * @param   cElements   The number of elements in the range.
+ */
+static size_t rtSortPartitionLeft(PRTSORTCTX pCtx, uint8_t *pb, size_t cElements)
+{
+    size_t i = 1;
+    size_t j = cElements;
+    while (j > i && rtSortCmp(pCtx, pb, RTSORT_ELEM(pb, j - 1)) < 0)
+        j--;
+    while (i < j && rtSortCmp(pCtx, pb, RTSORT_ELEM(pb, i)) >= 0)
+        i++;
+
+    while (i < j)
+    {
+        rtSortSwap(pCtx, RTSORT_ELEM(pb, i), RTSORT_ELEM(pb, j - 1));
+        i++;
+        j--;
+        while (j > i && rtSortCmp(pCtx, pb, RTSORT_ELEM(pb, j - 1)) < 0)
+            j--;
+        while (i < j && rtSortCmp(pCtx, pb, RTSORT_ELEM(pb, i)) >= 0)
+            i++;
+    }
+
+    if (j > 1)
+        rtSortSwap(pCtx, pb, RTSORT_ELEM(pb, j - 1));
+    return j - 1;
+}
+
+
+/**
+ * The pattern defeating introsort worker.
+ *
+ * Quicksort with median of three (nine for large ranges) pivots, which falls
+ * back on heap sort when the partitions keep coming out badly unbalanced and
+ * uses insertion sort for small ranges.  Already sorted ranges and runs of
+ * equal elements are detected and take linear time.
+ *
+ * Recurses on the smaller partition and loops on the larger, so the stack
+ * depth stays logarithmic.
+ *
+ * @param   pCtx            The sorting context.
+ * @param   pb              The first element.
+ * @param   cElements       The number of elements in the range.
+ * @param   cBadAllowed     Number of unbalanced partitionings allowed before
+ *                          switching to heap sort.
+ * @param   fLeftmost       Set if there are no elements preceeding the range.
+ */
+static void rtSortIntroWorker(PRTSORTCTX pCtx, uint8_t *pb, size_t cElements, unsigned cBadAllowed, bool fLeftmost)
+{
+    for (;;)
+    {
+        if (cElements <= RTSORT_INSERTION_THRESHOLD)
+        {
+            rtSortInsertion(pCtx, pb, cElements);
+            return;
+        }
+
+        /*
+         * Pick the pivot and put it at the start of the range.
+         */
+        size_t const iMid = cElements / 2;
+        if (cElements > RTSORT_NINTHER_THRESHOLD)
+        {
+            rtSortThree(pCtx, pb,                       RTSORT_ELEM(pb, iMid),     RTSORT_ELEM(pb, cElements - 1));
+            rtSortThree(pCtx, RTSORT_ELEM(pb, 1),       RTSORT_ELEM(pb, iMid - 1), RTSORT_ELEM(pb, cElements - 2));
+            rtSortThree(pCtx, RTSORT_ELEM(pb, 2),       RTSORT_ELEM(pb, iMid + 1), RTSORT_ELEM(pb, cElements - 3));
+            rtSortThree(pCtx, RTSORT_ELEM(pb, iMid - 1), RTSORT_ELEM(pb, iMid),    RTSORT_ELEM(pb, iMid + 1));
+            rtSortSwap(pCtx, pb, RTSORT_ELEM(pb, iMid));
+        }
+        else
+            rtSortThree(pCtx, RTSORT_ELEM(pb, iMid), pb, RTSORT_ELEM(pb, cElements - 1));
+
+        /*
+         * If the pivot equals the preceeding element, it is the smallest
+         * value in the range.  Put all its copies on the left and skip them.
+         */
+        if (   !fLeftmost
+            && rtSortCmp(pCtx, pb - pCtx->cbElement, pb) == 0)
+        {
+            size_t iPivot = rtSortPartitionLeft(pCtx, pb, cElements);
+            pb        = RTSORT_ELEM(pb, iPivot + 1);
+            cElements -= iPivot + 1;
+            continue;
+        }
+
+        bool         fAlreadyPartitioned;
+        size_t const iPivot = rtSortPartitionRight(pCtx, pb, cElements, &fAlreadyPartitioned);
+        size_t const cLeft  = iPivot;
+        size_t const cRight = cElements - iPivot - 1;
+        uint8_t     *pbRight = RTSORT_ELEM(pb, iPivot + 1);
+
+        if (cLeft < cElements / 8 || cRight < cElements / 8)
+        {
+            /*
+             * Unbalanced, give up on quicksort if it keeps happening.
+             * Otherwise shuffle some elements around to break up patterns.
+             */
+            if (--cBadAllowed == 0)
+            {
+                rtSortHeap(pCtx, pb, cElements);
+                return;
+            }
+            if (cLeft >= RTSORT_INSERTION_THRESHOLD)
+            {
+                rtSortSwap(pCtx, pb, RTSORT_ELEM(pb, cLeft / 4));
+                rtSortSwap(pCtx, RTSORT_ELEM(pb, iPivot - 1), RTSORT_ELEM(pb, iPivot - cLeft / 4));
+            }
+            if (cRight >= RTSORT_INSERTION_THRESHOLD)
+            {
+                rtSortSwap(pCtx, pbRight, RTSORT_ELEM(pbRight, cRight / 4));
+                rtSortSwap(pCtx, RTSORT_ELEM(pb, cElements - 1), RTSORT_ELEM(pb, cElements - cRight / 4));
+            }
+        }
+        else if (   fAlreadyPartitioned
+                 && rtSortPartialInsertion(pCtx, pb, cLeft)
+                 && rtSortPartialInsertion(pCtx, pbRight, cRight))
+            return;
+
+        /*
+         * Recurse on the smaller partition, loop on the larger one.
+         */
+        if (cLeft < cRight)
+        {
+            rtSortIntroWorker(pCtx, pb, cLeft, cBadAllowed, fLeftmost);
+            pb        = pbRight;
+            cElements = cRight;
+            fLeftmost = false;
+        }
+        else
+        {
+            rtSortIntroWorker(pCtx, pbRight, cRight, cBadAllowed, false);
+            cElements = cLeft;
+        }
+    }
+}
+
+
+RTDECL(void) RTSortIntro(void *pvArray, size_t cElements, size_t cbElement, PFNRTSORTCMP pfnCmp, void *pvUser)
+{
+    /* Anything worth sorting? */
+    if (cElements < 2)
+        return;
+
+    RTSORTCTX Ctx;
+    Ctx.pfnCmp    = pfnCmp;
+    Ctx.pvUser    = pvUser;
+    Ctx.cbElement = cbElement;
+    Ctx.fApv      = false;
+    Ctx.pbTmp     = (uint8_t *)alloca(cbElement);
+    rtSortIntroWorker(&Ctx, (uint8_t *)pvArray, cElements, ASMBitLastSetU64(cElements), true /*fLeftmost*/);
+}
+RT_EXPORT_SYMBOL(RTSortIntro);
+
+
+RTDECL(void) RTSortApvIntro(void **papvArray, size_t cElements, PFNRTSORTCMP pfnCmp, void *pvUser)
+{
+    /* Anything worth sorting? */
+    if (cElements < 2)
+        return;
+
+    void     *pvTmp;
+    RTSORTCTX Ctx;
+    Ctx.pfnCmp    = pfnCmp;
+    Ctx.pvUser    = pvUser;
+    Ctx.cbElement = sizeof(void *);
+    Ctx.fApv      = true;
+    Ctx.pbTmp     = (uint8_t *)&pvTmp;
+    rtSortIntroWorker(&Ctx, (uint8_t *)papvArray, cElements, ASMBitLastSetU64(cElements), true /*fLeftmost*/);
+}
+RT_EXPORT_SYMBOL(RTSortApvIntro);
+
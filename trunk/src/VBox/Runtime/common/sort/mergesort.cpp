@@ -0,0 +1,327 @@
+/* $Id$ */
+/** @file
+ * IPRT - RTSortMerge, RTSortApvMerge, RTSortParallel.
+ */
+
+/*
+ * Copyright (C) 2016 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ *
+ * The contents of this file may alternatively be used under the terms
+ * of the Common Development and Distribution License Version 1.0
+ * (CDDL) only, as it comes in the "COPYING.CDDL" file of the
+ * VirtualBox OSE distribution, in which case the provisions of the
+ * CDDL are applicable instead of those of the GPL.
+ *
+ * You may elect to license modified versions of this file under the
+ * terms and conditions of either the GPL or the CDDL or both.
+ */
+
+
+/*********************************************************************************************************************************
+*   Header Files                                                                                                                 *
+*********************************************************************************************************************************/
+#include "internal/iprt.h"
+#include <iprt/sort.h>
+
+#include <iprt/alloca.h>
+#include <iprt/assert.h>
+#include <iprt/err.h>
+#include <iprt/mem.h>
+#include <iprt/mp.h>
+#include <iprt/req.h>
+#include <iprt/string.h>
+#include "internal/sort.h"
+
+
+/*********************************************************************************************************************************
+*   Defined Constants And Macros                                                                                                 *
+*********************************************************************************************************************************/
+/** The max number of chunks RTSortParallel splits the array into. */
+#define RTSORT_PARALLEL_MAX_CHUNKS          64
+/** The min number of elements in a RTSortParallel chunk. */
+#define RTSORT_PARALLEL_MIN_CHUNK           4096
+
+
+/*********************************************************************************************************************************
+*   Structures and Typedefs                                                                                                      *
+*********************************************************************************************************************************/
+/**
+ * A RTSortParallel job, either sorting a chunk or merging two adjacent runs.
+ */
+typedef struct RTSORTPARJOB
+{
+    /** The sorting context template (pbTmp is not used). */
+    RTSORTCTX const    *pCtx;
+    /** The first element of the range. */
+    uint8_t            *pb;
+    /** Number of elements in the left run (whole chunk when sorting). */
+    size_t              cLeft;
+    /** Number of elements in the right run, 0 when sorting. */
+    size_t              cRight;
+    /** The merge buffer, at least cLeft elements big. */
+    uint8_t            *pbBuf;
+    /** The request handle while in the pool. */
+    PRTREQ              hReq;
+} RTSORTPARJOB;
+/** Pointer to a RTSortParallel job. */
+typedef RTSORTPARJOB *PRTSORTPARJOB;
+
+
+
+/**
+ * Merges two adjacent sorted runs.
+ *
+ * Elements of the left run are put before equal elements of the right one,
+ * which keeps the sort stable.
+ *
+ * @param   pCtx        The sorting context.
+ * @param   pb          The first element of the left run.
+ * @param   cLeft       The number of elements in the left run.
+ * @param   cRight      The number of elements in the right run, which follows
+ *                      immediately after the left one.
+ * @param   pbBuf       Buffer for the left run.
+ */
+static void rtSortMergeRuns(PRTSORTCTX pCtx, uint8_t *pb, size_t cLeft, size_t cRight, uint8_t *pbBuf)
+{
+    size_t const    cb       = pCtx->cbElement;
+    uint8_t        *pbRight  = pb + cLeft * cb;
+    uint8_t * const pbEnd    = pbRight + cRight * cb;
+
+    /* Already in order? */
+    if (!cLeft || !cRight || rtSortCmp(pCtx, pbRight - cb, pbRight) <= 0)
+        return;
+
+    memcpy(pbBuf, pb, cLeft * cb);
+    uint8_t        *pbLeft   = pbBuf;
+    uint8_t * const pbLeftEnd = pbBuf + cLeft * cb;
+    uint8_t        *pbDst    = pb;
+    while (pbLeft < pbLeftEnd && pbRight < pbEnd)
+    {
+        if (rtSortCmp(pCtx, pbRight, pbLeft) < 0)
+        {
+            memcpy(pbDst, pbRight, cb);
+            pbRight += cb;
+        }
+        else
+        {
+            memcpy(pbDst, pbLeft, cb);
+            pbLeft += cb;
+        }
+        pbDst += cb;
+    }
+
+    /* What remains of the right run is already in place. */
+    memcpy(pbDst, pbLeft, pbLeftEnd - pbLeft);
+}
+
+
+/**
+ * The merge sort worker.
+ *
+ * @param   pCtx        The sorting context.
+ * @param   pb          The first element.
+ * @param   cElements   The number of elements.
+ * @param   pbBuf       Merge buffer with room for at least half the elements.
+ */
+static void rtSortMergeWorker(PRTSORTCTX pCtx, uint8_t *pb, size_t cElements, uint8_t *pbBuf)
+{
+    if (cElements <= RTSORT_INSERTION_THRESHOLD)
+        rtSortInsertion(pCtx, pb, cElements);
+    else
+    {
+        size_t const cLeft = cElements / 2;
+        rtSortMergeWorker(pCtx, pb, cLeft, pbBuf);
+        rtSortMergeWorker(pCtx, pb + cLeft * pCtx->cbElement, cElements - cLeft, pbBuf);
+        rtSortMergeRuns(pCtx, pb, cLeft, cElements - cLeft, pbBuf);
+    }
+}
+
+
+/**
+ * Common worker for RTSortMerge and RTSortApvMerge.
+ */
+static int rtSortMerge(PRTSORTCTX pCtx, uint8_t *pb, size_t cElements)
+{
+    uint8_t *pbBuf = NULL;
+    if (cElements > RTSORT_INSERTION_THRESHOLD)
+    {
+        pbBuf = (uint8_t *)RTMemTmpAlloc(cElements / 2 * pCtx->cbElement);
+        if (!pbBuf)
+            return VERR_NO_TMP_MEMORY;
+    }
+    rtSortMergeWorker(pCtx, pb, cElements, pbBuf);
+    RTMemTmpFree(pbBuf);
+    return VINF_SUCCESS;
+}
+
+
+RTDECL(int) RTSortMerge(void *pvArray, size_t cElements, size_t cbElement, PFNRTSORTCMP pfnCmp, void *pvUser)
+{
+    /* Anything worth sorting? */
+    if (cElements < 2)
+        return VINF_SUCCESS;
+
+    RTSORTCTX Ctx;
+    Ctx.pfnCmp    = pfnCmp;
+    Ctx.pvUser    = pvUser;
+    Ctx.cbElement = cbElement;
+    Ctx.fApv      = false;
+    Ctx.pbTmp     = (uint8_t *)alloca(cbElement);
+    return rtSortMerge(&Ctx, (uint8_t *)pvArray, cElements);
+}
+RT_EXPORT_SYMBOL(RTSortMerge);
+
+
+RTDECL(int) RTSortApvMerge(void **papvArray, size_t cElements, PFNRTSORTCMP pfnCmp, void *pvUser)
+{
+    /* Anything worth sorting? */
+    if (cElements < 2)
+        return VINF_SUCCESS;
+
+    void     *pvTmp;
+    RTSORTCTX Ctx;
+    Ctx.pfnCmp    = pfnCmp;
+    Ctx.pvUser    = pvUser;
+    Ctx.cbElement = sizeof(void *);
+    Ctx.fApv      = true;
+    Ctx.pbTmp     = (uint8_t *)&pvTmp;
+    return rtSortMerge(&Ctx, (uint8_t *)papvArray, cElements);
+}
+RT_EXPORT_SYMBOL(RTSortApvMerge);
+
+
+/**
+ * Executes a RTSortParallel job, on a pool thread or the caller's.
+ *
+ * @returns VINF_SUCCESS.
+ * @param   pJob        The job.
+ */
+static DECLCALLBACK(int) rtSortParallelJob(PRTSORTPARJOB pJob)
+{
+    RTSORTCTX Ctx = *pJob->pCtx;
+    Ctx.pbTmp = (uint8_t *)alloca(Ctx.cbElement);
+    if (!pJob->cRight)
+        rtSortMergeWorker(&Ctx, pJob->pb, pJob->cLeft, pJob->pbBuf);
+    else
+        rtSortMergeRuns(&Ctx, pJob->pb, pJob->cLeft, pJob->cRight, pJob->pbBuf);
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Runs a batch of jobs, handing all but the last to the pool and doing the
+ * last one on the calling thread.
+ *
+ * @param   hPool       The request pool.
+ * @param   paJobs      The jobs.
+ * @param   cJobs       Number of jobs.
+ */
+static void rtSortParallelRunJobs(RTREQPOOL hPool, PRTSORTPARJOB paJobs, size_t cJobs)
+{
+    for (size_t i = 0; i + 1 < cJobs; i++)
+    {
+        int rc = RTReqPoolCallEx(hPool, 0 /*cMillies*/, &paJobs[i].hReq, RTREQFLAGS_IPRT_STATUS,
+                                 (PFNRT)rtSortParallelJob, 1, &paJobs[i]);
+        if (rc != VINF_SUCCESS && rc != VERR_TIMEOUT)
+        {
+            /* Couldn't queue it, do it ourselves. */
+            paJobs[i].hReq = NIL_RTREQ;
+            rtSortParallelJob(&paJobs[i]);
+        }
+    }
+
+    rtSortParallelJob(&paJobs[cJobs - 1]);
+
+    for (size_t i = 0; i + 1 < cJobs; i++)
+        if (paJobs[i].hReq != NIL_RTREQ)
+        {
+            int rc = RTReqWait(paJobs[i].hReq, RT_INDEFINITE_WAIT);
+            AssertRC(rc);
+            RTReqRelease(paJobs[i].hReq);
+            paJobs[i].hReq = NIL_RTREQ;
+        }
+}
+
+
+RTDECL(int) RTSortParallel(RTREQPOOL hPool, void *pvArray, size_t cElements, size_t cbElement,
+                           PFNRTSORTCMP pfnCmp, void *pvUser)
+{
+    /*
+     * Figure out how many chunks to use, sticking to a power of two so the
+     * runs can be merged pairwise.
+     */
+    uint32_t cChunks = 1;
+    if (hPool != NIL_RTREQPOOL)
+    {
+        uint64_t cMaxChunks = RT_MIN(RTMpGetOnlineCount(), RTReqPoolGetCfgVar(hPool, RTREQPOOLCFGVAR_MAX_THREADS) + 1);
+        cMaxChunks = RT_MIN(cMaxChunks, RTSORT_PARALLEL_MAX_CHUNKS);
+        while (   cChunks * 2 <= cMaxChunks
+               && cElements / (cChunks * 2) >= RTSORT_PARALLEL_MIN_CHUNK)
+            cChunks *= 2;
+    }
+    if (cChunks < 2)
+        return RTSortMerge(pvArray, cElements, cbElement, pfnCmp, pvUser);
+
+    RTSORTCTX Ctx;
+    Ctx.pfnCmp    = pfnCmp;
+    Ctx.pvUser    = pvUser;
+    Ctx.cbElement = cbElement;
+    Ctx.fApv      = false;
+    Ctx.pbTmp     = NULL;
+
+    /* Each job uses the part of the buffer corresponding to its range. */
+    uint8_t *pbBuf = (uint8_t *)RTMemTmpAlloc(cElements * cbElement);
+    if (!pbBuf)
+        return VERR_NO_TMP_MEMORY;
+
+    /*
+     * Sort the chunks, then merge the runs pairwise until there is only one.
+     * The jobs of one round work on disjoint parts of the array and buffer.
+     */
+    RTSORTPARJOB    aJobs[RTSORT_PARALLEL_MAX_CHUNKS];
+    size_t          aoffRuns[RTSORT_PARALLEL_MAX_CHUNKS + 1];
+    uint8_t * const pb = (uint8_t *)pvArray;
+    for (uint32_t i = 0; i <= cChunks; i++)
+        aoffRuns[i] = cElements * i / cChunks;
+
+    for (uint32_t i = 0; i < cChunks; i++)
+    {
+        aJobs[i].pCtx   = &Ctx;
+        aJobs[i].pb     = pb + aoffRuns[i] * cbElement;
+        aJobs[i].cLeft  = aoffRuns[i + 1] - aoffRuns[i];
+        aJobs[i].cRight = 0;
+        aJobs[i].pbBuf  = pbBuf + aoffRuns[i] * cbElement;
+        aJobs[i].hReq   = NIL_RTREQ;
+    }
+    rtSortParallelRunJobs(hPool, aJobs, cChunks);
+
+    for (uint32_t cRuns = cChunks; cRuns > 1; cRuns /= 2)
+    {
+        for (uint32_t i = 0; i < cRuns / 2; i++)
+        {
+            aJobs[i].pCtx   = &Ctx;
+            aJobs[i].pb     = pb + aoffRuns[i * 2] * cbElement;
+            aJobs[i].cLeft  = aoffRuns[i * 2 + 1] - aoffRuns[i * 2];
+            aJobs[i].cRight = aoffRuns[i * 2 + 2] - aoffRuns[i * 2 + 1];
+            aJobs[i].pbBuf  = pbBuf + aoffRuns[i * 2] * cbElement;
+            aJobs[i].hReq   = NIL_RTREQ;
+        }
+        rtSortParallelRunJobs(hPool, aJobs, cRuns / 2);
+
+        for (uint32_t i = 0; i <= cRuns / 2; i++)
+            aoffRuns[i] = aoffRuns[i * 2];
+    }
+
+    RTMemTmpFree(pbBuf);
+    return VINF_SUCCESS;
+}
+RT_EXPORT_SYMBOL(RTSortParallel);
+
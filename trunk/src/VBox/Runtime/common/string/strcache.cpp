@@ -63,6 +63,15 @@
 #define RTSTRCACHE_INITIAL_HASH_SIZE        512
 /** The hash table growth factor. */
 #define RTSTRCACHE_HASH_GROW_FACTOR         4
+/** The number of old hash table slots to migrate into the new table per
+ * RTStrCacheEnterN call while a resize is in progress. */
+#define RTSTRCACHE_HASH_MIGRATE_BATCH       32
+
+/** The number of shards used by caches created with RTSTRCACHE_F_CONCURRENT.
+ * Must be a power of two and not larger than RTSTRCACHE_MAX_SHARDS. */
+#define RTSTRCACHE_CONCURRENT_SHARDS        8
+/** The max number of shards (limited by the 16-bit hash in the entry). */
+#define RTSTRCACHE_MAX_SHARDS               16
 
 /**
  * The RTSTRCACHEENTRY size threshold at which we stop using our own allocator
@@ -246,20 +255,31 @@ typedef RTSTRCACHECHUNK *PRTSTRCACHECHUNK;
 
 
 /**
- * Cache instance data.
+ * String cache shard.
+ *
+ * Each shard covers a fixed part of the hash space and has its own lock, hash
+ * table and allocator, so threads entering different strings rarely contend
+ * with each other.
  */
-typedef struct RTSTRCACHEINT
+typedef struct RTSTRCACHESHARD
 {
-    /** The string cache magic (RTSTRCACHE_MAGIC). */
-    uint32_t                u32Magic;
-    /** Ref counter for the cache handle. */
-    uint32_t volatile       cRefs;
-    /** The number of strings currently entered in the cache. */
+    /** The number of strings currently entered in the shard. */
     uint32_t                cStrings;
     /** The size of the hash table. */
     uint32_t                cHashTab;
     /** Pointer to the hash table. */
     PRTSTRCACHEENTRY       *papHashTab;
+    /** The number of PRTSTRCACHEENTRY_NIL entries in the hash table.  These
+     * count towards the load as lookups must probe past them. */
+    uint32_t                cHashTabNils;
+    /** The previous hash table while its entries are being moved over to
+     * papHashTab, NULL if no resize is in progress.  Lookups search both. */
+    PRTSTRCACHEENTRY       *papHashTabOld;
+    /** The size of the previous hash table. */
+    uint32_t                cHashTabOld;
+    /** The number of slots at the start of the previous hash table still to
+     * be migrated (we work our way down from the top). */
+    uint32_t                cHashTabOldLeft;
     /** Free list for allocations of the sizes defined by g_acbFixedLists. */
     PRTSTRCACHEFREE         apFreeLists[RTSTRCACHE_NUM_OF_FIXED_SIZES];
 #ifdef RTSTRCACHE_WITH_MERGED_ALLOCATOR
@@ -289,8 +309,33 @@ typedef struct RTSTRCACHEINT
     uint32_t                cRehashes;
     /** @} */
 
-    /** Critical section protecting the cache structures. */
+    /** Critical section protecting the shard structures. */
     RTCRITSECT              CritSect;
+} RTSTRCACHESHARD;
+/** Pointer to a string cache shard. */
+typedef RTSTRCACHESHARD *PRTSTRCACHESHARD;
+
+
+/**
+ * Cache instance data.
+ */
+typedef struct RTSTRCACHEINT
+{
+    /** The string cache magic (RTSTRCACHE_MAGIC). */
+    uint32_t                u32Magic;
+    /** Ref counter for the cache handle. */
+    uint32_t volatile       cRefs;
+    /** The number of shards (power of two). */
+    uint32_t                cShards;
+    /** Alignment padding. */
+    uint32_t                u32Padding;
+    /** The shards, each padded to a cache line multiple to avoid false
+     * sharing between the locks.  Variable size, cShards entries. */
+    union
+    {
+        RTSTRCACHESHARD     s;
+        uint8_t             abPadding[RT_ALIGN_Z(sizeof(RTSTRCACHESHARD), 64)];
+    } aShards[1];
 } RTSTRCACHEINT;
 /** Pointer to a cache instance. */
 typedef RTSTRCACHEINT *PRTSTRCACHEINT;
@@ -316,42 +361,117 @@ static RTSTRCACHE   g_hrtStrCacheDefault = NIL_RTSTRCACHE;
 static DECLCALLBACK(int) rtStrCacheInitDefault(void *pvUser)
 {
     NOREF(pvUser);
-    return RTStrCacheCreate(&g_hrtStrCacheDefault, "Default");
+    return RTStrCacheCreateEx(&g_hrtStrCacheDefault, "Default", RTSTRCACHE_F_CONCURRENT);
 }
 
 
-RTDECL(int) RTStrCacheCreate(PRTSTRCACHE phStrCache, const char *pszName)
+/**
+ * Initializes a shard.
+ *
+ * @returns IPRT status code.
+ * @param   pShard              The shard (zeroed).
+ */
+static int rtStrCacheShardInit(PRTSTRCACHESHARD pShard)
 {
-    int            rc    = VERR_NO_MEMORY;
-    PRTSTRCACHEINT pThis = (PRTSTRCACHEINT)RTMemAllocZ(sizeof(*pThis));
-    if (pThis)
+    pShard->cHashTab   = RTSTRCACHE_INITIAL_HASH_SIZE;
+    pShard->papHashTab = (PRTSTRCACHEENTRY*)RTMemAllocZ(sizeof(pShard->papHashTab[0]) * pShard->cHashTab);
+    if (pShard->papHashTab)
     {
-        pThis->cHashTab   = RTSTRCACHE_INITIAL_HASH_SIZE;
-        pThis->papHashTab = (PRTSTRCACHEENTRY*)RTMemAllocZ(sizeof(pThis->papHashTab[0]) * pThis->cHashTab);
-        if (pThis->papHashTab)
+        int rc = RTCritSectInit(&pShard->CritSect);
+        if (RT_SUCCESS(rc))
         {
-            rc = RTCritSectInit(&pThis->CritSect);
-            if (RT_SUCCESS(rc))
-            {
-                RTListInit(&pThis->BigEntryList);
+            RTListInit(&pShard->BigEntryList);
 #ifdef RTSTRCACHE_WITH_MERGED_ALLOCATOR
-                for (uint32_t i = 0; i < RT_ELEMENTS(pThis->aMergedFreeLists); i++)
-                    RTListInit(&pThis->aMergedFreeLists[i]);
+            for (uint32_t i = 0; i < RT_ELEMENTS(pShard->aMergedFreeLists); i++)
+                RTListInit(&pShard->aMergedFreeLists[i]);
 #endif
-                pThis->cRefs    = 1;
-                pThis->u32Magic = RTSTRCACHE_MAGIC;
-
-                *phStrCache = pThis;
-                return VINF_SUCCESS;
-            }
-            RTMemFree(pThis->papHashTab);
+            return VINF_SUCCESS;
         }
-        RTMemFree(pThis);
+        RTMemFree(pShard->papHashTab);
+        pShard->papHashTab = NULL;
+        return rc;
+    }
+    return VERR_NO_MEMORY;
+}
+
+
+/**
+ * Frees all the memory of a shard and deletes its critical section.
+ *
+ * @param   pShard              The shard.
+ */
+static void rtStrCacheShardDelete(PRTSTRCACHESHARD pShard)
+{
+    RTCritSectEnter(&pShard->CritSect);
+
+    PRTSTRCACHECHUNK pChunk;
+    while ((pChunk = pShard->pChunkList) != NULL)
+    {
+        pShard->pChunkList = pChunk->pNext;
+        RTMemPageFree(pChunk, pChunk->cb);
+    }
+
+    RTMemFree(pShard->papHashTab);
+    pShard->papHashTab = NULL;
+    pShard->cHashTab   = 0;
+    RTMemFree(pShard->papHashTabOld);
+    pShard->papHashTabOld   = NULL;
+    pShard->cHashTabOld     = 0;
+    pShard->cHashTabOldLeft = 0;
+
+    PRTSTRCACHEBIGENTRY pCur, pNext;
+    RTListForEachSafe(&pShard->BigEntryList, pCur, pNext, RTSTRCACHEBIGENTRY, ListEntry)
+    {
+        RTMemFree(pCur);
     }
 
+    RTCritSectLeave(&pShard->CritSect);
+    RTCritSectDelete(&pShard->CritSect);
+}
+
+
+RTDECL(int) RTStrCacheCreateEx(PRTSTRCACHE phStrCache, const char *pszName, uint32_t fFlags)
+{
+    AssertPtrReturn(phStrCache, VERR_INVALID_POINTER);
+    AssertReturn(!(fFlags & ~RTSTRCACHE_F_VALID_MASK), VERR_INVALID_FLAGS);
     RT_NOREF_PV(pszName);
+
+    uint32_t const cShards = fFlags & RTSTRCACHE_F_CONCURRENT ? RTSTRCACHE_CONCURRENT_SHARDS : 1;
+    AssertCompile(RT_IS_POWER_OF_TWO(RTSTRCACHE_CONCURRENT_SHARDS));
+    AssertCompile(RTSTRCACHE_CONCURRENT_SHARDS <= RTSTRCACHE_MAX_SHARDS);
+
+    PRTSTRCACHEINT pThis = (PRTSTRCACHEINT)RTMemAllocZ(RT_UOFFSETOF(RTSTRCACHEINT, aShards[cShards]));
+    if (!pThis)
+        return VERR_NO_MEMORY;
+
+    int rc = VINF_SUCCESS;
+    uint32_t iShard;
+    for (iShard = 0; iShard < cShards && RT_SUCCESS(rc); iShard++)
+        rc = rtStrCacheShardInit(&pThis->aShards[iShard].s);
+    if (RT_SUCCESS(rc))
+    {
+        pThis->cShards  = cShards;
+        pThis->cRefs    = 1;
+        pThis->u32Magic = RTSTRCACHE_MAGIC;
+
+        *phStrCache = pThis;
+        return VINF_SUCCESS;
+    }
+
+    /* The shard that failed cleaned up after itself. */
+    iShard--;
+    while (iShard-- > 0)
+        rtStrCacheShardDelete(&pThis->aShards[iShard].s);
+    RTMemFree(pThis);
     return rc;
 }
+RT_EXPORT_SYMBOL(RTStrCacheCreateEx);
+
+
+RTDECL(int) RTStrCacheCreate(PRTSTRCACHE phStrCache, const char *pszName)
+{
+    return RTStrCacheCreateEx(phStrCache, pszName, 0 /*fFlags*/);
+}
 RT_EXPORT_SYMBOL(RTStrCacheCreate);
 
 
@@ -365,31 +485,14 @@ RTDECL(int) RTStrCacheDestroy(RTSTRCACHE hStrCache)
     RTSTRCACHE_VALID_RETURN_RC(pThis, VERR_INVALID_HANDLE);
 
     /*
-     * Invalidate it. Enter the crit sect just to be on the safe side.
+     * Invalidate it and free the shards, entering each shard's crit sect just
+     * to be on the safe side.
      */
     AssertReturn(ASMAtomicCmpXchgU32(&pThis->u32Magic, RTSTRCACHE_MAGIC_DEAD, RTSTRCACHE_MAGIC), VERR_INVALID_HANDLE);
-    RTCritSectEnter(&pThis->CritSect);
     Assert(pThis->cRefs == 1);
 
-    PRTSTRCACHECHUNK pChunk;
-    while ((pChunk = pThis->pChunkList) != NULL)
-    {
-        pThis->pChunkList = pChunk->pNext;
-        RTMemPageFree(pChunk, pChunk->cb);
-    }
-
-    RTMemFree(pThis->papHashTab);
-    pThis->papHashTab = NULL;
-    pThis->cHashTab   = 0;
-
-    PRTSTRCACHEBIGENTRY pCur, pNext;
-    RTListForEachSafe(&pThis->BigEntryList, pCur, pNext, RTSTRCACHEBIGENTRY, ListEntry)
-    {
-        RTMemFree(pCur);
-    }
-
-    RTCritSectLeave(&pThis->CritSect);
-    RTCritSectDelete(&pThis->CritSect);
+    for (uint32_t iShard = 0; iShard < pThis->cShards; iShard++)
+        rtStrCacheShardDelete(&pThis->aShards[iShard].s);
 
     RTMemFree(pThis);
     return VINF_SUCCESS;
@@ -397,6 +500,62 @@ RTDECL(int) RTStrCacheDestroy(RTSTRCACHE hStrCache)
 RT_EXPORT_SYMBOL(RTStrCacheDestroy);
 
 
+/**
+ * Selects the shard for a string.
+ *
+ * The shard is taken from the top bits of the scrambled 16-bit hash, so that
+ * it doesn't correlate with the hash table index which is taken from the low
+ * bits.
+ *
+ * @returns Pointer to the shard.
+ * @param   pThis               The string cache instance.
+ * @param   uHash               The lower 16-bit of the string hash.
+ */
+DECLINLINE(PRTSTRCACHESHARD) rtStrCacheSelectShard(PRTSTRCACHEINT pThis, uint16_t uHash)
+{
+    uint32_t const iShard = ((uint16_t)(uHash * UINT16_C(0x9e37)) >> 12) & (pThis->cShards - 1);
+    return &pThis->aShards[iShard].s;
+}
+
+
+/**
+ * Gets the hash + length value used for the hash table of an entry.
+ *
+ * @returns Hash + length value.
+ * @param   pEntry              The string cache entry.
+ */
+DECLINLINE(uint32_t) rtStrCacheEntryHashLen(PRTSTRCACHEENTRY pEntry)
+{
+    uint32_t cchString = pEntry->cchString;
+    if (cchString == RTSTRCACHEENTRY_BIG_LEN)
+        cchString = RT_FROM_MEMBER(pEntry, RTSTRCACHEBIGENTRY, Core)->cchString;
+    return RT_MAKE_U32(pEntry->uHash, cchString);
+}
+
+
+/**
+ * Tries to retain an entry found by a lookup.
+ *
+ * RTStrCacheRelease drops the last reference before it takes the shard lock
+ * to unlink the entry, so a lookup may run into an entry that is about to be
+ * freed.  Such an entry must not be handed out again.
+ *
+ * @returns true if retained, false if the entry is dying.
+ * @param   pEntry              The string cache entry.
+ */
+DECLINLINE(bool) rtStrCacheEntryTryRetain(PRTSTRCACHEENTRY pEntry)
+{
+    uint32_t cRefs = ASMAtomicReadU32(&pEntry->cRefs);
+    while (cRefs > 0)
+    {
+        Assert(cRefs < UINT32_MAX / 2);
+        if (ASMAtomicCmpXchgExU32(&pEntry->cRefs, cRefs + 1, cRefs, &cRefs))
+            return true;
+    }
+    return false;
+}
+
+
 /**
  * Selects the fixed free list index for a given minimum entry size.
  *
@@ -414,17 +573,17 @@ DECLINLINE(uint32_t) rtStrCacheSelectFixedList(uint32_t cbMin)
 
 
 #ifdef RT_STRICT
-# define RTSTRCACHE_CHECK(a_pThis)  do { rtStrCacheCheck(pThis); } while (0)
+# define RTSTRCACHE_CHECK(a_pShard) do { rtStrCacheCheck(a_pShard); } while (0)
 /**
  * Internal cache check.
  */
-static void rtStrCacheCheck(PRTSTRCACHEINT pThis)
+static void rtStrCacheCheck(PRTSTRCACHESHARD pShard)
 {
 # ifdef RTSTRCACHE_WITH_MERGED_ALLOCATOR
-    for (uint32_t i = 0; i < RT_ELEMENTS(pThis->aMergedFreeLists); i++)
+    for (uint32_t i = 0; i < RT_ELEMENTS(pShard->aMergedFreeLists); i++)
     {
         PRTSTRCACHEFREEMERGE pFree;
-        RTListForEach(&pThis->aMergedFreeLists[i], pFree, RTSTRCACHEFREEMERGE, ListEntry)
+        RTListForEach(&pShard->aMergedFreeLists[i], pFree, RTSTRCACHEFREEMERGE, ListEntry)
         {
             Assert(pFree->uMarker == RTSTRCACHEFREEMERGE_MAIN);
             Assert(pFree->cbFree > 0);
@@ -432,10 +591,10 @@ static void rtStrCacheCheck(PRTSTRCACHEINT pThis)
         }
     }
 # endif
-    RT_NOREF_PV(pThis);
+    RT_NOREF_PV(pShard);
 }
 #else
-# define RTSTRCACHE_CHECK(a_pThis)  do { } while (0)
+# define RTSTRCACHE_CHECK(a_pShard) do { } while (0)
 #endif
 
 
@@ -445,80 +604,139 @@ static void rtStrCacheCheck(PRTSTRCACHEINT pThis)
  * ASSUMES that the hash table isn't full.
  *
  * @returns Hash table index.
- * @param   pThis               The string cache instance.
+ * @param   papHashTab          The hash table.
+ * @param   cHashTab            The hash table size.
  * @param   uHashLen            The hash + length (not RTSTRCACHEENTRY_BIG_LEN).
  */
-static uint32_t rtStrCacheFindEmptyHashTabEntry(PRTSTRCACHEINT pThis, uint32_t uHashLen)
+static uint32_t rtStrCacheFindEmptyHashTabEntry(PRTSTRCACHEENTRY *papHashTab, uint32_t cHashTab, uint32_t uHashLen)
 {
-    uint32_t iHash = uHashLen % pThis->cHashTab;
+    uint32_t iHash = uHashLen % cHashTab;
     for (;;)
     {
-        PRTSTRCACHEENTRY pEntry = pThis->papHashTab[iHash];
+        PRTSTRCACHEENTRY pEntry = papHashTab[iHash];
         if (pEntry == NULL || pEntry == PRTSTRCACHEENTRY_NIL)
             return iHash;
 
         /* Advance. */
         iHash += RTSTRCACHE_COLLISION_INCR(uHashLen);
-        iHash %= pThis->cHashTab;
+        iHash %= cHashTab;
     }
 }
 
+
 /**
- * Grows the hash table.
+ * Stores an entry in the current hash table.
  *
- * @returns vINF_SUCCESS or VERR_NO_MEMORY.
- * @param   pThis               The string cache instance.
+ * @param   pShard              The string cache shard.
+ * @param   iHash               The index returned by
+ *                              rtStrCacheFindEmptyHashTabEntry or the lookup.
+ * @param   pEntry              The entry.
  */
-static int rtStrCacheGrowHashTab(PRTSTRCACHEINT pThis)
+DECLINLINE(void) rtStrCacheHashTabInsert(PRTSTRCACHESHARD pShard, uint32_t iHash, PRTSTRCACHEENTRY pEntry)
 {
-    /*
-     * Allocate a new hash table two times the size of the old one.
-     */
-    uint32_t            cNew   = pThis->cHashTab * RTSTRCACHE_HASH_GROW_FACTOR;
-    PRTSTRCACHEENTRY   *papNew = (PRTSTRCACHEENTRY  *)RTMemAllocZ(sizeof(papNew[0]) * cNew);
-    if (papNew == NULL)
-        return VERR_NO_MEMORY;
+    PRTSTRCACHEENTRY pOld = pShard->papHashTab[iHash];
+    Assert(pOld == NULL || pOld == PRTSTRCACHEENTRY_NIL);
+    if (pOld == PRTSTRCACHEENTRY_NIL)
+    {
+        Assert(pShard->cHashTabNils > 0);
+        pShard->cHashTabNils--;
+    }
+    pShard->papHashTab[iHash] = pEntry;
+}
 
-    /*
-     * Install the new table and move the items from the old table and into the new one.
-     */
-    PRTSTRCACHEENTRY   *papOld = pThis->papHashTab;
-    uint32_t            iOld   = pThis->cHashTab;
 
-    pThis->papHashTab = papNew;
-    pThis->cHashTab   = cNew;
-    pThis->cRehashes++;
+/**
+ * Moves entries from the previous hash table over to the current one.
+ *
+ * Called with a small batch size on each enter while a resize is in progress,
+ * so the cost of a resize is spread out instead of stalling one caller (and
+ * everyone waiting on the shard lock) for a full rehash.
+ *
+ * @param   pShard              The string cache shard.
+ * @param   cMaxSlots           The max number of old hash table slots to
+ *                              process.
+ */
+static void rtStrCacheMigrateHashTab(PRTSTRCACHESHARD pShard, uint32_t cMaxSlots)
+{
+    PRTSTRCACHEENTRY   *papOld = pShard->papHashTabOld;
+    uint32_t            iOld   = pShard->cHashTabOldLeft;
+    Assert(papOld);
 
-    while (iOld-- > 0)
+    while (iOld > 0 && cMaxSlots-- > 0)
     {
+        iOld--;
         PRTSTRCACHEENTRY pEntry = papOld[iOld];
         if (pEntry != NULL && pEntry != PRTSTRCACHEENTRY_NIL)
         {
-            uint32_t cchString = pEntry->cchString;
-            if (cchString == RTSTRCACHEENTRY_BIG_LEN)
-                cchString = RT_FROM_MEMBER(pEntry, RTSTRCACHEBIGENTRY, Core)->cchString;
+            uint32_t iHash = rtStrCacheFindEmptyHashTabEntry(pShard->papHashTab, pShard->cHashTab,
+                                                             rtStrCacheEntryHashLen(pEntry));
+            rtStrCacheHashTabInsert(pShard, iHash, pEntry);
 
-            uint32_t iHash = rtStrCacheFindEmptyHashTabEntry(pThis, RT_MAKE_U32(pEntry->uHash, cchString));
-            pThis->papHashTab[iHash] = pEntry;
+            /* Leave a tombstone so lookups in the old table keep probing past it. */
+            papOld[iOld] = PRTSTRCACHEENTRY_NIL;
         }
     }
 
+    pShard->cHashTabOldLeft = iOld;
+    if (!iOld)
+    {
+        pShard->papHashTabOld = NULL;
+        pShard->cHashTabOld   = 0;
+        RTMemFree(papOld);
+    }
+}
+
+
+/**
+ * Grows the hash table, or rebuilds it at the same size if it's mostly
+ * clogged up by deleted entries.
+ *
+ * The entries are moved over incrementally by rtStrCacheMigrateHashTab.
+ *
+ * @returns vINF_SUCCESS or VERR_NO_MEMORY.
+ * @param   pShard              The string cache shard.
+ */
+static int rtStrCacheGrowHashTab(PRTSTRCACHESHARD pShard)
+{
+    /*
+     * Complete any previous resize first, we only keep one old table around.
+     */
+    if (pShard->papHashTabOld)
+        rtStrCacheMigrateHashTab(pShard, UINT32_MAX);
+
     /*
-     * Free the old hash table.
+     * Allocate a new hash table RTSTRCACHE_HASH_GROW_FACTOR times the size of
+     * the old one and install it, keeping the old one for lookups until all
+     * its entries have been moved.
      */
-    RTMemFree(papOld);
+    uint32_t            cNew   = pShard->cStrings < pShard->cHashTab / 4
+                               ? pShard->cHashTab
+                               : pShard->cHashTab * RTSTRCACHE_HASH_GROW_FACTOR;
+    PRTSTRCACHEENTRY   *papNew = (PRTSTRCACHEENTRY  *)RTMemAllocZ(sizeof(papNew[0]) * cNew);
+    if (papNew == NULL)
+        return VERR_NO_MEMORY;
+
+    pShard->papHashTabOld   = pShard->papHashTab;
+    pShard->cHashTabOld     = pShard->cHashTab;
+    pShard->cHashTabOldLeft = pShard->cHashTab;
+    pShard->papHashTab      = papNew;
+    pShard->cHashTab        = cNew;
+    pShard->cHashTabNils    = 0;
+    pShard->cRehashes++;
+
     return VINF_SUCCESS;
 }
 
+
 #ifdef RTSTRCACHE_WITH_MERGED_ALLOCATOR
 
 /**
  * Link/Relink into the free right list.
  *
- * @param   pThis               The string cache instance.
+ * @param   pShard              The string cache shard.
  * @param   pFree               The free string entry.
  */
-static void rtStrCacheRelinkMerged(PRTSTRCACHEINT pThis, PRTSTRCACHEFREEMERGE pFree)
+static void rtStrCacheRelinkMerged(PRTSTRCACHESHARD pShard, PRTSTRCACHEFREEMERGE pFree)
 {
     Assert(pFree->uMarker == RTSTRCACHEFREEMERGE_MAIN);
     Assert(pFree->cbFree > 0);
@@ -528,10 +746,10 @@ static void rtStrCacheRelinkMerged(PRTSTRCACHEINT pThis, PRTSTRCACHEFREEMERGE pF
         RTListNodeRemove(&pFree->ListEntry);
 
     uint32_t iList = (ASMBitLastSetU32(pFree->cbFree) - 1) - RTSTRCACHE_MERGED_THRESHOLD_BIT;
-    if (iList >= RT_ELEMENTS(pThis->aMergedFreeLists))
-        iList = RT_ELEMENTS(pThis->aMergedFreeLists) - 1;
+    if (iList >= RT_ELEMENTS(pShard->aMergedFreeLists))
+        iList = RT_ELEMENTS(pShard->aMergedFreeLists) - 1;
 
-    RTListPrepend(&pThis->aMergedFreeLists[iList], &pFree->ListEntry);
+    RTListPrepend(&pShard->aMergedFreeLists[iList], &pFree->ListEntry);
 }
 
 
@@ -539,13 +757,13 @@ static void rtStrCacheRelinkMerged(PRTSTRCACHEINT pThis, PRTSTRCACHEFREEMERGE pF
  * Allocate a cache entry from the merged free lists.
  *
  * @returns Pointer to the cache entry on success, NULL on allocation error.
- * @param   pThis               The string cache instance.
+ * @param   pShard              The string cache shard.
  * @param   uHash               The full hash of the string.
  * @param   pchString           The string.
  * @param   cchString           The string length.
  * @param   cbEntry             The required entry size.
  */
-static PRTSTRCACHEENTRY rtStrCacheAllocMergedEntry(PRTSTRCACHEINT pThis, uint32_t uHash,
+static PRTSTRCACHEENTRY rtStrCacheAllocMergedEntry(PRTSTRCACHESHARD pShard, uint32_t uHash,
                                                    const char *pchString, uint32_t cchString, uint32_t cbEntry)
 {
     cbEntry = RT_ALIGN_32(cbEntry, sizeof(RTSTRCACHEFREEMERGE));
@@ -561,9 +779,9 @@ static PRTSTRCACHEENTRY rtStrCacheAllocMergedEntry(PRTSTRCACHEINT pThis, uint32_
         iList++;
     iList -= RTSTRCACHE_MERGED_THRESHOLD_BIT;
 
-    while (iList < RT_ELEMENTS(pThis->aMergedFreeLists))
+    while (iList < RT_ELEMENTS(pShard->aMergedFreeLists))
     {
-        pFree = RTListGetFirst(&pThis->aMergedFreeLists[iList], RTSTRCACHEFREEMERGE, ListEntry);
+        pFree = RTListGetFirst(&pShard->aMergedFreeLists[iList], RTSTRCACHEFREEMERGE, ListEntry);
         if (pFree)
         {
             /*
@@ -585,7 +803,7 @@ static PRTSTRCACHEENTRY rtStrCacheAllocMergedEntry(PRTSTRCACHEINT pThis, uint32_
                 Assert((pRemainder->cbFree - cbEntry) == cRemainder * sizeof(*pFree));
                 pRemainder->cbFree = cRemainder * sizeof(*pFree);
 
-                rtStrCacheRelinkMerged(pThis, pRemainder);
+                rtStrCacheRelinkMerged(pShard, pRemainder);
             }
             break;
         }
@@ -602,9 +820,9 @@ static PRTSTRCACHEENTRY rtStrCacheAllocMergedEntry(PRTSTRCACHEINT pThis, uint32_
         if (!pChunk)
             return NULL;
         pChunk->cb    = cbChunk;
-        pChunk->pNext = pThis->pChunkList;
-        pThis->pChunkList = pChunk;
-        pThis->cbChunks  += cbChunk;
+        pChunk->pNext = pShard->pChunkList;
+        pShard->pChunkList = pChunk;
+        pShard->cbChunks  += cbChunk;
         AssertCompile(sizeof(*pChunk) <= sizeof(*pFree));
 
         /*
@@ -629,7 +847,7 @@ static PRTSTRCACHEENTRY rtStrCacheAllocMergedEntry(PRTSTRCACHEINT pThis, uint32_
             pNewFree[iInternalBlock].pMain   = pNewFree;
         }
 
-        rtStrCacheRelinkMerged(pThis, pNewFree);
+        rtStrCacheRelinkMerged(pShard, pNewFree);
     }
 
     /*
@@ -644,7 +862,7 @@ static PRTSTRCACHEENTRY rtStrCacheAllocMergedEntry(PRTSTRCACHEINT pThis, uint32_
     memcpy(pEntry->szString, pchString, cchString);
     RT_BZERO(&pEntry->szString[cchString], cbEntry - RT_UOFFSETOF(RTSTRCACHEENTRY, szString) - cchString);
 
-    RTSTRCACHE_CHECK(pThis);
+    RTSTRCACHE_CHECK(pShard);
 
     return pEntry;
 }
@@ -655,12 +873,12 @@ static PRTSTRCACHEENTRY rtStrCacheAllocMergedEntry(PRTSTRCACHEINT pThis, uint32_
  * Allocate a cache entry from the heap.
  *
  * @returns Pointer to the cache entry on success, NULL on allocation error.
- * @param   pThis               The string cache instance.
+ * @param   pShard              The string cache shard.
  * @param   uHash               The full hash of the string.
  * @param   pchString           The string.
  * @param   cchString           The string length.
  */
-static PRTSTRCACHEENTRY rtStrCacheAllocHeapEntry(PRTSTRCACHEINT pThis, uint32_t uHash,
+static PRTSTRCACHEENTRY rtStrCacheAllocHeapEntry(PRTSTRCACHESHARD pShard, uint32_t uHash,
                                                  const char *pchString, uint32_t cchString)
 {
     /*
@@ -675,8 +893,8 @@ static PRTSTRCACHEENTRY rtStrCacheAllocHeapEntry(PRTSTRCACHEINT pThis, uint32_t
     /*
      * Initialize the block.
      */
-    RTListAppend(&pThis->BigEntryList, &pBigEntry->ListEntry);
-    pThis->cbBigEntries        += cbEntry;
+    RTListAppend(&pShard->BigEntryList, &pBigEntry->ListEntry);
+    pShard->cbBigEntries        += cbEntry;
     pBigEntry->cchString        = cchString;
     pBigEntry->uHash            = uHash;
     pBigEntry->Core.cRefs       = 1;
@@ -693,29 +911,29 @@ static PRTSTRCACHEENTRY rtStrCacheAllocHeapEntry(PRTSTRCACHEINT pThis, uint32_t
  * Allocate a cache entry from a fixed size free list.
  *
  * @returns Pointer to the cache entry on success, NULL on allocation error.
- * @param   pThis               The string cache instance.
+ * @param   pShard              The string cache shard.
  * @param   uHash               The full hash of the string.
  * @param   pchString           The string.
  * @param   cchString           The string length.
  * @param   iFreeList           Which free list.
  */
-static PRTSTRCACHEENTRY rtStrCacheAllocFixedEntry(PRTSTRCACHEINT pThis, uint32_t uHash,
+static PRTSTRCACHEENTRY rtStrCacheAllocFixedEntry(PRTSTRCACHESHARD pShard, uint32_t uHash,
                                                   const char *pchString, uint32_t cchString, uint32_t iFreeList)
 {
     /*
      * Get an entry from the free list. If empty, allocate another chunk of
      * memory and split it up into free entries of the desired size.
      */
-    PRTSTRCACHEFREE pFree = pThis->apFreeLists[iFreeList];
+    PRTSTRCACHEFREE pFree = pShard->apFreeLists[iFreeList];
     if (!pFree)
     {
         PRTSTRCACHECHUNK pChunk = (PRTSTRCACHECHUNK)RTMemPageAlloc(RTSTRCACHE_FIXED_GROW_SIZE);
         if (!pChunk)
             return NULL;
         pChunk->cb = RTSTRCACHE_FIXED_GROW_SIZE;
-        pChunk->pNext = pThis->pChunkList;
-        pThis->pChunkList = pChunk;
-        pThis->cbChunks  += RTSTRCACHE_FIXED_GROW_SIZE;
+        pChunk->pNext = pShard->pChunkList;
+        pShard->pChunkList = pChunk;
+        pShard->cbChunks  += RTSTRCACHE_FIXED_GROW_SIZE;
 
         PRTSTRCACHEFREE pPrev   = NULL;
         uint32_t const  cbEntry = g_acbFixedLists[iFreeList];
@@ -736,13 +954,13 @@ static PRTSTRCACHEENTRY rtStrCacheAllocFixedEntry(PRTSTRCACHEINT pThis, uint32_t
         }
 
         Assert(pPrev);
-        pThis->apFreeLists[iFreeList] = pFree = pPrev;
+        pShard->apFreeLists[iFreeList] = pFree = pPrev;
     }
 
     /*
      * Unlink it.
      */
-    pThis->apFreeLists[iFreeList] = pFree->pNext;
+    pShard->apFreeLists[iFreeList] = pFree->pNext;
     ASMCompilerBarrier();
 
     /*
@@ -760,11 +978,12 @@ static PRTSTRCACHEENTRY rtStrCacheAllocFixedEntry(PRTSTRCACHEINT pThis, uint32_t
 
 
 /**
- * Looks up a string in the hash table.
+ * Looks up a string in a hash table.
  *
- * @returns Pointer to the string cache entry, NULL + piFreeHashTabEntry if not
- *          found.
- * @param   pThis               The string cache instance.
+ * @returns Pointer to the string cache entry with a reference added, NULL +
+ *          piFreeHashTabEntry if not found.
+ * @param   papHashTab          The hash table.
+ * @param   cHashTab            The hash table size.
  * @param   uHashLen            The hash + length (not RTSTRCACHEENTRY_BIG_LEN).
  * @param   cchString           The real length.
  * @param   pchString           The string.
@@ -773,18 +992,19 @@ static PRTSTRCACHEENTRY rtStrCacheAllocFixedEntry(PRTSTRCACHEINT pThis, uint32_t
  *                              rtStrCacheFindEmptyHashTabEntry would return).
  * @param   pcCollisions        Where to return a collision counter.
  */
-static PRTSTRCACHEENTRY rtStrCacheLookUp(PRTSTRCACHEINT pThis, uint32_t uHashLen, uint32_t cchString, const char *pchString,
-                                         uint32_t *piFreeHashTabEntry, uint32_t *pcCollisions)
+static PRTSTRCACHEENTRY rtStrCacheLookUpTab(PRTSTRCACHEENTRY *papHashTab, uint32_t cHashTab, uint32_t uHashLen,
+                                            uint32_t cchString, const char *pchString,
+                                            uint32_t *piFreeHashTabEntry, uint32_t *pcCollisions)
 {
     *piFreeHashTabEntry = UINT32_MAX;
     *pcCollisions = 0;
 
     uint16_t cchStringFirst = RT_UOFFSETOF(RTSTRCACHEENTRY, szString[cchString + 1]) < RTSTRCACHE_HEAP_THRESHOLD
                             ? (uint16_t)cchString : RTSTRCACHEENTRY_BIG_LEN;
-    uint32_t iHash          = uHashLen % pThis->cHashTab;
+    uint32_t iHash          = uHashLen % cHashTab;
     for (;;)
     {
-        PRTSTRCACHEENTRY pEntry = pThis->papHashTab[iHash];
+        PRTSTRCACHEENTRY pEntry = papHashTab[iHash];
 
         /* Give up if NULL, but record the index for insertion. */
         if (pEntry == NULL)
@@ -796,21 +1016,23 @@ static PRTSTRCACHEENTRY rtStrCacheLookUp(PRTSTRCACHEINT pThis, uint32_t uHashLen
 
         if (pEntry != PRTSTRCACHEENTRY_NIL)
         {
-            /* Compare. */
+            /* Compare.  Entries on their way out are skipped, a new one will be created. */
             if (   pEntry->uHash     == (uint16_t)uHashLen
                 && pEntry->cchString == cchStringFirst)
             {
                 if (pEntry->cchString != RTSTRCACHEENTRY_BIG_LEN)
                 {
                     if (   !memcmp(pEntry->szString, pchString, cchString)
-                        && pEntry->szString[cchString] == '\0')
+                        && pEntry->szString[cchString] == '\0'
+                        && rtStrCacheEntryTryRetain(pEntry))
                         return pEntry;
                 }
                 else
                 {
                     PRTSTRCACHEBIGENTRY pBigEntry = RT_FROM_MEMBER(pEntry, RTSTRCACHEBIGENTRY, Core);
                     if (   pBigEntry->cchString == cchString
-                        && !memcmp(pBigEntry->Core.szString, pchString, cchString))
+                        && !memcmp(pBigEntry->Core.szString, pchString, cchString)
+                        && rtStrCacheEntryTryRetain(&pBigEntry->Core))
                         return &pBigEntry->Core;
                 }
             }
@@ -824,17 +1046,45 @@ static PRTSTRCACHEENTRY rtStrCacheLookUp(PRTSTRCACHEINT pThis, uint32_t uHashLen
 
         /* Advance. */
         iHash += RTSTRCACHE_COLLISION_INCR(uHashLen);
-        iHash %= pThis->cHashTab;
+        iHash %= cHashTab;
     }
 }
 
 
+/**
+ * Looks up a string in the shard, taking any resize in progress into account.
+ *
+ * @returns Pointer to the string cache entry with a reference added, NULL +
+ *          piFreeHashTabEntry if not found.
+ * @param   pShard              The string cache shard.
+ * @param   uHashLen            The hash + length (not RTSTRCACHEENTRY_BIG_LEN).
+ * @param   cchString           The real length.
+ * @param   pchString           The string.
+ * @param   piFreeHashTabEntry  Where to store the insertion index into the
+ *                              current hash table if NULL is returned.
+ * @param   pcCollisions        Where to return a collision counter.
+ */
+static PRTSTRCACHEENTRY rtStrCacheLookUp(PRTSTRCACHESHARD pShard, uint32_t uHashLen, uint32_t cchString, const char *pchString,
+                                         uint32_t *piFreeHashTabEntry, uint32_t *pcCollisions)
+{
+    PRTSTRCACHEENTRY pEntry = rtStrCacheLookUpTab(pShard->papHashTab, pShard->cHashTab, uHashLen, cchString, pchString,
+                                                  piFreeHashTabEntry, pcCollisions);
+    if (!pEntry && pShard->papHashTabOld)
+    {
+        uint32_t iIgnored;
+        uint32_t cIgnored;
+        pEntry = rtStrCacheLookUpTab(pShard->papHashTabOld, pShard->cHashTabOld, uHashLen, cchString, pchString,
+                                     &iIgnored, &cIgnored);
+    }
+    return pEntry;
+}
+
+
 RTDECL(const char *) RTStrCacheEnterN(RTSTRCACHE hStrCache, const char *pchString, size_t cchString)
 {
     PRTSTRCACHEINT pThis = hStrCache;
     RTSTRCACHE_VALID_RETURN_RC(pThis, NULL);
 
-
     /*
      * Calculate the hash and figure the exact string length, then look for an existing entry.
      */
@@ -843,74 +1093,76 @@ RTDECL(const char *) RTStrCacheEnterN(RTSTRCACHE hStrCache, const char *pchStrin
     AssertReturn(cchString < _1G, NULL);
     uint32_t const cchString32 = (uint32_t)cchString;
 
-    RTCritSectEnter(&pThis->CritSect);
-    RTSTRCACHE_CHECK(pThis);
+    PRTSTRCACHESHARD pShard = rtStrCacheSelectShard(pThis, (uint16_t)uHash);
+    RTCritSectEnter(&pShard->CritSect);
+    RTSTRCACHE_CHECK(pShard);
 
     uint32_t cCollisions;
     uint32_t iFreeHashTabEntry;
-    PRTSTRCACHEENTRY pEntry = rtStrCacheLookUp(pThis, uHashLen, cchString32, pchString, &iFreeHashTabEntry, &cCollisions);
-    if (pEntry)
-    {
-        uint32_t cRefs = ASMAtomicIncU32(&pEntry->cRefs);
-        Assert(cRefs < UINT32_MAX / 2); NOREF(cRefs);
-    }
-    else
+    PRTSTRCACHEENTRY pEntry = rtStrCacheLookUp(pShard, uHashLen, cchString32, pchString, &iFreeHashTabEntry, &cCollisions);
+    if (!pEntry)
     {
         /*
          * Allocate a new entry.
          */
         uint32_t cbEntry = cchString32 + 1U + RT_UOFFSETOF(RTSTRCACHEENTRY, szString);
         if (cbEntry >= RTSTRCACHE_HEAP_THRESHOLD)
-            pEntry = rtStrCacheAllocHeapEntry(pThis, uHash, pchString, cchString32);
+            pEntry = rtStrCacheAllocHeapEntry(pShard, uHash, pchString, cchString32);
 #ifdef RTSTRCACHE_WITH_MERGED_ALLOCATOR
         else if (cbEntry >= RTSTRCACHE_MERGED_THRESHOLD_BIT)
-            pEntry = rtStrCacheAllocMergedEntry(pThis, uHash, pchString, cchString32, cbEntry);
+            pEntry = rtStrCacheAllocMergedEntry(pShard, uHash, pchString, cchString32, cbEntry);
 #endif
         else
-            pEntry = rtStrCacheAllocFixedEntry(pThis, uHash, pchString, cchString32,
+            pEntry = rtStrCacheAllocFixedEntry(pShard, uHash, pchString, cchString32,
                                                rtStrCacheSelectFixedList(cbEntry));
         if (!pEntry)
         {
-            RTSTRCACHE_CHECK(pThis);
-            RTCritSectLeave(&pThis->CritSect);
+            RTSTRCACHE_CHECK(pShard);
+            RTCritSectLeave(&pShard->CritSect);
             return NULL;
         }
 
         /*
          * Insert it into the hash table.
          */
-        if (pThis->cHashTab - pThis->cStrings < pThis->cHashTab / 2)
+        if (pShard->cHashTab - pShard->cStrings - pShard->cHashTabNils < pShard->cHashTab / 2)
         {
-            int rc = rtStrCacheGrowHashTab(pThis);
+            int rc = rtStrCacheGrowHashTab(pShard);
             if (RT_SUCCESS(rc))
-                iFreeHashTabEntry = rtStrCacheFindEmptyHashTabEntry(pThis, uHashLen);
-            else if (pThis->cHashTab - pThis->cStrings <= pThis->cHashTab / 8) /* 12.5% full => error */
+                iFreeHashTabEntry = rtStrCacheFindEmptyHashTabEntry(pShard->papHashTab, pShard->cHashTab, uHashLen);
+            else if (pShard->cHashTab - pShard->cStrings - pShard->cHashTabNils <= pShard->cHashTab / 8) /* 12.5% full => error */
             {
-                pThis->papHashTab[iFreeHashTabEntry] = pEntry;
-                pThis->cStrings++;
-                pThis->cHashInserts++;
-                pThis->cHashCollisions += cCollisions > 0;
-                pThis->cHashCollisions2 += cCollisions > 1;
-                pThis->cbStrings += cchString32 + 1;
+                rtStrCacheHashTabInsert(pShard, iFreeHashTabEntry, pEntry);
+                pShard->cStrings++;
+                pShard->cHashInserts++;
+                pShard->cHashCollisions += cCollisions > 0;
+                pShard->cHashCollisions2 += cCollisions > 1;
+                pShard->cbStrings += cchString32 + 1;
                 RTStrCacheRelease(hStrCache, pEntry->szString);
 
-                RTSTRCACHE_CHECK(pThis);
-                RTCritSectLeave(&pThis->CritSect);
+                RTSTRCACHE_CHECK(pShard);
+                RTCritSectLeave(&pShard->CritSect);
                 return NULL;
             }
         }
 
-        pThis->papHashTab[iFreeHashTabEntry] = pEntry;
-        pThis->cStrings++;
-        pThis->cHashInserts++;
-        pThis->cHashCollisions += cCollisions > 0;
-        pThis->cHashCollisions2 += cCollisions > 1;
-        pThis->cbStrings += cchString32 + 1;
-        Assert(pThis->cStrings < pThis->cHashTab && pThis->cStrings > 0);
+        rtStrCacheHashTabInsert(pShard, iFreeHashTabEntry, pEntry);
+        pShard->cStrings++;
+        pShard->cHashInserts++;
+        pShard->cHashCollisions += cCollisions > 0;
+        pShard->cHashCollisions2 += cCollisions > 1;
+        pShard->cbStrings += cchString32 + 1;
+        Assert(pShard->cStrings + pShard->cHashTabNils < pShard->cHashTab && pShard->cStrings > 0);
     }
 
-    RTSTRCACHE_CHECK(pThis);
-    RTCritSectLeave(&pThis->CritSect);
+    /*
+     * Do a bit of work on any resize in progress.
+     */
+    if (pShard->papHashTabOld)
+        rtStrCacheMigrateHashTab(pShard, RTSTRCACHE_HASH_MIGRATE_BATCH);
+
+    RTSTRCACHE_CHECK(pShard);
+    RTCritSectLeave(&pShard->CritSect);
     return pEntry->szString;
 }
 RT_EXPORT_SYMBOL(RTStrCacheEnterN);
@@ -988,43 +1240,58 @@ RTDECL(uint32_t) RTStrCacheRetain(const char *psz)
 RT_EXPORT_SYMBOL(RTStrCacheRetain);
 
 
+/**
+ * Removes an entry from a hash table.
+ *
+ * @returns true if found and removed, false if not found.
+ * @param   papHashTab          The hash table.
+ * @param   cHashTab            The hash table size.
+ * @param   uHashLen            The hash + length of the entry.
+ * @param   pStr                The entry to remove.
+ */
+static bool rtStrCacheRemoveFromHashTab(PRTSTRCACHEENTRY *papHashTab, uint32_t cHashTab, uint32_t uHashLen,
+                                        PRTSTRCACHEENTRY pStr)
+{
+    uint32_t iHash = uHashLen % cHashTab;
+    for (uint32_t cLeft = cHashTab; cLeft > 0; cLeft--)
+    {
+        PRTSTRCACHEENTRY pEntry = papHashTab[iHash];
+        if (pEntry == pStr)
+        {
+            papHashTab[iHash] = PRTSTRCACHEENTRY_NIL;
+            return true;
+        }
+        if (pEntry == NULL)
+            break;
+
+        iHash += RTSTRCACHE_COLLISION_INCR(uHashLen);
+        iHash %= cHashTab;
+    }
+    return false;
+}
+
+
 static uint32_t rtStrCacheFreeEntry(PRTSTRCACHEINT pThis, PRTSTRCACHEENTRY pStr)
 {
-    RTCritSectEnter(&pThis->CritSect);
-    RTSTRCACHE_CHECK(pThis);
+    PRTSTRCACHESHARD pShard = rtStrCacheSelectShard(pThis, pStr->uHash);
+    RTCritSectEnter(&pShard->CritSect);
+    RTSTRCACHE_CHECK(pShard);
+    Assert(!pStr->cRefs);
 
-    /* Remove it from the hash table. */
+    /* Remove it from the hash table, it may still be in the old one if a resize is in progress. */
     uint32_t cchString = pStr->cchString == RTSTRCACHEENTRY_BIG_LEN
                        ? RT_FROM_MEMBER(pStr, RTSTRCACHEBIGENTRY, Core)->cchString
                        : pStr->cchString;
     uint32_t uHashLen  = RT_MAKE_U32(pStr->uHash, cchString);
-    uint32_t iHash     = uHashLen % pThis->cHashTab;
-    if (pThis->papHashTab[iHash] == pStr)
-        pThis->papHashTab[iHash] = PRTSTRCACHEENTRY_NIL;
-    else
-    {
-        do
-        {
-            AssertBreak(pThis->papHashTab[iHash] != NULL);
-            iHash += RTSTRCACHE_COLLISION_INCR(uHashLen);
-            iHash %= pThis->cHashTab;
-        } while (pThis->papHashTab[iHash] != pStr);
-        if (RT_LIKELY(pThis->papHashTab[iHash] == pStr))
-            pThis->papHashTab[iHash] = PRTSTRCACHEENTRY_NIL;
-        else
-        {
-            AssertFailed();
-            iHash = pThis->cHashTab;
-            while (iHash-- > 0)
-                if (pThis->papHashTab[iHash] == pStr)
-                    break;
-            AssertMsgFailed(("iHash=%u cHashTab=%u\n", iHash, pThis->cHashTab));
-        }
-    }
+    if (rtStrCacheRemoveFromHashTab(pShard->papHashTab, pShard->cHashTab, uHashLen, pStr))
+        pShard->cHashTabNils++;
+    else if (   !pShard->papHashTabOld
+             || !rtStrCacheRemoveFromHashTab(pShard->papHashTabOld, pShard->cHashTabOld, uHashLen, pStr))
+        AssertMsgFailed(("pStr=%p uHashLen=%#x cHashTab=%u cHashTabOld=%u\n", pStr, uHashLen, pShard->cHashTab, pShard->cHashTabOld));
 
-    pThis->cStrings--;
-    pThis->cbStrings -= cchString;
-    Assert(pThis->cStrings < pThis->cHashTab);
+    pShard->cStrings--;
+    pShard->cbStrings -= cchString + 1;
+    Assert(pShard->cStrings < pShard->cHashTab);
 
     /* Free it. */
     if (pStr->cchString != RTSTRCACHEENTRY_BIG_LEN)
@@ -1042,8 +1309,8 @@ static uint32_t rtStrCacheFreeEntry(PRTSTRCACHEINT pThis, PRTSTRCACHEENTRY pStr)
             PRTSTRCACHEFREE pFreeStr = (PRTSTRCACHEFREE)pStr;
             pFreeStr->cbFree   = cbMin;
             pFreeStr->uZero    = 0;
-            pFreeStr->pNext    = pThis->apFreeLists[iFreeList];
-            pThis->apFreeLists[iFreeList] = pFreeStr;
+            pFreeStr->pNext    = pShard->apFreeLists[iFreeList];
+            pShard->apFreeLists[iFreeList] = pFreeStr;
         }
 #ifdef RTSTRCACHE_WITH_MERGED_ALLOCATOR
         else
@@ -1122,22 +1389,22 @@ static uint32_t rtStrCacheFreeEntry(PRTSTRCACHEINT pThis, PRTSTRCACHEENTRY pStr)
             /*
              * Add/relink into the appropriate free list.
              */
-            rtStrCacheRelinkMerged(pThis, pMain);
+            rtStrCacheRelinkMerged(pShard, pMain);
         }
 #endif /* RTSTRCACHE_WITH_MERGED_ALLOCATOR */
-        RTSTRCACHE_CHECK(pThis);
-        RTCritSectLeave(&pThis->CritSect);
+        RTSTRCACHE_CHECK(pShard);
+        RTCritSectLeave(&pShard->CritSect);
     }
     else
     {
         /* Big string. */
         PRTSTRCACHEBIGENTRY pBigStr = RT_FROM_MEMBER(pStr, RTSTRCACHEBIGENTRY, Core);
         RTListNodeRemove(&pBigStr->ListEntry);
-        pThis->cbBigEntries -= RT_ALIGN_32(RT_UOFFSETOF(RTSTRCACHEBIGENTRY, Core.szString[cchString + 1]),
+        pShard->cbBigEntries -= RT_ALIGN_32(RT_UOFFSETOF(RTSTRCACHEBIGENTRY, Core.szString[cchString + 1]),
                                            RTSTRCACHE_HEAP_ENTRY_SIZE_ALIGN);
 
-        RTSTRCACHE_CHECK(pThis);
-        RTCritSectLeave(&pThis->CritSect);
+        RTSTRCACHE_CHECK(pShard);
+        RTCritSectLeave(&pShard->CritSect);
 
         RTMemFree(pBigStr);
     }
@@ -1202,26 +1469,44 @@ RTDECL(uint32_t) RTStrCacheGetStats(RTSTRCACHE hStrCache, size_t *pcbStrings, si
     PRTSTRCACHEINT pThis = hStrCache;
     RTSTRCACHE_VALID_RETURN_RC(pThis, UINT32_MAX);
 
-    RTCritSectEnter(&pThis->CritSect);
+    size_t   cbStrings        = 0;
+    size_t   cbChunks         = 0;
+    size_t   cbBigEntries     = 0;
+    uint32_t cHashCollisions  = 0;
+    uint32_t cHashCollisions2 = 0;
+    uint32_t cHashInserts     = 0;
+    uint32_t cRehashes        = 0;
+    uint32_t cStrings         = 0;
+    for (uint32_t iShard = 0; iShard < pThis->cShards; iShard++)
+    {
+        PRTSTRCACHESHARD pShard = &pThis->aShards[iShard].s;
+        RTCritSectEnter(&pShard->CritSect);
+        cbStrings        += pShard->cbStrings;
+        cbChunks         += pShard->cbChunks;
+        cbBigEntries     += pShard->cbBigEntries;
+        cHashCollisions  += pShard->cHashCollisions;
+        cHashCollisions2 += pShard->cHashCollisions2;
+        cHashInserts     += pShard->cHashInserts;
+        cRehashes        += pShard->cRehashes;
+        cStrings         += pShard->cStrings;
+        RTCritSectLeave(&pShard->CritSect);
+    }
 
     if (pcbStrings)
-        *pcbStrings         = pThis->cbStrings;
+        *pcbStrings         = cbStrings;
     if (pcbChunks)
-        *pcbChunks          = pThis->cbChunks;
+        *pcbChunks          = cbChunks;
     if (pcbBigEntries)
-        *pcbBigEntries      = pThis->cbBigEntries;
+        *pcbBigEntries      = cbBigEntries;
     if (pcHashCollisions)
-        *pcHashCollisions   = pThis->cHashCollisions;
+        *pcHashCollisions   = cHashCollisions;
     if (pcHashCollisions2)
-        *pcHashCollisions2  = pThis->cHashCollisions2;
+        *pcHashCollisions2  = cHashCollisions2;
     if (pcHashInserts)
-        *pcHashInserts      = pThis->cHashInserts;
+        *pcHashInserts      = cHashInserts;
     if (pcRehashes)
-        *pcRehashes         = pThis->cRehashes;
-    uint32_t cStrings       = pThis->cStrings;
-
-    RTCritSectLeave(&pThis->CritSect);
+        *pcRehashes         = cRehashes;
     return cStrings;
 }
-RT_EXPORT_SYMBOL(RTStrCacheRelease);
+RT_EXPORT_SYMBOL(RTStrCacheGetStats);
 
@@ -0,0 +1,669 @@
+/* $Id$ */
+/** @file
+ * IPRT - B+Tree range map template.
+ */
+
+/*
+ * Copyright (C) 2016 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ *
+ * The contents of this file may alternatively be used under the terms
+ * of the Common Development and Distribution License Version 1.0
+ * (CDDL) only, as it comes in the "COPYING.CDDL" file of the
+ * VirtualBox OSE distribution, in which case the provisions of the
+ * CDDL are applicable instead of those of the GPL.
+ *
+ * You may elect to license modified versions of this file under the
+ * terms and conditions of either the GPL or the CDDL or both.
+ */
+
+/** @page   pg_rt_btree_template   B+Tree Template configuration.
+ * @internal
+ *
+ *  This template implements B+tree range maps for different key types.
+ *
+ *  \#define KBT_FN(a)
+ *  Use this to alter the names of the functions.  Must be defined.
+ *
+ *  \#define KBTKEY, KBTNODECORE, PKBTNODECORE, KBTTREE, PKBTTREE, PKBTCALLBACK
+ *  The public types.  KBTKEY must be an unsigned integer type and KBTNODECORE
+ *  must have Key and KeyLast members.  Must be defined.
+ *
+ *  \#define KBTLEAF, KBTINNER, KBTPATH
+ *  Names for the internal node and path types.  Must be defined.
+ *
+ *  \#define KBT_DECL(a_Type)
+ *  The function declaration, RTDECL by default.
+ *
+ *  The tree is a B+tree: the internal nodes only hold separator keys, and the
+ *  user nodes are all referenced from the leaves, which are linked together
+ *  in key order.  The keys in child i of an internal node are in the range
+ *  [aKeys[i - 1], aKeys[i]).  Separators are not updated when the smallest
+ *  key of a leaf is removed, so the predecessor of a key may be the last
+ *  entry of the previous leaf.
+ *
+ *  The nodes are sized to four cache lines on 64-bit hosts and the keys are
+ *  kept in a separate array from the pointers, so the search of a node scans
+ *  two cache lines of keys.
+ */
+
+#ifndef ___btree_Base_cpp_h
+#define ___btree_Base_cpp_h
+
+
+/*********************************************************************************************************************************
+*   Defined Constants And Macros                                                                                                 *
+*********************************************************************************************************************************/
+/** @def KBT_DECL
+ * Function declaration macro in the RTDECL tradition.
+ * @param   a_Type      The function return type.  */
+#ifndef KBT_DECL
+# define KBT_DECL(a_Type)   RTDECL(a_Type)
+#endif
+
+/** The number of entries in a leaf node. */
+#define KBT_LEAF_KEYS       14
+/** The minimum number of entries in a non-root leaf node. */
+#define KBT_LEAF_MIN        (KBT_LEAF_KEYS / 2)
+/** The number of separator keys in an internal node. */
+#define KBT_INNER_KEYS      15
+/** The minimum number of separator keys in a non-root internal node. */
+#define KBT_INNER_MIN       (KBT_INNER_KEYS / 2)
+/** The max tree depth.  With a minimum fan-out of 8 this is plenty for
+ *  2^32 entries. */
+#define KBT_MAX_DEPTH       16
+
+
+/*********************************************************************************************************************************
+*   Structures and Typedefs                                                                                                      *
+*********************************************************************************************************************************/
+/**
+ * Leaf node.
+ */
+typedef struct KBTLEAF
+{
+    /** The number of entries. */
+    uint32_t            cKeys;
+    uint32_t            u32Padding;
+    /** The previous leaf in key order. */
+    struct KBTLEAF     *pPrev;
+    /** The next leaf in key order. */
+    struct KBTLEAF     *pNext;
+    /** The start keys of the entries, sorted. */
+    KBTKEY              aKeys[KBT_LEAF_KEYS];
+    /** The user nodes. */
+    PKBTNODECORE        apNodes[KBT_LEAF_KEYS];
+} KBTLEAF;
+
+/**
+ * Internal node.
+ */
+typedef struct KBTINNER
+{
+    /** The number of separator keys; there is one child more than this. */
+    uint32_t            cKeys;
+    uint32_t            u32Padding;
+    /** The separator keys, sorted. */
+    KBTKEY              aKeys[KBT_INNER_KEYS];
+    /** The child nodes, KBTINNER or KBTLEAF depending on the level. */
+    void               *apvChildren[KBT_INNER_KEYS + 1];
+} KBTINNER;
+
+/**
+ * The internal nodes passed on the way down to a leaf.
+ */
+typedef struct KBTPATH
+{
+    /** The number of internal nodes (tree depth - 1). */
+    uint32_t            cInner;
+    /** The internal nodes, root first. */
+    KBTINNER           *apInner[KBT_MAX_DEPTH];
+    /** The child index taken in each internal node. */
+    uint32_t            aiChild[KBT_MAX_DEPTH];
+} KBTPATH;
+
+
+/**
+ * Counts the keys in a sorted key array which are less than or equal to @a Key.
+ */
+DECLINLINE(uint32_t) KBT_FN(SearchKeys)(KBTKEY const *paKeys, uint32_t cKeys, KBTKEY Key)
+{
+    uint32_t i = 0;
+    while (i < cKeys && paKeys[i] <= Key)
+        i++;
+    return i;
+}
+
+
+/**
+ * Descends to the leaf which would hold @a Key.
+ *
+ * @returns The leaf node.
+ * @param   pTree       The tree, must not be empty.
+ * @param   Key         The key.
+ * @param   pPath       Where to record the path, optional.
+ */
+static KBTLEAF *KBT_FN(Descend)(PKBTTREE pTree, KBTKEY Key, KBTPATH *pPath)
+{
+    void    *pvNode = pTree->pvRoot;
+    uint32_t cInner = pTree->cDepth - 1;
+    for (uint32_t iLevel = 0; iLevel < cInner; iLevel++)
+    {
+        KBTINNER *pInner = (KBTINNER *)pvNode;
+        uint32_t  i      = KBT_FN(SearchKeys)(pInner->aKeys, pInner->cKeys, Key);
+        if (pPath)
+        {
+            pPath->apInner[iLevel] = pInner;
+            pPath->aiChild[iLevel] = i;
+        }
+        pvNode = pInner->apvChildren[i];
+    }
+    if (pPath)
+        pPath->cInner = cInner;
+    return (KBTLEAF *)pvNode;
+}
+
+
+/**
+ * Gets the first or last leaf of the tree.
+ */
+static KBTLEAF *KBT_FN(EdgeLeaf)(PKBTTREE pTree, bool fFirst)
+{
+    void *pvNode = pTree->pvRoot;
+    for (uint32_t iLevel = 1; iLevel < pTree->cDepth; iLevel++)
+    {
+        KBTINNER *pInner = (KBTINNER *)pvNode;
+        pvNode = pInner->apvChildren[fFirst ? 0 : pInner->cKeys];
+    }
+    return (KBTLEAF *)pvNode;
+}
+
+
+/**
+ * Finds the entry with the largest start key less than or equal to @a Key.
+ */
+static PKBTNODECORE KBT_FN(Predecessor)(PKBTTREE pTree, KBTKEY Key)
+{
+    if (!pTree->pvRoot)
+        return NULL;
+    KBTLEAF *pLeaf = KBT_FN(Descend)(pTree, Key, NULL);
+    uint32_t i     = KBT_FN(SearchKeys)(pLeaf->aKeys, pLeaf->cKeys, Key);
+    if (i > 0)
+        return pLeaf->apNodes[i - 1];
+    if (pLeaf->pPrev)
+        return pLeaf->pPrev->apNodes[pLeaf->pPrev->cKeys - 1];
+    return NULL;
+}
+
+
+/**
+ * Recursively frees a subtree.
+ */
+static void KBT_FN(FreeSubtree)(void *pvNode, uint32_t cLevels)
+{
+    if (cLevels > 1)
+    {
+        KBTINNER *pInner = (KBTINNER *)pvNode;
+        for (uint32_t i = 0; i <= pInner->cKeys; i++)
+            KBT_FN(FreeSubtree)(pInner->apvChildren[i], cLevels - 1);
+    }
+    RTMemFree(pvNode);
+}
+
+
+KBT_DECL(int) KBT_FN(Insert)(PKBTTREE pTree, PKBTNODECORE pNode)
+{
+    KBTKEY const Key = pNode->Key;
+    AssertReturn(Key <= pNode->KeyLast, VERR_INVALID_PARAMETER);
+
+    /*
+     * Empty tree.
+     */
+    if (!pTree->pvRoot)
+    {
+        KBTLEAF *pLeaf = (KBTLEAF *)RTMemAlloc(sizeof(*pLeaf));
+        if (!pLeaf)
+            return VERR_NO_MEMORY;
+        pLeaf->cKeys      = 1;
+        pLeaf->pPrev      = NULL;
+        pLeaf->pNext      = NULL;
+        pLeaf->aKeys[0]   = Key;
+        pLeaf->apNodes[0] = pNode;
+        pTree->pvRoot     = pLeaf;
+        pTree->cDepth     = 1;
+        pTree->cEntries   = 1;
+        return VINF_SUCCESS;
+    }
+
+    /*
+     * Find the leaf and check that the range doesn't overlap its neighbours.
+     */
+    KBTPATH  Path;
+    KBTLEAF *pLeaf = KBT_FN(Descend)(pTree, Key, &Path);
+    uint32_t i     = KBT_FN(SearchKeys)(pLeaf->aKeys, pLeaf->cKeys, Key);
+
+    PKBTNODECORE pNeighbour = i > 0        ? pLeaf->apNodes[i - 1]
+                            : pLeaf->pPrev ? pLeaf->pPrev->apNodes[pLeaf->pPrev->cKeys - 1] : NULL;
+    if (pNeighbour && pNeighbour->KeyLast >= Key)
+        return VERR_ALREADY_EXISTS;
+    pNeighbour = i < pLeaf->cKeys ? pLeaf->apNodes[i]
+               : pLeaf->pNext     ? pLeaf->pNext->apNodes[0] : NULL;
+    if (pNeighbour && pNeighbour->Key <= pNode->KeyLast)
+        return VERR_ALREADY_EXISTS;
+
+    /*
+     * Allocate the nodes needed for splitting up front, so we don't have to
+     * back out half way through.
+     */
+    void    *apvNew[KBT_MAX_DEPTH + 1];
+    uint32_t cNew = 0;
+    if (pLeaf->cKeys == KBT_LEAF_KEYS)
+    {
+        uint32_t cInnerNew = 1; /* Assume the root gets split. */
+        for (uint32_t iLevel = Path.cInner; iLevel-- > 0;)
+        {
+            if (Path.apInner[iLevel]->cKeys < KBT_INNER_KEYS)
+            {
+                cInnerNew--;
+                break;
+            }
+            cInnerNew++;
+        }
+        Assert(pTree->cDepth + (cInnerNew > Path.cInner) <= KBT_MAX_DEPTH);
+
+        apvNew[cNew++] = RTMemAlloc(sizeof(KBTLEAF));
+        while (cInnerNew-- > 0)
+            apvNew[cNew++] = RTMemAlloc(sizeof(KBTINNER));
+        for (uint32_t iNew = 0; iNew < cNew; iNew++)
+            if (!apvNew[iNew])
+            {
+                for (iNew = 0; iNew < cNew; iNew++)
+                    RTMemFree(apvNew[iNew]);
+                return VERR_NO_MEMORY;
+            }
+    }
+
+    /*
+     * Insert into the leaf, splitting it in two halves if it's full.
+     */
+    if (pLeaf->cKeys < KBT_LEAF_KEYS)
+    {
+        memmove(&pLeaf->aKeys[i + 1],   &pLeaf->aKeys[i],   (pLeaf->cKeys - i) * sizeof(pLeaf->aKeys[0]));
+        memmove(&pLeaf->apNodes[i + 1], &pLeaf->apNodes[i], (pLeaf->cKeys - i) * sizeof(pLeaf->apNodes[0]));
+        pLeaf->aKeys[i]   = Key;
+        pLeaf->apNodes[i] = pNode;
+        pLeaf->cKeys++;
+        pTree->cEntries++;
+        return VINF_SUCCESS;
+    }
+
+    uint32_t iNew   = 0;
+    KBTLEAF *pRight = (KBTLEAF *)apvNew[iNew++];
+    pRight->cKeys = KBT_LEAF_KEYS - KBT_LEAF_MIN;
+    memcpy(pRight->aKeys,   &pLeaf->aKeys[KBT_LEAF_MIN],   pRight->cKeys * sizeof(pLeaf->aKeys[0]));
+    memcpy(pRight->apNodes, &pLeaf->apNodes[KBT_LEAF_MIN], pRight->cKeys * sizeof(pLeaf->apNodes[0]));
+    pLeaf->cKeys  = KBT_LEAF_MIN;
+    pRight->pPrev = pLeaf;
+    pRight->pNext = pLeaf->pNext;
+    if (pLeaf->pNext)
+        pLeaf->pNext->pPrev = pRight;
+    pLeaf->pNext  = pRight;
+
+    KBTLEAF *pTarget = pLeaf;
+    if (i > KBT_LEAF_MIN)
+    {
+        pTarget = pRight;
+        i -= KBT_LEAF_MIN;
+    }
+    memmove(&pTarget->aKeys[i + 1],   &pTarget->aKeys[i],   (pTarget->cKeys - i) * sizeof(pTarget->aKeys[0]));
+    memmove(&pTarget->apNodes[i + 1], &pTarget->apNodes[i], (pTarget->cKeys - i) * sizeof(pTarget->apNodes[0]));
+    pTarget->aKeys[i]   = Key;
+    pTarget->apNodes[i] = pNode;
+    pTarget->cKeys++;
+    pTree->cEntries++;
+
+    /*
+     * Insert the separator and new node into the parents, splitting as we go.
+     */
+    KBTKEY KeySep   = pRight->aKeys[0];
+    void  *pvChild  = pRight;
+    for (uint32_t iLevel = Path.cInner; iLevel-- > 0;)
+    {
+        KBTINNER *pInner = Path.apInner[iLevel];
+        uint32_t  iChild = Path.aiChild[iLevel];
+        if (pInner->cKeys == KBT_INNER_KEYS)
+        {
+            /* Split: the left half keeps KBT_INNER_MIN keys, the next key
+               moves up and the rest goes to the right half. */
+            KBTINNER *pInnerRight = (KBTINNER *)apvNew[iNew++];
+            KBTKEY const KeyUp = pInner->aKeys[KBT_INNER_MIN];
+            pInnerRight->cKeys = KBT_INNER_KEYS - KBT_INNER_MIN - 1;
+            memcpy(pInnerRight->aKeys, &pInner->aKeys[KBT_INNER_MIN + 1], pInnerRight->cKeys * sizeof(pInner->aKeys[0]));
+            memcpy(pInnerRight->apvChildren, &pInner->apvChildren[KBT_INNER_MIN + 1],
+                   (pInnerRight->cKeys + 1) * sizeof(pInner->apvChildren[0]));
+            pInner->cKeys = KBT_INNER_MIN;
+
+            KBTINNER *pInnerTarget = pInner;
+            if (iChild > KBT_INNER_MIN)
+            {
+                pInnerTarget = pInnerRight;
+                iChild -= KBT_INNER_MIN + 1;
+            }
+            memmove(&pInnerTarget->aKeys[iChild + 1], &pInnerTarget->aKeys[iChild],
+                    (pInnerTarget->cKeys - iChild) * sizeof(pInnerTarget->aKeys[0]));
+            memmove(&pInnerTarget->apvChildren[iChild + 2], &pInnerTarget->apvChildren[iChild + 1],
+                    (pInnerTarget->cKeys - iChild) * sizeof(pInnerTarget->apvChildren[0]));
+            pInnerTarget->aKeys[iChild]           = KeySep;
+            pInnerTarget->apvChildren[iChild + 1] = pvChild;
+            pInnerTarget->cKeys++;
+
+            KeySep  = KeyUp;
+            pvChild = pInnerRight;
+        }
+        else
+        {
+            memmove(&pInner->aKeys[iChild + 1], &pInner->aKeys[iChild],
+                    (pInner->cKeys - iChild) * sizeof(pInner->aKeys[0]));
+            memmove(&pInner->apvChildren[iChild + 2], &pInner->apvChildren[iChild + 1],
+                    (pInner->cKeys - iChild) * sizeof(pInner->apvChildren[0]));
+            pInner->aKeys[iChild]           = KeySep;
+            pInner->apvChildren[iChild + 1] = pvChild;
+            pInner->cKeys++;
+            Assert(iNew == cNew);
+            return VINF_SUCCESS;
+        }
+    }
+
+    /*
+     * The root was split, add a new one on top.
+     */
+    KBTINNER *pRoot = (KBTINNER *)apvNew[iNew++];
+    Assert(iNew == cNew);
+    pRoot->cKeys          = 1;
+    pRoot->aKeys[0]       = KeySep;
+    pRoot->apvChildren[0] = pTree->pvRoot;
+    pRoot->apvChildren[1] = pvChild;
+    pTree->pvRoot = pRoot;
+    pTree->cDepth++;
+    return VINF_SUCCESS;
+}
+
+
+KBT_DECL(PKBTNODECORE) KBT_FN(Remove)(PKBTTREE pTree, KBTKEY Key)
+{
+    if (!pTree->pvRoot)
+        return NULL;
+
+    KBTPATH  Path;
+    KBTLEAF *pLeaf = KBT_FN(Descend)(pTree, Key, &Path);
+    uint32_t i     = KBT_FN(SearchKeys)(pLeaf->aKeys, pLeaf->cKeys, Key);
+    if (i == 0 || pLeaf->aKeys[i - 1] != Key)
+        return NULL;
+    i--;
+
+    /*
+     * Remove the entry from the leaf.
+     */
+    PKBTNODECORE pNode = pLeaf->apNodes[i];
+    pLeaf->cKeys--;
+    memmove(&pLeaf->aKeys[i],   &pLeaf->aKeys[i + 1],   (pLeaf->cKeys - i) * sizeof(pLeaf->aKeys[0]));
+    memmove(&pLeaf->apNodes[i], &pLeaf->apNodes[i + 1], (pLeaf->cKeys - i) * sizeof(pLeaf->apNodes[0]));
+    pTree->cEntries--;
+
+    if (!Path.cInner)
+    {
+        if (!pLeaf->cKeys)
+        {
+            RTMemFree(pLeaf);
+            pTree->pvRoot = NULL;
+            pTree->cDepth = 0;
+        }
+        return pNode;
+    }
+    if (pLeaf->cKeys >= KBT_LEAF_MIN)
+        return pNode;
+
+    /*
+     * The leaf is underfull: borrow an entry from a sibling or merge with it.
+     */
+    KBTINNER *pParent = Path.apInner[Path.cInner - 1];
+    uint32_t  iChild  = Path.aiChild[Path.cInner - 1];
+    KBTLEAF  *pLeft   = iChild > 0              ? (KBTLEAF *)pParent->apvChildren[iChild - 1] : NULL;
+    KBTLEAF  *pRight  = iChild < pParent->cKeys ? (KBTLEAF *)pParent->apvChildren[iChild + 1] : NULL;
+    if (pLeft && pLeft->cKeys > KBT_LEAF_MIN)
+    {
+        memmove(&pLeaf->aKeys[1],   &pLeaf->aKeys[0],   pLeaf->cKeys * sizeof(pLeaf->aKeys[0]));
+        memmove(&pLeaf->apNodes[1], &pLeaf->apNodes[0], pLeaf->cKeys * sizeof(pLeaf->apNodes[0]));
+        pLeft->cKeys--;
+        pLeaf->aKeys[0]   = pLeft->aKeys[pLeft->cKeys];
+        pLeaf->apNodes[0] = pLeft->apNodes[pLeft->cKeys];
+        pLeaf->cKeys++;
+        pParent->aKeys[iChild - 1] = pLeaf->aKeys[0];
+        return pNode;
+    }
+    if (pRight && pRight->cKeys > KBT_LEAF_MIN)
+    {
+        pLeaf->aKeys[pLeaf->cKeys]   = pRight->aKeys[0];
+        pLeaf->apNodes[pLeaf->cKeys] = pRight->apNodes[0];
+        pLeaf->cKeys++;
+        pRight->cKeys--;
+        memmove(&pRight->aKeys[0],   &pRight->aKeys[1],   pRight->cKeys * sizeof(pRight->aKeys[0]));
+        memmove(&pRight->apNodes[0], &pRight->apNodes[1], pRight->cKeys * sizeof(pRight->apNodes[0]));
+        pParent->aKeys[iChild] = pRight->aKeys[0];
+        return pNode;
+    }
+
+    /* Merge the right one of the pair into the left one. */
+    if (pLeft)
+    {
+        pRight = pLeaf;
+        iChild--;
+    }
+    else
+    {
+        pLeft = pLeaf;
+        Assert(pRight);
+    }
+    memcpy(&pLeft->aKeys[pLeft->cKeys],   pRight->aKeys,   pRight->cKeys * sizeof(pLeft->aKeys[0]));
+    memcpy(&pLeft->apNodes[pLeft->cKeys], pRight->apNodes, pRight->cKeys * sizeof(pLeft->apNodes[0]));
+    pLeft->cKeys += pRight->cKeys;
+    pLeft->pNext  = pRight->pNext;
+    if (pRight->pNext)
+        pRight->pNext->pPrev = pLeft;
+    RTMemFree(pRight);
+
+    /*
+     * Remove the separator and right child from the parent and rebalance the
+     * internal nodes on the way up.
+     */
+    for (uint32_t iLevel = Path.cInner; iLevel-- > 0;)
+    {
+        KBTINNER *pInner = Path.apInner[iLevel];
+        pInner->cKeys--;
+        memmove(&pInner->aKeys[iChild], &pInner->aKeys[iChild + 1], (pInner->cKeys - iChild) * sizeof(pInner->aKeys[0]));
+        memmove(&pInner->apvChildren[iChild + 1], &pInner->apvChildren[iChild + 2],
+                (pInner->cKeys - iChild) * sizeof(pInner->apvChildren[0]));
+
+        if (iLevel == 0)
+        {
+            if (!pInner->cKeys)
+            {
+                pTree->pvRoot = pInner->apvChildren[0];
+                pTree->cDepth--;
+                RTMemFree(pInner);
+            }
+            break;
+        }
+        if (pInner->cKeys >= KBT_INNER_MIN)
+            break;
+
+        pParent = Path.apInner[iLevel - 1];
+        iChild  = Path.aiChild[iLevel - 1];
+        KBTINNER *pInnerLeft  = iChild > 0              ? (KBTINNER *)pParent->apvChildren[iChild - 1] : NULL;
+        KBTINNER *pInnerRight = iChild < pParent->cKeys ? (KBTINNER *)pParent->apvChildren[iChild + 1] : NULL;
+        if (pInnerLeft && pInnerLeft->cKeys > KBT_INNER_MIN)
+        {
+            /* Rotate right through the parent. */
+            memmove(&pInner->aKeys[1], &pInner->aKeys[0], pInner->cKeys * sizeof(pInner->aKeys[0]));
+            memmove(&pInner->apvChildren[1], &pInner->apvChildren[0], (pInner->cKeys + 1) * sizeof(pInner->apvChildren[0]));
+            pInner->aKeys[0]       = pParent->aKeys[iChild - 1];
+            pInner->apvChildren[0] = pInnerLeft->apvChildren[pInnerLeft->cKeys];
+            pInner->cKeys++;
+            pParent->aKeys[iChild - 1] = pInnerLeft->aKeys[pInnerLeft->cKeys - 1];
+            pInnerLeft->cKeys--;
+            break;
+        }
+        if (pInnerRight && pInnerRight->cKeys > KBT_INNER_MIN)
+        {
+            /* Rotate left through the parent. */
+            pInner->aKeys[pInner->cKeys]           = pParent->aKeys[iChild];
+            pInner->apvChildren[pInner->cKeys + 1] = pInnerRight->apvChildren[0];
+            pInner->cKeys++;
+            pParent->aKeys[iChild] = pInnerRight->aKeys[0];
+            pInnerRight->cKeys--;
+            memmove(&pInnerRight->aKeys[0], &pInnerRight->aKeys[1], pInnerRight->cKeys * sizeof(pInnerRight->aKeys[0]));
+            memmove(&pInnerRight->apvChildren[0], &pInnerRight->apvChildren[1],
+                    (pInnerRight->cKeys + 1) * sizeof(pInnerRight->apvChildren[0]));
+            break;
+        }
+
+        /* Merge the right one of the pair into the left one, pulling down the separator. */
+        if (pInnerLeft)
+        {
+            pInnerRight = pInner;
+            iChild--;
+        }
+        else
+        {
+            pInnerLeft = pInner;
+            Assert(pInnerRight);
+        }
+        pInnerLeft->aKeys[pInnerLeft->cKeys] = pParent->aKeys[iChild];
+        memcpy(&pInnerLeft->aKeys[pInnerLeft->cKeys + 1], pInnerRight->aKeys, pInnerRight->cKeys * sizeof(pInnerLeft->aKeys[0]));
+        memcpy(&pInnerLeft->apvChildren[pInnerLeft->cKeys + 1], pInnerRight->apvChildren,
+               (pInnerRight->cKeys + 1) * sizeof(pInnerLeft->apvChildren[0]));
+        pInnerLeft->cKeys += pInnerRight->cKeys + 1;
+        RTMemFree(pInnerRight);
+    }
+
+    return pNode;
+}
+
+
+KBT_DECL(PKBTNODECORE) KBT_FN(Get)(PKBTTREE pTree, KBTKEY Key)
+{
+    if (!pTree->pvRoot)
+        return NULL;
+    KBTLEAF *pLeaf = KBT_FN(Descend)(pTree, Key, NULL);
+    uint32_t i     = KBT_FN(SearchKeys)(pLeaf->aKeys, pLeaf->cKeys, Key);
+    if (i > 0 && pLeaf->aKeys[i - 1] == Key)
+        return pLeaf->apNodes[i - 1];
+    return NULL;
+}
+
+
+KBT_DECL(PKBTNODECORE) KBT_FN(RangeGet)(PKBTTREE pTree, KBTKEY Key)
+{
+    PKBTNODECORE pNode = KBT_FN(Predecessor)(pTree, Key);
+    if (pNode && Key <= pNode->KeyLast)
+        return pNode;
+    return NULL;
+}
+
+
+KBT_DECL(PKBTNODECORE) KBT_FN(RangeRemove)(PKBTTREE pTree, KBTKEY Key)
+{
+    PKBTNODECORE pNode = KBT_FN(RangeGet)(pTree, Key);
+    if (pNode)
+        return KBT_FN(Remove)(pTree, pNode->Key);
+    return NULL;
+}
+
+
+KBT_DECL(PKBTNODECORE) KBT_FN(GetBestFit)(PKBTTREE pTree, KBTKEY Key, bool fAbove)
+{
+    if (!fAbove)
+        return KBT_FN(Predecessor)(pTree, Key);
+
+    if (!pTree->pvRoot)
+        return NULL;
+    KBTLEAF *pLeaf = KBT_FN(Descend)(pTree, Key, NULL);
+    uint32_t i     = KBT_FN(SearchKeys)(pLeaf->aKeys, pLeaf->cKeys, Key);
+    if (i > 0 && pLeaf->aKeys[i - 1] == Key)
+        return pLeaf->apNodes[i - 1];
+    if (i < pLeaf->cKeys)
+        return pLeaf->apNodes[i];
+    if (pLeaf->pNext)
+        return pLeaf->pNext->apNodes[0];
+    return NULL;
+}
+
+
+KBT_DECL(int) KBT_FN(DoWithAll)(PKBTTREE pTree, int fFromLeft, PKBTCALLBACK pfnCallBack, void *pvParam)
+{
+    if (!pTree->pvRoot)
+        return VINF_SUCCESS;
+
+    if (fFromLeft)
+    {
+        for (KBTLEAF *pLeaf = KBT_FN(EdgeLeaf)(pTree, true /*fFirst*/); pLeaf; pLeaf = pLeaf->pNext)
+            for (uint32_t i = 0; i < pLeaf->cKeys; i++)
+            {
+                int rc = pfnCallBack(pLeaf->apNodes[i], pvParam);
+                if (rc != VINF_SUCCESS)
+                    return rc;
+            }
+    }
+    else
+    {
+        for (KBTLEAF *pLeaf = KBT_FN(EdgeLeaf)(pTree, false /*fFirst*/); pLeaf; pLeaf = pLeaf->pPrev)
+            for (uint32_t i = pLeaf->cKeys; i-- > 0;)
+            {
+                int rc = pfnCallBack(pLeaf->apNodes[i], pvParam);
+                if (rc != VINF_SUCCESS)
+                    return rc;
+            }
+    }
+    return VINF_SUCCESS;
+}
+
+
+KBT_DECL(int) KBT_FN(Destroy)(PKBTTREE pTree, PKBTCALLBACK pfnCallBack, void *pvParam)
+{
+    if (!pTree->pvRoot)
+        return VINF_SUCCESS;
+
+    /*
+     * Unlink the entries leaf by leaf, emptying the leaves as we go so that a
+     * retry after a callback failure picks up where we left off.
+     */
+    for (KBTLEAF *pLeaf = KBT_FN(EdgeLeaf)(pTree, true /*fFirst*/); pLeaf; pLeaf = pLeaf->pNext)
+        while (pLeaf->cKeys > 0)
+        {
+            PKBTNODECORE pNode = pLeaf->apNodes[--pLeaf->cKeys];
+            pTree->cEntries--;
+            if (pfnCallBack)
+            {
+                int rc = pfnCallBack(pNode, pvParam);
+                if (rc != VINF_SUCCESS)
+                    return rc;
+            }
+        }
+    Assert(!pTree->cEntries);
+
+    KBT_FN(FreeSubtree)(pTree->pvRoot, pTree->cDepth);
+    pTree->pvRoot   = NULL;
+    pTree->cDepth   = 0;
+    pTree->cEntries = 0;
+    return VINF_SUCCESS;
+}
+
+#endif
+
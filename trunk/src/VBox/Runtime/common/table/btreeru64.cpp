@@ -0,0 +1,59 @@
+/* $Id$ */
+/** @file
+ * IPRT - B+Tree, uint64_t ranges.
+ */
+
+/*
+ * Copyright (C) 2016 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ *
+ * The contents of this file may alternatively be used under the terms
+ * of the Common Development and Distribution License Version 1.0
+ * (CDDL) only, as it comes in the "COPYING.CDDL" file of the
+ * VirtualBox OSE distribution, in which case the provisions of the
+ * CDDL are applicable instead of those of the GPL.
+ *
+ * You may elect to license modified versions of this file under the
+ * terms and conditions of either the GPL or the CDDL or both.
+ */
+
+
+/*********************************************************************************************************************************
+*   Defined Constants And Macros                                                                                                 *
+*********************************************************************************************************************************/
+/*
+ * B+tree configuration.
+ */
+#define KBT_FN(a)                   RTBTreeRU64##a
+#define KBTKEY                      RTBTREERU64KEY
+#define KBTNODECORE                 RTBTREERU64NODECORE
+#define PKBTNODECORE                PRTBTREERU64NODECORE
+#define KBTTREE                     RTBTREERU64TREE
+#define PKBTTREE                    PRTBTREERU64TREE
+#define PKBTCALLBACK                PRTBTREERU64CALLBACK
+#define KBTLEAF                     RTBTREERU64LEAF
+#define KBTINNER                    RTBTREERU64INNER
+#define KBTPATH                     RTBTREERU64PATH
+
+
+/*********************************************************************************************************************************
+*   Header Files                                                                                                                 *
+*********************************************************************************************************************************/
+#include <iprt/btree.h>
+#include <iprt/assert.h>
+#include <iprt/err.h>
+#include <iprt/mem.h>
+#include <iprt/string.h>
+
+/*
+ * Include the code.
+ */
+#include "btree_Base.cpp.h"
+
@@ -49,6 +49,14 @@ RTDECL(int) RTStrCacheCreate(PRTSTRCACHE phStrCache, const char *pszName)
 RT_EXPORT_SYMBOL(RTStrCacheCreate);
 
 
+RTDECL(int) RTStrCacheCreateEx(PRTSTRCACHE phStrCache, const char *pszName, uint32_t fFlags)
+{
+    AssertReturn(!(fFlags & ~RTSTRCACHE_F_VALID_MASK), VERR_INVALID_FLAGS);
+    return RTStrCacheCreate(phStrCache, pszName);
+}
+RT_EXPORT_SYMBOL(RTStrCacheCreateEx);
+
+
 RTDECL(int) RTStrCacheDestroy(RTSTRCACHE hStrCache)
 {
     if (    hStrCache == NIL_RTSTRCACHE
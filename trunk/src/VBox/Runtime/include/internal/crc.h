@@ -0,0 +1,191 @@
+/* $Id$ */
+/** @file
+ * IPRT - Internal header with the CPU specific CRC helpers.
+ */
+
+/*
+ * Copyright (C) 2016 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ *
+ * The contents of this file may alternatively be used under the terms
+ * of the Common Development and Distribution License Version 1.0
+ * (CDDL) only, as it comes in the "COPYING.CDDL" file of the
+ * VirtualBox OSE distribution, in which case the provisions of the
+ * CDDL are applicable instead of those of the GPL.
+ *
+ * You may elect to license modified versions of this file under the
+ * terms and conditions of either the GPL or the CDDL or both.
+ */
+
+#ifndef ___internal_crc_h
+#define ___internal_crc_h
+
+#include <iprt/types.h>
+
+/** @def RTCRC_WITH_PCLMUL
+ * Use the PCLMULQDQ folding and SSE4.2 CRC32 kernels when the host CPU
+ * supports them.  Ring-3 only, since the kernel contexts would have to save
+ * the FPU state around them, and AMD64 only to keep the variants down. */
+#if    defined(IN_RING3) && defined(RT_ARCH_AMD64) \
+    && (defined(_MSC_VER) ? _MSC_VER >= 1700 : RT_GNUC_PREREQ(4, 9) || defined(__clang__))
+# define RTCRC_WITH_PCLMUL
+# include <iprt/asm.h>
+# include <iprt/asm-amd64-x86.h>
+# include <iprt/x86.h>
+# include <emmintrin.h>
+# include <nmmintrin.h>
+# include <wmmintrin.h>
+# ifdef _MSC_VER
+#  define RTCRC_PCLMUL_FN
+#  define RTCRC_SSE42_FN
+# else
+#  define RTCRC_PCLMUL_FN       __attribute__((__target__("pclmul")))
+#  define RTCRC_SSE42_FN        __attribute__((__target__("sse4.2")))
+# endif
+#endif
+
+/** Don't bother with PCLMULQDQ folding for less than this many bytes. */
+#define RTCRC_PCLMUL_MIN        128
+
+/** @name RTCRC_F_XXX - CPU feature flags for the CRC kernels.
+ * @{ */
+#define RTCRC_F_INITIALIZED     RT_BIT_32(0)
+#define RTCRC_F_PCLMUL          RT_BIT_32(1)
+#define RTCRC_F_SSE42           RT_BIT_32(2)
+/** @} */
+
+
+/**
+ * PCLMULQDQ folding constants for a reflected CRC with polynomial P.
+ *
+ * Each pair is multiplied with the low and high quadword of an accumulator
+ * to move it forward by 512 and 128 bits respectively, i.e. it holds the
+ * bit reflected x^(64+D-1) mod P and x^(D-1) mod P values.
+ */
+typedef struct RTCRCFOLDCONSTS
+{
+    /** Fold by 512 bits (four accumulators). */
+    uint64_t    au64Fold512[2];
+    /** Fold by 128 bits (one accumulator). */
+    uint64_t    au64Fold128[2];
+} RTCRCFOLDCONSTS;
+
+
+/**
+ * Reads an unaligned little endian 32-bit value for the slicing-by-8 loops.
+ */
+DECLINLINE(uint32_t) rtCrcReadU32LE(uint8_t const *pb)
+{
+#if defined(RT_ARCH_AMD64) || defined(RT_ARCH_X86)
+    return *(uint32_t const *)pb;
+#else
+    return RT_MAKE_U32_FROM_U8(pb[0], pb[1], pb[2], pb[3]);
+#endif
+}
+
+
+/**
+ * Reads an unaligned little endian 64-bit value for the slicing-by-8 loops.
+ */
+DECLINLINE(uint64_t) rtCrcReadU64LE(uint8_t const *pb)
+{
+#if defined(RT_ARCH_AMD64) || defined(RT_ARCH_X86)
+    return *(uint64_t const *)pb;
+#else
+    return RT_MAKE_U64(rtCrcReadU32LE(pb), rtCrcReadU32LE(pb + 4));
+#endif
+}
+
+
+#ifdef RTCRC_WITH_PCLMUL
+
+/**
+ * Detects the CPU features used by the CRC kernels.
+ *
+ * @returns RTCRC_F_XXX.
+ * @param   pfCpu       The variable caching the flags.
+ */
+DECLINLINE(uint32_t) rtCrcInitCpu(uint32_t volatile *pfCpu)
+{
+    uint32_t fCpu = RTCRC_F_INITIALIZED;
+    uint32_t uEAX, uEBX, uECX, uEDX;
+    ASMCpuId(1, &uEAX, &uEBX, &uECX, &uEDX);
+    if (uECX & X86_CPUID_FEATURE_ECX_PCLMUL)
+        fCpu |= RTCRC_F_PCLMUL;
+    if (uECX & X86_CPUID_FEATURE_ECX_SSE4_2)
+        fCpu |= RTCRC_F_SSE42;
+    ASMAtomicWriteU32(pfCpu, fCpu);
+    return fCpu;
+}
+
+
+/**
+ * Folds a 128-bit accumulator forward.
+ */
+RTCRC_PCLMUL_FN DECLINLINE(__m128i) rtCrcFold(__m128i uAcc, __m128i uConsts)
+{
+    return _mm_xor_si128(_mm_clmulepi64_si128(uAcc, uConsts, 0x00), _mm_clmulepi64_si128(uAcc, uConsts, 0x11));
+}
+
+
+/**
+ * Folds whole 16 byte blocks of data into a 128-bit remainder using
+ * PCLMULQDQ.
+ *
+ * The CRC of the data equals the CRC of the 16 bytes returned in @a pbAcc
+ * calculated with a zero CRC register, so the caller finishes by running those
+ * through its table code (the Barrett reduction isn't worth it here).
+ *
+ * @param   pConsts     The folding constants for the polynomial.
+ * @param   uReg        The current (reflected) CRC register value.
+ * @param   pb          The data.
+ * @param   cBlocks     Number of 16 byte blocks, at least four.
+ * @param   pbAcc       Where to return the 16 remainder bytes.
+ */
+RTCRC_PCLMUL_FN DECLINLINE(void) rtCrcFoldPclmul(RTCRCFOLDCONSTS const *pConsts, uint64_t uReg, uint8_t const *pb,
+                                                 size_t cBlocks, uint8_t *pbAcc)
+{
+    __m128i const uFold512 = _mm_set_epi64x((int64_t)pConsts->au64Fold512[1], (int64_t)pConsts->au64Fold512[0]);
+    __m128i const uFold128 = _mm_set_epi64x((int64_t)pConsts->au64Fold128[1], (int64_t)pConsts->au64Fold128[0]);
+    __m128i uAcc0 = _mm_xor_si128(_mm_loadu_si128((__m128i const *)pb), _mm_cvtsi64_si128((int64_t)uReg));
+    __m128i uAcc1 = _mm_loadu_si128((__m128i const *)(pb + 16));
+    __m128i uAcc2 = _mm_loadu_si128((__m128i const *)(pb + 32));
+    __m128i uAcc3 = _mm_loadu_si128((__m128i const *)(pb + 48));
+    pb      += 64;
+    cBlocks -= 4;
+
+    /* Four independent accumulators to keep the multiplier busy. */
+    while (cBlocks >= 4)
+    {
+        uAcc0 = _mm_xor_si128(rtCrcFold(uAcc0, uFold512), _mm_loadu_si128((__m128i const *)pb));
+        uAcc1 = _mm_xor_si128(rtCrcFold(uAcc1, uFold512), _mm_loadu_si128((__m128i const *)(pb + 16)));
+        uAcc2 = _mm_xor_si128(rtCrcFold(uAcc2, uFold512), _mm_loadu_si128((__m128i const *)(pb + 32)));
+        uAcc3 = _mm_xor_si128(rtCrcFold(uAcc3, uFold512), _mm_loadu_si128((__m128i const *)(pb + 48)));
+        pb      += 64;
+        cBlocks -= 4;
+    }
+
+    /* Combine them and do the remaining blocks one by one. */
+    uAcc0 = _mm_xor_si128(rtCrcFold(uAcc0, uFold128), uAcc1);
+    uAcc0 = _mm_xor_si128(rtCrcFold(uAcc0, uFold128), uAcc2);
+    uAcc0 = _mm_xor_si128(rtCrcFold(uAcc0, uFold128), uAcc3);
+    while (cBlocks-- > 0)
+    {
+        uAcc0 = _mm_xor_si128(rtCrcFold(uAcc0, uFold128), _mm_loadu_si128((__m128i const *)pb));
+        pb += 16;
+    }
+
+    _mm_storeu_si128((__m128i *)pbAcc, uAcc0);
+}
+
+#endif /* RTCRC_WITH_PCLMUL */
+
+#endif
+
@@ -104,6 +104,10 @@
 #define RTLOCKVALRECNEST_MAGIC          UINT32_C(0x19071123)
 /** The magic value for RTLOCKVALRECNEST::u32Magic after deletion. */
 #define RTLOCKVALRECNEST_MAGIC_DEAD     UINT32_C(0x19980427)
+/** Magic number for RTMEMARENAINT::u32Magic. (Ada Lovelace) */
+#define RTMEMARENA_MAGIC                UINT32_C(0x18151210)
+/** Dead magic number for RTMEMARENAINT::u32Magic. */
+#define RTMEMARENA_MAGIC_DEAD           UINT32_C(0x18521127)
 /** Magic number for RTMEMCACHEINT::u32Magic. (Joseph Weizenbaum) */
 #define RTMEMCACHE_MAGIC                UINT32_C(0x19230108)
 /** Dead magic number for RTMEMCACHEINT::u32Magic. */
@@ -64,7 +64,9 @@ struct RTREQ
     /** Set if the event semaphore is clear. */
     volatile bool           fEventSemClear;
     /** Set if the push back semaphore should be signaled when the request
-     *  is picked up from the queue. */
+     *  is picked up from the queue.  In work-stealing pools this is cleared
+     *  on submission and set by both the submitter and the worker picking it
+     *  up (see rtReqPoolWsPushBack). */
     volatile bool           fSignalPushBack;
     /** Set if pool, clear if queue. */
     volatile bool           fPoolOrQueue;
@@ -0,0 +1,111 @@
+/* $Id$ */
+/** @file
+ * IPRT - Internal header with the SHA extension helpers for the SHA-1 and
+ *        SHA-256 code.
+ */
+
+/*
+ * Copyright (C) 2016 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ *
+ * The contents of this file may alternatively be used under the terms
+ * of the Common Development and Distribution License Version 1.0
+ * (CDDL) only, as it comes in the "COPYING.CDDL" file of the
+ * VirtualBox OSE distribution, in which case the provisions of the
+ * CDDL are applicable instead of those of the GPL.
+ *
+ * You may elect to license modified versions of this file under the
+ * terms and conditions of either the GPL or the CDDL or both.
+ */
+
+#ifndef ___internal_sha_h
+#define ___internal_sha_h
+
+#include <iprt/types.h>
+
+/** @def RTSHA_WITH_SHANI
+ * Use the SHA extensions (SHA-NI) for the block processing when the host CPU
+ * has them.  Ring-3 only, since the kernel contexts would have to save the
+ * FPU state around them, and AMD64 only to keep the variants down.
+ *
+ * @note    VBoxRT links the OpenSSL digest code (openssl-sha*.cpp) unless
+ *          VBOX_WITH_ALT_HASH_CODE is defined, so with the default config this
+ *          only benefits the static ring-3 runtimes (RuntimeR3,
+ *          RuntimeGuestR3, RuntimeBldProg). */
+#if    defined(IN_RING3) && defined(RT_ARCH_AMD64) \
+    && (defined(_MSC_VER) ? _MSC_VER >= 1900 : RT_GNUC_PREREQ(4, 9) || defined(__clang__))
+# define RTSHA_WITH_SHANI
+# include <iprt/asm.h>
+# include <iprt/asm-amd64-x86.h>
+# include <iprt/x86.h>
+# include <emmintrin.h>
+# include <tmmintrin.h>
+# include <smmintrin.h>
+# include <immintrin.h>
+# ifdef _MSC_VER
+#  define RTSHA_SHANI_FN
+# else
+#  define RTSHA_SHANI_FN        __attribute__((__target__("sha,ssse3,sse4.1")))
+# endif
+#endif
+
+/** @name RTSHA_F_XXX - CPU feature flags for the SHA block functions.
+ * @{ */
+#define RTSHA_F_INITIALIZED     RT_BIT_32(0)
+#define RTSHA_F_SHANI           RT_BIT_32(1)
+/** @} */
+
+
+#ifdef RTSHA_WITH_SHANI
+/**
+ * Detects whether the host CPU has the SHA extensions (along with the SSSE3
+ * and SSE4.1 instructions the SHA-NI code uses).
+ *
+ * @returns RTSHA_F_XXX.
+ * @param   pfCpu       The variable caching the flags.
+ */
+DECLINLINE(uint32_t) rtShaInitCpu(uint32_t volatile *pfCpu)
+{
+    uint32_t fCpu = RTSHA_F_INITIALIZED;
+    uint32_t uEAX, uEBX, uECX, uEDX;
+    ASMCpuId(0, &uEAX, &uEBX, &uECX, &uEDX);
+    if (uEAX >= 7)
+    {
+        ASMCpuId(1, &uEAX, &uEBX, &uECX, &uEDX);
+        if (   (uECX & (X86_CPUID_FEATURE_ECX_SSSE3 | X86_CPUID_FEATURE_ECX_SSE4_1))
+            == (X86_CPUID_FEATURE_ECX_SSSE3 | X86_CPUID_FEATURE_ECX_SSE4_1))
+        {
+            ASMCpuId_Idx_ECX(7, 0, &uEAX, &uEBX, &uECX, &uEDX);
+            if (uEBX & X86_CPUID_STEXT_FEATURE_EBX_SHA)
+                fCpu |= RTSHA_F_SHANI;
+        }
+    }
+    ASMAtomicWriteU32(pfCpu, fCpu);
+    return fCpu;
+}
+
+
+/**
+ * Checks whether the SHA extensions can be used, detecting it on first call.
+ *
+ * @returns true if SHA-NI is available, false if not.
+ * @param   pfCpu       The variable caching the RTSHA_F_XXX flags.
+ */
+DECLINLINE(bool) rtShaHasShaNi(uint32_t volatile *pfCpu)
+{
+    uint32_t fCpu = *pfCpu;
+    if (RT_UNLIKELY(!fCpu))
+        fCpu = rtShaInitCpu(pfCpu);
+    return RT_BOOL(fCpu & RTSHA_F_SHANI);
+}
+#endif /* RTSHA_WITH_SHANI */
+
+#endif
+
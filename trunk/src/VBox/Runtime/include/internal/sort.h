@@ -0,0 +1,140 @@
+/* $Id$ */
+/** @file
+ * IPRT - Internal header with inline helpers shared by the sorting algorithms.
+ */
+
+/*
+ * Copyright (C) 2016 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ *
+ * The contents of this file may alternatively be used under the terms
+ * of the Common Development and Distribution License Version 1.0
+ * (CDDL) only, as it comes in the "COPYING.CDDL" file of the
+ * VirtualBox OSE distribution, in which case the provisions of the
+ * CDDL are applicable instead of those of the GPL.
+ *
+ * You may elect to license modified versions of this file under the
+ * terms and conditions of either the GPL or the CDDL or both.
+ */
+
+#ifndef ___internal_sort_h
+#define ___internal_sort_h
+
+#include <iprt/sort.h>
+#include <iprt/string.h>
+
+
+/** Ranges of this many elements or less are sorted by insertion. */
+#define RTSORT_INSERTION_THRESHOLD      24
+
+
+/**
+ * Sorting context, shared by the variable sized element and the pointer array
+ * variants of the algorithms.
+ */
+typedef struct RTSORTCTX
+{
+    /** The compare callback. */
+    PFNRTSORTCMP    pfnCmp;
+    /** The user argument for the callback. */
+    void           *pvUser;
+    /** The element size. */
+    size_t          cbElement;
+    /** Set if this is a pointer array (RTSortApvXxx), clear if the callback
+     * should be given the element addresses. */
+    bool            fApv;
+    /** Scratch space for one element, private to the thread doing the sorting. */
+    uint8_t        *pbTmp;
+} RTSORTCTX;
+/** Pointer to a sorting context. */
+typedef RTSORTCTX *PRTSORTCTX;
+
+
+/**
+ * Compares two elements.
+ *
+ * @returns Same as FNRTSORTCMP.
+ * @param   pCtx        The sorting context.
+ * @param   pb1         The address of the 1st element.
+ * @param   pb2         The address of the 2nd element.
+ */
+DECLINLINE(int) rtSortCmp(PRTSORTCTX pCtx, uint8_t const *pb1, uint8_t const *pb2)
+{
+    if (pCtx->fApv)
+        return pCtx->pfnCmp(*(void * const *)pb1, *(void * const *)pb2, pCtx->pvUser);
+    return pCtx->pfnCmp(pb1, pb2, pCtx->pvUser);
+}
+
+
+/**
+ * Swaps two elements.
+ *
+ * @param   pCtx        The sorting context.
+ * @param   pb1         The address of the 1st element.
+ * @param   pb2         The address of the 2nd element.
+ */
+DECLINLINE(void) rtSortSwap(PRTSORTCTX pCtx, uint8_t *pb1, uint8_t *pb2)
+{
+    size_t cb = pCtx->cbElement;
+    if (cb == sizeof(void *))
+    {
+        void *pvTmp;
+        memcpy(&pvTmp, pb1, sizeof(pvTmp));
+        memcpy(pb1, pb2, sizeof(pvTmp));
+        memcpy(pb2, &pvTmp, sizeof(pvTmp));
+        return;
+    }
+    while (cb >= sizeof(uint64_t))
+    {
+        uint64_t uTmp;
+        memcpy(&uTmp, pb1, sizeof(uTmp));
+        memcpy(pb1, pb2, sizeof(uTmp));
+        memcpy(pb2, &uTmp, sizeof(uTmp));
+        pb1 += sizeof(uint64_t);
+        pb2 += sizeof(uint64_t);
+        cb  -= sizeof(uint64_t);
+    }
+    while (cb-- > 0)
+    {
+        uint8_t bTmp = *pb1;
+        *pb1++ = *pb2;
+        *pb2++ = bTmp;
+    }
+}
+
+
+/**
+ * Stable insertion sort of a (small) range.
+ *
+ * @param   pCtx        The sorting context.
+ * @param   pbBegin     The first element.
+ * @param   cElements   The number of elements in the range.
+ */
+DECLINLINE(void) rtSortInsertion(PRTSORTCTX pCtx, uint8_t *pbBegin, size_t cElements)
+{
+    size_t const cb = pCtx->cbElement;
+    for (size_t i = 1; i < cElements; i++)
+    {
+        uint8_t *pbCur = pbBegin + i * cb;
+        if (rtSortCmp(pCtx, pbCur - cb, pbCur) > 0)
+        {
+            uint8_t *pbHole = pbCur - cb;
+            memcpy(pCtx->pbTmp, pbCur, cb);
+            while (   pbHole > pbBegin
+                   && rtSortCmp(pCtx, pbHole - cb, pCtx->pbTmp) > 0)
+                pbHole -= cb;
+            memmove(pbHole + cb, pbHole, pbCur - pbHole);
+            memcpy(pbHole, pCtx->pbTmp, cb);
+        }
+    }
+}
+
+#endif
+
@@ -0,0 +1,383 @@
+/* $Id$ */
+/** @file
+ * IPRT Testcase - RTCHashTable/RTCMTHashTable.
+ */
+
+/*
+ * Copyright (C) 2016 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ *
+ * The contents of this file may alternatively be used under the terms
+ * of the Common Development and Distribution License Version 1.0
+ * (CDDL) only, as it comes in the "COPYING.CDDL" file of the
+ * VirtualBox OSE distribution, in which case the provisions of the
+ * CDDL are applicable instead of those of the GPL.
+ *
+ * You may elect to license modified versions of this file under the
+ * terms and conditions of either the GPL or the CDDL or both.
+ */
+
+
+/*********************************************************************************************************************************
+*   Header Files                                                                                                                 *
+*********************************************************************************************************************************/
+#include <iprt/cpp/mthashtable.h>
+
+#include <iprt/asm.h>
+#include <iprt/cpp/ministring.h>
+#include <iprt/err.h>
+#include <iprt/rand.h>
+#include <iprt/string.h>
+#include <iprt/test.h>
+#include <iprt/thread.h>
+#include <iprt/time.h>
+
+
+/*********************************************************************************************************************************
+*   Defined Constants And Macros                                                                                                 *
+*********************************************************************************************************************************/
+/** The number of keys used by the MT tests. */
+#define MTTESTKEYS              _16K
+/** The maximum number of threads in the MT tests. */
+#define MTTESTMAXTHREADS        8
+
+
+/*********************************************************************************************************************************
+*   Structures and Typedefs                                                                                                      *
+*********************************************************************************************************************************/
+/** Functor summing up the keys and values for the forEach test. */
+struct SumFunctor
+{
+    SumFunctor() : uKeySum(0), uValueSum(0), cCalls(0) {}
+    void operator()(uint32_t const &rKey, uint32_t &rValue)
+    {
+        uKeySum   += rKey;
+        uValueSum += rValue;
+        cCalls++;
+    }
+    uint64_t uKeySum;
+    uint64_t uValueSum;
+    size_t   cCalls;
+};
+
+/** Key traits with poor hashing, every 8 consecutive keys collide. */
+struct BADKEYTRAITS
+{
+    static uint32_t hash(uint32_t const &rKey)                           { return rKey & ~UINT32_C(7); }
+    static bool     equals(uint32_t const &rKey1, uint32_t const &rKey2) { return rKey1 == rKey2; }
+};
+
+/** Striped table used by the MT tests. */
+typedef RTCMTHashTable<uint32_t, uint32_t, RTCHashTableKeyTraits<uint32_t>, 16> MTTABLE16;
+/** Single stripe table used as the baseline in the benchmark. */
+typedef RTCMTHashTable<uint32_t, uint32_t, RTCHashTableKeyTraits<uint32_t>, 1>  MTTABLE1;
+
+/** MT test thread state. */
+template <typename T>
+struct MTTESTTHREAD
+{
+    T                      *pTable;
+    /** First key owned by this thread (churn test). */
+    uint32_t                uFirstKey;
+    /** Number of keys. */
+    uint32_t                cKeys;
+    /** Number of operations to do. */
+    uint32_t                cOps;
+    /** Whether to do lookups (true) or inserts + removals (false). */
+    bool                    fLookup;
+    /** Start flag. */
+    bool volatile          *pfGo;
+};
+
+
+/**
+ * Basic tests of a single threaded table.
+ */
+static void test1(void)
+{
+    RTTestISub("Basics");
+
+    RTCHashTable<uint32_t, uint32_t> Table;
+    RTTESTI_CHECK(Table.isEmpty());
+    RTTESTI_CHECK(Table.size() == 0);
+    RTTESTI_CHECK(Table.lookup(1) == NULL);
+    RTTESTI_CHECK(!Table.remove(1));
+
+    for (uint32_t i = 0; i < 1000; i++)
+        RTTESTI_CHECK(Table.insert(i, i * 3));
+    RTTESTI_CHECK(Table.size() == 1000);
+    RTTESTI_CHECK(Table.capacity() >= 1000 + 1000 / 3);
+    for (uint32_t i = 0; i < 1000; i++)
+    {
+        uint32_t *pu = Table.lookup(i);
+        RTTESTI_CHECK_RETV(pu != NULL);
+        RTTESTI_CHECK(*pu == i * 3);
+    }
+    RTTESTI_CHECK(!Table.contains(1000));
+
+    /* Replace. */
+    RTTESTI_CHECK(!Table.insert(500, 42));
+    RTTESTI_CHECK(*Table.lookup(500) == 42);
+    RTTESTI_CHECK(Table.size() == 1000);
+    Table.insert(500, 1500);
+
+    /* Enumerate. */
+    SumFunctor Sum;
+    Table.forEach(Sum);
+    RTTESTI_CHECK(Sum.cCalls == 1000);
+    RTTESTI_CHECK(Sum.uKeySum == 999 * 1000 / 2);
+    RTTESTI_CHECK(Sum.uValueSum == 3 * 999 * 1000 / 2);
+
+    /* Remove the odd keys. */
+    for (uint32_t i = 1; i < 1000; i += 2)
+        RTTESTI_CHECK(Table.remove(i));
+    RTTESTI_CHECK(Table.size() == 500);
+    for (uint32_t i = 0; i < 1000; i++)
+        RTTESTI_CHECK(Table.contains(i) == !(i & 1));
+
+    Table.clear();
+    RTTESTI_CHECK(Table.isEmpty());
+    RTTESTI_CHECK(!Table.contains(0));
+}
+
+
+/**
+ * Random inserts and removals, checked against a bitmap, to exercise the
+ * backward shift deletion with long probe chains.
+ */
+static void test2(void)
+{
+    RTTestISub("Random churn");
+
+    uint32_t const cKeys = 4096;
+    uint32_t      *pau32Bitmap = (uint32_t *)RTMemAllocZ(cKeys / 8);
+    RTTESTI_CHECK_RETV(pau32Bitmap);
+
+    RTCHashTable<uint32_t, uint32_t, BADKEYTRAITS> Table;
+
+    size_t cPresent = 0;
+    for (uint32_t iOp = 0; iOp < 200000; iOp++)
+    {
+        uint32_t const uKey = RTRandU32Ex(0, cKeys - 1);
+        if (ASMBitTest(pau32Bitmap, uKey))
+        {
+            RTTESTI_CHECK_RETV(Table.remove(uKey));
+            ASMBitClear(pau32Bitmap, uKey);
+            cPresent--;
+        }
+        else
+        {
+            RTTESTI_CHECK_RETV(Table.insert(uKey, ~uKey));
+            ASMBitSet(pau32Bitmap, uKey);
+            cPresent++;
+        }
+        if ((iOp & 4095) == 0)
+            for (uint32_t i = 0; i < cKeys; i++)
+            {
+                uint32_t *pu = Table.lookup(i);
+                RTTESTI_CHECK_RETV(!pu == !ASMBitTest(pau32Bitmap, i));
+                RTTESTI_CHECK_RETV(!pu || *pu == ~i);
+            }
+    }
+    RTTESTI_CHECK(Table.size() == cPresent);
+    RTMemFree(pau32Bitmap);
+}
+
+
+/**
+ * RTCString keys, which need copying and destruction.
+ */
+static void test3(void)
+{
+    RTTestISub("RTCString keys");
+
+    RTCHashTable<RTCString, RTCString> Table;
+    for (uint32_t i = 0; i < 2000; i++)
+    {
+        char szKey[32];
+        RTStrPrintf(szKey, sizeof(szKey), "key-%u", i);
+        RTTESTI_CHECK(Table.insert(szKey, RTCString(szKey).append("-value")));
+    }
+    RTTESTI_CHECK(Table.size() == 2000);
+
+    RTCString *pStr = Table.lookup("key-1234");
+    RTTESTI_CHECK_RETV(pStr != NULL);
+    RTTESTI_CHECK(pStr->equals("key-1234-value"));
+    RTTESTI_CHECK(Table.lookup("key-2000") == NULL);
+
+    for (uint32_t i = 0; i < 2000; i += 3)
+    {
+        char szKey[32];
+        RTStrPrintf(szKey, sizeof(szKey), "key-%u", i);
+        RTTESTI_CHECK(Table.remove(szKey));
+    }
+    RTTESTI_CHECK(Table.size() == 2000 - 667);
+    RTTESTI_CHECK(Table.contains("key-1"));
+    RTTESTI_CHECK(!Table.contains("key-3"));
+}
+
+
+/**
+ * MT test thread.
+ *
+ * In lookup mode it looks up random keys of the prefilled table, otherwise it
+ * inserts and removes the keys of its own range, checking that nobody else
+ * touches them.
+ */
+template <typename T>
+static DECLCALLBACK(int) mtTestThread(RTTHREAD hSelf, void *pvUser)
+{
+    RT_NOREF(hSelf);
+    MTTESTTHREAD<T> *pArgs = (MTTESTTHREAD<T> *)pvUser;
+    while (!ASMAtomicUoReadBool(pArgs->pfGo))
+        ASMNopPause();
+
+    uint32_t uSeed = pArgs->uFirstKey * 2654435761U + 1;
+    for (uint32_t iOp = 0; iOp < pArgs->cOps; iOp++)
+    {
+        uSeed = uSeed * 1103515245 + 12345;
+        uint32_t const uKey = pArgs->uFirstKey + (uSeed >> 8) % pArgs->cKeys;
+        if (pArgs->fLookup)
+        {
+            uint32_t uValue;
+            if (!pArgs->pTable->lookup(uKey, &uValue) || uValue != uKey * 7)
+                return VERR_NOT_FOUND;
+        }
+        else
+        {
+            uint32_t uValue;
+            if (pArgs->pTable->lookup(uKey, &uValue))
+            {
+                if (uValue != uKey * 7 || !pArgs->pTable->remove(uKey))
+                    return VERR_INTERNAL_ERROR;
+            }
+            else if (!pArgs->pTable->insert(uKey, uKey * 7))
+                return VERR_INTERNAL_ERROR_2;
+        }
+    }
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Runs @a cThreads MT test threads on the table.
+ *
+ * @returns Nanoseconds per operation.
+ */
+template <typename T>
+static uint64_t mtTestRun(T *pTable, unsigned cThreads, uint32_t cOps, bool fLookup)
+{
+    MTTESTTHREAD<T> aArgs[MTTESTMAXTHREADS];
+    RTTHREAD        ahThreads[MTTESTMAXTHREADS];
+    bool volatile   fGo = false;
+
+    for (unsigned i = 0; i < cThreads; i++)
+    {
+        aArgs[i].pTable    = pTable;
+        aArgs[i].uFirstKey = fLookup ? 0 : i * (MTTESTKEYS / MTTESTMAXTHREADS);
+        aArgs[i].cKeys     = fLookup ? MTTESTKEYS : MTTESTKEYS / MTTESTMAXTHREADS;
+        aArgs[i].cOps      = cOps;
+        aArgs[i].fLookup   = fLookup;
+        aArgs[i].pfGo      = &fGo;
+        int rc = RTThreadCreateF(&ahThreads[i], mtTestThread<T>, &aArgs[i], 0, RTTHREADTYPE_DEFAULT,
+                                 RTTHREADFLAGS_WAITABLE, "tst%u", i);
+        RTTESTI_CHECK_RC_OK_RET(rc, 0);
+    }
+
+    uint64_t const nsStart = RTTimeNanoTS();
+    ASMAtomicWriteBool(&fGo, true);
+    for (unsigned i = 0; i < cThreads; i++)
+    {
+        int rcThread = VERR_IPE_UNINITIALIZED_STATUS;
+        RTTESTI_CHECK_RC_OK(RTThreadWait(ahThreads[i], RT_INDEFINITE_WAIT, &rcThread));
+        RTTESTI_CHECK_RC_OK(rcThread);
+    }
+    uint64_t const cNsElapsed = RTTimeNanoTS() - nsStart;
+    return cNsElapsed / ((uint64_t)cOps * cThreads);
+}
+
+
+/**
+ * Multithreaded correctness test.
+ */
+static void test4(void)
+{
+    RTTestISubF("MT churn with %u threads", MTTESTMAXTHREADS);
+
+    MTTABLE16 Table;
+    mtTestRun(&Table, MTTESTMAXTHREADS, 50000, false /*fLookup*/);
+
+    /* Every key present must have the right value. */
+    size_t cPresent = 0;
+    for (uint32_t uKey = 0; uKey < MTTESTKEYS; uKey++)
+    {
+        uint32_t uValue;
+        if (Table.lookup(uKey, &uValue))
+        {
+            RTTESTI_CHECK(uValue == uKey * 7);
+            cPresent++;
+        }
+    }
+    RTTESTI_CHECK(Table.size() == cPresent);
+    Table.clear();
+    RTTESTI_CHECK(Table.isEmpty());
+}
+
+
+/**
+ * Benchmarks lookups and inserts for a table type.
+ */
+template <typename T>
+static void test5Table(const char *pszName)
+{
+    T Table;
+    for (uint32_t uKey = 0; uKey < MTTESTKEYS; uKey++)
+        Table.insert(uKey, uKey * 7);
+
+    for (unsigned cThreads = 1; cThreads <= MTTESTMAXTHREADS; cThreads *= 2)
+        RTTestIValueF(mtTestRun(&Table, cThreads, 200000, true /*fLookup*/), RTTESTUNIT_NS_PER_CALL,
+                      "%s lookup, %u threads", pszName, cThreads);
+
+    Table.clear();
+    for (unsigned cThreads = 1; cThreads <= MTTESTMAXTHREADS; cThreads *= 2)
+        RTTestIValueF(mtTestRun(&Table, cThreads, 200000, false /*fLookup*/), RTTESTUNIT_NS_PER_CALL,
+                      "%s insert/remove, %u threads", pszName, cThreads);
+}
+
+
+/**
+ * Scalability benchmark: a single stripe (one lock) vs. 16 stripes.
+ */
+static void test5(void)
+{
+    RTTestISub("Benchmark");
+    test5Table<MTTABLE1>("1 stripe");
+    test5Table<MTTABLE16>("16 stripes");
+}
+
+
+int main()
+{
+    RTTEST hTest;
+    RTEXITCODE rcExit = RTTestInitAndCreate("tstIprtHashTable", &hTest);
+    if (rcExit != RTEXITCODE_SUCCESS)
+        return rcExit;
+    RTTestBanner(hTest);
+
+    test1();
+    test2();
+    test3();
+    test4();
+    if (RTTestIErrorCount() == 0)
+        test5();
+
+    return RTTestSummaryAndDestroy(hTest);
+}
+
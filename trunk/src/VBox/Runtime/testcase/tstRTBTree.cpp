@@ -0,0 +1,430 @@
+/* $Id$ */
+/** @file
+ * IPRT Testcase - B+Trees.
+ */
+
+/*
+ * Copyright (C) 2016 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ *
+ * The contents of this file may alternatively be used under the terms
+ * of the Common Development and Distribution License Version 1.0
+ * (CDDL) only, as it comes in the "COPYING.CDDL" file of the
+ * VirtualBox OSE distribution, in which case the provisions of the
+ * CDDL are applicable instead of those of the GPL.
+ *
+ * You may elect to license modified versions of this file under the
+ * terms and conditions of either the GPL or the CDDL or both.
+ */
+
+
+/*********************************************************************************************************************************
+*   Header Files                                                                                                                 *
+*********************************************************************************************************************************/
+#include <iprt/btree.h>
+
+#include <iprt/avl.h>
+#include <iprt/err.h>
+#include <iprt/mem.h>
+#include <iprt/rand.h>
+#include <iprt/string.h>
+#include <iprt/test.h>
+#include <iprt/time.h>
+
+
+/*********************************************************************************************************************************
+*   Structures and Typedefs                                                                                                      *
+*********************************************************************************************************************************/
+/**
+ * A test entry which can live in an AVL and a B+tree at the same time, the
+ * AVL tree serving as reference.
+ */
+typedef struct TSTENTRY
+{
+    AVLRU64NODECORE     Avl;
+    RTBTREERU64NODECORE BTree;
+    /** Set while the entry is in the trees. */
+    bool                fInTree;
+    /** Padding, roughly the size of a block cache entry. */
+    uint8_t             abPadding[64];
+} TSTENTRY;
+typedef TSTENTRY *PTSTENTRY;
+
+/** DoWithAll callback state. */
+typedef struct TSTWALK
+{
+    uint64_t            KeyPrev;
+    uint32_t            cNodes;
+    bool                fFromLeft;
+    bool                fOrdered;
+} TSTWALK;
+
+
+/*********************************************************************************************************************************
+*   Global Variables                                                                                                             *
+*********************************************************************************************************************************/
+static RTRAND g_hRand;
+
+
+static PTSTENTRY tstFromBTree(PRTBTREERU64NODECORE pCore)
+{
+    return pCore ? RT_FROM_MEMBER(pCore, TSTENTRY, BTree) : NULL;
+}
+
+
+static PTSTENTRY tstFromAvl(PAVLRU64NODECORE pCore)
+{
+    return pCore ? RT_FROM_MEMBER(pCore, TSTENTRY, Avl) : NULL;
+}
+
+
+static DECLCALLBACK(int) tstWalkCallback(PRTBTREERU64NODECORE pNode, void *pvUser)
+{
+    TSTWALK *pWalk = (TSTWALK *)pvUser;
+    if (   pWalk->cNodes > 0
+        && (pWalk->fFromLeft ? pNode->Key <= pWalk->KeyPrev : pNode->Key >= pWalk->KeyPrev))
+        pWalk->fOrdered = false;
+    pWalk->KeyPrev = pNode->Key;
+    pWalk->cNodes++;
+    return VINF_SUCCESS;
+}
+
+
+static DECLCALLBACK(int) tstStopCallback(PRTBTREERU64NODECORE pNode, void *pvUser)
+{
+    RT_NOREF(pNode);
+    return ++*(uint32_t *)pvUser == 10 ? VERR_CALLBACK_RETURN : VINF_SUCCESS;
+}
+
+
+static DECLCALLBACK(int) tstDestroyCallback(PRTBTREERU64NODECORE pNode, void *pvUser)
+{
+    tstFromBTree(pNode)->fInTree = false;
+    ++*(uint32_t *)pvUser;
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Basic API tests.
+ */
+static void tst1(void)
+{
+    RTTestISub("Basics");
+
+    RTBTREERU64TREE Tree = RTBTREERU64TREE_INITIALIZER;
+    RTTESTI_CHECK(RTBTreeRU64Get(&Tree, 0) == NULL);
+    RTTESTI_CHECK(RTBTreeRU64RangeGet(&Tree, 0) == NULL);
+    RTTESTI_CHECK(RTBTreeRU64GetBestFit(&Tree, 0, true) == NULL);
+    RTTESTI_CHECK(RTBTreeRU64Remove(&Tree, 0) == NULL);
+
+    /* Ranges [i*16, i*16+7] for i = 0..999, inserted in a scrambled order. */
+    uint32_t const cEntries = 1000;
+    PTSTENTRY paEntries = (PTSTENTRY)RTMemAllocZ(cEntries * sizeof(TSTENTRY));
+    RTTESTI_CHECK_RETV(paEntries);
+    for (uint32_t j = 0; j < cEntries; j++)
+    {
+        uint32_t const i = (j * 367) % cEntries;
+        paEntries[i].BTree.Key     = i * 16;
+        paEntries[i].BTree.KeyLast = i * 16 + 7;
+        RTTESTI_CHECK_RC(RTBTreeRU64Insert(&Tree, &paEntries[i].BTree), VINF_SUCCESS);
+    }
+    RTTESTI_CHECK(Tree.cEntries == cEntries);
+    RTTESTI_CHECK(Tree.cDepth > 1);
+
+    /* Overlapping inserts must fail. */
+    TSTENTRY Extra;
+    Extra.BTree.Key = 16 * 5 + 7; Extra.BTree.KeyLast = 16 * 5 + 8;
+    RTTESTI_CHECK_RC(RTBTreeRU64Insert(&Tree, &Extra.BTree), VERR_ALREADY_EXISTS);
+    Extra.BTree.Key = 16 * 5 + 8; Extra.BTree.KeyLast = 16 * 6;
+    RTTESTI_CHECK_RC(RTBTreeRU64Insert(&Tree, &Extra.BTree), VERR_ALREADY_EXISTS);
+    Extra.BTree.Key = 16 * 5;     Extra.BTree.KeyLast = 16 * 5;
+    RTTESTI_CHECK_RC(RTBTreeRU64Insert(&Tree, &Extra.BTree), VERR_ALREADY_EXISTS);
+    Extra.BTree.Key = 16 * 5 + 8; Extra.BTree.KeyLast = 16 * 5 + 15;
+    RTTESTI_CHECK_RC(RTBTreeRU64Insert(&Tree, &Extra.BTree), VINF_SUCCESS);
+    RTTESTI_CHECK(RTBTreeRU64Remove(&Tree, 16 * 5 + 8) == &Extra.BTree);
+    RTTESTI_CHECK(Tree.cEntries == cEntries);
+
+    /* Lookups. */
+    for (uint32_t i = 0; i < cEntries; i++)
+    {
+        RTTESTI_CHECK(RTBTreeRU64Get(&Tree, i * 16) == &paEntries[i].BTree);
+        RTTESTI_CHECK(RTBTreeRU64Get(&Tree, i * 16 + 1) == NULL);
+        RTTESTI_CHECK(RTBTreeRU64RangeGet(&Tree, i * 16 + 7) == &paEntries[i].BTree);
+        RTTESTI_CHECK(RTBTreeRU64RangeGet(&Tree, i * 16 + 8) == NULL);
+        RTTESTI_CHECK(RTBTreeRU64GetBestFit(&Tree, i * 16 + 8, false /*fAbove*/) == &paEntries[i].BTree);
+        RTTESTI_CHECK(RTBTreeRU64GetBestFit(&Tree, i * 16, true /*fAbove*/) == &paEntries[i].BTree);
+        RTTESTI_CHECK(RTBTreeRU64GetBestFit(&Tree, i * 16 + 1, true /*fAbove*/)
+                      == (i + 1 < cEntries ? &paEntries[i + 1].BTree : NULL));
+    }
+
+    /* Enumeration. */
+    TSTWALK Walk = { 0, 0, true, true };
+    RTTESTI_CHECK_RC(RTBTreeRU64DoWithAll(&Tree, true /*fFromLeft*/, tstWalkCallback, &Walk), VINF_SUCCESS);
+    RTTESTI_CHECK(Walk.cNodes == cEntries && Walk.fOrdered);
+    TSTWALK WalkRev = { 0, 0, false, true };
+    RTTESTI_CHECK_RC(RTBTreeRU64DoWithAll(&Tree, false /*fFromLeft*/, tstWalkCallback, &WalkRev), VINF_SUCCESS);
+    RTTESTI_CHECK(WalkRev.cNodes == cEntries && WalkRev.fOrdered);
+    uint32_t cCalls = 0;
+    RTTESTI_CHECK_RC(RTBTreeRU64DoWithAll(&Tree, true /*fFromLeft*/, tstStopCallback, &cCalls), VERR_CALLBACK_RETURN);
+    RTTESTI_CHECK(cCalls == 10);
+
+    /* Remove every other entry, then the rest through RangeRemove. */
+    for (uint32_t i = 0; i < cEntries; i += 2)
+        RTTESTI_CHECK(RTBTreeRU64Remove(&Tree, i * 16) == &paEntries[i].BTree);
+    RTTESTI_CHECK(Tree.cEntries == cEntries / 2);
+    for (uint32_t i = 0; i < cEntries; i++)
+        RTTESTI_CHECK(RTBTreeRU64RangeGet(&Tree, i * 16 + 3) == (i & 1 ? &paEntries[i].BTree : NULL));
+    for (uint32_t i = 1; i < cEntries; i += 2)
+        RTTESTI_CHECK(RTBTreeRU64RangeRemove(&Tree, i * 16 + 5) == &paEntries[i].BTree);
+    RTTESTI_CHECK(Tree.cEntries == 0);
+    RTTESTI_CHECK(Tree.pvRoot == NULL);
+
+    /* Destroy. */
+    for (uint32_t i = 0; i < cEntries; i++)
+    {
+        RTTESTI_CHECK_RC(RTBTreeRU64Insert(&Tree, &paEntries[i].BTree), VINF_SUCCESS);
+        paEntries[i].fInTree = true;
+    }
+    cCalls = 0;
+    RTTESTI_CHECK_RC(RTBTreeRU64Destroy(&Tree, tstDestroyCallback, &cCalls), VINF_SUCCESS);
+    RTTESTI_CHECK(cCalls == cEntries);
+    RTTESTI_CHECK(Tree.pvRoot == NULL && Tree.cEntries == 0);
+    for (uint32_t i = 0; i < cEntries; i++)
+        RTTESTI_CHECK(!paEntries[i].fInTree);
+
+    RTMemFree(paEntries);
+}
+
+
+/**
+ * Random operations, checking every result against the AVL tree.
+ */
+static void tst2(uint32_t cEntries, uint64_t uKeyMax)
+{
+    RTTestISubF("Random, %u entries, keys < %#RX64", cEntries, uKeyMax);
+
+    PTSTENTRY paEntries = (PTSTENTRY)RTMemAllocZ(cEntries * sizeof(TSTENTRY));
+    RTTESTI_CHECK_RETV(paEntries);
+
+    RTBTREERU64TREE BTree  = RTBTREERU64TREE_INITIALIZER;
+    AVLRU64TREE     AvlTree = NULL;
+    uint32_t        cInTree = 0;
+
+    for (uint32_t iOp = 0; iOp < cEntries * 20; iOp++)
+    {
+        PTSTENTRY pEntry = &paEntries[RTRandAdvU32Ex(g_hRand, 0, cEntries - 1)];
+        if (!pEntry->fInTree)
+        {
+            uint64_t const Key  = RTRandAdvU64Ex(g_hRand, 0, uKeyMax);
+            uint64_t const cKey = RTRandAdvU32Ex(g_hRand, 0, 15);
+            pEntry->Avl.Key       = pEntry->BTree.Key     = Key;
+            pEntry->Avl.KeyLast   = pEntry->BTree.KeyLast = cKey <= uKeyMax - Key ? Key + cKey : uKeyMax;
+            bool const fAvl = RTAvlrU64Insert(&AvlTree, &pEntry->Avl);
+            int  const rc   = RTBTreeRU64Insert(&BTree, &pEntry->BTree);
+            RTTESTI_CHECK_MSG_RETV(fAvl ? rc == VINF_SUCCESS : rc == VERR_ALREADY_EXISTS,
+                                   ("iOp=%u Key=%#RX64 fAvl=%d rc=%Rrc\n", iOp, Key, fAvl, rc));
+            if (fAvl)
+            {
+                pEntry->fInTree = true;
+                cInTree++;
+            }
+        }
+        else if (RTRandAdvU32Ex(g_hRand, 0, 1))
+        {
+            RTTESTI_CHECK_RETV(RTBTreeRU64Remove(&BTree, pEntry->BTree.Key) == &pEntry->BTree);
+            RTTESTI_CHECK_RETV(RTAvlrU64Remove(&AvlTree, pEntry->Avl.Key) == &pEntry->Avl);
+            pEntry->fInTree = false;
+            cInTree--;
+        }
+        else
+        {
+            uint64_t const Key = pEntry->BTree.Key + RTRandAdvU32Ex(g_hRand, 0, (uint32_t)(pEntry->BTree.KeyLast - pEntry->BTree.Key));
+            RTTESTI_CHECK_RETV(RTBTreeRU64RangeRemove(&BTree, Key) == &pEntry->BTree);
+            RTTESTI_CHECK_RETV(RTAvlrU64RangeRemove(&AvlTree, Key) == &pEntry->Avl);
+            pEntry->fInTree = false;
+            cInTree--;
+        }
+        RTTESTI_CHECK_RETV(BTree.cEntries == cInTree);
+
+        /* Random queries. */
+        for (unsigned iQuery = 0; iQuery < 4; iQuery++)
+        {
+            uint64_t const Key = RTRandAdvU64Ex(g_hRand, 0, uKeyMax);
+            RTTESTI_CHECK_RETV(   tstFromBTree(RTBTreeRU64Get(&BTree, Key))
+                               == tstFromAvl(RTAvlrU64Get(&AvlTree, Key)));
+            RTTESTI_CHECK_RETV(   tstFromBTree(RTBTreeRU64RangeGet(&BTree, Key))
+                               == tstFromAvl(RTAvlrU64RangeGet(&AvlTree, Key)));
+            RTTESTI_CHECK_RETV(   tstFromBTree(RTBTreeRU64GetBestFit(&BTree, Key, true))
+                               == tstFromAvl(RTAvlrU64GetBestFit(&AvlTree, Key, true)));
+            RTTESTI_CHECK_RETV(   tstFromBTree(RTBTreeRU64GetBestFit(&BTree, Key, false))
+                               == tstFromAvl(RTAvlrU64GetBestFit(&AvlTree, Key, false)));
+        }
+    }
+
+    TSTWALK Walk = { 0, 0, true, true };
+    RTTESTI_CHECK_RC(RTBTreeRU64DoWithAll(&BTree, true /*fFromLeft*/, tstWalkCallback, &Walk), VINF_SUCCESS);
+    RTTESTI_CHECK(Walk.cNodes == cInTree && Walk.fOrdered);
+
+    /* Drain the tree in random order, which exercises all the rebalancing. */
+    while (cInTree > 0)
+    {
+        PTSTENTRY pEntry = &paEntries[RTRandAdvU32Ex(g_hRand, 0, cEntries - 1)];
+        if (pEntry->fInTree)
+        {
+            RTTESTI_CHECK_RETV(RTBTreeRU64Remove(&BTree, pEntry->BTree.Key) == &pEntry->BTree);
+            RTTESTI_CHECK_RETV(RTAvlrU64Remove(&AvlTree, pEntry->Avl.Key) == &pEntry->Avl);
+            pEntry->fInTree = false;
+            cInTree--;
+            RTTESTI_CHECK_RETV(RTBTreeRU64Get(&BTree, pEntry->BTree.Key) == NULL);
+        }
+    }
+    RTTESTI_CHECK(BTree.pvRoot == NULL && BTree.cDepth == 0 && BTree.cEntries == 0);
+    RTTESTI_CHECK(AvlTree == NULL);
+
+    RTMemFree(paEntries);
+}
+
+
+/**
+ * Benchmarks the trees with the access pattern of the PDM block cache index:
+ * variable sized, non-overlapping ranges of file offsets, looked up with
+ * RangeGet and GetBestFit(fAbove) on a miss, and entries evicted and
+ * re-inserted all the time.
+ */
+static void tst3(uint32_t cEntries)
+{
+    RTTestISubF("Block cache benchmark, %u entries", cEntries);
+
+    /* Individually allocated entries, like the cache does. */
+    PTSTENTRY *papEntries = (PTSTENTRY *)RTMemAllocZ(cEntries * sizeof(PTSTENTRY));
+    RTTESTI_CHECK_RETV(papEntries);
+    uint64_t off = 0;
+    for (uint32_t i = 0; i < cEntries; i++)
+    {
+        papEntries[i] = (PTSTENTRY)RTMemAllocZ(sizeof(TSTENTRY));
+        RTTESTI_CHECK_RETV(papEntries[i]);
+        uint64_t const cb = (uint64_t)RTRandAdvU32Ex(g_hRand, 1, 16) * _4K;
+        papEntries[i]->Avl.Key     = papEntries[i]->BTree.Key     = off;
+        papEntries[i]->Avl.KeyLast = papEntries[i]->BTree.KeyLast = off + cb - 1;
+        off += cb + (RTRandAdvU32Ex(g_hRand, 0, 3) == 0 ? _64K : 0); /* some holes */
+    }
+    uint64_t const cbFile = off;
+
+    /* Insert in random order. */
+    for (uint32_t i = cEntries - 1; i > 0; i--)
+    {
+        uint32_t j = RTRandAdvU32Ex(g_hRand, 0, i);
+        PTSTENTRY pTmp = papEntries[i]; papEntries[i] = papEntries[j]; papEntries[j] = pTmp;
+    }
+
+    AVLRU64TREE     AvlTree = NULL;
+    RTBTREERU64TREE BTree   = RTBTREERU64TREE_INITIALIZER;
+    uint64_t nsStart = RTTimeNanoTS();
+    for (uint32_t i = 0; i < cEntries; i++)
+        RTAvlrU64Insert(&AvlTree, &papEntries[i]->Avl);
+    uint64_t const nsAvlInsert = RTTimeNanoTS() - nsStart;
+    nsStart = RTTimeNanoTS();
+    for (uint32_t i = 0; i < cEntries; i++)
+        RTTESTI_CHECK_RC_RETV(RTBTreeRU64Insert(&BTree, &papEntries[i]->BTree), VINF_SUCCESS);
+    uint64_t const nsBTreeInsert = RTTimeNanoTS() - nsStart;
+    RTTestIValue("AVL insert", nsAvlInsert / cEntries, RTTESTUNIT_NS_PER_CALL);
+    RTTestIValue("B+tree insert", nsBTreeInsert / cEntries, RTTESTUNIT_NS_PER_CALL);
+
+    /* Lookups of random offsets, with the best fit query on a miss. */
+    uint32_t const cLookups = 1000000;
+    uint64_t *pauOffsets = (uint64_t *)RTMemAlloc(cLookups * sizeof(uint64_t));
+    RTTESTI_CHECK_RETV(pauOffsets);
+    for (uint32_t i = 0; i < cLookups; i++)
+        pauOffsets[i] = RTRandAdvU64Ex(g_hRand, 0, cbFile - 1);
+
+    uintptr_t uSumAvl = 0;
+    nsStart = RTTimeNanoTS();
+    for (uint32_t i = 0; i < cLookups; i++)
+    {
+        PAVLRU64NODECORE pCore = RTAvlrU64RangeGet(&AvlTree, pauOffsets[i]);
+        if (!pCore)
+            pCore = RTAvlrU64GetBestFit(&AvlTree, pauOffsets[i], true /*fAbove*/);
+        uSumAvl += (uintptr_t)tstFromAvl(pCore);
+    }
+    uint64_t const nsAvlLookup = RTTimeNanoTS() - nsStart;
+
+    uintptr_t uSumBTree = 0;
+    nsStart = RTTimeNanoTS();
+    for (uint32_t i = 0; i < cLookups; i++)
+    {
+        PRTBTREERU64NODECORE pCore = RTBTreeRU64RangeGet(&BTree, pauOffsets[i]);
+        if (!pCore)
+            pCore = RTBTreeRU64GetBestFit(&BTree, pauOffsets[i], true /*fAbove*/);
+        uSumBTree += (uintptr_t)tstFromBTree(pCore);
+    }
+    uint64_t const nsBTreeLookup = RTTimeNanoTS() - nsStart;
+    RTTESTI_CHECK(uSumAvl == uSumBTree);
+    RTTestIValue("AVL lookup", nsAvlLookup / cLookups, RTTESTUNIT_NS_PER_CALL);
+    RTTestIValue("B+tree lookup", nsBTreeLookup / cLookups, RTTESTUNIT_NS_PER_CALL);
+
+    /* Eviction and re-insertion. */
+    uint32_t const cChurn = RT_MIN(cEntries, 100000);
+    nsStart = RTTimeNanoTS();
+    for (uint32_t i = 0; i < cChurn; i++)
+    {
+        RTAvlrU64Remove(&AvlTree, papEntries[i]->Avl.Key);
+        RTAvlrU64Insert(&AvlTree, &papEntries[i]->Avl);
+    }
+    uint64_t const nsAvlChurn = RTTimeNanoTS() - nsStart;
+    nsStart = RTTimeNanoTS();
+    for (uint32_t i = 0; i < cChurn; i++)
+    {
+        RTBTreeRU64Remove(&BTree, papEntries[i]->BTree.Key);
+        RTBTreeRU64Insert(&BTree, &papEntries[i]->BTree);
+    }
+    uint64_t const nsBTreeChurn = RTTimeNanoTS() - nsStart;
+    RTTESTI_CHECK(BTree.cEntries == cEntries);
+    RTTestIValue("AVL remove+insert", nsAvlChurn / cChurn, RTTESTUNIT_NS_PER_CALL);
+    RTTestIValue("B+tree remove+insert", nsBTreeChurn / cChurn, RTTESTUNIT_NS_PER_CALL);
+
+    RTTESTI_CHECK_RC(RTBTreeRU64Destroy(&BTree, NULL, NULL), VINF_SUCCESS);
+    RTMemFree(pauOffsets);
+    for (uint32_t i = 0; i < cEntries; i++)
+        RTMemFree(papEntries[i]);
+    RTMemFree(papEntries);
+}
+
+
+int main()
+{
+    RTTEST hTest;
+    RTEXITCODE rcExit = RTTestInitAndCreate("tstRTBTree", &hTest);
+    if (rcExit != RTEXITCODE_SUCCESS)
+        return rcExit;
+    RTTestBanner(hTest);
+
+    int rc = RTRandAdvCreateParkMiller(&g_hRand);
+    if (RT_FAILURE(rc))
+    {
+        RTTestIFailed("RTRandAdvCreateParkMiller -> %Rrc", rc);
+        return RTTestSummaryAndDestroy(hTest);
+    }
+
+    tst1();
+    tst2(64, 1024);
+    tst2(4096, _64K);
+    tst2(20000, UINT64_MAX);
+    if (RTTestIErrorCount() == 0)
+    {
+        tst3(1000);
+        tst3(20000);
+        tst3(200000);
+    }
+
+    RTRandAdvDestroy(g_hRand);
+    return RTTestSummaryAndDestroy(hTest);
+}
+
@@ -0,0 +1,181 @@
+/* $Id$ */
+/** @file
+ * IPRT Testcase - CRC32, CRC32C and CRC64.
+ */
+
+/*
+ * Copyright (C) 2016 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ *
+ * The contents of this file may alternatively be used under the terms
+ * of the Common Development and Distribution License Version 1.0
+ * (CDDL) only, as it comes in the "COPYING.CDDL" file of the
+ * VirtualBox OSE distribution, in which case the provisions of the
+ * CDDL are applicable instead of those of the GPL.
+ *
+ * You may elect to license modified versions of this file under the
+ * terms and conditions of either the GPL or the CDDL or both.
+ */
+
+
+/*********************************************************************************************************************************
+*   Header Files                                                                                                                 *
+*********************************************************************************************************************************/
+#include <iprt/crc.h>
+
+#include <iprt/err.h>
+#include <iprt/rand.h>
+#include <iprt/string.h>
+#include <iprt/test.h>
+#include <iprt/thread.h>
+#include <iprt/time.h>
+
+
+/*********************************************************************************************************************************
+*   Global Variables                                                                                                             *
+*********************************************************************************************************************************/
+/** Random test data, a little extra for misaligning it. */
+static uint8_t g_abData[_64K + 64];
+
+
+/*
+ * Bit-at-a-time reference implementations.
+ */
+
+static uint32_t tstRefCrc32(uint32_t uPoly, const uint8_t *pb, size_t cb)
+{
+    uint32_t uReg = ~0U;
+    while (cb-- > 0)
+    {
+        uReg ^= *pb++;
+        for (unsigned iBit = 0; iBit < 8; iBit++)
+            uReg = uReg & 1 ? (uReg >> 1) ^ uPoly : uReg >> 1;
+    }
+    return ~uReg;
+}
+
+
+static uint64_t tstRefCrc64(const uint8_t *pb, size_t cb)
+{
+    uint64_t uReg = 0;
+    while (cb-- > 0)
+    {
+        uReg ^= *pb++;
+        for (unsigned iBit = 0; iBit < 8; iBit++)
+            uReg = uReg & 1 ? (uReg >> 1) ^ UINT64_C(0xd800000000000000) : uReg >> 1;
+    }
+    return uReg;
+}
+
+
+/**
+ * Checks the three CRCs against the reference implementations for various
+ * sizes and alignments, in one go and split into two pieces.
+ */
+static void tstCorrectness(void)
+{
+    RTTestISub("Correctness");
+
+    /* The usual check values. */
+    RTTESTI_CHECK(RTCrc32("123456789", 9)  == UINT32_C(0xcbf43926));
+    RTTESTI_CHECK(RTCrc32C("123456789", 9) == UINT32_C(0xe3069283));
+    RTTESTI_CHECK(RTCrc64("123456789", 9)  == UINT64_C(0x46a5a9388a5beffe));
+
+    uint32_t cErrors = 0;
+    for (size_t cb = 0; cb <= 4096 && cErrors < 8; cb += cb < 300 ? 1 : 61)
+        for (unsigned off = 0; off < 16 && cErrors < 8; off += 5)
+        {
+            uint8_t const  *pb       = &g_abData[off];
+            uint32_t const  uCrc32   = tstRefCrc32(UINT32_C(0xedb88320), pb, cb);
+            uint32_t const  uCrc32C  = tstRefCrc32(UINT32_C(0x82f63b78), pb, cb);
+            uint64_t const  uCrc64   = tstRefCrc64(pb, cb);
+            size_t const    cbFirst  = cb / 3;
+
+            uint32_t u32 = RTCrc32(pb, cb);
+            if (u32 != uCrc32 && cErrors++ < 8)
+                RTTestIFailed("RTCrc32(+%u, %zu) -> %#010RX32, expected %#010RX32", off, cb, u32, uCrc32);
+            u32 = RTCrc32Process(RTCrc32Start(), pb, cbFirst);
+            if (u32 != tstRefCrc32(UINT32_C(0xedb88320), pb, cbFirst) && cErrors++ < 8)
+                RTTestIFailed("RTCrc32Process(+%u, %zu): intermediate %#010RX32 is not the CRC so far", off, cbFirst, u32);
+            u32 = RTCrc32Finish(RTCrc32Process(u32, pb + cbFirst, cb - cbFirst));
+            if (u32 != uCrc32 && cErrors++ < 8)
+                RTTestIFailed("RTCrc32Process(+%u, %zu) -> %#010RX32, expected %#010RX32", off, cb, u32, uCrc32);
+
+            u32 = RTCrc32C(pb, cb);
+            if (u32 != uCrc32C && cErrors++ < 8)
+                RTTestIFailed("RTCrc32C(+%u, %zu) -> %#010RX32, expected %#010RX32", off, cb, u32, uCrc32C);
+            u32 = RTCrc32CProcess(RTCrc32CStart(), pb, cbFirst);
+            u32 = RTCrc32CFinish(RTCrc32CProcess(u32, pb + cbFirst, cb - cbFirst));
+            if (u32 != uCrc32C && cErrors++ < 8)
+                RTTestIFailed("RTCrc32CProcess(+%u, %zu) -> %#010RX32, expected %#010RX32", off, cb, u32, uCrc32C);
+
+            uint64_t u64 = RTCrc64(pb, cb);
+            if (u64 != uCrc64 && cErrors++ < 8)
+                RTTestIFailed("RTCrc64(+%u, %zu) -> %#018RX64, expected %#018RX64", off, cb, u64, uCrc64);
+            u64 = RTCrc64Process(RTCrc64Start(), pb, cbFirst);
+            u64 = RTCrc64Finish(RTCrc64Process(u64, pb + cbFirst, cb - cbFirst));
+            if (u64 != uCrc64 && cErrors++ < 8)
+                RTTestIFailed("RTCrc64Process(+%u, %zu) -> %#018RX64, expected %#018RX64", off, cb, u64, uCrc64);
+        }
+}
+
+
+/** Benchmark wrappers. */
+static uint64_t tstBenchCrc32(const void *pv, size_t cb)  { return RTCrc32(pv, cb); }
+static uint64_t tstBenchCrc32C(const void *pv, size_t cb) { return RTCrc32C(pv, cb); }
+static uint64_t tstBenchCrc64(const void *pv, size_t cb)  { return RTCrc64(pv, cb); }
+
+
+/**
+ * Measures the throughput of a CRC function for a few buffer sizes.
+ */
+static void tstBenchmark(const char *pszName, uint64_t (*pfnCrc)(const void *, size_t))
+{
+    static size_t const s_acbBufs[] = { 64, 512, 4096, _64K };
+    for (unsigned i = 0; i < RT_ELEMENTS(s_acbBufs); i++)
+    {
+        size_t const   cbBuf  = s_acbBufs[i];
+        uint32_t const cCalls = (uint32_t)(_256M / 4 / cbBuf);
+        uint64_t       uSum   = 0;
+
+        RTThreadYield();
+        uint64_t const nsStart = RTTimeNanoTS();
+        for (uint32_t iCall = 0; iCall < cCalls; iCall++)
+            uSum += pfnCrc(g_abData, cbBuf);
+        uint64_t const cNsElapsed = RT_MAX(RTTimeNanoTS() - nsStart, 1);
+
+        RTTestIValueF((uint64_t)cCalls * cbBuf * RT_NS_1SEC / _1M / cNsElapsed, RTTESTUNIT_MEGABYTES_PER_SEC,
+                      "%s %zu bytes (%#RX64)", pszName, cbBuf, uSum & 0xff);
+    }
+}
+
+
+int main()
+{
+    RTTEST hTest;
+    RTEXITCODE rcExit = RTTestInitAndCreate("tstRTCrc", &hTest);
+    if (rcExit != RTEXITCODE_SUCCESS)
+        return rcExit;
+    RTTestBanner(hTest);
+
+    RTRandBytes(g_abData, sizeof(g_abData));
+    tstCorrectness();
+
+    if (RTTestErrorCount(hTest) == 0)
+    {
+        RTTestISub("Benchmark");
+        tstBenchmark("RTCrc32",  tstBenchCrc32);
+        tstBenchmark("RTCrc32C", tstBenchCrc32C);
+        tstBenchmark("RTCrc64",  tstBenchCrc64);
+    }
+
+    return RTTestSummaryAndDestroy(hTest);
+}
+
@@ -61,6 +61,13 @@ typedef struct TESTRTDIGEST
 *********************************************************************************************************************************/
 #include "72kb-random.h"
 
+/** Buffer of 'a's for the FIPS 180-2 one million 'a's test (with some slack
+ * for misaligning it), initialized by main. */
+static char g_achMillionA[1024 + 4];
+/** The chunk sizes to feed the one million 'a's in, picked to cross the
+ * block boundaries in different ways. */
+static uint32_t const g_acbMillionAChunks[] = { 1, 63, 64, 65, 128, 1000, 1024 };
+
 
 #define CHECK_STRING(a_pszActual, a_pszExpected) \
     do { \
@@ -620,6 +627,24 @@ static void testSha1(void)
     RTTESTI_CHECK_RC_RETV(RTSha1ToString(abHash, szDigest, sizeof(szDigest)), VINF_SUCCESS);
     CHECK_STRING(szDigest, "a9993e364706816aba3e25717850c26c9cd0d89d");
 
+    pszString = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+    RTSha1(pszString, strlen(pszString), abHash);
+    RTTESTI_CHECK_RC_RETV(RTSha1ToString(abHash, szDigest, sizeof(szDigest)), VINF_SUCCESS);
+    CHECK_STRING(szDigest, "84983e441c3bd26ebaae4aa1f95129e5e54670f1");
+
+    /* One million 'a's in odd sized and misaligned chunks (FIPS 180-2). */
+    RTSHA1CONTEXT Ctx;
+    RTSha1Init(&Ctx);
+    for (uint32_t i = 0, cbLeft = 1000000; cbLeft > 0; i++)
+    {
+        uint32_t const cbChunk = RT_MIN(cbLeft, g_acbMillionAChunks[i % RT_ELEMENTS(g_acbMillionAChunks)]);
+        RTSha1Update(&Ctx, &g_achMillionA[i % 3], cbChunk);
+        cbLeft -= cbChunk;
+    }
+    RTSha1Final(&Ctx, abHash);
+    RTTESTI_CHECK_RC_RETV(RTSha1ToString(abHash, szDigest, sizeof(szDigest)), VINF_SUCCESS);
+    CHECK_STRING(szDigest, "34aa973cd4c4daa4f61eeb2bdbad27316534016f");
+
 
     /*
      * Generic API tests.
@@ -789,6 +814,24 @@ static void testSha256(void)
     RTTESTI_CHECK_RC_RETV(RTSha256ToString(abHash, szDigest, sizeof(szDigest)), VINF_SUCCESS);
     CHECK_STRING(szDigest, "d7a8fbb307d7809469ca9abcb0082e4f8d5651e46d3cdb762d02d0bf37c9e592");
 
+    pszString = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+    RTSha256(pszString, strlen(pszString), abHash);
+    RTTESTI_CHECK_RC_RETV(RTSha256ToString(abHash, szDigest, sizeof(szDigest)), VINF_SUCCESS);
+    CHECK_STRING(szDigest, "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+
+    /* One million 'a's in odd sized and misaligned chunks (FIPS 180-2). */
+    RTSHA256CONTEXT Ctx;
+    RTSha256Init(&Ctx);
+    for (uint32_t i = 0, cbLeft = 1000000; cbLeft > 0; i++)
+    {
+        uint32_t const cbChunk = RT_MIN(cbLeft, g_acbMillionAChunks[i % RT_ELEMENTS(g_acbMillionAChunks)]);
+        RTSha256Update(&Ctx, &g_achMillionA[i % 3], cbChunk);
+        cbLeft -= cbChunk;
+    }
+    RTSha256Final(&Ctx, abHash);
+    RTTESTI_CHECK_RC_RETV(RTSha256ToString(abHash, szDigest, sizeof(szDigest)), VINF_SUCCESS);
+    CHECK_STRING(szDigest, "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+
     /*
      * Generic API tests.
      */
@@ -1259,6 +1302,7 @@ int main()
     if (rc)
         return rc;
     RTTestBanner(hTest);
+    memset(g_achMillionA, 'a', sizeof(g_achMillionA));
 
     testMd2();
     testMd5();
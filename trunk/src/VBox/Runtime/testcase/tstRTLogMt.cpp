@@ -0,0 +1,224 @@
+/* $Id$ */
+/** @file
+ * IPRT Testcase - Multi-threaded logging, synchronous vs. async.
+ */
+
+/*
+ * Copyright (C) 2016 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ *
+ * The contents of this file may alternatively be used under the terms
+ * of the Common Development and Distribution License Version 1.0
+ * (CDDL) only, as it comes in the "COPYING.CDDL" file of the
+ * VirtualBox OSE distribution, in which case the provisions of the
+ * CDDL are applicable instead of those of the GPL.
+ *
+ * You may elect to license modified versions of this file under the
+ * terms and conditions of either the GPL or the CDDL or both.
+ */
+
+
+/*********************************************************************************************************************************
+*   Header Files                                                                                                                 *
+*********************************************************************************************************************************/
+#include <iprt/log.h>
+
+#include <iprt/err.h>
+#include <iprt/file.h>
+#include <iprt/getopt.h>
+#include <iprt/initterm.h>
+#include <iprt/mem.h>
+#include <iprt/path.h>
+#include <iprt/process.h>
+#include <iprt/semaphore.h>
+#include <iprt/string.h>
+#include <iprt/test.h>
+#include <iprt/thread.h>
+#include <iprt/time.h>
+
+
+/*********************************************************************************************************************************
+*   Global Variables                                                                                                             *
+*********************************************************************************************************************************/
+static RTTEST           g_hTest;
+static PRTLOGGER        g_pLogger;
+static RTSEMEVENTMULTI  g_hEvtGo;
+static uint32_t         g_cMessages = 20000;
+static uint32_t         g_cThreads  = 8;
+
+
+static DECLCALLBACK(int) tstLogThread(RTTHREAD hThreadSelf, void *pvUser)
+{
+    uint32_t const iThread = (uint32_t)(uintptr_t)pvUser;
+    RT_NOREF_PV(hThreadSelf);
+
+    RTSemEventMultiWait(g_hEvtGo, RT_INDEFINITE_WAIT);
+    for (uint32_t i = 0; i < g_cMessages; i++)
+        RTLogLoggerEx(g_pLogger, 0, ~0U, "T%02u %08u some payload to make it look like a log line\n", iThread, i);
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Checks the log file: every thread's messages must be there in order, except
+ * for the ones reported as dropped.
+ */
+static void tstLogCheckFile(const char *pszPath, bool fMayDrop)
+{
+    void   *pvFile;
+    size_t  cbFile;
+    int rc = RTFileReadAll(pszPath, &pvFile, &cbFile);
+    RTTESTI_CHECK_RC_RETV(rc, VINF_SUCCESS);
+
+    uint32_t *paiNext = (uint32_t *)RTMemAllocZ(sizeof(uint32_t) * g_cThreads);
+    uint64_t  cLines  = 0;
+    uint64_t  cDropped = 0;
+    uint32_t  cErrors = 0;
+    char     *pszLine = (char *)pvFile;
+    char     *pszEnd  = pszLine + cbFile;
+    while (pszLine < pszEnd && paiNext)
+    {
+        char *pszEol = (char *)memchr(pszLine, '\n', pszEnd - pszLine);
+        if (!pszEol)
+            break;
+        *pszEol = '\0';
+
+        const char *pszDrop = strstr(pszLine, "messages dropped");
+        const char *pszMsg  = strchr(pszLine, 'T');
+        if (pszDrop)
+        {
+            const char *pszCount = strstr(pszLine, "Log: ");
+            if (pszCount)
+                cDropped += RTStrToUInt32(pszCount + sizeof("Log: ") - 1);
+        }
+        else if (pszMsg)
+        {
+            uint32_t iThread = RTStrToUInt32(pszMsg + 1);
+            uint32_t iMsg    = RTStrToUInt32(pszMsg + 4);
+            if (iThread >= g_cThreads)
+            {
+                if (cErrors++ < 8)
+                    RTTestIFailed("bad line: '%s'", pszLine);
+            }
+            else if (   iMsg != paiNext[iThread]
+                     && (!fMayDrop || iMsg < paiNext[iThread]))
+            {
+                if (cErrors++ < 8)
+                    RTTestIFailed("thread %u: got message %u, expected %u", iThread, iMsg, paiNext[iThread]);
+            }
+            else
+                paiNext[iThread] = iMsg + 1;
+            cLines++;
+        }
+        pszLine = pszEol + 1;
+    }
+
+    if (fMayDrop)
+        RTTESTI_CHECK_MSG(cLines + cDropped == (uint64_t)g_cThreads * g_cMessages,
+                          ("cLines=%RU64 cDropped=%RU64 expected=%RU64\n", cLines, cDropped, (uint64_t)g_cThreads * g_cMessages));
+    else
+        RTTESTI_CHECK_MSG(cLines == (uint64_t)g_cThreads * g_cMessages,
+                          ("cLines=%RU64 expected=%RU64\n", cLines, (uint64_t)g_cThreads * g_cMessages));
+    if (fMayDrop)
+        RTTestValue(g_hTest, "dropped", cDropped, RTTESTUNIT_OCCURRENCES);
+
+    RTMemFree(paiNext);
+    RTFileReadAllFree(pvFile, cbFile);
+}
+
+
+/**
+ * Runs all threads against a fresh logger with the given flags.
+ */
+static void tstLogRun(const char *pszName, const char *pszFlags, bool fMayDrop)
+{
+    RTTestSubF(g_hTest, "%s, %u threads", pszName, g_cThreads);
+
+    char szPath[RTPATH_MAX];
+    int rc = RTPathTemp(szPath, sizeof(szPath));
+    RTTESTI_CHECK_RC_RETV(rc, VINF_SUCCESS);
+    char szName[64];
+    RTStrPrintf(szName, sizeof(szName), "tstRTLogMt-%u.log", RTProcSelf());
+    rc = RTPathAppend(szPath, sizeof(szPath), szName);
+    RTTESTI_CHECK_RC_RETV(rc, VINF_SUCCESS);
+
+    rc = RTLogCreate(&g_pLogger, RTLOGFLAGS_BUFFERED, "all", NULL, 0, NULL, RTLOGDEST_FILE, "%s", szPath);
+    RTTESTI_CHECK_RC_RETV(rc, VINF_SUCCESS);
+    RTTESTI_CHECK_RC(RTLogFlags(g_pLogger, pszFlags), VINF_SUCCESS);
+    RTTESTI_CHECK_RC(RTSemEventMultiReset(g_hEvtGo), VINF_SUCCESS);
+
+    PRTTHREAD pahThreads = (PRTTHREAD)RTMemAllocZ(sizeof(RTTHREAD) * g_cThreads);
+    RTTESTI_CHECK_RETV(pahThreads);
+    for (uint32_t i = 0; i < g_cThreads; i++)
+        RTTESTI_CHECK_RC(rc = RTThreadCreateF(&pahThreads[i], tstLogThread, (void *)(uintptr_t)i, 0,
+                                              RTTHREADTYPE_DEFAULT, RTTHREADFLAGS_WAITABLE, "tstLog%u", i), VINF_SUCCESS);
+
+    uint64_t const nsStart = RTTimeNanoTS();
+    RTSemEventMultiSignal(g_hEvtGo);
+    for (uint32_t i = 0; i < g_cThreads; i++)
+        if (pahThreads[i] != NIL_RTTHREAD)
+            RTThreadWait(pahThreads[i], RT_INDEFINITE_WAIT, NULL);
+    uint64_t const nsProduced = RTTimeNanoTS() - nsStart;
+    RTLogFlush(g_pLogger);
+    uint64_t const nsWritten  = RTTimeNanoTS() - nsStart;
+
+    uint64_t const cTotal = (uint64_t)g_cThreads * g_cMessages;
+    RTTestValue(g_hTest, "producer time per message", nsProduced / cTotal, RTTESTUNIT_NS_PER_CALL);
+    RTTestValue(g_hTest, "messages per second", cTotal * RT_NS_1SEC / RT_MAX(nsWritten, 1), RTTESTUNIT_CALLS_PER_SEC);
+
+    RTTESTI_CHECK_RC(RTLogDestroy(g_pLogger), VINF_SUCCESS);
+    g_pLogger = NULL;
+    RTMemFree(pahThreads);
+
+    tstLogCheckFile(szPath, fMayDrop);
+    RTFileDelete(szPath);
+}
+
+
+int main(int argc, char **argv)
+{
+    RTEXITCODE rcExit = RTTestInitAndCreate("tstRTLogMt", &g_hTest);
+    if (rcExit != RTEXITCODE_SUCCESS)
+        return rcExit;
+
+    static const RTGETOPTDEF s_aOptions[] =
+    {
+        { "--threads",  't', RTGETOPT_REQ_UINT32 },
+        { "--messages", 'm', RTGETOPT_REQ_UINT32 },
+    };
+    RTGETOPTSTATE   GetState;
+    RTGETOPTUNION   ValueUnion;
+    int             ch;
+    RTGetOptInit(&GetState, argc, argv, s_aOptions, RT_ELEMENTS(s_aOptions), 1, RTGETOPTINIT_FLAGS_NO_STD_OPTS);
+    while ((ch = RTGetOpt(&GetState, &ValueUnion)) != 0)
+    {
+        switch (ch)
+        {
+            case 't': g_cThreads  = RT_MAX(ValueUnion.u32, 1); break;
+            case 'm': g_cMessages = RT_MAX(ValueUnion.u32, 1); break;
+            default:
+                return RTGetOptPrintError(ch, &ValueUnion);
+        }
+    }
+    if (g_cThreads > 99)
+        g_cThreads = 99;
+    RTTestBanner(g_hTest);
+
+    int rc = RTSemEventMultiCreate(&g_hEvtGo);
+    RTTESTI_CHECK_RC_RET(rc, VINF_SUCCESS, RTTestSummaryAndDestroy(g_hTest));
+
+    tstLogRun("synchronous",      "ts",                 false);
+    tstLogRun("async",            "ts async",           false);
+    tstLogRun("async, drop",      "ts async asyncdrop", true);
+
+    RTSemEventMultiDestroy(g_hEvtGo);
+    return RTTestSummaryAndDestroy(g_hTest);
+}
+
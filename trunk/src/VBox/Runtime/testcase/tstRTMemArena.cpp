@@ -0,0 +1,214 @@
+/* $Id$ */
+/** @file
+ * IPRT Testcase - RTMemArena.
+ */
+
+/*
+ * Copyright (C) 2016 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ *
+ * The contents of this file may alternatively be used under the terms
+ * of the Common Development and Distribution License Version 1.0
+ * (CDDL) only, as it comes in the "COPYING.CDDL" file of the
+ * VirtualBox OSE distribution, in which case the provisions of the
+ * CDDL are applicable instead of those of the GPL.
+ *
+ * You may elect to license modified versions of this file under the
+ * terms and conditions of either the GPL or the CDDL or both.
+ */
+
+
+/*********************************************************************************************************************************
+*   Header Files                                                                                                                 *
+*********************************************************************************************************************************/
+#include <iprt/memarena.h>
+
+#include <iprt/asm.h>
+#include <iprt/err.h>
+#include <iprt/mem.h>
+#include <iprt/string.h>
+#include <iprt/test.h>
+#include <iprt/time.h>
+
+
+/**
+ * Basic API checks.
+ */
+static void tst1(void)
+{
+    RTTestISub("Basics");
+
+    RTMEMARENA hArena;
+    RTTESTI_CHECK_RC_RETV(RTMemArenaCreate(&hArena, 0 /*cbChunk*/, 0 /*fFlags*/), VINF_SUCCESS);
+    RTTESTI_CHECK_RETV(hArena != NIL_RTMEMARENA);
+
+    /* Alignment and no overlap. */
+    uint8_t *apb[64];
+    for (unsigned i = 0; i < RT_ELEMENTS(apb); i++)
+    {
+        apb[i] = (uint8_t *)RTMemArenaAlloc(hArena, i + 1);
+        RTTESTI_CHECK_RETV(apb[i] != NULL);
+        RTTESTI_CHECK(RT_ALIGN_P(apb[i], RTMEM_ALIGNMENT) == apb[i]);
+        memset(apb[i], i, i + 1);
+    }
+    for (unsigned i = 0; i < RT_ELEMENTS(apb); i++)
+        RTTESTI_CHECK(ASMMemIsAllU8(apb[i], i + 1, (uint8_t)i));
+
+    uint8_t *pb = (uint8_t *)RTMemArenaAllocZ(hArena, 100);
+    RTTESTI_CHECK(pb && ASMMemIsZero(pb, 100));
+    RTTESTI_CHECK(RTMemArenaAlloc(hArena, 0) != NULL);
+
+    /* Mark and reset to it: the memory after the mark is handed out again. */
+    RTMEMARENAMARK Mark;
+    RTMemArenaMark(hArena, &Mark);
+    void *pv1 = RTMemArenaAlloc(hArena, 32);
+    void *pvLarge = RTMemArenaAlloc(hArena, _64K);
+    RTTESTI_CHECK(pvLarge != NULL);
+    if (pvLarge)
+        memset(pvLarge, 0xf6, _64K);
+    RTMemArenaResetToMark(hArena, &Mark);
+    void *pv2 = RTMemArenaAlloc(hArena, 32);
+    RTTESTI_CHECK(pv1 == pv2);
+    for (unsigned i = 0; i < RT_ELEMENTS(apb); i++)
+        RTTESTI_CHECK(ASMMemIsAllU8(apb[i], i + 1, (uint8_t)i));
+
+    RTMEMARENASTATS Stats;
+    RTTESTI_CHECK_RC(RTMemArenaQueryStats(hArena, &Stats), VINF_SUCCESS);
+    RTTESTI_CHECK(Stats.cbReserved < _64K); /* the large block is gone */
+    RTTESTI_CHECK(Stats.cResets == 1);
+    RTTESTI_CHECK(Stats.cAllocs == RT_ELEMENTS(apb) + 5);
+
+    /* Spread over several chunks, reset, and make sure the chunks are reused. */
+    for (unsigned i = 0; i < 4096; i++)
+        RTTESTI_CHECK_RETV(RTMemArenaAlloc(hArena, 48) != NULL);
+    RTTESTI_CHECK_RC(RTMemArenaQueryStats(hArena, &Stats), VINF_SUCCESS);
+    uint64_t const cHeapAllocs = Stats.cHeapAllocs;
+    RTTESTI_CHECK(cHeapAllocs > 4);
+
+    for (unsigned iLoop = 0; iLoop < 16; iLoop++)
+    {
+        RTMemArenaReset(hArena);
+        for (unsigned i = 0; i < 4096; i++)
+            RTTESTI_CHECK_RETV(RTMemArenaAlloc(hArena, 48) != NULL);
+    }
+    RTTESTI_CHECK_RC(RTMemArenaQueryStats(hArena, &Stats), VINF_SUCCESS);
+    RTTESTI_CHECK_MSG(Stats.cHeapAllocs == cHeapAllocs, ("%RU64 vs %RU64\n", Stats.cHeapAllocs, cHeapAllocs));
+
+    RTMemArenaReset(hArena);
+    RTTESTI_CHECK_RC(RTMemArenaQueryStats(hArena, &Stats), VINF_SUCCESS);
+    RTTESTI_CHECK(Stats.cbUsed == 0);
+
+    RTTESTI_CHECK_RC(RTMemArenaDestroy(hArena), VINF_SUCCESS);
+    RTTESTI_CHECK_RC(RTMemArenaDestroy(NIL_RTMEMARENA), VINF_SUCCESS);
+}
+
+
+/**
+ * Nested marks, the way a request and its sub-requests would use them.
+ */
+static void tst2(void)
+{
+    RTTestISub("Nested marks");
+
+    RTMEMARENA hArena;
+    RTTESTI_CHECK_RC_RETV(RTMemArenaCreate(&hArena, _1K, 0 /*fFlags*/), VINF_SUCCESS);
+
+    RTMEMARENASTATS Stats;
+    for (unsigned iLoop = 0; iLoop < 64; iLoop++)
+    {
+        RTMEMARENAMARK Outer;
+        RTMemArenaMark(hArena, &Outer);
+        uint32_t *pu32Outer = (uint32_t *)RTMemArenaAlloc(hArena, sizeof(uint32_t) * 100);
+        RTTESTI_CHECK_RETV(pu32Outer);
+        for (uint32_t i = 0; i < 100; i++)
+            pu32Outer[i] = iLoop * 1000 + i;
+
+        for (unsigned iInner = 0; iInner < 8; iInner++)
+        {
+            RTMEMARENAMARK Inner;
+            RTMemArenaMark(hArena, &Inner);
+            for (unsigned i = 0; i < 20; i++)
+                RTTESTI_CHECK_RETV(RTMemArenaAlloc(hArena, 100 + i * 20) != NULL); /* some are large */
+            RTMemArenaResetToMark(hArena, &Inner);
+        }
+
+        for (uint32_t i = 0; i < 100; i++)
+            RTTESTI_CHECK(pu32Outer[i] == iLoop * 1000 + i);
+        RTMemArenaResetToMark(hArena, &Outer);
+
+        RTTESTI_CHECK_RC(RTMemArenaQueryStats(hArena, &Stats), VINF_SUCCESS);
+        RTTESTI_CHECK(Stats.cbUsed == 0);
+    }
+
+    RTTESTI_CHECK_RC(RTMemArenaDestroy(hArena), VINF_SUCCESS);
+}
+
+
+/**
+ * Allocation speed compared to the heap.
+ */
+static void tst3(void)
+{
+    RTTestISub("Benchmark");
+
+    RTMEMARENA hArena;
+    RTTESTI_CHECK_RC_RETV(RTMemArenaCreate(&hArena, 0 /*cbChunk*/, 0 /*fFlags*/), VINF_SUCCESS);
+
+    uint32_t const cRounds = 10000;
+    void          *apv[32];
+
+    uint64_t nsStart = RTTimeNanoTS();
+    for (uint32_t iRound = 0; iRound < cRounds; iRound++)
+    {
+        for (unsigned i = 0; i < RT_ELEMENTS(apv); i++)
+            apv[i] = RTMemArenaAlloc(hArena, 24 + i * 8);
+        RTMemArenaReset(hArena);
+    }
+    uint64_t const nsArena = RTTimeNanoTS() - nsStart;
+
+    nsStart = RTTimeNanoTS();
+    for (uint32_t iRound = 0; iRound < cRounds; iRound++)
+    {
+        for (unsigned i = 0; i < RT_ELEMENTS(apv); i++)
+            apv[i] = RTMemAlloc(24 + i * 8);
+        for (unsigned i = 0; i < RT_ELEMENTS(apv); i++)
+            RTMemFree(apv[i]);
+    }
+    uint64_t const nsHeap = RTTimeNanoTS() - nsStart;
+
+    uint64_t const cAllocs = (uint64_t)cRounds * RT_ELEMENTS(apv);
+    RTTestIValue("RTMemArenaAlloc", nsArena / cAllocs, RTTESTUNIT_NS_PER_CALL);
+    RTTestIValue("RTMemAlloc+RTMemFree", nsHeap / cAllocs, RTTESTUNIT_NS_PER_CALL);
+
+    RTMEMARENASTATS Stats;
+    RTTESTI_CHECK_RC(RTMemArenaQueryStats(hArena, &Stats), VINF_SUCCESS);
+    RTTestIValue("arena heap allocations", Stats.cHeapAllocs, RTTESTUNIT_OCCURRENCES);
+    RTTESTI_CHECK(Stats.cHeapAllocs == 1);
+
+    RTTESTI_CHECK_RC(RTMemArenaDestroy(hArena), VINF_SUCCESS);
+}
+
+
+int main()
+{
+    RTTEST hTest;
+    RTEXITCODE rcExit = RTTestInitAndCreate("tstRTMemArena", &hTest);
+    if (rcExit != RTEXITCODE_SUCCESS)
+        return rcExit;
+    RTTestBanner(hTest);
+
+    tst1();
+    tst2();
+    if (RTTestIErrorCount() == 0)
+        tst3();
+
+    return RTTestSummaryAndDestroy(hTest);
+}
+
@@ -55,6 +55,17 @@ typedef struct TST3THREAD
     bool                fUseCache;
 } TST3THREAD, *PTST3THREAD;
 
+/** Object ring between the tst4 producer and consumer. */
+typedef struct TST4RING
+{
+    /** Producer index. */
+    uint32_t volatile   iHead;
+    /** Consumer index. */
+    uint32_t volatile   iTail;
+    /** The objects. */
+    void * volatile     apvObjs[256];
+} TST4RING, *PTST4RING;
+
 
 /*********************************************************************************************************************************
 *   Global Variables                                                                                                             *
@@ -65,20 +76,22 @@ static RTTEST               g_hTest;
 static RTMEMCACHE           g_hMemCache;
 /** Stop indicator for tst3 threads.  */
 static bool volatile        g_fTst3Stop;
+/** Whether tst4 uses the cache or RTMemAlloc. */
+static bool                 g_fTst4UseCache;
 
 
 /**
  * Basic API checks.
  * We'll return if any of these fails.
  */
-static void tst1(void)
+static void tst1(uint32_t fFlags)
 {
-    RTTestISub("Basics");
+    RTTestISubF("Basics%s", fFlags & RTMEMCACHE_F_MAGAZINES ? " - magazines" : "");
 
     /* Create one without constructor or destructor. */
     uint32_t const cObjects = PAGE_SIZE * 2 / 256;
     RTMEMCACHE hMemCache;
-    RTTESTI_CHECK_RC_RETV(RTMemCacheCreate(&hMemCache, 256, cObjects, 32, NULL, NULL, NULL, 0 /*fFlags*/), VINF_SUCCESS);
+    RTTESTI_CHECK_RC_RETV(RTMemCacheCreate(&hMemCache, 256, cObjects, 32, NULL, NULL, NULL, fFlags), VINF_SUCCESS);
     RTTESTI_CHECK_RETV(hMemCache != NIL_RTMEMCACHE);
 
     /* Allocate a bit and free it again. */
@@ -121,6 +134,22 @@ static void tst1(void)
         }
     }
 
+    /* The objects in the magazines must count as allocated. */
+    RTMEMCACHESTATS Stats;
+    RTTESTI_CHECK_RC(RTMemCacheQueryStats(hMemCache, &Stats), VINF_SUCCESS);
+    RTTESTI_CHECK(Stats.cTotal == cObjects);
+    if (fFlags & RTMEMCACHE_F_MAGAZINES)
+    {
+        RTTESTI_CHECK(Stats.cThreads == 1);
+        RTTESTI_CHECK(Stats.cAllocMagHits > Stats.cAllocMisses);
+        RTTESTI_CHECK(Stats.cFree < cObjects);
+    }
+    else
+    {
+        RTTESTI_CHECK(Stats.cThreads == 0);
+        RTTESTI_CHECK(Stats.cAllocMagHits == 0);
+    }
+
     /* Destroy it. */
     RTTESTI_CHECK_RC(RTMemCacheDestroy(hMemCache), VINF_SUCCESS);
     RTTESTI_CHECK_RC(RTMemCacheDestroy(NIL_RTMEMCACHE), VINF_SUCCESS);
@@ -154,14 +183,14 @@ static DECLCALLBACK(void) tst2Dtor(RTMEMCACHE hMemCache, void *pvObj, void *pvUs
 /**
  * Test constructor / destructor.
  */
-static void tst2(void)
+static void tst2(uint32_t fFlags)
 {
-    RTTestISub("Ctor/Dtor");
+    RTTestISubF("Ctor/Dtor%s", fFlags & RTMEMCACHE_F_MAGAZINES ? " - magazines" : "");
 
     /* Create one without constructor or destructor. */
     bool            fFail    = false;
     uint32_t const  cObjects = PAGE_SIZE * 2 / 256;
-    RTTESTI_CHECK_RC_RETV(RTMemCacheCreate(&g_hMemCache, 256, cObjects, 32, tst2Ctor, tst2Dtor, &fFail, 0 /*fFlags*/), VINF_SUCCESS);
+    RTTESTI_CHECK_RC_RETV(RTMemCacheCreate(&g_hMemCache, 256, cObjects, 32, tst2Ctor, tst2Dtor, &fFail, fFlags), VINF_SUCCESS);
 
     /* A failure run first. */
     fFail = true;
@@ -261,13 +290,15 @@ static void tst3(uint32_t cThreads, uint32_t cbObject, int iMethod, uint32_t cSe
 {
     RTTestISubF("Benchmark - %u threads, %u bytes, %u secs, %s", cThreads, cbObject, cSecs,
                 iMethod == 0 ? "RTMemCache"
+                : iMethod == 2 ? "RTMemCache/magazines"
                 : "RTMemAlloc");
 
     /*
      * Create a cache with unlimited space, a start semaphore and line up
      * the threads.
      */
-    RTTESTI_CHECK_RC_RETV(RTMemCacheCreate(&g_hMemCache, cbObject, 0 /*cbAlignment*/, UINT32_MAX, NULL, NULL, NULL, 0 /*fFlags*/), VINF_SUCCESS);
+    RTTESTI_CHECK_RC_RETV(RTMemCacheCreate(&g_hMemCache, cbObject, 0 /*cbAlignment*/, UINT32_MAX, NULL, NULL, NULL,
+                                           iMethod == 2 ? RTMEMCACHE_F_MAGAZINES : 0), VINF_SUCCESS);
 
     RTSEMEVENTMULTI hEvt;
     RTTESTI_CHECK_RC_OK_RETV(RTSemEventMultiCreate(&hEvt));
@@ -280,7 +311,7 @@ static void tst3(uint32_t cThreads, uint32_t cbObject, int iMethod, uint32_t cSe
     {
         aThreads[i].hThread     = NIL_RTTHREAD;
         aThreads[i].cIterations = 0;
-        aThreads[i].fUseCache   = iMethod == 0;
+        aThreads[i].fUseCache   = iMethod != 1;
         aThreads[i].cbObject    = cbObject;
         aThreads[i].hEvt        = hEvt;
         RTTESTI_CHECK_RC_OK_RETV(RTThreadCreateF(&aThreads[i].hThread, tst3Thread, &aThreads[i], 0,
@@ -310,6 +341,14 @@ static void tst3(uint32_t cThreads, uint32_t cbObject, int iMethod, uint32_t cSe
     RTTestIPrintf(RTTESTLVL_ALWAYS, "%'8u iterations per second, %'llu ns on avg\n",
                   (unsigned)((long double)cIterations * 1000000000.0 / cElapsedNS),
                   cElapsedNS / cIterations);
+    if (iMethod == 2)
+    {
+        /* The threads have terminated, so all their counts should be in. */
+        RTMEMCACHESTATS Stats;
+        RTTESTI_CHECK_RC(RTMemCacheQueryStats(g_hMemCache, &Stats), VINF_SUCCESS);
+        uint64_t const cAllocs = Stats.cAllocMagHits + Stats.cAllocDepotHits + Stats.cAllocMisses;
+        RTTestIValue("alloc magazine hit rate", cAllocs ? Stats.cAllocMagHits * 100 / cAllocs : 0, RTTESTUNIT_PCT);
+    }
 
     /* clean up */
     RTTESTI_CHECK_RC(RTMemCacheDestroy(g_hMemCache), VINF_SUCCESS);
@@ -319,10 +358,180 @@ static void tst3(uint32_t cThreads, uint32_t cbObject, int iMethod, uint32_t cSe
 static void tst3AllMethods(uint32_t cThreads, uint32_t cbObject, uint32_t cSecs)
 {
     tst3(cThreads, cbObject, 0, cSecs);
+    tst3(cThreads, cbObject, 2, cSecs);
     tst3(cThreads, cbObject, 1, cSecs);
 }
 
 
+/**
+ * tst4 producer: allocates objects and hands them to the consumer.
+ */
+static DECLCALLBACK(int) tst4Producer(RTTHREAD hThreadSelf, void *pvArg)
+{
+    PTST4RING pRing = (PTST4RING)pvArg;
+    RT_NOREF_PV(hThreadSelf);
+
+    while (!ASMAtomicReadBool(&g_fTst3Stop))
+    {
+        uint32_t const iHead = ASMAtomicUoReadU32(&pRing->iHead);
+        if (iHead - ASMAtomicReadU32(&pRing->iTail) >= RT_ELEMENTS(pRing->apvObjs))
+        {
+            RTThreadYield();
+            continue;
+        }
+        void *pvObj = g_fTst4UseCache ? RTMemCacheAlloc(g_hMemCache) : RTMemAlloc(64);
+        RTTEST_CHECK_RET(g_hTest, pvObj != NULL, VERR_NO_MEMORY);
+        ASMAtomicWritePtr(&pRing->apvObjs[iHead % RT_ELEMENTS(pRing->apvObjs)], pvObj);
+        ASMAtomicWriteU32(&pRing->iHead, iHead + 1);
+    }
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * tst4 consumer: frees the objects the producer allocated.
+ */
+static DECLCALLBACK(int) tst4Consumer(RTTHREAD hThreadSelf, void *pvArg)
+{
+    PTST4RING pRing = (PTST4RING)pvArg;
+    RT_NOREF_PV(hThreadSelf);
+
+    for (;;)
+    {
+        uint32_t const iTail = ASMAtomicUoReadU32(&pRing->iTail);
+        if (iTail == ASMAtomicReadU32(&pRing->iHead))
+        {
+            if (ASMAtomicReadBool(&g_fTst3Stop) && iTail == ASMAtomicReadU32(&pRing->iHead))
+                break;
+            RTThreadYield();
+            continue;
+        }
+        void *pvObj = ASMAtomicReadPtr(&pRing->apvObjs[iTail % RT_ELEMENTS(pRing->apvObjs)]);
+        ASMAtomicWriteU32(&pRing->iTail, iTail + 1);
+        if (g_fTst4UseCache)
+            RTMemCacheFree(g_hMemCache, pvObj);
+        else
+            RTMemFree(pvObj);
+    }
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Cross-thread benchmark where objects are allocated by one thread and freed
+ * by another, i.e. the worst case for per-thread magazines.
+ */
+static void tst4(uint32_t cPairs, int iMethod, uint32_t cSecs)
+{
+    RTTestISubF("Producer/consumer - %u pairs, %u secs, %s", cPairs, cSecs,
+                iMethod == 0 ? "RTMemCache"
+                : iMethod == 2 ? "RTMemCache/magazines"
+                : "RTMemAlloc");
+
+    RTTESTI_CHECK_RC_RETV(RTMemCacheCreate(&g_hMemCache, 64, 0 /*cbAlignment*/, UINT32_MAX, NULL, NULL, NULL,
+                                           iMethod == 2 ? RTMEMCACHE_F_MAGAZINES : 0), VINF_SUCCESS);
+    g_fTst4UseCache = iMethod != 1;
+    ASMAtomicWriteBool(&g_fTst3Stop, false);
+
+    TST4RING   *paRings = (TST4RING *)RTMemAllocZ(sizeof(TST4RING) * cPairs);
+    RTTHREAD    ahThreads[32];
+    RTTESTI_CHECK_RETV(paRings);
+    RTTESTI_CHECK_RETV(cPairs * 2 <= RT_ELEMENTS(ahThreads));
+
+    uint64_t const uStartTS = RTTimeNanoTS();
+    for (uint32_t i = 0; i < cPairs; i++)
+    {
+        RTTESTI_CHECK_RC_OK(RTThreadCreateF(&ahThreads[i * 2], tst4Producer, &paRings[i], 0,
+                                            RTTHREADTYPE_DEFAULT, RTTHREADFLAGS_WAITABLE, "tst4-p%u", i));
+        RTTESTI_CHECK_RC_OK(RTThreadCreateF(&ahThreads[i * 2 + 1], tst4Consumer, &paRings[i], 0,
+                                            RTTHREADTYPE_DEFAULT, RTTHREADFLAGS_WAITABLE, "tst4-c%u", i));
+    }
+    RTThreadSleep(cSecs * 1000);
+    ASMAtomicWriteBool(&g_fTst3Stop, true);
+    for (uint32_t i = 0; i < cPairs * 2; i++)
+        RTTESTI_CHECK_RC_OK(RTThreadWait(ahThreads[i], 60*1000, NULL));
+    uint64_t const cElapsedNS = RTTimeNanoTS() - uStartTS;
+
+    uint64_t cObjects = 0;
+    for (uint32_t i = 0; i < cPairs; i++)
+    {
+        RTTESTI_CHECK(paRings[i].iHead == paRings[i].iTail);
+        cObjects += paRings[i].iHead;
+    }
+    RTTestIValue("objects per second", cObjects * RT_NS_1SEC / RT_MAX(cElapsedNS, 1), RTTESTUNIT_OCCURRENCES_PER_SEC);
+
+    RTMEMCACHESTATS Stats;
+    RTTESTI_CHECK_RC(RTMemCacheQueryStats(g_hMemCache, &Stats), VINF_SUCCESS);
+    if (iMethod == 2)
+    {
+        uint64_t const cAllocs = Stats.cAllocMagHits + Stats.cAllocDepotHits + Stats.cAllocMisses;
+        uint64_t const cFrees  = Stats.cFreeMagHits  + Stats.cFreeDepotHits  + Stats.cFreeMisses;
+        RTTestIValue("alloc magazine hit rate", cAllocs ? Stats.cAllocMagHits * 100 / cAllocs : 0, RTTESTUNIT_PCT);
+        RTTestIValue("alloc depot hit rate",    cAllocs ? Stats.cAllocDepotHits * 100 / cAllocs : 0, RTTESTUNIT_PCT);
+        RTTestIValue("free magazine hit rate",  cFrees  ? Stats.cFreeMagHits * 100 / cFrees : 0, RTTESTUNIT_PCT);
+        RTTestIValue("free depot hit rate",     cFrees  ? Stats.cFreeDepotHits * 100 / cFrees : 0, RTTESTUNIT_PCT);
+        RTTESTI_CHECK(cAllocs == cObjects);
+        RTTESTI_CHECK(cFrees  == cObjects);
+    }
+    RTTestIValue("objects in cache", Stats.cTotal, RTTESTUNIT_OCCURRENCES);
+
+    RTTESTI_CHECK_RC(RTMemCacheDestroy(g_hMemCache), VINF_SUCCESS);
+    RTMemFree(paRings);
+}
+
+
+/**
+ * tst5 thread: allocates and frees everything, then idles with the objects
+ * parked in its magazines until told to terminate.
+ */
+static DECLCALLBACK(int) tst5Thread(RTTHREAD hThreadSelf, void *pvArg)
+{
+    RTSEMEVENTMULTI hEvtDone = (RTSEMEVENTMULTI)pvArg;
+    RT_NOREF_PV(hThreadSelf);
+
+    void *apv[48];
+    for (unsigned i = 0; i < RT_ELEMENTS(apv); i++)
+        RTTEST_CHECK(g_hTest, (apv[i] = RTMemCacheAlloc(g_hMemCache)) != NULL);
+    for (unsigned i = 0; i < RT_ELEMENTS(apv); i++)
+        RTMemCacheFree(g_hMemCache, apv[i]);
+
+    RTTEST_CHECK_RC_OK(g_hTest, RTThreadUserSignal(RTThreadSelf()));
+    RTTEST_CHECK_RC_OK(g_hTest, RTSemEventMultiWait(hEvtDone, RT_INDEFINITE_WAIT));
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Objects parked in the magazines of an idle thread must be handed out when a
+ * cache with a size limit runs out, and destroying the cache before that
+ * thread terminates must be safe.
+ */
+static void tst5(void)
+{
+    RTTestISub("Magazines - size limit");
+
+    void *apv[48];
+    RTTESTI_CHECK_RC_RETV(RTMemCacheCreate(&g_hMemCache, 64, 0 /*cbAlignment*/, RT_ELEMENTS(apv), NULL, NULL, NULL,
+                                           RTMEMCACHE_F_MAGAZINES), VINF_SUCCESS);
+    RTSEMEVENTMULTI hEvtDone;
+    RTTESTI_CHECK_RC_OK_RETV(RTSemEventMultiCreate(&hEvtDone));
+    RTTHREAD hThread;
+    RTTESTI_CHECK_RC_OK_RETV(RTThreadCreate(&hThread, tst5Thread, hEvtDone, 0, RTTHREADTYPE_DEFAULT,
+                                            RTTHREADFLAGS_WAITABLE, "tst5"));
+    RTTESTI_CHECK_RC_OK(RTThreadUserWait(hThread, 60*1000));
+
+    for (unsigned i = 0; i < RT_ELEMENTS(apv); i++)
+        RTTESTI_CHECK_RC(RTMemCacheAllocEx(g_hMemCache, &apv[i]), VINF_SUCCESS);
+    void *pv;
+    RTTESTI_CHECK_RC(RTMemCacheAllocEx(g_hMemCache, &pv), VERR_MEM_CACHE_MAX_SIZE);
+
+    RTTESTI_CHECK_RC(RTMemCacheDestroy(g_hMemCache), VINF_SUCCESS);
+    RTTESTI_CHECK_RC_OK(RTSemEventMultiSignal(hEvtDone));
+    RTTESTI_CHECK_RC_OK(RTThreadWait(hThread, 60*1000, NULL));
+    RTTESTI_CHECK_RC_OK(RTSemEventMultiDestroy(hEvtDone));
+}
+
+
 int main(int argc, char **argv)
 {
     RT_NOREF_PV(argc); RT_NOREF_PV(argv);
@@ -334,8 +543,11 @@ int main(int argc, char **argv)
     RTTestBanner(hTest);
     g_hTest = hTest;
 
-    tst1();
-    tst2();
+    tst1(0);
+    tst1(RTMEMCACHE_F_MAGAZINES);
+    tst2(0);
+    tst2(RTMEMCACHE_F_MAGAZINES);
+    tst5();
     if (RTTestIErrorCount() == 0)
     {
         uint32_t cSecs = argc == 1 ? 5 : 2;
@@ -354,6 +566,11 @@ int main(int argc, char **argv)
         tst3AllMethods(     3,     1, cSecs);
 
         tst3AllMethods(    16,    32, cSecs);
+
+        for (int iMethod = 0; iMethod < 3; iMethod++)
+            tst4(1, iMethod, cSecs);
+        for (int iMethod = 0; iMethod < 3; iMethod++)
+            tst4(4, iMethod, cSecs);
     }
 
     /*
@@ -0,0 +1,179 @@
+/* $Id$ */
+/** @file
+ * IPRT Testcase - Internet checksum kernels.
+ */
+
+/*
+ * Copyright (C) 2016 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ *
+ * The contents of this file may alternatively be used under the terms
+ * of the Common Development and Distribution License Version 1.0
+ * (CDDL) only, as it comes in the "COPYING.CDDL" file of the
+ * VirtualBox OSE distribution, in which case the provisions of the
+ * CDDL are applicable instead of those of the GPL.
+ *
+ * You may elect to license modified versions of this file under the
+ * terms and conditions of either the GPL or the CDDL or both.
+ */
+
+
+/*********************************************************************************************************************************
+*   Header Files                                                                                                                 *
+*********************************************************************************************************************************/
+#include <iprt/net.h>
+
+#include <iprt/err.h>
+#include <iprt/initterm.h>
+#include <iprt/mem.h>
+#include <iprt/rand.h>
+#include <iprt/string.h>
+#include <iprt/test.h>
+#include <iprt/time.h>
+
+
+/*********************************************************************************************************************************
+*   Global Variables                                                                                                             *
+*********************************************************************************************************************************/
+/** Size of the test buffers. */
+#define TST_BUF_SIZE    (_64K + 64)
+
+static RTTEST   g_hTest;
+static uint8_t *g_pbSrc;
+static uint8_t *g_pbDst;
+
+
+/**
+ * The plain 16-bit at the time checksum the kernels are checked against.
+ */
+static uint16_t tstRefChecksum(uint8_t const *pb, size_t cb)
+{
+    uint32_t u32Sum = 0;
+    for (; cb > 1; cb -= 2, pb += 2)
+        u32Sum += *(uint16_t const *)pb;
+    if (cb)
+#ifdef RT_BIG_ENDIAN
+        u32Sum += (uint32_t)*pb << 8;
+#else
+        u32Sum += *pb;
+#endif
+    while (u32Sum >> 16)
+        u32Sum = (u32Sum >> 16) + (u32Sum & 0xffff);
+    return (uint16_t)~u32Sum;
+}
+
+
+/**
+ * Checks RTNetIPv4AddDataChecksum and RTNetIPv4AddDataChecksumCopy against
+ * the reference for random sizes, alignments and chunkings.
+ */
+static void tstCorrectness(void)
+{
+    RTTestSub(g_hTest, "correctness");
+
+    for (uint32_t i = 0; i < 20000; i++)
+    {
+        size_t const offSrc = RTRandU32Ex(0, 31);
+        size_t const offDst = RTRandU32Ex(0, 31);
+        size_t const cb     = RTRandU32Ex(0, i < 10000 ? 512 : _64K);
+        if (i % 8 == 0)
+            memset(&g_pbSrc[offSrc], 0xff, cb);     /* worst case for the lane accumulators */
+        else
+            RTRandBytes(&g_pbSrc[offSrc], cb);
+        uint16_t const uExpect = tstRefChecksum(&g_pbSrc[offSrc], cb);
+
+        /* In one go. */
+        bool     fOdd   = false;
+        uint16_t uCSum  = RTNetIPv4FinalizeChecksum(RTNetIPv4AddDataChecksum(&g_pbSrc[offSrc], cb, 0, &fOdd));
+        if (uCSum != uExpect)
+            RTTestFailed(g_hTest, "#%u: cb=%zu off=%zu: %#06x, expected %#06x", i, cb, offSrc, uCSum, uExpect);
+
+        /* In two chunks, the second one copied. */
+        size_t const cbFirst = RTRandU32Ex(0, (uint32_t)cb);
+        fOdd = false;
+        uint32_t u32Sum = RTNetIPv4AddDataChecksum(&g_pbSrc[offSrc], cbFirst, 0, &fOdd);
+        u32Sum = RTNetIPv4AddDataChecksumCopy(&g_pbDst[offDst], &g_pbSrc[offSrc + cbFirst], cb - cbFirst, u32Sum, &fOdd);
+        uCSum = RTNetIPv4FinalizeChecksum(u32Sum);
+        if (uCSum != uExpect)
+            RTTestFailed(g_hTest, "#%u: cb=%zu cbFirst=%zu: %#06x, expected %#06x", i, cb, cbFirst, uCSum, uExpect);
+        if (memcmp(&g_pbDst[offDst], &g_pbSrc[offSrc + cbFirst], cb - cbFirst))
+            RTTestFailed(g_hTest, "#%u: cb=%zu cbFirst=%zu: copy mismatch", i, cb, cbFirst);
+    }
+}
+
+
+/**
+ * Measures the throughput of one kernel for a given buffer size.
+ */
+static void tstBenchmarkOne(const char *pszName, size_t cb, int iKernel)
+{
+    uint32_t const cIterations = (uint32_t)RT_MAX(_256M / cb, 16);
+    uint32_t       u32Sum      = 0;
+    uint64_t const nsStart     = RTTimeNanoTS();
+    for (uint32_t i = 0; i < cIterations; i++)
+    {
+        bool fOdd = false;
+        switch (iKernel)
+        {
+            case 0: u32Sum += tstRefChecksum(g_pbSrc, cb); break;
+            case 1: u32Sum += RTNetIPv4AddDataChecksum(g_pbSrc, cb, 0, &fOdd); break;
+            case 2: u32Sum += RTNetIPv4AddDataChecksumCopy(g_pbDst, g_pbSrc, cb, 0, &fOdd); break;
+            case 3: memcpy(g_pbDst, g_pbSrc, cb); u32Sum += RTNetIPv4AddDataChecksum(g_pbDst, cb, 0, &fOdd); break;
+        }
+    }
+    uint64_t const cNsElapsed = RT_MAX(RTTimeNanoTS() - nsStart, 1);
+    RTTestValueF(g_hTest, (uint64_t)cIterations * cb * RT_NS_1SEC / cNsElapsed / _1M, RTTESTUNIT_MEGABYTES_PER_SEC,
+                 "%s, %zu bytes", pszName, cb);
+    RTTestPrintf(g_hTest, RTTESTLVL_DEBUG, "sum=%#x\n", u32Sum);
+}
+
+
+/**
+ * Measures the throughput per core for typical frame sizes and a GSO buffer.
+ */
+static void tstBenchmark(void)
+{
+    static size_t const s_acb[] = { 64, 576, 1514, 9000, _64K };
+    RTTestSub(g_hTest, "benchmark");
+    for (unsigned i = 0; i < RT_ELEMENTS(s_acb); i++)
+    {
+        tstBenchmarkOne("reference",        s_acb[i], 0);
+        tstBenchmarkOne("checksum",         s_acb[i], 1);
+        tstBenchmarkOne("copy+checksum",    s_acb[i], 2);
+        tstBenchmarkOne("memcpy, checksum", s_acb[i], 3);
+    }
+}
+
+
+int main()
+{
+    RTEXITCODE rcExit = RTTestInitAndCreate("tstRTNetChecksum", &g_hTest);
+    if (rcExit != RTEXITCODE_SUCCESS)
+        return rcExit;
+    RTTestBanner(g_hTest);
+
+    g_pbSrc = (uint8_t *)RTMemAlloc(TST_BUF_SIZE);
+    g_pbDst = (uint8_t *)RTMemAlloc(TST_BUF_SIZE);
+    if (g_pbSrc && g_pbDst)
+    {
+        tstCorrectness();
+        if (!RTTestErrorCount(g_hTest))
+        {
+            RTRandBytes(g_pbSrc, TST_BUF_SIZE);
+            tstBenchmark();
+        }
+    }
+    else
+        RTTestFailed(g_hTest, "Out of memory");
+
+    RTMemFree(g_pbSrc);
+    RTMemFree(g_pbDst);
+    return RTTestSummaryAndDestroy(g_hTest);
+}
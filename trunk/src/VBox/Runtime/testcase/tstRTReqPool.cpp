@@ -30,6 +30,7 @@
 *********************************************************************************************************************************/
 #include <iprt/req.h>
 
+#include <iprt/asm.h>
 #include <iprt/err.h>
 #include <iprt/test.h>
 #include <iprt/thread.h>
@@ -41,6 +42,8 @@
 *   Global Variables                                                                                                             *
 *********************************************************************************************************************************/
 static RTTEST g_hTest = NIL_RTTEST;
+/** Number of requests completed in the scheduling benchmark. */
+static uint32_t volatile g_cTest3Done = 0;
 
 
 static DECLCALLBACK(int) NopCallback(void)
@@ -48,12 +51,13 @@ static DECLCALLBACK(int) NopCallback(void)
     return VINF_SUCCESS;
 }
 
-static void test1(void)
+static void test1(bool fWorkStealing)
 {
-    RTTestISub("Basics");
+    RTTestISubF("Basics%s", fWorkStealing ? ", work-stealing" : "");
     RTREQPOOL hPool;
     uint32_t cMaxThreads = 10;
     RTTESTI_CHECK_RC_RETV(RTReqPoolCreate(cMaxThreads, RT_MS_1SEC, 6, 500, "test1", &hPool), VINF_SUCCESS);
+    RTTESTI_CHECK_RC(RTReqPoolSetCfgVar(hPool, RTREQPOOLCFGVAR_WORK_STEALING, fWorkStealing), VINF_SUCCESS);
     RTTESTI_CHECK(RTReqPoolGetCfgVar(hPool, RTREQPOOLCFGVAR_THREAD_TYPE) == (uint64_t)RTTHREADTYPE_DEFAULT);
     RTTESTI_CHECK(RTReqPoolGetCfgVar(hPool, RTREQPOOLCFGVAR_MAX_THREADS) == 10);
     RTTESTI_CHECK(RTReqPoolGetCfgVar(hPool, RTREQPOOLCFGVAR_MIN_THREADS) > 1);
@@ -102,7 +106,13 @@ static void test1(void)
         RTTESTI_CHECK_RC(RTReqPoolCallNoWait(hPool, (PFNRT)RTThreadSleep, 1, (RTMSINTERVAL)10), VINF_SUCCESS);
         RTTESTI_CHECK_RC(RTReqPoolCallWait(hPool, (PFNRT)RTThreadSleep, 1, (RTMSINTERVAL)100), VINF_SUCCESS);
     }
-    RTTESTI_CHECK(RTReqPoolGetStat(hPool, RTREQPOOLSTAT_REQUESTS_FREE) == cMaxFreeReqs || cMaxFreeReqs > 32);
+    /* Throttled work-stealing submitters are pushed back till a worker picks up
+       the request, so there are no more requests in flight than workers. */
+    if (!fWorkStealing)
+        RTTESTI_CHECK(RTReqPoolGetStat(hPool, RTREQPOOLSTAT_REQUESTS_FREE) == cMaxFreeReqs || cMaxFreeReqs > 32);
+    else
+        RTTESTI_CHECK(   RTReqPoolGetStat(hPool, RTREQPOOLSTAT_REQUESTS_FREE) >= cMinThreads
+                      && RTReqPoolGetStat(hPool, RTREQPOOLSTAT_REQUESTS_FREE) <= cMaxFreeReqs);
 
     /* Idle shutdown of worker threads should kick in now. */
     uint32_t cThreads2 = RTReqPoolGetStat(hPool, RTREQPOOLSTAT_THREADS);
@@ -132,6 +142,117 @@ static void test2(void)
 }
 
 
+static DECLCALLBACK(void) Test3CountCallback(void)
+{
+    ASMAtomicIncU32(&g_cTest3Done);
+}
+
+
+/** Fork-join style request: spawns two more until the depth runs out. */
+static DECLCALLBACK(void) Test3ForkCallback(RTREQPOOL hPool, uintptr_t cDepth)
+{
+    ASMAtomicIncU32(&g_cTest3Done);
+    if (cDepth > 0)
+    {
+        RTTESTI_CHECK_RC(RTReqPoolCallVoidNoWait(hPool, (PFNRT)Test3ForkCallback, 2, hPool, cDepth - 1), VINF_SUCCESS);
+        RTTESTI_CHECK_RC(RTReqPoolCallVoidNoWait(hPool, (PFNRT)Test3ForkCallback, 2, hPool, cDepth - 1), VINF_SUCCESS);
+    }
+}
+
+
+static DECLCALLBACK(int) Test3SubmitterThread(RTTHREAD hThreadSelf, void *pvUser)
+{
+    RTREQPOOL hPool = (RTREQPOOL)pvUser;
+    RT_NOREF_PV(hThreadSelf);
+    for (uint32_t i = 0; i < 25000; i++)
+        RTTESTI_CHECK_RC_BREAK(RTReqPoolCallVoidNoWait(hPool, (PFNRT)Test3CountCallback, 0), VINF_SUCCESS);
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Waits for the benchmark requests to complete and reports the throughput.
+ */
+static void test3Done(const char *pszName, uint32_t cExpected, uint64_t nsStart)
+{
+    uint64_t const nsWaitStart = RTTimeNanoTS();
+    while (   ASMAtomicReadU32(&g_cTest3Done) < cExpected
+           && RTTimeNanoTS() - nsWaitStart < RT_NS_1MIN)
+        RTThreadSleep(1);
+    uint64_t const cNsElapsed = RTTimeNanoTS() - nsStart;
+    RTTESTI_CHECK_MSG(g_cTest3Done == cExpected, ("%s: %u, expected %u\n", pszName, g_cTest3Done, cExpected));
+    RTTestIValue(pszName, (uint64_t)cExpected * RT_NS_1SEC / RT_MAX(cNsElapsed, 1), RTTESTUNIT_CALLS_PER_SEC);
+}
+
+
+static void test3(bool fWorkStealing)
+{
+    RTTestISubF("Scheduling benchmark, %s", fWorkStealing ? "work-stealing" : "shared queue");
+
+    RTREQPOOL hPool;
+    RTTESTI_CHECK_RC_RETV(RTReqPoolCreate(8, RT_MS_1SEC, UINT32_MAX, 0, "test3", &hPool), VINF_SUCCESS);
+    RTTESTI_CHECK_RC(RTReqPoolSetCfgVar(hPool, RTREQPOOLCFGVAR_WORK_STEALING, fWorkStealing), VINF_SUCCESS);
+    RTTESTI_CHECK(RTReqPoolGetCfgVar(hPool, RTREQPOOLCFGVAR_WORK_STEALING) == fWorkStealing);
+
+    /* Several threads submitting short requests. */
+    RTTHREAD ahThreads[4];
+    ASMAtomicWriteU32(&g_cTest3Done, 0);
+    uint64_t nsStart = RTTimeNanoTS();
+    for (unsigned i = 0; i < RT_ELEMENTS(ahThreads); i++)
+        RTTESTI_CHECK_RC(RTThreadCreateF(&ahThreads[i], Test3SubmitterThread, hPool, 0, RTTHREADTYPE_DEFAULT,
+                                         RTTHREADFLAGS_WAITABLE, "tst3sub%u", i), VINF_SUCCESS);
+    for (unsigned i = 0; i < RT_ELEMENTS(ahThreads); i++)
+        RTTESTI_CHECK_RC(RTThreadWait(ahThreads[i], RT_INDEFINITE_WAIT, NULL), VINF_SUCCESS);
+    test3Done("submitters", RT_ELEMENTS(ahThreads) * 25000, nsStart);
+
+    /* Requests submitting requests, 2^15 - 1 of them. */
+    ASMAtomicWriteU32(&g_cTest3Done, 0);
+    nsStart = RTTimeNanoTS();
+    RTTESTI_CHECK_RC(RTReqPoolCallVoidNoWait(hPool, (PFNRT)Test3ForkCallback, 2, hPool, (uintptr_t)14), VINF_SUCCESS);
+    test3Done("fork-join", _32K - 1, nsStart);
+
+    RTTestIValue("threads", RTReqPoolGetStat(hPool, RTREQPOOLSTAT_THREADS), RTTESTUNIT_OCCURRENCES);
+    RTTestIValue("stolen",  RTReqPoolGetStat(hPool, RTREQPOOLSTAT_REQUESTS_STOLEN), RTTESTUNIT_OCCURRENCES);
+
+    RTTESTI_CHECK(RTReqPoolRelease(hPool) == 0);
+}
+
+
+/** Nested request: waits for one more until the depth runs out. */
+static DECLCALLBACK(void) Test4NestedCallback(RTREQPOOL hPool, uintptr_t cDepth)
+{
+    if (cDepth > 0)
+        RTTESTI_CHECK_RC(RTReqPoolCallVoidWait(hPool, (PFNRT)Test4NestedCallback, 2, hPool, cDepth - 1), VINF_SUCCESS);
+    ASMAtomicIncU32(&g_cTest3Done);
+}
+
+
+/**
+ * Nested waits with throttled worker creation.  Each level blocks its worker,
+ * so the pool must create the next one once the push back period is over.
+ */
+static void test4(bool fWorkStealing)
+{
+    RTTestISubF("Nested waits, %s", fWorkStealing ? "work-stealing" : "shared queue");
+
+    RTREQPOOL hPool;
+    RTTESTI_CHECK_RC_RETV(RTReqPoolCreate(5, RT_MS_1SEC, 1, 100, "test4", &hPool), VINF_SUCCESS);
+    RTTESTI_CHECK_RC(RTReqPoolSetCfgVar(hPool, RTREQPOOLCFGVAR_WORK_STEALING, fWorkStealing), VINF_SUCCESS);
+
+    ASMAtomicWriteU32(&g_cTest3Done, 0);
+    RTTESTI_CHECK_RC(RTReqPoolCallVoidNoWait(hPool, (PFNRT)Test4NestedCallback, 2, hPool, (uintptr_t)4), VINF_SUCCESS);
+    uint64_t const nsStart = RTTimeNanoTS();
+    while (   ASMAtomicReadU32(&g_cTest3Done) < 5
+           && RTTimeNanoTS() - nsStart < 10 * RT_NS_1SEC_64)
+        RTThreadSleep(1);
+    RTTESTI_CHECK_MSG(g_cTest3Done == 5, ("%u levels done, expected 5\n", g_cTest3Done));
+    RTTestIValue("elapsed", RTTimeNanoTS() - nsStart, RTTESTUNIT_NS);
+
+    if (g_cTest3Done == 5) /* Don't destroy a pool with deadlocked workers. */
+        RTTESTI_CHECK(RTReqPoolRelease(hPool) == 0);
+}
+
+
 int main()
 {
     RTEXITCODE rcExit = RTTestInitAndCreate("tstRTReqPool", &g_hTest);
@@ -139,10 +260,15 @@ int main()
         return rcExit;
     RTTestBanner(g_hTest);
 
-    test1();
+    test1(false /*fWorkStealing*/);
+    test1(true  /*fWorkStealing*/);
     if (RTTestIErrorCount() == 0)
     {
         test2();
+        test3(false /*fWorkStealing*/);
+        test3(true  /*fWorkStealing*/);
+        test4(false /*fWorkStealing*/);
+        test4(true  /*fWorkStealing*/);
     }
     return RTTestSummaryAndDestroy(g_hTest);
 }
@@ -31,7 +31,9 @@
 #include <iprt/sort.h>
 
 #include <iprt/err.h>
+#include <iprt/mem.h>
 #include <iprt/rand.h>
+#include <iprt/req.h>
 #include <iprt/string.h>
 #include <iprt/test.h>
 #include <iprt/time.h>
@@ -47,6 +49,20 @@ typedef struct TSTRTSORTAPV
     size_t      cElements;
 } TSTRTSORTAPV;
 
+/** Element for the stability test. */
+typedef struct TSTRTSORTSTABLE
+{
+    uint32_t    uKey;
+    uint32_t    iOrg;
+} TSTRTSORTSTABLE;
+
+
+/*********************************************************************************************************************************
+*   Global Variables                                                                                                             *
+*********************************************************************************************************************************/
+/** The request pool for RTSortParallel. */
+static RTREQPOOL g_hPool = NIL_RTREQPOOL;
+
 
 static DECLCALLBACK(int) testApvCompare(void const *pvElement1, void const *pvElement2, void *pvUser)
 {
@@ -134,6 +150,131 @@ static void testSorter(RTTEST hTest, FNRTSORT pfnSorter, const char *pszName)
 }
 
 
+static DECLCALLBACK(void) testMergeWrapper(void *pvArray, size_t cElements, size_t cbElement, PFNRTSORTCMP pfnCmp, void *pvUser)
+{
+    RTTESTI_CHECK_RC(RTSortMerge(pvArray, cElements, cbElement, pfnCmp, pvUser), VINF_SUCCESS);
+}
+
+static DECLCALLBACK(void) testApvMergeWrapper(void **papvArray, size_t cElements, PFNRTSORTCMP pfnCmp, void *pvUser)
+{
+    RTTESTI_CHECK_RC(RTSortApvMerge(papvArray, cElements, pfnCmp, pvUser), VINF_SUCCESS);
+}
+
+static DECLCALLBACK(void) testParallelWrapper(void *pvArray, size_t cElements, size_t cbElement, PFNRTSORTCMP pfnCmp, void *pvUser)
+{
+    RTTESTI_CHECK_RC(RTSortParallel(g_hPool, pvArray, cElements, cbElement, pfnCmp, pvUser), VINF_SUCCESS);
+}
+
+
+static DECLCALLBACK(int) testStableCompare(void const *pvElement1, void const *pvElement2, void *pvUser)
+{
+    TSTRTSORTSTABLE const *pElement1 = (TSTRTSORTSTABLE const *)pvElement1;
+    TSTRTSORTSTABLE const *pElement2 = (TSTRTSORTSTABLE const *)pvElement2;
+    RT_NOREF_PV(pvUser);
+    if (pElement1->uKey < pElement2->uKey)
+        return -1;
+    if (pElement1->uKey > pElement2->uKey)
+        return 1;
+    return 0;
+}
+
+static void testStable(FNRTSORT pfnSorter, const char *pszName)
+{
+    RTTestISub(pszName);
+
+    RTRAND hRand;
+    RTTESTI_CHECK_RC_OK_RETV(RTRandAdvCreateParkMiller(&hRand));
+
+    static uint32_t const s_acElements[] = { 2, 17, 100, 1000, 9000, 70000 };
+    for (unsigned iTest = 0; iTest < RT_ELEMENTS(s_acElements); iTest++)
+    {
+        uint32_t const   cElements = s_acElements[iTest];
+        TSTRTSORTSTABLE *paArray   = (TSTRTSORTSTABLE *)RTMemAlloc(cElements * sizeof(paArray[0]));
+        RTTESTI_CHECK_RETV(paArray);
+        for (uint32_t i = 0; i < cElements; i++)
+        {
+            paArray[i].uKey = RTRandAdvU32Ex(hRand, 0, 15);
+            paArray[i].iOrg = i;
+        }
+
+        pfnSorter(paArray, cElements, sizeof(paArray[0]), testStableCompare, NULL);
+
+        for (uint32_t i = 1; i < cElements; i++)
+            if (   paArray[i - 1].uKey > paArray[i].uKey
+                || (paArray[i - 1].uKey == paArray[i].uKey && paArray[i - 1].iOrg > paArray[i].iOrg))
+            {
+                RTTestIFailed("%u elements: element %u is out of order (key %u/%u, org %u/%u)", cElements, i,
+                              paArray[i - 1].uKey, paArray[i].uKey, paArray[i - 1].iOrg, paArray[i].iOrg);
+                break;
+            }
+        RTMemFree(paArray);
+    }
+    RTRandAdvDestroy(hRand);
+}
+
+
+static DECLCALLBACK(int) testBenchCompare(void const *pvElement1, void const *pvElement2, void *pvUser)
+{
+    uint32_t const u1 = *(uint32_t const *)pvElement1;
+    uint32_t const u2 = *(uint32_t const *)pvElement2;
+    RT_NOREF_PV(pvUser);
+    return u1 < u2 ? -1 : u1 > u2 ? 1 : 0;
+}
+
+static void testBenchmark(void)
+{
+    RTTestISub("Benchmarks");
+
+    static struct
+    {
+        FNRTSORT   *pfnSorter;
+        const char *pszName;
+    } const s_aSorters[] =
+    {
+        { RTSortShell,          "RTSortShell"    },
+        { RTSortIntro,          "RTSortIntro"    },
+        { testMergeWrapper,     "RTSortMerge"    },
+        { testParallelWrapper,  "RTSortParallel" },
+    };
+    static const char * const s_apszInputs[] = { "random", "sorted", "reversed", "few-unique" };
+
+    uint32_t const cElements = _256K;
+    uint32_t      *pauSrc    = (uint32_t *)RTMemAlloc(cElements * sizeof(uint32_t));
+    uint32_t      *pauArray  = (uint32_t *)RTMemAlloc(cElements * sizeof(uint32_t));
+    RTTESTI_CHECK_RETV(pauSrc && pauArray);
+
+    RTRAND hRand;
+    RTTESTI_CHECK_RC_OK_RETV(RTRandAdvCreateParkMiller(&hRand));
+    for (unsigned iInput = 0; iInput < RT_ELEMENTS(s_apszInputs); iInput++)
+    {
+        for (uint32_t i = 0; i < cElements; i++)
+            switch (iInput)
+            {
+                case 0: pauSrc[i] = RTRandAdvU32(hRand); break;
+                case 1: pauSrc[i] = i; break;
+                case 2: pauSrc[i] = cElements - i; break;
+                case 3: pauSrc[i] = RTRandAdvU32Ex(hRand, 0, 7); break;
+            }
+
+        for (unsigned iSorter = 0; iSorter < RT_ELEMENTS(s_aSorters); iSorter++)
+        {
+            memcpy(pauArray, pauSrc, cElements * sizeof(uint32_t));
+            uint64_t nsStart = RTTimeNanoTS();
+            s_aSorters[iSorter].pfnSorter(pauArray, cElements, sizeof(uint32_t), testBenchCompare, NULL);
+            uint64_t cNsElapsed = RTTimeNanoTS() - nsStart;
+            RTTestIValueF(cNsElapsed / RT_NS_1MS, RTTESTUNIT_MS, "%s, %u %s elements",
+                          s_aSorters[iSorter].pszName, cElements, s_apszInputs[iInput]);
+            if (!RTSortIsSorted(pauArray, cElements, sizeof(uint32_t), testBenchCompare, NULL))
+                RTTestIFailed("%s failed sorting %s input", s_aSorters[iSorter].pszName, s_apszInputs[iInput]);
+        }
+    }
+
+    RTRandAdvDestroy(hRand);
+    RTMemFree(pauArray);
+    RTMemFree(pauSrc);
+}
+
+
 int main()
 {
     RTTEST hTest;
@@ -147,6 +288,21 @@ int main()
      */
     testSorter(hTest, RTSortShell, "RTSortShell - shell sort, variable sized element array");
     testApvSorter(RTSortApvShell, "RTSortApvShell - shell sort, pointer array");
+    testSorter(hTest, RTSortIntro, "RTSortIntro - introsort, variable sized element array");
+    testApvSorter(RTSortApvIntro, "RTSortApvIntro - introsort, pointer array");
+    testSorter(hTest, testMergeWrapper, "RTSortMerge - merge sort, variable sized element array");
+    testApvSorter(testApvMergeWrapper, "RTSortApvMerge - merge sort, pointer array");
+
+    rc = RTReqPoolCreate(4 /*cMaxThreads*/, RT_MS_1SEC, 4 /*cThreadsPushBackThreshold*/, 1 /*cMsMaxPushBack*/,
+                         "tstRTSort", &g_hPool);
+    RTTESTI_CHECK_RC(rc, VINF_SUCCESS);
+    testSorter(hTest, testParallelWrapper, "RTSortParallel - parallel merge sort, variable sized element array");
+
+    testStable(testMergeWrapper,    "RTSortMerge - stability");
+    testStable(testParallelWrapper, "RTSortParallel - stability");
+
+    testBenchmark();
+    RTReqPoolRelease(g_hPool);
 
     /*
      * Summary.
@@ -242,6 +242,173 @@ static void tst1(RTSTRCACHE hStrCache)
 }
 
 
+/** Number of strings per thread and round in the concurrency tests. */
+#define TST3_STRINGS        4096
+
+/**
+ * Concurrency test state.
+ */
+typedef struct TST3STATE
+{
+    /** The cache being tested. */
+    RTSTRCACHE          hStrCache;
+    /** Set when the threads should start. */
+    bool volatile       fGo;
+    /** Whether the threads should enter strings of their own (inserts) or the
+     * shared ones (lookups). */
+    bool                fInsert;
+    /** Number of rounds. */
+    uint32_t            cRounds;
+    /** The shared strings. */
+    char              (*paszStrings)[32];
+} TST3STATE;
+
+/**
+ * Concurrency test thread arguments.
+ */
+typedef struct TST3THREAD
+{
+    TST3STATE          *pState;
+    uint32_t            iThread;
+    RTTHREAD            hThread;
+} TST3THREAD;
+
+
+static DECLCALLBACK(int) tst3Thread(RTTHREAD hSelf, void *pvUser)
+{
+    TST3THREAD *pThread = (TST3THREAD *)pvUser;
+    TST3STATE  *pState  = pThread->pState;
+    RT_NOREF_PV(hSelf);
+
+    while (!ASMAtomicReadBool(&pState->fGo))
+        ASMNopPause();
+
+    if (!pState->fInsert)
+    {
+        /* Enter and release the shared strings, each thread starting at a different offset. */
+        uint32_t i = pThread->iThread * 997;
+        for (uint32_t iRound = 0; iRound < pState->cRounds; iRound++)
+            for (uint32_t j = 0; j < TST3_STRINGS; j++, i++)
+            {
+                const char *pszSrc = pState->paszStrings[i % TST3_STRINGS];
+                const char *psz    = RTStrCacheEnter(pState->hStrCache, pszSrc);
+                RTTESTI_CHECK_RET(psz && !strcmp(psz, pszSrc), VERR_INTERNAL_ERROR);
+                RTStrCacheRelease(pState->hStrCache, psz);
+            }
+    }
+    else
+    {
+        /* Enter a batch of strings of our own and release them again. */
+        const char **papsz = (const char **)RTMemAlloc(sizeof(papsz[0]) * TST3_STRINGS);
+        RTTESTI_CHECK_RET(papsz, VERR_NO_MEMORY);
+        for (uint32_t iRound = 0; iRound < pState->cRounds; iRound++)
+        {
+            for (uint32_t j = 0; j < TST3_STRINGS; j++)
+            {
+                char szBuf[64];
+                RTStrPrintf(szBuf, sizeof(szBuf), "thread%u-round%u-string%u", pThread->iThread, iRound, j);
+                papsz[j] = RTStrCacheEnter(pState->hStrCache, szBuf);
+                RTTESTI_CHECK_RET(papsz[j] && !strcmp(papsz[j], szBuf), VERR_INTERNAL_ERROR);
+            }
+            for (uint32_t j = 0; j < TST3_STRINGS; j++)
+                RTTESTI_CHECK(RTStrCacheRelease(pState->hStrCache, papsz[j]) == 0);
+        }
+        RTMemFree(papsz);
+    }
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Runs the concurrency test threads.
+ *
+ * @returns Nanoseconds of wall time per call.
+ */
+static uint64_t tst3Run(TST3STATE *pState, uint32_t cThreads)
+{
+    TST3THREAD aThreads[16];
+    Assert(cThreads <= RT_ELEMENTS(aThreads));
+
+    pState->fGo = false;
+    uint32_t cCreated = 0;
+    for (; cCreated < cThreads; cCreated++)
+    {
+        aThreads[cCreated].pState  = pState;
+        aThreads[cCreated].iThread = cCreated;
+        int rc = RTThreadCreateF(&aThreads[cCreated].hThread, tst3Thread, &aThreads[cCreated], 0,
+                                 RTTHREADTYPE_DEFAULT, RTTHREADFLAGS_WAITABLE, "tst3-%u", cCreated);
+        RTTESTI_CHECK_RC_BREAK(rc, VINF_SUCCESS);
+    }
+
+    uint64_t const nsStart = RTTimeNanoTS();
+    ASMAtomicWriteBool(&pState->fGo, true);
+    for (uint32_t i = 0; i < cCreated; i++)
+    {
+        int rcThread = VERR_IPE_UNINITIALIZED_STATUS;
+        RTTESTI_CHECK_RC(RTThreadWait(aThreads[i].hThread, RT_INDEFINITE_WAIT, &rcThread), VINF_SUCCESS);
+        RTTESTI_CHECK_RC(rcThread, VINF_SUCCESS);
+    }
+    uint64_t const cNsElapsed = RTTimeNanoTS() - nsStart;
+
+    return cNsElapsed / ((uint64_t)RT_MAX(cCreated, 1) * pState->cRounds * TST3_STRINGS);
+}
+
+
+/**
+ * Concurrency checks and insertion/lookup scalability.
+ */
+static void tst3(uint32_t fFlags)
+{
+    const char * const pszCache = fFlags & RTSTRCACHE_F_CONCURRENT ? "concurrent" : "plain";
+    RTTestISubF("Concurrency, %s cache", pszCache);
+
+    TST3STATE State;
+    RT_ZERO(State);
+    State.paszStrings = (char (*)[32])RTMemAlloc(sizeof(State.paszStrings[0]) * TST3_STRINGS);
+    RTTESTI_CHECK_RETV(State.paszStrings);
+    for (uint32_t i = 0; i < TST3_STRINGS; i++)
+        RTStrPrintf(State.paszStrings[i], sizeof(State.paszStrings[0]), "shared-string-%u-%#x", i, i * 2654435761U);
+
+    RTTESTI_CHECK_RC_RETV(RTStrCacheCreateEx(&State.hStrCache, "tst3", fFlags), VINF_SUCCESS);
+
+    /*
+     * Enter and release the same strings on all threads without holding them,
+     * so references keep dropping to zero while other threads look them up.
+     */
+    State.cRounds = 8;
+    tst3Run(&State, 8);
+    RTTESTI_CHECK(RTStrCacheGetStats(State.hStrCache, NULL, NULL, NULL, NULL, NULL, NULL, NULL) == 0);
+
+    /*
+     * Lookup scalability: the shared strings are held by us.
+     */
+    const char **papszHeld = (const char **)RTMemAlloc(sizeof(papszHeld[0]) * TST3_STRINGS);
+    RTTESTI_CHECK_RETV(papszHeld);
+    for (uint32_t i = 0; i < TST3_STRINGS; i++)
+        RTTESTI_CHECK(papszHeld[i] = RTStrCacheEnter(State.hStrCache, State.paszStrings[i]));
+
+    State.cRounds = 32;
+    for (uint32_t cThreads = 1; cThreads <= 8; cThreads *= 2)
+        RTTestValueF(NIL_RTTEST, tst3Run(&State, cThreads), RTTESTUNIT_NS_PER_CALL, "%s lookup, %u threads", pszCache, cThreads);
+
+    for (uint32_t i = 0; i < TST3_STRINGS; i++)
+        RTTESTI_CHECK(RTStrCacheRelease(State.hStrCache, papszHeld[i]) == 0);
+    RTMemFree(papszHeld);
+
+    /*
+     * Insertion scalability, each thread entering and releasing its own strings.
+     */
+    State.fInsert = true;
+    State.cRounds = 8;
+    for (uint32_t cThreads = 1; cThreads <= 8; cThreads *= 2)
+        RTTestValueF(NIL_RTTEST, tst3Run(&State, cThreads), RTTESTUNIT_NS_PER_CALL, "%s insert, %u threads", pszCache, cThreads);
+
+    RTTESTI_CHECK(RTStrCacheGetStats(State.hStrCache, NULL, NULL, NULL, NULL, NULL, NULL, NULL) == 0);
+    RTTESTI_CHECK_RC(RTStrCacheDestroy(State.hStrCache), VINF_SUCCESS);
+    RTMemFree(State.paszStrings);
+}
+
+
 int main()
 {
     RTTEST hTest;
@@ -277,6 +444,12 @@ int main()
      */
     tst2();
 
+    /*
+     * Concurrency and scalability, plain and sharded.
+     */
+    tst3(0);
+    tst3(RTSTRCACHE_F_CONCURRENT);
+
     /*
      * Summary.
      */
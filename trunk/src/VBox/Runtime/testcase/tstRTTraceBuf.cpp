@@ -0,0 +1,306 @@
+/* $Id$ */
+/** @file
+ * IPRT Testcase - Trace Buffer, binary entries and saved files.
+ */
+
+/*
+ * Copyright (C) 2016 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ *
+ * The contents of this file may alternatively be used under the terms
+ * of the Common Development and Distribution License Version 1.0
+ * (CDDL) only, as it comes in the "COPYING.CDDL" file of the
+ * VirtualBox OSE distribution, in which case the provisions of the
+ * CDDL are applicable instead of those of the GPL.
+ *
+ * You may elect to license modified versions of this file under the
+ * terms and conditions of either the GPL or the CDDL or both.
+ */
+
+
+/*********************************************************************************************************************************
+*   Header Files                                                                                                                 *
+*********************************************************************************************************************************/
+#include <iprt/trace.h>
+
+#include <iprt/err.h>
+#include <iprt/file.h>
+#include <iprt/path.h>
+#include <iprt/process.h>
+#include <iprt/string.h>
+#include <iprt/test.h>
+#include <iprt/time.h>
+
+
+/*********************************************************************************************************************************
+*   Global Variables                                                                                                             *
+*********************************************************************************************************************************/
+static RTTEST       g_hTest;
+/** The text of the last entry seen by tstTraceBufLastEntry. */
+static char         g_szLast[1024];
+/** Messages collected by tstTraceBufCollect. */
+static char         g_aszMsgs[64][128];
+/** Number of messages in g_aszMsgs. */
+static uint32_t     g_cMsgs;
+
+
+/**
+ * @callback_method_impl{FNRTTRACEBUFCALLBACK, Keeps the text of the newest
+ *                      entry in g_szLast.}
+ */
+static DECLCALLBACK(int) tstTraceBufLastEntry(RTTRACEBUF hTraceBuf, uint32_t iEntry, uint64_t NanoTS,
+                                              RTCPUID idCpu, const char *pszMsg, void *pvUser)
+{
+    RT_NOREF5(hTraceBuf, iEntry, NanoTS, idCpu, pvUser);
+    RTStrCopy(g_szLast, sizeof(g_szLast), pszMsg);
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * @callback_method_impl{FNRTTRACEBUFCALLBACK, Appends the entry text to
+ *                      g_aszMsgs.}
+ */
+static DECLCALLBACK(int) tstTraceBufCollect(RTTRACEBUF hTraceBuf, uint32_t iEntry, uint64_t NanoTS,
+                                            RTCPUID idCpu, const char *pszMsg, void *pvUser)
+{
+    RT_NOREF4(hTraceBuf, iEntry, NanoTS, idCpu);
+    if (g_cMsgs < RT_ELEMENTS(g_aszMsgs))
+        RTStrCopy(g_aszMsgs[g_cMsgs], sizeof(g_aszMsgs[0]), pszMsg);
+    g_cMsgs++;
+    *(uint64_t *)pvUser += NanoTS != 0;
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Adds a binary entry and checks that it decodes to what RTStrPrintf gives.
+ */
+#define TST_BIN_ONE(a_hTraceBuf, a_szFmt, ...) \
+    do { \
+        char szExpect[sizeof(g_szLast)]; \
+        RTStrPrintf(szExpect, sizeof(szExpect), a_szFmt, __VA_ARGS__); \
+        RTTESTI_CHECK_RC(RTTraceBufAddBinMsgF(a_hTraceBuf, a_szFmt, __VA_ARGS__), VINF_SUCCESS); \
+        g_szLast[0] = '\0'; \
+        RTTESTI_CHECK_RC(RTTraceBufEnumEntries(a_hTraceBuf, tstTraceBufLastEntry, NULL), VINF_SUCCESS); \
+        if (strcmp(g_szLast, szExpect)) \
+            RTTestIFailed("line %d: '%s': got '%s', expected '%s'", __LINE__, a_szFmt, g_szLast, szExpect); \
+    } while (0)
+
+
+static void tstBinFormat(void)
+{
+    RTTestSub(g_hTest, "Binary entry formatting");
+
+    RTTRACEBUF hTraceBuf;
+    RTTESTI_CHECK_RC_RETV(RTTraceBufCreate(&hTraceBuf, 16, 256, 0), VINF_SUCCESS);
+
+    TST_BIN_ONE(hTraceBuf, "plain %d", 42);
+    TST_BIN_ONE(hTraceBuf, "%d %u %x %X %o", -1, 0xfffffffeU, 0xdead, 0xbeef, 8);
+    TST_BIN_ONE(hTraceBuf, "%#010x|%-8d|%+d|% d", 0x1234, 5, 6, 7);
+    TST_BIN_ONE(hTraceBuf, "%ld %lu %lld %llx", -2L, 3UL, -4LL, 0x123456789abcdefULL);
+    TST_BIN_ONE(hTraceBuf, "%RU8 %RU16 %RU32 %RU64", (uint8_t)200, (uint16_t)60000, UINT32_C(4000000000), UINT64_C(18000000000000000000));
+    TST_BIN_ONE(hTraceBuf, "%RI8 %RI16 %RI32 %RI64", (int8_t)-100, (int16_t)-30000, INT32_C(-2000000000), INT64_C(-9000000000000000000));
+    TST_BIN_ONE(hTraceBuf, "%RX8 %RX16 %RX32 %RX64 %#RX64", (uint8_t)0xab, (uint16_t)0xabcd, UINT32_C(0xabcdef01), UINT64_C(0xfedcba9876543210),
+                UINT64_C(0x10));
+    TST_BIN_ONE(hTraceBuf, "%p %RHv %RGp", (void *)&hTraceBuf, (RTHCUINTPTR)0x1000, (RTGCPHYS)0xfee00000);
+    TST_BIN_ONE(hTraceBuf, "%*d|%-*u|%.*x", 6, 1, 5, 2U, 4, 3U);
+    TST_BIN_ONE(hTraceBuf, "str='%s' null='%s' prec='%.3s' width='%8s'", "hello", (const char *)NULL, "abcdef", "xy");
+    TST_BIN_ONE(hTraceBuf, "%c%c %% done", 'o', 'k');
+    TST_BIN_ONE(hTraceBuf, "%s", "a string that is long enough to need a fair bit of the entry for itself, "
+                                 "but which still fits nicely");
+    TST_BIN_ONE(hTraceBuf, "rc=%Rrc pid=%RTproc", VERR_NO_MEMORY, RTProcSelf());
+
+    /* These can't be done in binary and must fall back on immediate formatting. */
+    static RTUUID const s_Uuid = { { 0x01, 0x23, 0x45, 0x67, 0x89, 0xab, 0xcd, 0xef, 0x01, 0x23, 0x45, 0x67, 0x89, 0xab, 0xcd, 0xef } };
+    TST_BIN_ONE(hTraceBuf, "uuid=%RTuuid %s", &s_Uuid, "fallback");
+
+    RTTESTI_CHECK_RC(RTTraceBufRelease(hTraceBuf), 0);
+}
+
+
+static void tstSaveAndDecode(void)
+{
+    RTTestSub(g_hTest, "Save and decode");
+
+    char szPath[RTPATH_MAX];
+    RTTESTI_CHECK_RC_RETV(RTPathTemp(szPath, sizeof(szPath)), VINF_SUCCESS);
+    char szName[64];
+    RTStrPrintf(szName, sizeof(szName), "tstRTTraceBuf-%u.trace", RTProcSelf());
+    RTTESTI_CHECK_RC_RETV(RTPathAppend(szPath, sizeof(szPath), szName), VINF_SUCCESS);
+
+    RTTRACEBUF hTraceBuf;
+    RTTESTI_CHECK_RC_RETV(RTTraceBufCreate(&hTraceBuf, 16, 128, 0), VINF_SUCCESS);
+
+    /* Wrap around a couple of times and mix text and binary entries. */
+    for (uint32_t i = 0; i < 40; i++)
+    {
+        if (i % 3)
+            RTTraceBufAddBinMsgF(hTraceBuf, "binary #%u %s", i, i & 1 ? "odd" : "even");
+        else
+            RTTraceBufAddMsgF(hTraceBuf, "text #%u", i);
+    }
+
+    uint64_t cEntries = 0;
+    g_cMsgs = 0;
+    RTTESTI_CHECK_RC(RTTraceBufEnumEntries(hTraceBuf, tstTraceBufCollect, &cEntries), VINF_SUCCESS);
+    uint32_t const cMsgsLive = g_cMsgs;
+    static char s_aszLive[RT_ELEMENTS(g_aszMsgs)][sizeof(g_aszMsgs[0])];
+    memcpy(s_aszLive, g_aszMsgs, sizeof(g_aszMsgs));
+    RTTESTI_CHECK(cMsgsLive == 16);
+
+    RTTESTI_CHECK_RC(RTTraceBufSaveToFile(hTraceBuf, szPath), VINF_SUCCESS);
+    RTTESTI_CHECK_RC(RTTraceBufRelease(hTraceBuf), 0);
+
+    cEntries = 0;
+    g_cMsgs  = 0;
+    RT_ZERO(g_aszMsgs);
+    RTTESTI_CHECK_RC(RTTraceBufDecodeFile(szPath, tstTraceBufCollect, &cEntries), VINF_SUCCESS);
+    RTTESTI_CHECK_MSG(g_cMsgs == cMsgsLive, ("g_cMsgs=%u cMsgsLive=%u\n", g_cMsgs, cMsgsLive));
+    RTTESTI_CHECK(cEntries == g_cMsgs);
+    for (uint32_t i = 0; i < RT_MIN(g_cMsgs, cMsgsLive); i++)
+        if (strcmp(g_aszMsgs[i], s_aszLive[i]))
+            RTTestIFailed("entry %u: '%s', expected '%s'", i, g_aszMsgs[i], s_aszLive[i]);
+    RTTESTI_CHECK(!strcmp(g_aszMsgs[cMsgsLive - 1], "text #39"));
+
+    /* A damaged file must be rejected. */
+    RTFILE hFile;
+    RTTESTI_CHECK_RC(RTFileOpen(&hFile, szPath, RTFILE_O_WRITE | RTFILE_O_OPEN | RTFILE_O_DENY_NONE), VINF_SUCCESS);
+    if (hFile != NIL_RTFILE)
+    {
+        RTTESTI_CHECK_RC(RTFileWriteAt(hFile, 0, "X", 1, NULL), VINF_SUCCESS);
+        RTFileClose(hFile);
+        RTTESTI_CHECK_RC(RTTraceBufDecodeFile(szPath, tstTraceBufCollect, &cEntries), VERR_INVALID_MAGIC);
+    }
+
+    RTFileDelete(szPath);
+}
+
+
+/**
+ * Text entries may start with any character, including the byte the binary
+ * entries used to be told apart by.
+ */
+static void tstLeadingControlChar(void)
+{
+    RTTestSub(g_hTest, "Text starting with \\x01");
+
+    char szPath[RTPATH_MAX];
+    RTTESTI_CHECK_RC_RETV(RTPathTemp(szPath, sizeof(szPath)), VINF_SUCCESS);
+    char szName[64];
+    RTStrPrintf(szName, sizeof(szName), "tstRTTraceBuf-%u-ctl.trace", RTProcSelf());
+    RTTESTI_CHECK_RC_RETV(RTPathAppend(szPath, sizeof(szPath), szName), VINF_SUCCESS);
+
+    RTTRACEBUF hTraceBuf;
+    RTTESTI_CHECK_RC_RETV(RTTraceBufCreate(&hTraceBuf, 8, 128, 0), VINF_SUCCESS);
+    RTTESTI_CHECK_RC(RTTraceBufAddMsg(hTraceBuf, "\x01plain"), VINF_SUCCESS);
+    RTTESTI_CHECK_RC(RTTraceBufAddMsgF(hTraceBuf, "\x01%s #%u", "formatted", 2), VINF_SUCCESS);
+    RTTESTI_CHECK_RC(RTTraceBufAddBinMsgF(hTraceBuf, "binary #%u", 3), VINF_SUCCESS);
+    RTTESTI_CHECK_RC(RTTraceBufAddBinMsgF(hTraceBuf, "\x01" "binary #%u", 4), VINF_SUCCESS);
+    static const char * const s_apszExpect[] = { "\x01plain", "\x01" "formatted #2", "binary #3", "\x01" "binary #4" };
+
+    /* In memory. */
+    uint64_t cEntries = 0;
+    g_cMsgs = 0;
+    RT_ZERO(g_aszMsgs);
+    RTTESTI_CHECK_RC(RTTraceBufEnumEntries(hTraceBuf, tstTraceBufCollect, &cEntries), VINF_SUCCESS);
+    RTTESTI_CHECK_MSG(g_cMsgs == RT_ELEMENTS(s_apszExpect), ("g_cMsgs=%u\n", g_cMsgs));
+    RTTESTI_CHECK(cEntries == g_cMsgs);
+    for (uint32_t i = 0; i < RT_MIN(g_cMsgs, RT_ELEMENTS(s_apszExpect)); i++)
+        if (strcmp(g_aszMsgs[i], s_apszExpect[i]))
+            RTTestIFailed("live entry %u: '%s', expected '%s'", i, g_aszMsgs[i], s_apszExpect[i]);
+
+    /* Saved and decoded. */
+    RTTESTI_CHECK_RC(RTTraceBufSaveToFile(hTraceBuf, szPath), VINF_SUCCESS);
+    RTTESTI_CHECK_RC(RTTraceBufRelease(hTraceBuf), 0);
+
+    cEntries = 0;
+    g_cMsgs  = 0;
+    RT_ZERO(g_aszMsgs);
+    RTTESTI_CHECK_RC(RTTraceBufDecodeFile(szPath, tstTraceBufCollect, &cEntries), VINF_SUCCESS);
+    RTTESTI_CHECK_MSG(g_cMsgs == RT_ELEMENTS(s_apszExpect), ("g_cMsgs=%u\n", g_cMsgs));
+    for (uint32_t i = 0; i < RT_MIN(g_cMsgs, RT_ELEMENTS(s_apszExpect)); i++)
+        if (strcmp(g_aszMsgs[i], s_apszExpect[i]))
+            RTTestIFailed("decoded entry %u: '%s', expected '%s'", i, g_aszMsgs[i], s_apszExpect[i]);
+
+    RTFileDelete(szPath);
+}
+
+
+/**
+ * Strings with a precision need not be terminated, so the binary encoding
+ * must not look beyond the precision.
+ */
+static void tstUnterminatedStr(void)
+{
+    RTTestSub(g_hTest, "Unterminated %.*s arguments");
+
+    /* The buffer ends right before a guard page, so an overread faults. */
+    static const char s_achChars[6] = { 'a', 'b', 'c', 'd', 'e', 'f' };
+    char *pachBuf = (char *)RTTestGuardedAllocTail(g_hTest, sizeof(s_achChars));
+    RTTESTI_CHECK_RETV(pachBuf);
+    memcpy(pachBuf, s_achChars, sizeof(s_achChars));
+
+    RTTRACEBUF hTraceBuf;
+    RTTESTI_CHECK_RC_RETV(RTTraceBufCreate(&hTraceBuf, 16, 256, 0), VINF_SUCCESS);
+
+    TST_BIN_ONE(hTraceBuf, "'%.*s'", (int)sizeof(s_achChars), pachBuf);
+    TST_BIN_ONE(hTraceBuf, "'%.*s'", 2, pachBuf);
+    TST_BIN_ONE(hTraceBuf, "'%8.*s'", 3, pachBuf);
+    TST_BIN_ONE(hTraceBuf, "'%*.*s'", 9, 4, pachBuf);
+    TST_BIN_ONE(hTraceBuf, "'%.6s' '%.1s'", pachBuf, pachBuf + 5);
+    TST_BIN_ONE(hTraceBuf, "'%-10.6s'|", pachBuf);
+
+    RTTESTI_CHECK_RC(RTTraceBufRelease(hTraceBuf), 0);
+    RTTestGuardedFree(g_hTest, pachBuf);
+}
+
+
+static void tstTiming(void)
+{
+    RTTestSub(g_hTest, "Timing");
+
+    RTTRACEBUF hTraceBuf;
+    RTTESTI_CHECK_RC_RETV(RTTraceBufCreate(&hTraceBuf, 1024, 256, 0), VINF_SUCCESS);
+
+    uint32_t const cIterations = 200000;
+    uint64_t nsStart = RTTimeNanoTS();
+    for (uint32_t i = 0; i < cIterations; i++)
+        RTTraceBufAddMsgF(hTraceBuf, "iteration %u: GCPhys=%RGp cb=%#x %s", i, (RTGCPHYS)i << 12, 0x1000, "read");
+    uint64_t nsText = RTTimeNanoTS() - nsStart;
+
+    nsStart = RTTimeNanoTS();
+    for (uint32_t i = 0; i < cIterations; i++)
+        RTTraceBufAddBinMsgF(hTraceBuf, "iteration %u: GCPhys=%RGp cb=%#x %s", i, (RTGCPHYS)i << 12, 0x1000, "read");
+    uint64_t nsBin = RTTimeNanoTS() - nsStart;
+
+    RTTestValue(g_hTest, "RTTraceBufAddMsgF", nsText / cIterations, RTTESTUNIT_NS_PER_CALL);
+    RTTestValue(g_hTest, "RTTraceBufAddBinMsgF", nsBin / cIterations, RTTESTUNIT_NS_PER_CALL);
+
+    RTTESTI_CHECK_RC(RTTraceBufRelease(hTraceBuf), 0);
+}
+
+
+int main()
+{
+    RTEXITCODE rcExit = RTTestInitAndCreate("tstRTTraceBuf", &g_hTest);
+    if (rcExit != RTEXITCODE_SUCCESS)
+        return rcExit;
+    RTTestBanner(g_hTest);
+
+    tstBinFormat();
+    tstSaveAndDecode();
+    tstLeadingControlChar();
+    tstUnterminatedStr();
+    tstTiming();
+
+    return RTTestSummaryAndDestroy(g_hTest);
+}
+
@@ -0,0 +1,134 @@
+/* $Id$ */
+/** @file
+ * IPRT - Trace Buffer File Decoder.
+ */
+
+/*
+ * Copyright (C) 2016 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ *
+ * The contents of this file may alternatively be used under the terms
+ * of the Common Development and Distribution License Version 1.0
+ * (CDDL) only, as it comes in the "COPYING.CDDL" file of the
+ * VirtualBox OSE distribution, in which case the provisions of the
+ * CDDL are applicable instead of those of the GPL.
+ *
+ * You may elect to license modified versions of this file under the
+ * terms and conditions of either the GPL or the CDDL or both.
+ */
+
+
+/*********************************************************************************************************************************
+*   Header Files                                                                                                                 *
+*********************************************************************************************************************************/
+#include <iprt/trace.h>
+
+#include <iprt/buildconfig.h>
+#include <iprt/err.h>
+#include <iprt/getopt.h>
+#include <iprt/initterm.h>
+#include <iprt/message.h>
+#include <iprt/stream.h>
+#include <iprt/string.h>
+
+
+/*********************************************************************************************************************************
+*   Structures and Typedefs                                                                                                      *
+*********************************************************************************************************************************/
+/** Decoder state. */
+typedef struct RTTRACEDECODESTATE
+{
+    /** The timestamp of the first entry, UINT64_MAX if none yet. */
+    uint64_t    NanoTSFirst;
+    /** Whether to print timestamps relative to the first entry. */
+    bool        fRelative;
+} RTTRACEDECODESTATE;
+
+
+/**
+ * @callback_method_impl{FNRTTRACEBUFCALLBACK}
+ */
+static DECLCALLBACK(int) rtTraceDecodeEntry(RTTRACEBUF hTraceBuf, uint32_t iEntry, uint64_t NanoTS,
+                                            RTCPUID idCpu, const char *pszMsg, void *pvUser)
+{
+    RTTRACEDECODESTATE *pState = (RTTRACEDECODESTATE *)pvUser;
+    RT_NOREF2(hTraceBuf, iEntry);
+
+    if (pState->NanoTSFirst == UINT64_MAX)
+        pState->NanoTSFirst = NanoTS;
+    if (pState->fRelative)
+        RTPrintf("%'16RU64 %03x: %s\n", NanoTS - pState->NanoTSFirst, idCpu, pszMsg);
+    else
+        RTPrintf("%RU64 %03x: %s\n", NanoTS, idCpu, pszMsg);
+    return VINF_SUCCESS;
+}
+
+
+int main(int argc, char **argv)
+{
+    int rc = RTR3InitExe(argc, &argv, 0);
+    if (RT_FAILURE(rc))
+        return RTMsgInitFailure(rc);
+
+    /*
+     * Parse the command line.
+     */
+    static const RTGETOPTDEF s_aOptions[] =
+    {
+        { "--relative",     'r', RTGETOPT_REQ_NOTHING },
+    };
+
+    RTTRACEDECODESTATE  State       = { UINT64_MAX, false };
+    RTEXITCODE          rcExit      = RTEXITCODE_SUCCESS;
+    unsigned            cFiles      = 0;
+
+    RTGETOPTSTATE       GetState;
+    RTGetOptInit(&GetState, argc, argv, s_aOptions, RT_ELEMENTS(s_aOptions), 1, RTGETOPTINIT_FLAGS_OPTS_FIRST);
+    for (;;)
+    {
+        RTGETOPTUNION ValueUnion;
+        rc = RTGetOpt(&GetState, &ValueUnion);
+        if (rc == 0)
+            break;
+        switch (rc)
+        {
+            case 'r':
+                State.fRelative = true;
+                break;
+
+            case VINF_GETOPT_NOT_OPTION:
+                cFiles++;
+                State.NanoTSFirst = UINT64_MAX;
+                rc = RTTraceBufDecodeFile(ValueUnion.psz, rtTraceDecodeEntry, &State);
+                if (RT_FAILURE(rc))
+                    rcExit = RTMsgErrorExit(RTEXITCODE_FAILURE, "Failed to decode '%s': %Rrc", ValueUnion.psz, rc);
+                break;
+
+            case 'h':
+                RTPrintf("Usage: RTTraceDecode [-r|--relative] <file> [file2 [..]]\n"
+                         "\n"
+                         "Prints the entries of trace buffer files created by RTTraceBufSaveToFile,\n"
+                         "formatting the binary entries using the saved format strings.\n");
+                return RTEXITCODE_SUCCESS;
+
+            case 'V':
+                RTPrintf("%sr%d\n", RTBldCfgVersion(), RTBldCfgRevision());
+                return RTEXITCODE_SUCCESS;
+
+            default:
+                return RTGetOptPrintError(rc, &ValueUnion);
+        }
+    }
+
+    if (!cFiles)
+        return RTMsgErrorExit(RTEXITCODE_SYNTAX, "No trace buffer file specified");
+    return rcExit;
+}
+
@@ -35,6 +35,7 @@
 #include <iprt/path.h>
 #include <iprt/sg.h>
 #include <iprt/semaphore.h>
+#include <iprt/thread.h>
 
 #include "VDInternal.h"
 
@@ -60,6 +61,16 @@ typedef struct VDIIOFALLBACKSTORAGE
     RTTHREAD            ThreadAsync;
 } VDIIOFALLBACKSTORAGE, *PVDIIOFALLBACKSTORAGE;
 
+/** Auxiliary I/O allocations larger than this go to the heap instead of the
+ * per-disk arena. */
+#define VD_IO_ARENA_MAX_ALLOC                   _4K
+/** Auxiliary I/O allocations go to the heap once this much was allocated from
+ * the per-disk arena without it being reset and no freed block of the right
+ * size is at hand, so that I/O contexts holding on to arena memory for a long
+ * time can't make it grow forever. */
+#define VD_IO_ARENA_MAX_SIZE                    _256K
+AssertCompile(RT_BIT_32(VD_IO_ARENA_MIN_SHIFT + VD_IO_ARENA_CLASSES - 1) >= VD_IO_ARENA_MAX_ALLOC + sizeof(VDIOAUXHDR));
+
 /**
  * uModified bit flags.
  */
@@ -131,6 +142,8 @@ typedef struct VDIOCTX
     /** Temporary allocated memory which is freed
      * when the context completes. */
     void                        *pvAllocation;
+    /** Whether pvAllocation was allocated with vdIoAuxAlloc() from the arena. */
+    bool                         fAllocationArena;
     /** Transfer function. */
     PFNVDIOCTXTRANSFER           pfnIoCtxTransfer;
     /** Next transfer part after the current one completed. */
@@ -277,6 +290,8 @@ typedef struct VDIOCTXDEFERRED
     RTLISTNODE NodeDeferred;
     /** I/O context this entry points to. */
     PVDIOCTX   pIoCtx;
+    /** Whether this entry was allocated from the arena, see vdIoAuxAlloc(). */
+    bool       fArena;
 } VDIOCTXDEFERRED, *PVDIOCTXDEFERRED;
 
 /**
@@ -355,6 +370,10 @@ typedef struct VDMETAXFER
     /** Shadow buffer which is used in case a write is still active and other
      * writes update the shadow buffer. */
     uint8_t         *pbDataShw;
+    /** Whether this entry was allocated from the arena, see vdIoAuxAlloc(). */
+    bool             fArena;
+    /** Whether pbDataShw was allocated from the arena. */
+    bool             fDataShwArena;
     /** List of I/O contexts updating the shadow buffer while there is a write
      * in progress. */
     RTLISTNODE       ListIoCtxShwWrites;
@@ -717,6 +736,7 @@ DECLINLINE(void) vdIoCtxInit(PVDIOCTX pIoCtx, PVDISK pDisk, VDIOCTXTXDIR enmTxDi
     pIoCtx->fComplete             = false;
     pIoCtx->fFlags                = fFlags;
     pIoCtx->pvAllocation          = pvAllocation;
+    pIoCtx->fAllocationArena      = false;
     pIoCtx->pfnIoCtxTransfer      = pfnIoCtxTransfer;
     pIoCtx->pfnIoCtxTransferNext  = NULL;
     pIoCtx->rcReq                 = VINF_SUCCESS;
@@ -997,6 +1017,122 @@ static int vdDiscardSetRangeAllocated(PVDISK pDisk, uint64_t uOffset, size_t cbR
     return rc;
 }
 
+/**
+ * Allocates auxiliary memory for an I/O context, i.e. deferred list nodes,
+ * metadata transfers and bounce buffers.
+ *
+ * The memory comes from the per-disk arena in power of two sized blocks.
+ * Freed blocks are put on a free list per size, and the whole arena is reset
+ * when the last allocation is freed, so busy disks don't need to go to the
+ * heap for these even when there is always some I/O in flight.
+ * The disk must be locked.
+ *
+ * @returns Pointer to the memory, NULL if out of memory.
+ * @param   pDisk           The disk.
+ * @param   cb              Number of bytes to allocate.
+ * @param   pfArena         Where to store whether the memory came from the
+ *                          arena, to be passed to vdIoAuxFree().
+ */
+static void *vdIoAuxAlloc(PVDISK pDisk, size_t cb, bool *pfArena)
+{
+    VD_IS_LOCKED(pDisk);
+    pDisk->cIoAuxAllocs++;
+
+    if (cb <= VD_IO_ARENA_MAX_ALLOC)
+    {
+        uint32_t const iClass = RT_MAX(ASMBitLastSetU32((uint32_t)(cb + sizeof(VDIOAUXHDR) - 1)), VD_IO_ARENA_MIN_SHIFT)
+                              - VD_IO_ARENA_MIN_SHIFT;
+        PVDIOAUXHDR pHdr = pDisk->apArenaIoFree[iClass];
+        if (pHdr)
+            pDisk->apArenaIoFree[iClass] = pHdr->pNextFree;
+        else
+        {
+            size_t const cbBlock = RT_BIT_32(iClass + VD_IO_ARENA_MIN_SHIFT);
+            if (pDisk->cbArenaIoUsed + cbBlock <= VD_IO_ARENA_MAX_SIZE)
+            {
+                pHdr = (PVDIOAUXHDR)RTMemArenaAlloc(pDisk->hArenaIo, cbBlock);
+                if (RT_LIKELY(pHdr))
+                    pDisk->cbArenaIoUsed += cbBlock;
+            }
+        }
+        if (RT_LIKELY(pHdr))
+        {
+            pHdr->iClass = iClass;
+            pDisk->cArenaIoRefs++;
+            *pfArena = true;
+            return pHdr + 1;
+        }
+    }
+
+    pDisk->cIoAuxHeapAllocs++;
+    *pfArena = false;
+    return RTMemAlloc(cb);
+}
+
+/**
+ * Frees memory allocated by vdIoAuxAlloc().
+ *
+ * @param   pDisk           The disk.
+ * @param   pv              The memory to free, NULL is ignored.
+ * @param   fArena          The indicator returned by vdIoAuxAlloc().
+ */
+static void vdIoAuxFree(PVDISK pDisk, void *pv, bool fArena)
+{
+    if (!pv)
+        return;
+    if (fArena)
+    {
+        VD_IS_LOCKED(pDisk);
+        Assert(pDisk->cArenaIoRefs > 0);
+        if (!--pDisk->cArenaIoRefs)
+        {
+            RTMemArenaReset(pDisk->hArenaIo);
+            pDisk->cbArenaIoUsed = 0;
+            RT_ZERO(pDisk->apArenaIoFree);
+        }
+        else
+        {
+            PVDIOAUXHDR pHdr = (PVDIOAUXHDR)pv - 1;
+            AssertReturnVoid(pHdr->iClass < VD_IO_ARENA_CLASSES);
+            pHdr->pNextFree = pDisk->apArenaIoFree[pHdr->iClass];
+            pDisk->apArenaIoFree[pHdr->iClass] = pHdr;
+        }
+    }
+    else
+        RTMemFree(pv);
+}
+
+/**
+ * Allocates a deferred list node for the given I/O context.
+ *
+ * @returns Pointer to the node, NULL if out of memory.
+ * @param   pDisk           The disk.
+ * @param   pIoCtx          The I/O context to defer.
+ */
+DECLINLINE(PVDIOCTXDEFERRED) vdIoCtxDeferredAlloc(PVDISK pDisk, PVDIOCTX pIoCtx)
+{
+    bool fArena;
+    PVDIOCTXDEFERRED pDeferred = (PVDIOCTXDEFERRED)vdIoAuxAlloc(pDisk, sizeof(VDIOCTXDEFERRED), &fArena);
+    if (RT_LIKELY(pDeferred))
+    {
+        RTListInit(&pDeferred->NodeDeferred);
+        pDeferred->pIoCtx = pIoCtx;
+        pDeferred->fArena = fArena;
+    }
+    return pDeferred;
+}
+
+/**
+ * Frees a deferred list node.
+ *
+ * @param   pDisk           The disk.
+ * @param   pDeferred       The node to free.
+ */
+DECLINLINE(void) vdIoCtxDeferredFree(PVDISK pDisk, PVDIOCTXDEFERRED pDeferred)
+{
+    vdIoAuxFree(pDisk, pDeferred, pDeferred->fArena);
+}
+
 DECLINLINE(PVDIOCTX) vdIoCtxAlloc(PVDISK pDisk, VDIOCTXTXDIR enmTxDir,
                                   uint64_t uOffset, size_t cbTransfer,
                                   PVDIMAGE pImageStart,PCRTSGBUF pcSgBuf,
@@ -1052,6 +1188,7 @@ DECLINLINE(void) vdIoCtxDiscardInit(PVDIOCTX pIoCtx, PVDISK pDisk, PCRTRANGE paR
     pIoCtx->fComplete                 = false;
     pIoCtx->fFlags                    = fFlags;
     pIoCtx->pvAllocation              = pvAllocation;
+    pIoCtx->fAllocationArena          = false;
     pIoCtx->pfnIoCtxTransfer          = pfnIoCtxTransfer;
     pIoCtx->pfnIoCtxTransferNext      = NULL;
     pIoCtx->rcReq                     = VINF_SUCCESS;
@@ -1156,8 +1293,7 @@ DECLINLINE(void) vdIoCtxFree(PVDISK pDisk, PVDIOCTX pIoCtx)
 
     if (!(pIoCtx->fFlags & VDIOCTX_FLAGS_DONT_FREE))
     {
-        if (pIoCtx->pvAllocation)
-            RTMemFree(pIoCtx->pvAllocation);
+        vdIoAuxFree(pDisk, pIoCtx->pvAllocation, pIoCtx->fAllocationArena);
 #ifdef DEBUG
         memset(&pIoCtx->pDisk, 0xff, sizeof(void *));
 #endif
@@ -1185,7 +1321,8 @@ DECLINLINE(void) vdIoCtxChildReset(PVDIOCTX pIoCtx)
 
 DECLINLINE(PVDMETAXFER) vdMetaXferAlloc(PVDIOSTORAGE pIoStorage, uint64_t uOffset, size_t cb)
 {
-    PVDMETAXFER pMetaXfer = (PVDMETAXFER)RTMemAlloc(RT_OFFSETOF(VDMETAXFER, abData[cb]));
+    bool fArena;
+    PVDMETAXFER pMetaXfer = (PVDMETAXFER)vdIoAuxAlloc(pIoStorage->pVDIo->pDisk, RT_OFFSETOF(VDMETAXFER, abData[cb]), &fArena);
 
     if (RT_LIKELY(pMetaXfer))
     {
@@ -1196,12 +1333,31 @@ DECLINLINE(PVDMETAXFER) vdMetaXferAlloc(PVDIOSTORAGE pIoStorage, uint64_t uOffse
         pMetaXfer->pIoStorage   = pIoStorage;
         pMetaXfer->cRefs        = 0;
         pMetaXfer->pbDataShw    = NULL;
+        pMetaXfer->fArena       = fArena;
+        pMetaXfer->fDataShwArena = false;
         RTListInit(&pMetaXfer->ListIoCtxWaiting);
         RTListInit(&pMetaXfer->ListIoCtxShwWrites);
     }
     return pMetaXfer;
 }
 
+/**
+ * Frees the shadow buffer of a metadata transfer.
+ */
+DECLINLINE(void) vdMetaXferFreeShadow(PVDISK pDisk, PVDMETAXFER pMetaXfer)
+{
+    vdIoAuxFree(pDisk, pMetaXfer->pbDataShw, pMetaXfer->fDataShwArena);
+    pMetaXfer->pbDataShw = NULL;
+}
+
+/**
+ * Frees a metadata transfer.
+ */
+DECLINLINE(void) vdMetaXferFree(PVDISK pDisk, PVDMETAXFER pMetaXfer)
+{
+    vdIoAuxFree(pDisk, pMetaXfer, pMetaXfer->fArena);
+}
+
 DECLINLINE(void) vdIoCtxAddToWaitingList(volatile PVDIOCTX *ppList, PVDIOCTX pIoCtx)
 {
     /* Put it on the waiting list. */
@@ -2687,7 +2843,9 @@ static DECLCALLBACK(int) vdWriteHelperAsync(PVDIOCTX pIoCtx)
                  * Allocate segment and buffer in one go.
                  * A bit hackish but avoids the need to allocate memory twice.
                  */
-                PRTSGBUF pTmp = (PRTSGBUF)RTMemAlloc(cbPreRead + cbThisWrite + cbPostRead + sizeof(RTSGSEG) + sizeof(RTSGBUF));
+                bool fArena;
+                PRTSGBUF pTmp = (PRTSGBUF)vdIoAuxAlloc(pDisk, cbPreRead + cbThisWrite + cbPostRead + sizeof(RTSGSEG) + sizeof(RTSGBUF),
+                                                       &fArena);
                 AssertBreakStmt(pTmp, rc = VERR_NO_MEMORY);
                 PRTSGSEG pSeg = (PRTSGSEG)(pTmp + 1);
 
@@ -2706,10 +2864,11 @@ static DECLCALLBACK(int) vdWriteHelperAsync(PVDIOCTX pIoCtx)
                                                          : vdWriteHelperOptimizedAsync);
                 if (!VALID_PTR(pIoCtxWrite))
                 {
-                    RTMemTmpFree(pTmp);
+                    vdIoAuxFree(pDisk, pTmp, fArena);
                     rc = VERR_NO_MEMORY;
                     break;
                 }
+                pIoCtxWrite->fAllocationArena = fArena;
 
                 LogFlowFunc(("Disk is growing because of pIoCtx=%#p pIoCtxWrite=%#p\n",
                              pIoCtx, pIoCtxWrite));
@@ -3482,7 +3641,7 @@ static void vdIoCtxContinueDeferredList(PVDIOSTORAGE pIoStorage, PRTLISTANCHOR p
         PVDIOCTX pIoCtx = pDeferred->pIoCtx;
         RTListNodeRemove(&pDeferred->NodeDeferred);
 
-        RTMemFree(pDeferred);
+        vdIoCtxDeferredFree(pIoStorage->pVDIo->pDisk, pDeferred);
         ASMAtomicDecU32(&pIoCtx->cMetaTransfersPending);
 
         if (pfnComplete)
@@ -3509,6 +3668,7 @@ static int vdMetaXferCompleted(PVDIOSTORAGE pIoStorage, PFNVDXFERCOMPLETED pfnCo
     PVDISK pDisk = pIoStorage->pVDIo->pDisk;
     RTLISTNODE ListIoCtxWaiting;
     bool fFlush;
+    bool fFailed = false;
 
     LogFlowFunc(("pIoStorage=%#p pfnComplete=%#p pvUser=%#p pMetaXfer=%#p rcReq=%Rrc\n",
                  pIoStorage, pfnComplete, pvUser, pMetaXfer, rcReq));
@@ -3533,10 +3693,10 @@ static int vdMetaXferCompleted(PVDIOSTORAGE pIoStorage, PFNVDXFERCOMPLETED pfnCo
                 Assert(VDMETAXFER_TXDIR_GET(pMetaXfer->fFlags) == VDMETAXFER_TXDIR_WRITE);
                 Assert(!RTListIsEmpty(&pMetaXfer->ListIoCtxShwWrites));
                 RTListConcatenate(&ListIoCtxWaiting, &pMetaXfer->ListIoCtxShwWrites);
-                RTMemFree(pMetaXfer->pbDataShw);
-                pMetaXfer->pbDataShw = NULL;
+                vdMetaXferFreeShadow(pDisk, pMetaXfer);
             }
-            RTMemFree(pMetaXfer);
+            /* Freed below, the deferred contexts may still look at it. */
+            fFailed = true;
         }
         else
         {
@@ -3560,8 +3720,7 @@ static int vdMetaXferCompleted(PVDIOSTORAGE pIoStorage, PFNVDXFERCOMPLETED pfnCo
     {
         LogFlowFunc(("pMetaXfer=%#p Updating from shadow buffer and triggering new write\n", pMetaXfer));
         memcpy(pMetaXfer->abData, pMetaXfer->pbDataShw, pMetaXfer->cbMeta);
-        RTMemFree(pMetaXfer->pbDataShw);
-        pMetaXfer->pbDataShw = NULL;
+        vdMetaXferFreeShadow(pDisk, pMetaXfer);
         Assert(!RTListIsEmpty(&pMetaXfer->ListIoCtxShwWrites));
 
         /* Setup a new I/O write. */
@@ -3598,7 +3757,9 @@ static int vdMetaXferCompleted(PVDIOSTORAGE pIoStorage, PFNVDXFERCOMPLETED pfnCo
     }
 
     /* Remove if not used anymore. */
-    if (!fFlush)
+    if (fFailed)
+        vdMetaXferFree(pDisk, pMetaXfer);
+    else if (!fFlush)
     {
         pMetaXfer->cRefs--;
         if (!pMetaXfer->cRefs && RTListIsEmpty(&pMetaXfer->ListIoCtxWaiting))
@@ -3607,11 +3768,11 @@ static int vdMetaXferCompleted(PVDIOSTORAGE pIoStorage, PFNVDXFERCOMPLETED pfnCo
             LogFlow(("Removing meta xfer=%#p\n", pMetaXfer));
             bool fRemoved = RTAvlrFileOffsetRemove(pIoStorage->pTreeMetaXfers, pMetaXfer->Core.Key) != NULL;
             Assert(fRemoved); NOREF(fRemoved);
-            RTMemFree(pMetaXfer);
+            vdMetaXferFree(pDisk, pMetaXfer);
         }
     }
     else if (fFlush)
-        RTMemFree(pMetaXfer);
+        vdMetaXferFree(pDisk, pMetaXfer);
 
     return VINF_SUCCESS;
 }
@@ -4210,7 +4371,7 @@ static DECLCALLBACK(int) vdIOIntReadMeta(void *pvUser, PVDIOSTORAGE pIoStorage,
             pIoTask = vdIoTaskMetaAlloc(pIoStorage, pfnComplete, pvCompleteUser, pMetaXfer);
             if (!pIoTask)
             {
-                RTMemFree(pMetaXfer);
+                vdMetaXferFree(pDisk, pMetaXfer);
                 return VERR_NO_MEMORY;
             }
 
@@ -4229,7 +4390,7 @@ static DECLCALLBACK(int) vdIOIntReadMeta(void *pvUser, PVDIOSTORAGE pIoStorage,
                 Assert(fInserted); NOREF(fInserted);
             }
             else
-                RTMemFree(pMetaXfer);
+                vdMetaXferFree(pDisk, pMetaXfer);
 
             if (RT_SUCCESS(rc))
             {
@@ -4247,12 +4408,9 @@ static DECLCALLBACK(int) vdIOIntReadMeta(void *pvUser, PVDIOSTORAGE pIoStorage,
             /* If it is pending add the request to the list. */
             if (VDMETAXFER_TXDIR_GET(pMetaXfer->fFlags) == VDMETAXFER_TXDIR_READ)
             {
-                PVDIOCTXDEFERRED pDeferred = (PVDIOCTXDEFERRED)RTMemAllocZ(sizeof(VDIOCTXDEFERRED));
+                PVDIOCTXDEFERRED pDeferred = vdIoCtxDeferredAlloc(pDisk, pIoCtx);
                 AssertPtr(pDeferred);
 
-                RTListInit(&pDeferred->NodeDeferred);
-                pDeferred->pIoCtx = pIoCtx;
-
                 ASMAtomicIncU32(&pIoCtx->cMetaTransfersPending);
                 RTListAppend(&pMetaXfer->ListIoCtxWaiting, &pDeferred->NodeDeferred);
                 rc = VERR_VD_NOT_ENOUGH_METADATA;
@@ -4333,7 +4491,7 @@ static DECLCALLBACK(int) vdIOIntWriteMeta(void *pvUser, PVDIOSTORAGE pIoStorage,
             pIoTask = vdIoTaskMetaAlloc(pIoStorage, pfnComplete, pvCompleteUser, pMetaXfer);
             if (!pIoTask)
             {
-                RTMemFree(pMetaXfer);
+                vdMetaXferFree(pDisk, pMetaXfer);
                 return VERR_NO_MEMORY;
             }
 
@@ -4358,18 +4516,15 @@ static DECLCALLBACK(int) vdIOIntWriteMeta(void *pvUser, PVDIOSTORAGE pIoStorage,
                     LogFlow(("Removing meta xfer=%#p\n", pMetaXfer));
                     bool fRemoved = RTAvlrFileOffsetRemove(pIoStorage->pTreeMetaXfers, pMetaXfer->Core.Key) != NULL;
                     AssertMsg(fRemoved, ("Metadata transfer wasn't removed\n")); NOREF(fRemoved);
-                    RTMemFree(pMetaXfer);
+                    vdMetaXferFree(pDisk, pMetaXfer);
                     pMetaXfer = NULL;
                 }
             }
             else if (rc == VERR_VD_ASYNC_IO_IN_PROGRESS)
             {
-                PVDIOCTXDEFERRED pDeferred = (PVDIOCTXDEFERRED)RTMemAllocZ(sizeof(VDIOCTXDEFERRED));
+                PVDIOCTXDEFERRED pDeferred = vdIoCtxDeferredAlloc(pDisk, pIoCtx);
                 AssertPtr(pDeferred);
 
-                RTListInit(&pDeferred->NodeDeferred);
-                pDeferred->pIoCtx = pIoCtx;
-
                 if (!fInTree)
                 {
                     bool fInserted = RTAvlrFileOffsetInsert(pIoStorage->pTreeMetaXfers, &pMetaXfer->Core);
@@ -4380,7 +4535,7 @@ static DECLCALLBACK(int) vdIOIntWriteMeta(void *pvUser, PVDIOSTORAGE pIoStorage,
             }
             else
             {
-                RTMemFree(pMetaXfer);
+                vdMetaXferFree(pDisk, pMetaXfer);
                 pMetaXfer = NULL;
             }
         }
@@ -4392,7 +4547,7 @@ static DECLCALLBACK(int) vdIOIntWriteMeta(void *pvUser, PVDIOSTORAGE pIoStorage,
             {
                 /* Allocate shadow buffer and set initial state. */
                 LogFlowFunc(("pMetaXfer=%#p Creating shadow buffer\n", pMetaXfer));
-                pMetaXfer->pbDataShw = (uint8_t *)RTMemAlloc(pMetaXfer->cbMeta);
+                pMetaXfer->pbDataShw = (uint8_t *)vdIoAuxAlloc(pDisk, pMetaXfer->cbMeta, &pMetaXfer->fDataShwArena);
                 if (RT_LIKELY(pMetaXfer->pbDataShw))
                     memcpy(pMetaXfer->pbDataShw, pMetaXfer->abData, pMetaXfer->cbMeta);
                 else
@@ -4402,13 +4557,11 @@ static DECLCALLBACK(int) vdIOIntWriteMeta(void *pvUser, PVDIOSTORAGE pIoStorage,
             if (RT_SUCCESS(rc))
             {
                 /* Update with written data and append to waiting list. */
-                PVDIOCTXDEFERRED pDeferred = (PVDIOCTXDEFERRED)RTMemAllocZ(sizeof(VDIOCTXDEFERRED));
+                PVDIOCTXDEFERRED pDeferred = vdIoCtxDeferredAlloc(pDisk, pIoCtx);
                 if (pDeferred)
                 {
                     LogFlowFunc(("pMetaXfer=%#p Updating shadow buffer\n", pMetaXfer));
 
-                    RTListInit(&pDeferred->NodeDeferred);
-                    pDeferred->pIoCtx = pIoCtx;
                     ASMAtomicIncU32(&pIoCtx->cMetaTransfersPending);
                     memcpy(pMetaXfer->pbDataShw, pvBuf, cbWrite);
                     RTListAppend(&pMetaXfer->ListIoCtxShwWrites, &pDeferred->NodeDeferred);
@@ -4420,10 +4573,7 @@ static DECLCALLBACK(int) vdIOIntWriteMeta(void *pvUser, PVDIOSTORAGE pIoStorage,
                      * we just allocated it.
                      */
                     if (RTListIsEmpty(&pMetaXfer->ListIoCtxShwWrites))
-                    {
-                        RTMemFree(pMetaXfer->pbDataShw);
-                        pMetaXfer->pbDataShw = NULL;
-                    }
+                        vdMetaXferFreeShadow(pDisk, pMetaXfer);
                     rc = VERR_NO_MEMORY;
                 }
             }
@@ -4465,7 +4615,7 @@ static DECLCALLBACK(void) vdIOIntMetaXferRelease(void *pvUser, PVDMETAXFER pMeta
         bool fRemoved = RTAvlrFileOffsetRemove(pIoStorage->pTreeMetaXfers, pMetaXfer->Core.Key) != NULL;
         AssertMsg(fRemoved, ("Metadata transfer wasn't removed\n")); NOREF(fRemoved);
 
-        RTMemFree(pMetaXfer);
+        vdMetaXferFree(pDisk, pMetaXfer);
     }
 }
 
@@ -4513,18 +4663,15 @@ static DECLCALLBACK(int) vdIOIntFlush(void *pvUser, PVDIOSTORAGE pIoStorage, PVD
         pIoTask = vdIoTaskMetaAlloc(pIoStorage, pfnComplete, pvUser, pMetaXfer);
         if (!pIoTask)
         {
-            RTMemFree(pMetaXfer);
+            vdMetaXferFree(pDisk, pMetaXfer);
             return VERR_NO_MEMORY;
         }
 
         ASMAtomicIncU32(&pIoCtx->cMetaTransfersPending);
 
-        PVDIOCTXDEFERRED pDeferred = (PVDIOCTXDEFERRED)RTMemAllocZ(sizeof(VDIOCTXDEFERRED));
+        PVDIOCTXDEFERRED pDeferred = vdIoCtxDeferredAlloc(pDisk, pIoCtx);
         AssertPtr(pDeferred);
 
-        RTListInit(&pDeferred->NodeDeferred);
-        pDeferred->pIoCtx = pIoCtx;
-
         RTListAppend(&pMetaXfer->ListIoCtxWaiting, &pDeferred->NodeDeferred);
         VDMETAXFER_TXDIR_SET(pMetaXfer->fFlags, VDMETAXFER_TXDIR_FLUSH);
         rc = pVDIo->pInterfaceIo->pfnFlushAsync(pVDIo->pInterfaceIo->Core.pvUser,
@@ -4535,11 +4682,14 @@ static DECLCALLBACK(int) vdIOIntFlush(void *pvUser, PVDIOSTORAGE pIoStorage, PVD
             VDMETAXFER_TXDIR_SET(pMetaXfer->fFlags, VDMETAXFER_TXDIR_NONE);
             ASMAtomicDecU32(&pIoCtx->cMetaTransfersPending);
             vdIoTaskFree(pDisk, pIoTask);
-            RTMemFree(pDeferred);
-            RTMemFree(pMetaXfer);
+            vdIoCtxDeferredFree(pDisk, pDeferred);
+            vdMetaXferFree(pDisk, pMetaXfer);
         }
         else if (rc != VERR_VD_ASYNC_IO_IN_PROGRESS)
-            RTMemFree(pMetaXfer);
+        {
+            vdIoCtxDeferredFree(pDisk, pDeferred);
+            vdMetaXferFree(pDisk, pMetaXfer);
+        }
     }
 
     LogFlowFunc(("returns rc=%Rrc\n", rc));
@@ -5314,6 +5464,12 @@ VBOXDDU_DECL(int) VDCreate(PVDINTERFACE pVDIfsDisk, VDTYPE enmType, PVDISK *ppDi
             pDisk->fLocked                 = false;
             pDisk->hMemCacheIoCtx          = NIL_RTMEMCACHE;
             pDisk->hMemCacheIoTask         = NIL_RTMEMCACHE;
+            pDisk->hArenaIo                = NIL_RTMEMARENA;
+            pDisk->cArenaIoRefs            = 0;
+            pDisk->cbArenaIoUsed           = 0;
+            RT_ZERO(pDisk->apArenaIoFree);
+            pDisk->cIoAuxAllocs            = 0;
+            pDisk->cIoAuxHeapAllocs        = 0;
             RTListInit(&pDisk->ListFilterChainWrite);
             RTListInit(&pDisk->ListFilterChainRead);
 
@@ -5329,6 +5485,11 @@ VBOXDDU_DECL(int) VDCreate(PVDINTERFACE pVDIfsDisk, VDTYPE enmType, PVDISK *ppDi
             if (RT_FAILURE(rc))
                 break;
 
+            /* Create the arena for the auxiliary I/O context allocations. */
+            rc = RTMemArenaCreate(&pDisk->hArenaIo, 0 /*cbChunk*/, 0 /*fFlags*/);
+            if (RT_FAILURE(rc))
+                break;
+
             pDisk->pInterfaceError      = VDIfErrorGet(pVDIfsDisk);
             pDisk->pInterfaceThreadSync = VDIfThreadSyncGet(pVDIfsDisk);
 
@@ -5348,6 +5509,8 @@ VBOXDDU_DECL(int) VDCreate(PVDINTERFACE pVDIfsDisk, VDTYPE enmType, PVDISK *ppDi
             RTMemCacheDestroy(pDisk->hMemCacheIoCtx);
         if (pDisk->hMemCacheIoTask != NIL_RTMEMCACHE)
             RTMemCacheDestroy(pDisk->hMemCacheIoTask);
+        if (pDisk->hArenaIo != NIL_RTMEMARENA)
+            RTMemArenaDestroy(pDisk->hArenaIo);
     }
 
     LogFlowFunc(("returns %Rrc (pDisk=%#p)\n", rc, pDisk));
@@ -5379,6 +5542,8 @@ VBOXDDU_DECL(int) VDDestroy(PVDISK pDisk)
 
         RTMemCacheDestroy(pDisk->hMemCacheIoCtx);
         RTMemCacheDestroy(pDisk->hMemCacheIoTask);
+        Assert(!pDisk->cArenaIoRefs);
+        RTMemArenaDestroy(pDisk->hArenaIo);
         RTMemFree(pDisk);
     } while (0);
     LogFlowFunc(("returns %Rrc\n", rc));
@@ -10408,6 +10573,57 @@ VBOXDDU_DECL(int) VDAsyncDiscardRanges(PVDISK pDisk, PCRTRANGE paRanges, unsigne
     return rc;
 }
 
+VBOXDDU_DECL(int) VDQueryIoAllocStats(PVDISK pDisk, PVDIOALLOCSTATS pStats)
+{
+    int rc = VINF_SUCCESS;
+    int rc2;
+    bool fLockRead = false;
+
+    LogFlowFunc(("pDisk=%#p pStats=%#p\n", pDisk, pStats));
+    do
+    {
+        /* sanity check */
+        AssertPtrBreakStmt(pDisk, rc = VERR_INVALID_PARAMETER);
+        AssertMsg(pDisk->u32Signature == VDISK_SIGNATURE, ("u32Signature=%08x\n", pDisk->u32Signature));
+
+        /* Check arguments. */
+        AssertMsgBreakStmt(VALID_PTR(pStats),
+                           ("pStats=%#p\n", pStats),
+                           rc = VERR_INVALID_PARAMETER);
+
+        rc2 = vdThreadStartRead(pDisk);
+        AssertRC(rc2);
+        fLockRead = true;
+
+        /* The arena and the counters belong to whoever holds the disk lock,
+           which is never held for long outside of the write lock. */
+        while (!ASMAtomicCmpXchgBool(&pDisk->fLocked, true, false))
+            RTThreadYield();
+
+        RTMEMARENASTATS ArenaStats;
+        rc = RTMemArenaQueryStats(pDisk->hArenaIo, &ArenaStats);
+        if (RT_SUCCESS(rc))
+        {
+            pStats->cAllocs      = pDisk->cIoAuxAllocs;
+            pStats->cHeapAllocs  = pDisk->cIoAuxHeapAllocs + ArenaStats.cHeapAllocs;
+            pStats->cArenaResets = ArenaStats.cResets;
+            pStats->cbArena      = ArenaStats.cbReserved;
+        }
+
+        /* Process whatever got queued while we held the lock. */
+        vdDiskUnlock(pDisk, NULL);
+    } while (0);
+
+    if (RT_UNLIKELY(fLockRead))
+    {
+        rc2 = vdThreadFinishRead(pDisk);
+        AssertRC(rc2);
+    }
+
+    LogFlowFunc(("returns %Rrc\n", rc));
+    return rc;
+}
+
 VBOXDDU_DECL(int) VDRepair(PVDINTERFACE pVDIfsDisk, PVDINTERFACE pVDIfsImage,
                            const char *pszFilename, const char *pszBackend,
                            uint32_t fFlags)
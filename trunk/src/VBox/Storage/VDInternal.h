@@ -25,6 +25,7 @@
 
 #include <iprt/avl.h>
 #include <iprt/list.h>
+#include <iprt/memarena.h>
 #include <iprt/memcache.h>
 
 /** Disable dynamic backends on non x86 architectures. This feature
@@ -170,6 +171,28 @@ typedef struct VDFILTER
 /** Pointer to a VD filter instance. */
 typedef VDFILTER *PVDFILTER;
 
+/** Log2 of the smallest block the auxiliary I/O allocations are served with
+ * from the per-disk arena, header included. */
+#define VD_IO_ARENA_MIN_SHIFT   6
+/** Number of block size classes of the per-disk arena, up to 8KB. */
+#define VD_IO_ARENA_CLASSES     8
+
+/**
+ * Header of a block allocated from the per-disk arena, see vdIoAuxAlloc().
+ */
+typedef struct VDIOAUXHDR
+{
+    /** Next free block of the same size class. */
+    struct VDIOAUXHDR     *pNextFree;
+    /** The size class, i.e. log2 of the block size minus VD_IO_ARENA_MIN_SHIFT. */
+    uint32_t               iClass;
+    /** Padding so the caller gets 16 byte aligned memory. */
+    uint32_t               au32Padding[HC_ARCH_BITS == 64 ? 1 : 2];
+} VDIOAUXHDR;
+AssertCompileSize(VDIOAUXHDR, 16);
+/** Pointer to the header of a per-disk arena block. */
+typedef VDIOAUXHDR *PVDIOAUXHDR;
+
 /**
  * Virtual disk container main structure, private part.
  */
@@ -216,6 +239,21 @@ struct VDISK
     RTMEMCACHE             hMemCacheIoCtx;
     /** Memory cache for I/O tasks. */
     RTMEMCACHE             hMemCacheIoTask;
+    /** Arena for the auxiliary allocations of I/O contexts (deferred list
+     * nodes, metadata transfers, small bounce buffers).  Protected by the disk
+     * lock and reset when the last allocation is freed. */
+    RTMEMARENA             hArenaIo;
+    /** Number of live allocations in hArenaIo. */
+    uint32_t               cArenaIoRefs;
+    /** Number of bytes allocated from hArenaIo since the last reset. */
+    size_t                 cbArenaIoUsed;
+    /** Freed hArenaIo blocks per size class, for reuse while other
+     * allocations keep the arena from being reset. */
+    PVDIOAUXHDR            apArenaIoFree[VD_IO_ARENA_CLASSES];
+    /** Number of auxiliary I/O allocations made. */
+    uint64_t volatile      cIoAuxAllocs;
+    /** Number of auxiliary I/O allocations which went to the heap. */
+    uint64_t volatile      cIoAuxHeapAllocs;
     /** An I/O context is currently using the disk structures
      * Every I/O context must be placed on one of the lists below. */
     volatile bool          fLocked;
@@ -1327,6 +1327,265 @@ DECLINLINE(void) iemReInitDecoder(PVMCPU pVCpu)
 
 
 
+#ifdef IEM_WITH_OPCODE_CACHE
+
+/**
+ * Resets the opcode block cache, invalidating all blocks.
+ *
+ * @param   pVCpu               The cross context virtual CPU structure of the
+ *                              calling thread.
+ */
+DECLINLINE(void) iemOpcodeCacheReset(PVMCPU pVCpu)
+{
+    pVCpu->iem.s.OpCache.iLastHit = 0;
+    if (++pVCpu->iem.s.OpCache.uRevision != 0)
+    { /* very likely */ }
+    else
+    {
+        pVCpu->iem.s.OpCache.uRevision = 1;
+        unsigned i = RT_ELEMENTS(pVCpu->iem.s.OpCache.aBlocks);
+        while (i-- > 0)
+            pVCpu->iem.s.OpCache.aBlocks[i].uRevision = 0;
+    }
+}
+
+
+/**
+ * Arms the opcode block cache for an IEMExecLots run.
+ *
+ * The cached blocks are kept, but their translations must be verified again
+ * before they are used in this run.
+ *
+ * @param   pVCpu               The cross context virtual CPU structure of the
+ *                              calling thread.
+ */
+DECLINLINE(void) iemOpcodeCacheArm(PVMCPU pVCpu)
+{
+    Assert(!pVCpu->iem.s.OpCache.fArmed);
+    if (pVCpu->iem.s.OpCache.fEnabled)
+    {
+# ifdef VBOX_WITH_RAW_MODE_NOT_R0
+        /* PATM may have patched the code, we must read the original bytes. */
+        if (PATMIsEnabled(pVCpu->CTX_SUFF(pVM)))
+            return;
+# endif
+        if (++pVCpu->iem.s.OpCache.uExecRev != 0)
+        { /* very likely */ }
+        else
+        {
+            pVCpu->iem.s.OpCache.uExecRev = 1;
+            iemOpcodeCacheReset(pVCpu);
+        }
+        pVCpu->iem.s.OpCache.fArmed = true;
+    }
+}
+
+
+/**
+ * Disarms the opcode block cache at the end of an IEMExecLots run.
+ *
+ * @param   pVCpu               The cross context virtual CPU structure of the
+ *                              calling thread.
+ */
+DECLINLINE(void) iemOpcodeCacheDisarm(PVMCPU pVCpu)
+{
+    pVCpu->iem.s.OpCache.fArmed = false;
+}
+
+
+/**
+ * Looks up the ring-3 mapping of a guest code page and loads it into a block.
+ *
+ * @returns true on success, false if the page cannot be cached.
+ * @param   pVCpu               The cross context virtual CPU structure of the
+ *                              calling thread.
+ * @param   pBlock              The block to load.
+ * @param   GCPhysPage          The guest physical address of the page.
+ */
+IEM_STATIC bool iemOpcodeCacheLoadPage(PVMCPU pVCpu, PIEMOPCACHEBLOCK pBlock, RTGCPHYS GCPhysPage)
+{
+    PVM pVM = pVCpu->CTX_SUFF(pVM);
+
+    /* Only plain RAM that can be read without involving access handlers. */
+    if (PGMPhysIemQueryAccess(pVM, GCPhysPage, false /*fWritable*/, false /*fByPassHandlers*/) == VINF_SUCCESS)
+    {
+        int rc = PGMPhysIemQueryCodePage(pVM, pVCpu, GCPhysPage, &pBlock->pbPageR3, &pBlock->pvPgmPageR3,
+                                         &pBlock->uPgmCookie, &pBlock->uPgmGen);
+        if (RT_SUCCESS(rc))
+            return true;
+    }
+    pVCpu->iem.s.OpCache.cUncacheable++;
+    return false;
+}
+
+
+/**
+ * Loads a guest code page into the opcode block cache.
+ *
+ * @returns Index of the block on success, IEM_OPCACHE_BLOCKS if the page cannot
+ *          be cached.  The latter includes translation failures, which the
+ *          caller will run into and report again when taking the regular
+ *          path.
+ * @param   pVCpu               The cross context virtual CPU structure of the
+ *                              calling thread.
+ * @param   GCPtrPage           The linear address of the page.
+ */
+IEM_STATIC unsigned iemOpcodeCacheFill(PVMCPU pVCpu, RTGCPTR GCPtrPage)
+{
+    PIEMOPCACHE pCache = &pVCpu->iem.s.OpCache;
+    pCache->cMisses++;
+
+    RTGCPHYS    GCPhysPage;
+    uint64_t    fFlags;
+    int rc = PGMGstGetPage(pVCpu, GCPtrPage, &fFlags, &GCPhysPage);
+    if (RT_FAILURE(rc))
+        return IEM_OPCACHE_BLOCKS;
+    GCPhysPage &= ~(RTGCPHYS)PAGE_OFFSET_MASK;
+
+    unsigned const   iBlock = pCache->iNextVictim;
+    PIEMOPCACHEBLOCK pBlock = &pCache->aBlocks[iBlock];
+    pBlock->uRevision = 0;
+    if (!iemOpcodeCacheLoadPage(pVCpu, pBlock, GCPhysPage))
+        return IEM_OPCACHE_BLOCKS;
+    pCache->iNextVictim = (uint8_t)((iBlock + 1) % IEM_OPCACHE_BLOCKS);
+
+    pBlock->GCPtrPage  = GCPtrPage;
+    pBlock->GCPhysPage = GCPhysPage;
+    pBlock->fPteFlags  = fFlags;
+    pBlock->cHits      = 0;
+    pBlock->uExecRev   = pCache->uExecRev;
+    pBlock->uRevision  = pCache->uRevision;
+    Log5(("iemOpcodeCacheFill: #%u %RGv -> %RGp\n", iBlock, GCPtrPage, GCPhysPage));
+    return iBlock;
+}
+
+
+/**
+ * Verifies a block which was loaded by an earlier IEMExecLots run.
+ *
+ * @returns true if the block can be used, false if not (it is then invalid).
+ * @param   pVCpu               The cross context virtual CPU structure of the
+ *                              calling thread.
+ * @param   pBlock              The block.
+ */
+IEM_STATIC bool iemOpcodeCacheReverify(PVMCPU pVCpu, PIEMOPCACHEBLOCK pBlock)
+{
+    RTGCPHYS    GCPhysPage;
+    uint64_t    fFlags;
+    int rc = PGMGstGetPage(pVCpu, pBlock->GCPtrPage, &fFlags, &GCPhysPage);
+    if (   RT_SUCCESS(rc)
+        && (GCPhysPage & ~(RTGCPHYS)PAGE_OFFSET_MASK) == pBlock->GCPhysPage)
+    {
+        pBlock->fPteFlags = fFlags;
+        pBlock->uExecRev  = pVCpu->iem.s.OpCache.uExecRev;
+        pVCpu->iem.s.OpCache.cReverified++;
+        return true;
+    }
+    pBlock->uRevision = 0;
+    return false;
+}
+
+
+/**
+ * Tries to satisfy an opcode fetch from the opcode block cache.
+ *
+ * @returns true if the bytes were copied, false if the caller must take the
+ *          regular path (which also takes care of raising any exceptions).
+ * @param   pVCpu               The cross context virtual CPU structure of the
+ *                              calling thread.
+ * @param   GCPtr               The linear address to fetch from.
+ * @param   pbDst               Where to return the opcode bytes.
+ * @param   cbToRead            Number of bytes to fetch.  The range must not
+ *                              cross a page boundary.
+ */
+IEM_STATIC bool iemOpcodeCacheFetch(PVMCPU pVCpu, RTGCPTR GCPtr, uint8_t *pbDst, uint32_t cbToRead)
+{
+    PIEMOPCACHE pCache = &pVCpu->iem.s.OpCache;
+    Assert(pCache->fArmed);
+    Assert(cbToRead > 0 && (GCPtr & PAGE_OFFSET_MASK) + cbToRead <= PAGE_SIZE);
+
+    /*
+     * Look up the page, starting with the block that satisfied the previous fetch.
+     */
+    RTGCPTR const    GCPtrPage = GCPtr & ~(RTGCPTR)PAGE_OFFSET_MASK;
+    unsigned         iBlock    = pCache->iLastHit;
+    PIEMOPCACHEBLOCK pBlock    = &pCache->aBlocks[iBlock];
+    if (   pBlock->GCPtrPage == GCPtrPage
+        && pBlock->uRevision == pCache->uRevision
+        && pBlock->uExecRev  == pCache->uExecRev)
+    { /* likely */ }
+    else
+    {
+        for (iBlock = 0; iBlock < IEM_OPCACHE_BLOCKS; iBlock++)
+        {
+            pBlock = &pCache->aBlocks[iBlock];
+            if (   pBlock->GCPtrPage == GCPtrPage
+                && pBlock->uRevision == pCache->uRevision)
+                break;
+        }
+        if (   iBlock >= IEM_OPCACHE_BLOCKS
+            || (   pBlock->uExecRev != pCache->uExecRev
+                && !iemOpcodeCacheReverify(pVCpu, pBlock)))
+        {
+            iBlock = iemOpcodeCacheFill(pVCpu, GCPtrPage);
+            if (iBlock >= IEM_OPCACHE_BLOCKS)
+                return false;
+            pBlock = &pCache->aBlocks[iBlock];
+        }
+        pCache->iLastHit = (uint8_t)iBlock;
+    }
+
+    /*
+     * Check that PGM didn't replace the page or take away the mapping.
+     */
+    if (PGMPhysIemIsCodePageValid(pVCpu->CTX_SUFF(pVM), pBlock->pvPgmPageR3, pBlock->uPgmCookie, pBlock->uPgmGen))
+    { /* likely */ }
+    else
+    {
+        pCache->cStale++;
+        if (!iemOpcodeCacheLoadPage(pVCpu, pBlock, pBlock->GCPhysPage))
+        {
+            pBlock->uRevision = 0;
+            return false;
+        }
+    }
+
+    /*
+     * The access checks depend on the current CPL and EFER.NXE.  Leave the
+     * #PF raising to the regular path.
+     */
+    if (   (!(pBlock->fPteFlags & X86_PTE_US) && pVCpu->iem.s.uCpl == 3)
+        || ((pBlock->fPteFlags & X86_PTE_PAE_NX) && (IEM_GET_CTX(pVCpu)->msrEFER & MSR_K6_EFER_NXE)))
+        return false;
+
+    memcpy(pbDst, pBlock->pbPageR3 + (GCPtr & PAGE_OFFSET_MASK), cbToRead);
+    pBlock->cHits++;
+    pCache->cHits++;
+    return true;
+}
+
+#endif /* IEM_WITH_OPCODE_CACHE */
+
+
+/**
+ * Invalidates the whole opcode block cache.
+ *
+ * Called on TLB flushes, A20 changes and paging control register writes.
+ *
+ * @param   pVCpu               The cross context virtual CPU structure of the
+ *                              calling thread.
+ */
+DECLINLINE(void) iemOpcodeCacheInvalidateAll(PVMCPU pVCpu)
+{
+#ifdef IEM_WITH_OPCODE_CACHE
+    iemOpcodeCacheReset(pVCpu);
+    pVCpu->iem.s.OpCache.cFlushes++;
+#else
+    RT_NOREF_PV(pVCpu);
+#endif
+}
+
+
 /**
  * Prefetch opcodes the first time when starting executing.
  *
@@ -1395,6 +1654,19 @@ IEM_STATIC VBOXSTRICTRC iemInitDecoderAndPrefetchOpcodes(PVMCPU pVCpu, bool fByp
     }
 # endif /* VBOX_WITH_RAW_MODE_NOT_R0 */
 
+# ifdef IEM_WITH_OPCODE_CACHE
+    if (pVCpu->iem.s.OpCache.fArmed)
+    {
+        uint32_t const cbToCopy = RT_MIN(RT_MIN(cbToTryRead, PAGE_SIZE - (GCPtrPC & PAGE_OFFSET_MASK)),
+                                         sizeof(pVCpu->iem.s.abOpcode));
+        if (iemOpcodeCacheFetch(pVCpu, GCPtrPC, pVCpu->iem.s.abOpcode, cbToCopy))
+        {
+            pVCpu->iem.s.cbOpcode = (uint8_t)cbToCopy;
+            return VINF_SUCCESS;
+        }
+    }
+# endif
+
     RTGCPHYS    GCPhys;
     uint64_t    fFlags;
     int rc = PGMGstGetPage(pVCpu, GCPtrPC, &fFlags, &GCPhys);
@@ -1539,6 +1811,7 @@ VMM_INT_DECL(void) IEMTlbInvalidateAll(PVMCPU pVCpu, bool fVmm)
             pVCpu->iem.s.DataTlb.aEntries[i].uTag = 0;
     }
 #endif
+    iemOpcodeCacheInvalidateAll(pVCpu);
     NOREF(pVCpu); NOREF(fVmm);
 }
 
@@ -1552,6 +1825,14 @@ VMM_INT_DECL(void) IEMTlbInvalidateAll(PVMCPU pVCpu, bool fVmm)
  */
 VMM_INT_DECL(void) IEMTlbInvalidatePage(PVMCPU pVCpu, RTGCPTR GCPtr)
 {
+#ifdef IEM_WITH_OPCODE_CACHE
+    RTGCPTR const GCPtrPage = GCPtr & ~(RTGCPTR)PAGE_OFFSET_MASK;
+    unsigned i = RT_ELEMENTS(pVCpu->iem.s.OpCache.aBlocks);
+    while (i-- > 0)
+        if (pVCpu->iem.s.OpCache.aBlocks[i].GCPtrPage == GCPtrPage)
+            pVCpu->iem.s.OpCache.aBlocks[i].uRevision = 0;
+#endif
+
 #if defined(IEM_WITH_CODE_TLB) || defined(IEM_WITH_DATA_TLB)
     GCPtr = GCPtr >> X86_PAGE_SHIFT;
     AssertCompile(RT_ELEMENTS(pVCpu->iem.s.CodeTlb.aEntries) == 256);
@@ -1587,6 +1868,8 @@ VMM_INT_DECL(void) IEMTlbInvalidatePage(PVMCPU pVCpu, RTGCPTR GCPtr)
  */
 VMM_INT_DECL(void) IEMTlbInvalidateAllPhysical(PVMCPU pVCpu)
 {
+    iemOpcodeCacheInvalidateAll(pVCpu);
+
 #if defined(IEM_WITH_CODE_TLB) || defined(IEM_WITH_DATA_TLB)
     /* Note! This probably won't end up looking exactly like this, but it give an idea... */
 
@@ -2010,6 +2293,15 @@ IEM_STATIC VBOXSTRICTRC iemOpcodeFetchMoreBytes(PVMCPU pVCpu, size_t cbMin)
     }
 # endif /* VBOX_WITH_RAW_MODE_NOT_R0 */
 
+# ifdef IEM_WITH_OPCODE_CACHE
+    if (   pVCpu->iem.s.OpCache.fArmed
+        && iemOpcodeCacheFetch(pVCpu, GCPtrNext, &pVCpu->iem.s.abOpcode[pVCpu->iem.s.cbOpcode], cbToTryRead))
+    {
+        pVCpu->iem.s.cbOpcode += cbToTryRead;
+        return VINF_SUCCESS;
+    }
+# endif
+
     RTGCPHYS    GCPhys;
     uint64_t    fFlags;
     int rc = PGMGstGetPage(pVCpu, GCPtrNext, &fFlags, &GCPhys);
@@ -14741,6 +15033,9 @@ VMMDECL(VBOXSTRICTRC) IEMExecLots(PVMCPU pVCpu, uint32_t *pcInstructions)
     /*
      * Initial decoder init w/ prefetch, then setup setjmp.
      */
+# ifdef IEM_WITH_OPCODE_CACHE
+    iemOpcodeCacheArm(pVCpu);
+# endif
     VBOXSTRICTRC rcStrict = iemInitDecoderAndPrefetchOpcodes(pVCpu, false);
     if (rcStrict == VINF_SUCCESS)
     {
@@ -14835,6 +15130,10 @@ VMMDECL(VBOXSTRICTRC) IEMExecLots(PVMCPU pVCpu, uint32_t *pcInstructions)
 # endif
     }
 
+# ifdef IEM_WITH_OPCODE_CACHE
+    iemOpcodeCacheDisarm(pVCpu);
+# endif
+
     /*
      * Maybe re-enter raw-mode and log.
      */
@@ -5121,6 +5121,8 @@ IEM_CIMPL_DEF_4(iemCImpl_load_CrX, uint8_t, iCrReg, uint64_t, uNewCrX, IEMACCESS
 #ifndef VBOX_WITH_NESTED_HWVIRT
     RT_NOREF2(iGReg, enmAccessCrX);
 #endif
+    if (iCrReg == 0 || iCrReg == 3 || iCrReg == 4)
+        iemOpcodeCacheInvalidateAll(pVCpu); /* paging may change */
 
     /*
      * Try store it.
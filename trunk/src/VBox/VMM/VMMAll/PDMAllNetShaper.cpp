@@ -21,7 +21,9 @@
 *********************************************************************************************************************************/
 #define LOG_GROUP LOG_GROUP_NET_SHAPER
 #include <VBox/vmm/pdm.h>
+#include <VBox/sup.h>
 #include <VBox/log.h>
+#include <iprt/asm.h>
 #include <iprt/time.h>
 
 #include <VBox/vmm/pdmnetshaper.h>
@@ -31,6 +33,12 @@
 /**
  * Obtain bandwidth in a bandwidth group.
  *
+ * The transfer is first paid for with the credit the TX thread handed the
+ * filter when it was last choked, the rest must be available in the bucket of
+ * the group and of every one of its ancestors.  If it isn't, the filter is
+ * marked choked and the TX thread is told to call pfnXmitPending once the
+ * buckets have filled up enough.
+ *
  * @returns True if bandwidth was allocated, false if not.
  * @param   pFilter         Pointer to the filter that allocates bandwidth.
  * @param   cbTransfer      Number of bytes to allocate.
@@ -46,32 +54,72 @@ VMMDECL(bool) PDMNsAllocateBandwidth(PPDMNSFILTER pFilter, size_t cbTransfer)
     if (RT_UNLIKELY(rc == VERR_SEM_BUSY))
         return true;
 
-    bool fAllowed = true;
-    if (pBwGroup->cbPerSecMax)
+    bool           fAllowed     = true;
+    bool           fSignal      = false;
+    uint32_t const cbTransfer32 = (uint32_t)RT_MIN(cbTransfer, UINT32_MAX);
+    uint32_t const cbFromCredit = RT_MIN(pFilter->cbCredit, cbTransfer32);
+    uint32_t const cbNeeded     = cbTransfer32 - cbFromCredit;
+    if (cbNeeded)
     {
-        /* Re-fill the bucket first */
-        uint64_t tsNow        = RTTimeSystemNanoTS();
-        uint32_t uTokensAdded = (tsNow - pBwGroup->tsUpdatedLast) * pBwGroup->cbPerSecMax / (1000 * 1000 * 1000);
-        uint32_t uTokens      = RT_MIN(pBwGroup->cbBucket, uTokensAdded + pBwGroup->cbTokensLast);
+        /*
+         * Check the buckets all the way up, taking the locks child before
+         * parent.  Should an ancestor be busy we can't charge it, so the
+         * transfer is deferred to the TX thread which takes the locks the
+         * slow way and wakes us up again.
+         */
+        PPDMNSBWGROUP  apChain[PDM_NETSHAPER_MAX_DEPTH];
+        uint32_t       acbTokens[PDM_NETSHAPER_MAX_DEPTH];
+        unsigned       cLevels = 0;
+        uint64_t const tsNow   = RTTimeSystemNanoTS();
+        for (PPDMNSBWGROUP pCur = pBwGroup; pCur && cLevels < RT_ELEMENTS(apChain); pCur = pCur->CTX_SUFF(pParent))
+        {
+            if (pCur != pBwGroup)
+            {
+                rc = PDMCritSectEnter(&pCur->Lock, VERR_SEM_BUSY);
+                if (RT_UNLIKELY(rc == VERR_SEM_BUSY))
+                {
+                    fAllowed = false;
+                    break;
+                }
+                AssertRC(rc);
+            }
+            apChain[cLevels]   = pCur;
+            acbTokens[cLevels] = pdmNsBwGroupPeekTokens(pCur, tsNow);
+            if (acbTokens[cLevels] < cbNeeded)
+                fAllowed = false;
+            cLevels++;
+        }
 
-        if (cbTransfer > uTokens)
+        if (fAllowed)
+            for (unsigned i = 0; i < cLevels; i++)
+                pdmNsBwGroupConsume(apChain[i], tsNow, acbTokens[i], cbNeeded);
+        else
         {
-            fAllowed = false;
             ASMAtomicWriteBool(&pFilter->fChoked, true);
+            if (pBwGroup->cbPendingMax < cbNeeded)
+                pBwGroup->cbPendingMax = cbNeeded;
+            fSignal = !ASMAtomicXchgBool(&pBwGroup->fWaiters, true);
         }
-        else
+        Log2(("pdmNsAllocateBandwidth: BwGroup=%#p{%s} cbTransfer=%u cbNeeded=%u uTokens=%u cLevels=%u fAllowed=%RTbool\n",
+              pBwGroup, R3STRING(pBwGroup->pszNameR3), cbTransfer, cbNeeded, acbTokens[0], cLevels, fAllowed));
+
+        while (cLevels-- > 1)
         {
-            pBwGroup->tsUpdatedLast = tsNow;
-            pBwGroup->cbTokensLast = uTokens - (uint32_t)cbTransfer;
+            rc = PDMCritSectLeave(&apChain[cLevels]->Lock); AssertRC(rc);
         }
-        Log2(("pdmNsAllocateBandwidth: BwGroup=%#p{%s} cbTransfer=%u uTokens=%u uTokensAdded=%u fAllowed=%RTbool\n",
-              pBwGroup, R3STRING(pBwGroup->pszNameR3), cbTransfer, uTokens, uTokensAdded, fAllowed));
     }
     else
-        Log2(("pdmNsAllocateBandwidth: BwGroup=%#p{%s} disabled fAllowed=%RTbool\n",
-              pBwGroup, R3STRING(pBwGroup->pszNameR3), fAllowed));
+        Log2(("pdmNsAllocateBandwidth: BwGroup=%#p{%s} cbTransfer=%u paid from credit %u\n",
+              pBwGroup, R3STRING(pBwGroup->pszNameR3), cbTransfer, pFilter->cbCredit));
+    if (fAllowed)
+        pFilter->cbCredit -= cbFromCredit;
 
     rc = PDMCritSectLeave(&pBwGroup->Lock); AssertRC(rc);
+
+    /* Let the TX thread know it has to work out when to wake us up. */
+    if (fSignal)
+    {
+        rc = SUPSemEventSignal(pBwGroup->pSession, pBwGroup->hEvtWakeup); AssertRC(rc);
+    }
     return fAllowed;
 }
-
@@ -604,6 +604,9 @@ void pgmPhysInvalidatePageMapTLB(PVM pVM)
 
     /** @todo clear the RC TLB whenever we add it. */
 
+    /* The ring-3 mappings may go away, so tell IEM. */
+    pgmPhysBumpMapGen(pVM);
+
     pgmUnlock(pVM);
 }
 
@@ -4698,3 +4701,97 @@ VMM_INT_DECL(int) PGMPhysIemQueryAccess(PVM pVM, RTGCPHYS GCPhys, bool fWritable
     return rc;
 }
 
+
+#ifdef IN_RING3
+
+/**
+ * Looks up a guest code page for IEM's opcode cache.
+ *
+ * Only plain RAM pages that can be read without involving access handlers
+ * qualify.  IEM reads the opcode bytes straight from the returned mapping
+ * after checking with PGMPhysIemIsCodePageValid that nothing changed.
+ *
+ * @returns VBox status code.
+ * @retval  VINF_SUCCESS on success.
+ * @retval  VERR_PGM_PHYS_TLB_CATCH_ALL if the page has an all access handler,
+ *          is MMIO, ballooned or similar.
+ * @retval  VERR_PGM_PHYS_TLB_UNASSIGNED if the page doesn't exist.
+ *
+ * @param   pVM             The cross context VM structure.
+ * @param   pVCpu           The cross context virtual CPU structure of the
+ *                          calling EMT.
+ * @param   GCPhys          The guest physical address of the page.  This API
+ *                          masks the A20 line when necessary.
+ * @param   ppbPage         Where to return the ring-3 mapping of the page.
+ * @param   ppvPage         Where to return the page identity for
+ *                          PGMPhysIemIsCodePageValid.
+ * @param   puCookie        Where to return the page cookie for
+ *                          PGMPhysIemIsCodePageValid.
+ * @param   puGen           Where to return the mapping generation for
+ *                          PGMPhysIemIsCodePageValid.
+ *
+ * @thread  EMT(pVCpu).
+ */
+VMM_INT_DECL(int) PGMPhysIemQueryCodePage(PVM pVM, PVMCPU pVCpu, RTGCPHYS GCPhys, uint8_t const **ppbPage,
+                                          void const **ppvPage, uint64_t *puCookie, uint32_t *puGen)
+{
+    PGM_A20_APPLY_TO_VAR(pVCpu, GCPhys);
+    GCPhys &= ~(RTGCPHYS)PAGE_OFFSET_MASK;
+
+    pgmLock(pVM);
+
+    PPGMPAGE pPage;
+    int rc = pgmPhysGetPageEx(pVM, GCPhys, &pPage);
+    if (RT_SUCCESS(rc))
+    {
+        if (   PGM_PAGE_IS_BALLOONED(pPage)
+            || PGM_PAGE_IS_SPECIAL_ALIAS_MMIO(pPage)
+            || PGM_PAGE_IS_MMIO(pPage)
+            || PGM_PAGE_HAS_ACTIVE_ALL_HANDLERS(pPage))
+            rc = VERR_PGM_PHYS_TLB_CATCH_ALL;
+        else
+        {
+            PPGMPAGEMAPTLBE pTlbe;
+            rc = pgmPhysPageQueryTlbeWithPage(pVM, pPage, GCPhys, &pTlbe);
+            if (RT_SUCCESS(rc))
+            {
+                *ppbPage  = (uint8_t const *)pTlbe->pv;
+                *ppvPage  = pPage;
+                *puCookie = PGM_PAGE_GET_IEM_CODE_COOKIE(pPage);
+                *puGen    = pVM->pgm.s.uPhysMapGen;
+            }
+        }
+    }
+
+    pgmUnlock(pVM);
+    return rc;
+}
+
+
+/**
+ * Checks that a page returned by PGMPhysIemQueryCodePage can still be read
+ * via the returned mapping.
+ *
+ * The page must be looked up again if the backing page was replaced, if an
+ * access handler was registered or deregistered for it, if its page state
+ * changed (e.g. a zero page being allocated), or if the ring-3 mappings might
+ * have gone away.
+ *
+ * @returns true if valid, false if not.
+ * @param   pVM             The cross context VM structure.
+ * @param   pvPage          The page identity returned by
+ *                          PGMPhysIemQueryCodePage.
+ * @param   uCookie         The page cookie returned by PGMPhysIemQueryCodePage.
+ * @param   uGen            The mapping generation returned by
+ *                          PGMPhysIemQueryCodePage.
+ *
+ * @remarks No locking, this is called for every opcode fetch.  Mapping chunks
+ *          are only unmapped while all EMTs are in a rendezvous.
+ */
+VMM_INT_DECL(bool) PGMPhysIemIsCodePageValid(PVM pVM, void const *pvPage, uint64_t uCookie, uint32_t uGen)
+{
+    return ASMAtomicUoReadU32(&pVM->pgm.s.uPhysMapGen) == uGen
+        && PGM_PAGE_GET_IEM_CODE_COOKIE((PPGMPAGE)pvPage) == uCookie;
+}
+
+#endif /* IN_RING3 */
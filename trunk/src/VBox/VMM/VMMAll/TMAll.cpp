@@ -273,12 +273,35 @@ DECLINLINE(void) tmScheduleNotify(PVM pVM)
 DECLINLINE(void) tmSchedule(PTMTIMER pTimer)
 {
     PVM pVM = pTimer->CTX_SUFF(pVM);
-    if (    VM_IS_EMT(pVM)
+    if (RT_UNLIKELY(TMTIMERQUEUE_IDX_IS_POOL(pTimer->idxQueue)))
+    {
+        /*
+         * Thread pool timers can be scheduled by anyone getting hold of the
+         * queue lock.  If it's busy the owner will pick up the change, else
+         * the pool threads will when they get around to it.
+         */
+#ifdef IN_RING3
+        PTMTIMERQUEUER3 pQueueR3 = &pVM->tm.s.paTimerQueuesR3Data[pTimer->idxQueue];
+        if (RT_SUCCESS(RTCritSectTryEnter(&pQueueR3->CritSect)))
+        {
+            STAM_PROFILE_START(&pVM->tm.s.CTX_SUFF_Z(StatScheduleOne), a);
+            tmTimerQueueSchedule(pVM, pQueueR3->pQueue);
+            STAM_PROFILE_STOP(&pVM->tm.s.CTX_SUFF_Z(StatScheduleOne), a);
+            RTCritSectLeave(&pQueueR3->CritSect);
+        }
+        else if (TMTIMERSTATE_IS_PENDING_SCHEDULING(pTimer->enmState))
+            tmR3TimerPoolWakeUp();
+#else
+        if (TMTIMERSTATE_IS_PENDING_SCHEDULING(pTimer->enmState))
+            tmScheduleNotify(pVM);
+#endif
+    }
+    else if (    VM_IS_EMT(pVM)
         &&  RT_SUCCESS(TM_TRY_LOCK_TIMERS(pVM)))
     {
         STAM_PROFILE_START(&pVM->tm.s.CTX_SUFF_Z(StatScheduleOne), a);
         Log3(("tmSchedule: tmTimerQueueSchedule\n"));
-        tmTimerQueueSchedule(pVM, &pVM->tm.s.CTX_SUFF(paTimerQueues)[pTimer->enmClock]);
+        tmTimerQueueSchedule(pVM, &pVM->tm.s.CTX_SUFF(paTimerQueues)[pTimer->idxQueue]);
 #ifdef VBOX_STRICT
         tmTimerQueuesSanityChecks(pVM, "tmSchedule");
 #endif
@@ -352,7 +375,7 @@ DECLINLINE(bool) tmTimerTryWithLink(PTMTIMER pTimer, TMTIMERSTATE enmStateNew, T
 {
     if (tmTimerTry(pTimer, enmStateNew, enmStateOld))
     {
-        tmTimerLinkSchedule(&pTimer->CTX_SUFF(pVM)->tm.s.CTX_SUFF(paTimerQueues)[pTimer->enmClock], pTimer);
+        tmTimerLinkSchedule(&pTimer->CTX_SUFF(pVM)->tm.s.CTX_SUFF(paTimerQueues)[pTimer->idxQueue], pTimer);
         return true;
     }
     return false;
@@ -372,44 +395,25 @@ DECL_FORCE_INLINE(void) tmTimerQueueLinkActive(PTMTIMERQUEUE pQueue, PTMTIMER pT
 {
     Assert(!pTimer->offNext);
     Assert(!pTimer->offPrev);
+    Assert(!pTimer->offChild);
     Assert(pTimer->enmState == TMTIMERSTATE_ACTIVE || pTimer->enmClock != TMCLOCK_VIRTUAL_SYNC); /* (active is not a stable state) */
+    Assert(pTimer->u64Expire == u64Expire); NOREF(u64Expire);
 
-    PTMTIMER pCur = TMTIMER_GET_HEAD(pQueue);
-    if (pCur)
-    {
-        for (;; pCur = TMTIMER_GET_NEXT(pCur))
-        {
-            if (pCur->u64Expire > u64Expire)
-            {
-                const PTMTIMER pPrev = TMTIMER_GET_PREV(pCur);
-                TMTIMER_SET_NEXT(pTimer, pCur);
-                TMTIMER_SET_PREV(pTimer, pPrev);
-                if (pPrev)
-                    TMTIMER_SET_NEXT(pPrev, pTimer);
-                else
-                {
-                    TMTIMER_SET_HEAD(pQueue, pTimer);
-                    ASMAtomicWriteU64(&pQueue->u64Expire, u64Expire);
-                    DBGFTRACE_U64_TAG2(pTimer->CTX_SUFF(pVM), u64Expire, "tmTimerQueueLinkActive head", R3STRING(pTimer->pszDesc));
-                }
-                TMTIMER_SET_PREV(pCur, pTimer);
-                return;
-            }
-            if (!pCur->offNext)
-            {
-                TMTIMER_SET_NEXT(pCur, pTimer);
-                TMTIMER_SET_PREV(pTimer, pCur);
-                DBGFTRACE_U64_TAG2(pTimer->CTX_SUFF(pVM), u64Expire, "tmTimerQueueLinkActive tail", R3STRING(pTimer->pszDesc));
-                return;
-            }
-        }
-    }
-    else
+    PTMTIMER const pHead    = TMTIMER_GET_HEAD(pQueue);
+    PTMTIMER const pNewHead = tmTimerHeapInsert(pHead, pTimer);
+    if (pNewHead != pHead)
     {
-        TMTIMER_SET_HEAD(pQueue, pTimer);
+        TMTIMER_SET_HEAD(pQueue, pNewHead);
         ASMAtomicWriteU64(&pQueue->u64Expire, u64Expire);
-        DBGFTRACE_U64_TAG2(pTimer->CTX_SUFF(pVM), u64Expire, "tmTimerQueueLinkActive empty", R3STRING(pTimer->pszDesc));
+        DBGFTRACE_U64_TAG2(pTimer->CTX_SUFF(pVM), u64Expire, "tmTimerQueueLinkActive head", R3STRING(pTimer->pszDesc));
+#ifdef IN_RING3
+        /* The pool threads may be sleeping on a later deadline. */
+        if (TMTIMERQUEUE_IDX_IS_POOL(pQueue->idxQueue))
+            tmR3TimerPoolWakeUp();
+#endif
     }
+    else
+        DBGFTRACE_U64_TAG2(pTimer->CTX_SUFF(pVM), u64Expire, "tmTimerQueueLinkActive", R3STRING(pTimer->pszDesc));
 }
 
 
@@ -515,7 +519,7 @@ DECLINLINE(void) tmTimerQueueScheduleOne(PTMTIMERQUEUE pQueue, PTMTIMER pTimer)
  */
 void tmTimerQueueSchedule(PVM pVM, PTMTIMERQUEUE pQueue)
 {
-    TM_ASSERT_TIMER_LOCK_OWNERSHIP(pVM);
+    TM_ASSERT_QUEUE_LOCK_OWNERSHIP(pVM, pQueue);
     NOREF(pVM);
 
     /*
@@ -574,11 +578,22 @@ void tmTimerQueuesSanityChecks(PVM pVM, const char *pszWhere)
                 continue;
             fHaveVirtualSyncLock = true;
         }
-        PTMTIMER pPrev = NULL;
-        for (PTMTIMER pCur = TMTIMER_GET_HEAD(pQueue); pCur; pPrev = pCur, pCur = TMTIMER_GET_NEXT(pCur))
+        PTMTIMER pHead = TMTIMER_GET_HEAD(pQueue);
+        AssertMsg(!pHead || !pHead->offPrev, ("%s: %RI32\n", pszWhere, pHead ? pHead->offPrev : 0));
+        for (PTMTIMER pCur = pHead; pCur; pCur = tmTimerHeapWalkNext(pCur))
         {
             AssertMsg((int)pCur->enmClock == i, ("%s: %d != %d\n", pszWhere, pCur->enmClock, i));
-            AssertMsg(TMTIMER_GET_PREV(pCur) == pPrev, ("%s: %p != %p\n", pszWhere, TMTIMER_GET_PREV(pCur), pPrev));
+            for (PTMTIMER pChild = TMTIMER_GET_CHILD(pCur); pChild; pChild = TMTIMER_GET_NEXT(pChild))
+            {
+                AssertMsg(   pChild == TMTIMER_GET_CHILD(pCur)
+                          ?  TMTIMER_GET_PREV(pChild) == pCur
+                          :  TMTIMER_GET_NEXT(TMTIMER_GET_PREV(pChild)) == pChild,
+                          ("%s: %p bad prev link %p\n", pszWhere, pChild, TMTIMER_GET_PREV(pChild)));
+                AssertMsg(   pChild->u64Expire >= pCur->u64Expire
+                          || pChild->enmState != TMTIMERSTATE_ACTIVE
+                          || pCur->enmState   != TMTIMERSTATE_ACTIVE,
+                          ("%s: heap order %'RU64 < %'RU64\n", pszWhere, pChild->u64Expire, pCur->u64Expire));
+            }
             TMTIMERSTATE enmState = pCur->enmState;
             switch (enmState)
             {
@@ -608,6 +623,9 @@ void tmTimerQueuesSanityChecks(PVM pVM, const char *pszWhere)
     {
         Assert(pCur->pBigPrev == pPrev);
         Assert((unsigned)pCur->enmClock < (unsigned)TMCLOCK_MAX);
+        Assert(pCur->idxQueue == (unsigned)pCur->enmClock || TMTIMERQUEUE_IDX_IS_POOL(pCur->idxQueue));
+        if (TMTIMERQUEUE_IDX_IS_POOL(pCur->idxQueue))
+            continue; /* Serialized by the queue lock, not ours. */
 
         TMTIMERSTATE enmState = pCur->enmState;
         switch (enmState)
@@ -621,7 +639,7 @@ void tmTimerQueuesSanityChecks(PVM pVM, const char *pszWhere)
                     PTMTIMERR3 pCurAct = TMTIMER_GET_HEAD(&pVM->tm.s.CTX_SUFF(paTimerQueues)[pCur->enmClock]);
                     Assert(pCur->offPrev || pCur == pCurAct);
                     while (pCurAct && pCurAct != pCur)
-                        pCurAct = TMTIMER_GET_NEXT(pCurAct);
+                        pCurAct = tmTimerHeapWalkNext(pCurAct);
                     Assert(pCurAct == pCur);
                 }
                 break;
@@ -634,13 +652,15 @@ void tmTimerQueuesSanityChecks(PVM pVM, const char *pszWhere)
                 {
                     Assert(!pCur->offNext);
                     Assert(!pCur->offPrev);
+                    Assert(!pCur->offChild);
                     for (PTMTIMERR3 pCurAct = TMTIMER_GET_HEAD(&pVM->tm.s.CTX_SUFF(paTimerQueues)[pCur->enmClock]);
                           pCurAct;
-                          pCurAct = TMTIMER_GET_NEXT(pCurAct))
+                          pCurAct = tmTimerHeapWalkNext(pCurAct))
                     {
                         Assert(pCurAct != pCur);
                         Assert(TMTIMER_GET_NEXT(pCurAct) != pCur);
                         Assert(TMTIMER_GET_PREV(pCurAct) != pCur);
+                        Assert(TMTIMER_GET_CHILD(pCurAct) != pCur);
                     }
                 }
                 break;
@@ -1139,10 +1159,10 @@ static int tmTimerSetOptimizedStart(PVM pVM, PTMTIMER pTimer, uint64_t u64Expire
     /*
      * Link the timer into the active list.
      */
-    tmTimerQueueLinkActive(&pVM->tm.s.CTX_SUFF(paTimerQueues)[enmClock], pTimer, u64Expire);
+    tmTimerQueueLinkActive(&pVM->tm.s.CTX_SUFF(paTimerQueues)[pTimer->idxQueue], pTimer, u64Expire);
 
     STAM_COUNTER_INC(&pVM->tm.s.StatTimerSetOpt);
-    TM_UNLOCK_TIMERS(pVM);
+    tmTimerUnlockQueue(pVM, pTimer);
     return VINF_SUCCESS;
 }
 
@@ -1267,8 +1287,8 @@ VMMDECL(int) TMTimerSet(PTMTIMER pTimer, uint64_t u64Expire)
         ||  (   enmState1 == TMTIMERSTATE_STOPPED
              && pTimer->pCritSect))
     {
-        /* Try take the TM lock and check the state again. */
-        if (RT_SUCCESS_NP(TM_TRY_LOCK_TIMERS(pVM)))
+        /* Try take the queue lock and check the state again. */
+        if (tmTimerTryLockQueue(pVM, pTimer))
         {
             if (RT_LIKELY(tmTimerTry(pTimer, TMTIMERSTATE_ACTIVE, enmState1)))
             {
@@ -1276,7 +1296,7 @@ VMMDECL(int) TMTimerSet(PTMTIMER pTimer, uint64_t u64Expire)
                 STAM_PROFILE_STOP(&pVM->tm.s.CTX_SUFF_Z(StatTimerSet), a);
                 return VINF_SUCCESS;
             }
-            TM_UNLOCK_TIMERS(pVM);
+            tmTimerUnlockQueue(pVM, pTimer);
         }
     }
 #endif
@@ -1437,10 +1457,10 @@ static int tmTimerSetRelativeOptimizedStart(PVM pVM, PTMTIMER pTimer, uint64_t c
      * Link the timer into the active list.
      */
     DBGFTRACE_U64_TAG2(pVM, u64Expire, "tmTimerSetRelativeOptimizedStart", R3STRING(pTimer->pszDesc));
-    tmTimerQueueLinkActive(&pVM->tm.s.CTX_SUFF(paTimerQueues)[enmClock], pTimer, u64Expire);
+    tmTimerQueueLinkActive(&pVM->tm.s.CTX_SUFF(paTimerQueues)[pTimer->idxQueue], pTimer, u64Expire);
 
     STAM_COUNTER_INC(&pVM->tm.s.StatTimerSetRelativeOpt);
-    TM_UNLOCK_TIMERS(pVM);
+    tmTimerUnlockQueue(pVM, pTimer);
     return VINF_SUCCESS;
 }
 
@@ -1564,19 +1584,20 @@ VMMDECL(int) TMTimerSetRelative(PTMTIMER pTimer, uint64_t cTicksToNext, uint64_t
 #endif
 
     /*
-     * Try to take the TM lock and optimize the common cases.
+     * Try to take the queue lock and optimize the common cases.
      *
-     * With the TM lock we can safely make optimizations like immediate
-     * scheduling and we can also be 100% sure that we're not racing the
-     * running of the timer queues. As an additional restraint we require the
-     * timer to have a critical section associated with to be 100% there aren't
-     * concurrent operations on the timer. (This latter isn't necessary any
-     * longer as this isn't supported for any timers, critsect or not.)
+     * With the queue lock (the TM lock for all but the thread pool timers) we
+     * can safely make optimizations like immediate scheduling and we can
+     * also be 100% sure that we're not racing the running of the timer
+     * queues. As an additional restraint we require the timer to have a
+     * critical section associated with to be 100% there aren't concurrent
+     * operations on the timer. (This latter isn't necessary any longer as
+     * this isn't supported for any timers, critsect or not.)
      *
      * Note! Lock ordering doesn't apply when we only tries to
      *       get the innermost locks.
      */
-    bool fOwnTMLock = RT_SUCCESS_NP(TM_TRY_LOCK_TIMERS(pVM));
+    bool fOwnTMLock = tmTimerTryLockQueue(pVM, pTimer);
 #if 1
     if (    fOwnTMLock
         &&  pTimer->pCritSect)
@@ -1728,7 +1749,7 @@ VMMDECL(int) TMTimerSetRelative(PTMTIMER pTimer, uint64_t cTicksToNext, uint64_t
          * Retry to gain locks.
          */
         if (!fOwnTMLock)
-            fOwnTMLock = RT_SUCCESS_NP(TM_TRY_LOCK_TIMERS(pVM));
+            fOwnTMLock = tmTimerTryLockQueue(pVM, pTimer);
 
     } /* for (;;) */
 
@@ -1736,7 +1757,7 @@ VMMDECL(int) TMTimerSetRelative(PTMTIMER pTimer, uint64_t cTicksToNext, uint64_t
      * Clean up and return.
      */
     if (fOwnTMLock)
-        TM_UNLOCK_TIMERS(pVM);
+        tmTimerUnlockQueue(pVM, pTimer);
 
     STAM_PROFILE_STOP(&pTimer->CTX_SUFF(pVM)->tm.s.CTX_SUFF_Z(StatTimerSetRelative), a);
     return rc;
@@ -2474,13 +2495,14 @@ static uint32_t tmGetFrequencyHint(PVM pVM)
             ASMAtomicWriteBool(&pVM->tm.s.fHzHintNeedsUpdating, false);
 
             /*
-             * Loop over the timers associated with each clock.
+             * Loop over the timers associated with each clock.  The thread
+             * pool queues are skipped as they don't need the EMTs.
              */
             uMaxHzHint = 0;
             for (int i = 0; i < TMCLOCK_MAX; i++)
             {
                 PTMTIMERQUEUE pQueue = &pVM->tm.s.CTX_SUFF(paTimerQueues)[i];
-                for (PTMTIMER pCur = TMTIMER_GET_HEAD(pQueue); pCur; pCur = TMTIMER_GET_NEXT(pCur))
+                for (PTMTIMER pCur = TMTIMER_GET_HEAD(pQueue); pCur; pCur = tmTimerHeapWalkNext(pCur))
                 {
                     uint32_t uHzHint = ASMAtomicUoReadU32(&pCur->uHzHint);
                     if (uHzHint > uMaxHzHint)
@@ -21,6 +21,7 @@
 *********************************************************************************************************************************/
 #define LOG_GROUP LOG_GROUP_FTM
 #include <VBox/vmm/ftm.h>
+#include <VBox/vmm/cfgm.h>
 #include <VBox/vmm/em.h>
 #include <VBox/vmm/pdm.h>
 #include <VBox/vmm/pgm.h>
@@ -117,11 +118,24 @@ VMMR3_INT_DECL(int) FTMR3Init(PVM pVM)
     pVM->ftm.s.standby.hServer          = NIL_RTTCPSERVER;
     pVM->ftm.s.hShutdownEvent           = NIL_RTSEMEVENT;
     pVM->ftm.s.hSocket                  = NIL_RTSOCKET;
+    pVM->ftm.s.pStripe                  = NULL;
+
+    /*
+     * Number of TCP connections the state sync is striped over.
+     */
+    /** @cfgm{/FTM/Streams, uint32_t, 1, 1, 16, 1}
+     * The number of TCP connections the master stripes the VM state over.
+     * The default of 1 sends everything over the control connection. */
+    int rc = CFGMR3QueryU32Def(CFGMR3GetChild(CFGMR3GetRoot(pVM), "FTM"), "Streams", &pVM->ftm.s.cStreams, 1);
+    AssertLogRelRCReturn(rc, rc);
+    if (pVM->ftm.s.cStreams < 1 || pVM->ftm.s.cStreams > SSM_TCP_STRIPE_MAX_CONNS)
+        return VMSetError(pVM, VERR_OUT_OF_RANGE, RT_SRC_POS, "/FTM/Streams=%u is out of range (1..%u)",
+                          pVM->ftm.s.cStreams, SSM_TCP_STRIPE_MAX_CONNS);
 
     /*
      * Initialize the PGM critical section.
      */
-    int rc = PDMR3CritSectInit(pVM, &pVM->ftm.s.CritSect, RT_SRC_POS, "FTM");
+    rc = PDMR3CritSectInit(pVM, &pVM->ftm.s.CritSect, RT_SRC_POS, "FTM");
     AssertRCReturn(rc, rc);
 
     /*
@@ -164,6 +178,11 @@ VMMR3_INT_DECL(int) FTMR3Term(PVM pVM)
         RTSemEventDestroy(pVM->ftm.s.hShutdownEvent);
         pVM->ftm.s.hShutdownEvent = NIL_RTSEMEVENT;
     }
+    if (pVM->ftm.s.pStripe)
+    {
+        SSMR3TcpStripeDestroy(pVM->ftm.s.pStripe);
+        pVM->ftm.s.pStripe = NULL;
+    }
     if (pVM->ftm.s.hSocket != NIL_RTSOCKET)
     {
         RTTcpClientClose(pVM->ftm.s.hSocket);
@@ -613,6 +632,27 @@ static SSMSTRMOPS const g_ftmR3TcpOps =
 };
 
 
+/**
+ * Gets the stream methods to use for the next VM state sync.
+ *
+ * @returns The stream method table.
+ * @param   pVM         The cross context VM structure.
+ * @param   ppvUser     Where to return the user argument for the methods.
+ */
+static PCSSMSTRMOPS ftmR3GetStreamOps(PVM pVM, void **ppvUser)
+{
+    if (pVM->ftm.s.pStripe)
+    {
+        int rc = SSMR3TcpStripeReset(pVM->ftm.s.pStripe);
+        AssertRC(rc);
+        *ppvUser = pVM->ftm.s.pStripe;
+        return SSMR3TcpStripeGetOps();
+    }
+    *ppvUser = pVM;
+    return &g_ftmR3TcpOps;
+}
+
+
 /**
  * VMR3ReqCallWait callback
  *
@@ -654,7 +694,9 @@ static int ftmR3PerformFullSync(PVM pVM)
     AssertRC(rc);
 
     pVM->ftm.s.fDeltaLoadSaveActive = false;
-    rc = VMR3SaveFT(pVM->pUVM, &g_ftmR3TcpOps, pVM, &fSuspended, false /* fSkipStateChanges */);
+    void        *pvStreamOpsUser;
+    PCSSMSTRMOPS pStreamOps = ftmR3GetStreamOps(pVM, &pvStreamOpsUser);
+    rc = VMR3SaveFT(pVM->pUVM, pStreamOps, pvStreamOpsUser, &fSuspended, false /* fSkipStateChanges */);
     AssertRC(rc);
 
     rc = ftmR3TcpReadACK(pVM, "full-sync-complete");
@@ -775,7 +817,22 @@ static DECLCALLBACK(int) ftmR3MasterThread(RTTHREAD hThread, void *pvUser)
                     if (RT_SUCCESS(rc))
                     {
                         /** @todo verify VM config. */
-                        break;
+
+                        /* Stripe the state syncs over additional connections if configured. */
+                        if (pVM->ftm.s.cStreams <= 1)
+                            break;
+                        char szCmd[32];
+                        RTStrPrintf(szCmd, sizeof(szCmd), "streams=%u", pVM->ftm.s.cStreams);
+                        rc = ftmR3TcpSubmitCommand(pVM, szCmd);
+                        if (RT_SUCCESS(rc))
+                            rc = SSMR3TcpStripeConnect(pVM->ftm.s.hSocket, pVM->ftm.s.pszAddress, pVM->ftm.s.cStreams,
+                                                       true /*fWrite*/, &pVM->ftm.s.pStripe);
+                        if (RT_SUCCESS(rc))
+                        {
+                            LogRel(("FTSync: Striping the state over %u connections.\n", pVM->ftm.s.cStreams));
+                            break;
+                        }
+                        LogRel(("FTSync: Failed to set up %u data connections: %Rrc\n", pVM->ftm.s.cStreams, rc));
                     }
                 }
             }
@@ -1050,7 +1107,31 @@ static DECLCALLBACK(int) ftmR3StandbyServeConnection(RTSOCKET hSocket, void *pvU
             break;
 
         pVM->ftm.s.standby.u64LastHeartbeat = RTTimeMilliTS();
-        if (!strcmp(szCmd, "mem-sync"))
+        if (!strncmp(szCmd, RT_STR_TUPLE("streams=")))
+        {
+            uint32_t cStreams;
+            rc = RTStrToUInt32Full(&szCmd[sizeof("streams=") - 1], 10, &cStreams);
+            if (   rc != VINF_SUCCESS
+                || cStreams < 1
+                || cStreams > SSM_TCP_STRIPE_MAX_CONNS
+                || pVM->ftm.s.pStripe)
+            {
+                LogRel(("FTSync: Bad stream count '%s' (%Rrc)\n", szCmd, rc));
+                ftmR3TcpWriteNACK(pVM, VERR_INVALID_PARAMETER);
+                continue;
+            }
+            rc = ftmR3TcpWriteACK(pVM);
+            AssertRC(rc);
+            if (RT_FAILURE(rc))
+                continue;
+
+            rc = SSMR3TcpStripeListen(pVM->ftm.s.hSocket, pVM->ftm.s.pszAddress, cStreams, false /*fWrite*/,
+                                      &pVM->ftm.s.pStripe);
+            if (RT_FAILURE(rc))
+                break;
+            LogRel(("FTSync: Receiving the state over %u connections.\n", cStreams));
+        }
+        else if (!strcmp(szCmd, "mem-sync"))
         {
             rc = ftmR3TcpWriteACK(pVM);
             AssertRC(rc);
@@ -1090,7 +1171,9 @@ static DECLCALLBACK(int) ftmR3StandbyServeConnection(RTSOCKET hSocket, void *pvU
             pVM->ftm.s.syncstate.fEndOfStream = false;
 
             pVM->ftm.s.fDeltaLoadSaveActive = (fFullSync == false);
-            rc = VMR3LoadFromStreamFT(pVM->pUVM, &g_ftmR3TcpOps, pVM);
+            void        *pvStreamOpsUser;
+            PCSSMSTRMOPS pStreamOps = ftmR3GetStreamOps(pVM, &pvStreamOpsUser);
+            rc = VMR3LoadFromStreamFT(pVM->pUVM, pStreamOps, pvStreamOpsUser);
             pVM->ftm.s.fDeltaLoadSaveActive = false;
             RTSocketRelease(pVM->ftm.s.hSocket);
             AssertRC(rc);
@@ -1098,13 +1181,15 @@ static DECLCALLBACK(int) ftmR3StandbyServeConnection(RTSOCKET hSocket, void *pvU
             {
                 LogRel(("FTSync: VMR3LoadFromStream -> %Rrc\n", rc));
                 ftmR3TcpWriteNACK(pVM, rc);
+                if (pVM->ftm.s.pStripe)
+                    break; /* The data connections are out of sync now. */
                 continue;
             }
 
             /* The EOS might not have been read, make sure it is. */
             pVM->ftm.s.syncstate.fStopReading = false;
             size_t cbRead;
-            rc = ftmR3TcpOpRead(pVM, pVM->ftm.s.syncstate.uOffStream, szCmd, 1, &cbRead);
+            rc = pStreamOps->pfnRead(pvStreamOpsUser, pVM->ftm.s.syncstate.uOffStream, szCmd, 1, &cbRead);
             if (rc != VERR_EOF)
             {
                 LogRel(("FTSync: Draining teleporterTcpOpRead -> %Rrc\n", rc));
@@ -1273,7 +1358,9 @@ static DECLCALLBACK(VBOXSTRICTRC) ftmR3SetCheckpointRendezvous(PVM pVM, PVMCPU p
     AssertRC(rc);
 
     pVM->ftm.s.fDeltaLoadSaveActive = true;
-    rc = VMR3SaveFT(pVM->pUVM, &g_ftmR3TcpOps, pVM, &fSuspended, true /* fSkipStateChanges */);
+    void        *pvStreamOpsUser;
+    PCSSMSTRMOPS pStreamOps = ftmR3GetStreamOps(pVM, &pvStreamOpsUser);
+    rc = VMR3SaveFT(pVM->pUVM, pStreamOps, pvStreamOpsUser, &fSuspended, true /* fSkipStateChanges */);
     pVM->ftm.s.fDeltaLoadSaveActive = false;
     AssertRC(rc);
 
@@ -21,6 +21,7 @@
 *********************************************************************************************************************************/
 #define LOG_GROUP LOG_GROUP_EM
 #include <VBox/vmm/iem.h>
+#include <VBox/vmm/cfgm.h>
 #include <VBox/vmm/cpum.h>
 #include <VBox/vmm/mm.h>
 #include "IEMInternal.h"
@@ -63,6 +64,20 @@ VMMR3DECL(int)      IEMR3Init(PVM pVM)
     uint64_t const uInitialTlbRevision = UINT64_C(0) - (IEMTLB_REVISION_INCR * 200U);
     uint64_t const uInitialTlbPhysRev  = UINT64_C(0) - (IEMTLB_PHYS_REV_INCR * 100U);
 
+    /*
+     * Read configuration.
+     */
+    PCFGMNODE pIem = CFGMR3GetChild(CFGMR3GetRoot(pVM), "IEM");
+
+    /** @cfgm{/IEM/OpcodeCache, bool, true}
+     * Whether IEMExecLots should remember the translations and mappings of the
+     * guest code pages it executes instead of walking the page tables and
+     * reading guest memory via PGM for every instruction. */
+    bool fOpcodeCache;
+    int rc = CFGMR3QueryBoolDef(pIem, "OpcodeCache", &fOpcodeCache, true);
+    AssertLogRelRCReturn(rc, rc);
+    LogRel(("IEM: OpcodeCache=%RTbool\n", fOpcodeCache));
+
     for (VMCPUID idCpu = 0; idCpu < pVM->cCpus; idCpu++)
     {
         PVMCPU pVCpu = &pVM->aCpus[idCpu];
@@ -114,11 +129,29 @@ VMMR3DECL(int)      IEMR3Init(PVM pVM)
         STAMR3RegisterF(pVM, (void *)&pVCpu->iem.s.DataTlb.uTlbPhysRev, STAMTYPE_X64,       STAMVISIBILITY_ALWAYS, STAMUNIT_NONE,
                         "Data TLB physical revision",               "/IEM/CPU%u/DataTlb-PhysRev", idCpu);
 
+        /*
+         * The opcode block cache.
+         */
+        pVCpu->iem.s.OpCache.fEnabled  = fOpcodeCache;
+        pVCpu->iem.s.OpCache.uRevision = 1;
+        STAMR3RegisterF(pVM, &pVCpu->iem.s.OpCache.cHits,               STAMTYPE_U64_RESET, STAMVISIBILITY_USED,   STAMUNIT_COUNT,
+                        "Opcode fetches satisfied by the opcode cache", "/IEM/CPU%u/OpCache-Hits", idCpu);
+        STAMR3RegisterF(pVM, &pVCpu->iem.s.OpCache.cMisses,             STAMTYPE_U32_RESET, STAMVISIBILITY_USED,   STAMUNIT_COUNT,
+                        "Opcode cache block fills",                     "/IEM/CPU%u/OpCache-Misses", idCpu);
+        STAMR3RegisterF(pVM, &pVCpu->iem.s.OpCache.cUncacheable,        STAMTYPE_U32_RESET, STAMVISIBILITY_USED,   STAMUNIT_COUNT,
+                        "Code pages which could not be cached",         "/IEM/CPU%u/OpCache-Uncacheable", idCpu);
+        STAMR3RegisterF(pVM, &pVCpu->iem.s.OpCache.cFlushes,            STAMTYPE_U32_RESET, STAMVISIBILITY_USED,   STAMUNIT_COUNT,
+                        "Opcode cache flushes (TLB, CRx)",              "/IEM/CPU%u/OpCache-Flushes", idCpu);
+        STAMR3RegisterF(pVM, &pVCpu->iem.s.OpCache.cStale,              STAMTYPE_U32_RESET, STAMVISIBILITY_USED,   STAMUNIT_COUNT,
+                        "Blocks reloaded because PGM changed the page", "/IEM/CPU%u/OpCache-Stale", idCpu);
+        STAMR3RegisterF(pVM, &pVCpu->iem.s.OpCache.cReverified,         STAMTYPE_U32_RESET, STAMVISIBILITY_USED,   STAMUNIT_COUNT,
+                        "Blocks kept across IEMExecLots calls",         "/IEM/CPU%u/OpCache-Reverified", idCpu);
+
 #if defined(VBOX_WITH_STATISTICS) && !defined(DOXYGEN_RUNNING)
         /* Allocate instruction statistics and register them. */
         pVCpu->iem.s.pStatsR3 = (PIEMINSTRSTATS)MMR3HeapAllocZ(pVM, MM_TAG_IEM, sizeof(IEMINSTRSTATS));
         AssertLogRelReturn(pVCpu->iem.s.pStatsR3, VERR_NO_MEMORY);
-        int rc = MMHyperAlloc(pVM, sizeof(IEMINSTRSTATS), sizeof(uint64_t), MM_TAG_IEM, (void **)&pVCpu->iem.s.pStatsCCR3);
+        rc = MMHyperAlloc(pVM, sizeof(IEMINSTRSTATS), sizeof(uint64_t), MM_TAG_IEM, (void **)&pVCpu->iem.s.pStatsCCR3);
         AssertLogRelRCReturn(rc, rc);
         pVCpu->iem.s.pStatsR0 = MMHyperR3ToR0(pVM, pVCpu->iem.s.pStatsCCR3);
         pVCpu->iem.s.pStatsRC = MMHyperR3ToR0(pVM, pVCpu->iem.s.pStatsCCR3);
@@ -59,8 +59,14 @@ typedef struct PDMNETSHAPER
     RTCRITSECT               Lock;
     /** Pending TX thread. */
     PPDMTHREAD               pTxThread;
+    /** The event the TX thread waits on, signalled when a filter gets choked. */
+    SUPSEMEVENT              hEvtWakeup;
     /** Pointer to the first bandwidth group. */
     PPDMNSBWGROUP            pBwGroupsHead;
+    /** Number of bandwidth groups. */
+    uint32_t                 cBwGroups;
+    /** Round counter of the TX thread, for rotating the group it serves first. */
+    uint32_t                 iRound;
 } PDMNETSHAPER;
 
 
@@ -105,6 +111,7 @@ static void pdmNsBwGroupLink(PPDMNSBWGROUP pBwGroup)
 
     pBwGroup->pNextR3 = pShaper->pBwGroupsHead;
     pShaper->pBwGroupsHead = pBwGroup;
+    pShaper->cBwGroups++;
 
     UNLOCK_NETSHAPER(pShaper);
 }
@@ -137,15 +144,20 @@ static void pdmNsBwGroupUnlink(PPDMNSBWGROUP pBwGroup)
 static void pdmNsBwGroupSetLimit(PPDMNSBWGROUP pBwGroup, uint64_t cbPerSecMax)
 {
     pBwGroup->cbPerSecMax = cbPerSecMax;
-    pBwGroup->cbBucket    = RT_MAX(PDM_NETSHAPER_MIN_BUCKET_SIZE, cbPerSecMax * PDM_NETSHAPER_MAX_LATENCY / 1000);
+    if (pBwGroup->cbBurst)
+        pBwGroup->cbBucket = RT_MAX(PDM_NETSHAPER_MIN_BUCKET_SIZE, pBwGroup->cbBurst);
+    else
+        pBwGroup->cbBucket = (uint32_t)RT_MIN(RT_MAX(PDM_NETSHAPER_MIN_BUCKET_SIZE,
+                                                     cbPerSecMax * PDM_NETSHAPER_MAX_LATENCY / 1000), UINT32_MAX / 2);
     LogFlow(("pdmNsBwGroupSetLimit: New rate limit is %llu bytes per second, adjusted bucket size to %u bytes\n",
              pBwGroup->cbPerSecMax, pBwGroup->cbBucket));
 }
 
 
-static int pdmNsBwGroupCreate(PPDMNETSHAPER pShaper, const char *pszBwGroup, uint64_t cbPerSecMax)
+static int pdmNsBwGroupCreate(PPDMNETSHAPER pShaper, const char *pszBwGroup, uint64_t cbPerSecMax, uint32_t cbBurst)
 {
-    LogFlow(("pdmNsBwGroupCreate: pShaper=%#p pszBwGroup=%#p{%s} cbPerSecMax=%llu\n", pShaper, pszBwGroup, pszBwGroup, cbPerSecMax));
+    LogFlow(("pdmNsBwGroupCreate: pShaper=%#p pszBwGroup=%#p{%s} cbPerSecMax=%llu cbBurst=%u\n",
+             pShaper, pszBwGroup, pszBwGroup, cbPerSecMax, cbBurst));
 
     AssertPtrReturn(pShaper, VERR_INVALID_POINTER);
     AssertPtrReturn(pszBwGroup, VERR_INVALID_POINTER);
@@ -166,7 +178,10 @@ static int pdmNsBwGroupCreate(PPDMNETSHAPER pShaper, const char *pszBwGroup, uin
                 if (pBwGroup->pszNameR3)
                 {
                     pBwGroup->pShaperR3             = pShaper;
+                    pBwGroup->pSession              = pShaper->pVM->pSession;
+                    pBwGroup->hEvtWakeup            = pShaper->hEvtWakeup;
                     pBwGroup->cRefs                 = 0;
+                    pBwGroup->cbBurst               = cbBurst;
 
                     pdmNsBwGroupSetLimit(pBwGroup, cbPerSecMax);
 
@@ -193,6 +208,58 @@ static int pdmNsBwGroupCreate(PPDMNETSHAPER pShaper, const char *pszBwGroup, uin
 }
 
 
+/**
+ * Makes one bandwidth group the child of another.
+ *
+ * @returns VBox status code.
+ * @param   pShaper         The network shaper.
+ * @param   pszBwGroup      The name of the child group.
+ * @param   pszParent       The name of the parent group.
+ */
+static int pdmNsBwGroupSetParent(PPDMNETSHAPER pShaper, const char *pszBwGroup, const char *pszParent)
+{
+    PPDMNSBWGROUP pBwGroup = pdmNsBwGroupFindById(pShaper, pszBwGroup);
+    PPDMNSBWGROUP pParent  = pdmNsBwGroupFindById(pShaper, pszParent);
+    AssertReturn(pBwGroup, VERR_INTERNAL_ERROR_3);
+    if (!pParent)
+    {
+        LogRel(("NetShaper: Parent group '%s' of '%s' does not exist\n", pszParent, pszBwGroup));
+        return VERR_NOT_FOUND;
+    }
+    pBwGroup->pParentR3 = pParent;
+    pBwGroup->pParentR0 = MMHyperR3ToR0(pShaper->pVM, pParent);
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Checks that the group hierarchy has no loops and isn't too deep.
+ *
+ * @returns VBox status code.
+ * @param   pShaper         The network shaper.
+ */
+static int pdmNsBwGroupCheckHierarchy(PPDMNETSHAPER pShaper)
+{
+    for (PPDMNSBWGROUP pBwGroup = pShaper->pBwGroupsHead; pBwGroup; pBwGroup = pBwGroup->pNextR3)
+    {
+        unsigned      cLevels = 0;
+        PPDMNSBWGROUP pCur    = pBwGroup;
+        while (pCur && cLevels < PDM_NETSHAPER_MAX_DEPTH)
+        {
+            pCur = pCur->pParentR3;
+            cLevels++;
+        }
+        if (pCur)
+        {
+            LogRel(("NetShaper: The parents of group '%s' form a loop or are nested deeper than %u levels\n",
+                    pBwGroup->pszNameR3, PDM_NETSHAPER_MAX_DEPTH));
+            return VERR_INVALID_PARAMETER;
+        }
+    }
+    return VINF_SUCCESS;
+}
+
+
 static void pdmNsBwGroupTerminate(PPDMNSBWGROUP pBwGroup)
 {
     Assert(pBwGroup->cRefs == 0);
@@ -214,7 +281,22 @@ DECLINLINE(void) pdmNsBwGroupUnref(PPDMNSBWGROUP pBwGroup)
 }
 
 
-static void pdmNsBwGroupXmitPending(PPDMNSBWGROUP pBwGroup)
+/**
+ * Serves the choked filters of a bandwidth group if the buckets of the group
+ * and its ancestors have filled up enough.
+ *
+ * The tokens available are divided among the choked filters in proportion to
+ * their weights and handed to them as credit, which they spend before taking
+ * anything from the buckets.  A filter that wants more than its share keeps
+ * the credit and gets another share in the next round (deficit round robin),
+ * so the pipe stays full while every filter gets its weighted share.
+ *
+ * @returns Nanoseconds until the group can be served, 0 if there is nothing
+ *          waiting in it (anymore).
+ * @param   pBwGroup        The bandwidth group.
+ * @param   tsNow           The current RTTimeSystemNanoTS().
+ */
+static uint64_t pdmNsBwGroupServe(PPDMNSBWGROUP pBwGroup, uint64_t tsNow)
 {
     /*
      * We don't need to hold the bandwidth group lock to iterate over the list
@@ -224,27 +306,91 @@ static void pdmNsBwGroupXmitPending(PPDMNSBWGROUP pBwGroup)
     AssertPtr(pBwGroup);
     AssertPtr(pBwGroup->pShaperR3);
     Assert(RTCritSectIsOwner(&pBwGroup->pShaperR3->Lock));
-    //LOCK_NETSHAPER(pShaper);
 
-    /* Check if the group is disabled. */
-    if (pBwGroup->cbPerSecMax == 0)
-        return;
+    if (!ASMAtomicReadBool(&pBwGroup->fWaiters))
+        return 0;
+
+    /*
+     * Lock the chain, child before parent like PDMNsAllocateBandwidth, and
+     * see whether the largest pending transfer fits everywhere.
+     */
+    PPDMNSBWGROUP apChain[PDM_NETSHAPER_MAX_DEPTH];
+    uint32_t      acbTokens[PDM_NETSHAPER_MAX_DEPTH];
+    unsigned      cLevels   = 0;
+    uint32_t      cbAvail   = UINT32_MAX;
+    uint32_t      cbNeeded  = UINT32_MAX;
+    for (PPDMNSBWGROUP pCur = pBwGroup; pCur && cLevels < RT_ELEMENTS(apChain); pCur = pCur->pParentR3)
+    {
+        int rc = PDMCritSectEnter(&pCur->Lock, VERR_IGNORED); AssertRC(rc);
+        apChain[cLevels]   = pCur;
+        acbTokens[cLevels] = pdmNsBwGroupPeekTokens(pCur, tsNow);
+        cbAvail = RT_MIN(cbAvail, acbTokens[cLevels]);
+        if (pCur->cbPerSecMax)
+            cbNeeded = RT_MIN(cbNeeded, pCur->cbBucket);
+        cLevels++;
+    }
+    cbNeeded = RT_MIN(cbNeeded, RT_MAX(pBwGroup->cbPendingMax, 1));
 
-    PPDMNSFILTER pFilter = pBwGroup->pFiltersHeadR3;
-    while (pFilter)
+    uint64_t cNsWait = 0;
+    if (cbAvail < cbNeeded)
+    {
+        /* Work out when the slowest bucket will have filled up enough. */
+        for (unsigned i = 0; i < cLevels; i++)
+            if (acbTokens[i] < cbNeeded)
+            {
+                uint64_t cNs = (uint64_t)(cbNeeded - acbTokens[i]) * RT_NS_1SEC / apChain[i]->cbPerSecMax;
+                cNsWait = RT_MAX(cNsWait, RT_MAX(cNs, 1));
+            }
+    }
+    else
+    {
+        ASMAtomicWriteBool(&pBwGroup->fWaiters, false);
+        pBwGroup->cbPendingMax = 0;
+
+        if (cbAvail != UINT32_MAX)
+        {
+            uint64_t cWeights = 0;
+            for (PPDMNSFILTER pFilter = pBwGroup->pFiltersHeadR3; pFilter; pFilter = pFilter->pNextR3)
+                if (ASMAtomicReadBool(&pFilter->fChoked))
+                    cWeights += pFilter->uWeight;
+
+            uint32_t const cbCreditMax = RT_MAX(cbNeeded, PDM_NETSHAPER_MIN_BUCKET_SIZE);
+            uint32_t       cbGranted   = 0;
+            for (PPDMNSFILTER pFilter = pBwGroup->pFiltersHeadR3; pFilter && cWeights; pFilter = pFilter->pNextR3)
+                if (ASMAtomicReadBool(&pFilter->fChoked))
+                {
+                    uint32_t cbShare = (uint32_t)((uint64_t)cbAvail * pFilter->uWeight / cWeights);
+                    cbShare = RT_MIN(cbShare, cbCreditMax - RT_MIN(pFilter->cbCredit, cbCreditMax));
+                    pFilter->cbCredit += cbShare;
+                    cbGranted         += cbShare;
+                }
+            Assert(cbGranted <= cbAvail);
+            for (unsigned i = 0; i < cLevels; i++)
+                pdmNsBwGroupConsume(apChain[i], tsNow, acbTokens[i], cbGranted);
+        }
+    }
+
+    while (cLevels-- > 0)
+    {
+        int rc = PDMCritSectLeave(&apChain[cLevels]->Lock); AssertRC(rc);
+    }
+    if (cNsWait)
+        return cNsWait;
+
+    /*
+     * Wake up the filters.
+     */
+    for (PPDMNSFILTER pFilter = pBwGroup->pFiltersHeadR3; pFilter; pFilter = pFilter->pNextR3)
     {
         bool fChoked = ASMAtomicXchgBool(&pFilter->fChoked, false);
-        Log3((LOG_FN_FMT ": pFilter=%#p fChoked=%RTbool\n", __PRETTY_FUNCTION__, pFilter, fChoked));
+        Log3((LOG_FN_FMT ": pFilter=%#p fChoked=%RTbool cbCredit=%u\n", __PRETTY_FUNCTION__, pFilter, fChoked, pFilter->cbCredit));
         if (fChoked && pFilter->pIDrvNetR3)
         {
             LogFlowFunc(("Calling pfnXmitPending for pFilter=%#p\n", pFilter));
             pFilter->pIDrvNetR3->pfnXmitPending(pFilter->pIDrvNetR3);
         }
-
-        pFilter = pFilter->pNextR3;
     }
-
-    //UNLOCK_NETSHAPER(pShaper);
+    return 0;
 }
 
 
@@ -322,6 +468,10 @@ VMMR3_INT_DECL(int) PDMR3NsAttach(PUVM pUVM, PPDMDRVINS pDrvIns, const char *psz
 
     if (RT_SUCCESS(rc))
     {
+        if (!pFilter->uWeight)
+            pFilter->uWeight = PDM_NETSHAPER_DEFAULT_WEIGHT;
+        pFilter->cbCredit = 0;
+
         PPDMNSBWGROUP pBwGroupOld = ASMAtomicXchgPtrT(&pFilter->pBwGroupR3, pBwGroupNew, PPDMNSBWGROUP);
         ASMAtomicWritePtr(&pFilter->pBwGroupR0, MMHyperR3ToR0(pUVM->pVM, pBwGroupNew));
         if (pBwGroupOld)
@@ -395,6 +545,9 @@ VMMR3DECL(int) PDMR3NsBwGroupSetLimit(PUVM pUVM, const char *pszBwGroup, uint64_
                 pBwGroup->cbTokensLast = pBwGroup->cbBucket;
 
             int rc2 = PDMCritSectLeave(&pBwGroup->Lock); AssertRC(rc2);
+
+            /* Have the TX thread reconsider the filters waiting on the old rate. */
+            rc2 = SUPSemEventSignal(pShaper->pVM->pSession, pShaper->hEvtWakeup); AssertRC(rc2);
         }
     }
     else
@@ -408,29 +561,46 @@ VMMR3DECL(int) PDMR3NsBwGroupSetLimit(PUVM pUVM, const char *pszBwGroup, uint64_
 /**
  * I/O thread for pending TX.
  *
+ * Sleeps until a filter gets choked, then until the buckets have filled up
+ * enough for the choked filters and serves them.
+ *
  * @returns VINF_SUCCESS (ignored).
  * @param   pVM         The cross context VM structure.
  * @param   pThread     The PDM thread data.
  */
 static DECLCALLBACK(int) pdmR3NsTxThread(PVM pVM, PPDMTHREAD pThread)
 {
-    RT_NOREF_PV(pVM);
-
     PPDMNETSHAPER pShaper = (PPDMNETSHAPER)pThread->pvUser;
     LogFlow(("pdmR3NsTxThread: pShaper=%p\n", pShaper));
     while (pThread->enmState == PDMTHREADSTATE_RUNNING)
     {
-        RTThreadSleep(PDM_NETSHAPER_MAX_LATENCY);
-
-        /* Go over all bandwidth groups/filters calling pfnXmitPending */
+        /* Go over all bandwidth groups, starting with a different one each
+           round so that siblings get the same chance at their parent. */
+        uint64_t cNsWait = UINT64_MAX;
         LOCK_NETSHAPER(pShaper);
-        PPDMNSBWGROUP pBwGroup = pShaper->pBwGroupsHead;
-        while (pBwGroup)
+        if (pShaper->cBwGroups)
         {
-            pdmNsBwGroupXmitPending(pBwGroup);
-            pBwGroup = pBwGroup->pNextR3;
+            uint64_t const tsNow    = RTTimeSystemNanoTS();
+            PPDMNSBWGROUP  pStart   = pShaper->pBwGroupsHead;
+            for (uint32_t i = pShaper->iRound++ % pShaper->cBwGroups; i > 0; i--)
+                pStart = pStart->pNextR3;
+            PPDMNSBWGROUP  pBwGroup = pStart;
+            do
+            {
+                uint64_t cNs = pdmNsBwGroupServe(pBwGroup, tsNow);
+                if (cNs)
+                    cNsWait = RT_MIN(cNsWait, cNs);
+                pBwGroup = pBwGroup->pNextR3 ? pBwGroup->pNextR3 : pShaper->pBwGroupsHead;
+            } while (pBwGroup != pStart);
         }
         UNLOCK_NETSHAPER(pShaper);
+
+        int rc;
+        if (cNsWait == UINT64_MAX)
+            rc = SUPSemEventWaitNoResume(pVM->pSession, pShaper->hEvtWakeup, RT_INDEFINITE_WAIT);
+        else
+            rc = SUPSemEventWaitNsRelIntr(pVM->pSession, pShaper->hEvtWakeup, cNsWait);
+        AssertLogRelMsgReturn(RT_SUCCESS(rc) || rc == VERR_TIMEOUT || rc == VERR_INTERRUPTED, ("%Rrc\n", rc), rc);
     }
     return VINF_SUCCESS;
 }
@@ -441,10 +611,9 @@ static DECLCALLBACK(int) pdmR3NsTxThread(PVM pVM, PPDMTHREAD pThread)
  */
 static DECLCALLBACK(int) pdmR3NsTxWakeUp(PVM pVM, PPDMTHREAD pThread)
 {
-    RT_NOREF2(pVM, pThread);
-    LogFlow(("pdmR3NsTxWakeUp: pShaper=%p\n", pThread->pvUser));
-    /* Nothing to do */
-    return VINF_SUCCESS;
+    PPDMNETSHAPER pShaper = (PPDMNETSHAPER)pThread->pvUser;
+    LogFlow(("pdmR3NsTxWakeUp: pShaper=%p\n", pShaper));
+    return SUPSemEventSignal(pVM->pSession, pShaper->hEvtWakeup);
 }
 
 
@@ -474,6 +643,8 @@ int pdmR3NetShaperTerm(PVM pVM)
         MMHyperFree(pVM, pFree);
     }
 
+    SUPSemEventClose(pVM->pSession, pShaper->hEvtWakeup);
+    pShaper->hEvtWakeup = NIL_SUPSEMEVENT;
     RTCritSectDelete(&pShaper->Lock);
     MMR3HeapFree(pShaper);
     pUVM->pdm.s.pNetShaper = NULL;
@@ -502,9 +673,14 @@ int pdmR3NetShaperInit(PVM pVM)
 
         pShaper->pVM = pVM;
         rc = RTCritSectInit(&pShaper->Lock);
+        if (RT_SUCCESS(rc))
+            rc = SUPSemEventCreate(pVM->pSession, &pShaper->hEvtWakeup);
         if (RT_SUCCESS(rc))
         {
-            /* Create all bandwidth groups. */
+            /*
+             * Create all bandwidth groups, then link them up with their
+             * parents as these may come later in the config.
+             */
             PCFGMNODE pCfgBwGrp = CFGMR3GetChild(pCfgNetShaper, "BwGroups");
             if (pCfgBwGrp)
             {
@@ -519,8 +695,11 @@ int pdmR3NetShaperInit(PVM pVM)
                         {
                             uint64_t cbMax;
                             rc = CFGMR3QueryU64(pCur, "Max", &cbMax);
+                            uint32_t cbBurst = 0;
                             if (RT_SUCCESS(rc))
-                                rc = pdmNsBwGroupCreate(pShaper, pszBwGrpId, cbMax);
+                                rc = CFGMR3QueryU32Def(pCur, "Burst", &cbBurst, 0);
+                            if (RT_SUCCESS(rc))
+                                rc = pdmNsBwGroupCreate(pShaper, pszBwGrpId, cbMax, cbBurst);
                         }
                         RTMemFree(pszBwGrpId);
                     }
@@ -529,6 +708,31 @@ int pdmR3NetShaperInit(PVM pVM)
                     if (RT_FAILURE(rc))
                         break;
                 }
+
+                for (PCFGMNODE pCur = CFGMR3GetFirstChild(pCfgBwGrp); pCur && RT_SUCCESS(rc); pCur = CFGMR3GetNextChild(pCur))
+                {
+                    char *pszParent;
+                    rc = CFGMR3QueryStringAlloc(pCur, "Parent", &pszParent);
+                    if (RT_SUCCESS(rc))
+                    {
+                        size_t cbName = CFGMR3GetNameLen(pCur) + 1;
+                        char *pszBwGrpId = (char *)RTMemAllocZ(cbName);
+                        if (pszBwGrpId)
+                        {
+                            rc = CFGMR3GetName(pCur, pszBwGrpId, cbName);
+                            if (RT_SUCCESS(rc))
+                                rc = pdmNsBwGroupSetParent(pShaper, pszBwGrpId, pszParent);
+                            RTMemFree(pszBwGrpId);
+                        }
+                        else
+                            rc = VERR_NO_MEMORY;
+                        MMR3HeapFree(pszParent);
+                    }
+                    else if (rc == VERR_CFGM_VALUE_NOT_FOUND)
+                        rc = VINF_SUCCESS;
+                }
+                if (RT_SUCCESS(rc))
+                    rc = pdmNsBwGroupCheckHierarchy(pShaper);
             }
 
             if (RT_SUCCESS(rc))
@@ -542,8 +746,10 @@ int pdmR3NetShaperInit(PVM pVM)
                 }
             }
 
-            RTCritSectDelete(&pShaper->Lock);
+            SUPSemEventClose(pVM->pSession, pShaper->hEvtWakeup);
         }
+        if (RTCritSectIsInitialized(&pShaper->Lock))
+            RTCritSectDelete(&pShaper->Lock);
 
         MMR3HeapFree(pShaper);
     }
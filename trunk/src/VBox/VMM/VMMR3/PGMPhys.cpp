@@ -780,6 +780,7 @@ void pgmR3PhysRelinkRamRanges(PVM pVM)
         Assert(pVM->pgm.s.pRamRangesXRC == NIL_RTRCPTR);
     }
     ASMAtomicIncU32(&pVM->pgm.s.idRamRangesGen);
+    pgmPhysBumpMapGen(pVM);
 
     pgmR3PhysRebuildRamRangeSearchTrees(pVM);
 }
@@ -818,6 +819,7 @@ static void pgmR3PhysLinkRamRange(PVM pVM, PPGMRAMRANGE pNew, PPGMRAMRANGE pPrev
         pVM->pgm.s.pRamRangesXRC = pNew->pSelfRC;
     }
     ASMAtomicIncU32(&pVM->pgm.s.idRamRangesGen);
+    pgmPhysBumpMapGen(pVM);
 
     pgmR3PhysRebuildRamRangeSearchTrees(pVM);
     pgmUnlock(pVM);
@@ -854,6 +856,7 @@ static void pgmR3PhysUnlinkRamRange2(PVM pVM, PPGMRAMRANGE pRam, PPGMRAMRANGE pP
         pVM->pgm.s.pRamRangesXRC = pNext ? pNext->pSelfRC : NIL_RTRCPTR;
     }
     ASMAtomicIncU32(&pVM->pgm.s.idRamRangesGen);
+    pgmPhysBumpMapGen(pVM);
 
     pgmR3PhysRebuildRamRangeSearchTrees(pVM);
     pgmUnlock(pVM);
@@ -4716,6 +4719,9 @@ static DECLCALLBACK(VBOXSTRICTRC) pgmR3PhysUnmapChunkRendezvous(PVM pVM, PVMCPU
                 pVM->pgm.s.ChunkR3Map.c--;
                 pVM->pgm.s.cUnmappedChunks++;
 
+                /* IEM's opcode cache may still point into the chunk. */
+                pgmPhysBumpMapGen(pVM);
+
                 /*
                  * Flush dangling PGM pointers (R3 & R0 ptrs to GC physical addresses).
                  */
@@ -0,0 +1,1165 @@
+/* $Id$ */
+/** @file
+ * SSM - Saved State Manager, Multi-Connection (Striped) TCP Stream.
+ */
+
+/*
+ * Copyright (C) 2016 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ */
+
+/** @page pg_ssm_tcp_stripe     SSM - Striped TCP Streams
+ *
+ * The teleporter and the fault tolerance manager push the whole saved state
+ * over a single TCP connection, which caps the throughput at what one
+ * connection (and one core doing the socket I/O) can manage.  The striped
+ * stream implemented here spreads the stream buffers written by SSM over N
+ * data connections, each serviced by its own thread.
+ *
+ * Each block written by SSM is prefixed by a SSMTCPSTRIPEHDR carrying the
+ * stream offset of the block, which doubles as the sequence number.  The
+ * blocks are handed out to the connections in a round robin fashion.  On the
+ * receiving end, one thread per connection reads blocks into a private queue
+ * and the SSM read method picks the block matching the current stream offset
+ * from the queue heads.  Since the blocks on each connection are strictly
+ * ordered, a per connection read-ahead limit is sufficient to bound the memory
+ * usage without risking a deadlock.
+ *
+ * The end of the stream is signalled by a zero sized block on every
+ * connection, cancellation by a UINT32_MAX sized one, just like the single
+ * connection streams of the users do it.
+ *
+ * Setting up the data connections is done using the control connection of the
+ * user: The receiving side listens on a random port and sends the port number
+ * and a random cookie over the control connection
+ * (SSMR3TcpStripeListen), the sending side connects to it and presents the
+ * cookie on each new connection (SSMR3TcpStripeConnect).  The side which
+ * listens need not be the side receiving the stream, although that is the way
+ * both the teleporter and FTM use it.
+ *
+ * A stripe can be reused for several consecutive streams, see
+ * SSMR3TcpStripeReset.
+ */
+
+
+/*********************************************************************************************************************************
+*   Header Files                                                                                                                 *
+*********************************************************************************************************************************/
+#define LOG_GROUP LOG_GROUP_SSM
+#include <VBox/vmm/ssm.h>
+#include <VBox/err.h>
+#include <VBox/log.h>
+
+#include <iprt/asm.h>
+#include <iprt/assert.h>
+#include <iprt/critsect.h>
+#include <iprt/mem.h>
+#include <iprt/rand.h>
+#include <iprt/semaphore.h>
+#include <iprt/socket.h>
+#include <iprt/string.h>
+#include <iprt/tcp.h>
+#include <iprt/thread.h>
+#include <iprt/timer.h>
+
+
+/*********************************************************************************************************************************
+*   Defined Constants And Macros                                                                                                 *
+*********************************************************************************************************************************/
+/** Magic value for SSMTCPSTRIPEHDR::u32Magic. (Hermeto Pascoal) */
+#define SSMTCPSTRIPEHDR_MAGIC           UINT32_C(0x19360622)
+/** The max block size. */
+#define SSMTCPSTRIPEHDR_MAX_SIZE        UINT32_C(0x00100000)
+/** Magic value for SSMTCPSTRIPE::u32Magic. (Airto Moreira) */
+#define SSMTCPSTRIPE_MAGIC              UINT32_C(0x19410805)
+/** Magic value for SSMTCPSTRIPE::u32Magic after destruction. */
+#define SSMTCPSTRIPE_MAGIC_DEAD         UINT32_C(0x19410806)
+/** The max number of blocks queued up for a connection. */
+#define SSMTCPSTRIPE_MAX_QUEUED         4
+/** The size of the connection cookie in bytes. */
+#define SSMTCPSTRIPE_COOKIE_SIZE        16
+/** How long to wait for the data connections to be established (ms). */
+#define SSMTCPSTRIPE_ACCEPT_TIMEOUT     60000
+
+
+/*********************************************************************************************************************************
+*   Structures and Typedefs                                                                                                      *
+*********************************************************************************************************************************/
+/**
+ * Striped TCP stream block header.
+ */
+typedef struct SSMTCPSTRIPEHDR
+{
+    /** Magic value (SSMTCPSTRIPEHDR_MAGIC). */
+    uint32_t    u32Magic;
+    /** The size of the data block following this header.
+     * 0 indicates the end of the stream, while UINT32_MAX indicates
+     * cancelation. */
+    uint32_t    cb;
+    /** The stream offset of the block (sequence number). */
+    uint64_t    offStream;
+} SSMTCPSTRIPEHDR;
+AssertCompileSize(SSMTCPSTRIPEHDR, 16);
+
+
+/** Pointer to a stripe block. */
+typedef struct SSMTCPSTRIPEBLK *PSSMTCPSTRIPEBLK;
+/**
+ * A block queued for sending or waiting to be consumed.
+ */
+typedef struct SSMTCPSTRIPEBLK
+{
+    /** Pointer to the next block in the queue. */
+    PSSMTCPSTRIPEBLK        pNext;
+    /** The stream offset of the block. */
+    uint64_t                offStream;
+    /** The size of the block. */
+    uint32_t                cb;
+    /** Read position within the block (receiving side). */
+    uint32_t                off;
+    /** The data. */
+    uint8_t                 abData[1];
+} SSMTCPSTRIPEBLK;
+
+
+/**
+ * Per connection data.
+ */
+typedef struct SSMTCPSTRIPECONN
+{
+    /** Pointer to the stripe. */
+    PSSMTCPSTRIPE           pStripe;
+    /** The data connection. */
+    RTSOCKET                hSocket;
+    /** The I/O thread. */
+    RTTHREAD                hThread;
+    /** Event the I/O thread waits on. */
+    RTSEMEVENT              hEvt;
+    /** Queue head.  Protected by SSMTCPSTRIPE::CritSect. */
+    PSSMTCPSTRIPEBLK        pHead;
+    /** Queue tail.  Protected by SSMTCPSTRIPE::CritSect. */
+    PSSMTCPSTRIPEBLK        pTail;
+    /** Number of queued blocks.  Protected by SSMTCPSTRIPE::CritSect. */
+    uint32_t                cQueued;
+    /** The end of stream marker to send (0 or UINT32_MAX) when fEndOfStream
+     * is set on the sending side, the one received on the receiving side. */
+    uint32_t                cbEndOfStream;
+    /** Sending: send an end of stream marker once the queue is empty.
+     * Receiving: an end of stream marker was received.
+     * Protected by SSMTCPSTRIPE::CritSect. */
+    bool                    fEndOfStream;
+    /** Number of bytes transferred over this connection. */
+    uint64_t volatile       cbXfered;
+} SSMTCPSTRIPECONN;
+/** Pointer to per connection data. */
+typedef SSMTCPSTRIPECONN *PSSMTCPSTRIPECONN;
+
+
+/**
+ * Striped TCP stream instance data.
+ */
+typedef struct SSMTCPSTRIPE
+{
+    /** Magic value (SSMTCPSTRIPE_MAGIC). */
+    uint32_t                u32Magic;
+    /** Sending (true) or receiving (false) side. */
+    bool                    fWrite;
+    /** Set when the I/O threads should terminate. */
+    bool volatile           fTerminate;
+    /** Whether the data connections were accepted by our TCP server
+     * (SSMR3TcpStripeListen) instead of connected by RTTcpClientConnect. */
+    bool                    fAccepted;
+    /** The number of data connections. */
+    uint32_t                cConns;
+    /** Status of the stream, the first error encountered. */
+    int32_t volatile        rc;
+    /** Optional control connection polled by pfnIsOk on the sending side. */
+    RTSOCKET                hCtrlSocket;
+    /** The current stream offset. */
+    uint64_t                offStream;
+    /** Round robin index for the next block (sending side). */
+    uint32_t                iNextConn;
+    /** Critical section protecting the queues. */
+    RTCRITSECT              CritSect;
+    /** Event signalled whenever the state of a queue changes.  The SSM I/O
+     * thread waits on this. */
+    RTSEMEVENT              hEvtChanged;
+    /** The connections. */
+    SSMTCPSTRIPECONN        aConns[1];
+} SSMTCPSTRIPE;
+
+
+/**
+ * Sets the stream status if not already set.
+ *
+ * @param   pThis               The stripe.
+ * @param   rc                  The failure status.
+ */
+static void ssmR3TcpStripeSetError(PSSMTCPSTRIPE pThis, int rc)
+{
+    Assert(RT_FAILURE(rc));
+    ASMAtomicCmpXchgS32(&pThis->rc, rc, VINF_SUCCESS);
+    RTSemEventSignal(pThis->hEvtChanged);
+}
+
+
+/**
+ * Frees a list of blocks.
+ *
+ * @param   pHead               The list head.
+ */
+static void ssmR3TcpStripeFreeBlocks(PSSMTCPSTRIPEBLK pHead)
+{
+    while (pHead)
+    {
+        PSSMTCPSTRIPEBLK pNext = pHead->pNext;
+        RTMemFree(pHead);
+        pHead = pNext;
+    }
+}
+
+
+/**
+ * @callback_method_impl{FNRTTHREAD, Sending side connection thread.}
+ */
+static DECLCALLBACK(int) ssmR3TcpStripeSendThread(RTTHREAD hThreadSelf, void *pvUser)
+{
+    PSSMTCPSTRIPECONN pConn = (PSSMTCPSTRIPECONN)pvUser;
+    PSSMTCPSTRIPE     pThis = pConn->pStripe;
+    RT_NOREF(hThreadSelf);
+
+    for (;;)
+    {
+        RTCritSectEnter(&pThis->CritSect);
+        PSSMTCPSTRIPEBLK pBlk = pConn->pHead;
+        bool const       fEos = pConn->fEndOfStream;
+        if (pBlk)
+        {
+            pConn->pHead = pBlk->pNext;
+            if (!pConn->pHead)
+                pConn->pTail = NULL;
+        }
+        RTCritSectLeave(&pThis->CritSect);
+
+        if (ASMAtomicReadBool(&pThis->fTerminate))
+        {
+            RTMemFree(pBlk);
+            break;
+        }
+
+        if (pBlk)
+        {
+            /*
+             * Write the block unless the stream already failed.
+             */
+            if (RT_SUCCESS(ASMAtomicReadS32(&pThis->rc)))
+            {
+                SSMTCPSTRIPEHDR Hdr;
+                Hdr.u32Magic  = SSMTCPSTRIPEHDR_MAGIC;
+                Hdr.cb        = pBlk->cb;
+                Hdr.offStream = pBlk->offStream;
+                int rc = RTTcpSgWriteL(pConn->hSocket, 2, &Hdr, sizeof(Hdr), &pBlk->abData[0], (size_t)pBlk->cb);
+                if (RT_SUCCESS(rc))
+                    ASMAtomicAddU64(&pConn->cbXfered, pBlk->cb);
+                else
+                {
+                    LogRel(("SSM/TcpStripe: Write error: %Rrc (cb=%#x conn=%u)\n", rc, Hdr.cb, pConn - &pThis->aConns[0]));
+                    ssmR3TcpStripeSetError(pThis, rc);
+                }
+            }
+            RTMemFree(pBlk);
+
+            RTCritSectEnter(&pThis->CritSect);
+            pConn->cQueued--;
+            RTCritSectLeave(&pThis->CritSect);
+            RTSemEventSignal(pThis->hEvtChanged);
+        }
+        else if (fEos)
+        {
+            /*
+             * The queue is drained, send the end of stream marker.
+             */
+            SSMTCPSTRIPEHDR Hdr;
+            Hdr.u32Magic  = SSMTCPSTRIPEHDR_MAGIC;
+            Hdr.cb        = pConn->cbEndOfStream;
+            Hdr.offStream = pThis->offStream;
+            int rc = RTTcpWrite(pConn->hSocket, &Hdr, sizeof(Hdr));
+            if (RT_FAILURE(rc))
+            {
+                LogRel(("SSM/TcpStripe: EOS header write error: %Rrc (conn=%u)\n", rc, pConn - &pThis->aConns[0]));
+                ssmR3TcpStripeSetError(pThis, rc);
+            }
+
+            RTCritSectEnter(&pThis->CritSect);
+            pConn->fEndOfStream = false;
+            RTCritSectLeave(&pThis->CritSect);
+            RTSemEventSignal(pThis->hEvtChanged);
+        }
+        else
+            RTSemEventWait(pConn->hEvt, RT_INDEFINITE_WAIT);
+    }
+
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * @callback_method_impl{FNRTTHREAD, Receiving side connection thread.}
+ */
+static DECLCALLBACK(int) ssmR3TcpStripeRecvThread(RTTHREAD hThreadSelf, void *pvUser)
+{
+    PSSMTCPSTRIPECONN pConn = (PSSMTCPSTRIPECONN)pvUser;
+    PSSMTCPSTRIPE     pThis = pConn->pStripe;
+    RT_NOREF(hThreadSelf);
+
+    while (!ASMAtomicReadBool(&pThis->fTerminate))
+    {
+        /*
+         * Throttle the read-ahead and park after the end of the stream
+         * until the stripe is reset.
+         */
+        RTCritSectEnter(&pThis->CritSect);
+        bool const fWait = pConn->fEndOfStream
+                        || pConn->cQueued >= SSMTCPSTRIPE_MAX_QUEUED;
+        RTCritSectLeave(&pThis->CritSect);
+        if (fWait)
+        {
+            RTSemEventWait(pConn->hEvt, RT_INDEFINITE_WAIT);
+            continue;
+        }
+
+        /*
+         * Read the block header and validate it.
+         */
+        SSMTCPSTRIPEHDR Hdr;
+        int rc = RTTcpRead(pConn->hSocket, &Hdr, sizeof(Hdr), NULL);
+        if (RT_FAILURE(rc))
+        {
+            if (!ASMAtomicReadBool(&pThis->fTerminate))
+            {
+                LogRel(("SSM/TcpStripe: Header read error: %Rrc (conn=%u)\n", rc, pConn - &pThis->aConns[0]));
+                ssmR3TcpStripeSetError(pThis, rc);
+            }
+            break;
+        }
+        if (RT_UNLIKELY(   Hdr.u32Magic != SSMTCPSTRIPEHDR_MAGIC
+                        || (   Hdr.cb > SSMTCPSTRIPEHDR_MAX_SIZE
+                            && Hdr.cb != UINT32_MAX)))
+        {
+            LogRel(("SSM/TcpStripe: Invalid block: u32Magic=%#x cb=%#x (conn=%u)\n",
+                    Hdr.u32Magic, Hdr.cb, pConn - &pThis->aConns[0]));
+            ssmR3TcpStripeSetError(pThis, VERR_IO_GEN_FAILURE);
+            break;
+        }
+
+        if (Hdr.cb == 0 || Hdr.cb == UINT32_MAX)
+        {
+            RTCritSectEnter(&pThis->CritSect);
+            pConn->cbEndOfStream = Hdr.cb;
+            pConn->fEndOfStream  = true;
+            RTCritSectLeave(&pThis->CritSect);
+            RTSemEventSignal(pThis->hEvtChanged);
+            continue;
+        }
+
+        /*
+         * Read the data and queue the block.
+         */
+        PSSMTCPSTRIPEBLK pBlk = (PSSMTCPSTRIPEBLK)RTMemAlloc(RT_OFFSETOF(SSMTCPSTRIPEBLK, abData[Hdr.cb]));
+        if (!pBlk)
+        {
+            ssmR3TcpStripeSetError(pThis, VERR_NO_MEMORY);
+            break;
+        }
+        pBlk->pNext     = NULL;
+        pBlk->offStream = Hdr.offStream;
+        pBlk->cb        = Hdr.cb;
+        pBlk->off       = 0;
+        rc = RTTcpRead(pConn->hSocket, &pBlk->abData[0], Hdr.cb, NULL);
+        if (RT_FAILURE(rc))
+        {
+            RTMemFree(pBlk);
+            if (!ASMAtomicReadBool(&pThis->fTerminate))
+            {
+                LogRel(("SSM/TcpStripe: Data read error: %Rrc (cb=%#x conn=%u)\n", rc, Hdr.cb, pConn - &pThis->aConns[0]));
+                ssmR3TcpStripeSetError(pThis, rc);
+            }
+            break;
+        }
+        ASMAtomicAddU64(&pConn->cbXfered, Hdr.cb);
+
+        RTCritSectEnter(&pThis->CritSect);
+        if (pConn->pTail)
+            pConn->pTail->pNext = pBlk;
+        else
+            pConn->pHead = pBlk;
+        pConn->pTail = pBlk;
+        pConn->cQueued++;
+        RTCritSectLeave(&pThis->CritSect);
+        RTSemEventSignal(pThis->hEvtChanged);
+    }
+
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * @copydoc SSMSTRMOPS::pfnWrite
+ */
+static DECLCALLBACK(int) ssmR3TcpStripeOpWrite(void *pvUser, uint64_t offStream, const void *pvBuf, size_t cbToWrite)
+{
+    PSSMTCPSTRIPE pThis = (PSSMTCPSTRIPE)pvUser;
+    RT_NOREF(offStream);
+    AssertReturn(cbToWrite > 0, VINF_SUCCESS);
+    AssertReturn(cbToWrite < UINT32_MAX, VERR_OUT_OF_RANGE);
+    AssertReturn(pThis->fWrite, VERR_INVALID_HANDLE);
+
+    for (;;)
+    {
+        int rc = ASMAtomicReadS32(&pThis->rc);
+        if (RT_FAILURE(rc))
+            return rc;
+
+        /*
+         * Copy the data into a new block before we take the lock.
+         */
+        uint32_t const   cb   = RT_MIN((uint32_t)cbToWrite, SSMTCPSTRIPEHDR_MAX_SIZE);
+        PSSMTCPSTRIPEBLK pBlk = (PSSMTCPSTRIPEBLK)RTMemAlloc(RT_OFFSETOF(SSMTCPSTRIPEBLK, abData[cb]));
+        if (!pBlk)
+            return VERR_NO_MEMORY;
+        pBlk->pNext     = NULL;
+        pBlk->offStream = pThis->offStream;
+        pBlk->cb        = cb;
+        pBlk->off       = 0;
+        memcpy(&pBlk->abData[0], pvBuf, cb);
+
+        /*
+         * Queue it on the next connection in the round robin, waiting for
+         * space if the connection is lagging behind.
+         */
+        PSSMTCPSTRIPECONN pConn = &pThis->aConns[pThis->iNextConn];
+        RTCritSectEnter(&pThis->CritSect);
+        while (   pConn->cQueued >= SSMTCPSTRIPE_MAX_QUEUED
+               && RT_SUCCESS(ASMAtomicReadS32(&pThis->rc)))
+        {
+            RTCritSectLeave(&pThis->CritSect);
+            RTSemEventWait(pThis->hEvtChanged, RT_INDEFINITE_WAIT);
+            RTCritSectEnter(&pThis->CritSect);
+        }
+        rc = ASMAtomicReadS32(&pThis->rc);
+        if (RT_SUCCESS(rc))
+        {
+            if (pConn->pTail)
+                pConn->pTail->pNext = pBlk;
+            else
+                pConn->pHead = pBlk;
+            pConn->pTail = pBlk;
+            pConn->cQueued++;
+        }
+        RTCritSectLeave(&pThis->CritSect);
+        if (RT_FAILURE(rc))
+        {
+            RTMemFree(pBlk);
+            return rc;
+        }
+        RTSemEventSignal(pConn->hEvt);
+
+        pThis->iNextConn  = (pThis->iNextConn + 1) % pThis->cConns;
+        pThis->offStream += cb;
+        if (cb == cbToWrite)
+            return VINF_SUCCESS;
+
+        /* advance */
+        cbToWrite -= cb;
+        pvBuf = (uint8_t const *)pvBuf + cb;
+    }
+}
+
+
+/**
+ * @copydoc SSMSTRMOPS::pfnRead
+ */
+static DECLCALLBACK(int) ssmR3TcpStripeOpRead(void *pvUser, uint64_t offStream, void *pvBuf, size_t cbToRead, size_t *pcbRead)
+{
+    PSSMTCPSTRIPE pThis = (PSSMTCPSTRIPE)pvUser;
+    RT_NOREF(offStream);
+    AssertReturn(!pThis->fWrite, VERR_INVALID_HANDLE);
+
+    RTCritSectEnter(&pThis->CritSect);
+    for (;;)
+    {
+        /*
+         * Look for the block at the current stream offset.  Each connection
+         * delivers its blocks in order, so only the queue heads are candidates.
+         */
+        PSSMTCPSTRIPECONN pConn = NULL;
+        uint32_t          cEos  = 0;
+        bool              fCancelled = false;
+        for (uint32_t i = 0; i < pThis->cConns; i++)
+        {
+            PSSMTCPSTRIPEBLK pBlk = pThis->aConns[i].pHead;
+            if (pBlk && pBlk->offStream + pBlk->off == pThis->offStream)
+            {
+                pConn = &pThis->aConns[i];
+                break;
+            }
+            if (!pBlk && pThis->aConns[i].fEndOfStream)
+            {
+                cEos++;
+                if (pThis->aConns[i].cbEndOfStream == UINT32_MAX)
+                    fCancelled = true;
+            }
+        }
+
+        if (pConn)
+        {
+            PSSMTCPSTRIPEBLK pBlk = pConn->pHead;
+            uint32_t const   cb   = (uint32_t)RT_MIN(pBlk->cb - pBlk->off, cbToRead);
+            memcpy(pvBuf, &pBlk->abData[pBlk->off], cb);
+            pBlk->off        += cb;
+            pThis->offStream += cb;
+            if (pBlk->off == pBlk->cb)
+            {
+                pConn->pHead = pBlk->pNext;
+                if (!pConn->pHead)
+                    pConn->pTail = NULL;
+                pConn->cQueued--;
+                RTMemFree(pBlk);
+                RTSemEventSignal(pConn->hEvt);
+            }
+
+            cbToRead -= cb;
+            pvBuf     = (uint8_t *)pvBuf + cb;
+            if (pcbRead)
+            {
+                *pcbRead = cb;
+                break;
+            }
+            if (!cbToRead)
+                break;
+            continue;
+        }
+
+        /*
+         * Nothing ready.  Check for the end of the stream and errors before
+         * going to sleep.
+         */
+        if (cEos == pThis->cConns)
+        {
+            RTCritSectLeave(&pThis->CritSect);
+            return fCancelled ? VERR_SSM_CANCELLED : VERR_EOF;
+        }
+        int rc = ASMAtomicReadS32(&pThis->rc);
+        if (RT_FAILURE(rc))
+        {
+            RTCritSectLeave(&pThis->CritSect);
+            return rc;
+        }
+
+        RTCritSectLeave(&pThis->CritSect);
+        RTSemEventWait(pThis->hEvtChanged, RT_INDEFINITE_WAIT);
+        RTCritSectEnter(&pThis->CritSect);
+    }
+    RTCritSectLeave(&pThis->CritSect);
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * @copydoc SSMSTRMOPS::pfnSeek
+ */
+static DECLCALLBACK(int) ssmR3TcpStripeOpSeek(void *pvUser, int64_t offSeek, unsigned uMethod, uint64_t *poffActual)
+{
+    RT_NOREF(pvUser, offSeek, uMethod, poffActual);
+    return VERR_NOT_SUPPORTED;
+}
+
+
+/**
+ * @copydoc SSMSTRMOPS::pfnTell
+ */
+static DECLCALLBACK(uint64_t) ssmR3TcpStripeOpTell(void *pvUser)
+{
+    PSSMTCPSTRIPE pThis = (PSSMTCPSTRIPE)pvUser;
+    return pThis->offStream;
+}
+
+
+/**
+ * @copydoc SSMSTRMOPS::pfnSize
+ */
+static DECLCALLBACK(int) ssmR3TcpStripeOpSize(void *pvUser, uint64_t *pcb)
+{
+    RT_NOREF(pvUser, pcb);
+    return VERR_NOT_SUPPORTED;
+}
+
+
+/**
+ * @copydoc SSMSTRMOPS::pfnIsOk
+ */
+static DECLCALLBACK(int) ssmR3TcpStripeOpIsOk(void *pvUser)
+{
+    PSSMTCPSTRIPE pThis = (PSSMTCPSTRIPE)pvUser;
+
+    int rc = ASMAtomicReadS32(&pThis->rc);
+    if (RT_FAILURE(rc))
+    {
+        LogRel(("SSM/TcpStripe: Stream failed: %Rrc (IsOk).\n", rc));
+        return rc;
+    }
+
+    if (   pThis->fWrite
+        && pThis->hCtrlSocket != NIL_RTSOCKET)
+    {
+        /* Poll for incoming NACKs and errors from the other side */
+        rc = RTTcpSelectOne(pThis->hCtrlSocket, 0);
+        if (rc != VERR_TIMEOUT)
+        {
+            if (RT_SUCCESS(rc))
+            {
+                LogRel(("SSM/TcpStripe: Incoming data detect by IsOk, assuming it is a cancellation NACK.\n"));
+                rc = VERR_SSM_CANCELLED;
+            }
+            else
+                LogRel(("SSM/TcpStripe: RTTcpSelectOne -> %Rrc (IsOk).\n", rc));
+            return rc;
+        }
+    }
+
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * @copydoc SSMSTRMOPS::pfnClose
+ */
+static DECLCALLBACK(int) ssmR3TcpStripeOpClose(void *pvUser, bool fCancelled)
+{
+    PSSMTCPSTRIPE pThis = (PSSMTCPSTRIPE)pvUser;
+    if (!pThis->fWrite)
+        return VINF_SUCCESS;
+
+    /*
+     * Queue the end of stream marker on all connections and wait for them to
+     * be flushed out.
+     */
+    RTCritSectEnter(&pThis->CritSect);
+    for (uint32_t i = 0; i < pThis->cConns; i++)
+    {
+        pThis->aConns[i].cbEndOfStream = fCancelled ? UINT32_MAX : 0;
+        pThis->aConns[i].fEndOfStream  = true;
+        RTSemEventSignal(pThis->aConns[i].hEvt);
+    }
+
+    for (;;)
+    {
+        uint32_t cBusy = 0;
+        for (uint32_t i = 0; i < pThis->cConns; i++)
+            if (pThis->aConns[i].fEndOfStream || pThis->aConns[i].cQueued)
+                cBusy++;
+        if (!cBusy || RT_FAILURE(ASMAtomicReadS32(&pThis->rc)))
+            break;
+        RTCritSectLeave(&pThis->CritSect);
+        RTSemEventWait(pThis->hEvtChanged, RT_INDEFINITE_WAIT);
+        RTCritSectEnter(&pThis->CritSect);
+    }
+    RTCritSectLeave(&pThis->CritSect);
+
+    int rc = ASMAtomicReadS32(&pThis->rc);
+    if (RT_FAILURE(rc))
+        LogRel(("SSM/TcpStripe: Close failed: %Rrc\n", rc));
+    return rc;
+}
+
+
+/**
+ * Method table for a striped TCP stream.
+ */
+static SSMSTRMOPS const g_ssmR3TcpStripeOps =
+{
+    SSMSTRMOPS_VERSION,
+    ssmR3TcpStripeOpWrite,
+    ssmR3TcpStripeOpRead,
+    ssmR3TcpStripeOpSeek,
+    ssmR3TcpStripeOpTell,
+    ssmR3TcpStripeOpSize,
+    ssmR3TcpStripeOpIsOk,
+    ssmR3TcpStripeOpClose,
+    SSMSTRMOPS_VERSION
+};
+
+
+/**
+ * Worker for SSMR3TcpStripeCreate and SSMR3TcpStripeListen.
+ *
+ * @returns VBox status code.
+ * @param   fWrite              Whether this is the sending (true) or receiving
+ *                              (false) side of the stream.
+ * @param   fAccepted           Whether the sockets were accepted by a TCP
+ *                              server (true) or connected by
+ *                              RTTcpClientConnect (false).  This decides how
+ *                              they're closed.
+ * @param   pahSockets          The data connections.  The stripe takes
+ *                              ownership of these on success.
+ * @param   cSockets            The number of data connections.
+ * @param   hCtrlSocket         The control connection, see
+ *                              SSMR3TcpStripeCreate.
+ * @param   ppStripe            Where to return the stripe handle.
+ */
+static int ssmR3TcpStripeCreate(bool fWrite, bool fAccepted, PRTSOCKET pahSockets, uint32_t cSockets, RTSOCKET hCtrlSocket,
+                                PSSMTCPSTRIPE *ppStripe)
+{
+    AssertPtrReturn(ppStripe, VERR_INVALID_POINTER);
+    *ppStripe = NULL;
+    AssertPtrReturn(pahSockets, VERR_INVALID_POINTER);
+    AssertReturn(cSockets > 0 && cSockets <= SSM_TCP_STRIPE_MAX_CONNS, VERR_OUT_OF_RANGE);
+
+    PSSMTCPSTRIPE pThis = (PSSMTCPSTRIPE)RTMemAllocZ(RT_OFFSETOF(SSMTCPSTRIPE, aConns[cSockets]));
+    if (!pThis)
+        return VERR_NO_MEMORY;
+    pThis->u32Magic    = SSMTCPSTRIPE_MAGIC;
+    pThis->fWrite      = fWrite;
+    pThis->fTerminate  = false;
+    pThis->fAccepted   = fAccepted;
+    pThis->cConns      = cSockets;
+    pThis->rc          = VINF_SUCCESS;
+    pThis->hCtrlSocket = hCtrlSocket;
+    pThis->offStream   = 0;
+    pThis->iNextConn   = 0;
+    pThis->hEvtChanged = NIL_RTSEMEVENT;
+    for (uint32_t i = 0; i < cSockets; i++)
+    {
+        pThis->aConns[i].pStripe = pThis;
+        pThis->aConns[i].hSocket = pahSockets[i];
+        pThis->aConns[i].hThread = NIL_RTTHREAD;
+        pThis->aConns[i].hEvt    = NIL_RTSEMEVENT;
+    }
+
+    int rc = RTCritSectInit(&pThis->CritSect);
+    if (RT_SUCCESS(rc))
+    {
+        rc = RTSemEventCreate(&pThis->hEvtChanged);
+        for (uint32_t i = 0; i < cSockets && RT_SUCCESS(rc); i++)
+        {
+            rc = RTSemEventCreate(&pThis->aConns[i].hEvt);
+            if (RT_SUCCESS(rc))
+                rc = RTThreadCreateF(&pThis->aConns[i].hThread,
+                                     fWrite ? ssmR3TcpStripeSendThread : ssmR3TcpStripeRecvThread,
+                                     &pThis->aConns[i], 0, RTTHREADTYPE_IO, RTTHREADFLAGS_WAITABLE,
+                                     fWrite ? "SsmTx%u" : "SsmRx%u", i);
+        }
+        if (RT_SUCCESS(rc))
+        {
+            *ppStripe = pThis;
+            return VINF_SUCCESS;
+        }
+
+        /* Failed, don't let the destructor close the sockets owned by the caller. */
+        for (uint32_t i = 0; i < cSockets; i++)
+            pThis->aConns[i].hSocket = NIL_RTSOCKET;
+        SSMR3TcpStripeDestroy(pThis);
+        return rc;
+    }
+
+    RTMemFree(pThis);
+    return rc;
+}
+
+
+/**
+ * Creates a striped TCP stream on top of a set of connected sockets.
+ *
+ * @returns VBox status code.
+ * @param   fWrite              Whether this is the sending (true) or receiving
+ *                              (false) side of the stream.
+ * @param   pahSockets          The data connections, connected by
+ *                              RTTcpClientConnect.  The stripe takes
+ *                              ownership of these on success.
+ * @param   cSockets            The number of data connections.
+ * @param   hCtrlSocket         The control connection which the IsOk method
+ *                              of the sending side should poll for
+ *                              cancellation NACKs.  NIL_RTSOCKET if none.
+ *                              This is not owned by the stripe.
+ * @param   ppStripe            Where to return the stripe handle.
+ */
+VMMR3DECL(int) SSMR3TcpStripeCreate(bool fWrite, PRTSOCKET pahSockets, uint32_t cSockets, RTSOCKET hCtrlSocket,
+                                    PSSMTCPSTRIPE *ppStripe)
+{
+    return ssmR3TcpStripeCreate(fWrite, false /*fAccepted*/, pahSockets, cSockets, hCtrlSocket, ppStripe);
+}
+
+
+/**
+ * Destroys a striped TCP stream, closing all the data connections.
+ *
+ * @returns VBox status code.
+ * @param   pStripe             The stripe handle.  NULL is quietly ignored.
+ */
+VMMR3DECL(int) SSMR3TcpStripeDestroy(PSSMTCPSTRIPE pStripe)
+{
+    PSSMTCPSTRIPE pThis = pStripe;
+    if (!pThis)
+        return VINF_SUCCESS;
+    AssertPtrReturn(pThis, VERR_INVALID_HANDLE);
+    AssertReturn(pThis->u32Magic == SSMTCPSTRIPE_MAGIC, VERR_INVALID_HANDLE);
+
+    /*
+     * Tell the threads to quit, shutting down the sockets to get them out of
+     * any blocking socket calls.
+     */
+    ASMAtomicWriteBool(&pThis->fTerminate, true);
+    for (uint32_t i = 0; i < pThis->cConns; i++)
+    {
+        if (pThis->aConns[i].hSocket != NIL_RTSOCKET)
+            RTSocketShutdown(pThis->aConns[i].hSocket, true /*fRead*/, true /*fWrite*/);
+        if (pThis->aConns[i].hEvt != NIL_RTSEMEVENT)
+            RTSemEventSignal(pThis->aConns[i].hEvt);
+    }
+
+    for (uint32_t i = 0; i < pThis->cConns; i++)
+    {
+        PSSMTCPSTRIPECONN pConn = &pThis->aConns[i];
+        if (pConn->hThread != NIL_RTTHREAD)
+        {
+            int rc = RTThreadWait(pConn->hThread, 30000, NULL);
+            AssertLogRelRC(rc);
+            pConn->hThread = NIL_RTTHREAD;
+        }
+        if (pConn->hSocket != NIL_RTSOCKET)
+        {
+            if (pThis->fAccepted)
+                RTTcpServerDisconnectClient2(pConn->hSocket);
+            else
+                RTTcpClientCloseEx(pConn->hSocket, false /*fGracefulShutdown*/);
+            pConn->hSocket = NIL_RTSOCKET;
+        }
+        if (pConn->hEvt != NIL_RTSEMEVENT)
+        {
+            RTSemEventDestroy(pConn->hEvt);
+            pConn->hEvt = NIL_RTSEMEVENT;
+        }
+        ssmR3TcpStripeFreeBlocks(pConn->pHead);
+        pConn->pHead = pConn->pTail = NULL;
+    }
+
+    RTSemEventDestroy(pThis->hEvtChanged);
+    pThis->hEvtChanged = NIL_RTSEMEVENT;
+    RTCritSectDelete(&pThis->CritSect);
+    pThis->u32Magic = SSMTCPSTRIPE_MAGIC_DEAD;
+    RTMemFree(pThis);
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Resets a stripe so it can be used for another stream.
+ *
+ * The previous stream must have been closed (sending side) or read up to
+ * the end of stream marker (receiving side).
+ *
+ * @returns VBox status code.
+ * @param   pStripe             The stripe handle.
+ */
+VMMR3DECL(int) SSMR3TcpStripeReset(PSSMTCPSTRIPE pStripe)
+{
+    PSSMTCPSTRIPE pThis = pStripe;
+    AssertPtrReturn(pThis, VERR_INVALID_HANDLE);
+    AssertReturn(pThis->u32Magic == SSMTCPSTRIPE_MAGIC, VERR_INVALID_HANDLE);
+
+    int rc = ASMAtomicReadS32(&pThis->rc);
+    if (RT_FAILURE(rc))
+        return rc;
+
+    RTCritSectEnter(&pThis->CritSect);
+    for (uint32_t i = 0; i < pThis->cConns; i++)
+    {
+        PSSMTCPSTRIPECONN pConn = &pThis->aConns[i];
+        AssertMsg(!pConn->pHead, ("conn=%u\n", i));
+        if (!pThis->fWrite)
+        {
+            ssmR3TcpStripeFreeBlocks(pConn->pHead);
+            pConn->pHead   = pConn->pTail = NULL;
+            pConn->cQueued = 0;
+            pConn->fEndOfStream = false;
+        }
+        RTSemEventSignal(pConn->hEvt);
+    }
+    pThis->offStream = 0;
+    pThis->iNextConn = 0;
+    RTCritSectLeave(&pThis->CritSect);
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Gets the stream method table for striped TCP streams.
+ *
+ * The stripe handle is the user argument for the methods.
+ *
+ * @returns Pointer to the method table.
+ */
+VMMR3DECL(PCSSMSTRMOPS) SSMR3TcpStripeGetOps(void)
+{
+    return &g_ssmR3TcpStripeOps;
+}
+
+
+/**
+ * Gets the number of bytes transferred over a data connection.
+ *
+ * @returns Byte count, 0 if invalid input.
+ * @param   pStripe             The stripe handle.
+ * @param   iConn               The connection index.
+ */
+VMMR3DECL(uint64_t) SSMR3TcpStripeGetConnBytes(PSSMTCPSTRIPE pStripe, uint32_t iConn)
+{
+    PSSMTCPSTRIPE pThis = pStripe;
+    AssertPtrReturn(pThis, 0);
+    AssertReturn(pThis->u32Magic == SSMTCPSTRIPE_MAGIC, 0);
+    AssertReturn(iConn < pThis->cConns, 0);
+    return ASMAtomicReadU64(&pThis->aConns[iConn].cbXfered);
+}
+
+
+/**
+ * Reads a newline terminated line from the control connection.
+ *
+ * @returns VBox status code.
+ * @param   hSocket             The control connection.
+ * @param   pszBuf              The output buffer.
+ * @param   cchBuf              The size of the output buffer.
+ */
+static int ssmR3TcpStripeReadLine(RTSOCKET hSocket, char *pszBuf, size_t cchBuf)
+{
+    AssertReturn(cchBuf > 1, VERR_INTERNAL_ERROR);
+    *pszBuf = '\0';
+
+    for (;;)
+    {
+        char ch;
+        int rc = RTTcpRead(hSocket, &ch, sizeof(ch), NULL);
+        if (RT_FAILURE(rc))
+            return rc;
+        if (ch == '\n' || ch == '\0')
+            return VINF_SUCCESS;
+        if (cchBuf <= 1)
+            return VERR_BUFFER_OVERFLOW;
+        *pszBuf++ = ch;
+        *pszBuf = '\0';
+        cchBuf--;
+    }
+}
+
+
+/**
+ * @callback_method_impl{FNRTTIMERLR, Accept timeout.}
+ */
+static DECLCALLBACK(void) ssmR3TcpStripeAcceptTimeout(RTTIMERLR hTimerLR, void *pvUser, uint64_t iTick)
+{
+    RT_NOREF(hTimerLR, iTick);
+    RTTcpServerShutdown((PRTTCPSERVER)pvUser);
+}
+
+
+/**
+ * Sets up the data connections of a stripe by listening for them.
+ *
+ * This creates a TCP server on a random port, tells the peer about the port
+ * and a connection cookie via the control connection and waits for the peer
+ * to establish @a cConns connections (see SSMR3TcpStripeConnect).
+ *
+ * @returns VBox status code.
+ * @param   hCtrlSocket         The control connection.
+ * @param   pszAddress          The address to listen on, NULL for any.
+ * @param   cConns              The number of data connections.
+ * @param   fWrite              Whether this is the sending (true) or receiving
+ *                              (false) side of the stream.
+ * @param   ppStripe            Where to return the stripe handle.
+ */
+VMMR3DECL(int) SSMR3TcpStripeListen(RTSOCKET hCtrlSocket, const char *pszAddress, uint32_t cConns, bool fWrite,
+                                    PSSMTCPSTRIPE *ppStripe)
+{
+    AssertPtrReturn(ppStripe, VERR_INVALID_POINTER);
+    *ppStripe = NULL;
+    AssertReturn(cConns > 0 && cConns <= SSM_TCP_STRIPE_MAX_CONNS, VERR_OUT_OF_RANGE);
+
+    /*
+     * Create the server on a random port.
+     */
+    PRTTCPSERVER hServer = NULL;
+    uint32_t     uPort   = 0;
+    int          rc      = VERR_NET_ADDRESS_IN_USE;
+    for (unsigned cTries = 0; cTries < 256 && rc == VERR_NET_ADDRESS_IN_USE; cTries++)
+    {
+        uPort = RTRandU32Ex(49152, 65534);
+        rc = RTTcpServerCreateEx(pszAddress, uPort, &hServer);
+    }
+    if (RT_FAILURE(rc))
+    {
+        LogRel(("SSM/TcpStripe: RTTcpServerCreateEx failed: %Rrc\n", rc));
+        return rc;
+    }
+
+    /*
+     * Send the port and cookie to the peer.
+     */
+    uint8_t abCookie[SSMTCPSTRIPE_COOKIE_SIZE];
+    char    szCookie[SSMTCPSTRIPE_COOKIE_SIZE * 2 + 1];
+    RTRandBytes(abCookie, sizeof(abCookie));
+    rc = RTStrPrintHexBytes(szCookie, sizeof(szCookie), abCookie, sizeof(abCookie), 0 /*fFlags*/);
+    AssertRC(rc);
+
+    char   szLine[128];
+    size_t cchLine = RTStrPrintf(szLine, sizeof(szLine), "port=%u;cookie=%s\n", uPort, szCookie);
+    rc = RTTcpWrite(hCtrlSocket, szLine, cchLine);
+    if (RT_SUCCESS(rc))
+    {
+        /*
+         * Accept the connections, giving up after a while.
+         */
+        PRTSOCKET pahSockets = (PRTSOCKET)RTMemAllocZ(sizeof(RTSOCKET) * cConns);
+        RTTIMERLR hTimerLR   = NIL_RTTIMERLR;
+        if (pahSockets)
+            rc = RTTimerLRCreateEx(&hTimerLR, 0 /*ns*/, RTTIMER_FLAGS_CPU_ANY, ssmR3TcpStripeAcceptTimeout, hServer);
+        else
+            rc = VERR_NO_MEMORY;
+        if (RT_SUCCESS(rc))
+            rc = RTTimerLRStart(hTimerLR, SSMTCPSTRIPE_ACCEPT_TIMEOUT * UINT64_C(1000000) /*ns*/);
+
+        uint32_t cAccepted = 0;
+        while (RT_SUCCESS(rc) && cAccepted < cConns)
+        {
+            RTSOCKET hSocket;
+            rc = RTTcpServerListen2(hServer, &hSocket);
+            if (RT_FAILURE(rc))
+                break;
+
+            /* Check the cookie, quietly dropping connections with the wrong one. */
+            char szPeerCookie[sizeof(szCookie) + 8];
+            int rc2 = RTTcpSelectOne(hSocket, 10000);
+            if (RT_SUCCESS(rc2))
+                rc2 = ssmR3TcpStripeReadLine(hSocket, szPeerCookie, sizeof(szPeerCookie));
+            if (RT_SUCCESS(rc2) && !strcmp(szPeerCookie, szCookie))
+            {
+                RTTcpSetSendCoalescing(hSocket, false /*fEnable*/);
+                pahSockets[cAccepted++] = hSocket;
+            }
+            else
+            {
+                LogRel(("SSM/TcpStripe: Rejected data connection (%Rrc)\n", rc2));
+                RTTcpServerDisconnectClient2(hSocket);
+            }
+        }
+
+        if (hTimerLR != NIL_RTTIMERLR)
+            RTTimerLRDestroy(hTimerLR);
+
+        if (RT_SUCCESS(rc))
+            rc = ssmR3TcpStripeCreate(fWrite, true /*fAccepted*/, pahSockets, cConns, fWrite ? hCtrlSocket : NIL_RTSOCKET,
+                                      ppStripe);
+        if (RT_FAILURE(rc))
+        {
+            LogRel(("SSM/TcpStripe: Failed to establish %u data connections: %Rrc (got %u)\n", cConns, rc, cAccepted));
+            while (cAccepted-- > 0)
+                RTTcpServerDisconnectClient2(pahSockets[cAccepted]);
+        }
+        RTMemFree(pahSockets);
+    }
+    else
+        LogRel(("SSM/TcpStripe: Failed to send port and cookie: %Rrc\n", rc));
+
+    RTTcpServerDestroy(hServer);
+    return rc;
+}
+
+
+/**
+ * Sets up the data connections of a stripe by connecting to the peer.
+ *
+ * This is the counterpart to SSMR3TcpStripeListen, it reads the port and
+ * cookie from the control connection and establishes @a cConns connections.
+ *
+ * @returns VBox status code.
+ * @param   hCtrlSocket         The control connection.
+ * @param   pszAddress          The address of the peer.
+ * @param   cConns              The number of data connections.  Must match
+ *                              what the peer was given.
+ * @param   fWrite              Whether this is the sending (true) or receiving
+ *                              (false) side of the stream.
+ * @param   ppStripe            Where to return the stripe handle.
+ */
+VMMR3DECL(int) SSMR3TcpStripeConnect(RTSOCKET hCtrlSocket, const char *pszAddress, uint32_t cConns, bool fWrite,
+                                     PSSMTCPSTRIPE *ppStripe)
+{
+    AssertPtrReturn(ppStripe, VERR_INVALID_POINTER);
+    *ppStripe = NULL;
+    AssertPtrReturn(pszAddress, VERR_INVALID_POINTER);
+    AssertReturn(cConns > 0 && cConns <= SSM_TCP_STRIPE_MAX_CONNS, VERR_OUT_OF_RANGE);
+
+    /*
+     * Get the port and cookie: "port=<port>;cookie=<hex>"
+     */
+    char szLine[128];
+    int rc = ssmR3TcpStripeReadLine(hCtrlSocket, szLine, sizeof(szLine));
+    if (RT_FAILURE(rc))
+    {
+        LogRel(("SSM/TcpStripe: Failed to read port and cookie: %Rrc\n", rc));
+        return rc;
+    }
+    char *pszCookie = strchr(szLine, ';');
+    if (   strncmp(szLine, RT_STR_TUPLE("port="))
+        || !pszCookie
+        || strncmp(pszCookie + 1, RT_STR_TUPLE("cookie=")))
+    {
+        LogRel(("SSM/TcpStripe: Malformed port and cookie line: '%s'\n", szLine));
+        return VERR_PARSE_ERROR;
+    }
+    *pszCookie = '\0';
+    pszCookie += 1 + sizeof("cookie=") - 1;
+    uint32_t uPort;
+    rc = RTStrToUInt32Full(&szLine[sizeof("port=") - 1], 10, &uPort);
+    if (rc != VINF_SUCCESS || !uPort || uPort > 65535)
+    {
+        LogRel(("SSM/TcpStripe: Malformed port: '%s'\n", szLine));
+        return VERR_PARSE_ERROR;
+    }
+
+    /*
+     * Connect and present the cookie.
+     */
+    PRTSOCKET pahSockets = (PRTSOCKET)RTMemAllocZ(sizeof(RTSOCKET) * cConns);
+    if (!pahSockets)
+        return VERR_NO_MEMORY;
+    uint32_t cConnected = 0;
+    while (cConnected < cConns)
+    {
+        RTSOCKET hSocket;
+        rc = RTTcpClientConnect(pszAddress, uPort, &hSocket);
+        if (RT_FAILURE(rc))
+            break;
+        pahSockets[cConnected++] = hSocket;
+        RTTcpSetSendCoalescing(hSocket, false /*fEnable*/);
+        rc = RTTcpSgWriteL(hSocket, 2, pszCookie, strlen(pszCookie), RT_STR_TUPLE("\n"));
+        if (RT_FAILURE(rc))
+            break;
+    }
+
+    if (RT_SUCCESS(rc))
+        rc = SSMR3TcpStripeCreate(fWrite, pahSockets, cConns, fWrite ? hCtrlSocket : NIL_RTSOCKET, ppStripe);
+    if (RT_FAILURE(rc))
+    {
+        LogRel(("SSM/TcpStripe: Failed to connect %u data connections to %s:%u: %Rrc\n", cConns, pszAddress, uPort, rc));
+        while (cConnected-- > 0)
+            RTTcpClientCloseEx(pahSockets[cConnected], false /*fGracefulShutdown*/);
+    }
+    RTMemFree(pahSockets);
+    return rc;
+}
@@ -23,6 +23,14 @@
  * STAMR3DumpU, STAMR3DumpToReleaseLogU and the debugger.  Main is exposing the
  * XML based one, STAMR3SnapshotU.
  *
+ * For frequent polling there is also a binary interface: a pattern is compiled
+ * once into an index by STAMR3IndexCompile (compiled patterns are cached), and
+ * STAMR3SnapshotBinary then copies the raw values of the indexed samples into
+ * a caller buffer without any matching or formatting.  STAMR3ExportCreate
+ * builds on this to publish the values in a (file backed) shared memory area
+ * which external collectors can read without taking any locks, see
+ * STAMEXPORTHDR.
+ *
  * The rest of the VMM together with the devices and drivers registers their
  * statistics with STAM giving them a name.  The name is hierarchical, the
  * components separated by slashes ('/') and must start with a slash.
@@ -59,9 +67,20 @@
 
 #include <iprt/assert.h>
 #include <iprt/asm.h>
+#include <iprt/err.h>
+#include <iprt/file.h>
 #include <iprt/mem.h>
+#include <iprt/param.h>
 #include <iprt/stream.h>
 #include <iprt/string.h>
+#include <iprt/time.h>
+
+#ifdef RT_OS_WINDOWS
+# include <iprt/win/windows.h>
+#else
+# include <errno.h>
+# include <sys/mman.h>
+#endif
 
 
 /*********************************************************************************************************************************
@@ -159,6 +178,7 @@ static int                  stamR3EnumU(PUVM pUVM, const char *pszPat, bool fUpd
 static void                 stamR3Ring0StatsRegisterU(PUVM pUVM);
 static void                 stamR3Ring0StatsUpdateU(PUVM pUVM, const char *pszPat);
 static void                 stamR3Ring0StatsUpdateMultiU(PUVM pUVM, const char * const *papszExpressions, unsigned cExpressions);
+static uint32_t             stamR3IndexRelease(PSTAMINDEX pIndex);
 
 #ifdef VBOX_WITH_DEBUGGER
 static FNDBGCCMD            stamR3CmdStats;
@@ -343,6 +363,16 @@ VMMR3DECL(int) STAMR3InitUVM(PUVM pUVM)
  */
 VMMR3DECL(void) STAMR3TermUVM(PUVM pUVM)
 {
+    /*
+     * Drop the compiled pattern cache.
+     */
+    for (unsigned i = 0; i < RT_ELEMENTS(pUVM->stam.s.apIndexCache); i++)
+        if (pUVM->stam.s.apIndexCache[i])
+        {
+            stamR3IndexRelease(pUVM->stam.s.apIndexCache[i]);
+            pUVM->stam.s.apIndexCache[i] = NULL;
+        }
+
     /*
      * Free used memory and the RWLock.
      */
@@ -1431,6 +1461,7 @@ static int stamR3RegisterU(PUVM pUVM, void *pvSample, PFNSTAMR3CALLBACKRESET pfn
 #endif
 
         stamR3ResetOne(pNew, pUVM->pVM);
+        ASMAtomicIncU32(&pUVM->stam.s.iRegGen);
         rc = VINF_SUCCESS;
     }
     else
@@ -1445,10 +1476,12 @@ static int stamR3RegisterU(PUVM pUVM, void *pvSample, PFNSTAMR3CALLBACKRESET pfn
  * Destroys the statistics descriptor, unlinking it and freeing all resources.
  *
  * @returns VINF_SUCCESS
+ * @param   pUVM        Pointer to the user mode VM structure.
  * @param   pCur        The descriptor to destroy.
  */
-static int stamR3DestroyDesc(PSTAMDESC pCur)
+static int stamR3DestroyDesc(PUVM pUVM, PSTAMDESC pCur)
 {
+    ASMAtomicIncU32(&pUVM->stam.s.iRegGen);
     RTListNodeRemove(&pCur->ListEntry);
 #ifdef STAM_WITH_LOOKUP_TREE
     pCur->pLookup->pDesc = NULL; /** @todo free lookup nodes once it's working. */
@@ -1491,7 +1524,7 @@ VMMR3DECL(int)  STAMR3DeregisterByAddr(PUVM pUVM, void *pvSample)
     RTListForEachSafe(&pUVM->stam.s.List, pCur, pNext, STAMDESC, ListEntry)
     {
         if (pCur->u.pv == pvSample)
-            rc = stamR3DestroyDesc(pCur);
+            rc = stamR3DestroyDesc(pUVM, pCur);
     }
 
     STAM_UNLOCK_WR(pUVM);
@@ -1524,7 +1557,7 @@ static int stamR3DeregisterByPattern(PUVM pUVM, const char *pszPat)
             PSTAMDESC pNext = RTListNodeGetNext(&pCur->ListEntry, STAMDESC, ListEntry);
 
             if (RTStrSimplePatternMatch(pszPat, pCur->pszName))
-                rc = stamR3DestroyDesc(pCur);
+                rc = stamR3DestroyDesc(pUVM, pCur);
 
             /* advance. */
             if (pCur == pLast)
@@ -2777,6 +2810,745 @@ VMMR3DECL(const char *) STAMR3GetUnit(STAMUNIT enmUnit)
     }
 }
 
+
+/**
+ * Gets the number of 64-bit values a sample of the given type contributes to
+ * a binary snapshot.
+ *
+ * The values are:
+ *      - STAMTYPE_COUNTER: c.
+ *      - STAMTYPE_PROFILE, STAMTYPE_PROFILE_ADV: cPeriods, cTicks, cTicksMin
+ *        and cTicksMax.
+ *      - STAMTYPE_RATIO_U32, STAMTYPE_RATIO_U32_RESET: u32A and u32B.
+ *      - The integer and boolean types: the value.
+ *      - STAMTYPE_CALLBACK: nothing, these samples are not included.
+ *
+ * @returns Number of values, 0 if not representable.
+ * @param   enmType     The sample type.
+ */
+VMMR3DECL(uint32_t) STAMR3GetTypeValueCount(STAMTYPE enmType)
+{
+    switch (enmType)
+    {
+        case STAMTYPE_COUNTER:
+            return 1;
+        case STAMTYPE_PROFILE:
+        case STAMTYPE_PROFILE_ADV:
+            return 4;
+        case STAMTYPE_RATIO_U32:
+        case STAMTYPE_RATIO_U32_RESET:
+            return 2;
+        case STAMTYPE_U8:
+        case STAMTYPE_U8_RESET:
+        case STAMTYPE_X8:
+        case STAMTYPE_X8_RESET:
+        case STAMTYPE_U16:
+        case STAMTYPE_U16_RESET:
+        case STAMTYPE_X16:
+        case STAMTYPE_X16_RESET:
+        case STAMTYPE_U32:
+        case STAMTYPE_U32_RESET:
+        case STAMTYPE_X32:
+        case STAMTYPE_X32_RESET:
+        case STAMTYPE_U64:
+        case STAMTYPE_U64_RESET:
+        case STAMTYPE_X64:
+        case STAMTYPE_X64_RESET:
+        case STAMTYPE_BOOL:
+        case STAMTYPE_BOOL_RESET:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+
+/**
+ * Copies the values of one sample into a binary snapshot buffer.
+ *
+ * @param   pDesc       The sample descriptor, NULL if gone (zeros the values).
+ * @param   cValues     The number of values to produce.
+ * @param   pau64       Where to store the values.
+ */
+DECLINLINE(void) stamR3IndexReadOne(PSTAMDESC pDesc, uint32_t cValues, uint64_t *pau64)
+{
+    if (!pDesc)
+    {
+        while (cValues-- > 0)
+            *pau64++ = 0;
+        return;
+    }
+
+    switch (pDesc->enmType)
+    {
+        case STAMTYPE_COUNTER:
+            pau64[0] = pDesc->u.pCounter->c;
+            break;
+
+        case STAMTYPE_PROFILE:
+        case STAMTYPE_PROFILE_ADV:
+            pau64[0] = pDesc->u.pProfile->cPeriods;
+            pau64[1] = pDesc->u.pProfile->cTicks;
+            pau64[2] = pDesc->u.pProfile->cTicksMin;
+            pau64[3] = pDesc->u.pProfile->cTicksMax;
+            break;
+
+        case STAMTYPE_RATIO_U32:
+        case STAMTYPE_RATIO_U32_RESET:
+            pau64[0] = pDesc->u.pRatioU32->u32A;
+            pau64[1] = pDesc->u.pRatioU32->u32B;
+            break;
+
+        case STAMTYPE_U8:
+        case STAMTYPE_U8_RESET:
+        case STAMTYPE_X8:
+        case STAMTYPE_X8_RESET:
+            pau64[0] = *pDesc->u.pu8;
+            break;
+
+        case STAMTYPE_U16:
+        case STAMTYPE_U16_RESET:
+        case STAMTYPE_X16:
+        case STAMTYPE_X16_RESET:
+            pau64[0] = *pDesc->u.pu16;
+            break;
+
+        case STAMTYPE_U32:
+        case STAMTYPE_U32_RESET:
+        case STAMTYPE_X32:
+        case STAMTYPE_X32_RESET:
+            pau64[0] = *pDesc->u.pu32;
+            break;
+
+        case STAMTYPE_U64:
+        case STAMTYPE_U64_RESET:
+        case STAMTYPE_X64:
+        case STAMTYPE_X64_RESET:
+            pau64[0] = *pDesc->u.pu64;
+            break;
+
+        case STAMTYPE_BOOL:
+        case STAMTYPE_BOOL_RESET:
+            pau64[0] = *pDesc->u.pf;
+            break;
+
+        default:
+            AssertMsgFailed(("enmType=%d\n", pDesc->enmType));
+            break;
+    }
+}
+
+
+/**
+ * Frees a compiled sample index.
+ *
+ * @param   pIndex      The index.
+ */
+static void stamR3IndexFree(PSTAMINDEX pIndex)
+{
+    pIndex->u32Magic = STAMINDEX_MAGIC_DEAD;
+    RTMemFree(pIndex->paEntries);
+    RTMemFree(pIndex->pszNames);
+    RTStrFree(pIndex->pszPattern);
+    RTMemFree(pIndex);
+}
+
+
+/**
+ * Releases a reference to a compiled sample index.
+ *
+ * @returns The new reference count.
+ * @param   pIndex      The index.
+ */
+static uint32_t stamR3IndexRelease(PSTAMINDEX pIndex)
+{
+    uint32_t cRefs = ASMAtomicDecU32(&pIndex->cRefs);
+    Assert(cRefs < _1M);
+    if (!cRefs)
+        stamR3IndexFree(pIndex);
+    return cRefs;
+}
+
+
+/**
+ * stamR3EnumU callback employed by STAMR3IndexCompile.
+ *
+ * @returns VBox status code, but it's interpreted as 0 == success / !0 == failure by enmR3Enum.
+ * @param   pDesc       The sample.
+ * @param   pvArg       The index being compiled.
+ */
+static int stamR3IndexCompileOne(PSTAMDESC pDesc, void *pvArg)
+{
+    PSTAMINDEX pIndex  = (PSTAMINDEX)pvArg;
+    uint32_t   cValues = STAMR3GetTypeValueCount(pDesc->enmType);
+    if (!cValues)
+        return VINF_SUCCESS;
+
+    /*
+     * Make sure there is space for the entry and its name.
+     */
+    if (pIndex->cEntries >= pIndex->cEntriesAlloc)
+    {
+        uint32_t cNew = pIndex->cEntriesAlloc ? pIndex->cEntriesAlloc * 2 : 64;
+        void *pvNew = RTMemRealloc(pIndex->paEntries, cNew * sizeof(pIndex->paEntries[0]));
+        if (!pvNew)
+            return VERR_NO_MEMORY;
+        pIndex->paEntries     = (PSTAMINDEXENTRY)pvNew;
+        pIndex->cEntriesAlloc = cNew;
+    }
+
+    size_t const cbName = strlen(pDesc->pszName) + 1;
+    if ((pIndex->cbNames + cbName) > RT_ALIGN_32(pIndex->cbNames, _4K))
+    {
+        uint32_t cbNew = RT_ALIGN_32(pIndex->cbNames + (uint32_t)cbName, _4K);
+        void *pvNew = RTMemRealloc(pIndex->pszNames, cbNew);
+        if (!pvNew)
+            return VERR_NO_MEMORY;
+        pIndex->pszNames = (char *)pvNew;
+    }
+
+    /*
+     * Add it.
+     */
+    PSTAMINDEXENTRY pEntry = &pIndex->paEntries[pIndex->cEntries++];
+    pEntry->pDesc   = pDesc;
+    pEntry->offName = pIndex->cbNames;
+    pEntry->iValue  = pIndex->cValues;
+    pEntry->enmType = pDesc->enmType;
+    pEntry->enmUnit = pDesc->enmUnit;
+    memcpy(&pIndex->pszNames[pIndex->cbNames], pDesc->pszName, cbName);
+    pIndex->cbNames += (uint32_t)cbName;
+    pIndex->cValues += cValues;
+
+    if (!strncmp(pDesc->pszName, RT_STR_TUPLE("/GVMM/")))
+        pIndex->fRing0Gvmm = true;
+    else if (!strncmp(pDesc->pszName, RT_STR_TUPLE("/GMM/")))
+        pIndex->fRing0Gmm = true;
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Resolves the sample names of a compiled index against the current
+ * registry, used after samples have been registered or deregistered.
+ *
+ * @param   pUVM        Pointer to the user mode VM structure.
+ * @param   pIndex      The index.
+ *
+ * @remarks Caller must own the write lock.
+ */
+static void stamR3IndexRefresh(PUVM pUVM, PSTAMINDEX pIndex)
+{
+    uint32_t const iRegGen = pUVM->stam.s.iRegGen;
+    for (uint32_t i = 0; i < pIndex->cEntries; i++)
+    {
+        PSTAMINDEXENTRY pEntry  = &pIndex->paEntries[i];
+        const char     *pszName = &pIndex->pszNames[pEntry->offName];
+#ifdef STAM_WITH_LOOKUP_TREE
+        PSTAMDESC       pDesc   = stamR3LookupFindDesc(pUVM->stam.s.pRoot, pszName);
+#else
+        PSTAMDESC       pDesc   = NULL;
+        PSTAMDESC       pCur;
+        RTListForEach(&pUVM->stam.s.List, pCur, STAMDESC, ListEntry)
+            if (!strcmp(pCur->pszName, pszName))
+            {
+                pDesc = pCur;
+                break;
+            }
+#endif
+        /* The value layout is fixed, so a re-registration with a different
+           type is treated as if the sample is gone. */
+        if (   pDesc
+            && STAMR3GetTypeValueCount(pDesc->enmType) != STAMR3GetTypeValueCount(pEntry->enmType))
+            pDesc = NULL;
+        pEntry->pDesc = pDesc;
+    }
+    ASMAtomicWriteU32(&pIndex->iRegGen, iRegGen);
+}
+
+
+/**
+ * Compiles a sample name pattern into an index for use with
+ * STAMR3SnapshotBinary.
+ *
+ * The pattern is matched once and the resulting set of samples is fixed for
+ * the lifetime of the index, thus the value layout of the binary snapshot
+ * never changes.  Samples which are deregistered later produce zeros;
+ * samples registered later are picked up by compiling the pattern again.
+ *
+ * Compiled patterns are cached, so it is cheap to call this function for
+ * each snapshot for callers which cannot keep the handle around.
+ *
+ * @returns VBox status code.
+ * @param   pUVM            The user mode VM handle.
+ * @param   pszPat          The name matching pattern, see STAMR3Snapshot.
+ *                          NULL means all samples.
+ * @param   ppIndex         Where to return the index.  Release it by calling
+ *                          STAMR3IndexRelease.
+ */
+VMMR3DECL(int) STAMR3IndexCompile(PUVM pUVM, const char *pszPat, PSTAMINDEX *ppIndex)
+{
+    UVM_ASSERT_VALID_EXT_RETURN(pUVM, VERR_INVALID_VM_HANDLE);
+    AssertPtrReturn(ppIndex, VERR_INVALID_POINTER);
+    *ppIndex = NULL;
+    if (!pszPat || !*pszPat)
+        pszPat = "*";
+
+    /*
+     * Check the cache first.
+     */
+    STAM_LOCK_RD(pUVM);
+    uint32_t const iRegGen = pUVM->stam.s.iRegGen;
+    for (unsigned i = 0; i < RT_ELEMENTS(pUVM->stam.s.apIndexCache); i++)
+    {
+        PSTAMINDEX pIndex = pUVM->stam.s.apIndexCache[i];
+        if (   pIndex
+            && pIndex->iCompileGen == iRegGen
+            && !strcmp(pIndex->pszPattern, pszPat))
+        {
+            ASMAtomicIncU32(&pIndex->cRefs);
+            ASMAtomicWriteU32(&pIndex->uLastUsed, ASMAtomicIncU32(&pUVM->stam.s.uIndexCacheClock));
+            STAM_UNLOCK_RD(pUVM);
+            *ppIndex = pIndex;
+            return VINF_SUCCESS;
+        }
+    }
+    STAM_UNLOCK_RD(pUVM);
+
+    /*
+     * Compile it.
+     */
+    PSTAMINDEX pIndex = (PSTAMINDEX)RTMemAllocZ(sizeof(*pIndex));
+    if (!pIndex)
+        return VERR_NO_MEMORY;
+    pIndex->u32Magic   = STAMINDEX_MAGIC;
+    pIndex->cRefs      = 1;
+    pIndex->pszPattern = RTStrDup(pszPat);
+    if (!pIndex->pszPattern)
+    {
+        stamR3IndexFree(pIndex);
+        return VERR_NO_MEMORY;
+    }
+    pIndex->iRegGen     = ASMAtomicReadU32(&pUVM->stam.s.iRegGen);
+    pIndex->iCompileGen = pIndex->iRegGen;
+
+    int rc = stamR3EnumU(pUVM, pszPat, true /* fUpdateRing0 */, stamR3IndexCompileOne, pIndex);
+    if (RT_FAILURE(rc))
+    {
+        stamR3IndexFree(pIndex);
+        return rc;
+    }
+
+    /*
+     * Enter it into the cache, replacing the stalest entry.
+     */
+    STAM_LOCK_WR(pUVM);
+    unsigned       iVictim = 0;
+    uint32_t       cMaxAge = 0;
+    uint32_t const uClock  = pUVM->stam.s.uIndexCacheClock;
+    for (unsigned i = 0; i < RT_ELEMENTS(pUVM->stam.s.apIndexCache); i++)
+    {
+        PSTAMINDEX pCur = pUVM->stam.s.apIndexCache[i];
+        if (!pCur)
+        {
+            iVictim = i;
+            break;
+        }
+        if (!strcmp(pCur->pszPattern, pszPat))
+        {
+            iVictim = i;            /* same pattern, replace the outdated one. */
+            break;
+        }
+        uint32_t const cAge = uClock - pCur->uLastUsed;
+        if (cAge >= cMaxAge)
+        {
+            cMaxAge = cAge;
+            iVictim = i;
+        }
+    }
+    if (pUVM->stam.s.apIndexCache[iVictim])
+        stamR3IndexRelease(pUVM->stam.s.apIndexCache[iVictim]);
+    pIndex->cRefs++;
+    pIndex->uLastUsed = ASMAtomicIncU32(&pUVM->stam.s.uIndexCacheClock);
+    pUVM->stam.s.apIndexCache[iVictim] = pIndex;
+    STAM_UNLOCK_WR(pUVM);
+
+    *ppIndex = pIndex;
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Releases a compiled sample index.
+ *
+ * @returns VBox status code.
+ * @param   pUVM            The user mode VM handle.
+ * @param   pIndex          The index returned by STAMR3IndexCompile.  NULL is
+ *                          quietly ignored.
+ */
+VMMR3DECL(int) STAMR3IndexRelease(PUVM pUVM, PSTAMINDEX pIndex)
+{
+    UVM_ASSERT_VALID_EXT_RETURN(pUVM, VERR_INVALID_VM_HANDLE);
+    if (!pIndex)
+        return VINF_SUCCESS;
+    AssertPtrReturn(pIndex, VERR_INVALID_HANDLE);
+    AssertReturn(pIndex->u32Magic == STAMINDEX_MAGIC, VERR_INVALID_HANDLE);
+
+    stamR3IndexRelease(pIndex);
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Gets the number of samples in a compiled index.
+ *
+ * @returns Number of samples, 0 on invalid handle.
+ * @param   pIndex          The index returned by STAMR3IndexCompile.
+ */
+VMMR3DECL(uint32_t) STAMR3IndexGetSampleCount(PSTAMINDEX pIndex)
+{
+    AssertPtrReturn(pIndex, 0);
+    AssertReturn(pIndex->u32Magic == STAMINDEX_MAGIC, 0);
+    return pIndex->cEntries;
+}
+
+
+/**
+ * Gets the number of 64-bit values STAMR3SnapshotBinary produces for a
+ * compiled index.
+ *
+ * @returns Number of values, 0 on invalid handle.
+ * @param   pIndex          The index returned by STAMR3IndexCompile.
+ */
+VMMR3DECL(uint32_t) STAMR3IndexGetValueCount(PSTAMINDEX pIndex)
+{
+    AssertPtrReturn(pIndex, 0);
+    AssertReturn(pIndex->u32Magic == STAMINDEX_MAGIC, 0);
+    return pIndex->cValues;
+}
+
+
+/**
+ * Queries the details of a sample in a compiled index, for decoding binary
+ * snapshots.
+ *
+ * @returns VBox status code.
+ * @retval  VERR_OUT_OF_RANGE if @a iSample is out of range.
+ * @param   pIndex          The index returned by STAMR3IndexCompile.
+ * @param   iSample         The sample number.
+ * @param   ppszName        Where to return the sample name.  Valid while the
+ *                          index is.  Optional.
+ * @param   penmType        Where to return the sample type.  Optional.
+ * @param   penmUnit        Where to return the sample unit.  Optional.
+ * @param   piValue         Where to return the index of the first value.
+ *                          Optional.
+ * @param   pcValues        Where to return the number of values.  Optional.
+ */
+VMMR3DECL(int) STAMR3IndexQuerySample(PSTAMINDEX pIndex, uint32_t iSample, const char **ppszName, STAMTYPE *penmType,
+                                      STAMUNIT *penmUnit, uint32_t *piValue, uint32_t *pcValues)
+{
+    AssertPtrReturn(pIndex, VERR_INVALID_HANDLE);
+    AssertReturn(pIndex->u32Magic == STAMINDEX_MAGIC, VERR_INVALID_HANDLE);
+    AssertReturn(iSample < pIndex->cEntries, VERR_OUT_OF_RANGE);
+
+    PSTAMINDEXENTRY pEntry = &pIndex->paEntries[iSample];
+    if (ppszName)
+        *ppszName = &pIndex->pszNames[pEntry->offName];
+    if (penmType)
+        *penmType = pEntry->enmType;
+    if (penmUnit)
+        *penmUnit = pEntry->enmUnit;
+    if (piValue)
+        *piValue  = pEntry->iValue;
+    if (pcValues)
+        *pcValues = STAMR3GetTypeValueCount(pEntry->enmType);
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Worker for STAMR3SnapshotBinary and STAMR3ExportUpdate.
+ *
+ * @param   pUVM            Pointer to the user mode VM structure.
+ * @param   pIndex          The index.
+ * @param   pau64Values     Where to store the values (pIndex->cValues).
+ */
+static void stamR3SnapshotBinaryU(PUVM pUVM, PSTAMINDEX pIndex, uint64_t *pau64Values)
+{
+    if (pIndex->fRing0Gvmm)
+        stamR3Ring0StatsUpdateU(pUVM, "/GVMM/*");
+    if (pIndex->fRing0Gmm)
+        stamR3Ring0StatsUpdateU(pUVM, "/GMM/*");
+
+    /*
+     * The common case is that nothing has been (de)registered since the
+     * index was resolved, so the read lock suffices.  Otherwise we must
+     * re-resolve the names first, which requires exclusive access to the
+     * index and thus the write lock.
+     */
+    bool fWrite = false;
+    STAM_LOCK_RD(pUVM);
+    if (RT_UNLIKELY(pIndex->iRegGen != pUVM->stam.s.iRegGen))
+    {
+        STAM_UNLOCK_RD(pUVM);
+        STAM_LOCK_WR(pUVM);
+        fWrite = true;
+        if (pIndex->iRegGen != pUVM->stam.s.iRegGen)
+            stamR3IndexRefresh(pUVM, pIndex);
+    }
+
+    PSTAMINDEXENTRY pEntry = pIndex->paEntries;
+    for (uint32_t i = 0; i < pIndex->cEntries; i++, pEntry++)
+        stamR3IndexReadOne(pEntry->pDesc, STAMR3GetTypeValueCount(pEntry->enmType), &pau64Values[pEntry->iValue]);
+
+    if (fWrite)
+        STAM_UNLOCK_WR(pUVM);
+    else
+        STAM_UNLOCK_RD(pUVM);
+}
+
+
+/**
+ * Takes a binary snapshot of the samples in a compiled index.
+ *
+ * This is a much cheaper alternative to STAMR3Snapshot for frequent polling,
+ * as no pattern matching nor any formatting takes place.  The value layout
+ * is described by STAMR3IndexQuerySample and STAMR3GetTypeValueCount.
+ *
+ * @returns VBox status code.
+ * @retval  VERR_BUFFER_OVERFLOW if @a cValues is too small.
+ * @param   pUVM            The user mode VM handle.
+ * @param   pIndex          The index returned by STAMR3IndexCompile.
+ * @param   pau64Values     Where to store the values.
+ * @param   cValues         The size of the buffer in values, see
+ *                          STAMR3IndexGetValueCount.
+ */
+VMMR3DECL(int) STAMR3SnapshotBinary(PUVM pUVM, PSTAMINDEX pIndex, uint64_t *pau64Values, uint32_t cValues)
+{
+    UVM_ASSERT_VALID_EXT_RETURN(pUVM, VERR_INVALID_VM_HANDLE);
+    AssertPtrReturn(pIndex, VERR_INVALID_HANDLE);
+    AssertReturn(pIndex->u32Magic == STAMINDEX_MAGIC, VERR_INVALID_HANDLE);
+    AssertPtrReturn(pau64Values, VERR_INVALID_POINTER);
+    if (cValues < pIndex->cValues)
+        return VERR_BUFFER_OVERFLOW;
+
+    stamR3SnapshotBinaryU(pUVM, pIndex, pau64Values);
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Creates a shared memory export of the samples matching a pattern.
+ *
+ * The export area (see STAMEXPORTHDR for the layout and the lock-free reader
+ * protocol) is filled with an initial snapshot; call STAMR3ExportUpdate
+ * whenever the values should be refreshed.
+ *
+ * @returns VBox status code.
+ * @param   pUVM            The user mode VM handle.
+ * @param   pszPat          The name matching pattern, see STAMR3Snapshot.
+ *                          NULL means all samples.
+ * @param   pszFile         The file to map the area from so that other
+ *                          processes can map it too, e.g. something under
+ *                          /dev/shm/.  The file is created or truncated.
+ *                          On Windows the file is mapped as a section, so
+ *                          readers map it with CreateFileMapping too.
+ *                          When NULL the area is only accessible in this
+ *                          process, see STAMR3ExportGetArea.
+ * @param   ppExport        Where to return the export handle.
+ */
+VMMR3DECL(int) STAMR3ExportCreate(PUVM pUVM, const char *pszPat, const char *pszFile, PSTAMEXPORT *ppExport)
+{
+    UVM_ASSERT_VALID_EXT_RETURN(pUVM, VERR_INVALID_VM_HANDLE);
+    AssertPtrReturn(ppExport, VERR_INVALID_POINTER);
+    AssertPtrNullReturn(pszFile, VERR_INVALID_POINTER);
+    *ppExport = NULL;
+
+    PSTAMEXPORT pThis = (PSTAMEXPORT)RTMemAllocZ(sizeof(*pThis));
+    if (!pThis)
+        return VERR_NO_MEMORY;
+    int rc = STAMR3IndexCompile(pUVM, pszPat, &pThis->pIndex);
+    if (RT_FAILURE(rc))
+    {
+        RTMemFree(pThis);
+        return rc;
+    }
+    PSTAMINDEX pIndex = pThis->pIndex;
+
+    /*
+     * Work out the layout and allocate the area.
+     */
+    uint32_t const offSamples = sizeof(STAMEXPORTHDR);
+    uint32_t const offNames   = offSamples + pIndex->cEntries * sizeof(STAMEXPORTSAMPLE);
+    uint32_t const offValues  = RT_ALIGN_32(offNames + pIndex->cbNames, 64);
+    uint32_t const cbArea     = offValues + pIndex->cValues * sizeof(uint64_t);
+    pThis->cbMapping = RT_ALIGN_Z(cbArea, PAGE_SIZE);
+
+    if (pszFile)
+    {
+        RTFILE hFile;
+        rc = RTFileOpen(&hFile, pszFile, RTFILE_O_READWRITE | RTFILE_O_CREATE_REPLACE | RTFILE_O_DENY_NONE
+                                         | (0644 << RTFILE_O_CREATE_MODE_SHIFT));
+        if (RT_SUCCESS(rc))
+        {
+            rc = RTFileSetSize(hFile, pThis->cbMapping);
+            if (RT_SUCCESS(rc))
+            {
+#ifdef RT_OS_WINDOWS
+                /* The view keeps the section alive, so the handle can go right away. */
+                HANDLE hSection = CreateFileMappingW((HANDLE)RTFileToNative(hFile), NULL, PAGE_READWRITE, 0, 0, NULL);
+                if (hSection)
+                {
+                    void *pv = MapViewOfFile(hSection, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, pThis->cbMapping);
+                    if (pv)
+                    {
+                        pThis->pHdr    = (PSTAMEXPORTHDR)pv;
+                        pThis->fMapped = true;
+                    }
+                    else
+                        rc = RTErrConvertFromWin32(GetLastError());
+                    CloseHandle(hSection);
+                }
+                else
+                    rc = RTErrConvertFromWin32(GetLastError());
+#else
+                void *pv = mmap(NULL, pThis->cbMapping, PROT_READ | PROT_WRITE, MAP_SHARED, (int)RTFileToNative(hFile), 0);
+                if (pv != MAP_FAILED)
+                {
+                    pThis->pHdr    = (PSTAMEXPORTHDR)pv;
+                    pThis->fMapped = true;
+                }
+                else
+                    rc = RTErrConvertFromErrno(errno);
+#endif
+            }
+            RTFileClose(hFile);
+        }
+        if (RT_FAILURE(rc))
+            LogRel(("STAM: Failed to map export file '%s': %Rrc\n", pszFile, rc));
+    }
+    else
+    {
+        pThis->pHdr = (PSTAMEXPORTHDR)RTMemPageAllocZ(pThis->cbMapping);
+        if (!pThis->pHdr)
+            rc = VERR_NO_PAGE_MEMORY;
+    }
+    if (RT_FAILURE(rc))
+    {
+        stamR3IndexRelease(pIndex);
+        RTMemFree(pThis);
+        return rc;
+    }
+
+    /*
+     * Fill in the static parts.
+     */
+    PSTAMEXPORTHDR pHdr = pThis->pHdr;
+    RT_BZERO(pHdr, offValues);
+    pHdr->u32Version = STAMEXPORTHDR_VERSION;
+    pHdr->cbArea     = cbArea;
+    pHdr->cSamples   = pIndex->cEntries;
+    pHdr->cValues    = pIndex->cValues;
+    pHdr->offSamples = offSamples;
+    pHdr->offNames   = offNames;
+    pHdr->offValues  = offValues;
+
+    STAMEXPORTSAMPLE *paSamples = (STAMEXPORTSAMPLE *)((uint8_t *)pHdr + offSamples);
+    for (uint32_t i = 0; i < pIndex->cEntries; i++)
+    {
+        paSamples[i].offName = pIndex->paEntries[i].offName;
+        paSamples[i].iValue  = pIndex->paEntries[i].iValue;
+        paSamples[i].enmType = (uint8_t)pIndex->paEntries[i].enmType;
+        paSamples[i].enmUnit = (uint8_t)pIndex->paEntries[i].enmUnit;
+        paSamples[i].cValues = (uint16_t)STAMR3GetTypeValueCount(pIndex->paEntries[i].enmType);
+    }
+    memcpy((uint8_t *)pHdr + offNames, pIndex->pszNames, pIndex->cbNames);
+
+    pThis->u32Magic = STAMEXPORT_MAGIC;
+    STAMR3ExportUpdate(pUVM, pThis);
+
+    /* Publish the magic last so readers know the layout is complete. */
+    ASMAtomicWriteU32(&pHdr->u32Magic, STAMEXPORTHDR_MAGIC);
+
+    *ppExport = pThis;
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Refreshes the values in a shared memory export.
+ *
+ * Only one thread may update a given export at any time.
+ *
+ * @returns VBox status code.
+ * @param   pUVM            The user mode VM handle.
+ * @param   pExport         The export handle.
+ */
+VMMR3DECL(int) STAMR3ExportUpdate(PUVM pUVM, PSTAMEXPORT pExport)
+{
+    UVM_ASSERT_VALID_EXT_RETURN(pUVM, VERR_INVALID_VM_HANDLE);
+    AssertPtrReturn(pExport, VERR_INVALID_HANDLE);
+    AssertReturn(pExport->u32Magic == STAMEXPORT_MAGIC, VERR_INVALID_HANDLE);
+    PSTAMEXPORTHDR pHdr = pExport->pHdr;
+
+    ASMAtomicIncU32(&pHdr->uSeq);   /* odd: update in progress */
+    stamR3SnapshotBinaryU(pUVM, pExport->pIndex, (uint64_t *)((uint8_t *)pHdr + pHdr->offValues));
+    ASMAtomicWriteU64(&pHdr->u64NanoTS, RTTimeNanoTS());
+    ASMAtomicIncU32(&pHdr->uSeq);   /* even: consistent */
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Gets the shared memory export area.
+ *
+ * @returns Pointer to the export area header, NULL on invalid handle.
+ * @param   pExport         The export handle.
+ * @param   pcbArea         Where to return the size of the mapping.  Optional.
+ */
+VMMR3DECL(PCSTAMEXPORTHDR) STAMR3ExportGetArea(PSTAMEXPORT pExport, size_t *pcbArea)
+{
+    AssertPtrReturn(pExport, NULL);
+    AssertReturn(pExport->u32Magic == STAMEXPORT_MAGIC, NULL);
+    if (pcbArea)
+        *pcbArea = pExport->cbMapping;
+    return pExport->pHdr;
+}
+
+
+/**
+ * Destroys a shared memory export.
+ *
+ * The backing file, if any, is left behind with the magic cleared so that
+ * readers notice it is no longer being updated.
+ *
+ * @returns VBox status code.
+ * @param   pUVM            The user mode VM handle.
+ * @param   pExport         The export handle.  NULL is quietly ignored.
+ */
+VMMR3DECL(int) STAMR3ExportDestroy(PUVM pUVM, PSTAMEXPORT pExport)
+{
+    UVM_ASSERT_VALID_EXT_RETURN(pUVM, VERR_INVALID_VM_HANDLE);
+    if (!pExport)
+        return VINF_SUCCESS;
+    AssertPtrReturn(pExport, VERR_INVALID_HANDLE);
+    AssertReturn(pExport->u32Magic == STAMEXPORT_MAGIC, VERR_INVALID_HANDLE);
+    pExport->u32Magic = STAMEXPORT_MAGIC_DEAD;
+
+    ASMAtomicWriteU32(&pExport->pHdr->u32Magic, ~STAMEXPORTHDR_MAGIC);
+    if (pExport->fMapped)
+#ifdef RT_OS_WINDOWS
+        UnmapViewOfFile(pExport->pHdr);
+#else
+        munmap(pExport->pHdr, pExport->cbMapping);
+#endif
+    else
+        RTMemPageFree(pExport->pHdr, pExport->cbMapping);
+    stamR3IndexRelease(pExport->pIndex);
+    RTMemFree(pExport);
+    return VINF_SUCCESS;
+}
+
 #ifdef VBOX_WITH_DEBUGGER
 
 /**
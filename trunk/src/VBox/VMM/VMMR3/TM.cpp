@@ -105,6 +105,15 @@
  *    - Poll the virtual clocks and calculate first timeout from the halt loop.
  *    - Employ a thread which periodically (100Hz) polls all the timer queues.
  *
+ * Timers created with TMTIMER_FLAGS_NO_EMT don't go on the queues above but on
+ * a separate set of TMCLOCK_VIRTUAL and TMCLOCK_REAL queues which are run by a
+ * small process wide pool of timer threads (see /TM/TimerThreads).  Each of
+ * these queues is serialized by its own critical section instead of the TM
+ * lock, so these timers neither need to wait for an EMT to get around to them
+ * nor hold up the EMTs while their callbacks execute.  The delivery latency
+ * and jitter of both kinds of queues are collected in the /TM/Latency/ and
+ * /TM/Jitter/ release statistics.
+ *
  *
  * @image html TMTIMER-Statechart-Diagram.gif
  *
@@ -153,6 +162,8 @@
 #include <iprt/semaphore.h>
 #include <iprt/string.h>
 #include <iprt/env.h>
+#include <iprt/once.h>
+#include <iprt/list.h>
 
 #include "TMInline.h"
 
@@ -164,6 +175,61 @@
 #define TM_SAVED_STATE_VERSION  3
 
 
+/*********************************************************************************************************************************
+*   Structures and Typedefs                                                                                                      *
+*********************************************************************************************************************************/
+/**
+ * The timer thread pool.
+ *
+ * There is one of these per process, servicing the thread pool queues of all
+ * the VMs in it.
+ */
+typedef struct TMTIMERPOOL
+{
+    /** Protects the queue list and the user count. */
+    RTCRITSECT          CritSect;
+    /** Serializes attaching and detaching VMs, i.e. creating and terminating
+     * the threads.  The pool threads never take this. */
+    RTSEMFASTMUTEX      hMtxAttach;
+    /** Event semaphore the idle pool threads wait on. */
+    RTSEMEVENT          hEvtWakeUp;
+    /** List of the queues serviced by the pool (TMTIMERQUEUER3). */
+    RTLISTANCHOR        QueueList;
+    /** The number of VMs using the pool. */
+    uint32_t            cUsers;
+    /** The number of threads in the pool (hMtxAttach). */
+    uint32_t            cThreads;
+    /** Set when the threads should terminate. */
+    bool volatile       fTerminate;
+    /** The pool thread handles. */
+    RTTHREAD            ahThreads[TM_TIMER_POOL_MAX_THREADS];
+} TMTIMERPOOL;
+
+
+/*********************************************************************************************************************************
+*   Global Variables                                                                                                             *
+*********************************************************************************************************************************/
+/** Initialize the timer pool once. */
+static RTONCE           g_TimerPoolOnce = RTONCE_INITIALIZER;
+/** The timer thread pool. */
+static TMTIMERPOOL      g_TimerPool;
+
+/** The upper bounds (ns) of the timer latency and jitter histogram buckets.
+ * The last bucket takes what's left. */
+static const uint64_t   g_acNsLatencyBuckets[TM_LATENCY_BUCKETS - 1] =
+{
+    RT_NS_1US,      2 * RT_NS_1US,  5 * RT_NS_1US,  10 * RT_NS_1US,  20 * RT_NS_1US, 50 * RT_NS_1US,
+    100 * RT_NS_1US, 200 * RT_NS_1US, 500 * RT_NS_1US,
+    RT_NS_1MS,      2 * RT_NS_1MS,  5 * RT_NS_1MS,  10 * RT_NS_1MS,  20 * RT_NS_1MS, 50 * RT_NS_1MS
+};
+/** The statistics names of the histogram buckets. */
+static const char * const g_apszLatencyBuckets[TM_LATENCY_BUCKETS] =
+{
+    "lt1us", "lt2us", "lt5us", "lt10us", "lt20us", "lt50us", "lt100us", "lt200us", "lt500us",
+    "lt1ms", "lt2ms", "lt5ms", "lt10ms", "lt20ms", "lt50ms", "ge50ms"
+};
+
+
 /*********************************************************************************************************************************
 *   Internal Functions                                                                                                           *
 *********************************************************************************************************************************/
@@ -173,6 +239,8 @@ static DECLCALLBACK(int)    tmR3Save(PVM pVM, PSSMHANDLE pSSM);
 static DECLCALLBACK(int)    tmR3Load(PVM pVM, PSSMHANDLE pSSM, uint32_t uVersion, uint32_t uPass);
 static DECLCALLBACK(void)   tmR3TimerCallback(PRTTIMER pTimer, void *pvUser, uint64_t iTick);
 static void                 tmR3TimerQueueRun(PVM pVM, PTMTIMERQUEUE pQueue);
+static int                  tmR3TimerPoolAttach(PVM pVM);
+static void                 tmR3TimerPoolDetach(PVM pVM);
 static void                 tmR3TimerQueueRunVirtualSync(PVM pVM);
 static DECLCALLBACK(int)    tmR3SetWarpDrive(PUVM pUVM, uint32_t u32Percent);
 #ifndef VBOX_WITHOUT_NS_ACCOUNTING
@@ -208,7 +276,7 @@ VMM_INT_DECL(int) TMR3Init(PVM pVM)
      * Init the structure.
      */
     void *pv;
-    int rc = MMHyperAlloc(pVM, sizeof(pVM->tm.s.paTimerQueuesR3[0]) * TMCLOCK_MAX, 0, MM_TAG_TM, &pv);
+    int rc = MMHyperAlloc(pVM, sizeof(pVM->tm.s.paTimerQueuesR3[0]) * TMTIMERQUEUE_IDX_COUNT, 0, MM_TAG_TM, &pv);
     AssertRCReturn(rc, rc);
     pVM->tm.s.paTimerQueuesR3 = (PTMTIMERQUEUE)pv;
     pVM->tm.s.paTimerQueuesR0 = MMHyperR3ToR0(pVM, pv);
@@ -224,6 +292,31 @@ VMM_INT_DECL(int) TMR3Init(PVM pVM)
     pVM->tm.s.paTimerQueuesR3[TMCLOCK_REAL].u64Expire          = INT64_MAX;
     pVM->tm.s.paTimerQueuesR3[TMCLOCK_TSC].enmClock            = TMCLOCK_TSC;
     pVM->tm.s.paTimerQueuesR3[TMCLOCK_TSC].u64Expire           = INT64_MAX;
+    pVM->tm.s.paTimerQueuesR3[TMTIMERQUEUE_IDX_POOL_VIRTUAL].enmClock  = TMCLOCK_VIRTUAL;
+    pVM->tm.s.paTimerQueuesR3[TMTIMERQUEUE_IDX_POOL_VIRTUAL].u64Expire = INT64_MAX;
+    pVM->tm.s.paTimerQueuesR3[TMTIMERQUEUE_IDX_POOL_REAL].enmClock     = TMCLOCK_REAL;
+    pVM->tm.s.paTimerQueuesR3[TMTIMERQUEUE_IDX_POOL_REAL].u64Expire    = INT64_MAX;
+
+    static const char * const s_apszQueueNames[TMTIMERQUEUE_IDX_COUNT] =
+    { "Virtual", "VirtualSync", "Real", "TSC", "PoolVirtual", "PoolReal" };
+    AssertCompile(TMCLOCK_MAX == 4);
+    pVM->tm.s.paTimerQueuesR3Data = (PTMTIMERQUEUER3)MMR3HeapAllocZ(pVM, MM_TAG_TM,
+                                                                    sizeof(TMTIMERQUEUER3) * TMTIMERQUEUE_IDX_COUNT);
+    AssertReturn(pVM->tm.s.paTimerQueuesR3Data, VERR_NO_MEMORY);
+    for (uint32_t i = 0; i < TMTIMERQUEUE_IDX_COUNT; i++)
+    {
+        PTMTIMERQUEUER3 pQueueR3 = &pVM->tm.s.paTimerQueuesR3Data[i];
+        pVM->tm.s.paTimerQueuesR3[i].idxQueue = i;
+        pQueueR3->pVM     = pVM;
+        pQueueR3->pQueue  = &pVM->tm.s.paTimerQueuesR3[i];
+        pQueueR3->pszName = s_apszQueueNames[i];
+        if (TMTIMERQUEUE_IDX_IS_POOL(i))
+        {
+            rc = RTCritSectInitEx(&pQueueR3->CritSect, 0 /*fFlags*/, NIL_RTLOCKVALCLASS, RTLOCKVAL_SUB_CLASS_NONE,
+                                  "TM%s", s_apszQueueNames[i]);
+            AssertRCReturn(rc, rc);
+        }
+    }
 
 
     /*
@@ -353,7 +446,8 @@ VMM_INT_DECL(int) TMR3Init(PVM pVM)
                               "HostHzFudgeFactorCatchUp100|"
                               "HostHzFudgeFactorCatchUp200|"
                               "HostHzFudgeFactorCatchUp400|"
-                              "TimerMillies",
+                              "TimerMillies|"
+                              "TimerThreads",
                               "",
                               "TM", 0);
     if (RT_FAILURE(rc))
@@ -629,6 +723,17 @@ VMM_INT_DECL(int) TMR3Init(PVM pVM)
     Log(("TM: Created timer %p firing every %d milliseconds\n", pVM->tm.s.pTimer, u32Millies));
     pVM->tm.s.u32TimerMillies = u32Millies;
 
+    /** @cfgm{/TM/TimerThreads, uint32_t, 0, 16, 2}
+     * The number of timer pool threads this VM wants for running the timers
+     * created with TMTIMER_FLAGS_NO_EMT.  The pool is shared by all VMs in the
+     * process and sized by the largest request.  0 disables the pool for this
+     * VM, running these timers on EMT like all the others. */
+    rc = CFGMR3QueryU32Def(pCfgHandle, "TimerThreads", &pVM->tm.s.cTimerPoolThreads, 2);
+    AssertLogRelRCReturn(rc, rc);
+    if (pVM->tm.s.cTimerPoolThreads > TM_TIMER_POOL_MAX_THREADS)
+        return VMSetError(pVM, VERR_OUT_OF_RANGE, RT_SRC_POS,
+                          N_("Configuration error: \"TimerThreads\" is out of range (max %u)"), TM_TIMER_POOL_MAX_THREADS);
+
     /*
      * Register saved state.
      */
@@ -651,6 +756,23 @@ VMM_INT_DECL(int) TMR3Init(PVM pVM)
     STAM_REL_REG(     pVM,(void*)&pVM->tm.s.offVirtualSync,               STAMTYPE_U64, "/TM/VirtualSync/CurrentOffset",               STAMUNIT_NS, "The current offset. (subtract GivenUp to get the lag)");
     STAM_REL_REG_USED(pVM,(void*)&pVM->tm.s.offVirtualSyncGivenUp,        STAMTYPE_U64, "/TM/VirtualSync/GivenUp",                     STAMUNIT_NS, "Nanoseconds of the 'CurrentOffset' that's been given up and won't ever be attempted caught up with.");
     STAM_REL_REG(     pVM,(void*)&pVM->tm.s.uMaxHzHint,                   STAMTYPE_U32, "/TM/MaxHzHint",                               STAMUNIT_HZ, "Max guest timer frequency hint.");
+    static const uint8_t s_aidxHistQueues[] = { TMCLOCK_VIRTUAL, TMCLOCK_REAL, TMTIMERQUEUE_IDX_POOL_VIRTUAL, TMTIMERQUEUE_IDX_POOL_REAL };
+    for (unsigned i = 0; i < RT_ELEMENTS(s_aidxHistQueues); i++)
+    {
+        PTMTIMERQUEUER3 pQueueR3 = &pVM->tm.s.paTimerQueuesR3Data[s_aidxHistQueues[i]];
+        for (unsigned iBucket = 0; iBucket < TM_LATENCY_BUCKETS; iBucket++)
+        {
+            STAMR3RegisterF(pVM, &pQueueR3->aStatLatency[iBucket], STAMTYPE_COUNTER, STAMVISIBILITY_USED, STAMUNIT_OCCURENCES,
+                            "Timer callbacks delivered this long after the expire time.",
+                            "/TM/Latency/%s/%s", pQueueR3->pszName, g_apszLatencyBuckets[iBucket]);
+            STAMR3RegisterF(pVM, &pQueueR3->aStatJitter[iBucket],  STAMTYPE_COUNTER, STAMVISIBILITY_USED, STAMUNIT_OCCURENCES,
+                            "Latency change between two consecutive timer callbacks on the queue.",
+                            "/TM/Jitter/%s/%s", pQueueR3->pszName, g_apszLatencyBuckets[iBucket]);
+        }
+        if (TMTIMERQUEUE_IDX_IS_POOL(s_aidxHistQueues[i]))
+            STAMR3RegisterF(pVM, &pQueueR3->StatPoolRun, STAMTYPE_PROFILE, STAMVISIBILITY_USED, STAMUNIT_TICKS_PER_CALL,
+                            "Running the queue on a timer pool thread.", "/TM/Pool/%s/Run", pQueueR3->pszName);
+    }
 
 #ifdef VBOX_WITH_STATISTICS
     STAM_REG_USED(pVM,(void *)&pVM->tm.s.VirtualGetRawDataR3.cExpired,    STAMTYPE_U32, "/TM/R3/cExpired",                     STAMUNIT_OCCURENCES, "Times the TSC interval expired (overlaps 1ns steps).");
@@ -1052,6 +1174,12 @@ VMM_INT_DECL(int) TMR3InitFinalize(PVM pVM)
      */
     pVM->tm.s.fTSCModeSwitchAllowed &= tmR3HasFixedTSC(pVM) && GIMIsEnabled(pVM) && HMIsEnabled(pVM);
     LogRel(("TM: TMR3InitFinalize: fTSCModeSwitchAllowed=%RTbool\n", pVM->tm.s.fTSCModeSwitchAllowed));
+
+    /*
+     * Hand the thread pool queues to the timer threads.
+     */
+    if (RT_SUCCESS(rc) && pVM->tm.s.cTimerPoolThreads)
+        rc = tmR3TimerPoolAttach(pVM);
     return rc;
 }
 
@@ -1111,6 +1239,18 @@ VMM_INT_DECL(int) TMR3Term(PVM pVM)
         pVM->tm.s.pTimer = NULL;
     }
 
+    /*
+     * Take the thread pool queues back from the timer threads.  Any timers
+     * still on them are destroyed later on by PDM, on EMT, so the queue locks
+     * can go now.
+     */
+    if (pVM->tm.s.paTimerQueuesR3Data)
+    {
+        tmR3TimerPoolDetach(pVM);
+        for (uint32_t i = TMTIMERQUEUE_IDX_POOL_VIRTUAL; i < TMTIMERQUEUE_IDX_COUNT; i++)
+            RTCritSectDelete(&pVM->tm.s.paTimerQueuesR3Data[i].CritSect);
+    }
+
     return VINF_SUCCESS;
 }
 
@@ -1153,10 +1293,18 @@ VMM_INT_DECL(void) TMR3Reset(PVM pVM)
     }
 
     /*
-     * Process the queues.
+     * Process the queues.  The thread pool ones are protected by their own
+     * locks, which nest inside the TM lock.
      */
     for (int i = 0; i < TMCLOCK_MAX; i++)
         tmTimerQueueSchedule(pVM, &pVM->tm.s.paTimerQueuesR3[i]);
+    for (uint32_t i = TMTIMERQUEUE_IDX_POOL_VIRTUAL; i < TMTIMERQUEUE_IDX_COUNT; i++)
+    {
+        PTMTIMERQUEUER3 pQueueR3 = &pVM->tm.s.paTimerQueuesR3Data[i];
+        RTCritSectEnter(&pQueueR3->CritSect);
+        tmTimerQueueSchedule(pVM, pQueueR3->pQueue);
+        RTCritSectLeave(&pQueueR3->CritSect);
+    }
 #ifdef VBOX_STRICT
     tmTimerQueuesSanityChecks(pVM, "TMR3Reset");
 #endif
@@ -1401,12 +1549,16 @@ static DECLCALLBACK(int) tmR3Load(PVM pVM, PSSMHANDLE pSSM, uint32_t uVersion, u
  * @returns VBox status code.
  * @param   pVM         The cross context VM structure.
  * @param   enmClock    The timer clock.
+ * @param   fFlags      Timer creation flags, see grp_tm_timer_flags.
  * @param   pszDesc     The timer description.
  * @param   ppTimer     Where to store the timer pointer on success.
  */
-static int tmr3TimerCreate(PVM pVM, TMCLOCK enmClock, const char *pszDesc, PPTMTIMERR3 ppTimer)
+static int tmr3TimerCreate(PVM pVM, TMCLOCK enmClock, uint32_t fFlags, const char *pszDesc, PPTMTIMERR3 ppTimer)
 {
     VM_ASSERT_EMT(pVM);
+    AssertReturn(   !(fFlags & TMTIMER_FLAGS_NO_EMT)
+                 || enmClock == TMCLOCK_VIRTUAL
+                 || enmClock == TMCLOCK_REAL, VERR_INVALID_PARAMETER);
 
     /*
      * Allocate the timer.
@@ -1439,6 +1591,12 @@ static int tmr3TimerCreate(PVM pVM, TMCLOCK enmClock, const char *pszDesc, PPTMT
     pTimer->offScheduleNext = 0;
     pTimer->offNext         = 0;
     pTimer->offPrev         = 0;
+    pTimer->offChild        = 0;
+    pTimer->uRunGen         = 0;
+    pTimer->idxQueue        = enmClock;
+    if ((fFlags & TMTIMER_FLAGS_NO_EMT) && pVM->tm.s.cTimerPoolThreads)
+        pTimer->idxQueue    = enmClock == TMCLOCK_VIRTUAL ? TMTIMERQUEUE_IDX_POOL_VIRTUAL : TMTIMERQUEUE_IDX_POOL_REAL;
+    pTimer->fFlags          = fFlags;
     pTimer->pvUser          = NULL;
     pTimer->pCritSect       = NULL;
     pTimer->pszDesc         = pszDesc;
@@ -1478,12 +1636,12 @@ VMM_INT_DECL(int) TMR3TimerCreateDevice(PVM pVM, PPDMDEVINS pDevIns, TMCLOCK enm
                                         PFNTMTIMERDEV pfnCallback, void *pvUser,
                                         uint32_t fFlags, const char *pszDesc, PPTMTIMERR3 ppTimer)
 {
-    AssertReturn(!(fFlags & ~(TMTIMER_FLAGS_NO_CRIT_SECT)), VERR_INVALID_PARAMETER);
+    AssertReturn(!(fFlags & ~(TMTIMER_FLAGS_NO_CRIT_SECT | TMTIMER_FLAGS_NO_EMT)), VERR_INVALID_PARAMETER);
 
     /*
      * Allocate and init stuff.
      */
-    int rc = tmr3TimerCreate(pVM, enmClock, pszDesc, ppTimer);
+    int rc = tmr3TimerCreate(pVM, enmClock, fFlags, pszDesc, ppTimer);
     if (RT_SUCCESS(rc))
     {
         (*ppTimer)->enmType         = TMTIMERTYPE_DEV;
@@ -1519,12 +1677,12 @@ VMM_INT_DECL(int) TMR3TimerCreateUsb(PVM pVM, PPDMUSBINS pUsbIns, TMCLOCK enmClo
                                      PFNTMTIMERUSB pfnCallback, void *pvUser,
                                      uint32_t fFlags, const char *pszDesc, PPTMTIMERR3 ppTimer)
 {
-    AssertReturn(!(fFlags & ~(TMTIMER_FLAGS_NO_CRIT_SECT)), VERR_INVALID_PARAMETER);
+    AssertReturn(!(fFlags & ~(TMTIMER_FLAGS_NO_CRIT_SECT | TMTIMER_FLAGS_NO_EMT)), VERR_INVALID_PARAMETER);
 
     /*
      * Allocate and init stuff.
      */
-    int rc = tmr3TimerCreate(pVM, enmClock, pszDesc, ppTimer);
+    int rc = tmr3TimerCreate(pVM, enmClock, fFlags, pszDesc, ppTimer);
     if (RT_SUCCESS(rc))
     {
         (*ppTimer)->enmType         = TMTIMERTYPE_USB;
@@ -1562,12 +1720,12 @@ VMM_INT_DECL(int) TMR3TimerCreateUsb(PVM pVM, PPDMUSBINS pUsbIns, TMCLOCK enmClo
 VMM_INT_DECL(int) TMR3TimerCreateDriver(PVM pVM, PPDMDRVINS pDrvIns, TMCLOCK enmClock, PFNTMTIMERDRV pfnCallback, void *pvUser,
                                         uint32_t fFlags, const char *pszDesc, PPTMTIMERR3 ppTimer)
 {
-    AssertReturn(!(fFlags & ~(TMTIMER_FLAGS_NO_CRIT_SECT)), VERR_INVALID_PARAMETER);
+    AssertReturn(!(fFlags & ~(TMTIMER_FLAGS_NO_CRIT_SECT | TMTIMER_FLAGS_NO_EMT)), VERR_INVALID_PARAMETER);
 
     /*
      * Allocate and init stuff.
      */
-    int rc = tmr3TimerCreate(pVM, enmClock, pszDesc, ppTimer);
+    int rc = tmr3TimerCreate(pVM, enmClock, fFlags, pszDesc, ppTimer);
     if (RT_SUCCESS(rc))
     {
         (*ppTimer)->enmType         = TMTIMERTYPE_DRV;
@@ -1599,7 +1757,7 @@ VMMR3DECL(int) TMR3TimerCreateInternal(PVM pVM, TMCLOCK enmClock, PFNTMTIMERINT
      * Allocate and init  stuff.
      */
     PTMTIMER pTimer;
-    int rc = tmr3TimerCreate(pVM, enmClock, pszDesc, &pTimer);
+    int rc = tmr3TimerCreate(pVM, enmClock, 0 /*fFlags*/, pszDesc, &pTimer);
     if (RT_SUCCESS(rc))
     {
         pTimer->enmType             = TMTIMERTYPE_INTERNAL;
@@ -1630,7 +1788,7 @@ VMMR3DECL(PTMTIMERR3) TMR3TimerCreateExternal(PVM pVM, TMCLOCK enmClock, PFNTMTI
      * Allocate and init stuff.
      */
     PTMTIMERR3 pTimer;
-    int rc = tmr3TimerCreate(pVM, enmClock, pszDesc, &pTimer);
+    int rc = tmr3TimerCreate(pVM, enmClock, 0 /*fFlags*/, pszDesc, &pTimer);
     if (RT_SUCCESS(rc))
     {
         pTimer->enmType             = TMTIMERTYPE_EXTERNAL;
@@ -1645,23 +1803,20 @@ VMMR3DECL(PTMTIMERR3) TMR3TimerCreateExternal(PVM pVM, TMCLOCK enmClock, PFNTMTI
 
 
 /**
- * Destroy a timer
+ * Worker for TMR3TimerDestroy.
  *
  * @returns VBox status code.
- * @param   pTimer          Timer handle as returned by one of the create functions.
+ * @param   pTimer          The timer, not NULL.
+ *
+ * @remarks Called with the queue lock held for thread pool timers.
  */
-VMMR3DECL(int) TMR3TimerDestroy(PTMTIMER pTimer)
+static int tmR3TimerDestroy(PTMTIMER pTimer)
 {
-    /*
-     * Be extra careful here.
-     */
-    if (!pTimer)
-        return VINF_SUCCESS;
-    AssertPtr(pTimer);
     Assert((unsigned)pTimer->enmClock < (unsigned)TMCLOCK_MAX);
+    Assert(pTimer->idxQueue < (unsigned)TMTIMERQUEUE_IDX_COUNT);
 
     PVM             pVM      = pTimer->CTX_SUFF(pVM);
-    PTMTIMERQUEUE   pQueue   = &pVM->tm.s.CTX_SUFF(paTimerQueues)[pTimer->enmClock];
+    PTMTIMERQUEUE   pQueue   = &pVM->tm.s.CTX_SUFF(paTimerQueues)[pTimer->idxQueue];
     bool            fActive  = false;
     bool            fPending = false;
 
@@ -1751,21 +1906,7 @@ VMMR3DECL(int) TMR3TimerDestroy(PTMTIMER pTimer)
      * Unlink from the active list.
      */
     if (fActive)
-    {
-        const PTMTIMER pPrev = TMTIMER_GET_PREV(pTimer);
-        const PTMTIMER pNext = TMTIMER_GET_NEXT(pTimer);
-        if (pPrev)
-            TMTIMER_SET_NEXT(pPrev, pNext);
-        else
-        {
-            TMTIMER_SET_HEAD(pQueue, pNext);
-            pQueue->u64Expire = pNext ? pNext->u64Expire : INT64_MAX;
-        }
-        if (pNext)
-            TMTIMER_SET_PREV(pNext, pPrev);
-        pTimer->offNext = 0;
-        pTimer->offPrev = 0;
-    }
+        tmTimerQueueRemoveActive(pQueue, pTimer);
 
     /*
      * Unlink from the schedule list by running it.
@@ -1782,7 +1923,7 @@ VMMR3DECL(int) TMR3TimerDestroy(PTMTIMER pTimer)
     /*
      * Read to move the timer from the created list and onto the free list.
      */
-    Assert(!pTimer->offNext); Assert(!pTimer->offPrev); Assert(!pTimer->offScheduleNext);
+    Assert(!pTimer->offNext); Assert(!pTimer->offPrev); Assert(!pTimer->offChild); Assert(!pTimer->offScheduleNext);
 
     /* unlink from created list */
     if (pTimer->pBigPrev)
@@ -1808,6 +1949,45 @@ VMMR3DECL(int) TMR3TimerDestroy(PTMTIMER pTimer)
 }
 
 
+/**
+ * Destroy a timer
+ *
+ * @returns VBox status code.
+ * @param   pTimer          Timer handle as returned by one of the create functions.
+ */
+VMMR3DECL(int) TMR3TimerDestroy(PTMTIMER pTimer)
+{
+    /*
+     * Be extra careful here.
+     */
+    if (!pTimer)
+        return VINF_SUCCESS;
+    AssertPtr(pTimer);
+    if (!TMTIMERQUEUE_IDX_IS_POOL(pTimer->idxQueue))
+        return tmR3TimerDestroy(pTimer);
+
+    /*
+     * Thread pool timers may be in the middle of a callback or have their
+     * queue scheduled by a pool thread, so we must own the queue lock too.
+     * It nests inside the TM lock.  Once TMR3Term has detached the queue
+     * from the pool the lock is gone and EMT is the only one left.
+     */
+    PVM             pVM      = pTimer->CTX_SUFF(pVM);
+    PTMTIMERQUEUER3 pQueueR3 = &pVM->tm.s.paTimerQueuesR3Data[pTimer->idxQueue];
+    TM_LOCK_TIMERS(pVM);
+    bool const fQueueLock = RTCritSectIsInitialized(&pQueueR3->CritSect);
+    if (fQueueLock)
+        RTCritSectEnter(&pQueueR3->CritSect);
+
+    int rc = tmR3TimerDestroy(pTimer);
+
+    if (fQueueLock)
+        RTCritSectLeave(&pQueueR3->CritSect);
+    TM_UNLOCK_TIMERS(pVM);
+    return rc;
+}
+
+
 /**
  * Destroy all timers owned by a device.
  *
@@ -2088,6 +2268,12 @@ VMMR3DECL(void) TMR3TimerQueuesDo(PVM pVM)
     tmR3TimerQueueRun(pVM, &pVM->tm.s.paTimerQueuesR3[TMCLOCK_REAL]);
     STAM_PROFILE_ADV_STOP(&pVM->tm.s.aStatDoQueues[TMCLOCK_REAL], s3);
 
+    /* The thread pool queues; ring-0 and raw-mode cannot wake the pool
+       threads directly and leave that to us via the timer FF. */
+    if (   pVM->tm.s.paTimerQueuesR3[TMTIMERQUEUE_IDX_POOL_VIRTUAL].offSchedule
+        || pVM->tm.s.paTimerQueuesR3[TMTIMERQUEUE_IDX_POOL_REAL].offSchedule)
+        tmR3TimerPoolWakeUp();
+
 #ifdef VBOX_STRICT
     /* check that we didn't screw up. */
     tmTimerQueuesSanityChecks(pVM, "TMR3TimerQueuesDo");
@@ -2106,17 +2292,64 @@ VMMR3DECL(void) TMR3TimerQueuesDo(PVM pVM)
 //RT_C_DECLS_END
 
 
+/**
+ * Records the delivery latency and jitter of a timer about to be fired.
+ *
+ * @param   pVM             The cross context VM structure.
+ * @param   pQueueR3        The ring-3 data of the queue the timer is on.
+ * @param   enmClock        The queue clock.
+ * @param   u64Expire       The timer expire time.
+ */
+static void tmR3TimerQueueRecordLatency(PVM pVM, PTMTIMERQUEUER3 pQueueR3, TMCLOCK enmClock, uint64_t u64Expire)
+{
+    uint64_t u64NowNs;
+    uint64_t u64ExpireNs;
+    if (enmClock == TMCLOCK_VIRTUAL)
+    {
+        u64NowNs    = TMVirtualGetNoCheck(pVM);
+        u64ExpireNs = u64Expire;
+    }
+    else if (enmClock == TMCLOCK_REAL)
+    {
+        AssertCompile(TMCLOCK_FREQ_REAL == 1000);
+        u64NowNs    = RTTimeNanoTS();
+        u64ExpireNs = u64Expire * RT_NS_1MS;
+    }
+    else
+        return;
+    uint64_t const cNsLatency = u64NowNs > u64ExpireNs ? u64NowNs - u64ExpireNs : 0;
+    uint64_t const cNsJitter  = cNsLatency >= pQueueR3->cNsPrevLatency
+                              ? cNsLatency - pQueueR3->cNsPrevLatency : pQueueR3->cNsPrevLatency - cNsLatency;
+    pQueueR3->cNsPrevLatency  = cNsLatency;
+
+    unsigned iBucket = 0;
+    while (iBucket < RT_ELEMENTS(g_acNsLatencyBuckets) && cNsLatency >= g_acNsLatencyBuckets[iBucket])
+        iBucket++;
+    STAM_REL_COUNTER_INC(&pQueueR3->aStatLatency[iBucket]);
+
+    iBucket = 0;
+    while (iBucket < RT_ELEMENTS(g_acNsLatencyBuckets) && cNsJitter >= g_acNsLatencyBuckets[iBucket])
+        iBucket++;
+    STAM_REL_COUNTER_INC(&pQueueR3->aStatJitter[iBucket]);
+}
+
+
 /**
  * Schedules and runs any pending times in the specified queue.
  *
- * This is normally called from a forced action handler in EMT.
+ * This is normally called from a forced action handler in EMT, or by a timer
+ * pool thread for the thread pool queues.
  *
  * @param   pVM             The cross context VM structure.
  * @param   pQueue          The queue to run.
+ *
+ * @remarks Called while owning the queue lock.
  */
 static void tmR3TimerQueueRun(PVM pVM, PTMTIMERQUEUE pQueue)
 {
-    VM_ASSERT_EMT(pVM);
+    Assert(TMTIMERQUEUE_IDX_IS_POOL(pQueue->idxQueue) || VM_IS_EMT(pVM));
+    TM_ASSERT_QUEUE_LOCK_OWNERSHIP(pVM, pQueue);
+    PTMTIMERQUEUER3 const pQueueR3 = &pVM->tm.s.paTimerQueuesR3Data[pQueue->idxQueue];
 
     /*
      * Run timers.
@@ -2126,18 +2359,22 @@ static void tmR3TimerQueueRun(PVM pVM, PTMTIMERQUEUE pQueue)
      *
      * N.B. A generic unlink must be applied since other threads
      *      are allowed to mess with any active timer at any time.
-     *      However, we only allow EMT to handle EXPIRED_PENDING
-     *      timers, thus enabling the timer handler function to
-     *      arm the timer again.
+     *      However, we only allow the queue lock owner to handle
+     *      EXPIRED_PENDING timers, thus enabling the timer handler
+     *      function to arm the timer again.
+     *
+     * N.B. Timers pending rescheduling by another thread, and timers which
+     *      already fired in this run and were re-armed in the past by their
+     *      handler, are left in the heap and stepped over, see
+     *      tmTimerHeapFindExpired.
      */
-    PTMTIMER pNext = TMTIMER_GET_HEAD(pQueue);
-    if (!pNext)
+    PTMTIMER pTimer = TMTIMER_GET_HEAD(pQueue);
+    if (!pTimer)
         return;
-    const uint64_t u64Now = tmClock(pVM, pQueue->enmClock);
-    while (pNext && pNext->u64Expire <= u64Now)
+    const uint64_t u64Now  = tmClock(pVM, pQueue->enmClock);
+    const uint32_t uRunGen = ++pQueue->uRunGen;
+    while ((pTimer = tmTimerHeapFindExpired(TMTIMER_GET_HEAD(pQueue), u64Now, uRunGen)) != NULL)
     {
-        PTMTIMER        pTimer    = pNext;
-        pNext = TMTIMER_GET_NEXT(pTimer);
         PPDMCRITSECT    pCritSect = pTimer->pCritSect;
         if (pCritSect)
             PDMCritSectEnter(pCritSect, VERR_IGNORED);
@@ -2150,21 +2387,12 @@ static void tmR3TimerQueueRun(PVM pVM, PTMTIMERQUEUE pQueue)
             Assert(!pTimer->offScheduleNext); /* this can trigger falsely */
 
             /* unlink */
-            const PTMTIMER pPrev = TMTIMER_GET_PREV(pTimer);
-            if (pPrev)
-                TMTIMER_SET_NEXT(pPrev, pNext);
-            else
-            {
-                TMTIMER_SET_HEAD(pQueue, pNext);
-                pQueue->u64Expire = pNext ? pNext->u64Expire : INT64_MAX;
-            }
-            if (pNext)
-                TMTIMER_SET_PREV(pNext, pPrev);
-            pTimer->offNext = 0;
-            pTimer->offPrev = 0;
+            tmTimerQueueRemoveActive(pQueue, pTimer);
+            pTimer->uRunGen = uRunGen;
 
             /* fire */
             TM_SET_STATE(pTimer, TMTIMERSTATE_EXPIRED_DELIVER);
+            tmR3TimerQueueRecordLatency(pVM, pQueueR3, pQueue->enmClock, pTimer->u64Expire);
             switch (pTimer->enmType)
             {
                 case TMTIMERTYPE_DEV:       pTimer->u.Dev.pfnTimer(pTimer->u.Dev.pDevIns, pTimer, pTimer->pvUser); break;
@@ -2187,6 +2415,260 @@ static void tmR3TimerQueueRun(PVM pVM, PTMTIMERQUEUE pQueue)
 }
 
 
+/**
+ * @callback_method_impl{FNRTONCE, Initializes the timer thread pool.}
+ */
+static DECLCALLBACK(int32_t) tmR3TimerPoolInitOnce(void *pvUser)
+{
+    RT_NOREF(pvUser);
+    int rc = RTCritSectInit(&g_TimerPool.CritSect);
+    if (RT_SUCCESS(rc))
+    {
+        rc = RTSemFastMutexCreate(&g_TimerPool.hMtxAttach);
+        if (RT_SUCCESS(rc))
+        {
+            rc = RTSemEventCreate(&g_TimerPool.hEvtWakeUp);
+            if (RT_SUCCESS(rc))
+            {
+                RTListInit(&g_TimerPool.QueueList);
+                return VINF_SUCCESS;
+            }
+            RTSemFastMutexDestroy(g_TimerPool.hMtxAttach);
+            g_TimerPool.hMtxAttach = NIL_RTSEMFASTMUTEX;
+        }
+        RTCritSectDelete(&g_TimerPool.CritSect);
+    }
+    return rc;
+}
+
+
+/**
+ * Wakes up a timer pool thread.
+ *
+ * Called when a thread pool queue gets a new head or scheduling work the pool
+ * threads may not know about.
+ */
+void tmR3TimerPoolWakeUp(void)
+{
+    if (g_TimerPool.hEvtWakeUp != NIL_RTSEMEVENT)
+        RTSemEventSignal(g_TimerPool.hEvtWakeUp);
+}
+
+
+/**
+ * Works out how long until a thread pool queue needs running.
+ *
+ * @returns Nanoseconds until the next timer expires, 0 if the queue needs
+ *          running now, UINT64_MAX if there is nothing to wait for.
+ * @param   pQueueR3        The ring-3 data of the queue.
+ */
+static uint64_t tmR3TimerPoolQueueDue(PTMTIMERQUEUER3 pQueueR3)
+{
+    PTMTIMERQUEUE const pQueue = pQueueR3->pQueue;
+    if (ASMAtomicReadS32(&pQueue->offSchedule))
+        return 0;
+    uint64_t const u64Expire = ASMAtomicReadU64(&pQueue->u64Expire);
+    if (u64Expire == INT64_MAX)
+        return UINT64_MAX;
+
+    PVM const pVM = pQueueR3->pVM;
+    if (pQueue->enmClock == TMCLOCK_VIRTUAL)
+    {
+        /* The virtual clock doesn't move while the VM is suspended, TMR3NotifyResume wakes us. */
+        if (!ASMAtomicReadU32(&pVM->tm.s.cVirtualTicking))
+            return UINT64_MAX;
+        uint64_t const u64Now = TMVirtualGetNoCheck(pVM);
+        if (u64Expire <= u64Now)
+            return 0;
+        uint64_t cNsLeft = u64Expire - u64Now;
+        if (pVM->tm.s.fVirtualWarpDrive)
+            cNsLeft = ASMMultU64ByU32DivByU32(cNsLeft, 100, RT_MAX(pVM->tm.s.u32VirtualWarpDrivePercentage, 1));
+        return cNsLeft;
+    }
+
+    Assert(pQueue->enmClock == TMCLOCK_REAL);
+    uint64_t const u64Now = TMRealGet(pVM);
+    if (u64Expire <= u64Now)
+        return 0;
+    return (u64Expire - u64Now) * RT_NS_1MS;
+}
+
+
+/**
+ * The timer pool thread.
+ *
+ * Picks a queue in need of running, moving it to the end of the list to share
+ * the threads fairly between the VMs and queues, or sleeps until the earliest
+ * deadline of the queues not currently being run.
+ *
+ * @returns VINF_SUCCESS.
+ * @param   hThreadSelf     The thread handle.
+ * @param   pvUser          Unused.
+ */
+static DECLCALLBACK(int) tmR3TimerPoolThread(RTTHREAD hThreadSelf, void *pvUser)
+{
+    RT_NOREF(hThreadSelf, pvUser);
+
+    while (!ASMAtomicReadBool(&g_TimerPool.fTerminate))
+    {
+        /*
+         * Look for work.
+         */
+        PTMTIMERQUEUER3 pToRun  = NULL;
+        bool            fMore   = false;
+        uint64_t        cNsWait = RT_NS_1SEC;
+        RTCritSectEnter(&g_TimerPool.CritSect);
+        PTMTIMERQUEUER3 pQueueR3;
+        RTListForEach(&g_TimerPool.QueueList, pQueueR3, TMTIMERQUEUER3, PoolNode)
+        {
+            if (ASMAtomicReadBool(&pQueueR3->fBusy))
+                continue;
+            uint64_t const cNsDue = tmR3TimerPoolQueueDue(pQueueR3);
+            if (cNsDue == 0)
+            {
+                if (pToRun)
+                {
+                    fMore = true;
+                    break;
+                }
+                pToRun = pQueueR3;
+            }
+            else if (cNsDue < cNsWait)
+                cNsWait = cNsDue;
+        }
+        if (pToRun)
+        {
+            ASMAtomicWriteBool(&pToRun->fBusy, true);
+            RTListNodeRemove(&pToRun->PoolNode);
+            RTListAppend(&g_TimerPool.QueueList, &pToRun->PoolNode);
+        }
+        RTCritSectLeave(&g_TimerPool.CritSect);
+
+        /*
+         * Run the queue we picked, getting another thread going on the next
+         * one if there is more work, or go to sleep.
+         */
+        if (pToRun)
+        {
+            if (fMore)
+                RTSemEventSignal(g_TimerPool.hEvtWakeUp);
+
+            PVM const pVM = pToRun->pVM;
+            STAM_REL_PROFILE_START(&pToRun->StatPoolRun, a);
+            RTCritSectEnter(&pToRun->CritSect);
+            if (pToRun->pQueue->offSchedule)
+                tmTimerQueueSchedule(pVM, pToRun->pQueue);
+            tmR3TimerQueueRun(pVM, pToRun->pQueue);
+            RTCritSectLeave(&pToRun->CritSect);
+            STAM_REL_PROFILE_STOP(&pToRun->StatPoolRun, a);
+
+            ASMAtomicWriteBool(&pToRun->fBusy, false);
+        }
+        else
+            RTSemEventWaitEx(g_TimerPool.hEvtWakeUp,
+                             RTSEMWAIT_FLAGS_RELATIVE | RTSEMWAIT_FLAGS_NANOSECS | RTSEMWAIT_FLAGS_UNINTERRUPTIBLE,
+                             cNsWait);
+    }
+
+    /* Pass the termination on to the next thread. */
+    RTSemEventSignal(g_TimerPool.hEvtWakeUp);
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Hands the thread pool queues of a VM to the timer thread pool, growing it
+ * to the number of threads the VM wants.
+ *
+ * @returns VBox status code.
+ * @param   pVM             The cross context VM structure.
+ */
+static int tmR3TimerPoolAttach(PVM pVM)
+{
+    int rc = RTOnce(&g_TimerPoolOnce, tmR3TimerPoolInitOnce, NULL);
+    AssertLogRelRCReturn(rc, rc);
+
+    RTSemFastMutexRequest(g_TimerPool.hMtxAttach);
+    while (g_TimerPool.cThreads < pVM->tm.s.cTimerPoolThreads)
+    {
+        rc = RTThreadCreateF(&g_TimerPool.ahThreads[g_TimerPool.cThreads], tmR3TimerPoolThread, NULL, 0,
+                             RTTHREADTYPE_TIMER, RTTHREADFLAGS_WAITABLE, "TMPool%u", g_TimerPool.cThreads);
+        if (RT_FAILURE(rc))
+            break;
+        g_TimerPool.cThreads++;
+    }
+    if (g_TimerPool.cThreads > 0)
+    {
+        RTCritSectEnter(&g_TimerPool.CritSect);
+        for (uint32_t i = TMTIMERQUEUE_IDX_POOL_VIRTUAL; i < TMTIMERQUEUE_IDX_COUNT; i++)
+        {
+            PTMTIMERQUEUER3 pQueueR3 = &pVM->tm.s.paTimerQueuesR3Data[i];
+            RTListAppend(&g_TimerPool.QueueList, &pQueueR3->PoolNode);
+            pQueueR3->fInPool = true;
+        }
+        g_TimerPool.cUsers++;
+        RTCritSectLeave(&g_TimerPool.CritSect);
+        LogRel(("TM: Timer thread pool: %u thread(s), %u VM(s)\n", g_TimerPool.cThreads, g_TimerPool.cUsers));
+        rc = VINF_SUCCESS;
+    }
+    else
+        LogRel(("TM: Failed to create timer pool threads: %Rrc\n", rc));
+    RTSemFastMutexRelease(g_TimerPool.hMtxAttach);
+
+    if (RT_SUCCESS(rc))
+        tmR3TimerPoolWakeUp(); /* Timers may have been armed during device construction. */
+    return rc;
+}
+
+
+/**
+ * Takes the thread pool queues of a VM away from the timer thread pool,
+ * terminating the threads when the last VM leaves.
+ *
+ * @param   pVM             The cross context VM structure.
+ */
+static void tmR3TimerPoolDetach(PVM pVM)
+{
+    if (!pVM->tm.s.paTimerQueuesR3Data[TMTIMERQUEUE_IDX_POOL_VIRTUAL].fInPool)
+        return;
+
+    RTSemFastMutexRequest(g_TimerPool.hMtxAttach);
+    RTCritSectEnter(&g_TimerPool.CritSect);
+    for (uint32_t i = TMTIMERQUEUE_IDX_POOL_VIRTUAL; i < TMTIMERQUEUE_IDX_COUNT; i++)
+    {
+        PTMTIMERQUEUER3 pQueueR3 = &pVM->tm.s.paTimerQueuesR3Data[i];
+        RTListNodeRemove(&pQueueR3->PoolNode);
+        pQueueR3->fInPool = false;
+    }
+    uint32_t const cUsers = --g_TimerPool.cUsers;
+    RTCritSectLeave(&g_TimerPool.CritSect);
+
+    /* Wait for any thread still running one of our queues.  It was claimed
+       before we unlinked it, so no thread can pick it up again. */
+    for (uint32_t i = TMTIMERQUEUE_IDX_POOL_VIRTUAL; i < TMTIMERQUEUE_IDX_COUNT; i++)
+        while (ASMAtomicReadBool(&pVM->tm.s.paTimerQueuesR3Data[i].fBusy))
+            RTThreadSleep(1);
+
+    /*
+     * Terminate the threads if we were the last user.
+     */
+    if (!cUsers)
+    {
+        ASMAtomicWriteBool(&g_TimerPool.fTerminate, true);
+        RTSemEventSignal(g_TimerPool.hEvtWakeUp);
+        for (uint32_t i = 0; i < g_TimerPool.cThreads; i++)
+        {
+            int rc = RTThreadWait(g_TimerPool.ahThreads[i], RT_INDEFINITE_WAIT, NULL);
+            AssertLogRelRC(rc);
+            g_TimerPool.ahThreads[i] = NIL_RTTHREAD;
+        }
+        g_TimerPool.cThreads = 0;
+        ASMAtomicWriteBool(&g_TimerPool.fTerminate, false);
+    }
+    RTSemFastMutexRelease(g_TimerPool.hMtxAttach);
+}
+
+
 /**
  * Schedules and runs any pending times in the timer queue for the
  * synchronous virtual clock.
@@ -2314,15 +2796,16 @@ static void tmR3TimerQueueRunVirtualSync(PVM pVM)
 
     /*
      * Process the expired timers moving the clock along as we progress.
+     * Like in tmR3TimerQueueRun, each timer fires at most once per run.
      */
 #ifdef VBOX_STRICT
     uint64_t u64Prev = u64Now; NOREF(u64Prev);
 #endif
-    while (pNext && pNext->u64Expire <= u64Max)
+    uint32_t const uRunGen = ++pQueue->uRunGen;
+    while ((pNext = tmTimerHeapFindExpired(TMTIMER_GET_HEAD(pQueue), u64Max, uRunGen)) != NULL)
     {
         /* Advance */
         PTMTIMER pTimer = pNext;
-        pNext = TMTIMER_GET_NEXT(pTimer);
 
         /* Take the associated lock. */
         PPDMCRITSECT pCritSect = pTimer->pCritSect;
@@ -2343,6 +2826,7 @@ static void tmR3TimerQueueRunVirtualSync(PVM pVM)
 
         /* Unlink it, change the state and do the callout. */
         tmTimerQueueUnlinkActive(pQueue, pTimer);
+        pTimer->uRunGen = uRunGen;
         TM_SET_STATE(pTimer, TMTIMERSTATE_EXPIRED_DELIVER);
         switch (pTimer->enmType)
         {
@@ -2897,6 +3381,10 @@ VMMR3DECL(int) TMR3NotifyResume(PVM pVM, PVMCPU pVCpu)
     rc = tmVirtualResumeLocked(pVM);
     TM_UNLOCK_TIMERS(pVM);
 
+    /* The timer pool threads ignore the virtual queue while it's stopped. */
+    if (RT_SUCCESS(rc))
+        tmR3TimerPoolWakeUp();
+
     return rc;
 }
 
@@ -3454,12 +3942,16 @@ static DECLCALLBACK(void) tmR3TimerInfoActive(PVM pVM, PCDBGFINFOHLP pHlp, const
                                                 "Expire",
                                                 "HzHint",
                                                 "State");
-    for (unsigned iQueue = 0; iQueue < TMCLOCK_MAX; iQueue++)
+    for (unsigned iQueue = 0; iQueue < TMTIMERQUEUE_IDX_COUNT; iQueue++)
     {
-        TM_LOCK_TIMERS(pVM);
+        PTMTIMERQUEUER3 pQueueR3 = &pVM->tm.s.paTimerQueuesR3Data[iQueue];
+        if (TMTIMERQUEUE_IDX_IS_POOL(iQueue))
+            RTCritSectEnter(&pQueueR3->CritSect);
+        else
+            TM_LOCK_TIMERS(pVM);
         for (PTMTIMERR3 pTimer = TMTIMER_GET_HEAD(&pVM->tm.s.paTimerQueuesR3[iQueue]);
              pTimer;
-             pTimer = TMTIMER_GET_NEXT(pTimer))
+             pTimer = tmTimerHeapWalkNext(pTimer))
         {
             pHlp->pfnPrintf(pHlp,
                             "%p %08RX32 %08RX32 %08RX32 %s %18RU64 %18RU64 %6RU32 %-25s %s\n",
@@ -3474,7 +3966,10 @@ static DECLCALLBACK(void) tmR3TimerInfoActive(PVM pVM, PCDBGFINFOHLP pHlp, const
                             tmTimerState(pTimer->enmState),
                             pTimer->pszDesc);
         }
-        TM_UNLOCK_TIMERS(pVM);
+        if (TMTIMERQUEUE_IDX_IS_POOL(iQueue))
+            RTCritSectLeave(&pQueueR3->CritSect);
+        else
+            TM_UNLOCK_TIMERS(pVM);
     }
 }
 
@@ -22,6 +22,7 @@
 #include <VBox/types.h>
 #include <VBox/vmm/ftm.h>
 #include <VBox/vmm/stam.h>
+#include <VBox/vmm/ssm.h>
 #include <VBox/vmm/pdmcritsect.h>
 #include <iprt/avl.h>
 
@@ -70,6 +71,13 @@ typedef struct FTM
     /* Shutdown event semaphore. */
     RTSEMEVENT          hShutdownEvent;
 
+    /** The striped data connections for the state sync, NULL if the state
+     * goes over hSocket. */
+    R3PTRTYPE(PSSMTCPSTRIPE) pStripe;
+    /** The number of data connections the master should use (CFGM). */
+    uint32_t            cStreams;
+    uint32_t            u32Alignment;
+
     /** State sync. */
     struct
     {
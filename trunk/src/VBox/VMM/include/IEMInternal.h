@@ -83,6 +83,13 @@ RT_C_DECLS_BEGIN
 
 //#define IEM_WITH_CODE_TLB// - work in progress
 
+/** @def IEM_WITH_OPCODE_CACHE
+ * Enables the opcode block cache used by IEMExecLots in ring-3 when we're not
+ * using the code TLB. */
+#if (defined(IN_RING3) && !defined(IEM_WITH_CODE_TLB) && !defined(IEM_VERIFICATION_MODE_FULL)) || defined(DOXYGEN_RUNNING)
+# define IEM_WITH_OPCODE_CACHE
+#endif
+
 
 #if !defined(IN_TSTVMSTRUCT) && !defined(DOXYGEN_RUNNING)
 /** Instruction statistics.   */
@@ -447,6 +454,113 @@ AssertCompileSizeAlignment(IEMTLB, 64);
 #define IEMTLB_PHYS_REV_INCR    RT_BIT_64(8)
 
 
+/** Number of guest code pages the opcode cache can hold. */
+#define IEM_OPCACHE_BLOCKS      4
+
+/**
+ * An opcode cache block, i.e. one guest code page.
+ *
+ * The block does not hold a copy of the page, the opcode bytes are read
+ * straight from the ring-3 mapping of the guest page.
+ */
+typedef struct IEMOPCACHEBLOCK
+{
+    /** The linear address of the page. */
+    uint64_t            GCPtrPage;
+    /** The guest physical address of the page. */
+    uint64_t            GCPhysPage;
+    /** The page table flags returned by PGMGstGetPage.  Only X86_PTE_US and
+     * X86_PTE_PAE_NX are of interest, they're checked on every hit since
+     * the outcome depends on the CPL and EFER.NXE. */
+    uint64_t            fPteFlags;
+    /** The ring-3 mapping of the guest page. */
+    R3PTRTYPE(uint8_t const *) pbPageR3;
+#if HC_ARCH_BITS == 32
+    uint32_t            u32Padding0;
+#endif
+    /** The PGM page identity (PGMPhysIemQueryCodePage). */
+    R3PTRTYPE(void const *) pvPgmPageR3;
+#if HC_ARCH_BITS == 32
+    uint32_t            u32Padding1;
+#endif
+    /** The PGM page cookie (PGMPhysIemQueryCodePage). */
+    uint64_t            uPgmCookie;
+    /** The PGM mapping generation (PGMPhysIemQueryCodePage). */
+    uint32_t            uPgmGen;
+    /** The cache revision this block is valid for (IEMOPCACHE::uRevision). */
+    uint32_t            uRevision;
+    /** The IEMExecLots run the translation was last verified in
+     * (IEMOPCACHE::uExecRev). */
+    uint32_t            uExecRev;
+    /** Number of fetches satisfied by this block since it was filled. */
+    uint32_t            cHits;
+} IEMOPCACHEBLOCK;
+AssertCompileSize(IEMOPCACHEBLOCK, 64);
+/** Pointer to an opcode cache block. */
+typedef IEMOPCACHEBLOCK *PIEMOPCACHEBLOCK;
+
+/**
+ * The opcode block cache.
+ *
+ * Without the code TLB, every instruction executed by IEMExecLots would have
+ * to walk the guest page tables and do a PGMPhysRead of up to 15 bytes.  The
+ * cache remembers the translation and the ring-3 mapping of the most recently
+ * executed code pages instead, so the common case is a lookup and a small
+ * memcpy from the guest page.
+ *
+ * Since the bytes are read from the live guest page, writes to guest RAM need
+ * no invalidation.  PGMPhysIemIsCodePageValid is checked on every fetch and
+ * catches the page being replaced, getting access handlers or losing its
+ * mapping.
+ *
+ * The cache is kept across IEMExecLots calls.  We cannot see what the guest
+ * does to its page tables while executing natively, so the first use of a
+ * block in a new run redoes the page walk (uExecRev).  The block is kept if
+ * the page still translates to the same physical page.  Within a run, blocks
+ * are invalidated by INVLPG (IEMTlbInvalidatePage) and by TLB flushes, A20
+ * changes and paging control register writes (IEMTlbInvalidateAll and
+ * friends).
+ */
+typedef struct IEMOPCACHE
+{
+    /** The cache blocks. */
+    IEMOPCACHEBLOCK     aBlocks[IEM_OPCACHE_BLOCKS];
+    /** The current cache revision, never zero.  Blocks with a different
+     * revision are invalid. */
+    uint32_t            uRevision;
+    /** The current IEMExecLots run number, incremented every time the cache
+     * is armed. */
+    uint32_t            uExecRev;
+    /** The index of the block which satisfied the last fetch. */
+    uint8_t             iLastHit;
+    /** The index of the next block to replace. */
+    uint8_t             iNextVictim;
+    /** Set while IEMExecLots is using the cache. */
+    bool                fArmed;
+    /** Whether the cache is enabled (CFGM: /IEM/OpcodeCache). */
+    bool                fEnabled;
+    uint32_t            u32Padding0;
+
+    /** Number of fetches satisfied by the cache. */
+    uint64_t            cHits;
+    /** Number of block fills. */
+    uint32_t            cMisses;
+    /** Number of times a page could not be cached (access handlers, MMIO). */
+    uint32_t            cUncacheable;
+    /** Number of explicit invalidations (TLB flushes, CRx writes). */
+    uint32_t            cFlushes;
+    /** Number of blocks refilled because PGM changed the page. */
+    uint32_t            cStale;
+    /** Number of blocks whose translation was verified again in a new run. */
+    uint32_t            cReverified;
+    /** Alignment padding. */
+    uint32_t            au32Padding[5];
+} IEMOPCACHE;
+AssertCompileSizeAlignment(IEMOPCACHE, 64);
+/** Pointer to the opcode block cache. */
+typedef IEMOPCACHE *PIEMOPCACHE;
+
+
 /**
  * The per-CPU IEM state.
  */
@@ -735,6 +849,9 @@ typedef struct IEMCPU
     /** Instruction TLB.
      * @remarks Must be 64-byte aligned. */
     IEMTLB                  CodeTlb;
+    /** Opcode block cache.
+     * @remarks Must be 64-byte aligned. */
+    IEMOPCACHE              OpCache;
 
     /** Pointer to the CPU context - ring-3 context.
      * @todo put inside IEM_VERIFICATION_MODE_FULL++. */
@@ -769,6 +886,7 @@ typedef struct IEMCPU
 AssertCompileMemberOffset(IEMCPU, fCurXcpt, 0x48);
 AssertCompileMemberAlignment(IEMCPU, DataTlb, 64);
 AssertCompileMemberAlignment(IEMCPU, CodeTlb, 64);
+AssertCompileMemberAlignment(IEMCPU, OpCache, 64);
 /** Pointer to the per-CPU IEM state. */
 typedef IEMCPU *PIEMCPU;
 /** Pointer to the const per-CPU IEM state. */
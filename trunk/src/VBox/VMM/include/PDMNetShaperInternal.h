@@ -15,6 +15,17 @@
  * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
  */
 
+#ifndef ___PDMNetShaperInternal_h
+#define ___PDMNetShaperInternal_h
+
+#include <VBox/sup.h>
+#include <iprt/time.h>
+
+
+/** The max depth of the bandwidth group hierarchy (e.g. host, tenant, NIC). */
+#define PDM_NETSHAPER_MAX_DEPTH     4
+
+
 /**
  * Bandwidth group instance data
  */
@@ -24,6 +35,15 @@ typedef struct PDMNSBWGROUP
     R3PTRTYPE(struct PDMNSBWGROUP *)            pNextR3;
     /** Pointer to the shared UVM structure. */
     R3PTRTYPE(struct PDMNETSHAPER *)            pShaperR3;
+    /** The parent group which limits this one and its siblings as a whole,
+     *  NULL for a root (ring-3). */
+    R3PTRTYPE(struct PDMNSBWGROUP *)            pParentR3;
+    /** The parent group (ring-0). */
+    R0PTRTYPE(struct PDMNSBWGROUP *)            pParentR0;
+    /** The support driver session for signalling hEvtWakeup. */
+    PSUPDRVSESSION                              pSession;
+    /** The event the TX thread waits on (shared by all groups). */
+    SUPSEMEVENT                                 hEvtWakeup;
     /** Critical section protecting all members below. */
     PDMCRITSECT                                 Lock;
     /** Pointer to the first filter attached to this group. */
@@ -40,7 +60,61 @@ typedef struct PDMNSBWGROUP
     volatile uint64_t                           tsUpdatedLast;
     /** Reference counter - How many filters are associated with this group. */
     volatile uint32_t                           cRefs;
+    /** The configured burst size, 0 if derived from the rate. */
+    uint32_t                                    cbBurst;
+    /** The largest transfer denied since the TX thread last served the
+     *  filters of this group. */
+    volatile uint32_t                           cbPendingMax;
+    /** Set when a filter of this group is choked and the TX thread has been
+     *  told about it. */
+    volatile bool                               fWaiters;
+    /** Alignment padding. */
+    bool                                        afPadding[3];
 } PDMNSBWGROUP;
 /** Pointer to a bandwidth group. */
 typedef PDMNSBWGROUP *PPDMNSBWGROUP;
 
+
+/**
+ * Calculates the tokens in the bucket of a group at the given time without
+ * updating it.  Caller owns the group lock.
+ *
+ * @returns Number of bytes available, UINT32_MAX if the group is unlimited.
+ * @param   pBwGroup        The bandwidth group.
+ * @param   tsNow           The current RTTimeSystemNanoTS().
+ */
+DECLINLINE(uint32_t) pdmNsBwGroupPeekTokens(PPDMNSBWGROUP pBwGroup, uint64_t tsNow)
+{
+    uint64_t const cbPerSecMax = pBwGroup->cbPerSecMax;
+    if (!cbPerSecMax)
+        return UINT32_MAX;
+    /* No need to look further back than it takes to fill an empty bucket,
+       which also keeps the multiplication below from overflowing. */
+    uint64_t const cNsFill     = (uint64_t)pBwGroup->cbBucket * RT_NS_1SEC / cbPerSecMax;
+    uint64_t const tsLast      = pBwGroup->tsUpdatedLast;
+    uint64_t const cNsElapsed  = RT_MIN(tsNow > tsLast ? tsNow - tsLast : 0, cNsFill);
+    uint64_t const cbTokens    = cNsElapsed * cbPerSecMax / RT_NS_1SEC + pBwGroup->cbTokensLast;
+    return (uint32_t)RT_MIN(cbTokens, pBwGroup->cbBucket);
+}
+
+
+/**
+ * Takes tokens out of the bucket of a group.  Caller owns the group lock and
+ * has checked that there are enough using pdmNsBwGroupPeekTokens.
+ *
+ * @param   pBwGroup        The bandwidth group.
+ * @param   tsNow           The timestamp the tokens were peeked at.
+ * @param   cbTokens        The number of tokens available at @a tsNow.
+ * @param   cbTransfer      The number of tokens to take.
+ */
+DECLINLINE(void) pdmNsBwGroupConsume(PPDMNSBWGROUP pBwGroup, uint64_t tsNow, uint32_t cbTokens, uint32_t cbTransfer)
+{
+    if (pBwGroup->cbPerSecMax)
+    {
+        Assert(cbTokens >= cbTransfer);
+        pBwGroup->tsUpdatedLast = tsNow;
+        pBwGroup->cbTokensLast  = cbTokens - cbTransfer;
+    }
+}
+
+#endif /* !___PDMNetShaperInternal_h */
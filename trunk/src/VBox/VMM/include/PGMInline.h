@@ -548,6 +548,19 @@ DECLINLINE(void) pgmPhysPageWriteMonitor(PVM pVM, PPGMPAGE pPage, RTGCPHYS GCPhy
 }
 
 
+/**
+ * Advances the physical mapping generation when ring-3 page mappings or
+ * PGMPAGE pointers may become invalid.
+ *
+ * @param   pVM         The cross context VM structure.
+ * @sa      PGMPhysIemIsCodePageValid
+ */
+DECLINLINE(void) pgmPhysBumpMapGen(PVM pVM)
+{
+    ASMAtomicIncU32(&pVM->pgm.s.uPhysMapGen);
+}
+
+
 /**
  * Checks if the no-execute (NX) feature is active (EFER.NXE=1).
  *
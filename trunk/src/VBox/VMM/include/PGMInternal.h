@@ -1348,6 +1348,17 @@ typedef PPGMPAGE *PPPGMPAGE;
      || PGM_PAGE_GET_HNDL_VIRT_STATE(a_pPage) == PGM_PAGE_HNDL_VIRT_STATE_ALL )
 #endif
 
+/**
+ * Gets the bits of the page that IEM's opcode cache depends on: the handler
+ * states, the host physical address, the page state and the page type.
+ *
+ * @returns Opaque 64-bit cookie.
+ * @param   a_pPage     Pointer to the physical guest page tracking structure.
+ *
+ * @remarks Can be used without owning the PGM lock.
+ */
+#define PGM_PAGE_GET_IEM_CODE_COOKIE(a_pPage)   ( ASMAtomicUoReadU64(&(a_pPage)->au64[0]) & UINT64_C(0x003ffffffffff303) )
+
 
 /** @def PGM_PAGE_GET_TRACKING
  * Gets the packed shadow page pool tracking data associated with a guest page.
@@ -3316,6 +3327,11 @@ typedef struct PGM
     /** Generation ID for the RAM ranges. This member is incremented everytime
      * a RAM range is linked or unlinked. */
     uint32_t volatile               idRamRangesGen;
+    /** Physical mapping generation.  This member is incremented when the page
+     * map TLB is flushed and when a RAM range is linked or unlinked, i.e. when
+     * ring-3 page mappings and PGMPAGE pointers may go stale.  IEM uses it to
+     * validate its opcode cache, see PGMPhysIemIsCodePageValid. */
+    uint32_t volatile               uPhysMapGen;
 
     /** Base address (GC) of fixed mapping.
      * This is valid if either fMappingsFixed or fMappingsFixedRestored is set. */
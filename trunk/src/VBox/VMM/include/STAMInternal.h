@@ -128,6 +128,96 @@ typedef struct STAMDESC
 } STAMDESC;
 
 
+/**
+ * Compiled sample index entry.
+ */
+typedef struct STAMINDEXENTRY
+{
+    /** The sample descriptor, NULL if the sample has gone away.  Only valid
+     * while STAMINDEX::iRegGen matches STAMUSERPERVM::iRegGen. */
+    PSTAMDESC           pDesc;
+    /** Offset of the sample name into STAMINDEX::pszNames. */
+    uint32_t            offName;
+    /** The index of the first value in the binary snapshot. */
+    uint32_t            iValue;
+    /** The sample type at compile time. */
+    STAMTYPE            enmType;
+    /** The sample unit at compile time. */
+    STAMUNIT            enmUnit;
+} STAMINDEXENTRY;
+/** Pointer to a compiled sample index entry. */
+typedef STAMINDEXENTRY *PSTAMINDEXENTRY;
+
+
+/**
+ * Compiled sample index, see STAMR3IndexCompile.
+ */
+typedef struct STAMINDEX
+{
+    /** Magic value (STAMINDEX_MAGIC). */
+    uint32_t            u32Magic;
+    /** Reference counter.  The pattern cache holds one reference. */
+    uint32_t volatile   cRefs;
+    /** The registry generation the descriptor pointers are valid for. */
+    uint32_t volatile   iRegGen;
+    /** The registry generation the pattern was matched at.  Unlike iRegGen
+     * this is not advanced by re-resolving, so the cache can tell when samples
+     * may have been registered since. */
+    uint32_t            iCompileGen;
+    /** The cache clock value when this index was last handed out. */
+    uint32_t volatile   uLastUsed;
+    /** Number of entries in paEntries. */
+    uint32_t            cEntries;
+    /** Number of 64-bit values a binary snapshot produces. */
+    uint32_t            cValues;
+    /** Whether GVMM statistics must be fetched from ring-0. */
+    bool                fRing0Gvmm;
+    /** Whether GMM statistics must be fetched from ring-0. */
+    bool                fRing0Gmm;
+    /** The pattern the index was compiled from. */
+    char               *pszPattern;
+    /** The sample names (zero terminated strings back to back). */
+    char               *pszNames;
+    /** The size of the pszNames block (used bytes). */
+    uint32_t            cbNames;
+    /** Number of allocated entries (only used while compiling). */
+    uint32_t            cEntriesAlloc;
+    /** The sample entries, sorted like the sample list. */
+    PSTAMINDEXENTRY     paEntries;
+} STAMINDEX;
+
+/** STAMINDEX::u32Magic value (Grace Hopper). */
+#define STAMINDEX_MAGIC         UINT32_C(0x19061209)
+/** STAMINDEX::u32Magic value after destruction. */
+#define STAMINDEX_MAGIC_DEAD    UINT32_C(0x19920101)
+
+/** The number of compiled patterns kept in the cache. */
+#define STAM_INDEX_CACHE_SIZE   8
+
+
+/**
+ * Shared memory export instance, see STAMR3ExportCreate.
+ */
+typedef struct STAMEXPORT
+{
+    /** Magic value (STAMEXPORT_MAGIC). */
+    uint32_t            u32Magic;
+    /** Whether pHdr is a file mapping (true) or page memory (false). */
+    bool                fMapped;
+    /** The compiled index backing the export. */
+    PSTAMINDEX          pIndex;
+    /** The export area. */
+    PSTAMEXPORTHDR      pHdr;
+    /** The size of the export area. */
+    size_t              cbMapping;
+} STAMEXPORT;
+
+/** STAMEXPORT::u32Magic value (Edsger Wybe Dijkstra). */
+#define STAMEXPORT_MAGIC        UINT32_C(0x19300511)
+/** STAMEXPORT::u32Magic value after destruction. */
+#define STAMEXPORT_MAGIC_DEAD   UINT32_C(0x20020806)
+
+
 /**
  * STAM data kept in the UVM.
  */
@@ -150,6 +240,14 @@ typedef struct STAMUSERPERVM
     uint32_t                uAlignment;
     /** The copy of the GMM statistics. */
     GMMSTATS                GMMStats;
+
+    /** The registry generation, incremented (while holding the write lock)
+     * every time a sample is registered or deregistered. */
+    uint32_t volatile       iRegGen;
+    /** The clock for the LRU replacement in apIndexCache. */
+    uint32_t volatile       uIndexCacheClock;
+    /** Pattern compile cache (protected by RWSem). */
+    PSTAMINDEX              apIndexCache[STAM_INDEX_CACHE_SIZE];
 } STAMUSERPERVM;
 #ifdef IN_RING3
 AssertCompileMemberAlignment(STAMUSERPERVM, GMMStats, 8);
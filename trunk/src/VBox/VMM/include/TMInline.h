@@ -19,6 +19,240 @@
 #define ___TMInline_h
 
 
+/**
+ * Melds two active timer heaps.
+ *
+ * The root with the lower expire time becomes the root of the result, the
+ * other one its first child.  On a tie @a pA stays on top, which keeps the
+ * first armed of two equally expiring timers in front when inserting.
+ *
+ * @returns The new root.
+ * @param   pA          The first heap root (no siblings, no parent).
+ * @param   pB          The second heap root (no siblings, no parent).
+ */
+DECL_FORCE_INLINE(PTMTIMER) tmTimerHeapMeld(PTMTIMER pA, PTMTIMER pB)
+{
+    Assert(!pA->offNext && !pA->offPrev);
+    Assert(!pB->offNext && !pB->offPrev);
+    if (pB->u64Expire < pA->u64Expire)
+    {
+        PTMTIMER pTmp = pA;
+        pA = pB;
+        pB = pTmp;
+    }
+
+    PTMTIMER const pChild = TMTIMER_GET_CHILD(pA);
+    TMTIMER_SET_NEXT(pB, pChild);
+    if (pChild)
+        TMTIMER_SET_PREV(pChild, pB);
+    TMTIMER_SET_PREV(pB, pA);
+    TMTIMER_SET_CHILD(pA, pB);
+    return pA;
+}
+
+
+/**
+ * Combines a list of sibling heaps into one using the standard two-pass
+ * pairing.
+ *
+ * @returns The new root, NULL if @a pFirst is NULL.
+ * @param   pFirst      The first sibling.  The offPrev link is ignored.
+ */
+DECLINLINE(PTMTIMER) tmTimerHeapMergePairs(PTMTIMER pFirst)
+{
+    if (!pFirst)
+        return NULL;
+
+    /* Pass 1: Meld pairs left to right, pushing the results onto a stack
+               linked thru offNext. */
+    PTMTIMER pStack = NULL;
+    while (pFirst)
+    {
+        PTMTIMER pA = pFirst;
+        PTMTIMER pB = TMTIMER_GET_NEXT(pA);
+        pA->offNext = 0;
+        pA->offPrev = 0;
+        if (pB)
+        {
+            pFirst = TMTIMER_GET_NEXT(pB);
+            pB->offNext = 0;
+            pB->offPrev = 0;
+            pA = tmTimerHeapMeld(pA, pB);
+        }
+        else
+            pFirst = NULL;
+        TMTIMER_SET_NEXT(pA, pStack);
+        pStack = pA;
+    }
+
+    /* Pass 2: Meld them right to left. */
+    PTMTIMER pRoot = pStack;
+    pStack = TMTIMER_GET_NEXT(pRoot);
+    pRoot->offNext = 0;
+    while (pStack)
+    {
+        PTMTIMER pCur = pStack;
+        pStack = TMTIMER_GET_NEXT(pCur);
+        pCur->offNext = 0;
+        pRoot = tmTimerHeapMeld(pRoot, pCur);
+    }
+    return pRoot;
+}
+
+
+/**
+ * Inserts a timer into an active timer heap.
+ *
+ * @returns The new root.
+ * @param   pRoot       The current root, NULL if empty.
+ * @param   pTimer      The timer to insert (unlinked).
+ */
+DECL_FORCE_INLINE(PTMTIMER) tmTimerHeapInsert(PTMTIMER pRoot, PTMTIMER pTimer)
+{
+    Assert(!pTimer->offNext && !pTimer->offPrev && !pTimer->offChild);
+    return pRoot ? tmTimerHeapMeld(pRoot, pTimer) : pTimer;
+}
+
+
+/**
+ * Removes a timer from an active timer heap.
+ *
+ * @returns The new root.
+ * @param   pRoot       The current root.
+ * @param   pTimer      The timer to remove.  All its links are cleared.
+ */
+DECLINLINE(PTMTIMER) tmTimerHeapRemove(PTMTIMER pRoot, PTMTIMER pTimer)
+{
+    PTMTIMER const pSubHeap = tmTimerHeapMergePairs(TMTIMER_GET_CHILD(pTimer));
+    pTimer->offChild = 0;
+    if (pTimer == pRoot)
+    {
+        Assert(!pTimer->offPrev && !pTimer->offNext);
+        return pSubHeap;
+    }
+
+    /* Cut it out of the sibling list. */
+    PTMTIMER const pPrev = TMTIMER_GET_PREV(pTimer);
+    PTMTIMER const pNext = TMTIMER_GET_NEXT(pTimer);
+    Assert(pPrev);
+    if (TMTIMER_GET_CHILD(pPrev) == pTimer)
+        TMTIMER_SET_CHILD(pPrev, pNext);
+    else
+        TMTIMER_SET_NEXT(pPrev, pNext);
+    if (pNext)
+        TMTIMER_SET_PREV(pNext, pPrev);
+    pTimer->offNext = 0;
+    pTimer->offPrev = 0;
+
+    return pSubHeap ? tmTimerHeapMeld(pRoot, pSubHeap) : pRoot;
+}
+
+
+/**
+ * Gets the next timer in a pre-order walk of an active timer heap, skipping
+ * the children of the current timer.
+ *
+ * @returns The next timer, NULL when done.
+ * @param   pCur        The current timer.
+ */
+DECLINLINE(PTMTIMER) tmTimerHeapWalkSkip(PTMTIMER pCur)
+{
+    for (;;)
+    {
+        PTMTIMER pNext = TMTIMER_GET_NEXT(pCur);
+        if (pNext)
+            return pNext;
+
+        /* Back up to the parent: find the first sibling, whose prev is the parent. */
+        PTMTIMER pPrev = TMTIMER_GET_PREV(pCur);
+        while (pPrev && TMTIMER_GET_CHILD(pPrev) != pCur)
+        {
+            pCur  = pPrev;
+            pPrev = TMTIMER_GET_PREV(pCur);
+        }
+        if (!pPrev)
+            return NULL;
+        pCur = pPrev;
+    }
+}
+
+
+/**
+ * Gets the next timer in a pre-order walk of an active timer heap.
+ *
+ * This is for enumerating all active timers, the order is not related to the
+ * expire times except that the root comes first.
+ *
+ * @returns The next timer, NULL when done.
+ * @param   pCur        The current timer.
+ */
+DECLINLINE(PTMTIMER) tmTimerHeapWalkNext(PTMTIMER pCur)
+{
+    PTMTIMER pNext = TMTIMER_GET_CHILD(pCur);
+    if (pNext)
+        return pNext;
+    return tmTimerHeapWalkSkip(pCur);
+}
+
+
+/**
+ * Finds the next timer to fire in an active timer heap.
+ *
+ * This is the ACTIVE timer with the lowest expire time not exceeding
+ * @a u64Now that hasn't fired in the current run yet.  Timers which don't
+ * qualify (pending rescheduling by another thread, or re-armed into the past
+ * by their own handler) are stepped over, only their children are examined.
+ * The subtrees of qualifying and unexpired timers are skipped since nothing
+ * in them can expire earlier.  So, this is O(1) when the root qualifies.
+ *
+ * @returns The timer, NULL if none.
+ * @param   pRoot       The heap root, NULL if empty.
+ * @param   u64Now      The current clock time.
+ * @param   uRunGen     The run generation of the current run.
+ */
+DECLINLINE(PTMTIMER) tmTimerHeapFindExpired(PTMTIMER pRoot, uint64_t u64Now, uint32_t uRunGen)
+{
+    PTMTIMER pBest = NULL;
+    PTMTIMER pCur  = pRoot;
+    while (pCur)
+    {
+        uint64_t const u64Expire = pCur->u64Expire;
+        if (u64Expire > u64Now || (pBest && u64Expire >= pBest->u64Expire))
+            pCur = tmTimerHeapWalkSkip(pCur);
+        else if (pCur->enmState == TMTIMERSTATE_ACTIVE && pCur->uRunGen != uRunGen)
+        {
+            pBest = pCur;
+            pCur  = tmTimerHeapWalkSkip(pCur);
+        }
+        else
+            pCur = tmTimerHeapWalkNext(pCur);
+    }
+    return pBest;
+}
+
+
+/**
+ * Removes a timer from the active heap of a queue, updating the cached
+ * expire time if the head changes.
+ *
+ * @param   pQueue      The timer queue.
+ * @param   pTimer      The timer that needs unlinking.
+ *
+ * @remarks Called while owning the relevant queue lock.
+ */
+DECL_FORCE_INLINE(void) tmTimerQueueRemoveActive(PTMTIMERQUEUE pQueue, PTMTIMER pTimer)
+{
+    PTMTIMER const pHead    = TMTIMER_GET_HEAD(pQueue);
+    PTMTIMER const pNewHead = tmTimerHeapRemove(pHead, pTimer);
+    if (pNewHead != pHead)
+    {
+        TMTIMER_SET_HEAD(pQueue, pNewHead);
+        pQueue->u64Expire = pNewHead ? pNewHead->u64Expire : INT64_MAX;
+        DBGFTRACE_U64_TAG(pTimer->CTX_SUFF(pVM), pQueue->u64Expire, "tmTimerQueueUnlinkActive");
+    }
+}
+
+
 /**
  * Used to unlink a timer from the active list.
  *
@@ -36,21 +270,47 @@ DECL_FORCE_INLINE(void) tmTimerQueueUnlinkActive(PTMTIMERQUEUE pQueue, PTMTIMER
            : enmState == TMTIMERSTATE_PENDING_SCHEDULE || enmState == TMTIMERSTATE_PENDING_STOP_SCHEDULE);
 #endif
 
-    const PTMTIMER pPrev = TMTIMER_GET_PREV(pTimer);
-    const PTMTIMER pNext = TMTIMER_GET_NEXT(pTimer);
-    if (pPrev)
-        TMTIMER_SET_NEXT(pPrev, pNext);
-    else
-    {
-        TMTIMER_SET_HEAD(pQueue, pNext);
-        pQueue->u64Expire = pNext ? pNext->u64Expire : INT64_MAX;
-        DBGFTRACE_U64_TAG(pTimer->CTX_SUFF(pVM), pQueue->u64Expire, "tmTimerQueueUnlinkActive");
-    }
-    if (pNext)
-        TMTIMER_SET_PREV(pNext, pPrev);
-    pTimer->offNext = 0;
-    pTimer->offPrev = 0;
+    tmTimerQueueRemoveActive(pQueue, pTimer);
 }
 
+
+/**
+ * Try take the lock serializing the active heap of the queue a timer belongs
+ * to, no waiting.
+ *
+ * This is the TM lock for the EMT queues and the queue critical section for
+ * the thread pool ones.  The latter are only accessible in ring-3.
+ *
+ * @returns true if we got the lock, false if not.
+ * @param   pVM         The cross context VM structure.
+ * @param   pTimer      The timer.
+ */
+DECL_FORCE_INLINE(bool) tmTimerTryLockQueue(PVM pVM, PTMTIMER pTimer)
+{
+    if (RT_LIKELY(!TMTIMERQUEUE_IDX_IS_POOL(pTimer->idxQueue)))
+        return RT_SUCCESS_NP(TM_TRY_LOCK_TIMERS(pVM));
+#ifdef IN_RING3
+    return RT_SUCCESS_NP(RTCritSectTryEnter(&pVM->tm.s.paTimerQueuesR3Data[pTimer->idxQueue].CritSect));
+#else
+    return false;
+#endif
+}
+
+
+/**
+ * Releases the lock taken by tmTimerTryLockQueue.
+ *
+ * @param   pVM         The cross context VM structure.
+ * @param   pTimer      The timer.
+ */
+DECL_FORCE_INLINE(void) tmTimerUnlockQueue(PVM pVM, PTMTIMER pTimer)
+{
+    if (RT_LIKELY(!TMTIMERQUEUE_IDX_IS_POOL(pTimer->idxQueue)))
+        TM_UNLOCK_TIMERS(pVM);
+#ifdef IN_RING3
+    else
+        RTCritSectLeave(&pVM->tm.s.paTimerQueuesR3Data[pTimer->idxQueue].CritSect);
 #endif
+}
 
+#endif
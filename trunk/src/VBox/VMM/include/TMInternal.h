@@ -23,6 +23,8 @@
 #include <iprt/time.h>
 #include <iprt/timer.h>
 #include <iprt/assert.h>
+#include <iprt/critsect.h>
+#include <iprt/list.h>
 #include <VBox/vmm/stam.h>
 #include <VBox/vmm/pdmcritsect.h>
 
@@ -109,8 +111,10 @@ typedef enum TMTIMERSTATE
  * For correct serialization (without the use of semaphores and
  * other blocking/slow constructs) certain rules applies to updating
  * this structure:
- *      - For thread other than EMT only u64Expire, enmState and pScheduleNext*
- *        are changeable. Everything else is out of bounds.
+ *      - For thread other than the one owning the queue lock (EMT for the
+ *        EMT queues, a timer pool thread for the pool queues) only u64Expire,
+ *        enmState and pScheduleNext* are changeable. Everything else is out
+ *        of bounds.
  *      - Updating of u64Expire timer can only happen in the TMTIMERSTATE_STOPPED
  *        and TMTIMERSTATE_PENDING_RESCHEDULING_SET_EXPIRE states.
  *      - Timers in the TMTIMERSTATE_EXPIRED state are only accessible from EMT.
@@ -174,10 +178,22 @@ typedef struct TMTIMER
     /** Timer relative offset to the next timer in the schedule list. */
     int32_t volatile        offScheduleNext;
 
-    /** Timer relative offset to the next timer in the chain. */
+    /** Timer relative offset to the next sibling in the active timer heap. */
     int32_t                 offNext;
-    /** Timer relative offset to the previous timer in the chain. */
+    /** Timer relative offset to the previous sibling in the active timer heap,
+     * or to the parent if this is the first child.  Zero for the root. */
     int32_t                 offPrev;
+    /** Timer relative offset to the first child in the active timer heap. */
+    int32_t                 offChild;
+    /** The TMTIMERQUEUE::uRunGen value of the queue run which last fired the
+     * timer.  Used for preventing timers re-armed in the past from firing more
+     * than once per run. */
+    uint32_t                uRunGen;
+    /** The index of the queue the timer belongs to (TMTIMERQUEUE_IDX_XXX).
+     * This is the clock for all but the thread pool timers. */
+    uint32_t                idxQueue;
+    /** The timer creation flags (TMTIMER_FLAGS_XXX). */
+    uint32_t                fFlags;
 
     /** Pointer to the VM the timer belongs to - R3 Ptr. */
     PVMR3                   pVMR3;
@@ -243,6 +259,10 @@ AssertCompileMemberSize(TMTIMER, enmState, sizeof(uint32_t));
 #define TMTIMER_SET_PREV(pTimer, pPrev) ((pTimer)->offPrev = (pPrev) ? (intptr_t)(pPrev) - (intptr_t)(pTimer) : 0)
 /** Set the next timer link. */
 #define TMTIMER_SET_NEXT(pTimer, pNext) ((pTimer)->offNext = (pNext) ? (intptr_t)(pNext) - (intptr_t)(pTimer) : 0)
+/** Get the first child timer. */
+#define TMTIMER_GET_CHILD(pTimer) ((PTMTIMER)((pTimer)->offChild ? (intptr_t)(pTimer) + (pTimer)->offChild : 0))
+/** Set the first child timer link. */
+#define TMTIMER_SET_CHILD(pTimer, pChild) ((pTimer)->offChild = (pChild) ? (intptr_t)(pChild) - (intptr_t)(pTimer) : 0)
 
 
 /**
@@ -256,10 +276,12 @@ typedef struct TMTIMERQUEUE
      * Updated by EMT when scheduling the queue or modifying the head timer.
      * Assigned UINT64_MAX when there is no head timer. */
     uint64_t                u64Expire;
-    /** Doubly linked list of active timers.
+    /** The root of the pairing heap of active timers.
      *
-     * When no scheduling is pending, this list is will be ordered by expire time (ascending).
-     * Access is serialized by only letting the emulation thread (EMT) do changes.
+     * When no scheduling is pending, the root is the timer with the lowest
+     * expire time.  Insertion is O(1) and removal O(log n) amortized, see
+     * tmTimerHeapInsert and tmTimerHeapRemove.  Access is serialized by only
+     * letting the emulation thread (EMT) do changes.
      *
      * The offset is relative to the queue structure.
      */
@@ -275,18 +297,84 @@ typedef struct TMTIMERQUEUE
     int32_t volatile        offSchedule;
     /** The clock for this queue. */
     TMCLOCK                 enmClock;
+    /** The run generation, incremented each time the queue is run. */
+    uint32_t                uRunGen;
+    /** The index of this queue (TMTIMERQUEUE_IDX_XXX). */
+    uint32_t                idxQueue;
     /** Pad the structure up to 32 bytes. */
-    uint32_t                au32Padding[3];
+    uint32_t                u32Padding;
 } TMTIMERQUEUE;
 
 /** Pointer to a timer queue. */
 typedef TMTIMERQUEUE *PTMTIMERQUEUE;
 
-/** Get the head of the active timer list. */
+/** Get the head (root) of the active timer heap. */
 #define TMTIMER_GET_HEAD(pQueue)        ((PTMTIMER)((pQueue)->offActive ? (intptr_t)(pQueue) + (pQueue)->offActive : 0))
-/** Set the head of the active timer list. */
+/** Set the head (root) of the active timer heap. */
 #define TMTIMER_SET_HEAD(pQueue, pHead) ((pQueue)->offActive = pHead ? (intptr_t)pHead - (intptr_t)(pQueue) : 0)
 
+/** @name Timer queue indexes (TM::paTimerQueuesR3 and friends).
+ *
+ * The first TMCLOCK_MAX queues are indexed by clock and run by the timer EMT
+ * while owning the TM lock.  The ones following them hold the timers created
+ * with TMTIMER_FLAGS_NO_EMT and are run by the timer thread pool in ring-3,
+ * each serialized by its own critical section (TMTIMERQUEUER3::CritSect).
+ * @{ */
+/** The TMCLOCK_VIRTUAL queue serviced by the timer thread pool. */
+#define TMTIMERQUEUE_IDX_POOL_VIRTUAL   TMCLOCK_MAX
+/** The TMCLOCK_REAL queue serviced by the timer thread pool. */
+#define TMTIMERQUEUE_IDX_POOL_REAL      (TMCLOCK_MAX + 1)
+/** The number of timer queues. */
+#define TMTIMERQUEUE_IDX_COUNT          (TMCLOCK_MAX + 2)
+/** Checks if a queue index refers to a thread pool queue. */
+#define TMTIMERQUEUE_IDX_IS_POOL(a_idxQueue) ((a_idxQueue) >= (uint32_t)TMCLOCK_MAX)
+/** @} */
+
+/** The max number of timer pool threads. */
+#define TM_TIMER_POOL_MAX_THREADS       16
+
+/** The number of buckets in the timer latency and jitter histograms. */
+#define TM_LATENCY_BUCKETS              16
+
+
+/**
+ * Ring-3 only timer queue data.
+ *
+ * There is one of these for each timer queue, allocated from the MM heap.  It
+ * holds the timer delivery statistics, and for the thread pool queues also the
+ * queue lock and the pool bookkeeping.
+ */
+typedef struct TMTIMERQUEUER3
+{
+    /** The lock serializing the active heap of a thread pool queue.  It takes
+     * the place of the TM lock for these.  Not initialized for EMT queues. */
+    RTCRITSECT              CritSect;
+    /** Pointer to the VM. */
+    PVMR3                   pVM;
+    /** Pointer to the queue. */
+    PTMTIMERQUEUE           pQueue;
+    /** The queue name used for statistics. */
+    const char             *pszName;
+    /** Node in the list of queues serviced by the timer thread pool. */
+    RTLISTNODE              PoolNode;
+    /** Set while a pool thread is running the queue. */
+    bool volatile           fBusy;
+    /** Set while the queue is registered with the timer thread pool. */
+    bool                    fInPool;
+    /** Explicit alignment padding. */
+    bool                    afAlignment[6];
+    /** The delivery latency of the previous timer (ns), for the jitter. */
+    uint64_t                cNsPrevLatency;
+    /** Latency histogram: nanoseconds from the expire time to the callback. */
+    STAMCOUNTER             aStatLatency[TM_LATENCY_BUCKETS];
+    /** Jitter histogram: latency change between two consecutive callbacks. */
+    STAMCOUNTER             aStatJitter[TM_LATENCY_BUCKETS];
+    /** Time spent running the queue on a pool thread. */
+    STAMPROFILE             StatPoolRun;
+} TMTIMERQUEUER3;
+/** Pointer to ring-3 only timer queue data. */
+typedef TMTIMERQUEUER3 *PTMTIMERQUEUER3;
+
 
 /**
  * CPU load data set.
@@ -493,11 +581,11 @@ typedef struct TM
      * @todo Implement warpdrive on UTC. */
     int64_t                     offUTC;
 
-    /** Timer queues for the different clock types - R3 Ptr */
+    /** Timer queues, TMTIMERQUEUE_IDX_COUNT entries - R3 Ptr */
     R3PTRTYPE(PTMTIMERQUEUE)    paTimerQueuesR3;
-    /** Timer queues for the different clock types - R0 Ptr */
+    /** Timer queues, TMTIMERQUEUE_IDX_COUNT entries - R0 Ptr */
     R0PTRTYPE(PTMTIMERQUEUE)    paTimerQueuesR0;
-    /** Timer queues for the different clock types - RC Ptr */
+    /** Timer queues, TMTIMERQUEUE_IDX_COUNT entries - RC Ptr */
     RCPTRTYPE(PTMTIMERQUEUE)    paTimerQueuesRC;
 
     /** Pointer to our RC mapping of the GIP. */
@@ -520,15 +608,21 @@ typedef struct TM
      * raise VM_FF_TIMER to pull EMTs attention to them.
      */
     R3PTRTYPE(PRTTIMER)         pTimer;
+    /** Ring-3 only data for each of the timer queues, TMTIMERQUEUE_IDX_COUNT
+     * entries. */
+    R3PTRTYPE(PTMTIMERQUEUER3)  paTimerQueuesR3Data;
     /** Interval in milliseconds of the pTimer timer. */
     uint32_t                    u32TimerMillies;
+    /** The number of timer pool threads this VM asks for, 0 if the
+     * TMTIMER_FLAGS_NO_EMT timers should be run by EMT like the rest. */
+    uint32_t                    cTimerPoolThreads;
 
     /** Indicates that queues are being run. */
     bool volatile               fRunningQueues;
     /** Indicates that the virtual sync queue is being run. */
     bool volatile               fRunningVirtualSyncQueue;
     /** Alignment */
-    bool                        afAlignment3[2];
+    bool                        afAlignment3[6];
 
     /** Lock serializing access to the timer lists. */
     PDMCRITSECT                 TimerCritSect;
@@ -753,6 +847,9 @@ typedef struct TMCPU
 typedef TMCPU *PTMCPU;
 
 const char             *tmTimerState(TMTIMERSTATE enmState);
+#ifdef IN_RING3
+void                    tmR3TimerPoolWakeUp(void);
+#endif
 void                    tmTimerQueueSchedule(PVM pVM, PTMTIMERQUEUE pQueue);
 #ifdef VBOX_STRICT
 void                    tmTimerQueuesSanityChecks(PVM pVM, const char *pszWhere);
@@ -803,6 +900,20 @@ DECLCALLBACK(DECLEXPORT(uint64_t))  tmVirtualNanoTSBadCpuIndex(PRTTIMENANOTSDATA
 #define TM_ASSERT_TIMER_LOCK_OWNERSHIP(a_pVM) \
     Assert(PDMCritSectIsOwner(&(a_pVM)->tm.s.TimerCritSect))
 
+/** Checks that the caller owns the lock serializing the given queue.
+ * The thread pool queues only exist in ring-3, and once TMR3Term has detached
+ * them from the pool (deleting the lock) only EMT touches them. */
+#ifdef IN_RING3
+# define TM_ASSERT_QUEUE_LOCK_OWNERSHIP(a_pVM, a_pQueue) \
+    Assert(  TMTIMERQUEUE_IDX_IS_POOL((a_pQueue)->idxQueue) \
+           ?    RTCritSectIsOwner(&(a_pVM)->tm.s.paTimerQueuesR3Data[(a_pQueue)->idxQueue].CritSect) \
+             || !RTCritSectIsInitialized(&(a_pVM)->tm.s.paTimerQueuesR3Data[(a_pQueue)->idxQueue].CritSect) \
+           : PDMCritSectIsOwner(&(a_pVM)->tm.s.TimerCritSect))
+#else
+# define TM_ASSERT_QUEUE_LOCK_OWNERSHIP(a_pVM, a_pQueue) \
+    do { Assert(!TMTIMERQUEUE_IDX_IS_POOL((a_pQueue)->idxQueue)); TM_ASSERT_TIMER_LOCK_OWNERSHIP(a_pVM); } while (0)
+#endif
+
 /** @} */
 
 RT_C_DECLS_END
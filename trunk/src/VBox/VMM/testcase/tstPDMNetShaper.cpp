@@ -0,0 +1,633 @@
+/* $Id$ */
+/** @file
+ * PDM Network Shaper Testcase - Bucket refill, group hierarchy and weighted sharing.
+ *
+ * Includes the shaper code and runs it against a fake VM, a fake configuration
+ * tree and a clock the test moves by hand.  The TX thread is not started, the
+ * test serves the groups itself.
+ */
+
+/*
+ * Copyright (C) 2016 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ */
+
+
+/*********************************************************************************************************************************
+*   Header Files                                                                                                                 *
+*********************************************************************************************************************************/
+#include <iprt/time.h>
+
+/** The fake clock (RTTimeSystemNanoTS). */
+static uint64_t g_tsNow = RT_NS_1SEC;
+#define RTTimeSystemNanoTS() (g_tsNow)
+
+#include "../VMMAll/PDMAllNetShaper.cpp"
+#undef LOG_GROUP
+#include "../VMMR3/PDMNetShaper.cpp"
+
+#include <iprt/initterm.h>
+#include <iprt/test.h>
+
+
+/*********************************************************************************************************************************
+*   Structures and Typedefs                                                                                                      *
+*********************************************************************************************************************************/
+/**
+ * A bandwidth group in the fake configuration.
+ */
+typedef struct TSTCFGBWGROUP
+{
+    const char     *pszName;
+    uint64_t        cbMax;
+    uint32_t        cbBurst;
+    const char     *pszParent;
+} TSTCFGBWGROUP;
+
+/** The levels of the fake configuration tree. */
+typedef enum TSTCFGLEVEL
+{
+    kTstCfgLevel_Root = 0,
+    kTstCfgLevel_PDM,
+    kTstCfgLevel_NetworkShaper,
+    kTstCfgLevel_BwGroups,
+    kTstCfgLevel_BwGroup
+} TSTCFGLEVEL;
+
+/**
+ * A node of the fake configuration tree.
+ */
+typedef struct CFGMNODE
+{
+    TSTCFGLEVEL     enmLevel;
+    /** The group index for kTstCfgLevel_BwGroup. */
+    unsigned        iGroup;
+} CFGMNODE;
+
+/**
+ * A fake network driver above a filter.
+ */
+typedef struct TSTNETDOWN
+{
+    PDMINETWORKDOWN INetworkDown;
+    /** Number of pfnXmitPending calls. */
+    uint32_t        cXmitPending;
+} TSTNETDOWN;
+
+
+/*********************************************************************************************************************************
+*   Global Variables                                                                                                             *
+*********************************************************************************************************************************/
+/** The test handle.*/
+static RTTEST                   g_hTest;
+/** The bandwidth groups in the fake configuration. */
+static TSTCFGBWGROUP const     *g_paCfgBwGroups;
+/** Number of entries in g_paCfgBwGroups. */
+static unsigned                 g_cCfgBwGroups;
+/** The fixed nodes of the fake configuration tree. */
+static CFGMNODE                 g_aCfgNodes[kTstCfgLevel_BwGroup] =
+{
+    { kTstCfgLevel_Root, 0 }, { kTstCfgLevel_PDM, 0 }, { kTstCfgLevel_NetworkShaper, 0 }, { kTstCfgLevel_BwGroups, 0 }
+};
+/** The group nodes of the fake configuration tree. */
+static CFGMNODE                 g_aCfgGroupNodes[PDM_NETSHAPER_MAX_DEPTH + 2];
+/** Number of SUPSemEventSignal calls, i.e. TX thread wakeups. */
+static uint32_t                 g_cWakeups;
+/** Critical section PDMCritSectEnter pretends is owned by someone else, like
+ * it can be in ring-0. */
+static PPDMCRITSECT             g_pCritSectBusy;
+
+
+/*
+ *
+ * Fake VMM and support driver APIs.
+ *
+ */
+
+/* PDMCRITSECT starts with an RTCRITSECT, which is all we need here. */
+#undef PDMCritSectEnter
+VMMDECL(int) PDMCritSectEnter(PPDMCRITSECT pCritSect, int rcBusy)
+{
+    if (pCritSect == g_pCritSectBusy && rcBusy != VERR_IGNORED)
+        return rcBusy;
+    return RTCritSectEnter((PRTCRITSECT)pCritSect);
+}
+
+VMMDECL(int) PDMCritSectEnterDebug(PPDMCRITSECT pCritSect, int rcBusy, RTHCUINTPTR uId, RT_SRC_POS_DECL)
+{
+    RT_NOREF(uId); RT_SRC_POS_NOREF();
+    return PDMCritSectEnter(pCritSect, rcBusy);
+}
+
+VMMDECL(int) PDMCritSectLeave(PPDMCRITSECT pCritSect)
+{
+    return RTCritSectLeave((PRTCRITSECT)pCritSect);
+}
+
+VMMDECL(bool) PDMCritSectIsInitialized(PCPDMCRITSECT pCritSect)
+{
+    return RTCritSectIsInitialized((PCRTCRITSECT)pCritSect);
+}
+
+VMMR3DECL(int) PDMR3CritSectInit(PVM pVM, PPDMCRITSECT pCritSect, RT_SRC_POS_DECL, const char *pszNameFmt, ...)
+{
+    RT_NOREF(pVM, pszNameFmt); RT_SRC_POS_NOREF();
+    return RTCritSectInit((PRTCRITSECT)pCritSect);
+}
+
+VMMR3DECL(int) PDMR3CritSectDelete(PPDMCRITSECT pCritSect)
+{
+    return RTCritSectDelete((PRTCRITSECT)pCritSect);
+}
+
+VMMR3DECL(int) PDMR3ThreadCreate(PVM pVM, PPPDMTHREAD ppThread, void *pvUser, PFNPDMTHREADINT pfnThread,
+                                 PFNPDMTHREADWAKEUPINT pfnWakeUp, size_t cbStack, RTTHREADTYPE enmType, const char *pszName)
+{
+    RT_NOREF(pVM, pvUser, pfnThread, pfnWakeUp, cbStack, enmType, pszName);
+    *ppThread = NULL;
+    return VINF_SUCCESS;
+}
+
+VMMDECL(int) MMHyperAlloc(PVM pVM, size_t cb, uint32_t uAlignment, MMTAG enmTag, void **ppv)
+{
+    RT_NOREF(pVM, uAlignment, enmTag);
+    *ppv = RTMemAllocZ(cb);
+    return *ppv ? VINF_SUCCESS : VERR_NO_MEMORY;
+}
+
+VMMDECL(int) MMHyperFree(PVM pVM, void *pv)
+{
+    RT_NOREF(pVM);
+    RTMemFree(pv);
+    return VINF_SUCCESS;
+}
+
+VMMDECL(RTR0PTR) MMHyperR3ToR0(PVM pVM, RTR3PTR R3Ptr)
+{
+    RT_NOREF(pVM);
+    return (RTR0PTR)R3Ptr;
+}
+
+VMMR3DECL(int) MMR3HeapAllocZEx(PVM pVM, MMTAG enmTag, size_t cbSize, void **ppv)
+{
+    RT_NOREF(pVM, enmTag);
+    *ppv = RTMemAllocZ(cbSize);
+    return *ppv ? VINF_SUCCESS : VERR_NO_MEMORY;
+}
+
+VMMR3DECL(char *) MMR3HeapStrDup(PVM pVM, MMTAG enmTag, const char *psz)
+{
+    RT_NOREF(pVM, enmTag);
+    return RTStrDup(psz);
+}
+
+VMMR3DECL(void) MMR3HeapFree(void *pv)
+{
+    RTMemFree(pv);
+}
+
+VMMDECL(PVMCPU) VMMGetCpu(PVM pVM)
+{
+    return &pVM->aCpus[0];
+}
+
+VMMR3DECL(RTNATIVETHREAD) VMR3GetVMCPUNativeThread(PVM pVM)
+{
+    RT_NOREF(pVM);
+    return RTThreadNativeSelf();
+}
+
+SUPDECL(int) SUPSemEventCreate(PSUPDRVSESSION pSession, PSUPSEMEVENT phEvent)
+{
+    RT_NOREF(pSession);
+    *phEvent = (SUPSEMEVENT)(uintptr_t)0x42;
+    return VINF_SUCCESS;
+}
+
+SUPDECL(int) SUPSemEventClose(PSUPDRVSESSION pSession, SUPSEMEVENT hEvent)
+{
+    RT_NOREF(pSession, hEvent);
+    return VINF_SUCCESS;
+}
+
+SUPDECL(int) SUPSemEventSignal(PSUPDRVSESSION pSession, SUPSEMEVENT hEvent)
+{
+    RT_NOREF(pSession, hEvent);
+    g_cWakeups++;
+    return VINF_SUCCESS;
+}
+
+SUPDECL(int) SUPSemEventWaitNoResume(PSUPDRVSESSION pSession, SUPSEMEVENT hEvent, uint32_t cMillies)
+{
+    RT_NOREF(pSession, hEvent, cMillies);
+    return VERR_TIMEOUT;
+}
+
+SUPDECL(int) SUPSemEventWaitNsRelIntr(PSUPDRVSESSION pSession, SUPSEMEVENT hEvent, uint64_t cNsTimeout)
+{
+    RT_NOREF(pSession, hEvent, cNsTimeout);
+    return VERR_TIMEOUT;
+}
+
+
+/*
+ *
+ * Fake configuration tree: PDM/NetworkShaper/BwGroups/<g_paCfgBwGroups>.
+ *
+ */
+
+VMMR3DECL(PCFGMNODE) CFGMR3GetRoot(PVM pVM)
+{
+    RT_NOREF(pVM);
+    return &g_aCfgNodes[kTstCfgLevel_Root];
+}
+
+VMMR3DECL(PCFGMNODE) CFGMR3GetChild(PCFGMNODE pNode, const char *pszPath)
+{
+    static const char * const s_apszNames[] = { "", "PDM", "NetworkShaper", "BwGroups" };
+    if (   !pNode
+        || pNode->enmLevel + 1 >= kTstCfgLevel_BwGroup
+        || strcmp(pszPath, s_apszNames[pNode->enmLevel + 1]))
+        return NULL;
+    return &g_aCfgNodes[pNode->enmLevel + 1];
+}
+
+VMMR3DECL(PCFGMNODE) CFGMR3GetFirstChild(PCFGMNODE pNode)
+{
+    if (!pNode || pNode->enmLevel != kTstCfgLevel_BwGroups || !g_cCfgBwGroups)
+        return NULL;
+    return &g_aCfgGroupNodes[0];
+}
+
+VMMR3DECL(PCFGMNODE) CFGMR3GetNextChild(PCFGMNODE pCur)
+{
+    if (pCur->enmLevel != kTstCfgLevel_BwGroup || pCur->iGroup + 1 >= g_cCfgBwGroups)
+        return NULL;
+    return &g_aCfgGroupNodes[pCur->iGroup + 1];
+}
+
+VMMR3DECL(size_t) CFGMR3GetNameLen(PCFGMNODE pCur)
+{
+    return strlen(g_paCfgBwGroups[pCur->iGroup].pszName);
+}
+
+VMMR3DECL(int) CFGMR3GetName(PCFGMNODE pCur, char *pszName, size_t cchName)
+{
+    return RTStrCopy(pszName, cchName, g_paCfgBwGroups[pCur->iGroup].pszName);
+}
+
+VMMR3DECL(int) CFGMR3QueryU64(PCFGMNODE pNode, const char *pszName, uint64_t *pu64)
+{
+    RTTEST_CHECK(g_hTest, !strcmp(pszName, "Max"));
+    *pu64 = g_paCfgBwGroups[pNode->iGroup].cbMax;
+    return VINF_SUCCESS;
+}
+
+VMMR3DECL(int) CFGMR3QueryU32Def(PCFGMNODE pNode, const char *pszName, uint32_t *pu32, uint32_t u32Def)
+{
+    RTTEST_CHECK(g_hTest, !strcmp(pszName, "Burst"));
+    uint32_t const cbBurst = g_paCfgBwGroups[pNode->iGroup].cbBurst;
+    *pu32 = cbBurst ? cbBurst : u32Def;
+    return VINF_SUCCESS;
+}
+
+VMMR3DECL(int) CFGMR3QueryStringAlloc(PCFGMNODE pNode, const char *pszName, char **ppszString)
+{
+    RTTEST_CHECK(g_hTest, !strcmp(pszName, "Parent"));
+    const char *pszParent = g_paCfgBwGroups[pNode->iGroup].pszParent;
+    if (!pszParent)
+        return VERR_CFGM_VALUE_NOT_FOUND;
+    *ppszString = RTStrDup(pszParent);
+    return *ppszString ? VINF_SUCCESS : VERR_NO_MEMORY;
+}
+
+
+/*
+ *
+ * Helpers.
+ *
+ */
+
+/**
+ * @interface_method_impl{PDMINETWORKDOWN,pfnXmitPending}
+ */
+static DECLCALLBACK(void) tstNetDownXmitPending(PPDMINETWORKDOWN pInterface)
+{
+    RT_FROM_MEMBER(pInterface, TSTNETDOWN, INetworkDown)->cXmitPending++;
+}
+
+/**
+ * Sets up the shaper with the given groups in the configuration.
+ *
+ * @returns VBox status code from pdmR3NetShaperInit.
+ */
+static int tstShaperInit(PVM pVM, TSTCFGBWGROUP const *paGroups, unsigned cGroups)
+{
+    RTTEST_CHECK_RET(g_hTest, cGroups <= RT_ELEMENTS(g_aCfgGroupNodes), VERR_BUFFER_OVERFLOW);
+    g_paCfgBwGroups = paGroups;
+    g_cCfgBwGroups  = cGroups;
+    for (unsigned i = 0; i < cGroups; i++)
+    {
+        g_aCfgGroupNodes[i].enmLevel = kTstCfgLevel_BwGroup;
+        g_aCfgGroupNodes[i].iGroup   = i;
+    }
+    return pdmR3NetShaperInit(pVM);
+}
+
+/**
+ * Initializes a filter with a fake driver above it and attaches it.
+ */
+static void tstFilterAttach(PVM pVM, PPDMNSFILTER pFilter, TSTNETDOWN *pNetDown, const char *pszBwGroup, uint32_t uWeight)
+{
+    RT_ZERO(*pFilter);
+    RT_ZERO(*pNetDown);
+    pNetDown->INetworkDown.pfnXmitPending = tstNetDownXmitPending;
+    pFilter->pIDrvNetR3 = &pNetDown->INetworkDown;
+    pFilter->uWeight    = uWeight;
+    RTTEST_CHECK_RC(g_hTest, PDMR3NsAttach(pVM->pUVM, NULL, pszBwGroup, pFilter), VINF_SUCCESS);
+}
+
+/**
+ * Returns the tokens in the bucket of a group right now.
+ */
+static uint32_t tstPeekTokens(PVM pVM, const char *pszBwGroup)
+{
+    PPDMNSBWGROUP pBwGroup = pdmNsBwGroupFindById(pVM->pUVM->pdm.s.pNetShaper, pszBwGroup);
+    RTTEST_CHECK_RET(g_hTest, pBwGroup, 0);
+    return pdmNsBwGroupPeekTokens(pBwGroup, g_tsNow);
+}
+
+/**
+ * Does what one round of the TX thread does for a group.
+ *
+ * @returns See pdmNsBwGroupServe.
+ */
+static uint64_t tstServe(PVM pVM, const char *pszBwGroup)
+{
+    PPDMNETSHAPER pShaper  = pVM->pUVM->pdm.s.pNetShaper;
+    PPDMNSBWGROUP pBwGroup = pdmNsBwGroupFindById(pShaper, pszBwGroup);
+    RTTEST_CHECK_RET(g_hTest, pBwGroup, 0);
+    RTCritSectEnter(&pShaper->Lock);
+    uint64_t cNsWait = pdmNsBwGroupServe(pBwGroup, g_tsNow);
+    RTCritSectLeave(&pShaper->Lock);
+    return cNsWait;
+}
+
+
+/*
+ *
+ * The tests.
+ *
+ */
+
+/**
+ * A bucket holding more than a second worth of tokens must refill at the
+ * configured rate and not jump to full after a second.
+ */
+static void tstBurst(PVM pVM)
+{
+    RTTestSub(g_hTest, "Burst larger than the rate");
+
+    static TSTCFGBWGROUP const s_aGroups[] =
+    {
+        { "burst", 100000, 1000000, NULL },
+    };
+    RTTEST_CHECK_RC_RETV(g_hTest, tstShaperInit(pVM, s_aGroups, RT_ELEMENTS(s_aGroups)), VINF_SUCCESS);
+
+    PDMNSFILTER Filter;
+    TSTNETDOWN  NetDown;
+    tstFilterAttach(pVM, &Filter, &NetDown, "burst", 1);
+
+    /* The full burst goes out at once, then nothing. */
+    RTTEST_CHECK(g_hTest, tstPeekTokens(pVM, "burst") == 1000000);
+    RTTEST_CHECK(g_hTest, PDMNsAllocateBandwidth(&Filter, 1000000));
+    uint32_t const cWakeups = g_cWakeups;
+    RTTEST_CHECK(g_hTest, !PDMNsAllocateBandwidth(&Filter, 1));
+    RTTEST_CHECK(g_hTest, Filter.fChoked);
+    RTTEST_CHECK(g_hTest, g_cWakeups == cWakeups + 1);
+
+    /* One second later there is one second worth of tokens, not a full bucket. */
+    g_tsNow += RT_NS_1SEC;
+    RTTEST_CHECK_MSG(g_hTest, tstPeekTokens(pVM, "burst") == 100000,
+                     (g_hTest, "tokens=%u\n", tstPeekTokens(pVM, "burst")));
+    RTTEST_CHECK(g_hTest, !PDMNsAllocateBandwidth(&Filter, 100001));
+    RTTEST_CHECK(g_hTest, PDMNsAllocateBandwidth(&Filter, 100000));
+    RTTEST_CHECK(g_hTest, tstPeekTokens(pVM, "burst") == 0);
+
+    /* Half a second later half of that, and after a long pause the bucket is full again. */
+    g_tsNow += RT_NS_1SEC / 2;
+    RTTEST_CHECK(g_hTest, tstPeekTokens(pVM, "burst") == 50000);
+    g_tsNow += 9 * RT_NS_1SEC_64 + RT_NS_1SEC / 2;
+    RTTEST_CHECK(g_hTest, tstPeekTokens(pVM, "burst") == 1000000);
+    g_tsNow += 3600 * RT_NS_1SEC_64;
+    RTTEST_CHECK(g_hTest, tstPeekTokens(pVM, "burst") == 1000000);
+
+    RTTEST_CHECK_RC(g_hTest, PDMR3NsDetach(pVM->pUVM, NULL, &Filter), VINF_SUCCESS);
+    RTTEST_CHECK_RC(g_hTest, pdmR3NetShaperTerm(pVM), VINF_SUCCESS);
+}
+
+/**
+ * A transfer needs tokens in every group up to the root, and broken
+ * hierarchies are refused.
+ */
+static void tstHierarchy(PVM pVM)
+{
+    RTTestSub(g_hTest, "Hierarchy");
+
+    /* The children come before their parents on purpose. */
+    static TSTCFGBWGROUP const s_aGroups[] =
+    {
+        { "nic",    10000000, 0, "tenant" },
+        { "tenant", 10000000, 0, "host"   },
+        { "host",     200000, 0, NULL     },
+    };
+    RTTEST_CHECK_RC_RETV(g_hTest, tstShaperInit(pVM, s_aGroups, RT_ELEMENTS(s_aGroups)), VINF_SUCCESS);
+
+    PDMNSFILTER Filter;
+    TSTNETDOWN  NetDown;
+    tstFilterAttach(pVM, &Filter, &NetDown, "nic", 1);
+
+    /* The root has the smallest bucket and limits the whole chain. */
+    RTTEST_CHECK(g_hTest, tstPeekTokens(pVM, "host") == PDM_NETSHAPER_MIN_BUCKET_SIZE);
+    RTTEST_CHECK(g_hTest, tstPeekTokens(pVM, "nic")  == 1000000);
+    RTTEST_CHECK(g_hTest, PDMNsAllocateBandwidth(&Filter, PDM_NETSHAPER_MIN_BUCKET_SIZE));
+    RTTEST_CHECK(g_hTest, tstPeekTokens(pVM, "nic")    == 1000000 - PDM_NETSHAPER_MIN_BUCKET_SIZE);
+    RTTEST_CHECK(g_hTest, tstPeekTokens(pVM, "tenant") == 1000000 - PDM_NETSHAPER_MIN_BUCKET_SIZE);
+    RTTEST_CHECK(g_hTest, tstPeekTokens(pVM, "host")   == 0);
+    RTTEST_CHECK(g_hTest, !PDMNsAllocateBandwidth(&Filter, 1));
+
+    /* The TX thread waits for the root to refill, at the root's rate. */
+    uint64_t cNsWait = tstServe(pVM, "nic");
+    RTTEST_CHECK_MSG(g_hTest, cNsWait == RT_NS_1SEC / 200000, (g_hTest, "cNsWait=%RU64\n", cNsWait));
+    RTTEST_CHECK(g_hTest, NetDown.cXmitPending == 0);
+
+    /* 100 ms later the root has 20000 bytes, which all go to the one filter. */
+    g_tsNow += RT_NS_100MS;
+    RTTEST_CHECK(g_hTest, tstServe(pVM, "nic") == 0);
+    RTTEST_CHECK(g_hTest, NetDown.cXmitPending == 1);
+    RTTEST_CHECK(g_hTest, !Filter.fChoked);
+    RTTEST_CHECK(g_hTest, Filter.cbCredit == 20000);
+    RTTEST_CHECK(g_hTest, tstPeekTokens(pVM, "host") == 0);
+    RTTEST_CHECK(g_hTest, PDMNsAllocateBandwidth(&Filter, 20000));
+    RTTEST_CHECK(g_hTest, !PDMNsAllocateBandwidth(&Filter, 1));
+
+    RTTEST_CHECK_RC(g_hTest, PDMR3NsDetach(pVM->pUVM, NULL, &Filter), VINF_SUCCESS);
+    RTTEST_CHECK_RC(g_hTest, pdmR3NetShaperTerm(pVM), VINF_SUCCESS);
+
+    /* Loops, missing parents and too deep hierarchies. */
+    static TSTCFGBWGROUP const s_aLoop[] =
+    {
+        { "a", 100000, 0, "b" },
+        { "b", 100000, 0, "a" },
+    };
+    RTTEST_CHECK_RC(g_hTest, tstShaperInit(pVM, s_aLoop, RT_ELEMENTS(s_aLoop)), VERR_INVALID_PARAMETER);
+    RTTEST_CHECK(g_hTest, !pVM->pUVM->pdm.s.pNetShaper);
+
+    static TSTCFGBWGROUP const s_aOrphan[] =
+    {
+        { "a", 100000, 0, "nowhere" },
+    };
+    RTTEST_CHECK_RC(g_hTest, tstShaperInit(pVM, s_aOrphan, RT_ELEMENTS(s_aOrphan)), VERR_NOT_FOUND);
+
+    static TSTCFGBWGROUP const s_aDeep[PDM_NETSHAPER_MAX_DEPTH + 1] =
+    {
+        { "l0", 100000, 0, "l1" },
+        { "l1", 100000, 0, "l2" },
+        { "l2", 100000, 0, "l3" },
+        { "l3", 100000, 0, "l4" },
+        { "l4", 100000, 0, NULL },
+    };
+    RTTEST_CHECK_RC(g_hTest, tstShaperInit(pVM, s_aDeep, RT_ELEMENTS(s_aDeep)), VERR_INVALID_PARAMETER);
+    RTTEST_CHECK_RC(g_hTest, tstShaperInit(pVM, &s_aDeep[1], RT_ELEMENTS(s_aDeep) - 1), VINF_SUCCESS);
+    RTTEST_CHECK_RC(g_hTest, pdmR3NetShaperTerm(pVM), VINF_SUCCESS);
+}
+
+/**
+ * A transfer can't be charged to an ancestor whose lock is busy, so it must
+ * be deferred to the TX thread instead of going out for free.
+ */
+static void tstBusyAncestor(PVM pVM)
+{
+    RTTestSub(g_hTest, "Busy ancestor");
+
+    static TSTCFGBWGROUP const s_aGroups[] =
+    {
+        { "nic",  10000000, 0, "host" },
+        { "host",   200000, 0, NULL   },
+    };
+    RTTEST_CHECK_RC_RETV(g_hTest, tstShaperInit(pVM, s_aGroups, RT_ELEMENTS(s_aGroups)), VINF_SUCCESS);
+
+    PDMNSFILTER Filter;
+    TSTNETDOWN  NetDown;
+    tstFilterAttach(pVM, &Filter, &NetDown, "nic", 1);
+
+    PPDMNSBWGROUP pHost = pdmNsBwGroupFindById(pVM->pUVM->pdm.s.pNetShaper, "host");
+    RTTEST_CHECK_RETV(g_hTest, pHost);
+    uint32_t const cbNic  = tstPeekTokens(pVM, "nic");
+    uint32_t const cbHost = tstPeekTokens(pVM, "host");
+
+    /* Nothing is taken from any bucket and the TX thread is told about it. */
+    uint32_t const cWakeups = g_cWakeups;
+    g_pCritSectBusy = &pHost->Lock;
+    RTTEST_CHECK(g_hTest, !PDMNsAllocateBandwidth(&Filter, 1000));
+    g_pCritSectBusy = NULL;
+    RTTEST_CHECK(g_hTest, Filter.fChoked);
+    RTTEST_CHECK(g_hTest, g_cWakeups == cWakeups + 1);
+    RTTEST_CHECK(g_hTest, tstPeekTokens(pVM, "nic") == cbNic);
+    RTTEST_CHECK(g_hTest, tstPeekTokens(pVM, "host") == cbHost);
+
+    /* The TX thread charges the whole chain and lets the filter go again. */
+    RTTEST_CHECK(g_hTest, tstServe(pVM, "nic") == 0);
+    RTTEST_CHECK(g_hTest, NetDown.cXmitPending == 1);
+    RTTEST_CHECK(g_hTest, !Filter.fChoked);
+    RTTEST_CHECK(g_hTest, Filter.cbCredit >= 1000);
+    RTTEST_CHECK(g_hTest, tstPeekTokens(pVM, "host") == cbHost - Filter.cbCredit);
+    RTTEST_CHECK(g_hTest, PDMNsAllocateBandwidth(&Filter, 1000));
+
+    RTTEST_CHECK_RC(g_hTest, PDMR3NsDetach(pVM->pUVM, NULL, &Filter), VINF_SUCCESS);
+    RTTEST_CHECK_RC(g_hTest, pdmR3NetShaperTerm(pVM), VINF_SUCCESS);
+}
+
+/**
+ * Filters competing for a group share it in proportion to their weights.
+ */
+static void tstWeights(PVM pVM)
+{
+    RTTestSub(g_hTest, "Weights");
+
+    static TSTCFGBWGROUP const s_aGroups[] =
+    {
+        { "shared", 400000, 0, NULL },
+    };
+    RTTEST_CHECK_RC_RETV(g_hTest, tstShaperInit(pVM, s_aGroups, RT_ELEMENTS(s_aGroups)), VINF_SUCCESS);
+
+    PDMNSFILTER Filter1, Filter3;
+    TSTNETDOWN  NetDown1, NetDown3;
+    tstFilterAttach(pVM, &Filter1, &NetDown1, "shared", 1);
+    tstFilterAttach(pVM, &Filter3, &NetDown3, "shared", 3);
+
+    /* Drain the bucket, then have both filters choke. */
+    RTTEST_CHECK(g_hTest, PDMNsAllocateBandwidth(&Filter1, PDM_NETSHAPER_MIN_BUCKET_SIZE));
+    RTTEST_CHECK(g_hTest, !PDMNsAllocateBandwidth(&Filter1, 40000));
+    RTTEST_CHECK(g_hTest, !PDMNsAllocateBandwidth(&Filter3, 40000));
+    RTTEST_CHECK(g_hTest, Filter1.fChoked && Filter3.fChoked);
+
+    /* Nothing is handed out until the largest pending transfer fits. */
+    RTTEST_CHECK(g_hTest, tstServe(pVM, "shared") == RT_NS_100MS);
+    RTTEST_CHECK(g_hTest, Filter1.cbCredit == 0 && Filter3.cbCredit == 0);
+    g_tsNow += RT_NS_100MS;
+    RTTEST_CHECK(g_hTest, tstServe(pVM, "shared") == 0);
+    RTTEST_CHECK_MSG(g_hTest, Filter1.cbCredit == 10000 && Filter3.cbCredit == 30000,
+                     (g_hTest, "cbCredit: %u and %u\n", Filter1.cbCredit, Filter3.cbCredit));
+    RTTEST_CHECK(g_hTest, NetDown1.cXmitPending == 1 && NetDown3.cXmitPending == 1);
+    RTTEST_CHECK(g_hTest, !Filter1.fChoked && !Filter3.fChoked);
+    RTTEST_CHECK(g_hTest, tstPeekTokens(pVM, "shared") == 0);
+
+    /* The credit is spent before the bucket, which is empty. */
+    RTTEST_CHECK(g_hTest, PDMNsAllocateBandwidth(&Filter3, 30000));
+    RTTEST_CHECK(g_hTest, Filter3.cbCredit == 0);
+    RTTEST_CHECK(g_hTest, !PDMNsAllocateBandwidth(&Filter1, 10001));
+    RTTEST_CHECK(g_hTest, Filter1.cbCredit == 10000);
+    RTTEST_CHECK(g_hTest, PDMNsAllocateBandwidth(&Filter1, 10000));
+    RTTEST_CHECK(g_hTest, Filter1.cbCredit == 0);
+
+    RTTEST_CHECK_RC(g_hTest, PDMR3NsDetach(pVM->pUVM, NULL, &Filter1), VINF_SUCCESS);
+    RTTEST_CHECK_RC(g_hTest, PDMR3NsDetach(pVM->pUVM, NULL, &Filter3), VINF_SUCCESS);
+    RTTEST_CHECK_RC(g_hTest, pdmR3NetShaperTerm(pVM), VINF_SUCCESS);
+}
+
+
+int main()
+{
+    RTEXITCODE rcExit = RTTestInitAndCreate("tstPDMNetShaper", &g_hTest);
+    if (rcExit != RTEXITCODE_SUCCESS)
+        return rcExit;
+    RTTestBanner(g_hTest);
+
+    /*
+     * Just enough of a VM for the shaper.
+     */
+    PVM  pVM  = (PVM)RTMemPageAllocZ(RT_ALIGN_Z(sizeof(VM), PAGE_SIZE));
+    PUVM pUVM = (PUVM)RTMemPageAllocZ(RT_ALIGN_Z(sizeof(UVM), PAGE_SIZE));
+    RTTEST_CHECK_RET(g_hTest, pVM && pUVM, RTTestSummaryAndDestroy(g_hTest));
+    pVM->pUVM       = pUVM;
+    pVM->cCpus      = 1;
+    pUVM->pVM       = pVM;
+    pUVM->u32Magic  = UVM_MAGIC;
+
+    tstBurst(pVM);
+    tstHierarchy(pVM);
+    tstBusyAncestor(pVM);
+    tstWeights(pVM);
+
+    RTMemPageFree(pUVM, RT_ALIGN_Z(sizeof(UVM), PAGE_SIZE));
+    RTMemPageFree(pVM, RT_ALIGN_Z(sizeof(VM), PAGE_SIZE));
+    return RTTestSummaryAndDestroy(g_hTest);
+}
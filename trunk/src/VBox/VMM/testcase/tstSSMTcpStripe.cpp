@@ -0,0 +1,295 @@
+/* $Id$ */
+/** @file
+ * Saved State Manager Testcase: Striped TCP stream loopback benchmark.
+ */
+
+/*
+ * Copyright (C) 2016 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ */
+
+
+/*********************************************************************************************************************************
+*   Header Files                                                                                                                 *
+*********************************************************************************************************************************/
+#include <VBox/vmm/ssm.h>
+#include <VBox/err.h>
+
+#include <iprt/getopt.h>
+#include <iprt/initterm.h>
+#include <iprt/mem.h>
+#include <iprt/rand.h>
+#include <iprt/string.h>
+#include <iprt/tcp.h>
+#include <iprt/test.h>
+#include <iprt/thread.h>
+#include <iprt/time.h>
+
+
+/*********************************************************************************************************************************
+*   Structures and Typedefs                                                                                                      *
+*********************************************************************************************************************************/
+/** Arguments for the receiving thread. */
+typedef struct TSTRECVARGS
+{
+    /** The TCP server to accept the control connection on. */
+    PRTTCPSERVER    hServer;
+    /** Number of data connections. */
+    uint32_t        cConns;
+    /** Number of streams to receive over the stripe. */
+    uint32_t        cStreams;
+    /** The number of bytes to expect per stream. */
+    uint64_t        cbStream;
+    /** The status of the receiver. */
+    int             rc;
+} TSTRECVARGS;
+
+
+/*********************************************************************************************************************************
+*   Global Variables                                                                                                             *
+*********************************************************************************************************************************/
+static RTTEST   g_hTest;
+/** The size of the SSM stream buffers we emulate. */
+static size_t   g_cbChunk = _64K;
+
+
+/**
+ * Fills a chunk with a pattern derived from the stream offset.
+ */
+static void tstFillChunk(uint8_t *pb, size_t cb, uint64_t offStream)
+{
+    uint64_t *pu64 = (uint64_t *)pb;
+    for (size_t i = 0; i < cb / sizeof(uint64_t); i++)
+        pu64[i] = offStream + i * sizeof(uint64_t);
+}
+
+
+/**
+ * Checks a chunk filled by tstFillChunk, sampling a few qwords only so the
+ * verification doesn't dominate the measurement.
+ */
+static bool tstCheckChunk(uint8_t const *pb, size_t cb, uint64_t offStream)
+{
+    uint64_t const *pu64 = (uint64_t const *)pb;
+    size_t const    cQwords = cb / sizeof(uint64_t);
+    for (size_t i = 0; i < cQwords; i += 509)
+        if (pu64[i] != offStream + i * sizeof(uint64_t))
+            return false;
+    return !cQwords || pu64[cQwords - 1] == offStream + (cQwords - 1) * sizeof(uint64_t);
+}
+
+
+/**
+ * @callback_method_impl{FNRTTHREAD, The receiving end.}
+ */
+static DECLCALLBACK(int) tstRecvThread(RTTHREAD hThreadSelf, void *pvUser)
+{
+    TSTRECVARGS *pArgs = (TSTRECVARGS *)pvUser;
+    RT_NOREF(hThreadSelf);
+
+    RTSOCKET hCtrl;
+    int rc = RTTcpServerListen2(pArgs->hServer, &hCtrl);
+    if (RT_FAILURE(rc))
+        return pArgs->rc = rc;
+
+    PSSMTCPSTRIPE pStripe;
+    rc = SSMR3TcpStripeListen(hCtrl, "127.0.0.1", pArgs->cConns, false /*fWrite*/, &pStripe);
+    if (RT_SUCCESS(rc))
+    {
+        PCSSMSTRMOPS pOps  = SSMR3TcpStripeGetOps();
+        uint8_t     *pbBuf = (uint8_t *)RTMemAlloc(g_cbChunk);
+        for (uint32_t iStream = 0; iStream < pArgs->cStreams && RT_SUCCESS(rc) && pbBuf; iStream++)
+        {
+            if (iStream > 0)
+                rc = SSMR3TcpStripeReset(pStripe);
+            uint64_t offStream = 0;
+            while (RT_SUCCESS(rc))
+            {
+                rc = pOps->pfnRead(pStripe, offStream, pbBuf, g_cbChunk, NULL);
+                if (RT_FAILURE(rc))
+                    break;
+                if (!tstCheckChunk(pbBuf, g_cbChunk, offStream))
+                {
+                    RTTestFailed(g_hTest, "Data mismatch at offset %#RX64 (stream #%u)", offStream, iStream);
+                    rc = VERR_MISMATCH;
+                }
+                offStream += g_cbChunk;
+            }
+            if (rc == VERR_EOF)
+            {
+                rc = VINF_SUCCESS;
+                if (offStream != pArgs->cbStream)
+                {
+                    RTTestFailed(g_hTest, "Received %#RX64 bytes, expected %#RX64 (stream #%u)",
+                                 offStream, pArgs->cbStream, iStream);
+                    rc = VERR_MISMATCH;
+                }
+            }
+            else if (RT_FAILURE(rc))
+                RTTestFailed(g_hTest, "pfnRead -> %Rrc at %#RX64 (stream #%u)", rc, offStream, iStream);
+            /* Tell the sender we're done with this stream. */
+            if (RT_SUCCESS(rc))
+                rc = RTTcpWrite(hCtrl, RT_STR_TUPLE("ACK\n"));
+        }
+        RTMemFree(pbBuf);
+        SSMR3TcpStripeDestroy(pStripe);
+    }
+    else
+        RTTestFailed(g_hTest, "SSMR3TcpStripeListen -> %Rrc", rc);
+
+    RTTcpServerDisconnectClient2(hCtrl);
+    return pArgs->rc = rc;
+}
+
+
+/**
+ * Sends @a cStreams streams of @a cbStream bytes over @a cConns connections
+ * and reports the throughput.
+ */
+static void tstBenchmark(uint32_t cConns, uint32_t cStreams, uint64_t cbStream)
+{
+    RTTestSubF(g_hTest, "%u connection(s), %u stream(s) of %RU64 MB", cConns, cStreams, cbStream / _1M);
+
+    /*
+     * Set up the server and the receiving end.
+     */
+    PRTTCPSERVER hServer = NULL;
+    uint32_t     uPort   = 0;
+    int          rc      = VERR_NET_ADDRESS_IN_USE;
+    for (unsigned cTries = 0; cTries < 256 && rc == VERR_NET_ADDRESS_IN_USE; cTries++)
+    {
+        uPort = RTRandU32Ex(49152, 65534);
+        rc = RTTcpServerCreateEx("127.0.0.1", uPort, &hServer);
+    }
+    RTTESTI_CHECK_RC_OK_RETV(rc);
+
+    TSTRECVARGS Args;
+    Args.hServer  = hServer;
+    Args.cConns   = cConns;
+    Args.cStreams = cStreams;
+    Args.cbStream = cbStream;
+    Args.rc       = VERR_INTERNAL_ERROR;
+    RTTHREAD hThread;
+    rc = RTThreadCreate(&hThread, tstRecvThread, &Args, 0, RTTHREADTYPE_DEFAULT, RTTHREADFLAGS_WAITABLE, "recv");
+    if (RT_FAILURE(rc))
+    {
+        RTTestFailed(g_hTest, "RTThreadCreate -> %Rrc", rc);
+        RTTcpServerDestroy(hServer);
+        return;
+    }
+
+    /*
+     * Connect and push the data.
+     */
+    RTSOCKET hCtrl = NIL_RTSOCKET;
+    rc = RTTcpClientConnect("127.0.0.1", uPort, &hCtrl);
+    PSSMTCPSTRIPE pStripe = NULL;
+    if (RT_SUCCESS(rc))
+        rc = SSMR3TcpStripeConnect(hCtrl, "127.0.0.1", cConns, true /*fWrite*/, &pStripe);
+    if (RT_SUCCESS(rc))
+    {
+        PCSSMSTRMOPS pOps  = SSMR3TcpStripeGetOps();
+        uint8_t     *pbBuf = (uint8_t *)RTMemAlloc(g_cbChunk);
+        uint64_t     cNsTotal = 0;
+        RTTESTI_CHECK(pbBuf != NULL);
+        for (uint32_t iStream = 0; iStream < cStreams && RT_SUCCESS(rc) && pbBuf; iStream++)
+        {
+            if (iStream > 0)
+                rc = SSMR3TcpStripeReset(pStripe);
+
+            uint64_t const nsStart = RTTimeNanoTS();
+            for (uint64_t offStream = 0; offStream < cbStream && RT_SUCCESS(rc); offStream += g_cbChunk)
+            {
+                tstFillChunk(pbBuf, g_cbChunk, offStream);
+                rc = pOps->pfnWrite(pStripe, offStream, pbBuf, g_cbChunk);
+            }
+            int rc2 = pOps->pfnClose(pStripe, RT_FAILURE(rc));
+            if (RT_SUCCESS(rc))
+                rc = rc2;
+
+            /* Wait for the receiver to confirm it got everything. */
+            char szAck[8];
+            RT_ZERO(szAck);
+            if (RT_SUCCESS(rc))
+                rc = RTTcpRead(hCtrl, szAck, 4, NULL);
+            cNsTotal += RTTimeNanoTS() - nsStart;
+            if (RT_SUCCESS(rc) && strcmp(szAck, "ACK\n"))
+                rc = VERR_MISMATCH;
+        }
+        if (RT_SUCCESS(rc))
+        {
+            uint64_t const cbTotal = cbStream * cStreams;
+            RTTestValueF(g_hTest, cbTotal * RT_NS_1SEC / RT_MAX(cNsTotal, 1) / _1M, RTTESTUNIT_MEGABYTES_PER_SEC,
+                         "%u conn throughput", cConns);
+            for (uint32_t i = 0; i < cConns; i++)
+                RTTestPrintf(g_hTest, RTTESTLVL_ALWAYS, "  conn #%u: %'RU64 bytes\n", i, SSMR3TcpStripeGetConnBytes(pStripe, i));
+        }
+        else
+            RTTestFailed(g_hTest, "Sending failed: %Rrc", rc);
+        RTMemFree(pbBuf);
+        SSMR3TcpStripeDestroy(pStripe);
+    }
+    else
+        RTTestFailed(g_hTest, "Connecting failed: %Rrc", rc);
+
+    if (hCtrl != NIL_RTSOCKET)
+        RTTcpClientClose(hCtrl);
+    RTTcpServerShutdown(hServer);
+    rc = RTThreadWait(hThread, 120000, NULL);
+    RTTESTI_CHECK_RC_OK(rc);
+    RTTESTI_CHECK_RC_OK(Args.rc);
+    RTTcpServerDestroy(hServer);
+}
+
+
+int main(int argc, char **argv)
+{
+    RTEXITCODE rcExit = RTTestInitAndCreate("tstSSMTcpStripe", &g_hTest);
+    if (rcExit != RTEXITCODE_SUCCESS)
+        return rcExit;
+    RTTestBanner(g_hTest);
+
+    /*
+     * Parse arguments.
+     */
+    static const RTGETOPTDEF s_aOptions[] =
+    {
+        { "--megabytes",    'm', RTGETOPT_REQ_UINT32 },
+        { "--max-conns",    'c', RTGETOPT_REQ_UINT32 },
+        { "--streams",      's', RTGETOPT_REQ_UINT32 },
+    };
+    uint32_t cMegs     = 256;
+    uint32_t cMaxConns = 8;
+    uint32_t cStreams  = 2;
+
+    RTGETOPTSTATE GetState;
+    RTGetOptInit(&GetState, argc, argv, s_aOptions, RT_ELEMENTS(s_aOptions), 1, 0 /*fFlags*/);
+    RTGETOPTUNION ValueUnion;
+    int ch;
+    while ((ch = RTGetOpt(&GetState, &ValueUnion)))
+    {
+        switch (ch)
+        {
+            case 'm': cMegs     = RT_MAX(ValueUnion.u32, 1); break;
+            case 'c': cMaxConns = RT_MIN(RT_MAX(ValueUnion.u32, 1), SSM_TCP_STRIPE_MAX_CONNS); break;
+            case 's': cStreams  = RT_MAX(ValueUnion.u32, 1); break;
+            default:
+                return RTGetOptPrintError(ch, &ValueUnion);
+        }
+    }
+
+    /*
+     * Run the benchmark with an increasing number of connections.
+     */
+    for (uint32_t cConns = 1; cConns <= cMaxConns; cConns *= 2)
+        tstBenchmark(cConns, cStreams, (uint64_t)cMegs * _1M);
+
+    return RTTestSummaryAndDestroy(g_hTest);
+}
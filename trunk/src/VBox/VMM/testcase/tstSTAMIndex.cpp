@@ -0,0 +1,183 @@
+/* $Id$ */
+/** @file
+ * STAM Testcase - Compiled sample indexes and binary snapshots.
+ *
+ * Includes the statistics manager and runs it against a bare user mode VM
+ * structure, without ring-0 statistics.
+ */
+
+/*
+ * Copyright (C) 2016 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ */
+
+
+/*********************************************************************************************************************************
+*   Header Files                                                                                                                 *
+*********************************************************************************************************************************/
+#include "../VMMR3/STAM.cpp"
+
+#include <iprt/test.h>
+
+
+/*********************************************************************************************************************************
+*   Global Variables                                                                                                             *
+*********************************************************************************************************************************/
+/** The test handle.*/
+static RTTEST   g_hTest;
+
+
+/*
+ *
+ * Fake VMM and support driver APIs.
+ *
+ */
+
+VMMR3DECL(VMSTATE) VMR3GetStateU(PUVM pUVM)
+{
+    RT_NOREF(pUVM);
+    return VMSTATE_RUNNING;
+}
+
+VMMDECL(const char *) VMGetStateName(VMSTATE enmState)
+{
+    RT_NOREF(enmState);
+    return "RUNNING";
+}
+
+VMMDECL(PVMCPU) VMMGetCpu(PVM pVM)
+{
+    RT_NOREF(pVM);
+    return NULL;
+}
+
+SUPR3DECL(int) SUPR3CallVMMR0Ex(PVMR0 pVMR0, VMCPUID idCpu, unsigned uOperation, uint64_t u64Arg, PSUPVMMR0REQHDR pReqHdr)
+{
+    RT_NOREF(pVMR0, idCpu, uOperation, u64Arg, pReqHdr);
+    return VERR_NOT_SUPPORTED;
+}
+
+#ifdef VBOX_WITH_DEBUGGER
+DBGDECL(int) DBGCRegisterCommands(PCDBGCCMD paCommands, unsigned cCommands)
+{
+    RT_NOREF(paCommands, cCommands);
+    return VINF_SUCCESS;
+}
+#endif
+
+
+/**
+ * Checks that an index has exactly the given samples, in order.
+ */
+static void tstCheckIndex(PSTAMINDEX pIndex, const char * const *papszNames, uint32_t cNames)
+{
+    RTTEST_CHECK_MSG_RETV(g_hTest, STAMR3IndexGetSampleCount(pIndex) == cNames,
+                          (g_hTest, "%u samples, expected %u\n", STAMR3IndexGetSampleCount(pIndex), cNames));
+    for (uint32_t i = 0; i < cNames; i++)
+    {
+        const char *pszName = NULL;
+        RTTEST_CHECK_RC(g_hTest, STAMR3IndexQuerySample(pIndex, i, &pszName, NULL, NULL, NULL, NULL), VINF_SUCCESS);
+        if (!pszName || strcmp(pszName, papszNames[i]))
+            RTTestFailed(g_hTest, "sample #%u is '%s', expected '%s'", i, pszName, papszNames[i]);
+    }
+}
+
+
+/**
+ * Samples registered after a pattern was compiled must show up when the
+ * pattern is compiled again, also after the first index has been re-resolved
+ * by a snapshot.
+ */
+static void tstRegisterAfterCompile(PUVM pUVM)
+{
+    RTTestSub(g_hTest, "Register after compile");
+
+    static uint32_t s_cFirst  = 1;
+    static uint32_t s_cSecond = 2;
+    static uint32_t s_cThird  = 3;
+    static const char * const s_apszNames[] = { "/Test/First", "/Test/Second", "/Test/Third" };
+    RTTEST_CHECK_RC(g_hTest, STAMR3RegisterU(pUVM, &s_cFirst, STAMTYPE_U32, STAMVISIBILITY_ALWAYS, s_apszNames[0],
+                                             STAMUNIT_OCCURENCES, NULL), VINF_SUCCESS);
+
+    PSTAMINDEX pIndex1 = NULL;
+    RTTEST_CHECK_RC_RETV(g_hTest, STAMR3IndexCompile(pUVM, "/Test/*", &pIndex1), VINF_SUCCESS);
+    tstCheckIndex(pIndex1, s_apszNames, 1);
+
+    /* Register a sample and take a snapshot with the old index, which
+       re-resolves it against the new registry generation. */
+    RTTEST_CHECK_RC(g_hTest, STAMR3RegisterU(pUVM, &s_cSecond, STAMTYPE_U32, STAMVISIBILITY_ALWAYS, s_apszNames[1],
+                                             STAMUNIT_OCCURENCES, NULL), VINF_SUCCESS);
+    uint64_t au64Values[3] = { 0, 0, 0 };
+    RTTEST_CHECK_RC(g_hTest, STAMR3SnapshotBinary(pUVM, pIndex1, au64Values, 1), VINF_SUCCESS);
+    RTTEST_CHECK(g_hTest, au64Values[0] == 1);
+
+    /* Compiling again must not hand back the cached index. */
+    PSTAMINDEX pIndex2 = NULL;
+    RTTEST_CHECK_RC(g_hTest, STAMR3IndexCompile(pUVM, "/Test/*", &pIndex2), VINF_SUCCESS);
+    if (pIndex2)
+    {
+        RTTEST_CHECK(g_hTest, pIndex2 != pIndex1);
+        tstCheckIndex(pIndex2, s_apszNames, 2);
+        RTTEST_CHECK_RC(g_hTest, STAMR3SnapshotBinary(pUVM, pIndex2, au64Values, 2), VINF_SUCCESS);
+        RTTEST_CHECK(g_hTest, au64Values[0] == 1 && au64Values[1] == 2);
+    }
+
+    /* Once more, without a snapshot in between. */
+    RTTEST_CHECK_RC(g_hTest, STAMR3RegisterU(pUVM, &s_cThird, STAMTYPE_U32, STAMVISIBILITY_ALWAYS, s_apszNames[2],
+                                             STAMUNIT_OCCURENCES, NULL), VINF_SUCCESS);
+    PSTAMINDEX pIndex3 = NULL;
+    RTTEST_CHECK_RC(g_hTest, STAMR3IndexCompile(pUVM, "/Test/*", &pIndex3), VINF_SUCCESS);
+    if (pIndex3)
+    {
+        tstCheckIndex(pIndex3, s_apszNames, 3);
+        RTTEST_CHECK_RC(g_hTest, STAMR3SnapshotBinary(pUVM, pIndex3, au64Values, 3), VINF_SUCCESS);
+        RTTEST_CHECK(g_hTest, au64Values[0] == 1 && au64Values[1] == 2 && au64Values[2] == 3);
+    }
+
+    /* Nothing changed, so now the cache must be used. */
+    PSTAMINDEX pIndex4 = NULL;
+    RTTEST_CHECK_RC(g_hTest, STAMR3IndexCompile(pUVM, "/Test/*", &pIndex4), VINF_SUCCESS);
+    RTTEST_CHECK(g_hTest, pIndex4 == pIndex3);
+
+    /* The old index keeps its layout, deregistered samples read as zero. */
+    RTTEST_CHECK_RC(g_hTest, STAMR3DeregisterByAddr(pUVM, &s_cFirst), VINF_SUCCESS);
+    au64Values[0] = UINT64_MAX;
+    RTTEST_CHECK_RC(g_hTest, STAMR3SnapshotBinary(pUVM, pIndex1, au64Values, 1), VINF_SUCCESS);
+    RTTEST_CHECK(g_hTest, au64Values[0] == 0);
+
+    STAMR3IndexRelease(pUVM, pIndex4);
+    STAMR3IndexRelease(pUVM, pIndex3);
+    STAMR3IndexRelease(pUVM, pIndex2);
+    STAMR3IndexRelease(pUVM, pIndex1);
+    STAMR3Deregister(pUVM, "/Test/*");
+}
+
+
+int main()
+{
+    RTEXITCODE rcExit = RTTestInitAndCreate("tstSTAMIndex", &g_hTest);
+    if (rcExit != RTEXITCODE_SUCCESS)
+        return rcExit;
+    RTTestBanner(g_hTest);
+
+    /*
+     * Just enough of a user mode VM for STAM.
+     */
+    PUVM pUVM = (PUVM)RTMemPageAllocZ(RT_ALIGN_Z(sizeof(UVM), PAGE_SIZE));
+    RTTEST_CHECK_RET(g_hTest, pUVM, RTTestSummaryAndDestroy(g_hTest));
+    pUVM->u32Magic = UVM_MAGIC;
+    RTTEST_CHECK_RC_RET(g_hTest, STAMR3InitUVM(pUVM), VINF_SUCCESS, RTTestSummaryAndDestroy(g_hTest));
+
+    tstRegisterAfterCompile(pUVM);
+
+    STAMR3TermUVM(pUVM);
+    RTMemPageFree(pUVM, RT_ALIGN_Z(sizeof(UVM), PAGE_SIZE));
+    return RTTestSummaryAndDestroy(g_hTest);
+}
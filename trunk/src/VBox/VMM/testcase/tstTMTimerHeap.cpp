@@ -0,0 +1,302 @@
+/* $Id$ */
+/** @file
+ * TM Testcase: Active timer heap vs. sorted list microbenchmark.
+ */
+
+/*
+ * Copyright (C) 2016 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ */
+
+
+/*********************************************************************************************************************************
+*   Header Files                                                                                                                 *
+*********************************************************************************************************************************/
+#include <VBox/vmm/tm.h>
+#include <VBox/vmm/dbgftrace.h>
+#include "TMInternal.h"
+#include <VBox/vmm/vm.h>
+#include <VBox/err.h>
+
+#include <iprt/getopt.h>
+#include <iprt/initterm.h>
+#include <iprt/mem.h>
+#include <iprt/rand.h>
+#include <iprt/string.h>
+#include <iprt/test.h>
+#include <iprt/time.h>
+
+#include "TMInline.h"
+
+
+/*********************************************************************************************************************************
+*   Global Variables                                                                                                             *
+*********************************************************************************************************************************/
+static RTTEST   g_hTest;
+
+
+/**
+ * Inserts a timer into a sorted doubly linked list, the way the active
+ * queues were maintained before they became heaps.
+ */
+static PTMTIMER tstListInsert(PTMTIMER pHead, PTMTIMER pTimer)
+{
+    uint64_t const u64Expire = pTimer->u64Expire;
+    PTMTIMER pCur = pHead;
+    if (!pCur)
+        return pTimer;
+    for (;; pCur = TMTIMER_GET_NEXT(pCur))
+    {
+        if (pCur->u64Expire > u64Expire)
+        {
+            PTMTIMER const pPrev = TMTIMER_GET_PREV(pCur);
+            TMTIMER_SET_NEXT(pTimer, pCur);
+            TMTIMER_SET_PREV(pTimer, pPrev);
+            TMTIMER_SET_PREV(pCur, pTimer);
+            if (!pPrev)
+                return pTimer;
+            TMTIMER_SET_NEXT(pPrev, pTimer);
+            return pHead;
+        }
+        if (!pCur->offNext)
+        {
+            TMTIMER_SET_NEXT(pCur, pTimer);
+            TMTIMER_SET_PREV(pTimer, pCur);
+            return pHead;
+        }
+    }
+}
+
+
+/**
+ * Removes a timer from the sorted list.
+ */
+static PTMTIMER tstListRemove(PTMTIMER pHead, PTMTIMER pTimer)
+{
+    PTMTIMER const pPrev = TMTIMER_GET_PREV(pTimer);
+    PTMTIMER const pNext = TMTIMER_GET_NEXT(pTimer);
+    if (pPrev)
+        TMTIMER_SET_NEXT(pPrev, pNext);
+    else
+        pHead = pNext;
+    if (pNext)
+        TMTIMER_SET_PREV(pNext, pPrev);
+    pTimer->offNext = 0;
+    pTimer->offPrev = 0;
+    return pHead;
+}
+
+
+/**
+ * Assigns new random expire times to the timers.
+ */
+static void tstRandomize(PTMTIMER paTimers, uint32_t cTimers, uint64_t uNow)
+{
+    for (uint32_t i = 0; i < cTimers; i++)
+    {
+        RT_ZERO(paTimers[i]);
+        paTimers[i].u64Expire = uNow + RTRandU64Ex(1, cTimers * UINT64_C(1000));
+    }
+}
+
+
+/**
+ * Runs the simulation of an active queue with @a cTimers periodic timers on
+ * either the list or the heap.
+ *
+ * Each step removes the head (checking the order) and re-arms it a random
+ * interval into the future, like a periodic timer callback does.  Every
+ * eighth step additionally cancels and re-arms a random timer.
+ */
+static void tstSimulate(PTMTIMER paTimers, uint32_t cTimers, uint32_t cSteps, bool fHeap)
+{
+    RTTestSubF(g_hTest, "%s, %u timers", fHeap ? "heap" : "list", cTimers);
+
+    tstRandomize(paTimers, cTimers, 0);
+    PTMTIMER pHead = NULL;
+    for (uint32_t i = 0; i < cTimers; i++)
+        pHead = fHeap ? tmTimerHeapInsert(pHead, &paTimers[i]) : tstListInsert(pHead, &paTimers[i]);
+
+    uint64_t       uNow     = 0;
+    uint32_t       cErrors  = 0;
+    uint64_t const nsStart  = RTTimeNanoTS();
+    for (uint32_t iStep = 0; iStep < cSteps; iStep++)
+    {
+        PTMTIMER pTimer = pHead;
+        if (pTimer->u64Expire < uNow)
+            cErrors++;
+        uNow = pTimer->u64Expire;
+        pHead = fHeap ? tmTimerHeapRemove(pHead, pTimer) : tstListRemove(pHead, pTimer);
+        pTimer->u64Expire = uNow + RTRandU32Ex(1, cTimers * 1000);
+        pHead = fHeap ? tmTimerHeapInsert(pHead, pTimer) : tstListInsert(pHead, pTimer);
+
+        if (!(iStep & 7))
+        {
+            pTimer = &paTimers[RTRandU32Ex(0, cTimers - 1)];
+            pHead = fHeap ? tmTimerHeapRemove(pHead, pTimer) : tstListRemove(pHead, pTimer);
+            pTimer->u64Expire = uNow + RTRandU32Ex(1, cTimers * 1000);
+            pHead = fHeap ? tmTimerHeapInsert(pHead, pTimer) : tstListInsert(pHead, pTimer);
+        }
+    }
+    uint64_t const cNsElapsed = RTTimeNanoTS() - nsStart;
+    RTTestValue(g_hTest, "step", cNsElapsed / RT_MAX(cSteps, 1), RTTESTUNIT_NS_PER_CALL);
+
+    /* Drain it and check that everything comes out in order. */
+    uint32_t cLeft = 0;
+    while (pHead)
+    {
+        PTMTIMER pTimer = pHead;
+        if (pTimer->u64Expire < uNow)
+            cErrors++;
+        uNow = pTimer->u64Expire;
+        pHead = fHeap ? tmTimerHeapRemove(pHead, pTimer) : tstListRemove(pHead, pTimer);
+        if (pTimer->offNext || pTimer->offPrev || pTimer->offChild)
+            cErrors++;
+        cLeft++;
+    }
+    if (cLeft != cTimers)
+        RTTestFailed(g_hTest, "Drained %u timers, expected %u", cLeft, cTimers);
+    if (cErrors)
+        RTTestFailed(g_hTest, "%u ordering/link errors", cErrors);
+}
+
+
+/**
+ * Checks that a pre-order walk visits every timer in the heap exactly once.
+ */
+static void tstWalk(PTMTIMER paTimers, uint32_t cTimers)
+{
+    RTTestSubF(g_hTest, "walk, %u timers", cTimers);
+
+    tstRandomize(paTimers, cTimers, 0);
+    PTMTIMER pHead = NULL;
+    for (uint32_t i = 0; i < cTimers; i++)
+        pHead = tmTimerHeapInsert(pHead, &paTimers[i]);
+    /* Pop a few to give the heap some depth. */
+    for (uint32_t i = 0; i < cTimers / 4; i++)
+    {
+        PTMTIMER pTimer = pHead;
+        pHead = tmTimerHeapRemove(pHead, pTimer);
+        pTimer->u64Expire += cTimers * UINT64_C(1000);
+        pHead = tmTimerHeapInsert(pHead, pTimer);
+    }
+
+    uint32_t cVisited = 0;
+    for (PTMTIMER pCur = pHead; pCur; pCur = tmTimerHeapWalkNext(pCur))
+    {
+        pCur->uRunGen++;
+        cVisited++;
+        if (cVisited > cTimers)
+            break;
+    }
+    RTTESTI_CHECK_MSG(cVisited == cTimers, ("cVisited=%u cTimers=%u\n", cVisited, cTimers));
+    for (uint32_t i = 0; i < cTimers; i++)
+        RTTESTI_CHECK_MSG(paTimers[i].uRunGen == 1, ("#%u: uRunGen=%u\n", i, paTimers[i].uRunGen));
+}
+
+
+/**
+ * Checks that tmTimerHeapFindExpired steps over timers which don't qualify
+ * and still returns the expired ones in expire order.
+ */
+static void tstFindExpired(PTMTIMER paTimers, uint32_t cTimers)
+{
+    RTTestSubF(g_hTest, "find expired, %u timers", cTimers);
+
+    tstRandomize(paTimers, cTimers, 0);
+    PTMTIMER pHead = NULL;
+    for (uint32_t i = 0; i < cTimers; i++)
+    {
+        paTimers[i].enmState = TMTIMERSTATE_ACTIVE;
+        pHead = tmTimerHeapInsert(pHead, &paTimers[i]);
+    }
+
+    /* Every third timer is pending rescheduling, the rest fire in order
+       and are re-armed in the past like a periodic handler might do. */
+    for (uint32_t i = 0; i < cTimers; i += 3)
+        paTimers[i].enmState = TMTIMERSTATE_PENDING_RESCHEDULE;
+    uint64_t const u64Now   = cTimers * UINT64_C(500);
+    uint32_t const uRunGen  = 1;
+    uint64_t       u64Prev  = 0;
+    uint32_t       cFired   = 0;
+    uint32_t       cErrors  = 0;
+    PTMTIMER       pTimer;
+    while ((pTimer = tmTimerHeapFindExpired(pHead, u64Now, uRunGen)) != NULL)
+    {
+        if (   pTimer->u64Expire < u64Prev
+            || pTimer->u64Expire > u64Now
+            || pTimer->enmState != TMTIMERSTATE_ACTIVE)
+            cErrors++;
+        u64Prev = pTimer->u64Expire;
+        pHead = tmTimerHeapRemove(pHead, pTimer);
+        pTimer->uRunGen   = uRunGen;
+        pTimer->u64Expire = 0;
+        pHead = tmTimerHeapInsert(pHead, pTimer);
+        if (++cFired > cTimers)
+            break;
+    }
+
+    uint32_t cExpected = 0;
+    for (uint32_t i = 0; i < cTimers; i++)
+        if (paTimers[i].enmState == TMTIMERSTATE_ACTIVE && (paTimers[i].uRunGen == uRunGen || paTimers[i].u64Expire <= u64Now))
+            cExpected++;
+    RTTESTI_CHECK_MSG(cFired == cExpected, ("cFired=%u cExpected=%u\n", cFired, cExpected));
+    if (cErrors)
+        RTTestFailed(g_hTest, "%u ordering/state errors", cErrors);
+}
+
+
+int main(int argc, char **argv)
+{
+    RTEXITCODE rcExit = RTTestInitAndCreate("tstTMTimerHeap", &g_hTest);
+    if (rcExit != RTEXITCODE_SUCCESS)
+        return rcExit;
+    RTTestBanner(g_hTest);
+
+    /*
+     * Parse arguments.
+     */
+    static const RTGETOPTDEF s_aOptions[] =
+    {
+        { "--max-timers",   't', RTGETOPT_REQ_UINT32 },
+        { "--steps",        's', RTGETOPT_REQ_UINT32 },
+    };
+    uint32_t cMaxTimers = 4096;
+    uint32_t cSteps     = 200000;
+
+    RTGETOPTSTATE GetState;
+    RTGetOptInit(&GetState, argc, argv, s_aOptions, RT_ELEMENTS(s_aOptions), 1, 0 /*fFlags*/);
+    RTGETOPTUNION ValueUnion;
+    int ch;
+    while ((ch = RTGetOpt(&GetState, &ValueUnion)))
+    {
+        switch (ch)
+        {
+            case 't': cMaxTimers = RT_MAX(ValueUnion.u32, 2); break;
+            case 's': cSteps     = RT_MAX(ValueUnion.u32, 1); break;
+            default:
+                return RTGetOptPrintError(ch, &ValueUnion);
+        }
+    }
+
+    PTMTIMER paTimers = (PTMTIMER)RTMemAllocZ(sizeof(TMTIMER) * cMaxTimers);
+    RTTESTI_CHECK_RET(paTimers != NULL, RTTestSummaryAndDestroy(g_hTest));
+
+    for (uint32_t cTimers = 2; cTimers <= cMaxTimers; cTimers *= 4)
+    {
+        tstSimulate(paTimers, cTimers, cSteps, false /*fHeap*/);
+        tstSimulate(paTimers, cTimers, cSteps, true /*fHeap*/);
+        tstWalk(paTimers, cTimers);
+        tstFindExpired(paTimers, cTimers);
+    }
+
+    RTMemFree(paTimers);
+    return RTTestSummaryAndDestroy(g_hTest);
+}
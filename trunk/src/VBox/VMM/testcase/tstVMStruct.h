@@ -296,6 +296,9 @@
     GEN_CHECK_OFF(IEMCPU, aMemBbMappings[1]);
     GEN_CHECK_OFF(IEMCPU, DataTlb);
     GEN_CHECK_OFF(IEMCPU, CodeTlb);
+    GEN_CHECK_OFF(IEMCPU, OpCache);
+    GEN_CHECK_OFF(IEMCPU, OpCache.uRevision);
+    GEN_CHECK_OFF(IEMCPU, OpCache.uExecRev);
 
     GEN_CHECK_SIZE(IOM);
     GEN_CHECK_OFF(IOM, pTreesRC);
@@ -1125,7 +1128,9 @@
     GEN_CHECK_OFF_DOT(TM, aVirtualSyncCatchUpPeriods[1].u64Start);
     GEN_CHECK_OFF_DOT(TM, aVirtualSyncCatchUpPeriods[1].u32Percentage);
     GEN_CHECK_OFF(TM, pTimer);
+    GEN_CHECK_OFF(TM, paTimerQueuesR3Data);
     GEN_CHECK_OFF(TM, u32TimerMillies);
+    GEN_CHECK_OFF(TM, cTimerPoolThreads);
     GEN_CHECK_OFF(TM, pFree);
     GEN_CHECK_OFF(TM, pCreated);
     GEN_CHECK_OFF(TM, paTimerQueuesR3);
@@ -1149,6 +1154,10 @@
     GEN_CHECK_OFF(TMTIMER, offScheduleNext);
     GEN_CHECK_OFF(TMTIMER, offNext);
     GEN_CHECK_OFF(TMTIMER, offPrev);
+    GEN_CHECK_OFF(TMTIMER, offChild);
+    GEN_CHECK_OFF(TMTIMER, uRunGen);
+    GEN_CHECK_OFF(TMTIMER, idxQueue);
+    GEN_CHECK_OFF(TMTIMER, fFlags);
     GEN_CHECK_OFF(TMTIMER, pVMR0);
     GEN_CHECK_OFF(TMTIMER, pVMR3);
     GEN_CHECK_OFF(TMTIMER, pVMRC);
@@ -1162,6 +1171,8 @@
     GEN_CHECK_OFF(TMTIMERQUEUE, offActive);
     GEN_CHECK_OFF(TMTIMERQUEUE, offSchedule);
     GEN_CHECK_OFF(TMTIMERQUEUE, enmClock);
+    GEN_CHECK_OFF(TMTIMERQUEUE, uRunGen);
+    GEN_CHECK_OFF(TMTIMERQUEUE, idxQueue);
 
     GEN_CHECK_SIZE(TRPM); // has .mac
     GEN_CHECK_SIZE(TRPMCPU); // has .mac
@@ -24,6 +24,7 @@
 #include <iprt/mem.h>
 #include <iprt/err.h>
 #include <iprt/assert.h>
+#include <iprt/time.h>
 #include <iprt/x86.h>
 
 #ifdef RT_OS_WINDOWS
@@ -73,6 +74,7 @@ DECLASM(int32_t) x861_Test5(void);
 DECLASM(int32_t) x861_Test6(void);
 DECLASM(int32_t) x861_Test7(void);
 DECLASM(int32_t) x861_TestFPUInstr1(void);
+DECLASM(uint32_t) x861_DecodeBench(uint32_t cIterations);
 
 
 
@@ -263,6 +265,16 @@ int main()
         rc = x861_TestFPUInstr1();
         if (rc != 0)
             RTTestFailed(hTest, "x861_TestFPUInstr1 -> %d", rc);
+
+        /* Mostly of interest when running in a guest with IEM doing the work,
+           e.g. to compare /IEM/OpcodeCache on and off. */
+        RTTestSub(hTest, "Decode throughput");
+        uint32_t const cIterations   = _1M;
+        uint64_t const nsStart       = RTTimeNanoTS();
+        uint32_t const cInstrPerIter = x861_DecodeBench(cIterations);
+        uint64_t const cNsElapsed    = RTTimeNanoTS() - nsStart;
+        RTTestValue(hTest, "IEM decode", (uint64_t)cIterations * cInstrPerIter * RT_NS_1SEC / RT_MAX(cNsElapsed, 1),
+                    RTTESTUNIT_INSTRS_PER_SEC);
     }
 
     return RTTestSummaryAndDestroy(hTest);
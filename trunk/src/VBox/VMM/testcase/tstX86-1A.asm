@@ -3422,6 +3422,77 @@ ENDPROC     x861_TestFPUInstr1
 
 
 
+;;
+; Decoder throughput benchmark.
+;
+; Runs a loop of mixed length instructions (prefixes, ModR/M, SIB,
+; displacements and immediates) which is mainly interesting when executed in
+; a guest where IEM does the work.
+;
+; @returns  The number of instructions executed per iteration.
+; @param    cIterations     The number of loop iterations (32-bit).
+;
+BEGINPROC   x861_DecodeBench
+        SAVE_ALL_PROLOGUE
+%ifdef RT_ARCH_AMD64
+ %ifdef ASM_CALL64_GCC
+        mov     ecx, edi
+ %endif
+%else
+        mov     ecx, [xBP + xCB * 2]
+%endif
+        sub     xSP, 32
+        xor     eax, eax
+        xor     ebx, ebx
+        mov     [xSP + 8], eax
+        mov     [xSP + 12], eax
+        mov     [xSP + 16], eax
+        test    ecx, ecx
+        jz      .done
+
+.next:
+        mov     eax, 012345678h
+        add     ebx, eax
+        lea     esi, [ebx + eax * 2 + 010h]
+        xor     edx, edx
+        mov     [xSP + 8], eax
+        add     dword [xSP + 8], 01234h
+        mov     edi, [xSP + 8]
+        add     ax, 01234h
+        imul    edx, esi, 5
+        shl     eax, 3
+        and     ebx, 0ffffh
+        or      edi, ebx
+        movzx   eax, byte [xSP + 9]
+        movsx   edx, word [xSP + 10]
+        test    eax, edx
+        cmovz   eax, edi
+        sub     esi, edi
+        not     edx
+        rol     edi, 7
+        mov     [xSP + 12], al
+        inc     dword [xSP + 12]
+        cmp     dword [xSP + 12], 0
+        setnz   dl
+        xchg    eax, ebx
+        neg     esi
+        bswap   edi
+        adc     edx, [xSP + 16]
+        sbb     eax, 07fffffffh
+        nop
+        lea     edi, [esi + 012345678h]
+        mov     [xSP + 16], edx
+        dec     ecx
+        jnz     .next
+
+.done:
+        mov     eax, 33                 ; keep in sync with the loop above
+        SAVE_ALL_EPILOGUE
+        ret
+ENDPROC     x861_DecodeBench
+
+
+
 
 ;;
 ; Terminate the trap info array with a NIL entry.